@@ -130,6 +130,14 @@ public class MainActivity extends AppCompatActivity implements MqttSettingsDialo
     private long longitudeReceivedTime = 0L;
     private long trueWindAngleReceivedTime = 0L;
 
+    // MQTT payloads are 18 fields, a sequence number and K for keyframe or D for delta. In a delta an empty field
+    // has not changed and - is a field that is no longer available.
+    private static final int MQTT_FIELDS = 18;
+    private boolean[] mqttFieldAvailable = new boolean[MQTT_FIELDS];
+    private boolean mqttInSync = false;
+    private boolean mqttDelta = false;
+    private int mqttSequence = -1;
+
     private float startPressure;
     private float startHeading;
     private float startLatitude;
@@ -741,6 +749,45 @@ public class MainActivity extends AppCompatActivity implements MqttSettingsDialo
         });
     }
 
+    private void updateMqttSync(String[] split) {
+        if (split.length < MQTT_FIELDS + 2) {
+            // older firmware sends every field every time
+            mqttInSync = false;
+            mqttDelta = false;
+            return;
+        }
+
+        int sequence;
+        try {
+            sequence = Integer.parseInt(split[MQTT_FIELDS], 10);
+        } catch (Exception e) {
+            mqttInSync = false;
+            return;
+        }
+        mqttDelta = split[MQTT_FIELDS + 1].equals("D");
+        if (!mqttDelta) {
+            mqttInSync = true;
+        } else if (mqttSequence < 0 || sequence != (mqttSequence + 1) % 65536) {
+            // missed a publish, fields may have changed without us knowing until the next keyframe
+            mqttInSync = false;
+        }
+        mqttSequence = sequence;
+
+        for (int i = 0; i < MQTT_FIELDS; i++) {
+            if (split[i].equals("-")) {
+                mqttFieldAvailable[i] = false;
+            } else if (!split[i].isEmpty()) {
+                mqttFieldAvailable[i] = true;
+            } else if (!mqttDelta) {
+                mqttFieldAvailable[i] = false;
+            }
+        }
+    }
+
+    private boolean mqttFieldUnchanged(String[] split, int index) {
+        return mqttDelta && mqttInSync && index < split.length && split[index].isEmpty() && mqttFieldAvailable[index];
+    }
+
     private void messageBox(String message) {
         alert.setMessage(message);
         alert.show();
@@ -1297,52 +1344,77 @@ public class MainActivity extends AppCompatActivity implements MqttSettingsDialo
                                             String payload = new String(publish.getPayloadAsBytes());
 
                                             String[] split = payload.split(",");
+                                            updateMqttSync(split);
                                             try {
                                                 depth = Float.parseFloat(split[8]);
                                                 depthReceivedTime = System.currentTimeMillis();
                                             } catch (Exception e) {
+                                                if (mqttFieldUnchanged(split, 8)) {
+                                                    depthReceivedTime = System.currentTimeMillis();
+                                                }
                                             }
 
                                             try {
                                                 sog = Float.parseFloat(split[3]);
                                                 sogReceivedTime = System.currentTimeMillis();
                                             } catch (Exception e) {
+                                                if (mqttFieldUnchanged(split, 3)) {
+                                                    sogReceivedTime = System.currentTimeMillis();
+                                                }
                                             }
 
                                             try {
                                                 latitude = Float.parseFloat(split[13]);
                                                 latitudeReceivedTime = System.currentTimeMillis();
                                             } catch (Exception e) {
+                                                if (mqttFieldUnchanged(split, 13)) {
+                                                    latitudeReceivedTime = System.currentTimeMillis();
+                                                }
                                             }
 
                                             try {
                                                 trueWindAngle = Float.parseFloat(split[10]);
                                                 trueWindAngleReceivedTime = System.currentTimeMillis();
                                             } catch (Exception e) {
+                                                if (mqttFieldUnchanged(split, 10)) {
+                                                    trueWindAngleReceivedTime = System.currentTimeMillis();
+                                                }
                                             }
 
                                             try {
                                                 longitude = Float.parseFloat(split[14]);
                                                 longitudeReceivedTime = System.currentTimeMillis();
                                             } catch (Exception e) {
+                                                if (mqttFieldUnchanged(split, 14)) {
+                                                    longitudeReceivedTime = System.currentTimeMillis();
+                                                }
                                             }
 
                                             try {
                                                 heading = Float.parseFloat(split[7]);
                                                 headingReceivedTime = System.currentTimeMillis();
                                             } catch (Exception e) {
+                                                if (mqttFieldUnchanged(split, 7)) {
+                                                    headingReceivedTime = System.currentTimeMillis();
+                                                }
                                             }
 
                                             try {
                                                 windspeed = Float.parseFloat(split[11]);
                                                 windspeedReceivedTime = System.currentTimeMillis();
                                             } catch (Exception e) {
+                                                if (mqttFieldUnchanged(split, 11)) {
+                                                    windspeedReceivedTime = System.currentTimeMillis();
+                                                }
                                             }
 
                                             try {
                                                 pressure = Float.parseFloat(split[15]);
                                                 pressureReceivedTime = System.currentTimeMillis();
                                             } catch (Exception e) {
+                                                if (mqttFieldUnchanged(split, 15)) {
+                                                    pressureReceivedTime = System.currentTimeMillis();
+                                                }
                                             }
 
                                             try {
@@ -1376,7 +1448,9 @@ public class MainActivity extends AppCompatActivity implements MqttSettingsDialo
                                                     setSignalStrengthIcon(5);
                                                 }
                                             } catch (Exception e) {
-                                                setSignalStrengthIcon(0);
+                                                if (!mqttFieldUnchanged(split, 0)) {
+                                                    setSignalStrengthIcon(0);
+                                                }
                                             }
                                         })
                                         .send()
@@ -30,26 +30,16 @@ This is class for reading Actisense format messages from given stream.
 tActisenseReader::tActisenseReader() {
   DefaultSource=65;
   ReadStream=0;
+  MsgHandler=0;
+  BadMessages=0;
   ClearBuffer();
 }
 
 //*****************************************************************************
 void tActisenseReader::ClearBuffer() {
   MsgWritePos=0;
-  byteSum=0;
-  StartOfTextReceived=false;
-  MsgIsComing=false;
-  EscapeReceived=false;
-}
-
-//*****************************************************************************
-bool tActisenseReader::AddByteToBuffer(char NewByte) {
-  if (MsgWritePos>=MAX_STREAM_MSG_BUF_LEN) return false;
-
-  MsgBuf[MsgWritePos]=NewByte;
-  MsgWritePos++;
-  if ( MsgBuf[1]+3!=MsgWritePos ) byteSum+=NewByte; // !Do not add CRC to byteSum
-  return true;
+  ByteSum=0;
+  State=rs_Idle;
 }
 
 #define Escape 0x10
@@ -63,16 +53,18 @@ bool tActisenseReader::CheckMessage(tN2kMsg &N2kMsg) {
 
    N2kMsg.Clear();
 
-   if (MsgWritePos!=MsgBuf[1]+3) {
+   if (MsgWritePos<3 || MsgWritePos!=MsgBuf[1]+3) {
      return false; // Length does not match. Add type, length and crc
    }
 
-   uint8_t CheckSum = (uint8_t)((byteSum == 0) ? 0 : (256 - byteSum));
-   if ( CheckSum!=MsgBuf[MsgWritePos-1] ) {
+   if ( ByteSum!=0 ) {
      return false; // Checksum does not match
    }
 
    int i=2;
+   int HeaderLen=( MsgBuf[0]==MsgTypeN2kData ? 11 : 6 );
+   if ( MsgBuf[1]<HeaderLen ) return false; // Too short for header
+
    N2kMsg.Priority=MsgBuf[i++];
    N2kMsg.PGN=GetBuf3ByteUInt(i,MsgBuf);
    N2kMsg.Destination=MsgBuf[i++];
@@ -85,12 +77,12 @@ bool tActisenseReader::CheckMessage(tN2kMsg &N2kMsg) {
    }
    N2kMsg.DataLen=MsgBuf[i++];
 
-   if ( N2kMsg.DataLen>tN2kMsg::MaxDataLen ) {
+   if ( N2kMsg.DataLen>tN2kMsg::MaxDataLen || i+N2kMsg.DataLen!=MsgWritePos-1 ) {
      N2kMsg.Clear();
-     return false; // Too long data
+     return false; // Too long data or data length does not match message length
    }
 
-   for (int j=0; i<MsgWritePos-1; i++, j++) N2kMsg.Data[j]=MsgBuf[i];
+   memcpy(N2kMsg.Data,&MsgBuf[i],N2kMsg.DataLen);
 
    return true;
 }
@@ -101,81 +93,120 @@ bool tActisenseReader::IsStart(char ch) {
 }
 
 //*****************************************************************************
-// Read Actisense formatted NMEA2000 message from stream
+// Parse Actisense formatted NMEA2000 messages from received data
 // Actisense Format:
 // <10><02><93><length (1)><priority (1)><PGN (3)><destination (1)><source (1)><time (4)><len (1)><data (len)><CRC (1)><10><03>
 // or
 // <10><02><94><length (1)><priority (1)><PGN (3)><destination (1)><len (1)><data (len)><CRC (1)><10><03>
-bool tActisenseReader::GetMessageFromStream(tN2kMsg &N2kMsg, bool ReadOut) {
-  bool result=false;
-
-  if (ReadStream==0) return false;
-
-  int NewByte;
-  bool ContinueLoopAvailable=true;
-
-  while ((NewByte = ReadStream->peek()) != -1 && !result && ContinueLoopAvailable) {
-//        Serial.println((char)NewByte,HEX);
-      if (MsgIsComing) {
-        ReadStream->read();
-        if (EscapeReceived) {
-          switch (NewByte) {
-            case Escape: // Escaped Escape
-              EscapeReceived=false;
-              if (!AddByteToBuffer(NewByte)) ClearBuffer();
-              break;
-            case EndOfText: // Message ready
-              switch (MsgBuf[0]) {
-                case MsgTypeN2kData:
-                case MsgTypeN2kRequest:
-                  result=CheckMessage(N2kMsg);
-                  break;
-                default:
-                  result=false;
-              }
-              ClearBuffer();
-              break;
-            case StartOfText: // Start new message
-              ClearBuffer();
-              StartOfTextReceived=true;
-              break;
-            default: // Error
-              ClearBuffer();
-          }
+// State is kept in locals in the loop and stored back on return.
+size_t tActisenseReader::ParseBlock(const unsigned char *Data, size_t Len, tN2kMsg &N2kMsg, bool &MsgReady) {
+  tState s=State;
+  int Pos=MsgWritePos;
+  uint8_t Sum=ByteSum;
+  size_t i=0;
+
+  MsgReady=false;
+
+  while ( i<Len ) {
+    unsigned char ch=Data[i++];
+
+    switch (s) {
+      case rs_Idle:
+        if ( ch==Escape ) s=rs_Escape;
+        break;
+      case rs_Escape:
+        if ( ch==StartOfText ) {
+          s=rs_Message;
+          Pos=0;
+          Sum=0;
+        } else if ( ch!=Escape ) {
+          s=rs_Idle;
+        }
+        break;
+      case rs_Message:
+        if ( ch==Escape ) {
+          s=rs_MessageEscape;
+        } else if ( Pos<MAX_STREAM_MSG_BUF_LEN ) {
+          MsgBuf[Pos++]=ch;
+          Sum+=ch;
         } else {
-          if (NewByte==Escape) {
-            EscapeReceived=true;
-          } else {
-            if (!AddByteToBuffer(NewByte)) ClearBuffer();
-          }
+          s=rs_Idle;
+          BadMessages++;
         }
-      } else {
-        switch (NewByte) {
-          case StartOfText:
-            StartOfTextReceived=false;
-            if (EscapeReceived) {
-              ReadStream->read(); // Read ch out
-              ClearBuffer();
-              StartOfTextReceived=true;
+        break;
+      case rs_MessageEscape:
+        switch (ch) {
+          case Escape: // Escaped Escape
+            if ( Pos<MAX_STREAM_MSG_BUF_LEN ) {
+              MsgBuf[Pos++]=ch;
+              Sum+=ch;
+              s=rs_Message;
+            } else {
+              s=rs_Idle;
+              BadMessages++;
             }
             break;
-          default:
-            EscapeReceived=(NewByte==Escape);
-            if (StartOfTextReceived) {
-              ReadStream->read(); // Read ch out
-              StartOfTextReceived=false;
-              MsgIsComing=true;
-              AddByteToBuffer(NewByte);
-            } else {
-              if ( EscapeReceived || ReadOut ) ReadStream->read(); // Read ch out
+          case EndOfText: // Message ready
+            s=rs_Idle;
+            if ( Pos>0 && (MsgBuf[0]==MsgTypeN2kData || MsgBuf[0]==MsgTypeN2kRequest) ) {
+              MsgWritePos=Pos;
+              ByteSum=Sum;
+              MsgReady=CheckMessage(N2kMsg);
+              if ( !MsgReady ) BadMessages++;
             }
+            break;
+          case StartOfText: // Start new message, previous was cut
+            s=rs_Message;
+            Pos=0;
+            Sum=0;
+            BadMessages++;
+            break;
+          default: // Error
+            s=rs_Idle;
+            BadMessages++;
         }
-      }
+        break;
+    }
+
+    if ( MsgReady ) break;
+  }
+
+  State=s;
+  MsgWritePos=( s==rs_Idle ? 0 : Pos );
+  ByteSum=Sum;
+
+  return i;
+}
+
+//*****************************************************************************
+void tActisenseReader::ParseBlock(const unsigned char *Data, size_t Len) {
+  tN2kMsg N2kMsg;
+  bool MsgReady;
+  size_t Used;
+
+  while ( Len>0 ) {
+    Used=ParseBlock(Data,Len,N2kMsg,MsgReady);
+    if ( MsgReady && MsgHandler!=0 ) MsgHandler(N2kMsg);
+    Data+=Used;
+    Len-=Used;
+  }
+}
 
-    ContinueLoopAvailable=ReadOut || Handling();
+//*****************************************************************************
+// Read Actisense formatted NMEA2000 message from stream
+bool tActisenseReader::GetMessageFromStream(tN2kMsg &N2kMsg, bool ReadOut) {
+  bool MsgReady=false;
+  int NewByte;
+
+  (void)ReadOut;
+  if (ReadStream==0) return false;
+
+  while ( !MsgReady && (NewByte=ReadStream->read())!=-1 ) {
+    unsigned char ch=(unsigned char)NewByte;
+    ParseBlock(&ch,1,N2kMsg,MsgReady);
   }
 
-  return result;
+  return MsgReady;
 }
 
 //*****************************************************************************
@@ -186,5 +217,3 @@ void tActisenseReader::ParseMessages() {
       if (MsgHandler!=0) MsgHandler(N2kMsg);
     }
 }
-
-
@@ -0,0 +1,161 @@
+/*
+N2kBusStats.cpp
+
+Copyright (c) 2022 John Blaiklock, BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <string.h>
+#include "N2kBusStats.h"
+
+//*****************************************************************************
+tN2kBusStats::tN2kBusStats(tNMEA2000 *_pNMEA2000, uint32_t _BitRate)
+  : tNMEA2000::tMsgHandler(0,_pNMEA2000), BitRate(_BitRate>0?_BitRate:250000) {
+  Clear();
+}
+
+//*****************************************************************************
+void tN2kBusStats::Clear() {
+  memset(SourceCounters,0,sizeof(SourceCounters));
+  memset(PGNCounters,0,sizeof(PGNCounters));
+  memset(WindowBits,0,sizeof(WindowBits));
+  PGNCount=0;
+  PGNOverflow=0;
+  Messages=0;
+  Frames=0;
+  SecondStart=0; // first Update restarts the window
+  SecondBits=0;
+  SecondFrames=0;
+  LastSecondBits=0;
+  LastSecondFrames=0;
+  WindowSum=0;
+  WindowIndex=0;
+  WindowFilled=0;
+  TxErrors=RxErrors=0;
+  MaxTxErrors=MaxRxErrors=0;
+}
+
+//*****************************************************************************
+void tN2kBusStats::AddBits(uint32_t Bits, uint32_t _Frames) {
+  SecondBits+=Bits;
+  SecondFrames+=_Frames;
+}
+
+//*****************************************************************************
+void tN2kBusStats::HandleMsg(const tN2kMsg &N2kMsg) {
+  uint32_t MsgFrames;
+  uint32_t Bits;
+
+  if ( N2kMsg.DataLen<=8 ) {
+    MsgFrames=1;
+    Bits=FrameBits((uint8_t)N2kMsg.DataLen);
+  } else { // fast packet, 6 bytes in first frame and 7 in rest, all frames 8 bytes long
+    MsgFrames=(N2kMsg.DataLen-6-1)/7+1+1;
+    Bits=MsgFrames*FrameBits(8);
+  }
+
+  Messages++;
+  Frames+=MsgFrames;
+  AddBits(Bits,MsgFrames);
+
+  if ( N2kMsg.Source<Sources ) {
+    SourceCounters[N2kMsg.Source].Frames+=MsgFrames;
+    SourceCounters[N2kMsg.Source].Bytes+=N2kMsg.DataLen;
+  }
+
+  uint8_t i;
+  for (i=0; i<PGNCount && PGNCounters[i].PGN!=N2kMsg.PGN; i++);
+  if ( i==PGNCount ) {
+    if ( PGNCount==MaxPGNs ) {
+      PGNOverflow++;
+      return;
+    }
+    PGNCounters[PGNCount++].PGN=N2kMsg.PGN;
+  }
+  PGNCounters[i].Count.Frames+=MsgFrames;
+  PGNCounters[i].Count.Bytes+=N2kMsg.DataLen;
+}
+
+//*****************************************************************************
+void tN2kBusStats::Update(unsigned long Now) {
+  if ( Now-SecondStart>(unsigned long)(LongWindow+1)*1000 ) { // first call or long gap, window has nothing useful
+    memset(WindowBits,0,sizeof(WindowBits));
+    WindowSum=0;
+    WindowIndex=0;
+    WindowFilled=0;
+    LastSecondBits=0;
+    LastSecondFrames=0;
+    SecondBits=0;
+    SecondFrames=0;
+    SecondStart=Now;
+    return;
+  }
+
+  while ( Now-SecondStart>=1000 ) {
+    SecondStart+=1000;
+    LastSecondBits=SecondBits;
+    LastSecondFrames=SecondFrames;
+    WindowSum-=WindowBits[WindowIndex];
+    WindowBits[WindowIndex]=SecondBits;
+    WindowSum+=SecondBits;
+    WindowIndex=(WindowIndex+1)%LongWindow;
+    if ( WindowFilled<LongWindow ) WindowFilled++;
+    SecondBits=0;
+    SecondFrames=0;
+  }
+}
+
+//*****************************************************************************
+void tN2kBusStats::AddDroppedFrames(uint32_t Count) {
+  AddBits(Count*FrameBits(8),Count);
+}
+
+//*****************************************************************************
+void tN2kBusStats::SetErrorCounters(uint8_t Tx, uint8_t Rx) {
+  TxErrors=Tx;
+  RxErrors=Rx;
+  if ( Tx>MaxTxErrors ) MaxTxErrors=Tx;
+  if ( Rx>MaxRxErrors ) MaxRxErrors=Rx;
+}
+
+//*****************************************************************************
+uint8_t tN2kBusStats::GetActiveSources() const {
+  uint8_t Count=0;
+
+  for (uint16_t i=0; i<Sources; i++) {
+    if ( SourceCounters[i].Frames>0 ) Count++;
+  }
+
+  return Count;
+}
+
+//*****************************************************************************
+uint8_t tN2kBusStats::GetBusiestSource() const {
+  uint8_t Busiest=0xff;
+  uint32_t MostFrames=0;
+
+  for (uint16_t i=0; i<Sources; i++) {
+    if ( SourceCounters[i].Frames>MostFrames ) {
+      MostFrames=SourceCounters[i].Frames;
+      Busiest=(uint8_t)i;
+    }
+  }
+
+  return Busiest;
+}
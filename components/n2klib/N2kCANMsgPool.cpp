@@ -0,0 +1,185 @@
+/*
+N2kCANMsgPool.cpp
+
+Copyright (c) 2022 John Blaiklock, BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "N2kCANMsgPool.h"
+
+//*****************************************************************************
+tN2kCANMsgPool::tN2kCANMsgPool()
+  : Slots(0), DataBuf(0), HashHeads(0), HashMask(0), SmallSlots(0), LargeSlots(0),
+    FreeSmall(NoSlot), FreeLarge(NoSlot), AgeHead(NoSlot), AgeTail(NoSlot), UsedCount(0) {
+}
+
+//*****************************************************************************
+tN2kCANMsgPool::~tN2kCANMsgPool() {
+  delete[] Slots;
+  delete[] DataBuf;
+  delete[] HashHeads;
+}
+
+//*****************************************************************************
+bool tN2kCANMsgPool::Init(uint8_t _SmallSlots, uint8_t _LargeSlots) {
+  if ( Slots!=0 ) return false;
+  if ( _LargeSlots>128 ) _LargeSlots=128;
+  if ( (uint16_t)_SmallSlots+_LargeSlots>128 ) _SmallSlots=128-_LargeSlots;
+  uint8_t Count=_SmallSlots+_LargeSlots;
+  if ( Count==0 ) return false;
+
+  uint16_t Buckets=4;
+  while ( Buckets<Count ) Buckets*=2;
+
+  Slots=new tSlot[Count];
+  DataBuf=new unsigned char[(size_t)_SmallSlots*SmallDataLen+(size_t)_LargeSlots*tN2kMsg::MaxDataLen];
+  HashHeads=new uint8_t[Buckets];
+  if ( Slots==0 || DataBuf==0 || HashHeads==0 ) {
+    delete[] Slots; delete[] DataBuf; delete[] HashHeads;
+    Slots=0; DataBuf=0; HashHeads=0;
+    return false;
+  }
+
+  SmallSlots=_SmallSlots;
+  LargeSlots=_LargeSlots;
+  HashMask=(uint8_t)(Buckets-1);
+  for (uint16_t i=0; i<Buckets; i++) HashHeads[i]=NoSlot;
+
+  // Small slots first, free lists are chained through HashNext
+  unsigned char *Data=DataBuf;
+  for (uint8_t i=0; i<Count; i++) {
+    bool Small=(i<SmallSlots);
+    Slots[i].Data=Data;
+    Slots[i].MaxDataLen=(Small?SmallDataLen:tN2kMsg::MaxDataLen);
+    Data+=Slots[i].MaxDataLen;
+    Slots[i].Used=false;
+    Slots[i].HashNext=( Small ? (i+1<SmallSlots?i+1:NoSlot) : (i+1<Count?i+1:NoSlot) );
+    Slots[i].AgePrev=NoSlot;
+    Slots[i].AgeNext=NoSlot;
+  }
+  FreeSmall=(SmallSlots>0?0:NoSlot);
+  FreeLarge=(LargeSlots>0?SmallSlots:NoSlot);
+  AgeHead=AgeTail=NoSlot;
+  UsedCount=0;
+
+  return true;
+}
+
+//*****************************************************************************
+tN2kCANMsgPool::tSlot *tN2kCANMsgPool::Find(unsigned long KeyPGN, unsigned char Source, unsigned char Tag) {
+  if ( Slots==0 ) return 0;
+
+  for (uint8_t i=HashHeads[Hash(KeyPGN,Source,Tag)]; i!=NoSlot; i=Slots[i].HashNext) {
+    if ( Slots[i].KeyPGN==KeyPGN && Slots[i].Source==Source && Slots[i].Tag==Tag ) return &Slots[i];
+  }
+
+  return 0;
+}
+
+//*****************************************************************************
+tN2kCANMsgPool::tSlot *tN2kCANMsgPool::Alloc(unsigned long KeyPGN, unsigned char Source, unsigned char Tag, uint16_t DataLen, unsigned long Now) {
+  uint8_t i;
+
+  if ( Slots==0 || DataLen>tN2kMsg::MaxDataLen ) return 0;
+
+  if ( DataLen<=SmallDataLen && FreeSmall!=NoSlot ) {
+    i=FreeSmall;
+    FreeSmall=Slots[i].HashNext;
+  } else if ( FreeLarge!=NoSlot ) {
+    i=FreeLarge;
+    FreeLarge=Slots[i].HashNext;
+  } else return 0;
+
+  tSlot &Slot=Slots[i];
+  uint8_t Bucket=Hash(KeyPGN,Source,Tag);
+  Slot.KeyPGN=KeyPGN;
+  Slot.Source=Source;
+  Slot.Tag=Tag;
+  Slot.DataLen=(unsigned char)DataLen;
+  Slot.CopiedLen=0;
+  Slot.LastFrame=0;
+  Slot.KnownMessage=false;
+  Slot.SystemMessage=false;
+#if !defined(N2K_NO_ISO_MULTI_PACKET_SUPPORT)
+  Slot.TPMessage=false;
+  Slot.TPRequireCTS=0;
+  Slot.TPMaxPackets=0;
+#endif
+  Slot.Used=true;
+  Slot.HashNext=HashHeads[Bucket];
+  HashHeads[Bucket]=i;
+
+  Slot.LastTime=Now;
+  Slot.AgeNext=NoSlot;
+  Slot.AgePrev=AgeTail;
+  if ( AgeTail!=NoSlot ) { Slots[AgeTail].AgeNext=i; } else { AgeHead=i; }
+  AgeTail=i;
+  UsedCount++;
+
+  return &Slot;
+}
+
+//*****************************************************************************
+void tN2kCANMsgPool::Unlink(uint8_t Index) {
+  tSlot &Slot=Slots[Index];
+
+  if ( Slot.AgePrev!=NoSlot ) { Slots[Slot.AgePrev].AgeNext=Slot.AgeNext; } else { AgeHead=Slot.AgeNext; }
+  if ( Slot.AgeNext!=NoSlot ) { Slots[Slot.AgeNext].AgePrev=Slot.AgePrev; } else { AgeTail=Slot.AgePrev; }
+  Slot.AgePrev=Slot.AgeNext=NoSlot;
+}
+
+//*****************************************************************************
+void tN2kCANMsgPool::Free(tSlot *Slot) {
+  if ( Slot==0 || !Slot->Used ) return;
+
+  uint8_t Index=IndexOf(Slot);
+  uint8_t *Link=&HashHeads[Hash(Slot->KeyPGN,Slot->Source,Slot->Tag)];
+  for (; *Link!=NoSlot && *Link!=Index; Link=&Slots[*Link].HashNext);
+  if ( *Link==Index ) *Link=Slot->HashNext;
+
+  Unlink(Index);
+  Slot->Used=false;
+  if ( Index<SmallSlots ) {
+    Slot->HashNext=FreeSmall;
+    FreeSmall=Index;
+  } else {
+    Slot->HashNext=FreeLarge;
+    FreeLarge=Index;
+  }
+  UsedCount--;
+}
+
+//*****************************************************************************
+void tN2kCANMsgPool::Touch(tSlot *Slot, unsigned long Now) {
+  uint8_t Index=IndexOf(Slot);
+
+  Slot->LastTime=Now;
+  if ( AgeTail==Index ) return;
+  Unlink(Index);
+  Slot->AgePrev=AgeTail;
+  Slots[AgeTail].AgeNext=Index;
+  AgeTail=Index;
+}
+
+//*****************************************************************************
+tN2kCANMsgPool::tSlot *tN2kCANMsgPool::GetExpired(unsigned long Now, unsigned long Timeout) {
+  if ( AgeHead==NoSlot || Now-Slots[AgeHead].LastTime<=Timeout ) return 0;
+
+  return &Slots[AgeHead];
+}
@@ -0,0 +1,184 @@
+/*
+N2kGateway.cpp
+
+Copyright (c) 2022 John Blaiklock, BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <string.h>
+#include <stdio.h>
+#include "N2kGateway.h"
+#include "Seasmart.h"
+
+#define MaxSeasmartLen (30+2*tN2kMsg::MaxDataLen+2)
+#define YDRawLineLen 52 // "hh:mm:ss.ddd R xxxxxxxx" and 8 " xx" and \r\n
+
+//*****************************************************************************
+tN2kGateway::tN2kGateway(tNMEA2000 *_pNMEA2000, tWriteFunction _WriteFunction, uint16_t _MTU)
+  : tNMEA2000::tMsgHandler(0,_pNMEA2000), Format(gwf_Off), WriteFunction(_WriteFunction),
+    BufLen(0), BufMessages(0), PieceWritten(false), PieceDropped(false), FilterCount(0), IncludeCount(0) {
+  SetMTU(_MTU);
+  memset(&Statistics,0,sizeof(Statistics));
+}
+
+//*****************************************************************************
+void tN2kGateway::SetFormat(tFormat _Format) {
+  if ( Format==_Format ) return;
+  Format=_Format;
+  BufLen=0;
+  BufMessages=0;
+}
+
+//*****************************************************************************
+void tN2kGateway::SetMTU(uint16_t _MTU) {
+  Flush();
+  MTU=( _MTU>0 && _MTU<MaxMTU ? _MTU : MaxMTU );
+}
+
+//*****************************************************************************
+bool tN2kGateway::AddFilterPGN(unsigned long PGN, bool Exclude) {
+  if ( FilterCount>=MaxFilterPGNs ) return false;
+  FilterPGNs[FilterCount].PGN=PGN;
+  FilterPGNs[FilterCount].Exclude=Exclude;
+  FilterCount++;
+  if ( !Exclude ) IncludeCount++;
+  return true;
+}
+
+//*****************************************************************************
+bool tN2kGateway::IsPassed(unsigned long PGN) const {
+  bool Included=(IncludeCount==0);
+
+  for (uint8_t i=0; i<FilterCount; i++) {
+    if ( FilterPGNs[i].PGN!=PGN ) continue;
+    if ( FilterPGNs[i].Exclude ) return false;
+    Included=true;
+  }
+
+  return Included;
+}
+
+//*****************************************************************************
+// Counts what the write function took and what it did not.
+bool tN2kGateway::Write(const uint8_t *data, size_t size) {
+  size_t Written=(WriteFunction!=0 ? WriteFunction(data,size) : 0);
+
+  if ( Written>size ) Written=size;
+  Statistics.Bytes+=Written;
+  Statistics.DroppedBytes+=size-Written;
+  if ( Written<size ) return false;
+
+  Statistics.Writes++;
+  return true;
+}
+
+//*****************************************************************************
+void tN2kGateway::Flush() {
+  if ( BufLen==0 ) return;
+
+  if ( !Write(Buf,BufLen) ) Statistics.DroppedMessages+=BufMessages;
+  BufLen=0;
+  BufMessages=0;
+}
+
+//*****************************************************************************
+// Pieces of a message may go in different writes. A piece longer than MTU,
+// which only Actisense and Seasmart long messages make as the whole message,
+// is written as such and not counted in BufMessages.
+void tN2kGateway::Append(const uint8_t *data, size_t size) {
+  if ( BufLen+size>MTU ) Flush();
+  if ( size>MTU ) {
+    PieceWritten=true;
+    if ( !Write(data,size) ) PieceDropped=true;
+    return;
+  }
+  memcpy(Buf+BufLen,data,size);
+  BufLen+=size;
+}
+
+//*****************************************************************************
+void tN2kGateway::SendInSeasmartFormat(const tN2kMsg &N2kMsg) {
+  char Sentence[MaxSeasmartLen];
+  size_t Len=N2kToSeasmart(N2kMsg,N2kMsg.MsgTime,Sentence,sizeof(Sentence)-2);
+
+  if ( Len==0 ) return;
+  Len--; // returned length counts terminating 0
+  Sentence[Len++]='\r';
+  Sentence[Len++]='\n';
+  Append((const uint8_t *)Sentence,Len);
+}
+
+//*****************************************************************************
+void tN2kGateway::SendInYDRawFormat(const tN2kMsg &N2kMsg) {
+  char Line[YDRawLineLen+1];
+  unsigned long id=N2ktoCanID(N2kMsg.Priority,N2kMsg.PGN,N2kMsg.Source,N2kMsg.Destination);
+  unsigned long Time=N2kMsg.MsgTime%86400000UL;
+  int Copied=0;
+  uint8_t Frame=0;
+
+  if ( id==0 || N2kMsg.DataLen>tN2kMsg::MaxDataLen ) return;
+
+  do {
+    uint8_t FrameData[8];
+    uint8_t FrameLen=0;
+
+    if ( N2kMsg.DataLen<=8 ) {
+      for (; Copied<N2kMsg.DataLen; Copied++) FrameData[FrameLen++]=N2kMsg.Data[Copied];
+    } else {
+      FrameData[FrameLen++]=Frame;
+      if ( Frame==0 ) FrameData[FrameLen++]=(uint8_t)N2kMsg.DataLen;
+      for (; FrameLen<8 && Copied<N2kMsg.DataLen; Copied++) FrameData[FrameLen++]=N2kMsg.Data[Copied];
+      for (; FrameLen<8; FrameLen++) FrameData[FrameLen]=0xff;
+    }
+
+    int Len=snprintf(Line,sizeof(Line),"%02lu:%02lu:%02lu.%03lu R %08lX",
+                     Time/3600000UL,(Time/60000UL)%60,(Time/1000UL)%60,Time%1000UL,id);
+    for (uint8_t i=0; i<FrameLen; i++) Len+=snprintf(Line+Len,sizeof(Line)-Len," %02X",FrameData[i]);
+    Line[Len++]='\r';
+    Line[Len++]='\n';
+    Append((const uint8_t *)Line,Len);
+    Frame++;
+  } while ( Copied<N2kMsg.DataLen );
+}
+
+//*****************************************************************************
+void tN2kGateway::HandleMsg(const tN2kMsg &N2kMsg) {
+  if ( Format==gwf_Off ) return;
+
+  if ( !IsPassed(N2kMsg.PGN) ) {
+    Statistics.Filtered++;
+    return;
+  }
+
+  PieceWritten=false;
+  PieceDropped=false;
+  switch ( Format ) {
+    case gwf_Actisense: N2kMsg.SendInActisenseFormat(this); break;
+    case gwf_Seasmart: SendInSeasmartFormat(N2kMsg); break;
+    case gwf_YDRaw: SendInYDRawFormat(N2kMsg); break;
+    default: return;
+  }
+
+  Statistics.Messages++;
+  if ( PieceDropped ) {
+    Statistics.DroppedMessages++;
+  } else if ( !PieceWritten ) {
+    BufMessages++;
+  }
+}
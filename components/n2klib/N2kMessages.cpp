@@ -302,6 +302,54 @@ bool ParseN2kPGN127250(const tN2kMsg &N2kMsg, unsigned char &SID, double &Headin
   return true;
 }
 
+void SetN2kPGN127250(tN2kMsg &N2kMsg, unsigned char SID, float Heading, float Deviation, float Variation, tN2kHeadingReference ref) {
+    N2kMsg.SetPGN(127250L);
+    N2kMsg.Priority=2;
+    N2kMsg.AddByte(SID);
+    N2kMsg.Add2ByteUFloat(Heading,0.0001f);
+    N2kMsg.Add2ByteFloat(Deviation,0.0001f);
+    N2kMsg.Add2ByteFloat(Variation,0.0001f);
+    N2kMsg.AddByte(0xfc | ref);
+}
+
+void SetN2kPGN127250(tN2kMsg &N2kMsg, unsigned char SID, uint32_t Heading, int32_t Deviation, int32_t Variation, tN2kHeadingReference ref) {
+    N2kMsg.SetPGN(127250L);
+    N2kMsg.Priority=2;
+    N2kMsg.AddByte(SID);
+    N2kMsg.Add2ByteUFixed(Heading);
+    N2kMsg.Add2ByteFixed(Deviation);
+    N2kMsg.Add2ByteFixed(Variation);
+    N2kMsg.AddByte(0xfc | ref);
+}
+
+bool ParseN2kPGN127250(const tN2kMsg &N2kMsg, unsigned char &SID, float &Heading, float &Deviation, float &Variation, tN2kHeadingReference &ref) {
+  if (N2kMsg.PGN!=127250L) return false;
+
+  int Index=0;
+
+  SID=N2kMsg.GetByte(Index);
+  Heading=N2kMsg.Get2ByteUFloat(0.0001f,Index);
+  Deviation=N2kMsg.Get2ByteFloat(0.0001f,Index);
+  Variation=N2kMsg.Get2ByteFloat(0.0001f,Index);
+  ref=(tN2kHeadingReference)(N2kMsg.GetByte(Index)&0x03);
+
+  return true;
+}
+
+bool ParseN2kPGN127250(const tN2kMsg &N2kMsg, unsigned char &SID, uint32_t &Heading, int32_t &Deviation, int32_t &Variation, tN2kHeadingReference &ref) {
+  if (N2kMsg.PGN!=127250L) return false;
+
+  int Index=0;
+
+  SID=N2kMsg.GetByte(Index);
+  Heading=N2kMsg.Get2ByteUFixed(Index);
+  Deviation=N2kMsg.Get2ByteFixed(Index);
+  Variation=N2kMsg.Get2ByteFixed(Index);
+  ref=(tN2kHeadingReference)(N2kMsg.GetByte(Index)&0x03);
+
+  return true;
+}
+
 //*****************************************************************************
 // Rate of turn
 // Angles should be in radians
@@ -816,6 +864,54 @@ bool ParseN2kPGN128259(const tN2kMsg &N2kMsg, unsigned char &SID, double &WaterR
   return true;
 }
 
+void SetN2kPGN128259(tN2kMsg &N2kMsg, unsigned char SID, float WaterReferenced, float GroundReferenced, tN2kSpeedWaterReferenceType SWRT) {
+    N2kMsg.SetPGN(128259L);
+    N2kMsg.Priority=2;
+    N2kMsg.AddByte(SID);
+    N2kMsg.Add2ByteUFloat(WaterReferenced,0.01f);
+    N2kMsg.Add2ByteUFloat(GroundReferenced,0.01f);
+    N2kMsg.AddByte(SWRT);
+    N2kMsg.AddByte(0xff); // Reserved
+    N2kMsg.AddByte(0xff); // Reserved
+}
+
+void SetN2kPGN128259(tN2kMsg &N2kMsg, unsigned char SID, uint32_t WaterReferenced, uint32_t GroundReferenced, tN2kSpeedWaterReferenceType SWRT) {
+    N2kMsg.SetPGN(128259L);
+    N2kMsg.Priority=2;
+    N2kMsg.AddByte(SID);
+    N2kMsg.Add2ByteUFixed(WaterReferenced);
+    N2kMsg.Add2ByteUFixed(GroundReferenced);
+    N2kMsg.AddByte(SWRT);
+    N2kMsg.AddByte(0xff); // Reserved
+    N2kMsg.AddByte(0xff); // Reserved
+}
+
+bool ParseN2kPGN128259(const tN2kMsg &N2kMsg, unsigned char &SID, float &WaterReferenced, float &GroundReferenced, tN2kSpeedWaterReferenceType &SWRT) {
+  if (N2kMsg.PGN!=128259L) return false;
+
+  int Index=0;
+
+  SID=N2kMsg.GetByte(Index);
+  WaterReferenced=N2kMsg.Get2ByteUFloat(0.01f,Index);
+  GroundReferenced=N2kMsg.Get2ByteUFloat(0.01f,Index);
+  SWRT=(tN2kSpeedWaterReferenceType)(N2kMsg.GetByte(Index)&0x0F);
+
+  return true;
+}
+
+bool ParseN2kPGN128259(const tN2kMsg &N2kMsg, unsigned char &SID, uint32_t &WaterReferenced, uint32_t &GroundReferenced, tN2kSpeedWaterReferenceType &SWRT) {
+  if (N2kMsg.PGN!=128259L) return false;
+
+  int Index=0;
+
+  SID=N2kMsg.GetByte(Index);
+  WaterReferenced=N2kMsg.Get2ByteUFixed(Index);
+  GroundReferenced=N2kMsg.Get2ByteUFixed(Index);
+  SWRT=(tN2kSpeedWaterReferenceType)(N2kMsg.GetByte(Index)&0x0F);
+
+  return true;
+}
+
 //*****************************************************************************
 // Water depth
 void SetN2kPGN128267(tN2kMsg &N2kMsg, unsigned char SID, double DepthBelowTransducer, double Offset, double Range) {
@@ -839,6 +935,48 @@ bool ParseN2kPGN128267(const tN2kMsg &N2kMsg, unsigned char &SID, double &DepthB
   return true;
 }
 
+void SetN2kPGN128267(tN2kMsg &N2kMsg, unsigned char SID, float DepthBelowTransducer, float Offset, float Range) {
+    N2kMsg.SetPGN(128267L);
+    N2kMsg.Priority=3;
+    N2kMsg.AddByte(SID);
+    N2kMsg.Add4ByteUFloat(DepthBelowTransducer,0.01f);
+    N2kMsg.Add2ByteFloat(Offset,0.001f);
+    N2kMsg.Add1ByteUFloat(Range,10);
+}
+
+void SetN2kPGN128267(tN2kMsg &N2kMsg, unsigned char SID, uint32_t DepthBelowTransducer, int32_t Offset, uint32_t Range) {
+    N2kMsg.SetPGN(128267L);
+    N2kMsg.Priority=3;
+    N2kMsg.AddByte(SID);
+    N2kMsg.Add4ByteUFixed(DepthBelowTransducer);
+    N2kMsg.Add2ByteFixed(Offset);
+    N2kMsg.Add1ByteUFixed(Range);
+}
+
+bool ParseN2kPGN128267(const tN2kMsg &N2kMsg, unsigned char &SID, float &DepthBelowTransducer, float &Offset, float &Range) {
+  if (N2kMsg.PGN!=128267L) return false;
+
+  int Index=0;
+  SID=N2kMsg.GetByte(Index);
+  DepthBelowTransducer=N2kMsg.Get4ByteUFloat(0.01f,Index);
+  Offset=N2kMsg.Get2ByteFloat(0.001f,Index);
+  Range=N2kMsg.Get1ByteUFloat(10,Index);
+
+  return true;
+}
+
+bool ParseN2kPGN128267(const tN2kMsg &N2kMsg, unsigned char &SID, uint32_t &DepthBelowTransducer, int32_t &Offset, uint32_t &Range) {
+  if (N2kMsg.PGN!=128267L) return false;
+
+  int Index=0;
+  SID=N2kMsg.GetByte(Index);
+  DepthBelowTransducer=N2kMsg.Get4ByteUFixed(Index);
+  Offset=N2kMsg.Get2ByteFixed(Index);
+  Range=N2kMsg.Get1ByteUFixed(Index);
+
+  return true;
+}
+
 //*****************************************************************************
 // Distance log
 void SetN2kPGN128275(tN2kMsg &N2kMsg, uint16_t DaysSince1970, double SecondsSinceMidnight, uint32_t Log, uint32_t TripLog) {
@@ -863,6 +1001,50 @@ bool ParseN2kPGN128275(const tN2kMsg &N2kMsg, uint16_t &DaysSince1970, double &S
     return true;
 }
 
+void SetN2kPGN128275(tN2kMsg &N2kMsg, uint16_t DaysSince1970, float SecondsSinceMidnight, uint32_t Log, uint32_t TripLog) {
+    N2kMsg.SetPGN(128275L);
+    N2kMsg.Priority=6;
+    N2kMsg.Add2ByteUInt(DaysSince1970);
+    N2kMsg.Add4ByteUFloat(SecondsSinceMidnight,0.0001f);
+    N2kMsg.Add4ByteUInt(Log);
+    N2kMsg.Add4ByteUInt(TripLog);
+}
+
+void SetN2kPGN128275(tN2kMsg &N2kMsg, uint16_t DaysSince1970, uint32_t SecondsSinceMidnight, uint32_t Log, uint32_t TripLog) {
+    N2kMsg.SetPGN(128275L);
+    N2kMsg.Priority=6;
+    N2kMsg.Add2ByteUInt(DaysSince1970);
+    N2kMsg.Add4ByteUFixed(SecondsSinceMidnight);
+    N2kMsg.Add4ByteUInt(Log);
+    N2kMsg.Add4ByteUInt(TripLog);
+}
+
+bool ParseN2kPGN128275(const tN2kMsg &N2kMsg, uint16_t &DaysSince1970, float &SecondsSinceMidnight, uint32_t &Log, uint32_t &TripLog) {
+    if (N2kMsg.PGN!=128275L) return false;
+
+    int Index=0;
+
+    DaysSince1970=N2kMsg.Get2ByteUInt(Index);
+    SecondsSinceMidnight=N2kMsg.Get4ByteUFloat(0.0001f,Index);
+    Log=N2kMsg.Get4ByteUFixed(Index);
+    TripLog=N2kMsg.Get4ByteUFixed(Index);
+
+    return true;
+}
+
+bool ParseN2kPGN128275(const tN2kMsg &N2kMsg, uint16_t &DaysSince1970, uint32_t &SecondsSinceMidnight, uint32_t &Log, uint32_t &TripLog) {
+    if (N2kMsg.PGN!=128275L) return false;
+
+    int Index=0;
+
+    DaysSince1970=N2kMsg.Get2ByteUInt(Index);
+    SecondsSinceMidnight=N2kMsg.Get4ByteUFixed(Index);
+    Log=N2kMsg.Get4ByteUFixed(Index);
+    TripLog=N2kMsg.Get4ByteUFixed(Index);
+
+    return true;
+}
+
 
 //*****************************************************************************
 // PGN128776 - Windlass Control Status
@@ -1042,6 +1224,38 @@ bool ParseN2kPGN129025(const tN2kMsg &N2kMsg, double &Latitude, double &Longitud
 	Longitude=N2kMsg.Get4ByteDouble(1e-7, Index);
 	return true;
 }
+
+void SetN2kPGN129025(tN2kMsg &N2kMsg, float Latitude, float Longitude) {
+    N2kMsg.SetPGN(129025L);
+    N2kMsg.Priority=2;
+    N2kMsg.Add4ByteFloat(Latitude,1e-7f);
+    N2kMsg.Add4ByteFloat(Longitude,1e-7f);
+}
+
+void SetN2kPGN129025(tN2kMsg &N2kMsg, int32_t Latitude, int32_t Longitude) {
+    N2kMsg.SetPGN(129025L);
+    N2kMsg.Priority=2;
+    N2kMsg.Add4ByteFixed(Latitude);
+    N2kMsg.Add4ByteFixed(Longitude);
+}
+
+bool ParseN2kPGN129025(const tN2kMsg &N2kMsg, float &Latitude, float &Longitude) {
+  if (N2kMsg.PGN!=129025L) return false;
+
+  int Index=0;
+  Latitude=N2kMsg.Get4ByteFloat(1e-7f,Index);
+  Longitude=N2kMsg.Get4ByteFloat(1e-7f,Index);
+  return true;
+}
+
+bool ParseN2kPGN129025(const tN2kMsg &N2kMsg, int32_t &Latitude, int32_t &Longitude) {
+  if (N2kMsg.PGN!=129025L) return false;
+
+  int Index=0;
+  Latitude=N2kMsg.Get4ByteFixed(Index);
+  Longitude=N2kMsg.Get4ByteFixed(Index);
+  return true;
+}
 //*****************************************************************************
 // COG SOG rapid
 // COG should be in radians
@@ -1070,6 +1284,54 @@ bool ParseN2kPGN129026(const tN2kMsg &N2kMsg, unsigned char &SID, tN2kHeadingRef
   return true;
 }
 
+void SetN2kPGN129026(tN2kMsg &N2kMsg, unsigned char SID, tN2kHeadingReference ref, float COG, float SOG) {
+    N2kMsg.SetPGN(129026L);
+    N2kMsg.Priority=2;
+    N2kMsg.AddByte(SID);
+    N2kMsg.AddByte( (((unsigned char)(ref)) & 0x03) | 0xfc );
+    N2kMsg.Add2ByteUFloat(COG,0.0001f);
+    N2kMsg.Add2ByteUFloat(SOG,0.01f);
+    N2kMsg.AddByte(0xff); // Reserved
+    N2kMsg.AddByte(0xff); // Reserved
+}
+
+void SetN2kPGN129026(tN2kMsg &N2kMsg, unsigned char SID, tN2kHeadingReference ref, uint32_t COG, uint32_t SOG) {
+    N2kMsg.SetPGN(129026L);
+    N2kMsg.Priority=2;
+    N2kMsg.AddByte(SID);
+    N2kMsg.AddByte( (((unsigned char)(ref)) & 0x03) | 0xfc );
+    N2kMsg.Add2ByteUFixed(COG);
+    N2kMsg.Add2ByteUFixed(SOG);
+    N2kMsg.AddByte(0xff); // Reserved
+    N2kMsg.AddByte(0xff); // Reserved
+}
+
+bool ParseN2kPGN129026(const tN2kMsg &N2kMsg, unsigned char &SID, tN2kHeadingReference &ref, float &COG, float &SOG) {
+  if (N2kMsg.PGN!=129026L) return false;
+  int Index=0;
+  unsigned char b;
+
+  SID=N2kMsg.GetByte(Index);
+  b=N2kMsg.GetByte(Index); ref=(tN2kHeadingReference)( b & 0x03 );
+  COG=N2kMsg.Get2ByteUFloat(0.0001f,Index);
+  SOG=N2kMsg.Get2ByteUFloat(0.01f,Index);
+
+  return true;
+}
+
+bool ParseN2kPGN129026(const tN2kMsg &N2kMsg, unsigned char &SID, tN2kHeadingReference &ref, uint32_t &COG, uint32_t &SOG) {
+  if (N2kMsg.PGN!=129026L) return false;
+  int Index=0;
+  unsigned char b;
+
+  SID=N2kMsg.GetByte(Index);
+  b=N2kMsg.GetByte(Index); ref=(tN2kHeadingReference)( b & 0x03 );
+  COG=N2kMsg.Get2ByteUFixed(Index);
+  SOG=N2kMsg.Get2ByteUFixed(Index);
+
+  return true;
+}
+
 //*****************************************************************************
 // GNSS Position Data
 void SetN2kPGN129029(tN2kMsg &N2kMsg, unsigned char SID, uint16_t DaysSince1970, double SecondsSinceMidnight,
@@ -1136,6 +1398,128 @@ bool ParseN2kPGN129029(const tN2kMsg &N2kMsg, unsigned char &SID, uint16_t &Days
   return true;
 }
 
+void SetN2kPGN129029(tN2kMsg &N2kMsg, unsigned char SID, uint16_t DaysSince1970, float SecondsSinceMidnight,
+                     float Latitude, float Longitude, float Altitude,
+                     tN2kGNSStype GNSStype, tN2kGNSSmethod GNSSmethod,
+                     unsigned char nSatellites, float HDOP, float PDOP, float GeoidalSeparation,
+                     unsigned char nReferenceStations, tN2kGNSStype ReferenceStationType, uint16_t ReferenceSationID,
+                     float AgeOfCorrection
+                     ) {
+    N2kMsg.SetPGN(129029L);
+    N2kMsg.Priority=3;
+    N2kMsg.AddByte(SID);
+    N2kMsg.Add2ByteUInt(DaysSince1970);
+    N2kMsg.Add4ByteUFloat(SecondsSinceMidnight,0.0001f);
+    N2kMsg.Add8ByteFloat(Latitude,1e-16f);
+    N2kMsg.Add8ByteFloat(Longitude,1e-16f);
+    N2kMsg.Add8ByteFloat(Altitude,1e-6f);
+    N2kMsg.AddByte( (((unsigned char) GNSStype) & 0x0f) | (((unsigned char) GNSSmethod) & 0x0f)<<4 );
+    N2kMsg.AddByte(1 | 0xfc);  // Integrity 2 bit, reserved 6 bits
+    N2kMsg.AddByte(nSatellites);
+    N2kMsg.Add2ByteFloat(HDOP,0.01f);
+    N2kMsg.Add2ByteFloat(PDOP,0.01f);
+    N2kMsg.Add4ByteFloat(GeoidalSeparation,0.01f);
+    if (nReferenceStations!=0xff && nReferenceStations>0) {
+      N2kMsg.AddByte(1); // Note that we have values for only one reference station, so pass only one values.
+      N2kMsg.Add2ByteInt( (((int)ReferenceStationType) & 0x0f) | ReferenceSationID<<4 );
+      N2kMsg.Add2ByteUFloat(AgeOfCorrection,0.01f);
+    } else N2kMsg.AddByte(nReferenceStations);
+}
+
+void SetN2kPGN129029(tN2kMsg &N2kMsg, unsigned char SID, uint16_t DaysSince1970, uint32_t SecondsSinceMidnight,
+                     int64_t Latitude, int64_t Longitude, int64_t Altitude,
+                     tN2kGNSStype GNSStype, tN2kGNSSmethod GNSSmethod,
+                     unsigned char nSatellites, int32_t HDOP, int32_t PDOP, int32_t GeoidalSeparation,
+                     unsigned char nReferenceStations, tN2kGNSStype ReferenceStationType, uint16_t ReferenceSationID,
+                     uint32_t AgeOfCorrection
+                     ) {
+    N2kMsg.SetPGN(129029L);
+    N2kMsg.Priority=3;
+    N2kMsg.AddByte(SID);
+    N2kMsg.Add2ByteUInt(DaysSince1970);
+    N2kMsg.Add4ByteUFixed(SecondsSinceMidnight);
+    N2kMsg.Add8ByteFixed(Latitude);
+    N2kMsg.Add8ByteFixed(Longitude);
+    N2kMsg.Add8ByteFixed(Altitude);
+    N2kMsg.AddByte( (((unsigned char) GNSStype) & 0x0f) | (((unsigned char) GNSSmethod) & 0x0f)<<4 );
+    N2kMsg.AddByte(1 | 0xfc);  // Integrity 2 bit, reserved 6 bits
+    N2kMsg.AddByte(nSatellites);
+    N2kMsg.Add2ByteFixed(HDOP);
+    N2kMsg.Add2ByteFixed(PDOP);
+    N2kMsg.Add4ByteFixed(GeoidalSeparation);
+    if (nReferenceStations!=0xff && nReferenceStations>0) {
+      N2kMsg.AddByte(1); // Note that we have values for only one reference station, so pass only one values.
+      N2kMsg.Add2ByteInt( (((int)ReferenceStationType) & 0x0f) | ReferenceSationID<<4 );
+      N2kMsg.Add2ByteUFixed(AgeOfCorrection);
+    } else N2kMsg.AddByte(nReferenceStations);
+}
+
+bool ParseN2kPGN129029(const tN2kMsg &N2kMsg, unsigned char &SID, uint16_t &DaysSince1970, float &SecondsSinceMidnight,
+                     float &Latitude, float &Longitude, float &Altitude,
+                     tN2kGNSStype &GNSStype, tN2kGNSSmethod &GNSSmethod,
+                     unsigned char &nSatellites, float &HDOP, float &PDOP, float &GeoidalSeparation,
+                     unsigned char &nReferenceStations, tN2kGNSStype &ReferenceStationType, uint16_t &ReferenceSationID,
+                     float &AgeOfCorrection
+                     ) {
+  if (N2kMsg.PGN!=129029L) return false;
+  int Index=0;
+  unsigned char vb;
+  int16_t vi;
+
+  SID=N2kMsg.GetByte(Index);
+  DaysSince1970=N2kMsg.Get2ByteUInt(Index);
+  SecondsSinceMidnight=N2kMsg.Get4ByteUFloat(0.0001f,Index);
+  Latitude=N2kMsg.Get8ByteFloat(1e-16f,Index);
+  Longitude=N2kMsg.Get8ByteFloat(1e-16f,Index);
+  Altitude=N2kMsg.Get8ByteFloat(1e-6f,Index);
+  vb=N2kMsg.GetByte(Index); GNSStype=(tN2kGNSStype)(vb & 0x0f); GNSSmethod=(tN2kGNSSmethod)((vb>>4) & 0x0f);
+  vb=N2kMsg.GetByte(Index);  // Integrity 2 bit, reserved 6 bits
+  nSatellites=N2kMsg.GetByte(Index);
+  HDOP=N2kMsg.Get2ByteFloat(0.01f,Index);
+  PDOP=N2kMsg.Get2ByteFloat(0.01f,Index);
+  GeoidalSeparation=N2kMsg.Get4ByteFloat(0.01f,Index);
+  nReferenceStations=N2kMsg.GetByte(Index);
+  if (nReferenceStations!=N2kUInt8NA && nReferenceStations>0) {
+    vi=N2kMsg.Get2ByteUInt(Index); ReferenceStationType=(tN2kGNSStype)(vi & 0x0f); ReferenceSationID=(vi>>4);
+    AgeOfCorrection=N2kMsg.Get2ByteUFloat(0.01f,Index);
+  }
+
+  return true;
+}
+
+bool ParseN2kPGN129029(const tN2kMsg &N2kMsg, unsigned char &SID, uint16_t &DaysSince1970, uint32_t &SecondsSinceMidnight,
+                     int64_t &Latitude, int64_t &Longitude, int64_t &Altitude,
+                     tN2kGNSStype &GNSStype, tN2kGNSSmethod &GNSSmethod,
+                     unsigned char &nSatellites, int32_t &HDOP, int32_t &PDOP, int32_t &GeoidalSeparation,
+                     unsigned char &nReferenceStations, tN2kGNSStype &ReferenceStationType, uint16_t &ReferenceSationID,
+                     uint32_t &AgeOfCorrection
+                     ) {
+  if (N2kMsg.PGN!=129029L) return false;
+  int Index=0;
+  unsigned char vb;
+  int16_t vi;
+
+  SID=N2kMsg.GetByte(Index);
+  DaysSince1970=N2kMsg.Get2ByteUInt(Index);
+  SecondsSinceMidnight=N2kMsg.Get4ByteUFixed(Index);
+  Latitude=N2kMsg.Get8ByteFixed(Index);
+  Longitude=N2kMsg.Get8ByteFixed(Index);
+  Altitude=N2kMsg.Get8ByteFixed(Index);
+  vb=N2kMsg.GetByte(Index); GNSStype=(tN2kGNSStype)(vb & 0x0f); GNSSmethod=(tN2kGNSSmethod)((vb>>4) & 0x0f);
+  vb=N2kMsg.GetByte(Index);  // Integrity 2 bit, reserved 6 bits
+  nSatellites=N2kMsg.GetByte(Index);
+  HDOP=N2kMsg.Get2ByteFixed(Index);
+  PDOP=N2kMsg.Get2ByteFixed(Index);
+  GeoidalSeparation=N2kMsg.Get4ByteFixed(Index);
+  nReferenceStations=N2kMsg.GetByte(Index);
+  if (nReferenceStations!=N2kUInt8NA && nReferenceStations>0) {
+    vi=N2kMsg.Get2ByteUInt(Index); ReferenceStationType=(tN2kGNSStype)(vi & 0x0f); ReferenceSationID=(vi>>4);
+    AgeOfCorrection=N2kMsg.Get2ByteUFixed(Index);
+  }
+
+  return true;
+}
+
 //*****************************************************************************
 // Date,Time & Local offset
 void SetN2kPGN129033(tN2kMsg &N2kMsg, uint16_t DaysSince1970, double SecondsSinceMidnight, int16_t LocalOffset) {
@@ -1762,6 +2146,50 @@ bool ParseN2kPGN130306(const tN2kMsg &N2kMsg, unsigned char &SID, double &WindSp
   return true;
 }
 
+void SetN2kPGN130306(tN2kMsg &N2kMsg, unsigned char SID, float WindSpeed, float WindAngle, tN2kWindReference WindReference) {
+    N2kMsg.SetPGN(130306L);
+    N2kMsg.Priority=2;
+    N2kMsg.AddByte(SID);
+    N2kMsg.Add2ByteUFloat(WindSpeed,0.01f);
+    N2kMsg.Add2ByteUFloat(WindAngle,0.0001f);
+    N2kMsg.AddByte((unsigned char)WindReference);
+    N2kMsg.AddByte(0xff); // Reserved
+    N2kMsg.AddByte(0xff); // Reserved
+}
+
+void SetN2kPGN130306(tN2kMsg &N2kMsg, unsigned char SID, uint32_t WindSpeed, uint32_t WindAngle, tN2kWindReference WindReference) {
+    N2kMsg.SetPGN(130306L);
+    N2kMsg.Priority=2;
+    N2kMsg.AddByte(SID);
+    N2kMsg.Add2ByteUFixed(WindSpeed);
+    N2kMsg.Add2ByteUFixed(WindAngle);
+    N2kMsg.AddByte((unsigned char)WindReference);
+    N2kMsg.AddByte(0xff); // Reserved
+    N2kMsg.AddByte(0xff); // Reserved
+}
+
+bool ParseN2kPGN130306(const tN2kMsg &N2kMsg, unsigned char &SID, float &WindSpeed, float &WindAngle, tN2kWindReference &WindReference) {
+  if (N2kMsg.PGN!=130306L) return false;
+  int Index=0;
+  SID=N2kMsg.GetByte(Index);
+  WindSpeed=N2kMsg.Get2ByteUFloat(0.01f,Index);
+  WindAngle=N2kMsg.Get2ByteUFloat(0.0001f,Index);
+  WindReference=(tN2kWindReference)(N2kMsg.GetByte(Index)&0x07);
+
+  return true;
+}
+
+bool ParseN2kPGN130306(const tN2kMsg &N2kMsg, unsigned char &SID, uint32_t &WindSpeed, uint32_t &WindAngle, tN2kWindReference &WindReference) {
+  if (N2kMsg.PGN!=130306L) return false;
+  int Index=0;
+  SID=N2kMsg.GetByte(Index);
+  WindSpeed=N2kMsg.Get2ByteUFixed(Index);
+  WindAngle=N2kMsg.Get2ByteUFixed(Index);
+  WindReference=(tN2kWindReference)(N2kMsg.GetByte(Index)&0x07);
+
+  return true;
+}
+
 //*****************************************************************************
 // Outside Environmental parameters
 void SetN2kPGN130310(tN2kMsg &N2kMsg, unsigned char SID, double WaterTemperature,
@@ -1787,6 +2215,52 @@ bool ParseN2kPGN130310(const tN2kMsg &N2kMsg, unsigned char &SID, double &WaterT
   return true;
 }
 
+void SetN2kPGN130310(tN2kMsg &N2kMsg, unsigned char SID, float WaterTemperature,
+                     float OutsideAmbientAirTemperature, float AtmosphericPressure) {
+    N2kMsg.SetPGN(130310L);
+    N2kMsg.Priority=5;
+    N2kMsg.AddByte(SID);
+    N2kMsg.Add2ByteUFloat(WaterTemperature,0.01f);
+    N2kMsg.Add2ByteUFloat(OutsideAmbientAirTemperature,0.01f);
+    N2kMsg.Add2ByteUFloat(AtmosphericPressure,100);
+    N2kMsg.AddByte(0xff);  // reserved
+}
+
+void SetN2kPGN130310(tN2kMsg &N2kMsg, unsigned char SID, uint32_t WaterTemperature,
+                     uint32_t OutsideAmbientAirTemperature, uint32_t AtmosphericPressure) {
+    N2kMsg.SetPGN(130310L);
+    N2kMsg.Priority=5;
+    N2kMsg.AddByte(SID);
+    N2kMsg.Add2ByteUFixed(WaterTemperature);
+    N2kMsg.Add2ByteUFixed(OutsideAmbientAirTemperature);
+    N2kMsg.Add2ByteUFixed(AtmosphericPressure);
+    N2kMsg.AddByte(0xff);  // reserved
+}
+
+bool ParseN2kPGN130310(const tN2kMsg &N2kMsg, unsigned char &SID, float &WaterTemperature,
+                     float &OutsideAmbientAirTemperature, float &AtmosphericPressure) {
+  if (N2kMsg.PGN!=130310L) return false;
+  int Index=0;
+  SID=N2kMsg.GetByte(Index);
+  WaterTemperature=N2kMsg.Get2ByteUFloat(0.01f,Index);
+  OutsideAmbientAirTemperature=N2kMsg.Get2ByteUFloat(0.01f,Index);
+  AtmosphericPressure=N2kMsg.Get2ByteUFloat(100,Index);
+
+  return true;
+}
+
+bool ParseN2kPGN130310(const tN2kMsg &N2kMsg, unsigned char &SID, uint32_t &WaterTemperature,
+                     uint32_t &OutsideAmbientAirTemperature, uint32_t &AtmosphericPressure) {
+  if (N2kMsg.PGN!=130310L) return false;
+  int Index=0;
+  SID=N2kMsg.GetByte(Index);
+  WaterTemperature=N2kMsg.Get2ByteUFixed(Index);
+  OutsideAmbientAirTemperature=N2kMsg.Get2ByteUFixed(Index);
+  AtmosphericPressure=N2kMsg.Get2ByteUFixed(Index);
+
+  return true;
+}
+
 
 //*****************************************************************************
 // Environmental parameters
@@ -27,6 +27,20 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <string.h>
 //#include <MemoryFree.h>  // For testing used memory
 
+#define N2kInt8OR 0x7e
+#define N2kUInt8OR 0xfe
+#define N2kInt16OR 0x7ffe
+#define N2kUInt16OR 0xfffe
+#define N2kInt32OR 0x7ffffffe
+#define N2kUInt32OR 0xfffffffe
+
+#define N2kInt32Min -2147483648L
+#define N2kInt24OR  8388606L
+#define N2kInt24Min -8388608L
+#define N2kInt16Min -32768
+#define N2kInt8Min  -128
+#define N2kInt64OR  0x7ffffffffffffffeLL
+
 #define Escape 0x10
 #define StartOfText 0x02
 #define EndOfText 0x03
@@ -177,6 +191,137 @@ void tN2kMsg::Add1ByteUDouble(double v, double precision, double UndefVal) {
   }
 }
 
+//*****************************************************************************
+void tN2kMsg::Add8ByteFloat(float v, float precision, float UndefVal) {
+  if (v!=UndefVal) {
+    SetBuf8ByteFloat(v,precision,DataLen,Data);
+  } else {
+    SetBuf4ByteUInt(N2kUInt32NA,DataLen,Data);
+    SetBuf4ByteUInt(N2kInt32NA,DataLen,Data);
+  }
+}
+
+//*****************************************************************************
+void tN2kMsg::Add4ByteFloat(float v, float precision, float UndefVal) {
+  if (v!=UndefVal) {
+    SetBuf4ByteFloat(v,precision,DataLen,Data);
+  } else {
+    SetBuf4ByteUInt(N2kInt32NA,DataLen,Data);
+  }
+}
+
+//*****************************************************************************
+void tN2kMsg::Add4ByteUFloat(float v, float precision, float UndefVal) {
+  if (v!=UndefVal) {
+    SetBuf4ByteUFloat(v,precision,DataLen,Data);
+  } else {
+    SetBuf4ByteUInt(N2kUInt32NA,DataLen,Data);
+  }
+}
+
+//*****************************************************************************
+void tN2kMsg::Add3ByteFloat(float v, float precision, float UndefVal) {
+  if (v!=UndefVal) {
+    SetBuf3ByteFloat(v,precision,DataLen,Data);
+  } else {
+    SetBuf3ByteInt(0x7fffff,DataLen,Data);
+  }
+}
+
+//*****************************************************************************
+void tN2kMsg::Add2ByteFloat(float v, float precision, float UndefVal) {
+  if (v!=UndefVal) {
+    SetBuf2ByteFloat(v,precision,DataLen,Data);
+  } else {
+    SetBuf2ByteUInt(N2kInt16NA,DataLen,Data);
+  }
+}
+
+//*****************************************************************************
+void tN2kMsg::Add2ByteUFloat(float v, float precision, float UndefVal) {
+  if (v!=UndefVal) {
+    SetBuf2ByteUFloat(v,precision,DataLen,Data);
+  } else {
+    SetBuf2ByteUInt(N2kUInt16NA,DataLen,Data);
+  }
+}
+
+//*****************************************************************************
+void tN2kMsg::Add1ByteFloat(float v, float precision, float UndefVal) {
+  if (v!=UndefVal) {
+    SetBuf1ByteFloat(v,precision,DataLen,Data);
+  } else {
+    AddByte(N2kInt8NA);
+  }
+}
+
+//*****************************************************************************
+void tN2kMsg::Add1ByteUFloat(float v, float precision, float UndefVal) {
+  if (v!=UndefVal) {
+    SetBuf1ByteUFloat(v,precision,DataLen,Data);
+  } else {
+    AddByte(N2kUInt8NA);
+  }
+}
+
+//*****************************************************************************
+void tN2kMsg::Add8ByteFixed(int64_t v) {
+  if ( v!=N2kInt64NA && v>N2kInt64OR ) v=N2kInt64OR;
+  SetBufUInt64((uint64_t)v,DataLen,Data);
+}
+
+//*****************************************************************************
+void tN2kMsg::Add4ByteFixed(int32_t v) {
+  if ( v!=N2kInt32NA && v>N2kInt32OR ) v=N2kInt32OR;
+  SetBuf4ByteUInt((uint32_t)v,DataLen,Data);
+}
+
+//*****************************************************************************
+void tN2kMsg::Add4ByteUFixed(uint32_t v) {
+  if ( v!=N2kUInt32NA && v>N2kUInt32OR ) v=N2kUInt32OR;
+  SetBuf4ByteUInt(v,DataLen,Data);
+}
+
+//*****************************************************************************
+void tN2kMsg::Add3ByteFixed(int32_t v) {
+  if ( v==N2kInt32NA ) {
+    v=0x7fffff;
+  } else if ( v<N2kInt24Min || v>N2kInt24OR ) v=N2kInt24OR;
+  SetBuf3ByteInt(v,DataLen,Data);
+}
+
+//*****************************************************************************
+void tN2kMsg::Add2ByteFixed(int32_t v) {
+  if ( v==N2kInt32NA ) {
+    v=N2kInt16NA;
+  } else if ( v<N2kInt16Min || v>N2kInt16OR ) v=N2kInt16OR;
+  SetBuf2ByteInt((int16_t)v,DataLen,Data);
+}
+
+//*****************************************************************************
+void tN2kMsg::Add2ByteUFixed(uint32_t v) {
+  if ( v==N2kUInt32NA ) {
+    v=N2kUInt16NA;
+  } else if ( v>N2kUInt16OR ) v=N2kUInt16OR;
+  SetBuf2ByteUInt((uint16_t)v,DataLen,Data);
+}
+
+//*****************************************************************************
+void tN2kMsg::Add1ByteFixed(int32_t v) {
+  if ( v==N2kInt32NA ) {
+    v=N2kInt8NA;
+  } else if ( v<N2kInt8Min || v>N2kInt8OR ) v=N2kInt8OR;
+  AddByte((unsigned char)(int8_t)v);
+}
+
+//*****************************************************************************
+void tN2kMsg::Add1ByteUFixed(uint32_t v) {
+  if ( v==N2kUInt32NA ) {
+    v=N2kUInt8NA;
+  } else if ( v>N2kUInt8OR ) v=N2kUInt8OR;
+  AddByte((unsigned char)v);
+}
+
 //*****************************************************************************
 void tN2kMsg::Add2ByteInt(int16_t v) {
   SetBuf2ByteInt(v,DataLen,Data);
@@ -337,6 +482,127 @@ float  tN2kMsg::GetFloat(int &Index, float def) const {
   } else return def;
 }
 
+//*****************************************************************************
+float tN2kMsg::Get1ByteFloat(float precision, int &Index, float def) const {
+  if (Index<DataLen) {
+    return GetBuf1ByteFloat(precision,Index,Data,def);
+  } else return def;
+}
+
+//*****************************************************************************
+float tN2kMsg::Get1ByteUFloat(float precision, int &Index, float def) const {
+  if (Index<DataLen) {
+    return GetBuf1ByteUFloat(precision,Index,Data,def);
+  } else return def;
+}
+
+//*****************************************************************************
+float tN2kMsg::Get2ByteFloat(float precision, int &Index, float def) const {
+  if (Index+2<=DataLen) {
+    return GetBuf2ByteFloat(precision,Index,Data,def);
+  } else return def;
+}
+
+//*****************************************************************************
+float tN2kMsg::Get2ByteUFloat(float precision, int &Index, float def) const {
+  if (Index+2<=DataLen) {
+    return GetBuf2ByteUFloat(precision,Index,Data,def);
+  } else return def;
+}
+
+//*****************************************************************************
+float tN2kMsg::Get3ByteFloat(float precision, int &Index, float def) const {
+  if (Index+3<=DataLen) {
+    return GetBuf3ByteFloat(precision,Index,Data,def);
+  } else return def;
+}
+
+//*****************************************************************************
+float tN2kMsg::Get4ByteFloat(float precision, int &Index, float def) const {
+  if (Index+4<=DataLen) {
+    return GetBuf4ByteFloat(precision,Index,Data,def);
+  } else return def;
+}
+
+//*****************************************************************************
+float tN2kMsg::Get4ByteUFloat(float precision, int &Index, float def) const {
+  if (Index+4<=DataLen) {
+    return GetBuf4ByteUFloat(precision,Index,Data,def);
+  } else return def;
+}
+
+//*****************************************************************************
+float tN2kMsg::Get8ByteFloat(float precision, int &Index, float def) const {
+  if (Index+8<=DataLen) {
+    return GetBuf8ByteFloat(precision,Index,Data,def);
+  } else return def;
+}
+
+//*****************************************************************************
+int32_t tN2kMsg::Get1ByteFixed(int &Index, int32_t def) const {
+  if (Index<DataLen) {
+    int8_t vl=(int8_t)Data[Index++];
+    return (vl==N2kInt8NA?def:vl);
+  } else return def;
+}
+
+//*****************************************************************************
+uint32_t tN2kMsg::Get1ByteUFixed(int &Index, uint32_t def) const {
+  if (Index<DataLen) {
+    uint8_t vl=Data[Index++];
+    return (vl==N2kUInt8NA?def:vl);
+  } else return def;
+}
+
+//*****************************************************************************
+int32_t tN2kMsg::Get2ByteFixed(int &Index, int32_t def) const {
+  if (Index+2<=DataLen) {
+    int16_t vl=GetBuf2ByteInt(Index,Data);
+    return (vl==N2kInt16NA?def:vl);
+  } else return def;
+}
+
+//*****************************************************************************
+uint32_t tN2kMsg::Get2ByteUFixed(int &Index, uint32_t def) const {
+  if (Index+2<=DataLen) {
+    uint16_t vl=GetBuf2ByteUInt(Index,Data);
+    return (vl==N2kUInt16NA?def:vl);
+  } else return def;
+}
+
+//*****************************************************************************
+int32_t tN2kMsg::Get3ByteFixed(int &Index, int32_t def) const {
+  if (Index+3<=DataLen) {
+    uint32_t vl=GetBuf3ByteUInt(Index,Data);
+    if (vl==0x7fffff) return def;
+    return (vl & 0x800000)!=0 ? (int32_t)(vl | 0xff000000UL) : (int32_t)vl;
+  } else return def;
+}
+
+//*****************************************************************************
+int32_t tN2kMsg::Get4ByteFixed(int &Index, int32_t def) const {
+  if (Index+4<=DataLen) {
+    int32_t vl=(int32_t)GetBuf4ByteUInt(Index,Data);
+    return (vl==N2kInt32NA?def:vl);
+  } else return def;
+}
+
+//*****************************************************************************
+uint32_t tN2kMsg::Get4ByteUFixed(int &Index, uint32_t def) const {
+  if (Index+4<=DataLen) {
+    uint32_t vl=GetBuf4ByteUInt(Index,Data);
+    return (vl==N2kUInt32NA?def:vl);
+  } else return def;
+}
+
+//*****************************************************************************
+int64_t tN2kMsg::Get8ByteFixed(int &Index, int64_t def) const {
+  if (Index+8<=DataLen) {
+    int64_t vl=(int64_t)GetBuf8ByteUInt(Index,Data);
+    return (vl==N2kInt64NA?def:vl);
+  } else return def;
+}
+
 //*****************************************************************************
 bool tN2kMsg::GetStr(char *StrBuf, size_t Length, int &Index) const {
   unsigned char vb;
@@ -551,19 +817,6 @@ void SetBufFloat(float v, int &index, unsigned char *buf) {
   SetBuf(iv, 4, index, buf);
 }
 
-#define N2kInt8OR 0x7e
-#define N2kUInt8OR 0xfe
-#define N2kInt16OR 0x7ffe
-#define N2kUInt16OR 0xfffe
-#define N2kInt32OR 0x7ffffffe
-#define N2kUInt32OR 0xfffffffe
-
-#define N2kInt32Min -2147483648L
-#define N2kInt24OR  8388606L
-#define N2kInt24Min -8388608L
-#define N2kInt16Min -32768
-#define N2kInt8Min  -128
-
 //*****************************************************************************
 void SetBuf8ByteDouble(double v, double precision, int &index, unsigned char *buf) {
   int64_t vll;
@@ -747,6 +1000,129 @@ void SetBuf1ByteUDouble(double v, double precision, int &index, unsigned char *b
   SetBuf(vi, 1, index, buf);
 }
 
+//*****************************************************************************
+// Single precision versions. The checks against field range are done in float as
+// well, the limits there are rounded but stay inside the integer type.
+void SetBuf8ByteFloat(float v, float precision, int &index, unsigned char *buf) {
+  float vf=roundf(v/precision);
+  int64_t vll = (vf>=-9.2e18f && vf<9.2e18f)?(int64_t)vf:N2kInt64OR;
+  SetBuf(vll, 8, index, buf);
+}
+
+//*****************************************************************************
+void SetBuf4ByteFloat(float v, float precision, int &index, unsigned char *buf) {
+  float vf=roundf(v/precision);
+  int32_t vi = (vf>=N2kInt32Min && vf<N2kInt32OR)?(int32_t)vf:N2kInt32OR;
+  SetBuf<int32_t>(vi, 4, index, buf);
+}
+
+//*****************************************************************************
+void SetBuf4ByteUFloat(float v, float precision, int &index, unsigned char *buf) {
+  float vf=roundf(v/precision);
+  uint32_t vi = (vf>=0 && vf<N2kUInt32OR)?(uint32_t)vf:N2kUInt32OR;
+  SetBuf<uint32_t>(vi, 4, index, buf);
+}
+
+//*****************************************************************************
+void SetBuf3ByteFloat(float v, float precision, int &index, unsigned char *buf) {
+  float vf=roundf(v/precision);
+  int32_t vi = (vf>=N2kInt24Min && vf<N2kInt24OR)?(int32_t)vf:N2kInt24OR;
+  SetBuf<int32_t>(vi, 3, index, buf);
+}
+
+//*****************************************************************************
+void SetBuf2ByteFloat(float v, float precision, int &index, unsigned char *buf) {
+  float vf=roundf(v/precision);
+  int16_t vi = (vf>=N2kInt16Min && vf<N2kInt16OR)?(int16_t)vf:N2kInt16OR;
+  SetBuf(vi, 2, index, buf);
+}
+
+//*****************************************************************************
+void SetBuf2ByteUFloat(float v, float precision, int &index, unsigned char *buf) {
+  float vf=roundf(v/precision);
+  uint16_t vi = (vf>=0 && vf<N2kUInt16OR)?(uint16_t)vf:N2kUInt16OR;
+  SetBuf(vi, 2, index, buf);
+}
+
+//*****************************************************************************
+void SetBuf1ByteFloat(float v, float precision, int &index, unsigned char *buf) {
+  float vf=roundf(v/precision);
+  int8_t vi = (vf>=N2kInt8Min && vf<N2kInt8OR)?(int8_t)vf:N2kInt8OR;
+  SetBuf(vi, 1, index, buf);
+}
+
+//*****************************************************************************
+void SetBuf1ByteUFloat(float v, float precision, int &index, unsigned char *buf) {
+  float vf=roundf(v/precision);
+  uint8_t vi = (vf>=0 && vf<N2kUInt8OR)?(uint8_t)vf:N2kUInt8OR;
+  SetBuf(vi, 1, index, buf);
+}
+
+//*****************************************************************************
+float GetBuf1ByteFloat(float precision, int &index, const unsigned char *buf, float def) {
+  int8_t vl = GetBuf<int8_t>(1, index, buf);
+  if (vl==0x7f) return def;
+
+  return vl * precision;
+}
+
+//*****************************************************************************
+float GetBuf1ByteUFloat(float precision, int &index, const unsigned char *buf, float def) {
+  uint8_t vl = GetBuf<uint8_t>(1, index, buf);
+  if (vl==0xff) return def;
+
+  return vl * precision;
+}
+
+//*****************************************************************************
+float GetBuf2ByteFloat(float precision, int &index, const unsigned char *buf, float def) {
+  int16_t vl = GetBuf<int16_t>(2, index, buf);
+  if (vl==0x7fff) return def;
+
+  return vl * precision;
+}
+
+//*****************************************************************************
+float GetBuf2ByteUFloat(float precision, int &index, const unsigned char *buf, float def) {
+  uint16_t vl = GetBuf<uint16_t>(2, index, buf);
+  if (vl==0xffff) return def;
+
+  return vl * precision;
+}
+
+//*****************************************************************************
+float GetBuf3ByteFloat(float precision, int &index, const unsigned char *buf, float def) {
+  int32_t vl = GetBuf<int32_t>(3, index, buf);
+  if (vl==0x007fffff) return def;
+  if ( (vl & 0x800000)!=0 ) vl-=0x1000000L;
+
+  return vl * precision;
+}
+
+//*****************************************************************************
+float GetBuf4ByteFloat(float precision, int &index, const unsigned char *buf, float def) {
+  int32_t vl = GetBuf<int32_t>(4, index, buf);
+  if (vl==0x7fffffff) return def;
+
+  return vl * precision;
+}
+
+//*****************************************************************************
+float GetBuf4ByteUFloat(float precision, int &index, const unsigned char *buf, float def) {
+  uint32_t vl = GetBuf<uint32_t>(4, index, buf);
+  if (vl==0xffffffff) return def;
+
+  return vl * precision;
+}
+
+//*****************************************************************************
+float GetBuf8ByteFloat(float precision, int &index, const unsigned char *buf, float def) {
+  int64_t vl = GetBuf<int64_t>(8, index, buf);
+  if (vl==0x7fffffffffffffffLL) return def;
+
+  return vl * precision;
+}
+
 //*****************************************************************************
 void SetBuf2ByteInt(int16_t v, int &index, unsigned char *buf) {
   SetBuf(v, 2, index, buf);
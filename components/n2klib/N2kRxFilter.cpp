@@ -0,0 +1,146 @@
+/*
+N2kRxFilter.cpp
+
+Copyright (c) 2022 John Blaiklock, BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <string.h>
+#include "N2kRxFilter.h"
+#include "N2kDef.h"
+
+#define IdPriorityBits 0xe000 // id bits 28..26 seen by dual filter
+#define IdPDU1DestinationBits 0x0007 // id bits 15..13, top of PS, which is destination on PDU1
+
+//*****************************************************************************
+// Id bits 28..13 as compared by filter, with priority 0.
+static uint16_t FilterValue(unsigned long PGN) {
+  return (uint16_t)((PGN>>5) & 0x1fff);
+}
+
+//*****************************************************************************
+static uint16_t DontCareBits(unsigned long PGN) {
+  return ( (PGN & 0xff00)<0xf000 ? IdPriorityBits | IdPDU1DestinationBits : IdPriorityBits );
+}
+
+//*****************************************************************************
+// Smallest code/mask covering PGNs First..Last-1. Returns number of don't care
+// PGN bits, which is log2 of id range filter lets through.
+static int CoverPGNs(const unsigned long *PGNs, uint16_t First, uint16_t Last, uint16_t &Code, uint16_t &Mask) {
+  uint16_t Value=FilterValue(PGNs[First]);
+  int Bits=0;
+
+  Mask=0;
+  for (uint16_t i=First; i<Last; i++) {
+    Mask|=DontCareBits(PGNs[i]) | (FilterValue(PGNs[i]) ^ Value);
+  }
+  Code=Value & ~Mask;
+  for (uint16_t m=Mask & ~IdPriorityBits; m!=0; m&=m-1) Bits++;
+
+  return Bits;
+}
+
+//*****************************************************************************
+tN2kRxFilter::tN2kRxFilter() {
+  Clear();
+  Update();
+}
+
+//*****************************************************************************
+void tN2kRxFilter::Clear() {
+  PGNCount=0;
+  Overflow=false;
+}
+
+//*****************************************************************************
+void tN2kRxFilter::Add(unsigned long PGN) {
+  if ( (PGN & 0xff00)<0xf000 ) PGN&=0x1ff00;
+
+  uint16_t i=0;
+  for (; i<PGNCount && PGNs[i]<PGN; i++);
+  if ( i<PGNCount && PGNs[i]==PGN ) return;
+  if ( PGNCount>=MaxPGNs ) {
+    Overflow=true;
+    return;
+  }
+
+  // Kept sorted, so groups for controller filters are ranges of the list
+  memmove(&PGNs[i+1],&PGNs[i],(PGNCount-i)*sizeof(PGNs[0]));
+  PGNs[i]=PGN;
+  PGNCount++;
+}
+
+//*****************************************************************************
+void tN2kRxFilter::AddList(const unsigned long *List) {
+  unsigned long PGN;
+
+  if ( List==0 ) return;
+  for (int i=0; (PGN=pgm_read_dword(&List[i]))!=0; i++) Add(PGN);
+}
+
+//*****************************************************************************
+void tN2kRxFilter::Update() {
+  uint16_t Code1=0, Mask1=0xffff, Code2=0, Mask2=0xffff;
+
+  memset(Bitmap,0,sizeof(Bitmap));
+
+  AcceptAll=( Overflow || PGNCount==0 );
+
+  if ( !AcceptAll ) {
+    for (uint16_t i=0; i<PGNCount; i++) {
+      uint16_t Bit=BitOf(PGNs[i]);
+      Bitmap[Bit>>5]|=(1UL<<(Bit & 31));
+    }
+
+    // Try every split of the sorted list to two ranges and keep the one letting least through.
+    // Split at PGNCount means one range, then second filter is same as first.
+    unsigned long BestCost=0xffffffffUL;
+    for (uint16_t Split=1; Split<=PGNCount; Split++) {
+      uint16_t c1, m1, c2, m2;
+      unsigned long Cost=1UL<<CoverPGNs(PGNs,0,Split,c1,m1);
+      if ( Split<PGNCount ) {
+        Cost+=1UL<<CoverPGNs(PGNs,Split,PGNCount,c2,m2);
+      } else {
+        c2=c1; m2=m1;
+      }
+      if ( Cost<BestCost ) {
+        BestCost=Cost;
+        Code1=c1; Mask1=m1; Code2=c2; Mask2=m2;
+      }
+    }
+  }
+
+  Acceptance.Code[0]=(uint8_t)(Code1>>8); Acceptance.Code[1]=(uint8_t)Code1;
+  Acceptance.Code[2]=(uint8_t)(Code2>>8); Acceptance.Code[3]=(uint8_t)Code2;
+  Acceptance.Mask[0]=(uint8_t)(Mask1>>8); Acceptance.Mask[1]=(uint8_t)Mask1;
+  Acceptance.Mask[2]=(uint8_t)(Mask2>>8); Acceptance.Mask[3]=(uint8_t)Mask2;
+}
+
+//*****************************************************************************
+bool tN2kRxFilter::IsAcceptedByController(unsigned long id) const {
+  uint16_t Value=(uint16_t)((id>>13) & 0xffff);
+
+  for (int f=0; f<4; f+=2) {
+    uint16_t Code=((uint16_t)Acceptance.Code[f]<<8) | Acceptance.Code[f+1];
+    uint16_t Mask=((uint16_t)Acceptance.Mask[f]<<8) | Acceptance.Mask[f+1];
+    if ( ((Value ^ Code) & ~Mask)==0 ) return true;
+  }
+
+  return false;
+}
@@ -164,164 +164,144 @@ const unsigned long DefReceiveMessages[] PROGMEM = {
 #endif
                                        0};
 
-bool IsSingleFrameSystemMessage(unsigned long PGN) {
-                                  switch (PGN) {
-                                      case  59392L: /* ISO Acknowledgement */
-                                      case   TP_DT: /* Multi packet data transfer, TP.DT */
-                                      case   TP_CM: /* Multi packet connection management, TP.CM */
-                                      case  59904L: /* ISO Request */
-                                      case  60928L: /* ISO Address Claim */
-                                      return true;
-                                  }
-                                  return false;
-}
-
-bool IsFastPacketSystemMessage(unsigned long PGN) {
-                                  switch (PGN) {
-                                      case  65240L: /* Commanded Address*/
-                                      case 126208L: /* NMEA Request/Command/Acknowledge group function */
-                                      return true;
-                                  }
-                                  return false;
-}
-
-bool IsDefaultSingleFrameMessage(unsigned long PGN) {
-                                  switch (PGN) {
-                                      case 126992L: // System date/time, pri=3, period=1000
-                                      case 126993L: // Heartbeat, pri=7, period=60000
-                                      case 127245L: // Rudder, pri=2, period=100
-                                      case 127250L: // Vessel Heading, pri=2, period=100
-                                      case 127251L: // Rate of Turn, pri=2, period=100
-                                      case 127257L: // Attitude, pri=3, period=1000
-                                      case 127488L: // Engine parameters rapid, rapid Update, pri=2, period=100
-                                      case 127493L: // Transmission parameters: dynamic, pri=2, period=100
-                                      case 127501L: // Binary status report, pri=3, period=NA
-                                      case 127505L: // Fluid level, pri=6, period=2500
-                                      case 127508L: // Battery Status, pri=6, period=1500
-                                      case 128259L: // Boat speed, pri=2, period=1000
-                                      case 128267L: // Water depth, pri=3, period=1000
-                                      case 129025L: // Lat/lon rapid, pri=2, period=100
-                                      case 129026L: // COG SOG rapid, pri=2, period=250
-                                      case 129283L: // Cross Track Error, pri=3, period=1000
-                                      case 130306L: // Wind Speed, pri=2, period=100
-                                      case 130310L: // Outside Environmental parameters, pri=5, period=500
-                                      case 130311L: // Environmental parameters, pri=5, period=500
-                                      case 130312L: // Temperature, pri=5, period=2000
-                                      case 130313L: // Humidity, pri=5, period=2000
-                                      case 130314L: // Pressure, pri=5, period=2000
-                                      case 130316L: // Temperature extended range, pri=5, period=NA
-                                      case 130576L: // Small Craft Status (Trim Tab position), pri=2, period=200
-                                      return true;
-                                  }
-                                  return false;
-}
-
-bool IsMandatoryFastPacketMessage(unsigned long PGN) {
-                                  switch (PGN) {
-                                      case 126464L: // PGN List (Transmit and Receive), pri=6, period=NA
-                                      case 126996L: // Product information, pri=6, period=NA
-                                      case 126998L: // Configuration information, pri=6, period=NA
-                                      return true;
-                                  }
-                                  return false;
-}
-
-bool IsDefaultFastPacketMessage(unsigned long PGN) {
-                                  switch (PGN) {
-                                      case 126983L: // Alert, pri=2, period=1000
-                                      case 126984L: // Alert Response, pri=2, period=NA
-                                      case 126985L: // Alert Text, pri=2, period=10000
-                                      case 126986L: // Alert Configuration, pri=2, period=NA
-                                      case 126987L: // Alert Threshold, pri=2, period=NA
-                                      case 126988L: // Alert Value, pri=2, period=10000
-                                      case 127233L: // Alert Value, pri=3, period=NA
-                                      case 127237L: // Heading/Track control, pri=2, period=250
-                                      case 127489L: // Engine parameters dynamic, pri=2, period=500
-                                      case 127496L: // Trip fuel consumption, vessel, pri=5, period=1000
-                                      case 127497L: // Trip fuel consumption, engine, pri=5, period=1000
-                                      case 127498L: // Engine parameters static, pri=5, period=NA
-                                      case 127503L: // AC Input Status, pri=6, period=1500
-                                      case 127504L: // AC Output Status, pri=6, period=1500
-                                      case 127506L: // DC Detailed status, pri=6, period=1500
-                                      case 127507L: // Charger status, pri=6, period=1500
-                                      case 127509L: // Inverter status, pri=6, period=1500
-                                      case 127510L: // Charger configuration status, pri=6, period=NA
-                                      case 127511L: // Inverter Configuration Status, pri=6, period=NA
-                                      case 127512L: // AGS configuration status, pri=6, period=NA
-                                      case 127513L: // Battery configuration status, pri=6, period=NA
-                                      case 127514L: // AGS Status, pri=6, period=1500
-                                      case 128275L: // Distance log, pri=6, period=1000
-                                      case 128520L: // Tracked Target Data, pri=2, period=1000
-                                      case 129029L: // GNSS Position Data, pri=3, period=1000
-                                      case 129038L: // AIS Class A Position Report, pri=4, period=NA
-                                      case 129039L: // AIS Class B Position Report, pri=4, period=NA
-                                      case 129040L: // AIS Class B Extended Position Report, pri=4, period=NA
-                                      case 129041L: // AIS Aids to Navigation (AtoN) Report, pri=4, period=NA
-                                      case 129044L: // Datum, pri=6, period=10000
-                                      case 129045L: // User Datum Settings, pri=6, period=NA
-                                      case 129284L: // Navigation info, pri=3, period=1000
-                                      case 129285L: // Waypoint list, pri=3, period=NA
-                                      case 129301L: // Time to/from Mark, pri=3, period=1000
-                                      case 129302L: // Bearing and Distance between two Marks, pri=6, period=NA
-                                      case 129538L: // GNSS Control Status, pri=6, period=NA
-                                      case 129540L: // GNSS Sats in View, pri=6, period=1000
-                                      case 129541L: // GPS Almanac Data, pri=6, period=NA
-                                      case 129542L: // GNSS Pseudorange Noise Statistics, pri=6, period=1000
-                                      case 129545L: // GNSS RAIM Output, pri=6, period=NA
-                                      case 129547L: // GNSS Pseudorange Error Statistics, pri=6, period=NA
-                                      case 129549L: // DGNSS Corrections, pri=6, period=NA
-                                      case 129551L: // GNSS Differential Correction Receiver Signal, pri=6, period=NA
-                                      case 129556L: // GLONASS Almanac Data, pri=6, period=NA
-                                      case 129792L: // AIS DGNSS Broadcast Binary Message, pri=6, period=NA
-                                      case 129793L: // AIS UTC and Date Report, pri=7, period=NA
-                                      case 129794L: // AIS Class A Static data, pri=6, period=NA
-                                      case 129795L: // AIS Addressed Binary Message, pri=5, period=NA
-                                      case 129796L: // AIS Acknowledge, pri=7, period=NA
-                                      case 129797L: // AIS Binary Broadcast Message, pri=5, period=NA
-                                      case 129798L: // AIS SAR Aircraft Position Report, pri=4, period=NA
-                                      case 129799L: // Radio Frequency/Mode/Power, pri=3, period=NA
-                                      case 129800L: // AIS UTC/Date Inquiry, pri=7, period=NA
-                                      case 129801L: // AIS Addressed Safety Related Message, pri=5, period=NA
-                                      case 129802L: // AIS Safety Related Broadcast Message, pri=5, period=NA
-                                      case 129803L: // AIS Interrogation PGN, pri=7, period=NA
-                                      case 129804L: // AIS Assignment Mode Command, pri=7, period=NA
-                                      case 129805L: // AIS Data Link Management Message, pri=7, period=NA
-                                      case 129806L: // AIS Channel Management, pri=7, period=NA
-                                      case 129807L: // AIS Group Assignment, pri=7, period=NA
-                                      case 129808L: // DSC Call Information, pri=8, period=NA
-                                      case 129809L: // AIS Class B Static Data: Part A, pri=6, period=NA
-                                      case 129810L: // AIS Class B Static Data Part B, pri=6, period=NA
-                                      case 129811L: // AIS Single Slot Binary Message, pri=5, period=NA
-                                      case 129812L: // AIS Multi Slot Binary Message, pri=5, period=NA
-                                      case 129813L: // AIS Long-Range Broadcast Message, pri=5, period=NA
-                                      case 130052L: // Loran-C TD Data, pri=3, period=1000
-                                      case 130053L: // Loran-C Range Data, pri=3, period=1000
-                                      case 130054L: // Loran-C Signal Data, pri=3, period=1000
-                                      case 130060L: // Label, pri=7, period=NA
-                                      case 130061L: // Channel Source Configuration, pri=7, period=NA
-                                      case 130064L: // Route and WP Service - Database List, pri=7, period=NA
-                                      case 130065L: // Route and WP Service - Route List, pri=7, period=NA
-                                      case 130066L: // Route and WP Service - Route/WP-List Attributes, pri=7, period=NA
-                                      case 130067L: // Route and WP Service - Route - WP Name & Position, pri=7, period=NA
-                                      case 130068L: // Route and WP Service - Route - WP Name, pri=7, period=NA
-                                      case 130069L: // Route and WP Service - XTE Limit & Navigation Method, pri=7, period=NA
-                                      case 130070L: // Route and WP Service - WP Comment, pri=7, period=NA
-                                      case 130071L: // Route and WP Service - Route Comment, pri=7, period=NA
-                                      case 130072L: // Route and WP Service - Database Comment, pri=7, period=NA
-                                      case 130073L: // Route and WP Service - Radius of Turn, pri=7, period=NA
-                                      case 130074L: // Route and WP Service - WP List - WP Name & Position, pri=7, period=NA
-                                      case 130320L: // Tide Station Data, pri=6, period=1000
-                                      case 130321L: // Salinity Station Data, pri=6, period=1000
-                                      case 130322L: // Current Station Data, pri=6, period=1000
-                                      case 130323L: // Meteorological Station Data, pri=6, period=1000
-                                      case 130324L: // Moored Buoy Station Data, pri=6, period=1000
-                                      case 130567L: // Watermaker Input Setting and Status, pri=6, period=2500
-                                      case 130577L: // Direction Data PGN, pri=3, period=1000
-                                      case 130578L: // Vessel Speed Components, pri=2, period=250
-                                      return true;
-                                  }
-                                  return false;
-}
+const unsigned long SingleFrameSystemMessages[] PROGMEM = {
+                                        59392L, /* ISO Acknowledgement */
+                                         TP_DT, /* Multi packet data transfer, TP.DT */
+                                         TP_CM, /* Multi packet connection management, TP.CM */
+                                        59904L, /* ISO Request */
+                                        60928L, /* ISO Address Claim */
+                                       0};
+
+const unsigned long FastPacketSystemMessages[] PROGMEM = {
+                                        65240L, /* Commanded Address*/
+                                       126208L, /* NMEA Request/Command/Acknowledge group function */
+                                       0};
+
+const unsigned long DefSingleFrameMessages[] PROGMEM = {
+                                       126992L, /* System date/time, pri=3, period=1000 */
+                                       126993L, /* Heartbeat, pri=7, period=60000 */
+                                       127245L, /* Rudder, pri=2, period=100 */
+                                       127250L, /* Vessel Heading, pri=2, period=100 */
+                                       127251L, /* Rate of Turn, pri=2, period=100 */
+                                       127257L, /* Attitude, pri=3, period=1000 */
+                                       127488L, /* Engine parameters rapid, rapid Update, pri=2, period=100 */
+                                       127493L, /* Transmission parameters: dynamic, pri=2, period=100 */
+                                       127501L, /* Binary status report, pri=3, period=NA */
+                                       127505L, /* Fluid level, pri=6, period=2500 */
+                                       127508L, /* Battery Status, pri=6, period=1500 */
+                                       128259L, /* Boat speed, pri=2, period=1000 */
+                                       128267L, /* Water depth, pri=3, period=1000 */
+                                       129025L, /* Lat/lon rapid, pri=2, period=100 */
+                                       129026L, /* COG SOG rapid, pri=2, period=250 */
+                                       129283L, /* Cross Track Error, pri=3, period=1000 */
+                                       130306L, /* Wind Speed, pri=2, period=100 */
+                                       130310L, /* Outside Environmental parameters, pri=5, period=500 */
+                                       130311L, /* Environmental parameters, pri=5, period=500 */
+                                       130312L, /* Temperature, pri=5, period=2000 */
+                                       130313L, /* Humidity, pri=5, period=2000 */
+                                       130314L, /* Pressure, pri=5, period=2000 */
+                                       130316L, /* Temperature extended range, pri=5, period=NA */
+                                       130576L, /* Small Craft Status (Trim Tab position), pri=2, period=200 */
+                                       0};
+
+const unsigned long MandatoryFastPacketMessages[] PROGMEM = {
+                                       126464L, /* PGN List (Transmit and Receive), pri=6, period=NA */
+                                       126996L, /* Product information, pri=6, period=NA */
+                                       126998L, /* Configuration information, pri=6, period=NA */
+                                       0};
+
+const unsigned long DefFastPacketMessages[] PROGMEM = {
+                                       126983L, /* Alert, pri=2, period=1000 */
+                                       126984L, /* Alert Response, pri=2, period=NA */
+                                       126985L, /* Alert Text, pri=2, period=10000 */
+                                       126986L, /* Alert Configuration, pri=2, period=NA */
+                                       126987L, /* Alert Threshold, pri=2, period=NA */
+                                       126988L, /* Alert Value, pri=2, period=10000 */
+                                       127233L, /* Alert Value, pri=3, period=NA */
+                                       127237L, /* Heading/Track control, pri=2, period=250 */
+                                       127489L, /* Engine parameters dynamic, pri=2, period=500 */
+                                       127496L, /* Trip fuel consumption, vessel, pri=5, period=1000 */
+                                       127497L, /* Trip fuel consumption, engine, pri=5, period=1000 */
+                                       127498L, /* Engine parameters static, pri=5, period=NA */
+                                       127503L, /* AC Input Status, pri=6, period=1500 */
+                                       127504L, /* AC Output Status, pri=6, period=1500 */
+                                       127506L, /* DC Detailed status, pri=6, period=1500 */
+                                       127507L, /* Charger status, pri=6, period=1500 */
+                                       127509L, /* Inverter status, pri=6, period=1500 */
+                                       127510L, /* Charger configuration status, pri=6, period=NA */
+                                       127511L, /* Inverter Configuration Status, pri=6, period=NA */
+                                       127512L, /* AGS configuration status, pri=6, period=NA */
+                                       127513L, /* Battery configuration status, pri=6, period=NA */
+                                       127514L, /* AGS Status, pri=6, period=1500 */
+                                       128275L, /* Distance log, pri=6, period=1000 */
+                                       128520L, /* Tracked Target Data, pri=2, period=1000 */
+                                       129029L, /* GNSS Position Data, pri=3, period=1000 */
+                                       129038L, /* AIS Class A Position Report, pri=4, period=NA */
+                                       129039L, /* AIS Class B Position Report, pri=4, period=NA */
+                                       129040L, /* AIS Class B Extended Position Report, pri=4, period=NA */
+                                       129041L, /* AIS Aids to Navigation (AtoN) Report, pri=4, period=NA */
+                                       129044L, /* Datum, pri=6, period=10000 */
+                                       129045L, /* User Datum Settings, pri=6, period=NA */
+                                       129284L, /* Navigation info, pri=3, period=1000 */
+                                       129285L, /* Waypoint list, pri=3, period=NA */
+                                       129301L, /* Time to/from Mark, pri=3, period=1000 */
+                                       129302L, /* Bearing and Distance between two Marks, pri=6, period=NA */
+                                       129538L, /* GNSS Control Status, pri=6, period=NA */
+                                       129540L, /* GNSS Sats in View, pri=6, period=1000 */
+                                       129541L, /* GPS Almanac Data, pri=6, period=NA */
+                                       129542L, /* GNSS Pseudorange Noise Statistics, pri=6, period=1000 */
+                                       129545L, /* GNSS RAIM Output, pri=6, period=NA */
+                                       129547L, /* GNSS Pseudorange Error Statistics, pri=6, period=NA */
+                                       129549L, /* DGNSS Corrections, pri=6, period=NA */
+                                       129551L, /* GNSS Differential Correction Receiver Signal, pri=6, period=NA */
+                                       129556L, /* GLONASS Almanac Data, pri=6, period=NA */
+                                       129792L, /* AIS DGNSS Broadcast Binary Message, pri=6, period=NA */
+                                       129793L, /* AIS UTC and Date Report, pri=7, period=NA */
+                                       129794L, /* AIS Class A Static data, pri=6, period=NA */
+                                       129795L, /* AIS Addressed Binary Message, pri=5, period=NA */
+                                       129796L, /* AIS Acknowledge, pri=7, period=NA */
+                                       129797L, /* AIS Binary Broadcast Message, pri=5, period=NA */
+                                       129798L, /* AIS SAR Aircraft Position Report, pri=4, period=NA */
+                                       129799L, /* Radio Frequency/Mode/Power, pri=3, period=NA */
+                                       129800L, /* AIS UTC/Date Inquiry, pri=7, period=NA */
+                                       129801L, /* AIS Addressed Safety Related Message, pri=5, period=NA */
+                                       129802L, /* AIS Safety Related Broadcast Message, pri=5, period=NA */
+                                       129803L, /* AIS Interrogation PGN, pri=7, period=NA */
+                                       129804L, /* AIS Assignment Mode Command, pri=7, period=NA */
+                                       129805L, /* AIS Data Link Management Message, pri=7, period=NA */
+                                       129806L, /* AIS Channel Management, pri=7, period=NA */
+                                       129807L, /* AIS Group Assignment, pri=7, period=NA */
+                                       129808L, /* DSC Call Information, pri=8, period=NA */
+                                       129809L, /* AIS Class B Static Data: Part A, pri=6, period=NA */
+                                       129810L, /* AIS Class B Static Data Part B, pri=6, period=NA */
+                                       129811L, /* AIS Single Slot Binary Message, pri=5, period=NA */
+                                       129812L, /* AIS Multi Slot Binary Message, pri=5, period=NA */
+                                       129813L, /* AIS Long-Range Broadcast Message, pri=5, period=NA */
+                                       130052L, /* Loran-C TD Data, pri=3, period=1000 */
+                                       130053L, /* Loran-C Range Data, pri=3, period=1000 */
+                                       130054L, /* Loran-C Signal Data, pri=3, period=1000 */
+                                       130060L, /* Label, pri=7, period=NA */
+                                       130061L, /* Channel Source Configuration, pri=7, period=NA */
+                                       130064L, /* Route and WP Service - Database List, pri=7, period=NA */
+                                       130065L, /* Route and WP Service - Route List, pri=7, period=NA */
+                                       130066L, /* Route and WP Service - Route/WP-List Attributes, pri=7, period=NA */
+                                       130067L, /* Route and WP Service - Route - WP Name & Position, pri=7, period=NA */
+                                       130068L, /* Route and WP Service - Route - WP Name, pri=7, period=NA */
+                                       130069L, /* Route and WP Service - XTE Limit & Navigation Method, pri=7, period=NA */
+                                       130070L, /* Route and WP Service - WP Comment, pri=7, period=NA */
+                                       130071L, /* Route and WP Service - Route Comment, pri=7, period=NA */
+                                       130072L, /* Route and WP Service - Database Comment, pri=7, period=NA */
+                                       130073L, /* Route and WP Service - Radius of Turn, pri=7, period=NA */
+                                       130074L, /* Route and WP Service - WP List - WP Name & Position, pri=7, period=NA */
+                                       130320L, /* Tide Station Data, pri=6, period=1000 */
+                                       130321L, /* Salinity Station Data, pri=6, period=1000 */
+                                       130322L, /* Current Station Data, pri=6, period=1000 */
+                                       130323L, /* Meteorological Station Data, pri=6, period=1000 */
+                                       130324L, /* Moored Buoy Station Data, pri=6, period=1000 */
+                                       130567L, /* Watermaker Input Setting and Status, pri=6, period=2500 */
+                                       130577L, /* Direction Data PGN, pri=3, period=1000 */
+                                       130578L, /* Vessel Speed Components, pri=2, period=250 */
+                                       0};
 
 bool IsProprietaryFastPacketMessage(unsigned long PGN) {
   return ( PGN==126720L ) || ( 130816L<=PGN && PGN<=131071L );
@@ -391,13 +371,20 @@ tNMEA2000::tNMEA2000() {
   ForwardStream=0;
 
   for (int i=0; i<N2kMessageGroups; i++) {SingleFrameMessages[i]=0; FastPacketMessages[i]=0;}
+  PGNIndex=0;
+  PGNIndexSize=0;
+  PGNIndexValid=false;
 
-  N2kCANMsgBuf=0;
+  N2kCANRxMsg=0;
   MaxN2kCANMsgs=0;
+  MaxN2kCANLargeMsgs=0;
 
   MaxCANSendFrames=40;
   MaxCANReceiveFrames=0; // Use driver default
+  MaxReadFramesOnParse=20;
   CANSendFrameBuf=0;
+  SendBlocked=false;
+  SendBlockedCount=0;
 
   MsgHandler=0;
   MsgHandlers=0;
@@ -863,21 +850,25 @@ void tNMEA2000::SetDeviceInformationInstances(
 //*****************************************************************************
 void tNMEA2000::SetSingleFrameMessages(const unsigned long *_SingleFrameMessages) {
   SingleFrameMessages[0]=_SingleFrameMessages;
+  PGNIndexValid=false;
 }
 
 //*****************************************************************************
 void tNMEA2000::SetFastPacketMessages(const unsigned long *_FastPacketMessages) {
   FastPacketMessages[0]=_FastPacketMessages;
+  PGNIndexValid=false;
 }
 
 //*****************************************************************************
 void tNMEA2000::ExtendSingleFrameMessages(const unsigned long *_SingleFrameMessages) {
   SingleFrameMessages[1]=_SingleFrameMessages;
+  PGNIndexValid=false;
 }
 
 //*****************************************************************************
 void tNMEA2000::ExtendFastPacketMessages(const unsigned long *_FastPacketMessages) {
   FastPacketMessages[1]=_FastPacketMessages;
+  PGNIndexValid=false;
 }
 
 //*****************************************************************************
@@ -908,10 +899,8 @@ void tNMEA2000::SetMode(tN2kMode _N2kMode, uint8_t _N2kSource) {
 //*****************************************************************************
 void tNMEA2000::InitCANFrameBuffers() {
     if ( CANSendFrameBuf==0 && !IsInitialized() ) {
-      if ( MaxCANSendFrames>0 ) CANSendFrameBuf = new tCANSendFrame[MaxCANSendFrames];
+      if ( MaxCANSendFrames>0 ) CANSendFrameBuf = new tPriorityRingBuffer<tCANSendFrame>(MaxCANSendFrames,8);
       N2kDbg("Initialize frame buffer. Size: "); N2kDbg(MaxCANSendFrames); N2kDbg(", address:"); N2kDbgln((uint32_t)CANSendFrameBuf);
-      CANSendFrameBufferWrite=0;
-      CANSendFrameBufferRead=0;
     }
 
     // Receive buffer has sense only with interrupt handling. So it must be handled on inherited class.
@@ -923,11 +912,13 @@ bool tNMEA2000::Open() {
   if (!DeviceReady) {
     InitCANFrameBuffers();
     InitDevices();
+    if ( !PGNIndexValid ) BuildPGNIndex();
 
-    if ( N2kCANMsgBuf==0 ) {
-      if ( MaxN2kCANMsgs==0 ) MaxN2kCANMsgs=5;
-      N2kCANMsgBuf = new tN2kCANMsg[MaxN2kCANMsgs];
-      for (int i=0; i<MaxN2kCANMsgs; i++) N2kCANMsgBuf[i].FreeMessage();
+    if ( N2kCANRxMsg==0 ) {
+      if ( MaxN2kCANMsgs==0 ) SetN2kCANMsgBufSize(5);
+      N2kCANMsgPool.Init(MaxN2kCANMsgs-MaxN2kCANLargeMsgs,MaxN2kCANLargeMsgs);
+      N2kCANRxMsg = new tN2kCANMsg;
+      N2kCANRxMsg->FreeMessage();
 
 #if !defined(N2K_NO_GROUP_FUNCTION_SUPPORT)
       // On first open try add also default group function handlers
@@ -994,15 +985,15 @@ unsigned long N2ktoCanID(unsigned char priority, unsigned long PGN, unsigned lon
 
 //*****************************************************************************
 bool tNMEA2000::SendFrames()
-{ uint16_t temp;
+{ const tCANSendFrame *Frame;
+  uint8_t Priority;
 
   if ( CANSendFrameBuf==0 ) return true; // This can be in case, where inherited class defines own buffering.
 
-  while (CANSendFrameBufferRead!=CANSendFrameBufferWrite) {
-    temp = (CANSendFrameBufferRead + 1) % MaxCANSendFrames;
-    if ( CANSendFrame(CANSendFrameBuf[temp].id, CANSendFrameBuf[temp].len, CANSendFrameBuf[temp].buf, CANSendFrameBuf[temp].wait_sent) ) {
-      CANSendFrameBufferRead=temp;
-      N2kFrameOutDbgStart("Frame unbuffered "); N2kFrameOutDbgln(CANSendFrameBuf[temp].id);
+  while ( (Frame=CANSendFrameBuf->peekReadRef(&Priority))!=0 ) {
+    if ( CANSendFrame(Frame->id, Frame->len, Frame->buf, Frame->wait_sent) ) {
+      N2kFrameOutDbgStart("Frame unbuffered "); N2kFrameOutDbgln(Frame->id);
+      CANSendFrameBuf->getReadRef(Priority);
     } else return false;
   }
 
@@ -1013,7 +1004,7 @@ bool tNMEA2000::SendFrames()
 bool tNMEA2000::SendFrame(unsigned long id, unsigned char len, const unsigned char *buf, bool wait_sent) {
 
   if ( !SendFrames() || !CANSendFrame(id,len,buf,wait_sent) ) { // If we can not sent frame immediately, add it to buffer
-    tCANSendFrame *Frame=GetNextFreeCANSendFrame();
+    tCANSendFrame *Frame=( CANSendFrameBuf!=0 ? CANSendFrameBuf->getAddRef((id>>26) & 0x7) : 0 );
     if ( Frame==0 ) {
       N2kFrameOutDbgStart("Frame failed "); N2kFrameOutDbgln(id);
       return false;
@@ -1077,17 +1068,12 @@ void tNMEA2000::SendHeartbeat(bool force) {
 #endif
 
 //*****************************************************************************
-tNMEA2000::tCANSendFrame *tNMEA2000::GetNextFreeCANSendFrame() {
-  if (CANSendFrameBuf==0) return 0;
+uint16_t tNMEA2000::GetSendFrameSpace() {
+  uint32_t Space=CANGetSendFrameSpace();
 
-  uint16_t temp = (CANSendFrameBufferWrite + 1) % MaxCANSendFrames;
+  if ( CANSendFrameBuf!=0 ) Space+=CANSendFrameBuf->getFreeCount();
 
-  if (temp != CANSendFrameBufferRead) {
-    CANSendFrameBufferWrite = temp;
-    return &(CANSendFrameBuf[CANSendFrameBufferWrite]);
-  } else {
-    return 0;
-  }
+  return ( Space<0xffff ? (uint16_t)Space : 0xffff );
 }
 
 //*****************************************************************************
@@ -1106,6 +1092,7 @@ void tNMEA2000::SendPendingInformation() {
 // Sends message to N2k bus
 //
 bool tNMEA2000::SendMsg(const tN2kMsg &N2kMsg, int DeviceIndex) {
+  SendBlocked=false;
   if ( dbMode==dm_None && !Open() ) return false;
 
   bool result=false;
@@ -1134,6 +1121,19 @@ bool tNMEA2000::SendMsg(const tN2kMsg &N2kMsg, int DeviceIndex) {
       N2kMsgDbgStart(" - can ID:"); N2kMsgDbgln(canId);
       if ( IsAddressClaimStarted(DeviceIndex) && N2kMsg.PGN!=N2kPGNIsoAddressClaim ) return false;
 
+#if !defined(N2K_NO_ISO_MULTI_PACKET_SUPPORT)
+      if ( !N2kMsg.IsTPMessage() )
+#endif
+      { // Queue nothing, if all frames do not fit. Caller may try again later.
+        int frames=( N2kMsg.DataLen<=8 && !IsFastPacket(N2kMsg) ? 1 : (N2kMsg.DataLen>6 ? (N2kMsg.DataLen-6-1)/7+1+1 : 1 ) );
+        if ( GetSendFrameSpace()<frames ) {
+          SendBlocked=true;
+          SendBlockedCount++;
+          N2kMsgDbgStart("Send blocked PGN:"); N2kMsgDbgln(N2kMsg.PGN);
+          return false;
+        }
+      }
+
       if (N2kMsg.DataLen<=8 && !IsFastPacket(N2kMsg) ) { // We can send single frame
           DbgPrintBuf(N2kMsg.DataLen, N2kMsg.Data,true);
           result=SendFrame(canId, N2kMsg.DataLen, N2kMsg.Data,false);
@@ -1204,24 +1204,122 @@ void tNMEA2000::SetDebugMode(tDebugMode _dbMode) {
   dbMode=_dbMode;
 }
 
+#define PGNClassKnown 0x01
+#define PGNClassSystem 0x02
+#define PGNClassFastPacket 0x04
+#define PGNClassSendFastPacket 0x08 // Set if any list has the PGN as fast packet, which is what IsFastPacketPGN reports.
+
 //*****************************************************************************
-bool tNMEA2000::IsFastPacketPGN(unsigned long PGN) {
-  if ( IsFastPacketSystemMessage(PGN) || IsMandatoryFastPacketMessage(PGN) ||
-       ( FastPacketMessages[0]==0 && IsDefaultFastPacketMessage(PGN) ) ||
-       IsProprietaryFastPacketMessage(PGN) ) return true;
+// Index is open addressing hash table. Table size is power of 2 and kept under
+// 3/4 full, so a lookup normally needs one or two probes. PGN 0 marks free slot.
+uint16_t PGNIndexSlot(unsigned long PGN, uint16_t Mask) {
+  return (uint16_t)(((uint32_t)PGN*2654435761UL)>>16) & Mask;
+}
 
-  int i;
+//*****************************************************************************
+// Adds PGN to the index or merges it to existing entry. Flags in FirstFlags are
+// kept from the list where PGN was found first, which gives same result as
+// checking lists in order. Other flags are collected from all lists.
+void tNMEA2000::AddPGNClass(unsigned long PGN, uint8_t Flags, uint8_t FirstFlags) {
+  uint16_t Mask=PGNIndexSize-1;
+  uint16_t i=PGNIndexSlot(PGN,Mask);
 
-    for (unsigned char igroup=0; (igroup<N2kMessageGroups); igroup++)  {
-      if (FastPacketMessages[igroup]!=0) {
-        for (i=0; pgm_read_dword(&FastPacketMessages[igroup][i])!=PGN && pgm_read_dword(&FastPacketMessages[igroup][i])!=0; i++);
-        if (pgm_read_dword(&FastPacketMessages[igroup][i])==PGN) {
-         return true;
-        }
-      }
+  for (; PGNIndex[i].PGN!=0; i=(i+1) & Mask) {
+    if ( PGNIndex[i].PGN==PGN ) {
+      PGNIndex[i].Flags|=(Flags & ~FirstFlags);
+      return;
     }
+  }
 
-    return false;
+  PGNIndex[i].PGN=PGN;
+  PGNIndex[i].Flags=Flags;
+}
+
+//*****************************************************************************
+void tNMEA2000::AddPGNClasses(const unsigned long *PGNs, uint8_t Flags, uint8_t FirstFlags) {
+  unsigned long PGN;
+
+  if ( PGNs==0 ) return;
+  for (int i=0; (PGN=pgm_read_dword(&PGNs[i]))!=0; i++) AddPGNClass(PGN,Flags,FirstFlags);
+}
+
+//*****************************************************************************
+size_t PGNListLength(const unsigned long *PGNs) {
+  size_t i=0;
+
+  if ( PGNs==0 ) return 0;
+  for (; pgm_read_dword(&PGNs[i])!=0; i++);
+  return i;
+}
+
+//*****************************************************************************
+void tNMEA2000::BuildPGNIndex() {
+  const uint8_t FirstFlags=PGNClassKnown | PGNClassSystem | PGNClassFastPacket;
+  size_t MaxCount=PGNListLength(MandatoryFastPacketMessages) +
+                  PGNListLength(SingleFrameSystemMessages) +
+                  PGNListLength(FastPacketSystemMessages);
+
+  if ( SingleFrameMessages[0]==0 ) MaxCount+=PGNListLength(DefSingleFrameMessages);
+  if ( FastPacketMessages[0]==0 ) MaxCount+=PGNListLength(DefFastPacketMessages);
+  for (unsigned char igroup=0; igroup<N2kMessageGroups; igroup++) {
+    MaxCount+=PGNListLength(SingleFrameMessages[igroup])+PGNListLength(FastPacketMessages[igroup]);
+  }
+
+  uint16_t Size=16;
+  while ( Size<0x8000 && Size*3<MaxCount*4 ) Size*=2;
+
+  if ( PGNIndex!=0 && PGNIndexSize!=Size ) { delete[] PGNIndex; PGNIndex=0; }
+  if ( PGNIndex==0 ) PGNIndex=new tPGNClass[Size];
+  PGNIndexSize=Size;
+  for (uint16_t i=0; i<PGNIndexSize; i++) { PGNIndex[i].PGN=0; PGNIndex[i].Flags=0; }
+
+  // Same order as lists were checked before the index
+  if ( SingleFrameMessages[0]==0 ) AddPGNClasses(DefSingleFrameMessages,PGNClassKnown,FirstFlags);
+  AddPGNClasses(MandatoryFastPacketMessages,PGNClassKnown | PGNClassFastPacket | PGNClassSendFastPacket,FirstFlags);
+  if ( FastPacketMessages[0]==0 ) AddPGNClasses(DefFastPacketMessages,PGNClassKnown | PGNClassFastPacket | PGNClassSendFastPacket,FirstFlags);
+  AddPGNClasses(SingleFrameSystemMessages,PGNClassKnown | PGNClassSystem,FirstFlags);
+  AddPGNClasses(FastPacketSystemMessages,PGNClassKnown | PGNClassSystem | PGNClassFastPacket | PGNClassSendFastPacket,FirstFlags);
+  for (unsigned char igroup=0; igroup<N2kMessageGroups; igroup++) {
+    AddPGNClasses(SingleFrameMessages[igroup],PGNClassKnown,FirstFlags);
+    AddPGNClasses(FastPacketMessages[igroup],PGNClassKnown | PGNClassFastPacket | PGNClassSendFastPacket,FirstFlags);
+  }
+
+  N2kDbg("PGN index size: "); N2kDbg(PGNIndexSize); N2kDbg(", PGNs: "); N2kDbgln(MaxCount);
+  PGNIndexValid=true;
+}
+
+//*****************************************************************************
+const tNMEA2000::tPGNClass *tNMEA2000::FindPGNClass(unsigned long PGN) {
+  if ( !PGNIndexValid ) BuildPGNIndex();
+
+  uint16_t Mask=PGNIndexSize-1;
+
+  for (uint16_t i=PGNIndexSlot(PGN,Mask); PGNIndex[i].PGN!=0; i=(i+1) & Mask) {
+    if ( PGNIndex[i].PGN==PGN ) return &PGNIndex[i];
+  }
+
+  return 0;
+}
+
+//*****************************************************************************
+// Only PGNs library handles itself and PGNs devices have declared to receive
+// pass the filter. Other known messages are not needed for classification
+// once they are not received.
+void tNMEA2000::AddReceiveFilterPGNs(tN2kRxFilter &Filter) {
+  InitDevices();
+  Filter.AddList(SingleFrameSystemMessages);
+  Filter.AddList(FastPacketSystemMessages);
+  Filter.AddList(DefReceiveMessages);
+  for (int i=0; i<DeviceCount; i++) Filter.AddList(Devices[i].ReceiveMessages);
+}
+
+//*****************************************************************************
+bool tNMEA2000::IsFastPacketPGN(unsigned long PGN) {
+  const tPGNClass *PGNClass=FindPGNClass(PGN);
+
+  if ( PGNClass!=0 && (PGNClass->Flags & PGNClassSendFastPacket)!=0 ) return true;
+
+  return IsProprietaryFastPacketMessage(PGN);
 }
 
 //*****************************************************************************
@@ -1233,82 +1331,87 @@ bool tNMEA2000::IsFastPacket(const tN2kMsg &N2kMsg) {
 
 //*****************************************************************************
 bool tNMEA2000::CheckKnownMessage(unsigned long PGN, bool &SystemMessage, bool &FastPacket) {
-  int i;
-//    return true;
     FastPacket=false;
     SystemMessage=false;
     if ( PGN==0 ) { return false; }  // Unknown
 
-    // Check other messages
-    if ( SingleFrameMessages[0]==0 && IsDefaultSingleFrameMessage(PGN) ) return true;
-    if ( (FastPacket=IsMandatoryFastPacketMessage(PGN)) ) return true;
-    if ( FastPacketMessages[0]==0 && (FastPacket=IsDefaultFastPacketMessage(PGN))==true ) return true;
+    const tPGNClass *PGNClass=FindPGNClass(PGN);
 
-    // Check system messages
-    if ( IsSingleFrameSystemMessage(PGN) || (FastPacket=IsFastPacketSystemMessage(PGN))==true ) {
-      SystemMessage=true;
-      return true;
+    if ( PGNClass==0 ) {
+      FastPacket=IsProprietaryFastPacketMessage(PGN);
+      return false;
     }
 
-    // Check user defined messages
-    for (unsigned char igroup=0; (igroup<N2kMessageGroups); igroup++)  {
-      if (SingleFrameMessages[igroup]!=0) {
-        for (i=0; pgm_read_dword(&SingleFrameMessages[igroup][i])!=PGN && pgm_read_dword(&SingleFrameMessages[igroup][i])!=0; i++);
-        if (pgm_read_dword(&SingleFrameMessages[igroup][i])==PGN) return true;
-      }
+    SystemMessage=( (PGNClass->Flags & PGNClassSystem)!=0 );
+    FastPacket=( (PGNClass->Flags & PGNClassFastPacket)!=0 );
 
-      if (FastPacketMessages[igroup]!=0) {
-        for (i=0; pgm_read_dword(&FastPacketMessages[igroup][i])!=PGN && pgm_read_dword(&FastPacketMessages[igroup][i])!=0; i++);
-        if (pgm_read_dword(&FastPacketMessages[igroup][i])==PGN) {
-         FastPacket=true;
-         return true;
-        }
-      }
-    }
+    return true;
+}
 
-    FastPacket=IsProprietaryFastPacketMessage(PGN);
-    
-    return false;
+//*****************************************************************************
+void tNMEA2000::FreeExpiredCANMsgs(unsigned long CurTime) {
+  tN2kCANMsgPool::tSlot *Slot;
+
+  while ( (Slot=N2kCANMsgPool.GetExpired(CurTime,Max_N2kMsgBuf_Time))!=0 ) {
+    N2kFrameErrDbgStart("Timeout, source "); N2kFrameErrDbg(Slot->Source); N2kFrameErrDbg(" for: "); N2kFrameErrDbgln(Slot->PGN);
+    N2kCANMsgPool.Free(Slot);
+  }
 }
 
 //*****************************************************************************
-void CopyBufToCANMsg(tN2kCANMsg &CANMsg, unsigned char start, unsigned char len, unsigned char *buf) {
-        for (int j=start; (j<len) & (CANMsg.CopiedLen<CANMsg.N2kMsg.MaxDataLen); j++, CANMsg.CopiedLen++) {
-          CANMsg.N2kMsg.Data[CANMsg.CopiedLen]=buf[j];
-        }
+// Starts new message under reception. Message with same key, which has not been
+// finished, will be replaced.
+tN2kCANMsgPool::tSlot *tNMEA2000::StartCANMsg(unsigned long KeyPGN, unsigned char Source, unsigned char Tag, uint16_t DataLen, unsigned long CurTime) {
+  N2kCANMsgPool.Free(N2kCANMsgPool.Find(KeyPGN,Source,Tag));
+
+  tN2kCANMsgPool::tSlot *Slot=N2kCANMsgPool.Alloc(KeyPGN,Source,Tag,DataLen,CurTime);
+  if ( Slot!=0 ) {
+    Slot->PGN=KeyPGN;
+    Slot->Priority=7;
+    Slot->Destination=0xff;
+  }
+
+  return Slot;
 }
 
 //*****************************************************************************
+// As tN2kMsg::Init, but uses time frame was read instead of reading clock for every frame.
+void InitReceivedMsg(tN2kMsg &N2kMsg, unsigned char Priority, unsigned long PGN, unsigned char Source, unsigned char Destination,
+                     unsigned long MsgTime, bool TPMessage=false) {
+  N2kMsg.Priority=Priority & 0x7;
+  N2kMsg.PGN=PGN;
+  N2kMsg.Source=Source;
+  N2kMsg.Destination=Destination;
+  N2kMsg.DataLen=0;
+  N2kMsg.MsgTime=MsgTime;
 #if !defined(N2K_NO_ISO_MULTI_PACKET_SUPPORT)
-void tNMEA2000::FindFreeCANMsgIndex(unsigned long PGN, unsigned char Source, unsigned char Destination, bool TPMsg, uint8_t &MsgIndex) {
+  N2kMsg.SetIsTPMessage(TPMessage);
 #else
-void tNMEA2000::FindFreeCANMsgIndex(unsigned long PGN, unsigned char Source, unsigned char Destination, uint8_t &MsgIndex) {
+  (void)TPMessage;
 #endif
-  unsigned long OldestMsgTime,CurTime;
-  int OldestIndex;
-
-  for (MsgIndex=0, CurTime=OldestMsgTime=millis(), OldestIndex=MaxN2kCANMsgs;
-       MsgIndex<MaxN2kCANMsgs &&
-       !( N2kCANMsgBuf[MsgIndex].FreeMsg ||
-         ( N2kCANMsgBuf[MsgIndex].N2kMsg.PGN==PGN
-           && N2kCANMsgBuf[MsgIndex].N2kMsg.Source==Source
-           && N2kCANMsgBuf[MsgIndex].N2kMsg.Destination==Destination
+}
+
+//*****************************************************************************
+// Copies complete message from reception slot for handling and frees slot.
+tN2kCANMsg *tNMEA2000::SetReadyCANMsg(tN2kCANMsgPool::tSlot *Slot, unsigned long CurTime) {
+  tN2kCANMsg &CANMsg=*N2kCANRxMsg;
+
+  CANMsg.FreeMsg=false;
+  CANMsg.KnownMessage=Slot->KnownMessage;
+  CANMsg.SystemMessage=Slot->SystemMessage;
 #if !defined(N2K_NO_ISO_MULTI_PACKET_SUPPORT)
-           && N2kCANMsgBuf[MsgIndex].N2kMsg.IsTPMessage()==TPMsg
+  InitReceivedMsg(CANMsg.N2kMsg,Slot->Priority,Slot->PGN,Slot->Source,Slot->Destination,CurTime,Slot->TPMessage);
+#else
+  InitReceivedMsg(CANMsg.N2kMsg,Slot->Priority,Slot->PGN,Slot->Source,Slot->Destination,CurTime);
 #endif
-         )
-        );
-       MsgIndex++) { // Find free message place
-    if (N2kCANMsgBuf[MsgIndex].N2kMsg.MsgTime<OldestMsgTime) {
-      OldestIndex=MsgIndex;
-      OldestMsgTime=N2kCANMsgBuf[MsgIndex].N2kMsg.MsgTime;
-    }
-  }
-  if ( MsgIndex==MaxN2kCANMsgs && OldestMsgTime+Max_N2kMsgBuf_Time<CurTime) {
-    MsgIndex=OldestIndex; // Use the old one, which has timed out
-    N2kCANMsgBuf[MsgIndex].FreeMessage();
-  }
+  CANMsg.N2kMsg.DataLen=Slot->DataLen;
+  memcpy(CANMsg.N2kMsg.Data,Slot->Data,Slot->DataLen);
+  CANMsg.CopiedLen=Slot->CopiedLen;
+  CANMsg.LastFrame=Slot->LastFrame;
+  CANMsg.Ready=true;
+  N2kCANMsgPool.Free(Slot);
 
+  return &CANMsg;
 }
 
 #if !defined(N2K_NO_ISO_MULTI_PACKET_SUPPORT)
@@ -1434,8 +1537,8 @@ bool tNMEA2000::HasAllTPDTSent(int iDev) {
 //*****************************************************************************
 bool tNMEA2000::TestHandleTPMessage(unsigned long PGN, unsigned char Source, unsigned char Destination,
                                     unsigned char len, unsigned char *buf,
-                                    uint8_t &MsgIndex) {
-  MsgIndex=MaxN2kCANMsgs;
+                                    unsigned long CurTime, tN2kCANMsg *&RxMsg) {
+  RxMsg=0;
   int iDev=FindSourceDeviceIndex(Destination);
 
   if ( PGN==TP_CM ) {
@@ -1452,43 +1555,40 @@ bool tNMEA2000::TestHandleTPMessage(unsigned long PGN, unsigned char Source, uns
         uint8_t TPMaxPackets=buf[Index++];
         //Index++; // reserved
 
-        FindFreeCANMsgIndex(TransportPGN,Source,Destination,true,MsgIndex);
+        bool KnownMessage, SystemMessage, FastPacket;
+        tN2kCANMsgPool::tSlot *Slot=0;
 
-        if (MsgIndex==MaxN2kCANMsgs) { // No free msg place
-          N2kMsgDbgStart("No free msg slot"); N2kMsgDbgln();
+        KnownMessage=CheckKnownMessage(TransportPGN,SystemMessage,FastPacket);
+        if ( nBytes < tN2kMsg::MaxDataLen &&  // Currently we can handle only tN2kMsg::MaxDataLen long messages
+             (KnownMessage || !HandleOnlyKnownMessages()) ) {
+          // Sender can have only one transport session to a destination, so it is the key
+          Slot=StartCANMsg(TP_DT,Source,Destination,nBytes,CurTime);
+          if ( Slot==0 ) { N2kMsgDbgStart("No free msg slot"); N2kMsgDbgln(); }
+        }
+
+        if ( Slot==0 ) { // Too long, unknown or no free msg place
           if ( (TP_CM_Control==TP_CM_RTS) && (iDev>=0) ) { // If it was for us and not broadcast, we need to abort transport
             SendTPCM_Abort(TransportPGN,Source,iDev,TP_CM_AbortBusy);
           }
         } else { // Start transport
-          N2kMsgDbgStart("Use msg slot: "); N2kMsgDbgln(MsgIndex);
-          bool FastPacket;
-          N2kCANMsgBuf[MsgIndex].KnownMessage=CheckKnownMessage(TransportPGN,N2kCANMsgBuf[MsgIndex].SystemMessage,FastPacket);
-          if ( nBytes < tN2kMsg::MaxDataLen &&  // Currently we can handle only tN2kMsg::MaxDataLen long messages
-               (N2kCANMsgBuf[MsgIndex].KnownMessage || !HandleOnlyKnownMessages()) ) {
-            N2kCANMsgBuf[MsgIndex].FreeMsg=false;
-            N2kCANMsgBuf[MsgIndex].N2kMsg.Init(7 /* Priority? */,TransportPGN,Source,Destination);
-            N2kCANMsgBuf[MsgIndex].CopiedLen=0;
-            N2kCANMsgBuf[MsgIndex].LastFrame=0;
-            N2kCANMsgBuf[MsgIndex].N2kMsg.DataLen=nBytes;
-            N2kCANMsgBuf[MsgIndex].N2kMsg.SetIsTPMessage();
-            N2kCANMsgBuf[MsgIndex].TPMaxPackets=TPMaxPackets;
-            if ( (TP_CM_Control==TP_CM_RTS) && (iDev>=0) ) { // If it was for us and not broadcast, we need to response
-              SendTPCM_CTS(TransportPGN,Source,iDev,N2kCANMsgBuf[MsgIndex].TPMaxPackets,N2kCANMsgBuf[MsgIndex].LastFrame+1);
-              N2kCANMsgBuf[MsgIndex].TPRequireCTS=TPCtsPackets(N2kCANMsgBuf[MsgIndex].TPMaxPackets);
-            } else {
-              N2kCANMsgBuf[MsgIndex].TPMaxPackets=0xff; // TPMaxPackets>0 indicates that it is TP message
-            }
-          } else { // Too long or unknown
-            if ( (TP_CM_Control==TP_CM_RTS) && (iDev>=0) ) { // If it was for us and not broadcast, we need to response
-              SendTPCM_Abort(TransportPGN,Source,iDev,TP_CM_AbortBusy);  // Abort
-            }
+          Slot->PGN=TransportPGN;
+          Slot->Destination=Destination;
+          Slot->KnownMessage=KnownMessage;
+          Slot->SystemMessage=SystemMessage;
+          Slot->TPMessage=true;
+          Slot->TPMaxPackets=TPMaxPackets;
+          if ( (TP_CM_Control==TP_CM_RTS) && (iDev>=0) ) { // If it was for us and not broadcast, we need to response
+            SendTPCM_CTS(TransportPGN,Source,iDev,Slot->TPMaxPackets,Slot->LastFrame+1);
+            Slot->TPRequireCTS=TPCtsPackets(Slot->TPMaxPackets);
+          } else {
+            Slot->TPMaxPackets=0xff; // TPMaxPackets>0 indicates that it is TP message
           }
         }
         break;
       }
       case TP_CM_CTS:
         if ( !IsValidDevice(iDev) ) break; // Should never fail
-        N2kMsgDbgStart("Got TP CTS"); N2kMsgDbgln(MsgIndex);
+        N2kMsgDbgStart("Got TP CTS"); N2kMsgDbgln();
         if ( IsBroadcast(Devices[iDev].PendingTPMsg.Destination) ) break; // We should not get controls for broadcast TP msg
         if ( Devices[iDev].PendingTPMsg.PGN!=TransportPGN ) { // Some failure on communication
           EndSendTPMessage(iDev); // Should we retry from beginning?
@@ -1509,61 +1609,50 @@ bool tNMEA2000::TestHandleTPMessage(unsigned long PGN, unsigned char Source, uns
         break;
       case TP_CM_ACK:
         if ( !IsValidDevice(iDev) ) break; // Should never fail
-        N2kMsgDbgStart("Got TP ACK"); N2kMsgDbgln(MsgIndex);
+        N2kMsgDbgStart("Got TP ACK"); N2kMsgDbgln();
         if ( IsBroadcast(Devices[iDev].PendingTPMsg.Destination) ) break; // We should not get controls for broadcast TP msg
         EndSendTPMessage(iDev);
         break;
       case TP_CM_Abort:
         if ( !IsValidDevice(iDev) ) break; // Should never fail
-        N2kMsgDbgStart("Got TP Abort"); N2kMsgDbgln(MsgIndex);
+        N2kMsgDbgStart("Got TP Abort"); N2kMsgDbgln();
         if ( IsBroadcast(Devices[iDev].PendingTPMsg.Destination) ) break; // We should not get controls for broadcast TP msg
         EndSendTPMessage(iDev);
         break;
       default:
         ;
     }
-    MsgIndex=MaxN2kCANMsgs;  // After TP_CM, message is newer ready.
     return true;
   } else if ( PGN==TP_DT ) { // Datapacket
-    N2kMsgDbgStart("Got TP data"); N2kMsgDbgln(MsgIndex);
+    N2kMsgDbgStart("Got TP data"); N2kMsgDbgln();
     // So we need to find TP msg which sender and destination matches.
-    for (MsgIndex=0;
-         MsgIndex<MaxN2kCANMsgs &&
-         !( !N2kCANMsgBuf[MsgIndex].FreeMsg
-            && N2kCANMsgBuf[MsgIndex].N2kMsg.IsTPMessage()
-            && N2kCANMsgBuf[MsgIndex].N2kMsg.Destination==Destination
-            && N2kCANMsgBuf[MsgIndex].N2kMsg.Source==Source
-          );
-         MsgIndex++);
-    // if (MsgIndex==MaxN2kCANMsgs) N2kMsgDbgln("TP data msg not found");
+    tN2kCANMsgPool::tSlot *Slot=N2kCANMsgPool.Find(TP_DT,Source,Destination);
+    // if (Slot==0) N2kMsgDbgln("TP data msg not found");
     // for (int i=1; i<len; i++) N2kMsgDbgln(buf[i]);
-    if (MsgIndex<MaxN2kCANMsgs) { // found TP message under reception
-      N2kMsgDbgStart("Use msg slot: "); N2kMsgDbgln(MsgIndex);
-      if (N2kCANMsgBuf[MsgIndex].LastFrame+1 == buf[0]) { // Right packet is coming
+    if ( Slot!=0 ) { // found TP message under reception
+      if (Slot->LastFrame+1 == buf[0]) { // Right packet is coming
         // Add packet to the message
-        CopyBufToCANMsg(N2kCANMsgBuf[MsgIndex],1,len,buf);
-        N2kCANMsgBuf[MsgIndex].LastFrame=buf[0];
+        Slot->CopyData(1,len,buf);
+        Slot->LastFrame=buf[0];
         // Transport protocol is slower, so to avoid timeout, we reset message time
-        N2kCANMsgBuf[MsgIndex].N2kMsg.MsgTime=millis();
-        if ( N2kCANMsgBuf[MsgIndex].CopiedLen>=N2kCANMsgBuf[MsgIndex].N2kMsg.DataLen ) { // all done
-          N2kCANMsgBuf[MsgIndex].Ready=true;
-          if ( N2kCANMsgBuf[MsgIndex].TPRequireCTS>0 && iDev>=0 ) { // send response
-            SendTPCM_EndAck(N2kCANMsgBuf[MsgIndex].N2kMsg.PGN,Source,iDev,N2kCANMsgBuf[MsgIndex].N2kMsg.DataLen,N2kCANMsgBuf[MsgIndex].LastFrame);
+        N2kCANMsgPool.Touch(Slot,CurTime);
+        if ( Slot->IsComplete() ) { // all done
+          if ( Slot->TPRequireCTS>0 && iDev>=0 ) { // send response
+            SendTPCM_EndAck(Slot->PGN,Source,iDev,Slot->DataLen,Slot->LastFrame);
           }
+          RxMsg=SetReadyCANMsg(Slot,CurTime);
         } else {
-          if ( N2kCANMsgBuf[MsgIndex].TPRequireCTS>0 && ((N2kCANMsgBuf[MsgIndex].LastFrame)%N2kCANMsgBuf[MsgIndex].TPRequireCTS)==0 ) { // send response
-            SendTPCM_CTS(N2kCANMsgBuf[MsgIndex].N2kMsg.PGN,Source,iDev,N2kCANMsgBuf[MsgIndex].TPMaxPackets,N2kCANMsgBuf[MsgIndex].LastFrame+1);
+          if ( Slot->TPRequireCTS>0 && ((Slot->LastFrame)%Slot->TPRequireCTS)==0 ) { // send response
+            SendTPCM_CTS(Slot->PGN,Source,iDev,Slot->TPMaxPackets,Slot->LastFrame+1);
           }
         }
       } else { // Wrong packet - either we lost packet or sender sends wrong, so free this
         N2kMsgDbgStart("Invalid packet: "); N2kMsgDbgln(buf[0]);
-        if ( N2kCANMsgBuf[MsgIndex].TPRequireCTS>0 && iDev>=0 ) { // We need to abort transport
-          SendTPCM_Abort(N2kCANMsgBuf[MsgIndex].N2kMsg.PGN,Source,iDev,TP_CM_AbortTimeout);  // Abort transport
+        if ( Slot->TPRequireCTS>0 && iDev>=0 ) { // We need to abort transport
+          SendTPCM_Abort(Slot->PGN,Source,iDev,TP_CM_AbortTimeout);  // Abort transport
         }
-        N2kCANMsgBuf[MsgIndex].FreeMessage();
-
+        N2kCANMsgPool.Free(Slot);
       }
-      if ( !N2kCANMsgBuf[MsgIndex].Ready ) MsgIndex=MaxN2kCANMsgs;
     }
     return true; // We handled message
   }
@@ -1620,10 +1709,11 @@ void tNMEA2000::SendPendingTPMessages() {
 inline bool IsFastPacketFirstFrame(unsigned char b) { return ((b & 0x1F)==0); }
 
 //*****************************************************************************
-// Function handles received CAN frame and adds it to tN2kCANMsg.
-// Returns: Index to ready tN2kCANMsg or MaxN2kCANMsgs, if we skipped the frame
-//          or message is not ready (fast packet or ISO Multi-Packet)
-uint8_t tNMEA2000::SetN2kCANBufMsg(unsigned long canId, unsigned char len, unsigned char *buf) {
+// Function handles received CAN frame and adds it to message under reception.
+// CurTime is millis() when frame was read.
+// Returns: Ready message or 0, if we skipped the frame or message is not ready
+//          (fast packet or ISO Multi-Packet)
+tN2kCANMsg *tNMEA2000::SetN2kCANBufMsg(unsigned long canId, unsigned char len, unsigned char *buf, unsigned long CurTime) {
   unsigned char Priority;
   unsigned long PGN;
   unsigned char Source;
@@ -1631,80 +1721,67 @@ uint8_t tNMEA2000::SetN2kCANBufMsg(unsigned long canId, unsigned char len, unsig
   bool FastPacket;
   bool SystemMessage;
   bool KnownMessage;
-  uint8_t MsgIndex=MaxN2kCANMsgs;
+  tN2kCANMsg *RxMsg=0;
 
+    FreeExpiredCANMsgs(CurTime);
     CanIdToN2k(canId,Priority,PGN,Source,Destination);
 #if !defined(N2K_NO_ISO_MULTI_PACKET_SUPPORT)
-    if ( !TestHandleTPMessage(PGN,Source,Destination,len,buf,MsgIndex) )
+    if ( !TestHandleTPMessage(PGN,Source,Destination,len,buf,CurTime,RxMsg) )
 #endif
     {
       KnownMessage=CheckKnownMessage(PGN,SystemMessage,FastPacket);
       if ( KnownMessage || !HandleOnlyKnownMessages() ) {
-        if (FastPacket && !IsFastPacketFirstFrame(buf[0]) ) { // Not first frame
-        N2kFrameInDbgStart("New frame="); N2kFrameInDbg(PGN); N2kFrameInDbg(" frame="); N2kFrameInDbg(buf[0],HEX); N2kFrameInDbgln();
-          // Find previous slot for this PGN
-          for (MsgIndex=0;
-               MsgIndex<MaxN2kCANMsgs &&
-               !( N2kCANMsgBuf[MsgIndex].N2kMsg.PGN==PGN
-                  && N2kCANMsgBuf[MsgIndex].N2kMsg.Source==Source
-#if !defined(N2K_NO_ISO_MULTI_PACKET_SUPPORT)
-                  && !N2kCANMsgBuf[MsgIndex].N2kMsg.IsTPMessage()
-#endif
-                );
-               MsgIndex++);
-          if (MsgIndex<MaxN2kCANMsgs) { // we found start for this message, so add data to it.
-            N2kMsgDbgStart("Use msg slot: "); N2kMsgDbgln(MsgIndex);
-            if (N2kCANMsgBuf[MsgIndex].LastFrame+1 == buf[0]) { // Right frame is coming
-              N2kCANMsgBuf[MsgIndex].LastFrame=buf[0];
-              CopyBufToCANMsg(N2kCANMsgBuf[MsgIndex],1,len,buf);
+        if ( !FastPacket ) { // Single frame message is ready as such
+          N2kFrameInDbgStart("Single frame="); N2kFrameInDbg(PGN); N2kFrameInDbgln();
+          RxMsg=N2kCANRxMsg;
+          RxMsg->FreeMsg=false;
+          RxMsg->KnownMessage=KnownMessage;
+          RxMsg->SystemMessage=SystemMessage;
+          InitReceivedMsg(RxMsg->N2kMsg,Priority,PGN,Source,Destination,CurTime);
+          if ( len>8 ) len=8;
+          memcpy(RxMsg->N2kMsg.Data,buf,len);
+          RxMsg->N2kMsg.DataLen=len;
+          RxMsg->CopiedLen=len;
+          RxMsg->LastFrame=0;
+          RxMsg->Ready=true;
+        } else if ( !IsFastPacketFirstFrame(buf[0]) ) { // Not first frame
+          N2kFrameInDbgStart("New frame="); N2kFrameInDbg(PGN); N2kFrameInDbg(" frame="); N2kFrameInDbg(buf[0],HEX); N2kFrameInDbgln();
+          // Find previous slot for this PGN and sequence
+          tN2kCANMsgPool::tSlot *Slot=N2kCANMsgPool.Find(PGN,Source,buf[0]>>5);
+          if ( Slot!=0 ) { // we found start for this message, so add data to it.
+            if (Slot->LastFrame+1 == buf[0]) { // Right frame is coming
+              Slot->LastFrame=buf[0];
+              Slot->CopyData(1,len,buf);
+              N2kCANMsgPool.Touch(Slot,CurTime);
+              if ( Slot->IsComplete() ) RxMsg=SetReadyCANMsg(Slot,CurTime);
             } else { // We have lost frame, so free this
-              N2kFrameErrDbgStart("Lost frame ");  N2kFrameErrDbg(N2kCANMsgBuf[MsgIndex].LastFrame); N2kFrameErrDbg("/");  N2kFrameErrDbg(buf[0]);
+              N2kFrameErrDbgStart("Lost frame ");  N2kFrameErrDbg(Slot->LastFrame); N2kFrameErrDbg("/");  N2kFrameErrDbg(buf[0]);
               N2kFrameErrDbg(", source ");  N2kFrameErrDbg(Source); N2kFrameErrDbg(" for: "); N2kFrameErrDbgln(PGN);
-              N2kCANMsgBuf[MsgIndex].FreeMessage();
-              MsgIndex=MaxN2kCANMsgs;
+              N2kCANMsgPool.Free(Slot);
             }
           } else {  // Orphan frame
               N2kFrameErrDbgStart("Orphan frame "); N2kFrameErrDbg(buf[0]); N2kFrameErrDbg(", source ");
               N2kFrameErrDbg(Source); N2kFrameErrDbg(" for: "); N2kFrameErrDbgln(PGN);
           }
         } else { // Handle first frame
-#if !defined(N2K_NO_ISO_MULTI_PACKET_SUPPORT)
-          FindFreeCANMsgIndex(PGN,Source,Destination,false,MsgIndex);
-#else
-          FindFreeCANMsgIndex(PGN,Source,Destination,MsgIndex);
-#endif
-          if ( MsgIndex<MaxN2kCANMsgs ) { // we found free place, so handle frame
-            N2kMsgDbgStart("Use msg slot: "); N2kMsgDbgln(MsgIndex);
-            N2kCANMsgBuf[MsgIndex].FreeMsg=false;
-            N2kCANMsgBuf[MsgIndex].KnownMessage=KnownMessage;
-            N2kCANMsgBuf[MsgIndex].SystemMessage=SystemMessage;
-            N2kCANMsgBuf[MsgIndex].N2kMsg.Init(Priority,PGN,Source,Destination);
-#if !defined(N2K_NO_ISO_MULTI_PACKET_SUPPORT)
-            N2kCANMsgBuf[MsgIndex].N2kMsg.SetIsTPMessage(false);
-#endif
-            N2kCANMsgBuf[MsgIndex].CopiedLen=0;
-            if (FastPacket) {
-              CopyBufToCANMsg(N2kCANMsgBuf[MsgIndex],2,len,buf);
-              N2kFrameInDbgStart("First frame="); N2kFrameInDbg(PGN);  N2kFrameInDbgln();
-              N2kCANMsgBuf[MsgIndex].LastFrame=buf[0];
-              N2kCANMsgBuf[MsgIndex].N2kMsg.DataLen=buf[1];
-            } else {
-              CopyBufToCANMsg(N2kCANMsgBuf[MsgIndex],0,len,buf);
-              N2kFrameInDbgStart("Single frame="); N2kFrameInDbg(PGN); N2kFrameInDbgln();
-              N2kCANMsgBuf[MsgIndex].LastFrame=0;
-              N2kCANMsgBuf[MsgIndex].N2kMsg.DataLen=len;
-            }
+          tN2kCANMsgPool::tSlot *Slot=StartCANMsg(PGN,Source,buf[0]>>5,buf[1],CurTime);
+          if ( Slot!=0 ) { // we found free place, so handle frame
+            N2kFrameInDbgStart("First frame="); N2kFrameInDbg(PGN);  N2kFrameInDbgln();
+            Slot->Priority=Priority;
+            Slot->Destination=Destination;
+            Slot->KnownMessage=KnownMessage;
+            Slot->SystemMessage=SystemMessage;
+            Slot->LastFrame=buf[0];
+            Slot->CopyData(2,len,buf);
+            if ( Slot->IsComplete() ) RxMsg=SetReadyCANMsg(Slot,CurTime);
+          } else {
+            N2kFrameErrDbgStart("No free msg slot, source "); N2kFrameErrDbg(Source); N2kFrameErrDbg(" for: "); N2kFrameErrDbgln(PGN);
           }
         }
-
-        if ( MsgIndex<MaxN2kCANMsgs ) {
-          N2kCANMsgBuf[MsgIndex].Ready=(N2kCANMsgBuf[MsgIndex].CopiedLen>=N2kCANMsgBuf[MsgIndex].N2kMsg.DataLen);
-          if ( !N2kCANMsgBuf[MsgIndex].Ready ) MsgIndex=MaxN2kCANMsgs; // If packet is not ready, do not return index to it
-        }
       }
     }
 
-    return MsgIndex;
+    return RxMsg;
 }
 
 //*****************************************************************************
@@ -2184,29 +2261,29 @@ void tNMEA2000::GetNextAddress(int DeviceIndex, bool RestartAtEnd) {
 }
 
 //*****************************************************************************
-bool tNMEA2000::HandleReceivedSystemMessage(int MsgIndex) {
+bool tNMEA2000::HandleReceivedSystemMessage(const tN2kCANMsg &N2kCANMsg) {
   bool result=false;
 
    if ( N2kMode==N2km_SendOnly || N2kMode==N2km_ListenAndSend ) return result;
 
-    if ( N2kCANMsgBuf[MsgIndex].SystemMessage ) {
-      if ( ForwardSystemMessages() ) ForwardMessage(N2kCANMsgBuf[MsgIndex].N2kMsg);
+    if ( N2kCANMsg.SystemMessage ) {
+      if ( ForwardSystemMessages() ) ForwardMessage(N2kCANMsg.N2kMsg);
       if ( N2kMode!=N2km_ListenOnly ) { // Note that in listen only mode we will not inform us to the bus
-        switch (N2kCANMsgBuf[MsgIndex].N2kMsg.PGN) {
+        switch (N2kCANMsg.N2kMsg.PGN) {
           case 59392L: /*ISO Acknowledgement*/
             break;
           case 59904L: /*ISO Request*/
-            HandleISORequest(N2kCANMsgBuf[MsgIndex].N2kMsg);
+            HandleISORequest(N2kCANMsg.N2kMsg);
             break;
           case 60928L: /*ISO Address Claim*/
-            HandleISOAddressClaim(N2kCANMsgBuf[MsgIndex].N2kMsg);
+            HandleISOAddressClaim(N2kCANMsg.N2kMsg);
             break;
           case 65240L: /*Commanded Address*/
-            HandleCommandedAddress(N2kCANMsgBuf[MsgIndex].N2kMsg);
+            HandleCommandedAddress(N2kCANMsg.N2kMsg);
             break;
 #if !defined(N2K_NO_GROUP_FUNCTION_SUPPORT)
           case 126208L: /*NMEA Request/Command/Acknowledge group function*/
-            HandleGroupFunction(N2kCANMsgBuf[MsgIndex].N2kMsg);
+            HandleGroupFunction(N2kCANMsg.N2kMsg);
             break;
 #endif
         }
@@ -2222,8 +2299,8 @@ void tNMEA2000::ParseMessages() {
     unsigned long canId;
     unsigned char len = 0;
     unsigned char buf[8];
-    uint8_t MsgIndex;
-    static const int MaxReadFramesOnParse=20;
+    tN2kCANMsg *RxMsg;
+    unsigned long CurTime;
     int FramesRead=0;
 //    tN2kMsg N2kMsg;
 
@@ -2240,19 +2317,20 @@ void tNMEA2000::ParseMessages() {
     TestISR();
 #endif
 
+    CurTime=millis(); // Frames are read in short burst, so one time is enough for all of them
     while (FramesRead<MaxReadFramesOnParse && CANGetFrame(canId,len,buf) ) {           // check if data coming
         FramesRead++;
         N2kMsgDbgStart("Received frame, can ID:"); N2kMsgDbg(canId); N2kMsgDbg(" len:"); N2kMsgDbg(len); N2kMsgDbg(" data:"); DbgPrintBuf(len,buf,false); N2kMsgDbgln();
-        MsgIndex=SetN2kCANBufMsg(canId,len,buf);
-        if (MsgIndex<MaxN2kCANMsgs) {
-          if ( !HandleReceivedSystemMessage(MsgIndex) ) {
-            N2kMsgDbgStart(" - Non system message, MsgIndex: "); N2kMsgDbgln(MsgIndex);
-            ForwardMessage(N2kCANMsgBuf[MsgIndex]);
+        RxMsg=SetN2kCANBufMsg(canId,len,buf,CurTime);
+        if (RxMsg!=0) {
+          if ( !HandleReceivedSystemMessage(*RxMsg) ) {
+            N2kMsgDbgStart(" - Non system message, PGN: "); N2kMsgDbgln(RxMsg->N2kMsg.PGN);
+            ForwardMessage(*RxMsg);
           }
-//          N2kCANMsgBuf[MsgIndex].N2kMsg.Print(Serial);
-          RunMessageHandlers(N2kCANMsgBuf[MsgIndex].N2kMsg);
-          N2kCANMsgBuf[MsgIndex].FreeMessage();
-          N2kMsgDbgStart(" - Free message, MsgIndex: "); N2kMsgDbg(MsgIndex); N2kMsgDbgln();
+//          RxMsg->N2kMsg.Print(Serial);
+          RunMessageHandlers(RxMsg->N2kMsg);
+          RxMsg->FreeMessage();
+          N2kMsgDbgStart(" - Free message"); N2kMsgDbgln();
         }
     }
 
@@ -2261,6 +2339,42 @@ void tNMEA2000::ParseMessages() {
 #endif
 }
 
+//*****************************************************************************
+// Due time T against Now, both millis(), as delay limited to MaxDelay.
+static unsigned long HousekeepingDelay(unsigned long T, unsigned long Now, unsigned long MaxDelay) {
+  long Delay=(long)(T-Now);
+
+  if ( Delay<0 ) return 0;
+  return ( (unsigned long)Delay<MaxDelay ? (unsigned long)Delay : MaxDelay );
+}
+
+//*****************************************************************************
+unsigned long tNMEA2000::GetHousekeepingDelay(unsigned long MaxDelay) {
+  unsigned long Now=millis();
+  unsigned long Delay=MaxDelay;
+
+  if ( !DeviceReady ) return 0; // ParseMessages retries open
+  if ( CANSendFrameBuf!=0 && !CANSendFrameBuf->isEmpty() ) return 0;
+
+  for (int i=0; i<DeviceCount; i++) {
+    if ( Devices[i].PendingIsoAddressClaim!=0 ) Delay=HousekeepingDelay(Devices[i].PendingIsoAddressClaim,Now,Delay);
+    if ( Devices[i].PendingProductInformation!=0 ) Delay=HousekeepingDelay(Devices[i].PendingProductInformation,Now,Delay);
+    if ( Devices[i].PendingConfigurationInformation!=0 ) Delay=HousekeepingDelay(Devices[i].PendingConfigurationInformation,Now,Delay);
+    if ( Devices[i].AddressClaimStarted!=0 ) Delay=HousekeepingDelay(Devices[i].AddressClaimStarted+N2kAddressClaimTimeout,Now,Delay);
+#if !defined(N2K_NO_ISO_MULTI_PACKET_SUPPORT)
+    if ( Devices[i].PendingTPMsg.PGN!=0 ) Delay=HousekeepingDelay(Devices[i].NextDTSendTime,Now,Delay);
+#endif
+#if !defined(N2K_NO_HEARTBEAT_SUPPORT)
+    // SendHeartbeat waits for address claim to end
+    if ( IsActiveNode() && Devices[i].AddressClaimStarted==0 && Devices[i].HeartbeatInterval>0 ) {
+      Delay=HousekeepingDelay(Devices[i].NextHeartbeatSentTime,Now,Delay);
+    }
+#endif
+  }
+
+  return Delay;
+}
+
 //*****************************************************************************
 void tNMEA2000::RunMessageHandlers(const tN2kMsg &N2kMsg) {
   if ( MsgHandler!=0 ) MsgHandler(N2kMsg);
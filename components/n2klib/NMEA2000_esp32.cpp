@@ -28,12 +28,15 @@ can.h library, which may cause even naming problem.
 */
 
 #include <cmath>
+#include <string.h>
+#include "esp_timer.h"
 #include "driver/periph_ctrl.h"
 
 #include "soc/dport_reg.h"
 #include "NMEA2000_esp32.h"
 
 bool tNMEA2000_esp32::CanInUse=false;
+portMUX_TYPE tNMEA2000_esp32::TxMux=portMUX_INITIALIZER_UNLOCKED;
 tNMEA2000_esp32 *pNMEA2000_esp32=0;
 
 void ESP32Can1Interrupt(void *);
@@ -42,44 +45,57 @@ void ESP32Can1Interrupt(void *);
 tNMEA2000_esp32::tNMEA2000_esp32(gpio_num_t _TxPin,  gpio_num_t _RxPin) :
     tNMEA2000(), IsOpen(false),
     speed(CAN_SPEED_250KBPS), TxPin(_TxPin), RxPin(_RxPin),
-    RxQueue(NULL), TxQueue(NULL) {
+    RxRing(NULL), InjectRing(NULL), TxRing(NULL), RxFrameHook(0), RxHardwareOverruns(0),
+    RxNotifyTask(NULL), LastRxFrameTime(0),
+    RxFilterEnabled(false), RxFilterBypass(false), RxFilterBypassWanted(false), RxAccepted(0), RxRejected(0) {
+  memset(RxLatencyHistogram,0,sizeof(RxLatencyHistogram));
 }
 
 //*****************************************************************************
 bool tNMEA2000_esp32::CANSendFrame(unsigned long id, unsigned char len, const unsigned char *buf, bool /*wait_sent*/) {
-  if ( uxQueueSpacesAvailable(TxQueue)==0 ) 
-  {
-	  return false; // can not send to queue
-  }
-
   tCANFrame frame;
   frame.id=id;
   frame.len=len>8?8:len;
-  memcpy(frame.buf,buf,len);
+  memcpy(frame.buf,buf,frame.len);
 
-  xQueueSendToBack(TxQueue,&frame,0);  // Add frame to queue
-  if ( MODULE_CAN->SR.B.TBS==0 ) 
-  {
-	  return true; // Currently sending, ISR takes care of sending
+  // Interrupt reads the ring on transmit complete, so both add and restart are done under lock
+  portENTER_CRITICAL(&TxMux);
+  if ( !TxRing->add(frame,(id>>26) & 0x7) ) {
+    portEXIT_CRITICAL(&TxMux);
+    return false; // can not send to queue
   }
 
-  if ( MODULE_CAN->SR.B.TBS==1 ) 
-  { // Check again and restart send, if is not going on
-    xQueueReceive(TxQueue,&frame,0);
-	
+  if ( MODULE_CAN->SR.B.TBS==1 ) { // Transmit buffer free, so nothing is being sent and ISR will not start next. Send highest priority now.
+    TxRing->read(frame);
     CAN_send_frame(frame);
   }
+  portEXIT_CRITICAL(&TxMux);
+
   return true;
 }
 
+//*****************************************************************************
+uint16_t tNMEA2000_esp32::CANGetSendFrameSpace() {
+  uint16_t Space;
+
+  if ( TxRing==NULL ) return 0;
+
+  portENTER_CRITICAL(&TxMux);
+  Space=TxRing->getFreeCount();
+  portEXIT_CRITICAL(&TxMux);
+
+  return Space;
+}
+
 //*****************************************************************************
 void tNMEA2000_esp32::InitCANFrameBuffers() {
     if (MaxCANReceiveFrames<10 ) MaxCANReceiveFrames=50; // ESP32 has plenty of RAM
     if (MaxCANSendFrames<10 ) MaxCANSendFrames=40;
     uint16_t CANGlobalBufSize=MaxCANSendFrames-4;
     MaxCANSendFrames=4;  // we do not need much libary internal buffer since driver has them.
-    RxQueue=xQueueCreate(MaxCANReceiveFrames,sizeof(tCANFrame));
-    TxQueue=xQueueCreate(CANGlobalBufSize,sizeof(tCANFrame));
+    RxRing=new tSPSCRingBuffer<tCANFrame>(MaxCANReceiveFrames);
+    InjectRing=new tSPSCRingBuffer<tCANFrame>(MaxCANReceiveFrames);
+    TxRing=new tPriorityRingBuffer<tCANFrame>(CANGlobalBufSize,8); // by N2k priority, 0 highest
 
     tNMEA2000::InitCANFrameBuffers(); // call main initialization
 }
@@ -101,18 +117,100 @@ bool tNMEA2000_esp32::CANOpen() {
 
 //*****************************************************************************
 bool tNMEA2000_esp32::CANGetFrame(unsigned long &id, unsigned char &len, unsigned char *buf) {
-  bool HasFrame=false;
-  tCANFrame frame;
+  const tCANFrame *frame;
+
+    //receive next CAN frame from ring, no kernel call needed
+    if ( (frame=RxRing->getReadRef())!=0 ) {
+      id=frame->id;
+      len=frame->len;
+      memcpy(buf,frame->buf,frame->len);
+      LastRxFrameTime=frame->time;
+      RxRing->commitRead();
+      return true;
+    }
 
-    //receive next CAN frame from queue
-    if ( xQueueReceive(RxQueue,&frame, 0)==pdTRUE ) {
-      HasFrame=true;
-      id=frame.id;
-      len=frame.len;
-      memcpy(buf,frame.buf,frame.len);
+    if ( (frame=InjectRing->getReadRef())!=0 ) {
+      id=frame->id;
+      len=frame->len;
+      memcpy(buf,frame->buf,frame->len);
+      LastRxFrameTime=frame->time;
+      InjectRing->commitRead();
+      return true;
     }
 
-    return HasFrame;
+    return false;
+}
+
+//*****************************************************************************
+bool tNMEA2000_esp32::InjectRxFrame(unsigned long id, unsigned char len, const unsigned char *buf) {
+  tCANFrame frame;
+
+    if ( InjectRing==NULL ) return false;
+
+    frame.id=id;
+    frame.len=len>8?8:len;
+    memcpy(frame.buf,buf,frame.len);
+    frame.time=(uint32_t)esp_timer_get_time();
+
+    if ( !InjectRing->add(frame) ) return false;
+    if ( RxNotifyTask!=NULL ) xTaskNotifyGive(RxNotifyTask);
+
+    return true;
+}
+
+//*****************************************************************************
+void tNMEA2000_esp32::SetRxFilterBypass(bool Bypass) {
+  if ( !RxFilterEnabled ) return;
+
+  portENTER_CRITICAL(&TxMux);
+  RxFilterBypassWanted=Bypass;
+  if ( !IsOpen ) {
+    RxFilterBypass=Bypass;
+  } else if ( RxFilterBypass!=Bypass && MODULE_CAN->SR.B.TBS==1 ) { // nothing being sent, otherwise interrupt switches when ring is empty
+    CAN_apply_rx_filter_bypass();
+  }
+  portEXIT_CRITICAL(&TxMux);
+}
+
+//*****************************************************************************
+void tNMEA2000_esp32::CAN_apply_rx_filter_bypass() {
+  tCANFrame frame;
+
+  // Acceptance registers can be written only in reset mode, which would abort a frame being sent, so this is
+  // only called with transmit buffer free. Frames on the bus meanwhile are missed.
+  RxFilterBypass=RxFilterBypassWanted;
+  MODULE_CAN->MOD.B.RM = 1;
+  CAN_set_acceptance();
+  MODULE_CAN->MOD.B.RM = 0;
+
+  // No transmit complete interrupt follows, so start sending what is in the ring
+  if ( TxRing->read(frame) ) {
+    CAN_send_frame(frame);
+  }
+}
+
+//*****************************************************************************
+void tNMEA2000_esp32::CAN_set_acceptance() {
+  for ( int i=0; i<4; i++ ) {
+    MODULE_CAN->MBX_CTRL.ACC.CODE[i] = ( RxFilterBypass ? 0x00 : RxFilter.GetAcceptance().Code[i] );
+    MODULE_CAN->MBX_CTRL.ACC.MASK[i] = ( RxFilterBypass ? 0xff : RxFilter.GetAcceptance().Mask[i] );
+  }
+}
+
+//*****************************************************************************
+uint16_t tNMEA2000_esp32::GetRxPendingFrames() const {
+  if ( RxRing==NULL ) return 0;
+
+  return RxRing->count()+InjectRing->count();
+}
+
+//*****************************************************************************
+void tNMEA2000_esp32::RecordRxLatency() {
+  uint32_t Latency=(uint32_t)esp_timer_get_time()-LastRxFrameTime;
+  int Bucket=0;
+
+  for (; Latency>1 && Bucket<RxLatencyBuckets-1; Latency>>=1, Bucket++);
+  RxLatencyHistogram[Bucket]++;
 }
 
 //*****************************************************************************
@@ -172,15 +270,12 @@ void tNMEA2000_esp32::CAN_init() {
     //enable all interrupts
     MODULE_CAN->IER.U = 0xef;  // bit 0x10 contains Baud Rate Prescaler Divider (BRP_DIV) bit
 
-    //no acceptance filtering, as we want to fetch all messages
-    MODULE_CAN->MBX_CTRL.ACC.CODE[0] = 0;
-    MODULE_CAN->MBX_CTRL.ACC.CODE[1] = 0;
-    MODULE_CAN->MBX_CTRL.ACC.CODE[2] = 0;
-    MODULE_CAN->MBX_CTRL.ACC.CODE[3] = 0;
-    MODULE_CAN->MBX_CTRL.ACC.MASK[0] = 0xff;
-    MODULE_CAN->MBX_CTRL.ACC.MASK[1] = 0xff;
-    MODULE_CAN->MBX_CTRL.ACC.MASK[2] = 0xff;
-    MODULE_CAN->MBX_CTRL.ACC.MASK[3] = 0xff;
+    //acceptance filtering from receive PGN list or none, if we want to fetch all messages
+    RxFilter.Clear();
+    if ( RxFilterEnabled ) AddReceiveFilterPGNs(RxFilter);
+    RxFilter.Update();
+    MODULE_CAN->MOD.B.AFM = 0; // dual filter, both compare id bits 28..13 of extended frames
+    CAN_set_acceptance();
 
     //set to normal mode
     MODULE_CAN->OCR.B.OCMODE=__CAN_OC_NOM;
@@ -212,27 +307,48 @@ void tNMEA2000_esp32::CAN_init() {
 void tNMEA2000_esp32::CAN_read_frame() {
 	tCANFrame frame;
   CAN_FIR_t FIR;
-
-	//get FIR
-	FIR.U=MODULE_CAN->MBX_CTRL.FCTRL.FIR.U;
-  frame.len=FIR.B.DLC>8?8:FIR.B.DLC;
-
-  // Handle only extended frames
-  if (FIR.B.FF==CAN_frame_ext) {  //extended frame
-    //Get Message ID
-    frame.id = _CAN_GET_EXT_ID;
-
-    //deep copy data bytes
-    for( size_t i=0; i<frame.len; i++ ) {
-      frame.buf[i]=MODULE_CAN->MBX_CTRL.FCTRL.TX_RX.EXT.data[i];
+  bool Received=false;
+
+  // Empty the whole receive FIFO, more frames may have arrived since the interrupt was raised
+  while ( MODULE_CAN->SR.B.RBS==1 ) {
+  	//get FIR
+  	FIR.U=MODULE_CAN->MBX_CTRL.FCTRL.FIR.U;
+    frame.len=FIR.B.DLC>8?8:FIR.B.DLC;
+
+    // Handle only extended frames
+    if (FIR.B.FF==CAN_frame_ext) {  //extended frame
+      //Get Message ID
+      frame.id = _CAN_GET_EXT_ID;
+
+      //controller filter is coarse, drop what it let through but we do not want
+      if ( RxFilterBypass || RxFilter.IsAccepted(frame.id) ) {
+        RxAccepted++;
+
+        //deep copy data bytes
+        for( size_t i=0; i<frame.len; i++ ) {
+          frame.buf[i]=MODULE_CAN->MBX_CTRL.FCTRL.TX_RX.EXT.data[i];
+        }
+
+        if ( RxFrameHook!=0 ) RxFrameHook(frame.id,frame.len,frame.buf);
+
+        //send frame to receive ring, ring counts it as overrun if full
+        frame.time=(uint32_t)esp_timer_get_time();
+        Received|=RxRing->add(frame);
+      } else {
+        RxRejected++;
+      }
     }
 
-    //send frame to input queue
-    xQueueSendToBackFromISR(RxQueue,&frame,0);
+    //Let the hardware know the frame has been read.
+    MODULE_CAN->CMR.B.RRB=1;
   }
 
-  //Let the hardware know the frame has been read.
-  MODULE_CAN->CMR.B.RRB=1;
+  //wake up task handling frames once for all frames read
+  if ( Received && RxNotifyTask!=NULL ) {
+    BaseType_t HigherPriorityTaskWoken=pdFALSE;
+    vTaskNotifyGiveFromISR(RxNotifyTask,&HigherPriorityTaskWoken);
+    if ( HigherPriorityTaskWoken ) portYIELD_FROM_ISR();
+  }
 }
 
 //*****************************************************************************
@@ -269,9 +385,15 @@ void tNMEA2000_esp32::InterruptHandler() {
     // Handle TX complete interrupt
     if ((interrupt & __CAN_IRQ_TX) != 0) {
       tCANFrame frame;
-      if ( (xQueueReceiveFromISR(TxQueue,&frame,NULL)==pdTRUE) ) {
-        CAN_send_frame(frame);
+      portENTER_CRITICAL_ISR(&TxMux);
+      if ( MODULE_CAN->SR.B.TBS==1 ) { // a task may have started the next frame already
+        if ( TxRing->read(frame) ) {
+          CAN_send_frame(frame);
+        } else if ( RxFilterBypass!=RxFilterBypassWanted ) {
+          CAN_apply_rx_filter_bypass();
+        }
       }
+      portEXIT_CRITICAL_ISR(&TxMux);
     }
 
     // Handle RX frame available interrupt
@@ -279,6 +401,12 @@ void tNMEA2000_esp32::InterruptHandler() {
     	CAN_read_frame();
     }
 
+    // Controller FIFO overflowed, frames have been lost before we could read them
+    if ((interrupt & __CAN_IRQ_DATA_OVERRUN) != 0) {
+      RxHardwareOverruns++;
+      MODULE_CAN->CMR.B.CDO=1;
+    }
+
     // Handle error interrupts.
     if ((interrupt & (__CAN_IRQ_ERR						//0x4
                       | __CAN_IRQ_DATA_OVERRUN			//0x8
@@ -85,6 +85,22 @@ uint16_t tRingBuffer<T>::count() {
     return (uint16_t)entries;
 }
 
+// *****************************************************************************
+template<typename T>
+T *tRingBuffer<T>::getAddRef() {
+  uint16_t nextEntry = (head + 1) % size;
+
+  // Check if the ring buffer is full
+  if ( nextEntry == tail ) return 0;
+
+  T *ret=&(buffer[head]);
+
+  // Bump the head to point to the next free entry
+  head = nextEntry;
+
+  return ret;
+}
+
 // *****************************************************************************
 template<typename T>
 bool tRingBuffer<T>::add(const T &val) {
@@ -117,16 +133,131 @@ bool tRingBuffer<T>::read(T &val) {
   return (true);
 }
 
+// *****************************************************************************
+template<typename T>
+const T *tRingBuffer<T>::getReadRef() {
+  // Check if the ring buffer has data available
+  if ( isEmpty() ) return 0;
+
+  const T *ret=&(buffer[tail]);
+
+  // Bump the tail pointer
+  tail = (tail + 1) % size;
+
+  return ret;
+}
+
+//==============================================================================
+// class tSPSCRingBuffer
+
+// *****************************************************************************
+template<typename T>
+tSPSCRingBuffer<T>::tSPSCRingBuffer(uint16_t _size) : head(0), tail(0), size(_size), overruns(0), highWater(0) {
+  if ( size<3 ) size=3;
+  buffer=new T[size];
+}
+
+// *****************************************************************************
+template<typename T>
+tSPSCRingBuffer<T>::~tSPSCRingBuffer() {
+  delete[] buffer;
+}
+
+// *****************************************************************************
+template<typename T>
+bool tSPSCRingBuffer<T>::isEmpty() const {
+  return __atomic_load_n(&head,__ATOMIC_ACQUIRE)==__atomic_load_n(&tail,__ATOMIC_ACQUIRE);
+}
+
+// *****************************************************************************
+template<typename T>
+uint16_t tSPSCRingBuffer<T>::count() const {
+  int32_t entries = (int32_t)__atomic_load_n(&head,__ATOMIC_ACQUIRE) - (int32_t)__atomic_load_n(&tail,__ATOMIC_ACQUIRE);
+
+  if ( entries < 0 ) entries += size;
+
+  return (uint16_t)entries;
+}
+
+// *****************************************************************************
+template<typename T>
+T *tSPSCRingBuffer<T>::getAddRef() {
+  uint16_t h=head;
+
+  // Full, when one item is left free as in tRingBuffer
+  if ( next(h)==__atomic_load_n(&tail,__ATOMIC_ACQUIRE) ) {
+    overruns++;
+    return 0;
+  }
+
+  return &(buffer[h]);
+}
+
+// *****************************************************************************
+template<typename T>
+void tSPSCRingBuffer<T>::commitAdd() {
+  uint16_t h=next(head);
+
+  // Item must be written before consumer sees new head
+  __atomic_store_n(&head,h,__ATOMIC_RELEASE);
+
+  int32_t entries = (int32_t)h - (int32_t)__atomic_load_n(&tail,__ATOMIC_ACQUIRE);
+  if ( entries < 0 ) entries += size;
+  if ( (uint16_t)entries > highWater ) highWater=(uint16_t)entries;
+}
+
+// *****************************************************************************
+template<typename T>
+bool tSPSCRingBuffer<T>::add(const T &val) {
+  T *ref=getAddRef();
+
+  if ( ref==0 ) return false;
+  memcpy((void *)ref, (const void *)&val, sizeof (T));
+  commitAdd();
+
+  return true;
+}
+
+// *****************************************************************************
+template<typename T>
+const T *tSPSCRingBuffer<T>::getReadRef() {
+  uint16_t t=tail;
+
+  if ( t==__atomic_load_n(&head,__ATOMIC_ACQUIRE) ) return 0;
+
+  return &(buffer[t]);
+}
+
+// *****************************************************************************
+template<typename T>
+void tSPSCRingBuffer<T>::commitRead() {
+  // Item must be copied before producer can reuse it
+  __atomic_store_n(&tail,next(tail),__ATOMIC_RELEASE);
+}
+
+// *****************************************************************************
+template<typename T>
+bool tSPSCRingBuffer<T>::read(T &val) {
+  const T *ref=getReadRef();
+
+  if ( ref==0 ) return false;
+  memcpy((void *)&val, (const void *)ref, sizeof (T));
+  commitRead();
+
+  return true;
+}
+
 //==============================================================================
 // class tPriorityRingBuffer
 
 // *****************************************************************************
 template<typename T>
 tPriorityRingBuffer<T>::tPriorityRingBuffer(uint16_t _size, uint8_t _maxPriorities) : 
-    head(0), tail(0), size(_size), maxPriorities(_maxPriorities) {
+    head(0), tail(0), size(_size), items(0), maxPriorities(_maxPriorities) {
   if ( size<3 ) size=3;
   if ( maxPriorities<1 ) maxPriorities=1;
   buffer=new tValueSlot[size];
+  for ( uint16_t i=0; i<size; i++ ) buffer[i].used=false;
   priorityReferencies=new tPriorityRef[maxPriorities];
   RingBufferDbgf("tPriorityRingBuffer<T>::tPriorityRingBuffer, ring buffer initialized size:%u, priorities:%u\n",size,maxPriorities);
 }
@@ -134,8 +265,8 @@ tPriorityRingBuffer<T>::tPriorityRingBuffer(uint16_t _size, uint8_t _maxPrioriti
 // *****************************************************************************
 template<typename T>
 tPriorityRingBuffer<T>::~tPriorityRingBuffer() {
-  delete buffer;
-  delete priorityReferencies;
+  delete[] buffer;
+  delete[] priorityReferencies;
 }
 
 // *****************************************************************************
@@ -151,7 +282,8 @@ bool tPriorityRingBuffer<T>::isEmpty(uint8_t _priority) const {
 // *****************************************************************************
 template<typename T>
 void tPriorityRingBuffer<T>::clear() {
-  head=tail=0;
+  head=tail=items=0;
+  for ( uint16_t i=0; i<size; i++ ) buffer[i].used=false;
   for ( uint16_t i=0; i<maxPriorities; i++ ) priorityReferencies[i].clear();
 }
 
@@ -206,6 +338,8 @@ T *tPriorityRingBuffer<T>::getAddRef(uint8_t _priority) {
   ret=&(buffer[head].Value);
   buffer[head].priority=_priority;
   buffer[head].next=INVALID_RING_REF;
+  buffer[head].used=true;
+  items++;
   if ( priorityReferencies[_priority].next==INVALID_RING_REF ) {
     priorityReferencies[_priority].next=head;
   } else {
@@ -239,11 +373,13 @@ const T *tPriorityRingBuffer<T>::getReadRef(uint8_t _priority) {
   if ( priorityReferencies[_priority].next==INVALID_RING_REF ) {
     priorityReferencies[_priority].last=INVALID_RING_REF;
   }
-  // Update tail, if we are removing first
+  buffer[ref].next=INVALID_RING_REF;
+  buffer[ref].used=false; // Release slot
+  items--;
+  // Update tail, if we are removing first. Last item of a priority has no next, so slot use is checked with used.
   if ( ref==tail ) {
-    for ( tail = (tail + 1) % size; tail!=head && buffer[tail].next==INVALID_RING_REF; tail = (tail + 1) % size );
+    for ( tail = (tail + 1) % size; tail!=head && !buffer[tail].used; tail = (tail + 1) % size );
   }
-  buffer[ref].next=INVALID_RING_REF; // Release slot
 
   RingBufferDbgf("tPriorityRingBuffer<T>::getReadRef, read item ref:%u, priority:%u, tail:%u\n",ref,_priority,tail);
 
@@ -262,3 +398,16 @@ const T *tPriorityRingBuffer<T>::getReadRef(uint8_t *_priority) {
 
   return 0;
 }
+
+// *****************************************************************************
+template<typename T>
+const T *tPriorityRingBuffer<T>::peekReadRef(uint8_t *_priority) const {
+  for ( uint8_t _pri=0; _pri<maxPriorities; _pri++ ) {
+    if ( priorityReferencies[_pri].next!=INVALID_RING_REF ) {
+      if ( _priority!=0 ) *_priority=_pri;
+      return &(buffer[priorityReferencies[_pri].next].Value);
+    }
+  }
+
+  return 0;
+}
@@ -21,7 +21,16 @@ CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFT
 OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
-This is class for reading Actisense format messages from given stream.
+This is class for reading Actisense format messages from given stream or
+from blocks of received data.
+
+Messages are framed as <DLE><STX>..<DLE><ETX> with DLE in the message doubled.
+ParseBlock runs the framing state machine over a whole block in one loop and
+stops at the end of each complete message, so the caller can hold the rest of
+the block while e.g. the message waits for room to be sent. Messages with bad
+length or checksum are counted and dropped, and the reader finds the next
+<DLE><STX> on its own. Message types other than N2k data and N2k request are
+ignored.
 
 There is unresolved problem to use programming port with reading data.
 Read works fine for a while, but then stops. With e.g. Arduino Due
@@ -37,14 +46,19 @@ class tActisenseReader
 {
 protected:
     #define MAX_STREAM_MSG_BUF_LEN 300
-    bool StartOfTextReceived;
-    bool MsgIsComing;
-    bool EscapeReceived;
-    int byteSum;
+    enum tState {
+      rs_Idle,          // waiting for DLE
+      rs_Escape,        // DLE received outside message, waiting for STX
+      rs_Message,       // in message
+      rs_MessageEscape  // DLE received in message
+    };
+    tState State;
+    uint8_t ByteSum;    // sum of message bytes so far, with CRC 0 for valid message
     // Buffer for incoming messages from stream
     unsigned char MsgBuf[MAX_STREAM_MSG_BUF_LEN];
     int MsgWritePos;
     unsigned char DefaultSource;
+    uint32_t BadMessages;
 
 protected:
     N2kStream* ReadStream;
@@ -52,8 +66,6 @@ protected:
     void (*MsgHandler)(const tN2kMsg &N2kMsg);
 
 protected:
-    bool AddByteToBuffer(char NewByte);
-    void ClearBuffer();
     bool CheckMessage(tN2kMsg &N2kMsg);
 
 public:
@@ -65,8 +77,12 @@ public:
     // If you use application, which sends data by using Actisense data request type, source
     // set by this function will be set as source. Default=65;
     void SetDefaultSource(unsigned char source) { DefaultSource=source; }
-    
-    // You can either call this or ParseMessages periodically.
+
+    // Drops message in progress.
+    void ClearBuffer();
+
+    // You can either call this or ParseMessages periodically. N2kStream has no peek, so
+    // bytes are always read out and ReadOut is kept only for compatibility.
     bool GetMessageFromStream(tN2kMsg &N2kMsg, bool ReadOut=true);
 
     bool IsStart(char ch);
@@ -75,7 +91,15 @@ public:
     // Set message handler to be used in ParseMessages, when message has been received.
     void SetMsgHandler(void (*_MsgHandler)(const tN2kMsg &N2kMsg)) { MsgHandler=_MsgHandler; }
 
-    bool Handling() const { return MsgIsComing || EscapeReceived || StartOfTextReceived; }
+    // Parses Data until its end or until a complete message. Returns bytes used. If MsgReady
+    // is set, N2kMsg holds the message and the rest of Data should be given on next call.
+    size_t ParseBlock(const unsigned char *Data, size_t Len, tN2kMsg &N2kMsg, bool &MsgReady);
+    // Parses whole Data and calls message handler for each message.
+    void ParseBlock(const unsigned char *Data, size_t Len);
+
+    bool Handling() const { return State!=rs_Idle; }
+    // Messages dropped for bad length or checksum or for not fitting to buffer.
+    uint32_t GetBadMessages() const { return BadMessages; }
 };
 
 #endif
@@ -0,0 +1,119 @@
+/*
+N2kBusStats.h
+
+Copyright (c) 2022 John Blaiklock, BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Bus traffic statistics, attached to tNMEA2000 as message handler for all PGNs.
+
+Frames and bytes are counted per source address and for the first MaxPGNs
+PGNs seen. Frames of a message are worked out from its length as the library
+sends them, single frame up to 8 bytes and fast packet above that. Bus load is
+the nominal bits of those frames, 67 bits and 8 per data byte without stuff
+bits, over the last full second and over the last LongWindow seconds.
+
+The handler sees only messages the node receives. With a receive filter the
+frames it drops can be added with AddDroppedFrames, which counts them as 8 byte
+frames for bus load only. Controller error counters are given with
+SetErrorCounters, the highest values since Clear are kept.
+
+Nothing here locks. Update, HandleMsg and the setters should be called from
+the task that runs ParseMessages, and readers in other tasks should take a copy.
+*/
+
+#ifndef _tN2kBusStats_H_
+#define _tN2kBusStats_H_
+
+#include <stdint.h>
+#include "NMEA2000.h"
+
+class tN2kBusStats : public tNMEA2000::tMsgHandler
+{
+public:
+  static const uint16_t Sources=254; // 0-251 devices, 252-253 reserved. 254 is null address.
+  static const uint8_t MaxPGNs=32;
+  static const uint8_t LongWindow=60; // s
+
+  struct tCounter {
+    uint32_t Frames;
+    uint32_t Bytes;
+  };
+
+  struct tPGNCounter {
+    unsigned long PGN;
+    tCounter Count;
+  };
+
+protected:
+  tCounter SourceCounters[Sources];
+  tPGNCounter PGNCounters[MaxPGNs];
+  uint8_t PGNCount;
+  uint32_t PGNOverflow; // messages of PGNs not in table
+  uint32_t Messages;
+  uint32_t Frames;
+  uint32_t BitRate;
+  unsigned long SecondStart; // ms
+  uint32_t SecondBits;       // bits in second in progress
+  uint32_t LastSecondBits;
+  uint32_t LastSecondFrames;
+  uint32_t SecondFrames;
+  uint32_t WindowBits[LongWindow];
+  uint32_t WindowSum;
+  uint8_t WindowIndex;
+  uint8_t WindowFilled;
+  uint8_t TxErrors;
+  uint8_t RxErrors;
+  uint8_t MaxTxErrors;
+  uint8_t MaxRxErrors;
+
+  static uint32_t FrameBits(uint8_t Len) { return 67+8*(uint32_t)Len; }
+  void AddBits(uint32_t Bits, uint32_t _Frames);
+  void HandleMsg(const tN2kMsg &N2kMsg);
+
+public:
+  tN2kBusStats(tNMEA2000 *_pNMEA2000=0, uint32_t _BitRate=250000);
+
+  void Clear();
+  // Closes seconds that have passed by Now (ms). Call at least every second or two.
+  void Update(unsigned long Now);
+  // Frames dropped by receive filter since last call, counted for bus load only.
+  void AddDroppedFrames(uint32_t Count);
+  void SetErrorCounters(uint8_t Tx, uint8_t Rx);
+
+  // Bus load in percent over the last full second and over up to LongWindow last seconds.
+  float GetLoad() const { return (float)LastSecondBits*100.0f/(float)BitRate; }
+  float GetLongLoad() const { return ( WindowFilled>0 ? (float)WindowSum*100.0f/((float)BitRate*WindowFilled) : 0.0f ); }
+  uint32_t GetLastSecondFrames() const { return LastSecondFrames; }
+  uint32_t GetMessages() const { return Messages; }
+  uint32_t GetFrames() const { return Frames; }
+  uint8_t GetTxErrors() const { return TxErrors; }
+  uint8_t GetRxErrors() const { return RxErrors; }
+  uint8_t GetMaxTxErrors() const { return MaxTxErrors; }
+  uint8_t GetMaxRxErrors() const { return MaxRxErrors; }
+
+  const tCounter *GetSourceCounter(uint8_t Source) const { return ( Source<Sources ? &SourceCounters[Source] : 0 ); }
+  // Number of sources that have sent anything and the one that has sent most frames, 0xff if none.
+  uint8_t GetActiveSources() const;
+  uint8_t GetBusiestSource() const;
+  uint8_t GetPGNCount() const { return PGNCount; }
+  const tPGNCounter *GetPGNCounter(uint8_t Index) const { return ( Index<PGNCount ? &PGNCounters[Index] : 0 ); }
+  uint32_t GetPGNOverflow() const { return PGNOverflow; }
+};
+
+#endif
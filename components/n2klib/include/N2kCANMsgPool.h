@@ -0,0 +1,121 @@
+/*
+N2kCANMsgPool.h
+
+Copyright (c) 2022 John Blaiklock, BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Slots for fast packet and ISO multi packet messages under reception.
+
+A slot is found by key (PGN, source, tag) through a small hash table, so the
+cost of handling a frame does not depend on how many messages are in flight.
+The tag is the fast packet sequence counter or, for ISO transport, the
+destination. Data is kept in two pools: small slots hold a fast packet first
+frame and six following frames, large slots hold tN2kMsg::MaxDataLen bytes.
+Slots in use are also kept in a list in order of last received frame, so timed
+out messages are found from the head of the list.
+*/
+
+#ifndef _tN2kCANMsgPool_H_
+#define _tN2kCANMsgPool_H_
+
+#include "N2kMsg.h"
+
+class tN2kCANMsgPool
+{
+public:
+  static const unsigned char SmallDataLen=48; // Fast packet first frame (6 bytes) and 6 following frames (7 bytes)
+  static const uint8_t NoSlot=0xff;
+
+  class tSlot
+  {
+  public:
+    unsigned long KeyPGN;
+    unsigned long PGN;
+    unsigned long LastTime; // millis() of last received frame
+    unsigned char *Data;
+    unsigned char MaxDataLen;
+    unsigned char Priority;
+    unsigned char Source;
+    unsigned char Destination;
+    unsigned char Tag;
+    unsigned char DataLen;
+    unsigned char CopiedLen;
+    unsigned char LastFrame; // Last received frame sequence number on fast packets or multi packet
+    bool KnownMessage;
+    bool SystemMessage;
+#if !defined(N2K_NO_ISO_MULTI_PACKET_SUPPORT)
+    bool TPMessage;
+    unsigned char TPRequireCTS; // =0 no, n=after each n frames
+    unsigned char TPMaxPackets;
+#endif
+    uint8_t HashNext;
+    uint8_t AgePrev;
+    uint8_t AgeNext;
+    bool Used;
+
+  public:
+    void CopyData(unsigned char start, unsigned char len, const unsigned char *buf) {
+      for (int j=start; j<len && CopiedLen<MaxDataLen; j++, CopiedLen++) Data[CopiedLen]=buf[j];
+    }
+    bool IsComplete() const { return CopiedLen>=DataLen; }
+  };
+
+protected:
+  tSlot *Slots;
+  unsigned char *DataBuf;
+  uint8_t *HashHeads;
+  uint8_t HashMask;
+  uint8_t SmallSlots;
+  uint8_t LargeSlots;
+  uint8_t FreeSmall;
+  uint8_t FreeLarge;
+  uint8_t AgeHead;
+  uint8_t AgeTail;
+  uint8_t UsedCount;
+
+  uint8_t Hash(unsigned long KeyPGN, unsigned char Source, unsigned char Tag) const {
+    return (uint8_t)((KeyPGN ^ (KeyPGN>>8) ^ ((unsigned long)Source*31) ^ ((unsigned long)Tag*7)) & HashMask);
+  }
+  uint8_t IndexOf(const tSlot *Slot) const { return (uint8_t)(Slot-Slots); }
+  void Unlink(uint8_t Index);
+
+public:
+  tN2kCANMsgPool();
+  ~tN2kCANMsgPool();
+
+  // Allocates the pools. Can be called only once, returns false if allocation failed. At most 128 slots are
+  // allocated, large slots are kept first and small slots cut to fit.
+  bool Init(uint8_t _SmallSlots, uint8_t _LargeSlots);
+  bool IsInitialized() const { return Slots!=0; }
+  uint8_t GetSmallSlots() const { return SmallSlots; }
+  uint8_t GetLargeSlots() const { return LargeSlots; }
+  uint8_t GetUsedCount() const { return UsedCount; }
+
+  tSlot *Find(unsigned long KeyPGN, unsigned char Source, unsigned char Tag);
+  // Returns slot with room for DataLen bytes or 0, if there is none. Small messages
+  // use a large slot, when small slots are all in use.
+  tSlot *Alloc(unsigned long KeyPGN, unsigned char Source, unsigned char Tag, uint16_t DataLen, unsigned long Now);
+  void Free(tSlot *Slot);
+  // Moves slot to the end of age list after a frame has been added to it.
+  void Touch(tSlot *Slot, unsigned long Now);
+  // Returns oldest slot, if it has not received frames for Timeout ms, otherwise 0.
+  tSlot *GetExpired(unsigned long Now, unsigned long Timeout);
+};
+
+#endif
@@ -0,0 +1,125 @@
+/*
+N2kGateway.h
+
+Copyright (c) 2022 John Blaiklock, BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+Raw NMEA2000 gateway. Received messages are written to a byte stream, such as
+Bluetooth SPP, in one of the common formats PC software reads:
+
+  Actisense  NGT-1 binary, as tN2kMsg::SendInActisenseFormat makes it
+  Seasmart   $PCDIN sentences, see Seasmart.h
+  YD RAW     Yacht Devices text, one line per CAN frame, e.g.
+             "17:33:21.107 R 19F51323 01 02 03 04 05 06 07 08"
+
+Messages are packed to a buffer of up to MTU bytes and written with one call
+when the next one would not fit or on Flush. The write function must not
+block. If it takes nothing, the packed messages are dropped and counted, so a
+slow link loses whole messages rather than stalling the NMEA2000 task.
+
+YD RAW has no message level, so messages are split back to frames: single
+frame up to 8 bytes and fast packet above that with sequence counter 0.
+Frame times are MsgTime taken as time of day.
+
+PGN filter: with any include PGN set only those pass, exclude PGNs never pass.
+Nothing here locks, everything is called from the task that runs ParseMessages.
+*/
+
+#ifndef _tN2kGateway_H_
+#define _tN2kGateway_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "NMEA2000.h"
+#include "N2kStream.h"
+
+class tN2kGateway : public tNMEA2000::tMsgHandler, public N2kStream
+{
+public:
+  typedef enum { gwf_Off,
+                 gwf_Actisense,
+                 gwf_Seasmart,
+                 gwf_YDRaw
+               } tFormat;
+  // Returns bytes taken, which is all or 0 if the link is busy. Must not block.
+  typedef size_t (*tWriteFunction)(const uint8_t *data, size_t size);
+
+  static const uint16_t MaxMTU=512;
+  static const uint8_t MaxFilterPGNs=16;
+
+  struct tStatistics {
+    uint32_t Messages;        // messages packed, including those dropped later
+    uint32_t Filtered;        // messages not passing PGN filter
+    uint32_t Writes;          // successful writes
+    uint32_t Bytes;           // bytes the write function took
+    uint32_t DroppedMessages; // messages lost because link was busy
+    uint32_t DroppedBytes;    // bytes the write function did not take
+  };
+
+protected:
+  struct tFilterPGN {
+    unsigned long PGN;
+    bool Exclude;
+  };
+
+  tFormat Format;
+  tWriteFunction WriteFunction;
+  uint16_t MTU;
+  uint8_t Buf[MaxMTU];
+  uint16_t BufLen;
+  uint16_t BufMessages;
+  bool PieceWritten;          // message being handled was written by Append rather than buffered
+  bool PieceDropped;          // ... and the write function did not take all of it
+  tFilterPGN FilterPGNs[MaxFilterPGNs];
+  uint8_t FilterCount;
+  uint8_t IncludeCount;
+  tStatistics Statistics;
+
+  bool IsPassed(unsigned long PGN) const;
+  bool Write(const uint8_t *data, size_t size);
+  void Append(const uint8_t *data, size_t size);
+  void SendInSeasmartFormat(const tN2kMsg &N2kMsg);
+  void SendInYDRawFormat(const tN2kMsg &N2kMsg);
+  void HandleMsg(const tN2kMsg &N2kMsg);
+
+public:
+  tN2kGateway(tNMEA2000 *_pNMEA2000=0, tWriteFunction _WriteFunction=0, uint16_t _MTU=MaxMTU);
+
+  // Changing format drops anything packed in the old one.
+  void SetFormat(tFormat _Format);
+  tFormat GetFormat() const { return Format; }
+  void SetWriteFunction(tWriteFunction _WriteFunction) { WriteFunction=_WriteFunction; }
+  void SetMTU(uint16_t _MTU);
+
+  void ClearFilter() { FilterCount=0; IncludeCount=0; }
+  // Returns false if filter table is full.
+  bool AddFilterPGN(unsigned long PGN, bool Exclude=false);
+
+  // Writes packed messages. Call after each ParseMessages to keep latency down.
+  void Flush();
+
+  const tStatistics &GetStatistics() const { return Statistics; }
+
+  // N2kStream, used by tN2kMsg::SendInActisenseFormat
+  int read() { return -1; }
+  size_t write(const uint8_t* data, size_t size) { Append(data,size); return size; }
+};
+
+#endif
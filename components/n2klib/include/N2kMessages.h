@@ -58,6 +58,16 @@ inline double SecondsToh(double v) { return N2kIsNA(v)?v:v/3600L; }
 inline double msToKnots(double v) { return N2kIsNA(v)?v:v*1.9438444924406047516198704103672L; } // 3600L/1852.0L
 inline double KnotsToms(double v) { return N2kIsNA(v)?v:v*0.51444444444444444444444444444444L; } // 1852L/3600.0L
 
+// Single precision versions for the float overloads of message functions below.
+inline float RadToDeg(float v) { return N2kIsNA(v)?v:v*57.295779513082321f; }
+inline float DegToRad(float v) { return N2kIsNA(v)?v:v*0.017453292519943296f; }
+inline float CToKelvin(float v) { return N2kIsNA(v)?v:v+273.15f; }
+inline float KelvinToC(float v) { return N2kIsNA(v)?v:v-273.15f; }
+inline float mBarToPascal(float v) { return N2kIsNA(v)?v:v*100.0f; }
+inline float PascalTomBar(float v) { return N2kIsNA(v)?v:v*0.01f; }
+inline float msToKnots(float v) { return N2kIsNA(v)?v:v*1.9438444924406048f; }
+inline float KnotsToms(float v) { return N2kIsNA(v)?v:v*0.51444444444444444f; }
+
 //*****************************************************************************
 // System date/time
 // Input:
@@ -361,6 +371,21 @@ inline bool ParseN2kHeading(const tN2kMsg &N2kMsg, unsigned char &SID, double &H
   return ParseN2kPGN127250(N2kMsg,SID,Heading,Deviation,Variation,ref);
 }
 
+// Float and fixed point versions. Fixed point angles are in 0.0001 radians.
+void SetN2kPGN127250(tN2kMsg &N2kMsg, unsigned char SID, float Heading, float Deviation, float Variation, tN2kHeadingReference ref);
+void SetN2kPGN127250(tN2kMsg &N2kMsg, unsigned char SID, uint32_t Heading, int32_t Deviation, int32_t Variation, tN2kHeadingReference ref);
+inline void SetN2kTrueHeading(tN2kMsg &N2kMsg, unsigned char SID, float Heading) {
+  SetN2kPGN127250(N2kMsg,SID,Heading,N2kFloatNA,N2kFloatNA,N2khr_true);
+}
+bool ParseN2kPGN127250(const tN2kMsg &N2kMsg, unsigned char &SID, float &Heading, float &Deviation, float &Variation, tN2kHeadingReference &ref);
+bool ParseN2kPGN127250(const tN2kMsg &N2kMsg, unsigned char &SID, uint32_t &Heading, int32_t &Deviation, int32_t &Variation, tN2kHeadingReference &ref);
+inline bool ParseN2kHeading(const tN2kMsg &N2kMsg, unsigned char &SID, float &Heading, float &Deviation, float &Variation, tN2kHeadingReference &ref) {
+  return ParseN2kPGN127250(N2kMsg,SID,Heading,Deviation,Variation,ref);
+}
+inline bool ParseN2kHeading(const tN2kMsg &N2kMsg, unsigned char &SID, uint32_t &Heading, int32_t &Deviation, int32_t &Variation, tN2kHeadingReference &ref) {
+  return ParseN2kPGN127250(N2kMsg,SID,Heading,Deviation,Variation,ref);
+}
+
 //*****************************************************************************
 // Rate of Turn
 // Input:
@@ -927,6 +952,18 @@ inline bool ParseN2kBoatSpeed(const tN2kMsg &N2kMsg, unsigned char &SID, double
   return ParseN2kPGN128259(N2kMsg, SID, WaterReferenced, GroundReferenced, SWRT);
 }
 
+// Float and fixed point versions. Fixed point speeds are in 0.01 m/s.
+void SetN2kPGN128259(tN2kMsg &N2kMsg, unsigned char SID, float WaterReferenced, float GroundReferenced=N2kFloatNA, tN2kSpeedWaterReferenceType SWRT=N2kSWRT_Paddle_wheel);
+void SetN2kPGN128259(tN2kMsg &N2kMsg, unsigned char SID, uint32_t WaterReferenced, uint32_t GroundReferenced=N2kUInt32NA, tN2kSpeedWaterReferenceType SWRT=N2kSWRT_Paddle_wheel);
+bool ParseN2kPGN128259(const tN2kMsg &N2kMsg, unsigned char &SID, float &WaterReferenced, float &GroundReferenced, tN2kSpeedWaterReferenceType &SWRT);
+bool ParseN2kPGN128259(const tN2kMsg &N2kMsg, unsigned char &SID, uint32_t &WaterReferenced, uint32_t &GroundReferenced, tN2kSpeedWaterReferenceType &SWRT);
+inline bool ParseN2kBoatSpeed(const tN2kMsg &N2kMsg, unsigned char &SID, float &WaterReferenced, float &GroundReferenced, tN2kSpeedWaterReferenceType &SWRT) {
+  return ParseN2kPGN128259(N2kMsg, SID, WaterReferenced, GroundReferenced, SWRT);
+}
+inline bool ParseN2kBoatSpeed(const tN2kMsg &N2kMsg, unsigned char &SID, uint32_t &WaterReferenced, uint32_t &GroundReferenced, tN2kSpeedWaterReferenceType &SWRT) {
+  return ParseN2kPGN128259(N2kMsg, SID, WaterReferenced, GroundReferenced, SWRT);
+}
+
 //*****************************************************************************
 // Water depth
 // Input:
@@ -954,6 +991,20 @@ inline bool ParseN2kWaterDepth(const tN2kMsg &N2kMsg, unsigned char &SID, double
   return ParseN2kPGN128267(N2kMsg, SID, DepthBelowTransducer, Offset, Range);
 }
 
+// Float and fixed point versions. Fixed point depth is in 0.01 m, offset in 0.001 m and range in 10 m.
+void SetN2kPGN128267(tN2kMsg &N2kMsg, unsigned char SID, float DepthBelowTransducer, float Offset, float Range=N2kFloatNA);
+void SetN2kPGN128267(tN2kMsg &N2kMsg, unsigned char SID, uint32_t DepthBelowTransducer, int32_t Offset, uint32_t Range=N2kUInt32NA);
+bool ParseN2kPGN128267(const tN2kMsg &N2kMsg, unsigned char &SID, float &DepthBelowTransducer, float &Offset, float &Range);
+bool ParseN2kPGN128267(const tN2kMsg &N2kMsg, unsigned char &SID, uint32_t &DepthBelowTransducer, int32_t &Offset, uint32_t &Range);
+inline bool ParseN2kWaterDepth(const tN2kMsg &N2kMsg, unsigned char &SID, float &DepthBelowTransducer, float &Offset) {
+  float Range;
+  return ParseN2kPGN128267(N2kMsg, SID, DepthBelowTransducer, Offset, Range);
+}
+inline bool ParseN2kWaterDepth(const tN2kMsg &N2kMsg, unsigned char &SID, uint32_t &DepthBelowTransducer, int32_t &Offset) {
+  uint32_t Range;
+  return ParseN2kPGN128267(N2kMsg, SID, DepthBelowTransducer, Offset, Range);
+}
+
 //*****************************************************************************
 // Distance log
 // Input:
@@ -975,6 +1026,19 @@ inline bool ParseN2kDistanceLog(const tN2kMsg &N2kMsg, uint16_t &DaysSince1970,
   return ParseN2kPGN128275(N2kMsg,DaysSince1970,SecondsSinceMidnight,Log,TripLog);
 }
 
+// Float and fixed point versions. Float time has about 10 ms resolution late in the day, fixed
+// point time is in 0.0001 s. Log and TripLog are N2kUInt32NA when not available.
+void SetN2kPGN128275(tN2kMsg &N2kMsg, uint16_t DaysSince1970, float SecondsSinceMidnight, uint32_t Log, uint32_t TripLog);
+void SetN2kPGN128275(tN2kMsg &N2kMsg, uint16_t DaysSince1970, uint32_t SecondsSinceMidnight, uint32_t Log, uint32_t TripLog);
+bool ParseN2kPGN128275(const tN2kMsg &N2kMsg, uint16_t &DaysSince1970, float &SecondsSinceMidnight, uint32_t &Log, uint32_t &TripLog);
+bool ParseN2kPGN128275(const tN2kMsg &N2kMsg, uint16_t &DaysSince1970, uint32_t &SecondsSinceMidnight, uint32_t &Log, uint32_t &TripLog);
+inline bool ParseN2kDistanceLog(const tN2kMsg &N2kMsg, uint16_t &DaysSince1970, float &SecondsSinceMidnight, uint32_t &Log, uint32_t &TripLog) {
+  return ParseN2kPGN128275(N2kMsg,DaysSince1970,SecondsSinceMidnight,Log,TripLog);
+}
+inline bool ParseN2kDistanceLog(const tN2kMsg &N2kMsg, uint16_t &DaysSince1970, uint32_t &SecondsSinceMidnight, uint32_t &Log, uint32_t &TripLog) {
+  return ParseN2kPGN128275(N2kMsg,DaysSince1970,SecondsSinceMidnight,Log,TripLog);
+}
+
 //*****************************************************************************
 // PGN128776 - Anchor Windlass Control Status
 //
@@ -1109,6 +1173,18 @@ bool ParseN2kPGN129025(const tN2kMsg &N2kMsg, double &Latitude, double &Longitud
 inline bool ParseN2kPositionRapid(const tN2kMsg &N2kMsg, double &Latitude, double &Longitude) {
 	return ParseN2kPGN129025(N2kMsg, Latitude, Longitude);
 }
+
+// Float and fixed point versions. Float position has about 1 m resolution, fixed point is in 1e-7 degrees.
+void SetN2kPGN129025(tN2kMsg &N2kMsg, float Latitude, float Longitude);
+void SetN2kPGN129025(tN2kMsg &N2kMsg, int32_t Latitude, int32_t Longitude);
+bool ParseN2kPGN129025(const tN2kMsg &N2kMsg, float &Latitude, float &Longitude);
+bool ParseN2kPGN129025(const tN2kMsg &N2kMsg, int32_t &Latitude, int32_t &Longitude);
+inline bool ParseN2kPositionRapid(const tN2kMsg &N2kMsg, float &Latitude, float &Longitude) {
+  return ParseN2kPGN129025(N2kMsg, Latitude, Longitude);
+}
+inline bool ParseN2kPositionRapid(const tN2kMsg &N2kMsg, int32_t &Latitude, int32_t &Longitude) {
+  return ParseN2kPGN129025(N2kMsg, Latitude, Longitude);
+}
 //*****************************************************************************
 // COG SOG rapid
 // Input:
@@ -1127,6 +1203,18 @@ inline bool ParseN2kCOGSOGRapid(const tN2kMsg &N2kMsg, unsigned char &SID, tN2kH
   return ParseN2kPGN129026(N2kMsg,SID,ref,COG,SOG);
 }
 
+// Float and fixed point versions. Fixed point COG is in 0.0001 radians and SOG in 0.01 m/s.
+void SetN2kPGN129026(tN2kMsg &N2kMsg, unsigned char SID, tN2kHeadingReference ref, float COG, float SOG);
+void SetN2kPGN129026(tN2kMsg &N2kMsg, unsigned char SID, tN2kHeadingReference ref, uint32_t COG, uint32_t SOG);
+bool ParseN2kPGN129026(const tN2kMsg &N2kMsg, unsigned char &SID, tN2kHeadingReference &ref, float &COG, float &SOG);
+bool ParseN2kPGN129026(const tN2kMsg &N2kMsg, unsigned char &SID, tN2kHeadingReference &ref, uint32_t &COG, uint32_t &SOG);
+inline bool ParseN2kCOGSOGRapid(const tN2kMsg &N2kMsg, unsigned char &SID, tN2kHeadingReference &ref, float &COG, float &SOG) {
+  return ParseN2kPGN129026(N2kMsg,SID,ref,COG,SOG);
+}
+inline bool ParseN2kCOGSOGRapid(const tN2kMsg &N2kMsg, unsigned char &SID, tN2kHeadingReference &ref, uint32_t &COG, uint32_t &SOG) {
+  return ParseN2kPGN129026(N2kMsg,SID,ref,COG,SOG);
+}
+
 //*****************************************************************************
 // GNSS Position Data
 // Input:
@@ -1191,6 +1279,38 @@ inline bool ParseN2kGNSS(const tN2kMsg &N2kMsg, unsigned char &SID, uint16_t &Da
                      );
 }
 
+// Float and fixed point versions, without defaults as the double version has them. Float position
+// has about 1 m resolution. Fixed point time is in 0.0001 s, position in 1e-16 degrees, altitude
+// in 1e-6 m, HDOP, PDOP and geoidal separation in 0.01 m and age of correction in 0.01 s.
+void SetN2kPGN129029(tN2kMsg &N2kMsg, unsigned char SID, uint16_t DaysSince1970, float SecondsSinceMidnight,
+                     float Latitude, float Longitude, float Altitude,
+                     tN2kGNSStype GNSStype, tN2kGNSSmethod GNSSmethod,
+                     unsigned char nSatellites, float HDOP, float PDOP, float GeoidalSeparation,
+                     unsigned char nReferenceStations, tN2kGNSStype ReferenceStationType, uint16_t ReferenceSationID,
+                     float AgeOfCorrection
+                     );
+void SetN2kPGN129029(tN2kMsg &N2kMsg, unsigned char SID, uint16_t DaysSince1970, uint32_t SecondsSinceMidnight,
+                     int64_t Latitude, int64_t Longitude, int64_t Altitude,
+                     tN2kGNSStype GNSStype, tN2kGNSSmethod GNSSmethod,
+                     unsigned char nSatellites, int32_t HDOP, int32_t PDOP, int32_t GeoidalSeparation,
+                     unsigned char nReferenceStations, tN2kGNSStype ReferenceStationType, uint16_t ReferenceSationID,
+                     uint32_t AgeOfCorrection
+                     );
+bool ParseN2kPGN129029(const tN2kMsg &N2kMsg, unsigned char &SID, uint16_t &DaysSince1970, float &SecondsSinceMidnight,
+                     float &Latitude, float &Longitude, float &Altitude,
+                     tN2kGNSStype &GNSStype, tN2kGNSSmethod &GNSSmethod,
+                     unsigned char &nSatellites, float &HDOP, float &PDOP, float &GeoidalSeparation,
+                     unsigned char &nReferenceStations, tN2kGNSStype &ReferenceStationType, uint16_t &ReferenceSationID,
+                     float &AgeOfCorrection
+                     );
+bool ParseN2kPGN129029(const tN2kMsg &N2kMsg, unsigned char &SID, uint16_t &DaysSince1970, uint32_t &SecondsSinceMidnight,
+                     int64_t &Latitude, int64_t &Longitude, int64_t &Altitude,
+                     tN2kGNSStype &GNSStype, tN2kGNSSmethod &GNSSmethod,
+                     unsigned char &nSatellites, int32_t &HDOP, int32_t &PDOP, int32_t &GeoidalSeparation,
+                     unsigned char &nReferenceStations, tN2kGNSStype &ReferenceStationType, uint16_t &ReferenceSationID,
+                     uint32_t &AgeOfCorrection
+                     );
+
 //*****************************************************************************
 // Date,Time & Local offset  ( see also PGN 126992 )
 // Input:
@@ -1713,6 +1833,18 @@ inline bool ParseN2kWindSpeed(const tN2kMsg &N2kMsg, unsigned char &SID, double
   return ParseN2kPGN130306(N2kMsg,SID,WindSpeed,WindAngle,WindReference);
 }
 
+// Float and fixed point versions. Fixed point speed is in 0.01 m/s and angle in 0.0001 radians.
+void SetN2kPGN130306(tN2kMsg &N2kMsg, unsigned char SID, float WindSpeed, float WindAngle, tN2kWindReference WindReference);
+void SetN2kPGN130306(tN2kMsg &N2kMsg, unsigned char SID, uint32_t WindSpeed, uint32_t WindAngle, tN2kWindReference WindReference);
+bool ParseN2kPGN130306(const tN2kMsg &N2kMsg, unsigned char &SID, float &WindSpeed, float &WindAngle, tN2kWindReference &WindReference);
+bool ParseN2kPGN130306(const tN2kMsg &N2kMsg, unsigned char &SID, uint32_t &WindSpeed, uint32_t &WindAngle, tN2kWindReference &WindReference);
+inline bool ParseN2kWindSpeed(const tN2kMsg &N2kMsg, unsigned char &SID, float &WindSpeed, float &WindAngle, tN2kWindReference &WindReference) {
+  return ParseN2kPGN130306(N2kMsg,SID,WindSpeed,WindAngle,WindReference);
+}
+inline bool ParseN2kWindSpeed(const tN2kMsg &N2kMsg, unsigned char &SID, uint32_t &WindSpeed, uint32_t &WindAngle, tN2kWindReference &WindReference) {
+  return ParseN2kPGN130306(N2kMsg,SID,WindSpeed,WindAngle,WindReference);
+}
+
 //*****************************************************************************
 // Outside Environmental parameters
 // Input:
@@ -1737,6 +1869,24 @@ inline bool ParseN2kOutsideEnvironmentalParameters(const tN2kMsg &N2kMsg, unsign
   return ParseN2kPGN130310(N2kMsg, SID,WaterTemperature,OutsideAmbientAirTemperature,AtmosphericPressure);
 }
 
+// Float and fixed point versions. Fixed point temperatures are in 0.01 K and pressure in 100 Pa.
+void SetN2kPGN130310(tN2kMsg &N2kMsg, unsigned char SID, float WaterTemperature,
+                     float OutsideAmbientAirTemperature=N2kFloatNA, float AtmosphericPressure=N2kFloatNA);
+void SetN2kPGN130310(tN2kMsg &N2kMsg, unsigned char SID, uint32_t WaterTemperature,
+                     uint32_t OutsideAmbientAirTemperature=N2kUInt32NA, uint32_t AtmosphericPressure=N2kUInt32NA);
+bool ParseN2kPGN130310(const tN2kMsg &N2kMsg, unsigned char &SID, float &WaterTemperature,
+                     float &OutsideAmbientAirTemperature, float &AtmosphericPressure);
+bool ParseN2kPGN130310(const tN2kMsg &N2kMsg, unsigned char &SID, uint32_t &WaterTemperature,
+                     uint32_t &OutsideAmbientAirTemperature, uint32_t &AtmosphericPressure);
+inline bool ParseN2kOutsideEnvironmentalParameters(const tN2kMsg &N2kMsg, unsigned char &SID, float &WaterTemperature,
+                     float &OutsideAmbientAirTemperature, float &AtmosphericPressure) {
+  return ParseN2kPGN130310(N2kMsg, SID,WaterTemperature,OutsideAmbientAirTemperature,AtmosphericPressure);
+}
+inline bool ParseN2kOutsideEnvironmentalParameters(const tN2kMsg &N2kMsg, unsigned char &SID, uint32_t &WaterTemperature,
+                     uint32_t &OutsideAmbientAirTemperature, uint32_t &AtmosphericPressure) {
+  return ParseN2kPGN130310(N2kMsg, SID,WaterTemperature,OutsideAmbientAirTemperature,AtmosphericPressure);
+}
+
 //*****************************************************************************
 // Environmental parameters
 // Note that in PGN 130311 TempInstance is as TempSource in PGN 130312. I do not know why this
@@ -90,6 +90,25 @@ double GetBuf8ByteDouble(double precision, int &index, const unsigned char *buf,
 double GetBufDouble(int &index, const unsigned char *buf, double def=0);
 float GetBufFloat(int &index, const unsigned char *buf, float def=0);
 
+// Single precision variants of the scaled functions above. Where the FPU has only
+// single precision, like on ESP32, these do not need the soft float double routines.
+void SetBuf8ByteFloat(float v, float precision, int &index, unsigned char *buf);
+void SetBuf4ByteFloat(float v, float precision, int &index, unsigned char *buf);
+void SetBuf4ByteUFloat(float v, float precision, int &index, unsigned char *buf);
+void SetBuf3ByteFloat(float v, float precision, int &index, unsigned char *buf);
+void SetBuf2ByteFloat(float v, float precision, int &index, unsigned char *buf);
+void SetBuf2ByteUFloat(float v, float precision, int &index, unsigned char *buf);
+void SetBuf1ByteFloat(float v, float precision, int &index, unsigned char *buf);
+void SetBuf1ByteUFloat(float v, float precision, int &index, unsigned char *buf);
+float GetBuf1ByteFloat(float precision, int &index, const unsigned char *buf, float def=0);
+float GetBuf1ByteUFloat(float precision, int &index, const unsigned char *buf, float def=-1);
+float GetBuf2ByteFloat(float precision, int &index, const unsigned char *buf, float def=0);
+float GetBuf2ByteUFloat(float precision, int &index, const unsigned char *buf, float def=-1);
+float GetBuf3ByteFloat(float precision, int &index, const unsigned char *buf, float def=0);
+float GetBuf4ByteFloat(float precision, int &index, const unsigned char *buf, float def=0);
+float GetBuf4ByteUFloat(float precision, int &index, const unsigned char *buf, float def=-1);
+float GetBuf8ByteFloat(float precision, int &index, const unsigned char *buf, float def=0);
+
 class tN2kMsg
 {
 public:
@@ -131,6 +150,25 @@ public:
   void Add2ByteDouble(double v, double precision, double UndefVal=N2kDoubleNA);
   void Add1ByteDouble(double v, double precision, double UndefVal=N2kDoubleNA);
   void Add1ByteUDouble(double v, double precision, double UndefVal=N2kDoubleNA);
+  void Add8ByteFloat(float v, float precision, float UndefVal=N2kFloatNA);
+  void Add4ByteFloat(float v, float precision, float UndefVal=N2kFloatNA);
+  void Add4ByteUFloat(float v, float precision, float UndefVal=N2kFloatNA);
+  void Add3ByteFloat(float v, float precision, float UndefVal=N2kFloatNA);
+  void Add2ByteUFloat(float v, float precision, float UndefVal=N2kFloatNA);
+  void Add2ByteFloat(float v, float precision, float UndefVal=N2kFloatNA);
+  void Add1ByteFloat(float v, float precision, float UndefVal=N2kFloatNA);
+  void Add1ByteUFloat(float v, float precision, float UndefVal=N2kFloatNA);
+  // Fixed point values are integers in the resolution of the field, e.g. 1e-7 degrees
+  // for 4 byte latitude. N2kInt32NA, N2kUInt32NA or N2kInt64NA is sent as not available
+  // and values outside the field range as out of range.
+  void Add8ByteFixed(int64_t v);
+  void Add4ByteFixed(int32_t v);
+  void Add4ByteUFixed(uint32_t v);
+  void Add3ByteFixed(int32_t v);
+  void Add2ByteFixed(int32_t v);
+  void Add2ByteUFixed(uint32_t v);
+  void Add1ByteFixed(int32_t v);
+  void Add1ByteUFixed(uint32_t v);
   void Add2ByteInt(int16_t v);
   void Add2ByteUInt(uint16_t v);
   void Add3ByteInt(int32_t v);
@@ -156,6 +194,23 @@ public:
   double Get4ByteUDouble(double precision, int &Index, double def=N2kDoubleNA) const;
   double Get8ByteDouble(double precision, int &Index, double def=N2kDoubleNA) const;
   float  GetFloat(int &Index, float def=N2kFloatNA) const;
+  float Get1ByteFloat(float precision, int &Index, float def=N2kFloatNA) const;
+  float Get1ByteUFloat(float precision, int &Index, float def=N2kFloatNA) const;
+  float Get2ByteFloat(float precision, int &Index, float def=N2kFloatNA) const;
+  float Get2ByteUFloat(float precision, int &Index, float def=N2kFloatNA) const;
+  float Get3ByteFloat(float precision, int &Index, float def=N2kFloatNA) const;
+  float Get4ByteFloat(float precision, int &Index, float def=N2kFloatNA) const;
+  float Get4ByteUFloat(float precision, int &Index, float def=N2kFloatNA) const;
+  float Get8ByteFloat(float precision, int &Index, float def=N2kFloatNA) const;
+  // Fixed point getters return the raw field, def if it is not available or out of message.
+  int32_t Get1ByteFixed(int &Index, int32_t def=N2kInt32NA) const;
+  uint32_t Get1ByteUFixed(int &Index, uint32_t def=N2kUInt32NA) const;
+  int32_t Get2ByteFixed(int &Index, int32_t def=N2kInt32NA) const;
+  uint32_t Get2ByteUFixed(int &Index, uint32_t def=N2kUInt32NA) const;
+  int32_t Get3ByteFixed(int &Index, int32_t def=N2kInt32NA) const;
+  int32_t Get4ByteFixed(int &Index, int32_t def=N2kInt32NA) const;
+  uint32_t Get4ByteUFixed(int &Index, uint32_t def=N2kUInt32NA) const;
+  int64_t Get8ByteFixed(int &Index, int64_t def=N2kInt64NA) const;
   bool GetStr(char *StrBuf, size_t Length, int &Index) const;
   bool GetStr(size_t StrBufSize, char *StrBuf, size_t Length, unsigned char nulChar, int &Index) const;
   bool GetVarStr(size_t &StrBufSize, char *StrBuf, int &Index) const;
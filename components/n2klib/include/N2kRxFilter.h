@@ -0,0 +1,96 @@
+/*
+N2kRxFilter.h
+
+Copyright (c) 2022 John Blaiklock, BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Receive filter for CAN frames by PGN, in two stages.
+
+The first stage is the SJA1000 style acceptance filter of the CAN controller.
+In dual filter mode it compares only bits 28..13 of an extended id, which is
+priority, data page, PDU format and top 3 bits of PDU specific, so each of the
+two filters is a code and mask over PGN>>5. Wanted PGNs are split to two
+groups and each group gets the smallest code/mask that covers it. With more
+than a couple of PGNs that lets through other PGNs too.
+
+The second stage is a bitmap indexed by hashed PGN, checked for every frame
+the controller accepts. It may let through a PGN that shares a bit with a
+wanted one, but never drops a wanted one. Frames passing both stages still
+go through the normal library checks.
+*/
+
+#ifndef _tN2kRxFilter_H_
+#define _tN2kRxFilter_H_
+
+#include <stdint.h>
+
+class tN2kRxFilter
+{
+public:
+  static const uint16_t MaxPGNs=64;
+  static const uint16_t BitmapBits=2048;
+
+  // Acceptance code and mask bytes for ACR0..ACR3 and AMR0..AMR3 in dual filter mode. Mask bit 1 is don't care.
+  struct tAcceptance {
+    uint8_t Code[4];
+    uint8_t Mask[4];
+  };
+
+protected:
+  unsigned long PGNs[MaxPGNs];
+  uint16_t PGNCount;
+  bool Overflow;
+  bool AcceptAll;
+  uint32_t Bitmap[BitmapBits/32];
+  tAcceptance Acceptance;
+
+  static unsigned long IdToPGN(unsigned long id) {
+    unsigned long PGN=(id>>8) & 0x1ffff;
+    if ( (PGN & 0xff00)<0xf000 ) PGN&=0x1ff00; // PDU1, PS is destination
+    return PGN;
+  }
+  static uint16_t BitOf(unsigned long PGN) {
+    return (uint16_t)((((uint32_t)PGN*2654435761UL)>>16) & (BitmapBits-1));
+  }
+
+public:
+  tN2kRxFilter();
+
+  void Clear();
+  // Adds PGN to wanted set. If set is full, filter falls back to accepting everything.
+  void Add(unsigned long PGN);
+  // Adds 0 terminated PROGMEM list.
+  void AddList(const unsigned long *List);
+  // Builds controller settings and bitmap from PGNs added since Clear. With no PGNs everything is accepted.
+  void Update();
+
+  bool GetAcceptAll() const { return AcceptAll; }
+  const tAcceptance &GetAcceptance() const { return Acceptance; }
+  uint16_t GetPGNCount() const { return PGNCount; }
+
+  // Checks frame id as the controller filter does. Used where there is no controller.
+  bool IsAcceptedByController(unsigned long id) const;
+  // Second stage. Safe to call from interrupt, only reads the bitmap.
+  bool IsAccepted(unsigned long id) const {
+    uint16_t Bit=BitOf(IdToPGN(id));
+    return AcceptAll || (Bitmap[Bit>>5] & (1UL<<(Bit & 31)))!=0;
+  }
+};
+
+#endif
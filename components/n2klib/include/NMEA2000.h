@@ -48,6 +48,9 @@ address anymore. See also method ReadResetAddressChanged().
 #include "N2kStream.h"
 #include "N2kMsg.h"
 #include "N2kCANMsg.h"
+#include "N2kCANMsgPool.h"
+#include "N2kRxFilter.h"
+#include "RingBuffer.h"
 
 #if !defined(N2K_NO_GROUP_FUNCTION_SUPPORT)
 #include "N2kGroupFunction.h"
@@ -356,6 +359,16 @@ protected:
     const unsigned long *SingleFrameMessages[N2kMessageGroups];
     const unsigned long *FastPacketMessages[N2kMessageGroups];
 
+    // Hash index of all known PGNs built from the lists above, so that received
+    // frames are classified without scanning every list.
+    struct tPGNClass {
+      unsigned long PGN;
+      uint8_t Flags;
+    };
+    tPGNClass *PGNIndex;
+    uint16_t PGNIndexSize;
+    bool PGNIndexValid;
+
     class tCANSendFrame
     {
     public:
@@ -369,15 +382,20 @@ protected:
     };
 
 protected:
-    // Buffer for received messages.
-    tN2kCANMsg *N2kCANMsgBuf;
+    // Fast packet and ISO multi packet messages under reception
+    tN2kCANMsgPool N2kCANMsgPool;
     uint8_t MaxN2kCANMsgs;
+    uint8_t MaxN2kCANLargeMsgs;
+    // Received message, which is ready for handling
+    tN2kCANMsg *N2kCANRxMsg;
 
-    tCANSendFrame *CANSendFrameBuf;
+    // Frames driver could not take, read out in order of N2k priority
+    tPriorityRingBuffer<tCANSendFrame> *CANSendFrameBuf;
     uint16_t MaxCANSendFrames;
-    uint16_t CANSendFrameBufferWrite;
-    uint16_t CANSendFrameBufferRead;
+    bool SendBlocked;
+    uint32_t SendBlockedCount;
     uint16_t MaxCANReceiveFrames;
+    int MaxReadFramesOnParse;
 
     // Handler callbacks
     void (*MsgHandler)(const tN2kMsg &N2kMsg);                  // Normal messages
@@ -396,6 +414,9 @@ protected:
     // This will be called on Open() before any other initialization. Inherit this, if buffers can be set for the driver
     // and you want to change size of library send frame buffer size. See e.g. NMEA2000_teensy.cpp.
     virtual void InitCANFrameBuffers();
+    // Frames the driver can still queue for sending. Drivers, which do not know it, return 0xffff
+    // and only whole message sending is then checked against library buffer.
+    virtual uint16_t CANGetSendFrameSpace() { return 0xffff; }
 #if defined(DEBUG_NMEA2000_ISR)
     virtual void TestISR() {;}
 #endif
@@ -403,7 +424,6 @@ protected:
 protected:
     bool SendFrames(); // Sends pending frames
     bool SendFrame(unsigned long id, unsigned char len, const unsigned char *buf, bool wait_sent=true);
-    tCANSendFrame *GetNextFreeCANSendFrame();
     // Currently Product Information and Configuration Information will we pended on ISO request.
     // This is because specially for broadcasted response it may take a while, when higher priority
     // devices sends their response.
@@ -411,17 +431,21 @@ protected:
 
 protected:
     void InitDevices();
-    bool IsInitialized() { return (N2kCANMsgBuf!=0); }
-#if !defined(N2K_NO_ISO_MULTI_PACKET_SUPPORT)
-    void FindFreeCANMsgIndex(unsigned long PGN, unsigned char Source, unsigned char Destination, bool TPMsg, uint8_t &MsgIndex);
-#else
-    void FindFreeCANMsgIndex(unsigned long PGN, unsigned char Source, unsigned char Destination, uint8_t &MsgIndex);
-#endif
-    uint8_t SetN2kCANBufMsg(unsigned long canId, unsigned char len, unsigned char *buf);
+    bool IsInitialized() { return (N2kCANRxMsg!=0); }
+    void FreeExpiredCANMsgs(unsigned long CurTime);
+    tN2kCANMsgPool::tSlot *StartCANMsg(unsigned long KeyPGN, unsigned char Source, unsigned char Tag, uint16_t DataLen, unsigned long CurTime);
+    tN2kCANMsg *SetReadyCANMsg(tN2kCANMsgPool::tSlot *Slot, unsigned long CurTime);
+    tN2kCANMsg *SetN2kCANBufMsg(unsigned long canId, unsigned char len, unsigned char *buf, unsigned long CurTime);
     bool IsFastPacketPGN(unsigned long PGN);
     bool IsFastPacket(const tN2kMsg &N2kMsg);
+    void AddPGNClass(unsigned long PGN, uint8_t Flags, uint8_t FirstFlags);
+    void AddPGNClasses(const unsigned long *PGNs, uint8_t Flags, uint8_t FirstFlags);
+    void BuildPGNIndex();
+    const tPGNClass *FindPGNClass(unsigned long PGN);
+    // Adds system messages and receive lists of all devices to filter. Caller updates filter.
+    void AddReceiveFilterPGNs(tN2kRxFilter &Filter);
     bool CheckKnownMessage(unsigned long PGN, bool &SystemMessage, bool &FastPacket);
-    bool HandleReceivedSystemMessage(int MsgIndex);
+    bool HandleReceivedSystemMessage(const tN2kCANMsg &N2kCANMsg);
     void ForwardMessage(const tN2kMsg &N2kMsg);
     void ForwardMessage(const tN2kCANMsg &N2kCanMsg);
     void RespondISORequest(const tN2kMsg &N2kMsg, unsigned long RequestedPGN, int iDev);
@@ -470,7 +494,7 @@ protected:
     // Transport protocol handlers
     bool TestHandleTPMessage(unsigned long PGN, unsigned char Source, unsigned char Destination,
                              unsigned char len, unsigned char *buf,
-                             uint8_t &MsgIndex);
+                             unsigned long CurTime, tN2kCANMsg *&RxMsg);
     bool SendTPCM_BAM(int iDev);
     bool SendTPCM_RTS(int iDev);
     void SendTPCM_CTS(unsigned long PGN, unsigned char Destination, int iDev, unsigned char nPackets, unsigned char NextPacketNumber);
@@ -493,8 +517,11 @@ public:
     void SetDeviceCount(const uint8_t _DeviceCount);
 
     // As default there are reservation for 5 messages. If it is not critical to handle all fast packet messages like with N2km_NodeOnly
-    // you can set buffer size smaller like 3 or 2 by calling this before Open().
-    void SetN2kCANMsgBufSize(const uint8_t _MaxN2kCANMsgs) { if (N2kCANMsgBuf==0) { MaxN2kCANMsgs=_MaxN2kCANMsgs; }; }
+    // you can set buffer size smaller like 3 or 2 by calling this before Open(). One quarter of the slots can hold
+    // tN2kMsg::MaxDataLen bytes, others tN2kCANMsgPool::SmallDataLen bytes. Single frame messages do not use slots.
+    void SetN2kCANMsgBufSize(const uint8_t _MaxN2kCANMsgs) { if (N2kCANRxMsg==0) { MaxN2kCANMsgs=_MaxN2kCANMsgs; MaxN2kCANLargeMsgs=(_MaxN2kCANMsgs+3)/4; }; }
+    // Sets number of small and large slots separately. Call this before Open().
+    void SetN2kCANMsgBufSize(const uint8_t _SmallMsgs, const uint8_t _LargeMsgs) { if (N2kCANRxMsg==0) { MaxN2kCANMsgs=_SmallMsgs+_LargeMsgs; MaxN2kCANLargeMsgs=_LargeMsgs; }; }
 
     // When sending long messages like ProductInformation or GNSS data, there may not be enough buffers for successfully send data
     // This depends of your hw and device source. Device source has effect due to priority of getting sending slot. If your data is
@@ -644,13 +671,28 @@ public:
     void Restart();
 
     // Generate N2k message e.g. by using N2kMessages.h and simply send it to the bus.
+    // Message is queued only if there is room for all of its frames, so a fast packet is never
+    // cut. Frames are sent in order of message priority.
     bool SendMsg(const tN2kMsg &N2kMsg, int DeviceIndex=0);
+    // True if last SendMsg failed only because send buffers had no room for the message.
+    // Sending the same message again later will succeed, when buffers have been emptied.
+    bool IsSendBlocked() const { return SendBlocked; }
+    // Number of SendMsg calls refused because send buffers were full.
+    uint32_t GetSendBlockedCount() const { return SendBlockedCount; }
+    // Frames that can be queued for sending now, in driver and library buffers.
+    uint16_t GetSendFrameSpace();
 
     // Call this periodically to handle N2k messages. Note that even if you only send e.g.
     // temperature to the bus, you should call this so the code will automatically inform
     // about itselt to others. Take care that your loop to call ParseMessages() does not have
     // long delays. 
     void ParseMessages();
+    // Most frames ParseMessages reads on one call. Default is 20.
+    void SetMaxReadFramesOnParse(int _MaxReadFramesOnParse) { if ( _MaxReadFramesOnParse>0 ) MaxReadFramesOnParse=_MaxReadFramesOnParse; }
+    // Time in ms until ParseMessages has timed work to do: buffered frames, pending address claim,
+    // product or configuration information, TP data or heartbeat. Returns MaxDelay if nothing is
+    // due before that. Use this to sleep between calls when they are triggered by received frames.
+    unsigned long GetHousekeepingDelay(unsigned long MaxDelay);
 
     // Set the message handler for incoming N2kMessages.
     void SetMsgHandler(void (*_MsgHandler)(const tN2kMsg &N2kMsg));             // Old style - callback function pointer
@@ -702,6 +744,12 @@ public:
 
 };
 
+//*****************************************************************************
+// Conversion between CAN id and priority, PGN, source and destination as used on the bus.
+// N2ktoCanID returns 0 for PDU1 PGN with destination byte set.
+void CanIdToN2k(unsigned long id, unsigned char &prio, unsigned long &pgn, unsigned char &src, unsigned char &dst);
+unsigned long N2ktoCanID(unsigned char priority, unsigned long PGN, unsigned long Source, unsigned char Destination);
+
 //*****************************************************************************
 // ISO Acknowledgement
 void SetN2kPGN59392(tN2kMsg &N2kMsg, unsigned char Control, unsigned char GroupFunction, unsigned long PGN);
@@ -38,9 +38,11 @@ before including NMEA2000_esp32.h or NMEA2000_CAN.h
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/task.h"
 #include "driver/gpio.h"
 #include "NMEA2000.h"
 #include "N2kMsg.h"
+#include "RingBuffer.h"
 #include "ESP32_CAN_def.h"
 
 #ifndef ESP32_CAN_TX_PIN
@@ -52,39 +54,97 @@ before including NMEA2000_esp32.h or NMEA2000_CAN.h
 
 class tNMEA2000_esp32 : public tNMEA2000
 {
+public:
+  typedef void (*tRxFrameHook)(unsigned long id, unsigned char len, const unsigned char *buf);
+  static const int RxLatencyBuckets=16;
+
 private:
   bool IsOpen;
   static bool CanInUse;
+  static portMUX_TYPE TxMux;
 
 protected:
   struct tCANFrame {
     uint32_t id; // can identifier
     uint8_t len; // length of data
     uint8_t buf[8];
+    uint32_t time; // esp_timer_get_time() in us when frame was read from controller
   };
 
 protected:
 	CAN_speed_t    speed;	
   gpio_num_t     TxPin;	
   gpio_num_t     RxPin;
-  QueueHandle_t  RxQueue;
-  QueueHandle_t  TxQueue;
+  tSPSCRingBuffer<tCANFrame> *RxRing;     // filled by interrupt, read by CANGetFrame
+  tSPSCRingBuffer<tCANFrame> *InjectRing; // filled by InjectRxFrame from a task
+  tPriorityRingBuffer<tCANFrame> *TxRing; // read by interrupt as transmit completes, highest priority first
+  tRxFrameHook   RxFrameHook;
+  volatile uint32_t RxHardwareOverruns;
+  TaskHandle_t   RxNotifyTask;
+  uint32_t       LastRxFrameTime;
+  uint32_t       RxLatencyHistogram[RxLatencyBuckets];
+  bool           RxFilterEnabled;
+  volatile bool  RxFilterBypass;       // in effect in the controller, read by interrupt
+  volatile bool  RxFilterBypassWanted; // set by SetRxFilterBypass, applied when nothing is being sent
+  tN2kRxFilter   RxFilter;
+  volatile uint32_t RxAccepted;
+  volatile uint32_t RxRejected;
 
 protected:
-  void CAN_read_frame(); // Read frame to queue within interrupt
+  void CAN_read_frame(); // Read all frames in controller receive FIFO to ring within interrupt
   void CAN_send_frame(tCANFrame &frame); // Send frame
   void CAN_init();
+  void CAN_set_acceptance(); // Acceptance code and mask from receive filter, controller must be in reset mode
+  void CAN_apply_rx_filter_bypass(); // Switch bypass through reset mode and restart sending, call with TxMux held and transmit buffer free
 
 protected:
   bool CANSendFrame(unsigned long id, unsigned char len, const unsigned char *buf, bool wait_sent=true);
   bool CANOpen();
   bool CANGetFrame(unsigned long &id, unsigned char &len, unsigned char *buf);
   virtual void InitCANFrameBuffers();
+  uint16_t CANGetSendFrameSpace();
 
 public:
   tNMEA2000_esp32(gpio_num_t _TxPin=ESP32_CAN_TX_PIN,  gpio_num_t _RxPin=ESP32_CAN_RX_PIN);
 
   void InterruptHandler();
+
+  // Set function called from the CAN interrupt with every frame received, before it is queued.
+  // With receive filter enabled only frames passing the filter are seen.
+  void SetRxFrameHook(tRxFrameHook hook) { RxFrameHook=hook; }
+  // Receive only system messages and PGNs set with ExtendReceiveMessages. Call before Open.
+  // The controller acceptance filter drops most other frames without an interrupt, rest are
+  // dropped in the interrupt before they are queued.
+  void EnableRxFilter(bool Enable=true) { if (!IsOpen) RxFilterEnabled=Enable; }
+  // Let every frame through an enabled receive filter for a while, e.g. for a raw gateway. Switching
+  // resets the controller for a moment, so a frame or two on the bus may be missed. A frame being sent
+  // is not aborted: while frames are sent the switch waits until the send ring is empty.
+  void SetRxFilterBypass(bool Bypass);
+  // Frames read from the controller that were queued and that were dropped by the second filter stage.
+  // Frames dropped by the controller acceptance filter are not seen, so are not counted.
+  uint32_t GetRxAcceptedFrames() const { return RxAccepted; }
+  uint32_t GetRxRejectedFrames() const { return RxRejected; }
+  // Put frame to receive queue as if it had been received. Returns false if the queue is full.
+  // Injected frames have own queue, so that the interrupt stays the only writer of the receive ring.
+  bool InjectRxFrame(unsigned long id, unsigned char len, const unsigned char *buf);
+  // Frames lost because receive ring was full, most frames ever waiting in it and frames lost
+  // by the controller itself because its FIFO overflowed before the interrupt emptied it.
+  uint32_t GetRxOverruns() const { return (RxRing!=0?RxRing->getOverruns():0); }
+  uint16_t GetRxHighWater() const { return (RxRing!=0?RxRing->getHighWater():0); }
+  // Controller transmit and receive error counters. Above 127 the node is error passive, transmit at 256 takes it bus off.
+  uint8_t GetTxErrorCounter() const { return (uint8_t)MODULE_CAN->TXERR.B.TXERR; }
+  uint8_t GetRxErrorCounter() const { return (uint8_t)MODULE_CAN->RXERR.B.RXERR; }
+  uint32_t GetRxHardwareOverruns() const { return RxHardwareOverruns; }
+  // Frames waiting to be read by ParseMessages.
+  uint16_t GetRxPendingFrames() const;
+  // Task notified with vTaskNotifyGiveFromISR, when interrupt has put frames to receive ring
+  // or a frame is injected. Task should then call ParseMessages until no frames are pending.
+  void SetRxNotifyTask(TaskHandle_t Task) { RxNotifyTask=Task; }
+  // Call from message handler to count time from reading the last frame of the message from the
+  // controller to handling it. Bucket i counts times from 2^i to 2^(i+1)-1 us, first bucket
+  // also 0 and last one also longer times.
+  void RecordRxLatency();
+  const uint32_t *GetRxLatencyHistogram() const { return RxLatencyHistogram; }
 };
 
 #endif
@@ -64,12 +64,26 @@
   tPriorityRingBuffer is similar as tRingBuffer, but it extends functionality with item priority. When you add
   items to buffer, you can give them priority and when you read them, highest priority item will be read out
   first.
+
+  tSPSCRingBuffer is tRingBuffer for one producer and one consumer, which may run at the same time e.g. an
+  interrupt and a task, without locking. Only the producer writes head and only the consumer writes tail, and
+  an item is published or released only after it has been copied. Producer can fill next item in place:
+
+  tCANData *msgIn=CANRx.getAddRef();
+  if ( msgIn!=0 ) {
+    ...fill msgIn...
+    CANRx.commitAdd();
+  }
+
+  Failed adds are counted as overruns and the highest fill seen is kept as high water mark. Both are written
+  by the producer only.
 */
 
 #ifndef _RING_BUFFER_H_
 #define _RING_BUFFER_H_
 
 #include <cstdint>
+#include <cstring>
 
 template <typename T> class tRingBuffer {
 
@@ -94,6 +108,39 @@ public:
   bool read(T &val);
 };
 
+template <typename T> class tSPSCRingBuffer {
+
+protected:
+  T *buffer;
+  volatile uint16_t head; // written by producer only
+  volatile uint16_t tail; // written by consumer only
+  uint16_t size;
+  volatile uint32_t overruns;
+  volatile uint16_t highWater;
+
+  uint16_t next(uint16_t index) const { return ( index+1==size ? 0 : index+1 ); }
+
+public:
+  tSPSCRingBuffer(uint16_t _size);
+  virtual ~tSPSCRingBuffer();
+  uint16_t getSize() const { return size; }
+  bool isEmpty() const;
+  uint16_t count() const;
+  uint32_t getOverruns() const { return overruns; }
+  uint16_t getHighWater() const { return highWater; }
+
+  // Producer side. getAddRef returns pointer to next free item or 0 and counts overrun, if buffer is full.
+  // Item is not visible to consumer before commitAdd.
+  T *getAddRef();
+  void commitAdd();
+  bool add(const T &val);
+
+  // Consumer side. getReadRef returns pointer to oldest item or 0. Item stays reserved until commitRead.
+  const T *getReadRef();
+  void commitRead();
+  bool read(T &val);
+};
+
 template <typename T> class tPriorityRingBuffer {
 protected:
   #define INVALID_RING_REF (uint16_t)(-1)
@@ -103,6 +150,7 @@ protected:
     T Value;
     uint16_t next;
     uint8_t priority;
+    bool used;
   };
 
   struct tPriorityRef {
@@ -115,6 +163,7 @@ protected:
   uint16_t head;
   uint16_t tail;
   uint16_t size;
+  uint16_t items;
   uint8_t maxPriorities;
   tValueSlot *buffer;
   tPriorityRef *priorityReferencies;
@@ -126,7 +175,10 @@ public:
   bool isEmpty(uint8_t _priority=0xff) const;
   void clear();
   void clean();
-  uint16_t count();
+  uint16_t count() const { return items; }
+  // Number of items that can be added now. Slots read out of order are reused only after
+  // older items before them have been read, so this can be less than size-1-count().
+  uint16_t getFreeCount() const { return (uint16_t)((tail+size-head-1)%size); }
 
   bool add(const T &val, uint8_t _priority=0);
   bool read(T &val);
@@ -135,6 +187,8 @@ public:
   const T *getReadRef(uint8_t _priority);
   // Get reference to highest available.
   const T *getReadRef(uint8_t *_priority=0);
+  // Get reference to highest available without removing it.
+  const T *peekReadRef(uint8_t *_priority=0) const;
 };
 
 
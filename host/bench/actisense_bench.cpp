@@ -0,0 +1,243 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+/*
+actisense_bench.cpp
+
+Measures how fast tActisenseReader turns Actisense input into messages, as
+the raw gateway reads it from Bluetooth. A mix of single frame and fast
+packet messages, some with bytes that need escaping, is written in Actisense
+format to memory and parsed again in blocks with ParseBlock and a byte at a
+time through an N2kStream with GetMessageFromStream. A third run corrupts one
+message in 50 to check the reader drops it and finds the next one.
+
+Output is a single JSON object on stdout with, for each run, ns per input
+byte, messages parsed, bad messages and if parsed messages matched the ones
+written.
+
+Usage: actisense_bench [-m messages] [-b block_size]
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "N2kMessages.h"
+#include "ActisenseReader.h"
+
+#define DEFAULT_MESSAGES 200000UL
+#define DEFAULT_BLOCK_SIZE 256U
+#define CORRUPT_EVERY 50UL
+
+//*****************************************************************************
+// Collects written data in memory and reads it back a byte at a time.
+class tMemoryStream : public N2kStream
+{
+public:
+  uint8_t *Buf;
+  size_t Size;
+  size_t Len;
+  size_t ReadPos;
+
+  tMemoryStream(size_t _Size) : Buf(new uint8_t[_Size]), Size(_Size), Len(0), ReadPos(0) {}
+  ~tMemoryStream() { delete[] Buf; }
+  int read() { return ( ReadPos<Len ? Buf[ReadPos++] : -1 ); }
+  size_t write(const uint8_t *data, size_t size) {
+    if ( Len+size>Size ) return 0;
+    memcpy(&Buf[Len],data,size);
+    Len+=size;
+    return size;
+  }
+};
+
+// Messages are checked by a sum of PGN, length and data, order matters
+static uint32_t check_value(uint32_t check, const tN2kMsg &msg)
+{
+	int i;
+
+	check = check * 31UL + msg.PGN + (uint32_t)msg.DataLen;
+	for (i = 0; i < msg.DataLen; i++)
+	{
+		check = check * 31UL + msg.Data[i];
+	}
+
+	return check;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void make_message(uint32_t index, tN2kMsg &msg)
+{
+	char callsign[] = "OH1234";
+	char name[] = "BLUEBRIDGE";
+	char destination[] = "HELSINKI";
+
+	switch (index % 4UL)
+	{
+	case 0UL:
+		SetN2kGNSS(msg, 1, 19000U, 43200.0 + index, 60.1, 24.9, 12.0, N2kGNSSt_GPS, N2kGNSSm_GNSSfix, 9, 0.8, 1.2, 47.0, 0,
+				N2kGNSSt_GPS, 0, 0.0);
+		break;
+	case 1UL:
+		// heading of 0x1010 gives escaped bytes
+		SetN2kTrueHeading(msg, (unsigned char)index, 0x1010 * 0.0001);
+		break;
+	case 2UL:
+		SetN2kAISClassAStatic(msg, 5, N2kaisr_First, 230000000UL + index, 9000000UL, callsign, name, 36, 12.0, 4.0, 2.0,
+				6.0, 19000U, 43200.0, 3.5, destination, N2kaisv_ITU_R_M_1371_3, N2kGNSSt_GPS, N2kaisdte_Ready,
+				N2kaisti_Channel_A_VDL_reception);
+		break;
+	default:
+		SetN2kCOGSOGRapid(msg, (unsigned char)index, N2khr_true, 1.5, 3.2);
+		break;
+	}
+	msg.Source = 16U;
+	msg.MsgTime = index;
+}
+
+static void run(const char *name, tMemoryStream &input, uint32_t written, uint32_t expected_check, size_t block_size,
+		bool stream, bool first)
+{
+	tActisenseReader reader;
+	tN2kMsg msg;
+	uint32_t parsed = 0UL;
+	uint32_t check = 0UL;
+	uint64_t start;
+	double ns_per_byte;
+
+	input.ReadPos = 0U;
+	start = now_ns();
+	if (stream)
+	{
+		reader.SetReadStream(&input);
+		while (reader.GetMessageFromStream(msg))
+		{
+			parsed++;
+			check = check_value(check, msg);
+		}
+	}
+	else
+	{
+		size_t pos = 0U;
+
+		while (pos < input.Len)
+		{
+			size_t len = (input.Len - pos < block_size) ? input.Len - pos : block_size;
+			size_t used = 0U;
+			bool ready;
+
+			while (used < len)
+			{
+				used += reader.ParseBlock(&input.Buf[pos + used], len - used, msg, ready);
+				if (ready)
+				{
+					parsed++;
+					check = check_value(check, msg);
+				}
+			}
+			pos += len;
+		}
+	}
+	ns_per_byte = (double)(now_ns() - start) / (double)input.Len;
+
+	printf("%s{\"run\":\"%s\",\"bytes\":%u,\"ns_per_byte\":%.2f,\"messages_written\":%u,\"messages_parsed\":%u,"
+			"\"bad\":%u,\"match\":%s}", first ? "" : ",", name, (unsigned int)input.Len, ns_per_byte, (unsigned int)written,
+			(unsigned int)parsed, (unsigned int)reader.GetBadMessages(), check == expected_check ? "true" : "false");
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t messages = DEFAULT_MESSAGES;
+	size_t block_size = DEFAULT_BLOCK_SIZE;
+	uint32_t check = 0UL;
+	uint32_t corrupt_check = 0UL;
+	tN2kMsg msg;
+	uint32_t i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "m:b:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'm':
+			messages = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			block_size = (size_t)strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-m messages] [-b block_size]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (messages < 100UL || messages > 10000000UL || block_size < 1U)
+	{
+		fprintf(stderr, "bad parameter\n");
+		return 1;
+	}
+
+	{
+		tMemoryStream input((size_t)messages * 2U * tN2kMsg::MaxDataLen);
+		tMemoryStream corrupt((size_t)messages * 2U * tN2kMsg::MaxDataLen);
+
+		for (i = 0UL; i < messages; i++)
+		{
+			make_message(i, msg);
+			msg.SendInActisenseFormat(&input);
+			check = check_value(check, msg);
+
+			size_t start = corrupt.Len;
+			msg.SendInActisenseFormat(&corrupt);
+			if (i % CORRUPT_EVERY == CORRUPT_EVERY - 1UL)
+			{
+				// flip a bit in PGN, which is never a framing byte, so checksum fails
+				corrupt.Buf[start + 5U] ^= 0x01U;
+			}
+			else
+			{
+				corrupt_check = check_value(corrupt_check, msg);
+			}
+		}
+
+		printf("{\"benchmark\":\"actisense\",\"messages\":%u,\"block_size\":%u,\"results\":[", (unsigned int)messages,
+				(unsigned int)block_size);
+		run("block", input, messages, check, block_size, false, true);
+		run("stream", input, messages, check, block_size, true, false);
+		run("block_corrupt", corrupt, messages, corrupt_check, block_size, false, false);
+		printf("]}\n");
+	}
+
+	return 0;
+}
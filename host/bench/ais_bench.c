@@ -0,0 +1,514 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+/*
+ais_bench.c
+
+Measures the AIS reassembly, decoding, target table and forwarding policy in
+main/ais.c on the traffic of a busy harbour. Vessels are simulated, some
+moored with a few metres of GPS noise, some under way and turning now and
+then, class A sending position reports (type 1) and static data (type 5, in 2
+fragments) and class B sending position reports (type 18) and static data
+(type 24 part A and B). Their reports are encoded to VDM fragments at a fixed
+rate, 2000 sentences a minute by default, shared out between the vessels in
+turn. A few vessels go out of range half way through, which the table must
+age out, and every 50th type 5 loses its second fragment.
+
+The first run has fewer vessels than the target table holds and the second
+twice as many, so half of them are not tracked and all their reports are
+forwarded. Output is a
+single JSON object on stdout with, for each run, ns per fragment given to
+ais_receive_fragment, the sentences and bytes forwarded against those
+received, the table counters and how many targets in the table had a position
+or name different from what their vessel last sent, which should be 0.
+
+Usage: ais_bench [-r sentences_per_minute] [-s simulated_seconds] [-v vessels]
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "ais.h"
+
+#define DEFAULT_RATE 2000UL
+#define DEFAULT_SECONDS 1800UL
+#define DEFAULT_VESSELS 48UL
+#define MAX_VESSELS 1000UL
+#define STATIC_EVERY 10UL
+#define LOST_FRAGMENT_EVERY 50UL
+#define LEAVING_EVERY 8UL
+#define TURN_PERIOD_S 60UL
+#define FIRST_FRAGMENT_CHARACTERS 60U
+#define METRES_PER_UNIT 0.1852
+#define KNOTS_TO_MPS 0.514444
+#define PI 3.14159265358979
+#define ARRAY_LENGTH(a) (sizeof(a) / sizeof((a)[0]))
+
+typedef struct
+{
+	uint32_t mmsi;
+	bool class_b;
+	bool moored;
+	bool leaves;					// stops sending half way through
+	double latitude;				// 1/10000 minutes
+	double longitude;
+	uint16_t sog;					// 0.1 knots
+	uint16_t cog;					// 0.1 degrees
+	int32_t sent_latitude;			// last position sent
+	int32_t sent_longitude;
+	char name[AIS_NAME_LENGTH + 1];
+	uint32_t reports;
+	bool static_sent;
+} vessel_t;
+
+typedef struct
+{
+	uint32_t time_ms;
+	nmea_message_data_VDM_t fragment;
+} traffic_t;
+
+typedef struct
+{
+	uint16_t length;
+	uint8_t bits[64];
+} bit_writer_t;
+
+static vessel_t vessels[MAX_VESSELS];
+static uint32_t random_state = 12345UL;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t random_next(void)
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+
+	return random_state;
+}
+
+static void put_bits(bit_writer_t *writer, uint32_t value, uint8_t length)
+{
+	uint8_t i;
+
+	for (i = length; i > 0U; i--)
+	{
+		if (value & (1UL << (i - 1U)))
+		{
+			writer->bits[writer->length >> 3] |= (uint8_t)(0x80U >> (writer->length & 7U));
+		}
+		writer->length++;
+	}
+}
+
+static void put_text(bit_writer_t *writer, const char *text, uint8_t characters)
+{
+	uint8_t i;
+	char c;
+
+	for (i = 0U; i < characters; i++)
+	{
+		c = *text != '\0' ? *text++ : '@';
+		put_bits(writer, (uint32_t)(c >= 64 ? c - 64 : c), 6U);
+	}
+}
+
+// 6 bit characters of the payload, with the fill bits needed to make whole characters
+static void armour(const bit_writer_t *writer, char *text, uint8_t *fill_bits)
+{
+	uint16_t characters = (uint16_t)((writer->length + 5U) / 6U);
+	uint16_t i;
+	uint8_t value;
+	uint8_t bit;
+
+	for (i = 0U; i < characters; i++)
+	{
+		value = 0U;
+		for (bit = 0U; bit < 6U; bit++)
+		{
+			uint16_t position = (uint16_t)(i * 6U + bit);
+
+			value = (uint8_t)((value << 1) | ((writer->bits[position >> 3] >> (7U - (position & 7U))) & 1U));
+		}
+		text[i] = (char)(value < 40U ? value + 48U : value + 56U);
+	}
+	text[characters] = '\0';
+	*fill_bits = (uint8_t)(characters * 6U - writer->length);
+}
+
+static void add_fragments(traffic_t *traffic, size_t *count, uint32_t time_ms, const bit_writer_t *writer,
+		uint8_t message_identifier, bool lose_second)
+{
+	char text[(sizeof(writer->bits) * 8U) / 6U + 2U];
+	uint8_t fill_bits;
+	size_t length;
+	size_t copied;
+	uint8_t fragments;
+	uint8_t i;
+
+	armour(writer, text, &fill_bits);
+	length = strlen(text);
+	fragments = length > FIRST_FRAGMENT_CHARACTERS ? 2U : 1U;
+	for (i = 0U; i < fragments; i++)
+	{
+		nmea_message_data_VDM_t *fragment = &traffic[*count].fragment;
+		const char *start = &text[i * FIRST_FRAGMENT_CHARACTERS];
+
+		if (i == 1U && lose_second)
+		{
+			break;
+		}
+		memset(fragment, 0, sizeof(*fragment));
+		fragment->data_available = NMEA_VDM_FRAGMENT_COUNT_PRESENT | NMEA_VDM_FRAGMENT_NUMBER_PRESENT |
+				NMEA_VDM_CHANNEL_CODE_PRESENT | NMEA_VDM_DATA_PRESENT | NMEA_VDM_FILL_BITS_PRESENT;
+		fragment->fragment_count = fragments;
+		fragment->fragment_number = (uint8_t)(i + 1U);
+		if (fragments > 1U)
+		{
+			fragment->data_available |= NMEA_VDM_MESSAGE_IDENTIFIER_PRESENT;
+			fragment->message_identifier = message_identifier;
+		}
+		fragment->channel_code = (message_identifier & 1U) ? 'B' : 'A';
+		copied = length - i * FIRST_FRAGMENT_CHARACTERS;
+		if (copied > (i == 0U ? FIRST_FRAGMENT_CHARACTERS : NMEA_VDM_MAX_AIS_DATA_FIELD_LENGTH))
+		{
+			copied = i == 0U ? FIRST_FRAGMENT_CHARACTERS : NMEA_VDM_MAX_AIS_DATA_FIELD_LENGTH;
+		}
+		(void)memcpy(fragment->data, start, copied);
+		fragment->data[copied] = '\0';
+		fragment->fill_bits = i + 1U == fragments ? fill_bits : 0U;
+		traffic[*count].time_ms = time_ms;
+		(*count)++;
+	}
+}
+
+// !AIVDM,c,n,id,ch,data,fill*hh\r\n
+static size_t sentence_length(const nmea_message_data_VDM_t *fragment)
+{
+	return 21U + strlen(fragment->data) + ((fragment->data_available & NMEA_VDM_MESSAGE_IDENTIFIER_PRESENT) ? 1U : 0U);
+}
+
+static void make_vessels(uint32_t count)
+{
+	uint32_t i;
+
+	random_state = 12345UL;
+	for (i = 0UL; i < count; i++)
+	{
+		vessel_t *vessel = &vessels[i];
+
+		memset(vessel, 0, sizeof(*vessel));
+		vessel->mmsi = 230000000UL + i * 7919UL;
+		vessel->class_b = (i % 3UL) == 2UL;
+		vessel->moored = (i % 2UL) == 0UL;
+		vessel->leaves = (i % LEAVING_EVERY) == LEAVING_EVERY - 1UL;
+		// a harbour 5 km across at 60 N 25 E
+		vessel->latitude = 60.0 * 600000.0 + (double)(random_next() % 16000UL);
+		vessel->longitude = 25.0 * 600000.0 + (double)(random_next() % 32000UL);
+		vessel->sog = vessel->moored ? 0U : (uint16_t)(40U + random_next() % 160UL);
+		vessel->cog = (uint16_t)(random_next() % 3600UL);
+		(void)snprintf(vessel->name, sizeof(vessel->name), "VESSEL %u", (unsigned int)i);
+	}
+}
+
+static void move_vessels(uint32_t count, uint32_t second)
+{
+	uint32_t i;
+
+	for (i = 0UL; i < count; i++)
+	{
+		vessel_t *vessel = &vessels[i];
+		double metres = (double)vessel->sog / 10.0 * KNOTS_TO_MPS;
+		double course = (double)vessel->cog / 10.0 * PI / 180.0;
+
+		if (vessel->moored)
+		{
+			continue;
+		}
+		vessel->latitude += metres * cos(course) / METRES_PER_UNIT;
+		vessel->longitude += metres * sin(course) / (METRES_PER_UNIT * cos(vessel->latitude / 600000.0 * PI / 180.0));
+		if ((second + i) % TURN_PERIOD_S == 0UL)
+		{
+			vessel->cog = (uint16_t)((vessel->cog + 3600U - 450U + random_next() % 900UL) % 3600U);
+		}
+	}
+}
+
+static void encode_report(traffic_t *traffic, size_t *count, vessel_t *vessel, uint32_t time_ms, uint8_t *message_identifier,
+		uint32_t *type_5_count)
+{
+	bit_writer_t writer;
+	double noise = vessel->moored ? 3.0 / METRES_PER_UNIT : 0.0;
+	bool lose_second = false;
+
+	memset(&writer, 0, sizeof(writer));
+	if (vessel->reports % STATIC_EVERY == 0UL)
+	{
+		if (vessel->class_b)
+		{
+			put_bits(&writer, 24UL, 6U);
+			put_bits(&writer, 0UL, 2U);
+			put_bits(&writer, vessel->mmsi, 30U);
+			put_bits(&writer, (vessel->reports / STATIC_EVERY) & 1UL, 2U);
+			if (((vessel->reports / STATIC_EVERY) & 1UL) == 0UL)
+			{
+				put_text(&writer, vessel->name, AIS_NAME_LENGTH);
+				vessel->static_sent = true;
+			}
+			else
+			{
+				put_bits(&writer, 37UL, 8U);
+				put_text(&writer, "BBR", 3U);
+				put_bits(&writer, 0UL, 24U);
+				put_text(&writer, "OH1234", AIS_CALLSIGN_LENGTH);
+				put_bits(&writer, 8UL, 9U);
+				put_bits(&writer, 4UL, 9U);
+				put_bits(&writer, 2UL, 6U);
+				put_bits(&writer, 2UL, 6U);
+				put_bits(&writer, 0UL, 6U);
+			}
+		}
+		else
+		{
+			put_bits(&writer, 5UL, 6U);
+			put_bits(&writer, 0UL, 2U);
+			put_bits(&writer, vessel->mmsi, 30U);
+			put_bits(&writer, 0UL, 2U);
+			put_bits(&writer, 9000000UL + vessel->mmsi % 1000000UL, 30U);
+			put_text(&writer, "OH1234", AIS_CALLSIGN_LENGTH);
+			put_text(&writer, vessel->name, AIS_NAME_LENGTH);
+			put_bits(&writer, 70UL, 8U);
+			put_bits(&writer, 120UL, 9U);
+			put_bits(&writer, 30UL, 9U);
+			put_bits(&writer, 10UL, 6U);
+			put_bits(&writer, 10UL, 6U);
+			put_bits(&writer, 1UL, 4U);
+			put_bits(&writer, 6UL, 4U);
+			put_bits(&writer, 15UL, 5U);
+			put_bits(&writer, 12UL, 5U);
+			put_bits(&writer, 0UL, 6U);
+			put_bits(&writer, 65UL, 8U);
+			put_text(&writer, "HELSINKI", AIS_NAME_LENGTH);
+			put_bits(&writer, 0UL, 2U);
+			vessel->static_sent = true;
+			(*type_5_count)++;
+			lose_second = *type_5_count % LOST_FRAGMENT_EVERY == 0UL;
+		}
+		add_fragments(traffic, count, time_ms, &writer, *message_identifier, lose_second);
+		*message_identifier = (uint8_t)((*message_identifier + 1U) % 10U);
+	}
+	else
+	{
+		vessel->sent_latitude = (int32_t)lround(vessel->latitude + noise * ((double)(random_next() % 2001UL) / 1000.0 - 1.0));
+		vessel->sent_longitude = (int32_t)lround(vessel->longitude + noise * ((double)(random_next() % 2001UL) / 1000.0 - 1.0));
+		put_bits(&writer, vessel->class_b ? 18UL : 1UL, 6U);
+		put_bits(&writer, 0UL, 2U);
+		put_bits(&writer, vessel->mmsi, 30U);
+		if (vessel->class_b)
+		{
+			put_bits(&writer, 0UL, 8U);
+		}
+		else
+		{
+			put_bits(&writer, vessel->moored ? 5UL : 0UL, 4U);
+			put_bits(&writer, 128UL, 8U);
+		}
+		put_bits(&writer, vessel->sog, 10U);
+		put_bits(&writer, 1UL, 1U);
+		put_bits(&writer, (uint32_t)vessel->sent_longitude & 0x0fffffffUL, 28U);
+		put_bits(&writer, (uint32_t)vessel->sent_latitude & 0x07ffffffUL, 27U);
+		put_bits(&writer, vessel->cog, 12U);
+		put_bits(&writer, vessel->cog / 10U, 9U);
+		put_bits(&writer, (time_ms / 1000UL) % 60UL, 6U);
+		put_bits(&writer, 0UL, vessel->class_b ? 29U : 25U);
+		add_fragments(traffic, count, time_ms, &writer, 0U, false);
+	}
+	vessel->reports++;
+}
+
+static traffic_t *build_traffic(uint32_t rate, uint32_t seconds, uint32_t vessel_count, size_t *count)
+{
+	// each message is at most 2 fragments
+	traffic_t *traffic = malloc(((size_t)rate * seconds / 60U + 2U) * 2U * sizeof(traffic_t));
+	uint32_t next_vessel = 0UL;
+	uint32_t type_5_count = 0UL;
+	uint8_t message_identifier = 0U;
+	uint32_t second;
+	uint32_t sent;
+	uint32_t due;
+
+	*count = 0U;
+	if (traffic == NULL)
+	{
+		return NULL;
+	}
+
+	make_vessels(vessel_count);
+	for (second = 0UL; second < seconds; second++)
+	{
+		// sentences of this second, spread evenly over it
+		due = (uint32_t)(((uint64_t)rate * (second + 1UL)) / 60ULL - ((uint64_t)rate * second) / 60ULL);
+		for (sent = 0UL; sent < due; )
+		{
+			vessel_t *vessel = &vessels[next_vessel];
+			size_t before = *count;
+
+			next_vessel = (next_vessel + 1UL) % vessel_count;
+			if (vessel->leaves && second >= seconds / 2UL)
+			{
+				continue;
+			}
+			encode_report(traffic, count, vessel, second * 1000UL + (sent * 1000UL) / due, &message_identifier, &type_5_count);
+			sent += (uint32_t)(*count - before);
+		}
+		move_vessels(vessel_count, second);
+	}
+
+	return traffic;
+}
+
+static void run(uint32_t rate, uint32_t seconds, uint32_t vessel_count, bool first)
+{
+	const nmea_message_data_VDM_t *fragments;
+	uint8_t fragment_count;
+	traffic_t *traffic;
+	size_t count;
+	size_t i;
+	uint64_t bytes_in = 0ULL;
+	uint64_t bytes_forwarded = 0ULL;
+	uint32_t sentences_forwarded = 0UL;
+	uint32_t mismatches = 0UL;
+	uint64_t start;
+	uint64_t elapsed;
+	ais_stats_t stats;
+	uint32_t v;
+	uint8_t f;
+
+	traffic = build_traffic(rate, seconds, vessel_count, &count);
+	if (traffic == NULL)
+	{
+		return;
+	}
+
+	ais_init();
+	start = now_ns();
+	for (i = 0U; i < count; i++)
+	{
+		if (ais_receive_fragment(&traffic[i].fragment, traffic[i].time_ms, &fragments, &fragment_count) == ais_result_forward)
+		{
+			for (f = 0U; f < fragment_count; f++)
+			{
+				bytes_forwarded += sentence_length(&fragments[f]);
+			}
+			sentences_forwarded += fragment_count;
+		}
+	}
+	elapsed = now_ns() - start;
+
+	for (i = 0U; i < count; i++)
+	{
+		bytes_in += sentence_length(&traffic[i].fragment);
+	}
+
+	// targets still in the table must have what their vessel last sent
+	for (v = 0UL; v < vessel_count; v++)
+	{
+		const ais_target_t *target = ais_get_target(vessels[v].mmsi);
+
+		if (target != NULL && ((target->latitude != AIS_LATITUDE_NOT_AVAILABLE &&
+				(target->latitude != vessels[v].sent_latitude || target->longitude != vessels[v].sent_longitude)) ||
+				(vessels[v].static_sent && target->name[0] != '\0' && strcmp(target->name, vessels[v].name) != 0)))
+		{
+			mismatches++;
+		}
+	}
+
+	ais_get_stats(&stats);
+	printf("%s{\"vessels\":%u,\"fragments\":%u,\"messages\":%u,\"ns_per_fragment\":%.1f,\"sentences_forwarded\":%u,"
+			"\"forwarded_percent\":%.1f,\"bytes_in\":%llu,\"bytes_forwarded\":%llu,\"decoded\":%u,\"passed_on\":%u,"
+			"\"suppressed\":%u,\"reassembly_failed\":%u,\"payload_errors\":%u,\"targets\":%u,\"targets_added\":%u,"
+			"\"targets_aged\":%u,\"targets_evicted\":%u,\"untracked\":%u,\"mismatches\":%u}",
+			first ? "" : ",", (unsigned int)vessel_count, (unsigned int)stats.fragments, (unsigned int)stats.messages,
+			(double)elapsed / (double)count, (unsigned int)sentences_forwarded,
+			100.0 * (double)sentences_forwarded / (double)count, (unsigned long long)bytes_in,
+			(unsigned long long)bytes_forwarded, (unsigned int)stats.decoded, (unsigned int)stats.passed_on,
+			(unsigned int)stats.suppressed, (unsigned int)stats.reassembly_failed, (unsigned int)stats.payload_errors,
+			(unsigned int)ais_get_target_count(), (unsigned int)stats.targets_added, (unsigned int)stats.targets_aged,
+			(unsigned int)stats.targets_evicted, (unsigned int)stats.untracked, (unsigned int)mismatches);
+	free(traffic);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t rate = DEFAULT_RATE;
+	uint32_t seconds = DEFAULT_SECONDS;
+	uint32_t vessel_count = DEFAULT_VESSELS;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "r:s:v:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'r':
+			rate = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 's':
+			seconds = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'v':
+			vessel_count = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-r sentences_per_minute] [-s simulated_seconds] [-v vessels]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (rate < 60UL || rate > 100000UL || seconds < 60UL || vessel_count < 1UL || vessel_count * 2UL > MAX_VESSELS)
+	{
+		fprintf(stderr, "bad parameter\n");
+		return 1;
+	}
+
+	printf("{\"benchmark\":\"ais\",\"sentences_per_minute\":%u,\"simulated_seconds\":%u,\"table_size\":%u,\"results\":[",
+			(unsigned int)rate, (unsigned int)seconds, (unsigned int)AIS_MAXIMUM_TARGETS);
+	run(rate, seconds, vessel_count, true);
+	run(rate, seconds, AIS_MAXIMUM_TARGETS * 2UL, false);
+	printf("]}\n");
+
+	return 0;
+}
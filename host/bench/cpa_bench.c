@@ -0,0 +1,481 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+/*
+cpa_bench.c
+
+Measures the CPA/TCPA alarm engine in main/cpa.c in a crowded anchorage.
+Most targets lie at anchor within 1.5 km, swinging 25 m around their anchor
+once every 10 minutes and reporting every 3 minutes, and the rest cross the
+area at 4 to 14 knots reporting every 10 seconds. Own ship gives a fix 10
+times a second. It lies at anchor for the first half of the run, then gets
+under way at 6 knots and turns 90 degrees every 5 minutes. cpa_process is
+called every 25 ms as the timer task does.
+
+Every simulated second all targets are also worked out again from scratch
+against the latest own ship fix, as a sweep of the whole table would, to
+compare the time that takes and the CPA the engine has. The engine keeps own
+ship on a straight track until a fix is off it by more than its limits, so
+its CPAs differ a little from the sweep's.
+
+Output is a single JSON object on stdout with, for each number of targets,
+ns per call of each engine function and the longest call, the engine's and
+the sweep's time per simulated second, the longest time from an own ship
+track change until all targets were recomputed, alarms raised and cleared
+and the largest CPA difference from the sweep for targets passing within a
+nautical mile in the next 30 minutes.
+
+Usage: cpa_bench [-s simulated_seconds] [-t targets]
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "cpa.h"
+
+#define DEFAULT_SECONDS 1800UL
+#define TICK_MS 25UL
+#define OWN_FIX_MS 100UL
+#define SWEEP_MS 1000UL
+#define MOVING_EVERY 7UL
+#define ANCHORED_REPORT_MS 180000UL
+#define MOVING_REPORT_MS 10000UL
+#define ANCHORAGE_RADIUS_M 1500.0
+#define AREA_RADIUS_M 3000.0
+#define SWING_RADIUS_M 25.0
+#define SWING_PERIOD_S 600.0
+#define OWN_SWING_RADIUS_M 20.0
+#define OWN_SPEED_KNOTS 6.0
+#define OWN_LEG_S 300UL
+#define CENTRE_LATITUDE 60.0
+#define CENTRE_LONGITUDE 24.0
+#define METRES_PER_UNIT 0.1852
+#define MPS_PER_KNOT 0.514444
+#define COMPARE_CPA_M 1852.0
+#define COMPARE_TCPA_S 1800.0
+#define PI 3.14159265358979
+
+typedef struct
+{
+	uint32_t mmsi;
+	bool moving;
+	double east_m;
+	double north_m;
+	double anchor_east_m;
+	double anchor_north_m;
+	double swing_phase;
+	double speed_mps;
+	double course;
+	uint32_t report_interval_ms;
+	uint32_t next_report_ms;
+	ais_target_t sent;
+} vessel_t;
+
+typedef struct
+{
+	uint64_t total_ns;
+	uint64_t max_ns;
+	uint32_t calls;
+} timing_t;
+
+static vessel_t vessels[AIS_MAXIMUM_TARGETS];
+static uint32_t random_state = 12345UL;
+static uint32_t alarms_raised[2];
+static uint32_t alarms_cleared[2];
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t random_next(void)
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+
+	return random_state;
+}
+
+// uniform in 0 to 1
+static double random_unit(void)
+{
+	return (double)(random_next() % 1000000UL) / 1000000.0;
+}
+
+static void add_timing(timing_t *timing, uint64_t ns)
+{
+	timing->total_ns += ns;
+	timing->calls++;
+	if (ns > timing->max_ns)
+	{
+		timing->max_ns = ns;
+	}
+}
+
+static void alarm_callback(const cpa_alarm_t *alarm)
+{
+	uint8_t type = alarm->type == cpa_alarm_collision ? 0U : 1U;
+
+	if (alarm->raised)
+	{
+		alarms_raised[type]++;
+	}
+	else
+	{
+		alarms_cleared[type]++;
+	}
+}
+
+// a crossing vessel enters at the edge of the area heading for somewhere in the anchorage
+static void start_crossing(vessel_t *vessel)
+{
+	double angle = random_unit() * 2.0 * PI;
+	double aim_east = (random_unit() * 2.0 - 1.0) * ANCHORAGE_RADIUS_M;
+	double aim_north = (random_unit() * 2.0 - 1.0) * ANCHORAGE_RADIUS_M;
+
+	vessel->east_m = AREA_RADIUS_M * sin(angle);
+	vessel->north_m = AREA_RADIUS_M * cos(angle);
+	vessel->course = atan2(aim_east - vessel->east_m, aim_north - vessel->north_m);
+	if (vessel->course < 0.0)
+	{
+		vessel->course += 2.0 * PI;
+	}
+	vessel->speed_mps = (4.0 + random_unit() * 10.0) * MPS_PER_KNOT;
+}
+
+static void move_vessel(vessel_t *vessel, uint32_t time_ms)
+{
+	double angle;
+
+	if (vessel->moving)
+	{
+		vessel->east_m += vessel->speed_mps * sin(vessel->course) * (double)TICK_MS / 1000.0;
+		vessel->north_m += vessel->speed_mps * cos(vessel->course) * (double)TICK_MS / 1000.0;
+		if (vessel->east_m * vessel->east_m + vessel->north_m * vessel->north_m > AREA_RADIUS_M * AREA_RADIUS_M * 1.01)
+		{
+			start_crossing(vessel);
+		}
+	}
+	else
+	{
+		angle = vessel->swing_phase + (double)time_ms / 1000.0 * 2.0 * PI / SWING_PERIOD_S;
+		vessel->east_m = vessel->anchor_east_m + SWING_RADIUS_M * sin(angle);
+		vessel->north_m = vessel->anchor_north_m + SWING_RADIUS_M * cos(angle);
+	}
+}
+
+static void make_report(vessel_t *vessel)
+{
+	double cog = vessel->course * 180.0 / PI;
+
+	memset(&vessel->sent, 0, sizeof(vessel->sent));
+	vessel->sent.mmsi = vessel->mmsi;
+	vessel->sent.latitude = (int32_t)lround(CENTRE_LATITUDE * 600000.0 + vessel->north_m / METRES_PER_UNIT);
+	vessel->sent.longitude = (int32_t)lround(CENTRE_LONGITUDE * 600000.0 +
+			vessel->east_m / (METRES_PER_UNIT * cos(CENTRE_LATITUDE * PI / 180.0)));
+	vessel->sent.sog = vessel->moving ? (uint16_t)lround(vessel->speed_mps / MPS_PER_KNOT * 10.0) : 0U;
+	vessel->sent.cog = vessel->moving ? (uint16_t)((uint32_t)lround(cog * 10.0) % 3600UL) : AIS_COG_NOT_AVAILABLE;
+	vessel->sent.heading = AIS_HEADING_NOT_AVAILABLE;
+}
+
+// own ship position, speed and course at a time, at anchor for the first half of the run then boxing the anchorage
+static void own_ship_at(uint32_t time_ms, uint32_t seconds, double *east_m, double *north_m, double *sog, double *cog)
+{
+	uint32_t under_way_ms;
+	uint32_t leg;
+	double leg_s;
+	double angle;
+
+	if (time_ms < seconds * 500UL)
+	{
+		angle = (double)time_ms / 1000.0 * 2.0 * PI / SWING_PERIOD_S;
+		*east_m = OWN_SWING_RADIUS_M * sin(angle) + (random_unit() - 0.5) * 4.0;
+		*north_m = OWN_SWING_RADIUS_M * cos(angle) + (random_unit() - 0.5) * 4.0;
+		*sog = random_unit() * 0.2;
+		*cog = random_unit() * 360.0;
+		return;
+	}
+
+	under_way_ms = time_ms - seconds * 500UL;
+	*east_m = 0.0;
+	*north_m = 0.0;
+	for (leg = 0UL; leg < under_way_ms / (OWN_LEG_S * 1000UL); leg++)
+	{
+		*east_m += OWN_SPEED_KNOTS * MPS_PER_KNOT * (double)OWN_LEG_S * sin((45.0 + 90.0 * (double)leg) * PI / 180.0);
+		*north_m += OWN_SPEED_KNOTS * MPS_PER_KNOT * (double)OWN_LEG_S * cos((45.0 + 90.0 * (double)leg) * PI / 180.0);
+	}
+	leg_s = (double)(under_way_ms % (OWN_LEG_S * 1000UL)) / 1000.0;
+	*cog = fmod(45.0 + 90.0 * (double)leg, 360.0);
+	*east_m += OWN_SPEED_KNOTS * MPS_PER_KNOT * leg_s * sin(*cog * PI / 180.0) + (random_unit() - 0.5) * 4.0;
+	*north_m += OWN_SPEED_KNOTS * MPS_PER_KNOT * leg_s * cos(*cog * PI / 180.0) + (random_unit() - 0.5) * 4.0;
+	*sog = OWN_SPEED_KNOTS + (random_unit() - 0.5) * 0.2;
+	*cog += (random_unit() - 0.5) * 2.0;
+}
+
+// CPA of a target worked out from scratch from its last report and the latest own ship fix
+static bool sweep_cpa(const vessel_t *vessel, uint32_t report_ms, double own_east_m, double own_north_m, double own_sog,
+		double own_cog, uint32_t time_ms, double *cpa_m, double *tcpa_s)
+{
+	double metres_per_unit_east = METRES_PER_UNIT * cos(CENTRE_LATITUDE * PI / 180.0);
+	double target_east_mps = 0.0;
+	double target_north_mps = 0.0;
+	double own_east_mps = 0.0;
+	double own_north_mps = 0.0;
+	double elapsed_s = (double)(time_ms - report_ms) / 1000.0;
+	double east_m;
+	double north_m;
+	double east_mps;
+	double north_mps;
+	double speed_squared;
+
+	if (vessel->sent.sog > 0U && vessel->sent.cog != AIS_COG_NOT_AVAILABLE)
+	{
+		target_east_mps = vessel->sent.sog / 10.0 * MPS_PER_KNOT * sin(vessel->sent.cog / 10.0 * PI / 180.0);
+		target_north_mps = vessel->sent.sog / 10.0 * MPS_PER_KNOT * cos(vessel->sent.cog / 10.0 * PI / 180.0);
+	}
+	if (own_sog >= CPA_STATIONARY_SOG_KNOTS)
+	{
+		own_east_mps = own_sog * MPS_PER_KNOT * sin(own_cog * PI / 180.0);
+		own_north_mps = own_sog * MPS_PER_KNOT * cos(own_cog * PI / 180.0);
+	}
+
+	east_m = (vessel->sent.longitude - CENTRE_LONGITUDE * 600000.0) * metres_per_unit_east +
+			target_east_mps * elapsed_s - own_east_m;
+	north_m = (vessel->sent.latitude - CENTRE_LATITUDE * 600000.0) * METRES_PER_UNIT + target_north_mps * elapsed_s -
+			own_north_m;
+	east_mps = target_east_mps - own_east_mps;
+	north_mps = target_north_mps - own_north_mps;
+	speed_squared = east_mps * east_mps + north_mps * north_mps;
+	if (speed_squared < 1.0e-4)
+	{
+		*tcpa_s = 0.0;
+		*cpa_m = hypot(east_m, north_m);
+		return false;
+	}
+	*tcpa_s = -(east_m * east_mps + north_m * north_mps) / speed_squared;
+	*cpa_m = hypot(east_m + east_mps * *tcpa_s, north_m + north_mps * *tcpa_s);
+
+	return true;
+}
+
+static void run(uint32_t seconds, uint32_t target_count, bool first)
+{
+	uint32_t report_ms[AIS_MAXIMUM_TARGETS];
+	timing_t update_timing = {0};
+	timing_t own_timing = {0};
+	timing_t process_timing = {0};
+	timing_t sweep_timing = {0};
+	cpa_stats_t stats;
+	uint32_t last_tracks = 0UL;
+	uint32_t track_start_ms = 0UL;
+	uint32_t backlog_ms_max = 0UL;
+	bool backlog = false;
+	double own_east_m = 0.0;
+	double own_north_m = 0.0;
+	double own_sog = 0.0;
+	double own_cog = 0.0;
+	double cpa_error_max = 0.0;
+	double cpa_error_total = 0.0;
+	uint32_t compared = 0UL;
+	uint32_t time_ms;
+	uint32_t i;
+	uint64_t start;
+	double angle;
+	double radius;
+	double cpa_m;
+	double tcpa_s;
+	float engine_cpa_m;
+	float engine_tcpa_s;
+
+	random_state = 12345UL;
+	memset(alarms_raised, 0, sizeof(alarms_raised));
+	memset(alarms_cleared, 0, sizeof(alarms_cleared));
+	for (i = 0UL; i < target_count; i++)
+	{
+		vessel_t *vessel = &vessels[i];
+
+		memset(vessel, 0, sizeof(vessel_t));
+		vessel->mmsi = 230000000UL + i;
+		vessel->moving = i % MOVING_EVERY == MOVING_EVERY - 1UL;
+		if (vessel->moving)
+		{
+			start_crossing(vessel);
+			radius = random_unit() * AREA_RADIUS_M;
+			vessel->east_m = radius * sin(vessel->course + PI);
+			vessel->north_m = radius * cos(vessel->course + PI);
+			vessel->report_interval_ms = MOVING_REPORT_MS;
+		}
+		else
+		{
+			// spread over the anchorage, leaving room around own ship's anchor
+			angle = random_unit() * 2.0 * PI;
+			radius = 100.0 + sqrt(random_unit()) * (ANCHORAGE_RADIUS_M - 100.0);
+			vessel->anchor_east_m = radius * sin(angle);
+			vessel->anchor_north_m = radius * cos(angle);
+			vessel->swing_phase = random_unit() * 2.0 * PI;
+			vessel->report_interval_ms = ANCHORED_REPORT_MS;
+		}
+		vessel->next_report_ms = random_next() % vessel->report_interval_ms;
+		report_ms[i] = 0UL;
+	}
+
+	cpa_init(alarm_callback);
+	for (time_ms = 0UL; time_ms < seconds * 1000UL; time_ms += TICK_MS)
+	{
+		for (i = 0UL; i < target_count; i++)
+		{
+			move_vessel(&vessels[i], time_ms);
+			if (time_ms >= vessels[i].next_report_ms)
+			{
+				vessels[i].next_report_ms += vessels[i].report_interval_ms;
+				make_report(&vessels[i]);
+				report_ms[i] = time_ms;
+				start = now_ns();
+				cpa_update_target((uint16_t)i, &vessels[i].sent, time_ms);
+				add_timing(&update_timing, now_ns() - start);
+			}
+		}
+
+		if (time_ms % OWN_FIX_MS == 0UL)
+		{
+			own_ship_at(time_ms, seconds, &own_east_m, &own_north_m, &own_sog, &own_cog);
+			start = now_ns();
+			cpa_update_own_ship((float)(CENTRE_LATITUDE + own_north_m / METRES_PER_UNIT / 600000.0),
+					(float)(CENTRE_LONGITUDE + own_east_m / (METRES_PER_UNIT * cos(CENTRE_LATITUDE * PI / 180.0)) / 600000.0),
+					(float)own_sog, (float)own_cog, time_ms);
+			add_timing(&own_timing, now_ns() - start);
+		}
+
+		start = now_ns();
+		cpa_process(time_ms);
+		add_timing(&process_timing, now_ns() - start);
+
+		cpa_get_stats(&stats);
+		if (stats.own_ship_tracks != last_tracks)
+		{
+			last_tracks = stats.own_ship_tracks;
+			track_start_ms = time_ms;
+			backlog = true;
+		}
+		if (backlog && stats.backlog == 0U)
+		{
+			backlog = false;
+			if (time_ms - track_start_ms > backlog_ms_max)
+			{
+				backlog_ms_max = time_ms - track_start_ms;
+			}
+		}
+
+		if (time_ms % SWEEP_MS == 0UL)
+		{
+			start = now_ns();
+			for (i = 0UL; i < target_count; i++)
+			{
+				if (vessels[i].sent.mmsi != 0UL)
+				{
+					(void)sweep_cpa(&vessels[i], report_ms[i], own_east_m, own_north_m, own_sog, own_cog, time_ms, &cpa_m,
+							&tcpa_s);
+					if (cpa_m < COMPARE_CPA_M && tcpa_s > 0.0 && tcpa_s < COMPARE_TCPA_S && !backlog &&
+							cpa_get_target((uint16_t)i, time_ms, &engine_cpa_m, &engine_tcpa_s))
+					{
+						compared++;
+						cpa_error_total += fabs((double)engine_cpa_m - cpa_m);
+						if (fabs((double)engine_cpa_m - cpa_m) > cpa_error_max)
+						{
+							cpa_error_max = fabs((double)engine_cpa_m - cpa_m);
+						}
+					}
+				}
+			}
+			add_timing(&sweep_timing, now_ns() - start);
+		}
+	}
+
+	cpa_get_stats(&stats);
+	printf("%s{\"targets\":%u,\"target_updates\":%u,\"update_ns\":%.1f,\"update_max_ns\":%llu,\"own_ship_updates\":%u,"
+			"\"own_ship_ns\":%.1f,\"own_ship_max_ns\":%llu,\"own_ship_tracks\":%u,\"process_ns\":%.1f,\"process_max_ns\":%llu,"
+			"\"recomputes\":%u,\"events\":%u,\"backlog_max_ms\":%u,\"engine_us_per_s\":%.2f,\"sweep_us_per_s\":%.2f,"
+			"\"collision_alarms\":%u,\"proximity_alarms\":%u,\"alarms_cleared\":%u,\"alarms_held\":%u,\"compared\":%u,"
+			"\"cpa_error_mean_m\":%.1f,\"cpa_error_max_m\":%.1f}",
+			first ? "" : ",", (unsigned int)target_count, (unsigned int)stats.target_updates,
+			(double)update_timing.total_ns / (double)update_timing.calls, (unsigned long long)update_timing.max_ns,
+			(unsigned int)stats.own_ship_updates, (double)own_timing.total_ns / (double)own_timing.calls,
+			(unsigned long long)own_timing.max_ns, (unsigned int)stats.own_ship_tracks,
+			(double)process_timing.total_ns / (double)process_timing.calls, (unsigned long long)process_timing.max_ns,
+			(unsigned int)stats.recomputes, (unsigned int)stats.events, (unsigned int)backlog_ms_max,
+			(double)(update_timing.total_ns + own_timing.total_ns + process_timing.total_ns) / 1000.0 / (double)seconds,
+			(double)sweep_timing.total_ns / 1000.0 / (double)seconds, (unsigned int)alarms_raised[0],
+			(unsigned int)alarms_raised[1], (unsigned int)(alarms_cleared[0] + alarms_cleared[1]),
+			(unsigned int)stats.alarms_held, (unsigned int)compared,
+			compared > 0UL ? cpa_error_total / (double)compared : 0.0, cpa_error_max);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t seconds = DEFAULT_SECONDS;
+	uint32_t targets = AIS_MAXIMUM_TARGETS;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "s:t:")) != -1)
+	{
+		switch (opt)
+		{
+		case 's':
+			seconds = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 't':
+			targets = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-s simulated_seconds] [-t targets]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (seconds < 60UL || seconds > 86400UL || targets < 4UL || targets > AIS_MAXIMUM_TARGETS)
+	{
+		fprintf(stderr, "bad parameter\n");
+		return 1;
+	}
+
+	printf("{\"benchmark\":\"cpa\",\"simulated_seconds\":%u,\"recompute_budget\":%u,\"event_budget\":%u,\"results\":[",
+			(unsigned int)seconds, (unsigned int)CPA_RECOMPUTE_BUDGET, (unsigned int)CPA_EVENT_BUDGET);
+	run(seconds, targets / 4UL, true);
+	run(seconds, targets / 2UL, false);
+	run(seconds, targets, false);
+	printf("]}\n");
+
+	return 0;
+}
@@ -0,0 +1,324 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+/*
+format_bench.c
+
+Measures the number formatting in main/format.c against snprintf(), which the
+NMEA0183 encoders and the publisher used before. Each kind of number the
+firmware writes is formatted both ways over a table of values in the range it
+has on a boat: 1 decimal for speeds, depths and temperatures, 4 decimals for
+the MQTT position, degrees and minutes with 3 decimals as in GGA and RMC, and
+unsigned integers. The payload run builds the comma separated MQTT "all"
+payload of the publisher with snprintf() and util_safe_strcat() as it was done
+before and with the format functions and a running length as it is done now.
+
+Output is a single JSON object on stdout with, for each run, ns per number or
+payload both ways and how many results differed. format_fixed rounds to
+nearest with ties to even as the C library does, so differences are expected
+only for a negative value that rounds to 0, which the C library writes as -0.0.
+
+Usage: format_bench [-i iterations]
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "format.h"
+
+#define DEFAULT_ITERATIONS 200000UL
+#define VALUES 256U
+#define PAYLOAD_FIELDS 17U
+#define PAYLOAD_SIZE 220U
+
+typedef enum
+{
+	RUN_FIXED_1,
+	RUN_FIXED_4,
+	RUN_DEGREES_MINUTES,
+	RUN_UINT
+} run_t;
+
+static float values[VALUES];
+static volatile size_t sink;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Same as util_safe_strcat in main/util.c, which needs the ESP-IDF headers
+static bool safe_strcat(char *dest, size_t size, const char *src)
+{
+	if (strlen(dest) + strlen(src) + (size_t)1 > size)
+	{
+		return false;
+	}
+	(void)strcat(dest, src);
+
+	return true;
+}
+
+static size_t with_snprintf(run_t run, char *dest, size_t size, float value)
+{
+	switch (run)
+	{
+	case RUN_FIXED_1:
+		return (size_t)snprintf(dest, size, "%.1f", value);
+	case RUN_FIXED_4:
+		return (size_t)snprintf(dest, size, "%.4f", value);
+	case RUN_DEGREES_MINUTES:
+		return (size_t)snprintf(dest, size, "%08.3f", value);
+	default:
+		return (size_t)snprintf(dest, size, "%u", (unsigned int)value);
+	}
+}
+
+static size_t with_format(run_t run, char *dest, size_t size, float value)
+{
+	switch (run)
+	{
+	case RUN_FIXED_1:
+		return format_fixed(dest, size, value, 1U, 0U);
+	case RUN_FIXED_4:
+		return format_fixed(dest, size, value, 4U, 0U);
+	case RUN_DEGREES_MINUTES:
+		return format_fixed(dest, size, value, 3U, 4U);
+	default:
+		return format_uint(dest, size, (uint32_t)value, 0U);
+	}
+}
+
+static void make_values(run_t run)
+{
+	uint32_t random = 12345UL;
+	uint32_t i;
+
+	for (i = 0UL; i < VALUES; i++)
+	{
+		float fraction;
+
+		random = random * 1103515245UL + 12345UL;
+		fraction = (float)(random >> 8) / 16777216.0f;
+		switch (run)
+		{
+		case RUN_FIXED_1:
+			values[i] = fraction * 60.0f - 10.0f;
+			break;
+		case RUN_FIXED_4:
+			values[i] = fraction * 360.0f - 180.0f;
+			break;
+		case RUN_DEGREES_MINUTES:
+			values[i] = (float)(random % 180UL) * 100.0f + fraction * 60.0f;
+			break;
+		default:
+			values[i] = (float)(random >> 12);
+			break;
+		}
+	}
+}
+
+static void run_numbers(const char *name, run_t run, uint32_t iterations, bool first)
+{
+	char expected[24];
+	char actual[24];
+	uint32_t differences = 0UL;
+	uint64_t start;
+	double ns_snprintf;
+	double ns_format;
+	size_t length = 0U;
+	uint32_t i;
+
+	make_values(run);
+	for (i = 0UL; i < VALUES; i++)
+	{
+		(void)with_snprintf(run, expected, sizeof(expected), values[i]);
+		(void)with_format(run, actual, sizeof(actual), values[i]);
+		if (strcmp(expected, actual) != 0)
+		{
+			differences++;
+		}
+	}
+
+	start = now_ns();
+	for (i = 0UL; i < iterations; i++)
+	{
+		length += with_snprintf(run, actual, sizeof(actual), values[i % VALUES]);
+	}
+	ns_snprintf = (double)(now_ns() - start) / (double)iterations;
+
+	start = now_ns();
+	for (i = 0UL; i < iterations; i++)
+	{
+		length += with_format(run, actual, sizeof(actual), values[i % VALUES]);
+	}
+	ns_format = (double)(now_ns() - start) / (double)iterations;
+	sink = length;
+
+	printf("%s{\"run\":\"%s\",\"ns_snprintf\":%.1f,\"ns_format\":%.1f,\"values\":%u,\"differences\":%u}", first ? "" : ",",
+			name, ns_snprintf, ns_format, VALUES, (unsigned int)differences);
+}
+
+// Payload fields in publisher order, strength, COG, log, heading and period are integers, latitude and longitude 4 decimals
+static const uint8_t payload_decimals[PAYLOAD_FIELDS] = {0U, 0U, 1U, 1U, 1U, 0U, 1U, 0U, 1U, 1U, 1U, 1U, 1U, 4U, 4U, 1U, 0U};
+
+static size_t payload_with_snprintf(char *payload, const float *fields)
+{
+	char number_buf[20];
+	uint32_t i;
+
+	payload[0] = '\0';
+	for (i = 0UL; i < PAYLOAD_FIELDS; i++)
+	{
+		if (payload_decimals[i] == 0U)
+		{
+			(void)snprintf(number_buf, sizeof(number_buf), "%u", (unsigned int)fields[i]);
+		}
+		else
+		{
+			(void)snprintf(number_buf, sizeof(number_buf), "%.*f", (int)payload_decimals[i], fields[i]);
+		}
+		(void)safe_strcat(payload, PAYLOAD_SIZE, number_buf);
+		(void)safe_strcat(payload, PAYLOAD_SIZE, ",");
+	}
+
+	return strlen(payload);
+}
+
+static size_t payload_with_format(char *payload, const float *fields)
+{
+	size_t length = 0U;
+	uint32_t i;
+
+	payload[0] = '\0';
+	for (i = 0UL; i < PAYLOAD_FIELDS; i++)
+	{
+		if (payload_decimals[i] == 0U)
+		{
+			length += format_uint(&payload[length], PAYLOAD_SIZE - length, (uint32_t)fields[i], 0U);
+		}
+		else
+		{
+			length += format_fixed(&payload[length], PAYLOAD_SIZE - length, fields[i], payload_decimals[i], 0U);
+		}
+		length += format_text(&payload[length], PAYLOAD_SIZE - length, ",");
+	}
+
+	return length;
+}
+
+static void run_payload(uint32_t iterations, bool first)
+{
+	static float fields[VALUES][PAYLOAD_FIELDS];
+	char expected[PAYLOAD_SIZE];
+	char actual[PAYLOAD_SIZE];
+	uint32_t random = 54321UL;
+	uint32_t differences = 0UL;
+	uint64_t start;
+	double ns_snprintf;
+	double ns_format;
+	size_t length = 0U;
+	uint32_t i;
+	uint32_t j;
+
+	for (i = 0UL; i < VALUES; i++)
+	{
+		for (j = 0UL; j < PAYLOAD_FIELDS; j++)
+		{
+			random = random * 1103515245UL + 12345UL;
+			fields[i][j] = (float)(random >> 8) / 16777216.0f * (payload_decimals[j] == 4U ? 180.0f : 360.0f);
+		}
+	}
+	for (i = 0UL; i < VALUES; i++)
+	{
+		(void)payload_with_snprintf(expected, fields[i]);
+		(void)payload_with_format(actual, fields[i]);
+		if (strcmp(expected, actual) != 0)
+		{
+			differences++;
+		}
+	}
+
+	start = now_ns();
+	for (i = 0UL; i < iterations; i++)
+	{
+		length += payload_with_snprintf(actual, fields[i % VALUES]);
+	}
+	ns_snprintf = (double)(now_ns() - start) / (double)iterations;
+
+	start = now_ns();
+	for (i = 0UL; i < iterations; i++)
+	{
+		length += payload_with_format(actual, fields[i % VALUES]);
+	}
+	ns_format = (double)(now_ns() - start) / (double)iterations;
+	sink = length;
+
+	printf("%s{\"run\":\"payload\",\"ns_snprintf\":%.1f,\"ns_format\":%.1f,\"bytes\":%u,\"values\":%u,\"differences\":%u}",
+			first ? "" : ",", ns_snprintf, ns_format, (unsigned int)strlen(actual), VALUES, (unsigned int)differences);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t iterations = DEFAULT_ITERATIONS;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "i:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'i':
+			iterations = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-i iterations]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (iterations < 1000UL || iterations > 100000000UL)
+	{
+		fprintf(stderr, "bad parameter\n");
+		return 1;
+	}
+
+	printf("{\"benchmark\":\"format\",\"iterations\":%u,\"results\":[", (unsigned int)iterations);
+	run_numbers("fixed_1", RUN_FIXED_1, iterations, true);
+	run_numbers("fixed_4", RUN_FIXED_4, iterations, false);
+	run_numbers("degrees_minutes", RUN_DEGREES_MINUTES, iterations, false);
+	run_numbers("uint", RUN_UINT, iterations, false);
+	run_payload(iterations / 10UL, false);
+	printf("]}\n");
+
+	return 0;
+}
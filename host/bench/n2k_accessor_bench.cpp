@@ -0,0 +1,99 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+/*
+n2k_accessor_bench.cpp
+
+Compares the double, float and fixed point versions of ParseN2k and SetN2k
+for the PGNs main.cpp handles, using main/n2k_bench.cpp which the firmware
+also runs on the ESP32 when built with N2K_ACCESSOR_BENCH_CODE. The PC has a
+double precision FPU, so here the paths differ much less than on the ESP32
+where double arithmetic is done in software. The float and fixed point
+results are checked against the double ones first.
+
+Output is a single JSON object on stdout with ns per message parsed and set
+on each path and the number of fields that did not match.
+
+Usage: n2k_accessor_bench [-i iterations]
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "n2k_bench.h"
+
+#define DEFAULT_ITERATIONS 1000000UL
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+	static const char *path_names[N2K_BENCH_PATH_COUNT] = {"double", "float", "fixed"};
+	n2k_bench_result_t result;
+	uint32_t iterations = DEFAULT_ITERATIONS;
+	int opt;
+	uint32_t i;
+
+	while ((opt = getopt(argc, argv, "i:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'i':
+			iterations = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-i iterations]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (iterations < 1UL)
+	{
+		fprintf(stderr, "bad parameter\n");
+		return 1;
+	}
+
+	n2k_bench_run(iterations, now_ns, &result);
+
+	printf("{\"benchmark\":\"n2k_accessor\",\"messages\":%u,\"results\":[", (unsigned int)result.messages);
+	for (i = 0UL; i < N2K_BENCH_PATH_COUNT; i++)
+	{
+		printf("%s{\"path\":\"%s\",\"parse_ns\":%.1f,\"set_ns\":%.1f,\"mismatches\":%u}", i == 0UL ? "" : ",", path_names[i],
+				(double)result.parse_ns[i] / (double)result.messages, (double)result.set_ns[i] / (double)result.messages,
+				(unsigned int)result.mismatches[i]);
+	}
+	printf("]}\n");
+
+	return 0;
+}
@@ -0,0 +1,342 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+n2k_bus_bench.cpp
+
+Floods a virtual 250 kbit/s bus with single frame (127250 heading) and fast
+packet (129029 GNSS position, 7 frames) traffic from a number of sender nodes
+and measures how a receiver configured like BlueBridge copes: ParseMessages()
+called every 10 ms with 16 small and 9 large reassembly slots and the ESP32
+sized rx queue. Everything runs on the virtual clock so results do not depend
+on host load, except the CPU time which is measured per ParseMessages() call.
+
+Usage: n2k_bus_bench [-s senders] [-t seconds] [-p parse_interval_ms] [-m single|fast|mixed]
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "NMEA2000_host.h"
+#include "N2kMessages.h"
+#include "host_time.h"
+
+#define MAX_SENDERS 8
+#define STEP_US 1000LL
+#define WARMUP_MS 1500
+#define RECEIVER_ADDRESS 34
+#define FIRST_SENDER_ADDRESS 40
+
+typedef enum
+{
+	traffic_single,
+	traffic_fast,
+	traffic_mixed
+} traffic_t;
+
+typedef struct
+{
+	uint32_t single_received;
+	uint32_t fast_received;
+} receive_counts_t;
+
+//*****************************************************************************
+// Receiver which remembers which messages lost frames in its rx queue, so that
+// losses caused by the queue can be told apart from losses in reassembly.
+class tBenchReceiver : public tNMEA2000_host
+{
+protected:
+  int LastDamagedKey[256];
+
+  void HandleRxOverrun(const tCANFrame &frame) {
+    unsigned char PF=(unsigned char)(frame.id>>16);
+    unsigned long PGN=((frame.id>>8)&0x1ff00UL) | (PF>=240 ? ((frame.id>>8)&0xffUL) : 0UL);
+    unsigned char Source=(unsigned char)frame.id;
+
+    if ( PGN==129029L ) {
+      int Key=frame.buf[0]>>5; // fast packet sequence counter
+      if ( LastDamagedKey[Source]!=Key ) { LastDamagedKey[Source]=Key; FastDamaged++; }
+    } else if ( PGN==127250L ) {
+      SingleDamaged++;
+    }
+  }
+
+public:
+  uint32_t SingleDamaged;
+  uint32_t FastDamaged;
+
+  tBenchReceiver(tVirtualCANBus *_Bus) : tNMEA2000_host(_Bus) { ResetDamaged(); }
+  void ResetDamaged() {
+    for (int i=0; i<256; i++) LastDamagedKey[i]=-1;
+    SingleDamaged=0;
+    FastDamaged=0;
+  }
+};
+
+static receive_counts_t receive_counts;
+
+static void handle_n2k_message(const tN2kMsg &N2kMsg)
+{
+	if (N2kMsg.PGN == 127250UL)
+	{
+		receive_counts.single_received++;
+	}
+	else if (N2kMsg.PGN == 129029UL)
+	{
+		receive_counts.fast_received++;
+	}
+}
+
+static void run_load(uint32_t load_percent, int senders_count, int seconds, int parse_interval_ms, traffic_t traffic)
+{
+	static const unsigned long receive_messages[] = {127250UL, 129029UL, 0UL};
+	tVirtualCANBus bus(250000UL);
+	tBenchReceiver receiver(&bus);
+	tNMEA2000_host *senders[MAX_SENDERS];
+	double credit_bits[MAX_SENDERS];
+	uint32_t single_sent = 0UL;
+	uint32_t fast_sent = 0UL;
+	uint32_t send_refused = 0UL;
+	uint64_t parse_cpu_ns = 0ULL;
+	int64_t now;
+	int64_t end;
+	int64_t next_parse;
+	uint32_t message_counter = 0UL;
+	int i;
+	tN2kMsg single_message;
+	tN2kMsg fast_message;
+	double bits_per_step;
+	uint32_t single_bits = tVirtualCANBus::FrameBits(8U);
+	uint32_t fast_bits = 7UL * tVirtualCANBus::FrameBits(8U);
+
+	host_time_set_virtual(true);
+	memset(&receive_counts, 0, sizeof(receive_counts));
+
+	receiver.SetN2kCANMsgBufSize(16, 9);
+	receiver.SetMode(tNMEA2000::N2km_ListenAndNode, RECEIVER_ADDRESS);
+	receiver.SetDeviceInformation(1UL, 130U, 25U, 2046U);
+	receiver.EnableForward(false);
+	receiver.ExtendReceiveMessages(receive_messages);
+	receiver.SetMsgHandler(handle_n2k_message);
+	(void)receiver.Open();
+
+	for (i = 0; i < senders_count; i++)
+	{
+		senders[i] = new tNMEA2000_host(&bus);
+		senders[i]->SetMode(tNMEA2000::N2km_NodeOnly, (uint8_t)(FIRST_SENDER_ADDRESS + i));
+		senders[i]->SetDeviceInformation((unsigned long)(100 + i), 145U, 60U, 2046U);
+		senders[i]->EnableForward(false);
+		(void)senders[i]->Open();
+		credit_bits[i] = 0.0;
+	}
+
+	// let address claiming settle
+	for (now = 0LL; now < (int64_t)WARMUP_MS * 1000LL; now += STEP_US)
+	{
+		host_time_advance_us(STEP_US);
+		(void)bus.Run(host_time_get_us());
+		receiver.ParseMessages();
+		for (i = 0; i < senders_count; i++)
+		{
+			senders[i]->ParseMessages();
+		}
+	}
+
+	receiver.ResetStatistics();
+	receiver.ResetDamaged();
+	bus.ResetStatistics();
+	memset(&receive_counts, 0, sizeof(receive_counts));
+
+	bits_per_step = (double)bus.GetBitRate() * ((double)load_percent / 100.0) * ((double)STEP_US / 1000000.0) / (double)senders_count;
+	now = host_time_get_us();
+	end = now + (int64_t)seconds * 1000000LL;
+	next_parse = now;
+
+	while (now < end)
+	{
+		for (i = 0; i < senders_count; i++)
+		{
+			credit_bits[i] += bits_per_step;
+			while (true)
+			{
+				bool fast = (traffic == traffic_fast) || (traffic == traffic_mixed && (message_counter & 1UL));
+				uint32_t cost = fast ? fast_bits : single_bits;
+
+				if (credit_bits[i] < (double)cost)
+				{
+					break;
+				}
+				credit_bits[i] -= (double)cost;
+				message_counter++;
+
+				if (fast)
+				{
+					SetN2kGNSS(fast_message, (unsigned char)message_counter, 19000U, 43200.0 + (double)message_counter,
+							50.1 + (double)i / 1000.0, -1.3, 12.0, N2kGNSSt_GPS, N2kGNSSm_GNSSfix, 9U, 0.9, 1.8);
+					if (senders[i]->SendMsg(fast_message))
+					{
+						fast_sent++;
+					}
+					else
+					{
+						send_refused++;
+					}
+				}
+				else
+				{
+					SetN2kTrueHeading(single_message, (unsigned char)message_counter, 1.0 + (double)i / 100.0);
+					if (senders[i]->SendMsg(single_message))
+					{
+						single_sent++;
+					}
+					else
+					{
+						send_refused++;
+					}
+				}
+			}
+		}
+
+		host_time_advance_us(STEP_US);
+		now = host_time_get_us();
+		(void)bus.Run(now);
+
+		if (now >= next_parse)
+		{
+			uint64_t start_cpu = host_time_get_cpu_ns();
+
+			receiver.ParseMessages();
+			parse_cpu_ns += host_time_get_cpu_ns() - start_cpu;
+			for (i = 0; i < senders_count; i++)
+			{
+				senders[i]->ParseMessages();
+			}
+			next_parse += (int64_t)parse_interval_ms * 1000LL;
+		}
+	}
+
+	// drain what is still queued so that it is not counted as lost
+	for (i = 0; i < 200; i++)
+	{
+		host_time_advance_us(STEP_US);
+		(void)bus.Run(host_time_get_us());
+		if (i % parse_interval_ms == 0)
+		{
+			receiver.ParseMessages();
+		}
+	}
+
+	{
+		const tNMEA2000_host::tStatistics &stats = receiver.GetStatistics();
+		double bus_load = 100.0 * (double)bus.GetBitCount() / ((double)bus.GetBitRate() * (double)seconds);
+		uint32_t single_lost = single_sent > receive_counts.single_received ? single_sent - receive_counts.single_received : 0UL;
+		uint32_t fast_lost = fast_sent > receive_counts.fast_received ? fast_sent - receive_counts.fast_received : 0UL;
+		uint32_t reassembly_drops = fast_lost > receiver.FastDamaged ? fast_lost - receiver.FastDamaged : 0UL;
+
+		printf("%7u%% %7.1f%% %9.0f %9u %9u %9u %9u %9u %9u %9u %8u %9.0f\n",
+				load_percent,
+				bus_load,
+				(double)bus.GetFrameCount() / (double)seconds,
+				single_sent,
+				single_lost,
+				fast_sent,
+				fast_lost,
+				send_refused,
+				reassembly_drops,
+				stats.RxOverruns,
+				stats.RxHighWater,
+				stats.RxRead > 0UL ? (double)parse_cpu_ns / (double)stats.RxRead : 0.0);
+	}
+
+	for (i = 0; i < senders_count; i++)
+	{
+		delete senders[i];
+	}
+}
+
+int main(int argc, char **argv)
+{
+	static const uint32_t loads[] = {10UL, 25UL, 50UL, 75UL, 90UL, 100UL};
+	int senders_count = 3;
+	int seconds = 10;
+	int parse_interval_ms = 10;
+	traffic_t traffic = traffic_mixed;
+	int opt;
+	size_t i;
+
+	while ((opt = getopt(argc, argv, "s:t:p:m:")) != -1)
+	{
+		switch (opt)
+		{
+		case 's':
+			senders_count = atoi(optarg);
+			break;
+
+		case 't':
+			seconds = atoi(optarg);
+			break;
+
+		case 'p':
+			parse_interval_ms = atoi(optarg);
+			break;
+
+		case 'm':
+			if (strcmp(optarg, "single") == 0)
+			{
+				traffic = traffic_single;
+			}
+			else if (strcmp(optarg, "fast") == 0)
+			{
+				traffic = traffic_fast;
+			}
+			else
+			{
+				traffic = traffic_mixed;
+			}
+			break;
+
+		default:
+			fprintf(stderr, "usage: %s [-s senders] [-t seconds] [-p parse_interval_ms] [-m single|fast|mixed]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (senders_count < 1 || senders_count > MAX_SENDERS || seconds < 1 || parse_interval_ms < 1)
+	{
+		fprintf(stderr, "bad parameter\n");
+		return 1;
+	}
+
+	printf("senders %d, %d s per load, parse every %d ms, traffic %s\n",
+			senders_count, seconds, parse_interval_ms,
+			traffic == traffic_single ? "single" : (traffic == traffic_fast ? "fast" : "mixed"));
+	printf("  offer     load  frames/s  1f sent   1f lost  fp sent   fp lost   refused  reasm dr  overruns  rx hwm  ns/frame\n");
+	for (i = 0; i < sizeof(loads) / sizeof(loads[0]); i++)
+	{
+		run_load(loads[i], senders_count, seconds, parse_interval_ms, traffic);
+	}
+
+	return 0;
+}
@@ -0,0 +1,481 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+/*
+n2k_classify_bench.cpp
+
+Measures the cost of classifying a received PGN as known, system and fast
+packet, which tNMEA2000 does for every frame in CheckKnownMessage(), and of
+IsFastPacketPGN(), which it does for every message sent. A node is set up as
+on a busy bus with 120 PGNs registered with ExtendSingleFrameMessages() and
+ExtendFastPacketMessages() on top of the library defaults, and each lookup is
+timed over several PGN mixes: default PGNs, the last registered PGNs,
+unknown PGNs and a mix like a Raymarine bus. A hash of the classification of
+every possible PGN is printed so that changes to the lookup can be checked
+to give the same answers. The same lookups are also timed with the linear
+search the library used before the hash index, the default PGN switch lists
+and a walk of every registered PGN list, over the same registered PGNs. The
+number of PGNs the two classify differently is printed; it is 1 as the old
+walk matched PGN 0 against the list terminator and sent it as fast packet.
+
+Output is a single JSON object on stdout.
+
+Usage: n2k_classify_bench [-i iterations]
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "NMEA2000_host.h"
+
+#define DEFAULT_ITERATIONS 2000000UL
+#define REGISTERED_PER_LIST 60
+#define PGN_MAX 0x1ffffUL
+#define MESSAGE_GROUPS 2
+
+typedef struct
+{
+	const char *name;
+	const unsigned long *pgns;
+	size_t count;
+} pgn_mix_t;
+
+//*****************************************************************************
+// Gives the benchmark access to the protected classification functions.
+class tClassifyNode : public tNMEA2000_host
+{
+public:
+  tClassifyNode(tVirtualCANBus *_Bus) : tNMEA2000_host(_Bus) {}
+  bool Classify(unsigned long PGN, bool &SystemMessage, bool &FastPacket) { return CheckKnownMessage(PGN,SystemMessage,FastPacket); }
+  bool SendsAsFastPacket(unsigned long PGN) { return IsFastPacketPGN(PGN); }
+};
+
+//*****************************************************************************
+// The linear search classification the library used before the hash index,
+// walking the same registered PGN lists as the node.
+class tLinearClassifier
+{
+public:
+  const unsigned long *SingleFrameMessages[MESSAGE_GROUPS];
+  const unsigned long *FastPacketMessages[MESSAGE_GROUPS];
+  bool Classify(unsigned long PGN, bool &SystemMessage, bool &FastPacket);
+  bool SendsAsFastPacket(unsigned long PGN);
+};
+
+static unsigned long single_frame_pgns[REGISTERED_PER_LIST + 1];
+static unsigned long fast_packet_pgns[REGISTERED_PER_LIST + 1];
+static volatile uint32_t sink;
+
+static const unsigned long default_pgns[] = {127250UL, 129025UL, 130306UL, 127245UL, 127488UL, 129026UL, 128267UL, 129029UL};
+static const unsigned long tail_pgns[] = {65339UL, 65338UL, 65337UL, 127659UL, 127658UL, 127657UL};
+static const unsigned long unknown_pgns[] = {65000UL, 126000UL, 127999UL, 61000UL, 131000UL, 60000UL};
+// heading, position, wind, rudder, engine, proprietary single frame and fast packet, and unknown
+static const unsigned long raymarine_pgns[] = {127250UL, 129025UL, 130306UL, 127245UL, 127488UL, 65288UL, 65311UL, 65300UL,
+		126720UL, 130845UL, 129029UL, 129026UL, 128259UL, 65359UL, 130850UL, 127237UL};
+
+static bool linear_single_frame_system(unsigned long pgn)
+{
+	switch (pgn)
+	{
+	case 59392UL: // ISO Acknowledgement
+	case 60160UL: // Multi packet data transfer, TP.DT
+	case 60416UL: // Multi packet connection management, TP.CM
+	case 59904UL: // ISO Request
+	case 60928UL: // ISO Address Claim
+		return true;
+	}
+
+	return false;
+}
+
+static bool linear_fast_packet_system(unsigned long pgn)
+{
+	switch (pgn)
+	{
+	case 65240UL: // Commanded Address
+	case 126208UL: // NMEA Request/Command/Acknowledge group function
+		return true;
+	}
+
+	return false;
+}
+
+static bool linear_default_single_frame(unsigned long pgn)
+{
+	switch (pgn)
+	{
+	case 126992UL: // System date/time, pri=3, period=1000
+	case 126993UL: // Heartbeat, pri=7, period=60000
+	case 127245UL: // Rudder, pri=2, period=100
+	case 127250UL: // Vessel Heading, pri=2, period=100
+	case 127251UL: // Rate of Turn, pri=2, period=100
+	case 127257UL: // Attitude, pri=3, period=1000
+	case 127488UL: // Engine parameters rapid, rapid Update, pri=2, period=100
+	case 127493UL: // Transmission parameters: dynamic, pri=2, period=100
+	case 127501UL: // Binary status report, pri=3, period=NA
+	case 127505UL: // Fluid level, pri=6, period=2500
+	case 127508UL: // Battery Status, pri=6, period=1500
+	case 128259UL: // Boat speed, pri=2, period=1000
+	case 128267UL: // Water depth, pri=3, period=1000
+	case 129025UL: // Lat/lon rapid, pri=2, period=100
+	case 129026UL: // COG SOG rapid, pri=2, period=250
+	case 129283UL: // Cross Track Error, pri=3, period=1000
+	case 130306UL: // Wind Speed, pri=2, period=100
+	case 130310UL: // Outside Environmental parameters, pri=5, period=500
+	case 130311UL: // Environmental parameters, pri=5, period=500
+	case 130312UL: // Temperature, pri=5, period=2000
+	case 130313UL: // Humidity, pri=5, period=2000
+	case 130314UL: // Pressure, pri=5, period=2000
+	case 130316UL: // Temperature extended range, pri=5, period=NA
+	case 130576UL: // Small Craft Status (Trim Tab position), pri=2, period=200
+		return true;
+	}
+
+	return false;
+}
+
+static bool linear_mandatory_fast_packet(unsigned long pgn)
+{
+	switch (pgn)
+	{
+	case 126464UL: // PGN List (Transmit and Receive), pri=6, period=NA
+	case 126996UL: // Product information, pri=6, period=NA
+	case 126998UL: // Configuration information, pri=6, period=NA
+		return true;
+	}
+
+	return false;
+}
+
+static bool linear_default_fast_packet(unsigned long pgn)
+{
+	switch (pgn)
+	{
+	case 126983UL: // Alert, pri=2, period=1000
+	case 126984UL: // Alert Response, pri=2, period=NA
+	case 126985UL: // Alert Text, pri=2, period=10000
+	case 126986UL: // Alert Configuration, pri=2, period=NA
+	case 126987UL: // Alert Threshold, pri=2, period=NA
+	case 126988UL: // Alert Value, pri=2, period=10000
+	case 127233UL: // Alert Value, pri=3, period=NA
+	case 127237UL: // Heading/Track control, pri=2, period=250
+	case 127489UL: // Engine parameters dynamic, pri=2, period=500
+	case 127496UL: // Trip fuel consumption, vessel, pri=5, period=1000
+	case 127497UL: // Trip fuel consumption, engine, pri=5, period=1000
+	case 127498UL: // Engine parameters static, pri=5, period=NA
+	case 127503UL: // AC Input Status, pri=6, period=1500
+	case 127504UL: // AC Output Status, pri=6, period=1500
+	case 127506UL: // DC Detailed status, pri=6, period=1500
+	case 127507UL: // Charger status, pri=6, period=1500
+	case 127509UL: // Inverter status, pri=6, period=1500
+	case 127510UL: // Charger configuration status, pri=6, period=NA
+	case 127511UL: // Inverter Configuration Status, pri=6, period=NA
+	case 127512UL: // AGS configuration status, pri=6, period=NA
+	case 127513UL: // Battery configuration status, pri=6, period=NA
+	case 127514UL: // AGS Status, pri=6, period=1500
+	case 128275UL: // Distance log, pri=6, period=1000
+	case 128520UL: // Tracked Target Data, pri=2, period=1000
+	case 129029UL: // GNSS Position Data, pri=3, period=1000
+	case 129038UL: // AIS Class A Position Report, pri=4, period=NA
+	case 129039UL: // AIS Class B Position Report, pri=4, period=NA
+	case 129040UL: // AIS Class B Extended Position Report, pri=4, period=NA
+	case 129041UL: // AIS Aids to Navigation (AtoN) Report, pri=4, period=NA
+	case 129044UL: // Datum, pri=6, period=10000
+	case 129045UL: // User Datum Settings, pri=6, period=NA
+	case 129284UL: // Navigation info, pri=3, period=1000
+	case 129285UL: // Waypoint list, pri=3, period=NA
+	case 129301UL: // Time to/from Mark, pri=3, period=1000
+	case 129302UL: // Bearing and Distance between two Marks, pri=6, period=NA
+	case 129538UL: // GNSS Control Status, pri=6, period=NA
+	case 129540UL: // GNSS Sats in View, pri=6, period=1000
+	case 129541UL: // GPS Almanac Data, pri=6, period=NA
+	case 129542UL: // GNSS Pseudorange Noise Statistics, pri=6, period=1000
+	case 129545UL: // GNSS RAIM Output, pri=6, period=NA
+	case 129547UL: // GNSS Pseudorange Error Statistics, pri=6, period=NA
+	case 129549UL: // DGNSS Corrections, pri=6, period=NA
+	case 129551UL: // GNSS Differential Correction Receiver Signal, pri=6, period=NA
+	case 129556UL: // GLONASS Almanac Data, pri=6, period=NA
+	case 129792UL: // AIS DGNSS Broadcast Binary Message, pri=6, period=NA
+	case 129793UL: // AIS UTC and Date Report, pri=7, period=NA
+	case 129794UL: // AIS Class A Static data, pri=6, period=NA
+	case 129795UL: // AIS Addressed Binary Message, pri=5, period=NA
+	case 129796UL: // AIS Acknowledge, pri=7, period=NA
+	case 129797UL: // AIS Binary Broadcast Message, pri=5, period=NA
+	case 129798UL: // AIS SAR Aircraft Position Report, pri=4, period=NA
+	case 129799UL: // Radio Frequency/Mode/Power, pri=3, period=NA
+	case 129800UL: // AIS UTC/Date Inquiry, pri=7, period=NA
+	case 129801UL: // AIS Addressed Safety Related Message, pri=5, period=NA
+	case 129802UL: // AIS Safety Related Broadcast Message, pri=5, period=NA
+	case 129803UL: // AIS Interrogation PGN, pri=7, period=NA
+	case 129804UL: // AIS Assignment Mode Command, pri=7, period=NA
+	case 129805UL: // AIS Data Link Management Message, pri=7, period=NA
+	case 129806UL: // AIS Channel Management, pri=7, period=NA
+	case 129807UL: // AIS Group Assignment, pri=7, period=NA
+	case 129808UL: // DSC Call Information, pri=8, period=NA
+	case 129809UL: // AIS Class B Static Data: Part A, pri=6, period=NA
+	case 129810UL: // AIS Class B Static Data Part B, pri=6, period=NA
+	case 129811UL: // AIS Single Slot Binary Message, pri=5, period=NA
+	case 129812UL: // AIS Multi Slot Binary Message, pri=5, period=NA
+	case 129813UL: // AIS Long-Range Broadcast Message, pri=5, period=NA
+	case 130052UL: // Loran-C TD Data, pri=3, period=1000
+	case 130053UL: // Loran-C Range Data, pri=3, period=1000
+	case 130054UL: // Loran-C Signal Data, pri=3, period=1000
+	case 130060UL: // Label, pri=7, period=NA
+	case 130061UL: // Channel Source Configuration, pri=7, period=NA
+	case 130064UL: // Route and WP Service - Database List, pri=7, period=NA
+	case 130065UL: // Route and WP Service - Route List, pri=7, period=NA
+	case 130066UL: // Route and WP Service - Route/WP-List Attributes, pri=7, period=NA
+	case 130067UL: // Route and WP Service - Route - WP Name & Position, pri=7, period=NA
+	case 130068UL: // Route and WP Service - Route - WP Name, pri=7, period=NA
+	case 130069UL: // Route and WP Service - XTE Limit & Navigation Method, pri=7, period=NA
+	case 130070UL: // Route and WP Service - WP Comment, pri=7, period=NA
+	case 130071UL: // Route and WP Service - Route Comment, pri=7, period=NA
+	case 130072UL: // Route and WP Service - Database Comment, pri=7, period=NA
+	case 130073UL: // Route and WP Service - Radius of Turn, pri=7, period=NA
+	case 130074UL: // Route and WP Service - WP List - WP Name & Position, pri=7, period=NA
+	case 130320UL: // Tide Station Data, pri=6, period=1000
+	case 130321UL: // Salinity Station Data, pri=6, period=1000
+	case 130322UL: // Current Station Data, pri=6, period=1000
+	case 130323UL: // Meteorological Station Data, pri=6, period=1000
+	case 130324UL: // Moored Buoy Station Data, pri=6, period=1000
+	case 130567UL: // Watermaker Input Setting and Status, pri=6, period=2500
+	case 130577UL: // Direction Data PGN, pri=3, period=1000
+	case 130578UL: // Vessel Speed Components, pri=2, period=250
+		return true;
+	}
+
+	return false;
+}
+
+static bool linear_proprietary_fast_packet(unsigned long pgn)
+{
+	return pgn == 126720UL || (130816UL <= pgn && pgn <= 131071UL);
+}
+
+//*****************************************************************************
+bool tLinearClassifier::Classify(unsigned long PGN, bool &SystemMessage, bool &FastPacket) {
+  int i;
+
+  FastPacket=false;
+  SystemMessage=false;
+  if ( PGN==0 ) { return false; }
+
+  if ( SingleFrameMessages[0]==0 && linear_default_single_frame(PGN) ) return true;
+  if ( (FastPacket=linear_mandatory_fast_packet(PGN)) ) return true;
+  if ( FastPacketMessages[0]==0 && (FastPacket=linear_default_fast_packet(PGN))==true ) return true;
+
+  if ( linear_single_frame_system(PGN) || (FastPacket=linear_fast_packet_system(PGN))==true ) {
+    SystemMessage=true;
+    return true;
+  }
+
+  for (unsigned char igroup=0; igroup<MESSAGE_GROUPS; igroup++) {
+    if (SingleFrameMessages[igroup]!=0) {
+      for (i=0; SingleFrameMessages[igroup][i]!=PGN && SingleFrameMessages[igroup][i]!=0; i++);
+      if (SingleFrameMessages[igroup][i]==PGN) return true;
+    }
+
+    if (FastPacketMessages[igroup]!=0) {
+      for (i=0; FastPacketMessages[igroup][i]!=PGN && FastPacketMessages[igroup][i]!=0; i++);
+      if (FastPacketMessages[igroup][i]==PGN) {
+        FastPacket=true;
+        return true;
+      }
+    }
+  }
+
+  FastPacket=linear_proprietary_fast_packet(PGN);
+
+  return false;
+}
+
+//*****************************************************************************
+bool tLinearClassifier::SendsAsFastPacket(unsigned long PGN) {
+  int i;
+
+  if ( linear_fast_packet_system(PGN) || linear_mandatory_fast_packet(PGN) ||
+       ( FastPacketMessages[0]==0 && linear_default_fast_packet(PGN) ) ||
+       linear_proprietary_fast_packet(PGN) ) return true;
+
+  for (unsigned char igroup=0; igroup<MESSAGE_GROUPS; igroup++) {
+    if (FastPacketMessages[igroup]!=0) {
+      for (i=0; FastPacketMessages[igroup][i]!=PGN && FastPacketMessages[igroup][i]!=0; i++);
+      if (FastPacketMessages[igroup][i]==PGN) return true;
+    }
+  }
+
+  return false;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+template <class tClassifier>
+static double time_classify(tClassifier &node, const pgn_mix_t &mix, uint32_t iterations)
+{
+	uint64_t start;
+	uint32_t i;
+	uint32_t known = 0UL;
+	bool system_message;
+	bool fast_packet;
+
+	start = now_ns();
+	for (i = 0UL; i < iterations; i++)
+	{
+		known += node.Classify(mix.pgns[i % mix.count], system_message, fast_packet) ? 1UL : 0UL;
+		known += fast_packet ? 2UL : 0UL;
+	}
+	sink = known;
+
+	return (double)(now_ns() - start) / (double)iterations;
+}
+
+template <class tClassifier>
+static double time_send(tClassifier &node, const pgn_mix_t &mix, uint32_t iterations)
+{
+	uint64_t start;
+	uint32_t i;
+	uint32_t fast = 0UL;
+
+	start = now_ns();
+	for (i = 0UL; i < iterations; i++)
+	{
+		fast += node.SendsAsFastPacket(mix.pgns[i % mix.count]) ? 1UL : 0UL;
+	}
+	sink = fast;
+
+	return (double)(now_ns() - start) / (double)iterations;
+}
+
+static uint32_t classification_hash(tClassifyNode &node)
+{
+	uint32_t hash = 2166136261UL;
+	unsigned long pgn;
+	bool system_message;
+	bool fast_packet;
+	uint8_t value;
+
+	for (pgn = 0UL; pgn <= PGN_MAX; pgn++)
+	{
+		value = node.Classify(pgn, system_message, fast_packet) ? 1U : 0U;
+		value |= system_message ? 2U : 0U;
+		value |= fast_packet ? 4U : 0U;
+		value |= node.SendsAsFastPacket(pgn) ? 8U : 0U;
+		hash = (hash ^ value) * 16777619UL;
+	}
+
+	return hash;
+}
+
+static uint32_t linear_differences(tClassifyNode &node, tLinearClassifier &linear)
+{
+	uint32_t differences = 0UL;
+	unsigned long pgn;
+	bool system_message[2];
+	bool fast_packet[2];
+
+	for (pgn = 0UL; pgn <= PGN_MAX; pgn++)
+	{
+		if (node.Classify(pgn, system_message[0], fast_packet[0]) != linear.Classify(pgn, system_message[1], fast_packet[1]) ||
+				system_message[0] != system_message[1] || fast_packet[0] != fast_packet[1] ||
+				node.SendsAsFastPacket(pgn) != linear.SendsAsFastPacket(pgn))
+		{
+			differences++;
+		}
+	}
+
+	return differences;
+}
+
+int main(int argc, char **argv)
+{
+	static const pgn_mix_t mixes[] =
+	{
+		{"default", default_pgns, sizeof(default_pgns) / sizeof(default_pgns[0])},
+		{"registered_tail", tail_pgns, sizeof(tail_pgns) / sizeof(tail_pgns[0])},
+		{"unknown", unknown_pgns, sizeof(unknown_pgns) / sizeof(unknown_pgns[0])},
+		{"raymarine_bus", raymarine_pgns, sizeof(raymarine_pgns) / sizeof(raymarine_pgns[0])}
+	};
+	uint32_t iterations = DEFAULT_ITERATIONS;
+	tVirtualCANBus bus(250000UL);
+	tClassifyNode node(&bus);
+	tLinearClassifier linear = {{NULL, single_frame_pgns}, {NULL, fast_packet_pgns}};
+	int opt;
+	size_t i;
+
+	while ((opt = getopt(argc, argv, "i:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'i':
+			iterations = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-i iterations]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (iterations == 0UL)
+	{
+		fprintf(stderr, "bad parameter\n");
+		return 1;
+	}
+
+	// proprietary single frame PGNs and PDU2 PGNs outside the library defaults, as a Raymarine bus would need
+	for (i = 0U; i < REGISTERED_PER_LIST; i++)
+	{
+		single_frame_pgns[i] = 65280UL + i;
+		fast_packet_pgns[i] = 127600UL + i;
+	}
+	single_frame_pgns[REGISTERED_PER_LIST] = 0UL;
+	fast_packet_pgns[REGISTERED_PER_LIST] = 0UL;
+	node.ExtendSingleFrameMessages(single_frame_pgns);
+	node.ExtendFastPacketMessages(fast_packet_pgns);
+	node.SetMode(tNMEA2000::N2km_ListenOnly);
+	node.Open();
+
+	printf("{\"benchmark\":\"n2k_classify\",\"iterations\":%u,\"registered_pgns\":%u,\"classification_hash\":\"%08x\",\"linear_differences\":%u,\"results\":[",
+			(unsigned int)iterations, (unsigned int)(2 * REGISTERED_PER_LIST), (unsigned int)classification_hash(node),
+			(unsigned int)linear_differences(node, linear));
+	for (i = 0U; i < sizeof(mixes) / sizeof(mixes[0]); i++)
+	{
+		printf("%s{\"mix\":\"%s\",\"receive_ns\":%.1f,\"send_ns\":%.1f,", i == 0U ? "" : ",", mixes[i].name,
+				time_classify(node, mixes[i], iterations), time_send(node, mixes[i], iterations));
+		printf("\"linear_receive_ns\":%.1f,\"linear_send_ns\":%.1f}",
+				time_classify(linear, mixes[i], iterations), time_send(linear, mixes[i], iterations));
+	}
+	printf("]}\n");
+
+	return 0;
+}
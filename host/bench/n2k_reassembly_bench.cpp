@@ -0,0 +1,252 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+/*
+n2k_reassembly_bench.cpp
+
+Measures the cost per frame of fast packet reassembly in tNMEA2000 when
+several sources send at the same time. Each source sends GNSS position
+(129029, 43 bytes, 7 frames) and AIS class A static data (129794, 75 bytes,
+11 frames) in turn and the frames of all sources are interleaved one by one,
+so every source has a message in reception all the time. Frames are given
+straight to the reassembly, the CAN driver and message handlers are not
+timed. The receiver has the message buffer sizes BlueBridge uses.
+
+Output is a single JSON object on stdout with, for each number of sources,
+ns per frame, messages completed and messages lost.
+
+Usage: n2k_reassembly_bench [-f frames] [-s small_slots] [-l large_slots]
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "NMEA2000_host.h"
+#include "N2kMessages.h"
+
+#define DEFAULT_FRAMES 2000000UL
+#define DEFAULT_SMALL_SLOTS 16
+#define DEFAULT_LARGE_SLOTS 9
+#define FIRST_SOURCE 10
+#define MAX_SOURCES 32
+#define MAX_MESSAGE_FRAMES 32
+
+typedef struct
+{
+	unsigned long id;
+	uint8_t frame_count;
+	uint8_t frames[MAX_MESSAGE_FRAMES][8];
+} message_frames_t;
+
+typedef struct
+{
+	const message_frames_t *message[2];
+	uint8_t next_message;
+	uint8_t next_frame;
+	uint8_t sequence;
+} source_t;
+
+//*****************************************************************************
+// Gives the benchmark access to the protected reassembly.
+class tReassemblyNode : public tNMEA2000_host
+{
+public:
+  tReassemblyNode(tVirtualCANBus *_Bus) : tNMEA2000_host(_Bus) {}
+  bool Receive(unsigned long id, unsigned char len, unsigned char *buf, unsigned long CurTime) {
+    tN2kCANMsg *RxMsg=SetN2kCANBufMsg(id,len,buf,CurTime);
+    if ( RxMsg==0 ) return false;
+    RxMsg->FreeMessage();
+    return true;
+  }
+  size_t GetBufferBytes() const {
+    return (size_t)N2kCANMsgPool.GetSmallSlots()*tN2kCANMsgPool::SmallDataLen +
+           (size_t)N2kCANMsgPool.GetLargeSlots()*tN2kMsg::MaxDataLen +
+           (size_t)(N2kCANMsgPool.GetSmallSlots()+N2kCANMsgPool.GetLargeSlots())*sizeof(tN2kCANMsgPool::tSlot) +
+           sizeof(tN2kCANMsg);
+  }
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Splits a message to fast packet frames with sequence counter 0, as tNMEA2000::SendMsg does
+static void make_frames(const tN2kMsg &msg, unsigned char source, message_frames_t &out)
+{
+	int copied = 0;
+	int frame;
+	int i;
+
+	out.id = ((unsigned long)(msg.Priority & 0x7U) << 26) | (msg.PGN << 8) | source;
+	memset(out.frames, 0xff, sizeof(out.frames));
+	out.frames[0][0] = 0U;
+	out.frames[0][1] = (uint8_t)msg.DataLen;
+	for (i = 2; i < 8 && copied < msg.DataLen; i++)
+	{
+		out.frames[0][i] = msg.Data[copied++];
+	}
+	for (frame = 1; copied < msg.DataLen && frame < MAX_MESSAGE_FRAMES; frame++)
+	{
+		out.frames[frame][0] = (uint8_t)frame;
+		for (i = 1; i < 8 && copied < msg.DataLen; i++)
+		{
+			out.frames[frame][i] = msg.Data[copied++];
+		}
+	}
+	out.frame_count = (uint8_t)frame;
+}
+
+static void run_sources(int sources_count, uint32_t frames, int small_slots, int large_slots, bool first)
+{
+	static message_frames_t messages[MAX_SOURCES][2];
+	source_t sources[MAX_SOURCES];
+	tVirtualCANBus bus(250000UL);
+	tReassemblyNode node(&bus);
+	tN2kMsg msg;
+	char callsign[] = "OH1234";
+	char name[] = "BLUEBRIDGE";
+	char destination[] = "HELSINKI";
+	uint32_t in_reception = 0UL;
+	uint32_t started = 0UL;
+	uint32_t completed = 0UL;
+	uint32_t frame;
+	uint64_t start;
+	double ns_per_frame;
+	int i;
+
+	node.SetN2kCANMsgBufSize((uint8_t)small_slots, (uint8_t)large_slots);
+	node.SetMode(tNMEA2000::N2km_ListenOnly);
+	node.Open();
+
+	for (i = 0; i < sources_count; i++)
+	{
+		SetN2kGNSS(msg, 1, 19000U, 43200.0 + i, 50.1 + i * 0.01, -1.2, 12.0, N2kGNSSt_GPS, N2kGNSSm_GNSSfix, 9, 0.8, 1.2, 47.0, 0,
+				N2kGNSSt_GPS, 0, 0.0);
+		make_frames(msg, (unsigned char)(FIRST_SOURCE + i), messages[i][0]);
+		SetN2kAISClassAStatic(msg, 5, N2kaisr_First, 230000000UL + i, 9000000UL + i, callsign, name, 36, 12.0, 4.0, 2.0,
+				6.0, 19000U, 43200.0, 3.5, destination, N2kaisv_ITU_R_M_1371_3, N2kGNSSt_GPS, N2kaisdte_Ready,
+				N2kaisti_Channel_A_VDL_reception);
+		make_frames(msg, (unsigned char)(FIRST_SOURCE + i), messages[i][1]);
+		sources[i].message[0] = &messages[i][0];
+		sources[i].message[1] = &messages[i][1];
+		sources[i].next_message = (uint8_t)(i & 1);
+		sources[i].next_frame = 0U;
+		sources[i].sequence = 0U;
+	}
+
+	start = now_ns();
+	for (frame = 0UL; frame < frames; frame++)
+	{
+		source_t &source = sources[frame % (uint32_t)sources_count];
+		const message_frames_t &message = *source.message[source.next_message];
+		uint8_t buf[8];
+
+		memcpy(buf, message.frames[source.next_frame], 8U);
+		buf[0] = (uint8_t)(buf[0] | (source.sequence << 5));
+		if (source.next_frame == 0U)
+		{
+			started++;
+		}
+		if (node.Receive(message.id, 8U, buf, frame / 1000UL))
+		{
+			completed++;
+		}
+		if (++source.next_frame >= message.frame_count)
+		{
+			source.next_frame = 0U;
+			source.next_message ^= 1U;
+			source.sequence = (uint8_t)((source.sequence + 1U) & 0x7U);
+		}
+	}
+	ns_per_frame = (double)(now_ns() - start) / (double)frames;
+
+	// messages still in reception at the end are not counted as lost
+	for (i = 0; i < sources_count; i++)
+	{
+		in_reception += (sources[i].next_frame != 0U) ? 1UL : 0UL;
+	}
+	printf("%s{\"sources\":%d,\"ns_per_frame\":%.1f,\"completed\":%u,\"lost\":%u}", first ? "" : ",", sources_count, ns_per_frame,
+			(unsigned int)completed, (unsigned int)(started - completed - in_reception));
+}
+
+int main(int argc, char **argv)
+{
+	static const int sources_counts[] = {1, 2, 4, 8, 16, 24, 32};
+	uint32_t frames = DEFAULT_FRAMES;
+	int small_slots = DEFAULT_SMALL_SLOTS;
+	int large_slots = DEFAULT_LARGE_SLOTS;
+	int opt;
+	size_t i;
+
+	while ((opt = getopt(argc, argv, "f:s:l:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'f':
+			frames = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 's':
+			small_slots = atoi(optarg);
+			break;
+		case 'l':
+			large_slots = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-f frames] [-s small_slots] [-l large_slots]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (frames < 1000UL || small_slots < 0 || large_slots < 0 || small_slots + large_slots < 1 || small_slots + large_slots > 128)
+	{
+		fprintf(stderr, "bad parameter\n");
+		return 1;
+	}
+
+	{
+		tVirtualCANBus bus(250000UL);
+		tReassemblyNode node(&bus);
+
+		node.SetN2kCANMsgBufSize((uint8_t)small_slots, (uint8_t)large_slots);
+		node.Open();
+		printf("{\"benchmark\":\"n2k_reassembly\",\"frames\":%u,\"small_slots\":%d,\"large_slots\":%d,\"buffer_bytes\":%u,\"results\":[",
+				(unsigned int)frames, small_slots, large_slots, (unsigned int)node.GetBufferBytes());
+	}
+	for (i = 0U; i < sizeof(sources_counts) / sizeof(sources_counts[0]); i++)
+	{
+		run_sources(sources_counts[i], frames, small_slots, large_slots, i == 0U);
+	}
+	printf("]}\n");
+
+	return 0;
+}
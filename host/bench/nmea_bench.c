@@ -0,0 +1,724 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+nmea_bench.c
+
+Measures the NMEA0183 encoders and decoders in main/nmea.c, which run from the
+25 ms timer callback. Each decoder is run over a corpus of real sentences and
+each encoder over typical data, reporting ns per sentence, bytes per second and
+the stack used. The traffic scenario feeds GPS and AIS sentences into port 0 at
+38400 baud and again at 115200 baud with three times the AIS, and transmits
+the same Bluetooth message set as main.cpp through nmea_process(), called
+every 25 ms of virtual time or sooner when it asks to be. A third run repeats
+the first with the Bluetooth port limited to fewer bytes per second than the
+messages need, so sentences wait in the output queues and the lower priority
+classes lose the most. It reports the CPU time per simulated second, the worst
+nmea_process() call, the receive framing counters and the output queue
+counters of each class. Every tenth second has one sentence with a bad
+checksum, one too long and one cut short by the next, so each of those
+counters should be a tenth of the simulated seconds. Stack figures come
+from the host compiler and C library, so they are for comparing releases rather
+than sizing ESP32 task stacks.
+
+Output is a single JSON object on stdout.
+
+Usage: nmea_bench [-i iterations] [-s simulated_seconds] [-a ais_sentences_per_second] [-b limited_bluetooth_bytes_per_second]
+
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "nmea.h"
+#include "serial.h"
+#include "host_time.h"
+
+#define DEFAULT_ITERATIONS 200000UL
+#define DEFAULT_SECONDS 60UL
+#define DEFAULT_AIS_PER_SECOND 20UL
+#define DEFAULT_LIMITED_RATE 800UL
+#define PROCESS_PERIOD_MS 25UL
+#define N0183_BAUD 38400UL
+#define N0183_FAST_BAUD 115200UL
+#define ERROR_PERIOD_S 10UL
+#define MEASURE_STACK_SIZE (64U * 1024U)
+#define STACK_PAINT 0xa5U
+#define PORT_N0183 0U
+#define PORT_BLUETOOTH 1U
+#define ARRAY_LENGTH(a) (sizeof(a) / sizeof((a)[0]))
+
+typedef struct
+{
+	const char *name;
+	void (*run)(size_t index);		// process item index of the corpus once
+	size_t corpus_length;
+	size_t (*item_bytes)(size_t index);
+} bench_t;
+
+typedef struct
+{
+	const bench_t *bench;
+	uint32_t iterations;
+} stack_job_t;
+
+// real world sentences, from receiver manuals, gpsd test logs and AIS feeds
+static const char *const rmc_corpus[] = {
+	"$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n",
+	"$GPRMC,225446,A,4916.45,N,12311.12,W,000.5,054.7,191194,020.3,E*68\r\n",
+	"$GPRMC,092750.000,A,5321.6802,N,00630.3372,W,0.02,31.66,280511,,,A*43\r\n",
+	"$GPRMC,161229.487,A,3723.2475,N,12158.3416,W,0.13,309.62,120598,,*10\r\n",
+	"$GPRMC,001225,A,2832.1834,N,08101.0536,W,12,25,251211,1.2,E,A*03\r\n",
+	"$GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62\r\n",
+	"$GPRMC,144326.00,A,5107.0017737,N,11402.3291611,W,0.080,323.3,210307,0.0,E,A*20\r\n",
+	"$GPRMC,,V,,,,,,,,,,N*53\r\n"
+};
+
+static const char *const gga_corpus[] = {
+	"$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n",
+	"$GPGGA,092750.000,5321.6802,N,00630.3372,W,1,8,1.03,61.7,M,55.2,M,,*76\r\n",
+	"$GPGGA,002153.000,3342.6618,N,11751.3858,W,1,10,1.2,27.0,M,-34.2,M,,0000*5E\r\n",
+	"$GPGGA,134658.00,5106.9792,N,11402.3003,W,2,09,1.0,1048.47,M,-16.27,M,08,AAAA*60\r\n",
+	"$GPGGA,,,,,,0,00,99.99,,,,,,*48\r\n"
+};
+
+static const char *const vdm_corpus[] = {
+	"!AIVDM,1,1,,B,177KQJ5000G?tO`K>RA1wUbN0TKH,0*5C\r\n",
+	"!AIVDM,1,1,,A,13HOI:0P0000VOHLCnHQKwvL05Ip,0*23\r\n",
+	"!AIVDM,1,1,,A,133sVfPP00PD>hRMDH@jNOvN20S8,0*7F\r\n",
+	"!AIVDM,1,1,,B,13u?etPv2;0n:dDPwUM1U1Cb069D,0*27\r\n",
+	"!AIVDM,1,1,,A,15RTgt0PAso;90TKcjM8h6g208CQ,0*4A\r\n",
+	"!AIVDM,1,1,,B,B6CdCm0t3`tba35f@V9faHi7kP06,0*5B\r\n",
+	"!AIVDM,2,1,3,B,55P5TL01VIaAL@7WKO@mBplU@<PDhh000000001S;AJ::4A80?4i@E53,0*3E\r\n",
+	"!AIVDM,2,2,3,B,1@0000000000000,2*55\r\n",
+	"!AIVDM,1,1,,A,403OviQuMGCqWrRO9>E6fE700@GO,0*4D\r\n",
+	"!AIVDM,1,1,,B,H42O55i18tMET00000000000000,2*6E\r\n"
+};
+
+// encoder inputs, filled from the decoder corpora and typical instrument values
+static nmea_message_data_RMC_t rmc_data[ARRAY_LENGTH(rmc_corpus)];
+static nmea_message_data_GGA_t gga_data[ARRAY_LENGTH(gga_corpus)];
+static nmea_message_data_VDM_t vdm_data[ARRAY_LENGTH(vdm_corpus)];
+static nmea_message_data_DPT_t dpt_data[4];
+static nmea_message_data_HDM_t hdm_data[4];
+static nmea_message_data_HDT_t hdt_data[4];
+static nmea_message_data_MTW_t mtw_data[4];
+static nmea_message_data_MWD_t mwd_data[4];
+static nmea_message_data_MWV_t mwv_data[4];
+static nmea_message_data_VHW_t vhw_data[4];
+static nmea_message_data_VLW_t vlw_data[4];
+static nmea_message_data_XDR_t xdr_data[4];
+static nmea_message_data_MDA_t mda_data[4];
+
+static char encode_buffer[NMEA_MAX_MESSAGE_LENGTH + 1];
+static size_t encoded_bytes;
+static volatile uint32_t sink;
+static size_t stack_baseline;
+
+// serial port stand-ins used by nmea_process() in the traffic scenario
+static const char *rx_data;
+static size_t rx_length;
+static size_t rx_position;
+static size_t rx_allowed;
+static uint64_t tx_bytes[NMEA_NUMBER_OF_PORTS];
+static uint32_t rx_sentences_decoded;
+
+size_t serial_1_read_data(size_t buffer_length, uint8_t *data)
+{
+	size_t length = rx_allowed - rx_position;
+
+	if (length > buffer_length)
+	{
+		length = buffer_length;
+	}
+	(void)memcpy(data, rx_data + rx_position, length);
+	rx_position += length;
+
+	return length;
+}
+
+size_t serial_1_send_data(size_t length, const uint8_t *data)
+{
+	(void)data;
+	tx_bytes[PORT_N0183] += length;
+
+	return length;
+}
+
+size_t serial_2_read_data(size_t buffer_length, uint8_t *data)
+{
+	(void)buffer_length;
+	(void)data;
+
+	return 0U;
+}
+
+size_t serial_2_send_data(size_t length, const uint8_t *data)
+{
+	(void)data;
+	tx_bytes[PORT_BLUETOOTH] += length;
+
+	return length;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static size_t rmc_bytes(size_t i) { return strlen(rmc_corpus[i]); }
+static size_t gga_bytes(size_t i) { return strlen(gga_corpus[i]); }
+static size_t vdm_bytes(size_t i) { return strlen(vdm_corpus[i]); }
+static size_t encoded_size(size_t i) { (void)i; return encoded_bytes; }
+
+// the decoders tokenize in place so each run works on a copy, as decode() in nmea.c passes its own buffer
+#define DECODE_RUN(type, corpus) \
+	static void decode_##type(size_t i) \
+	{ \
+		char message[NMEA_MAX_MESSAGE_LENGTH + 1]; \
+		nmea_message_data_##type##_t result; \
+		(void)strcpy(message, corpus[i]); \
+		sink += (uint32_t)nmea_decode_##type(message, &result); \
+	}
+DECODE_RUN(RMC, rmc_corpus)
+DECODE_RUN(GGA, gga_corpus)
+DECODE_RUN(VDM, vdm_corpus)
+
+// encoders return the body without checksum and line end, which nmea_process() appends
+#define ENCODE_RUN(type, data) \
+	static void encode_##type(size_t i) { sink += (uint32_t)nmea_encode_##type(encode_buffer, &data[i]); }
+ENCODE_RUN(RMC, rmc_data)
+ENCODE_RUN(GGA, gga_data)
+ENCODE_RUN(VDM, vdm_data)
+ENCODE_RUN(DPT, dpt_data)
+ENCODE_RUN(HDM, hdm_data)
+ENCODE_RUN(HDT, hdt_data)
+ENCODE_RUN(MTW, mtw_data)
+ENCODE_RUN(MWD, mwd_data)
+ENCODE_RUN(MWV, mwv_data)
+ENCODE_RUN(VHW, vhw_data)
+ENCODE_RUN(VLW, vlw_data)
+ENCODE_RUN(XDR, xdr_data)
+ENCODE_RUN(MDA, mda_data)
+
+static const bench_t benches[] = {
+	{"decode_RMC", decode_RMC, ARRAY_LENGTH(rmc_corpus), rmc_bytes},
+	{"decode_GGA", decode_GGA, ARRAY_LENGTH(gga_corpus), gga_bytes},
+	{"decode_VDM", decode_VDM, ARRAY_LENGTH(vdm_corpus), vdm_bytes},
+	{"encode_RMC", encode_RMC, ARRAY_LENGTH(rmc_data), encoded_size},
+	{"encode_GGA", encode_GGA, ARRAY_LENGTH(gga_data), encoded_size},
+	{"encode_VDM", encode_VDM, ARRAY_LENGTH(vdm_data), encoded_size},
+	{"encode_DPT", encode_DPT, ARRAY_LENGTH(dpt_data), encoded_size},
+	{"encode_HDM", encode_HDM, ARRAY_LENGTH(hdm_data), encoded_size},
+	{"encode_HDT", encode_HDT, ARRAY_LENGTH(hdt_data), encoded_size},
+	{"encode_MTW", encode_MTW, ARRAY_LENGTH(mtw_data), encoded_size},
+	{"encode_MWD", encode_MWD, ARRAY_LENGTH(mwd_data), encoded_size},
+	{"encode_MWV", encode_MWV, ARRAY_LENGTH(mwv_data), encoded_size},
+	{"encode_VHW", encode_VHW, ARRAY_LENGTH(vhw_data), encoded_size},
+	{"encode_VLW", encode_VLW, ARRAY_LENGTH(vlw_data), encoded_size},
+	{"encode_XDR", encode_XDR, ARRAY_LENGTH(xdr_data), encoded_size},
+	{"encode_MDA", encode_MDA, ARRAY_LENGTH(mda_data), encoded_size}
+};
+
+static void fill_encoder_inputs(void)
+{
+	static const float depth[] = {3.2f, 12.75f, 48.0f, 0.6f};
+	static const float heading[] = {0.0f, 84.4f, 271.3f, 359.9f};
+	static const float speed[] = {0.0f, 5.3f, 7.85f, 12.4f};
+
+	char message[NMEA_MAX_MESSAGE_LENGTH + 1];
+	size_t i;
+
+	for (i = 0U; i < ARRAY_LENGTH(rmc_corpus); i++)
+	{
+		(void)nmea_decode_RMC(strcpy(message, rmc_corpus[i]), &rmc_data[i]);
+	}
+	for (i = 0U; i < ARRAY_LENGTH(gga_corpus); i++)
+	{
+		(void)nmea_decode_GGA(strcpy(message, gga_corpus[i]), &gga_data[i]);
+	}
+	for (i = 0U; i < ARRAY_LENGTH(vdm_corpus); i++)
+	{
+		(void)nmea_decode_VDM(strcpy(message, vdm_corpus[i]), &vdm_data[i]);
+	}
+
+	for (i = 0U; i < 4U; i++)
+	{
+		dpt_data[i].data_available = NMEA_DPT_DEPTH_PRESENT | NMEA_DPT_DEPTH_OFFSET_PRESENT;
+		dpt_data[i].depth = depth[i];
+		dpt_data[i].depth_offset = 0.4f;
+
+		hdm_data[i].data_available = NMEA_HDM_MAG_HEADING_PRESENT;
+		hdm_data[i].magnetic_heading = heading[i];
+
+		hdt_data[i].data_available = NMEA_HDT_TRUE_HEADING_PRESENT;
+		hdt_data[i].true_heading = heading[3U - i];
+
+		mtw_data[i].data_available = NMEA_MTW_WATER_TEMPERATURE_PRESENT;
+		mtw_data[i].water_temperature = 8.5f + (float)i * 3.7f;
+
+		mwd_data[i].data_available = NMEA_MWD_WIND_DIRECTION_TRUE_PRESENT | NMEA_MWD_WIND_DIRECTION_MAG_PRESENT |
+				NMEA_MWD_WIND_SPEED_KTS_PRESENT;
+		mwd_data[i].wind_direction_true = heading[i];
+		mwd_data[i].wind_direction_magnetic = heading[i] > 2.0f ? heading[i] - 2.0f : 358.0f;
+		mwd_data[i].wind_speed_knots = speed[i] * 2.0f;
+
+		mwv_data[i].data_available = NMEA_MWV_WIND_ANGLE_PRESENT | NMEA_MWV_REFERENCE_PRESENT | NMEA_MWV_WIND_SPEED_PRESENT |
+				NMEA_MWV_WIND_SPEED_UNITS_PRESENT | NMEA_MWV_STATUS_PRESENT;
+		mwv_data[i].wind_angle = heading[i];
+		mwv_data[i].reference = (i % 2U) == 0U ? 'R' : 'T';
+		mwv_data[i].wind_speed = speed[i] * 2.5f;
+		mwv_data[i].wind_speed_units = 'N';
+		mwv_data[i].status = 'A';
+
+		vhw_data[i].data_available = NMEA_VHW_HEADING_TRUE_PRESENT | NMEA_VHW_HEADING_MAG_PRESENT | NMEA_VHW_WATER_SPEED_KTS_PRESENT;
+		vhw_data[i].heading_true = heading[i];
+		vhw_data[i].heading_magnetic = heading[3U - i];
+		vhw_data[i].water_speed_knots = speed[i];
+
+		vlw_data[i].data_available = NMEA_VLW_TOTAL_WATER_DISTANCE_PRESENT | NMEA_VLW_TRIP_WATER_DISTANCE_PRESENT;
+		vlw_data[i].total_water_distance = 12345.6f + (float)i * 1000.0f;
+		vlw_data[i].trip_water_distance = 12.3f * (float)(i + 1U);
+
+		xdr_data[i].data_available = NMEA_XDR_MEASUREMENT_1_PRESENT | NMEA_XDR_MEASUREMENT_2_PRESENT;
+		xdr_data[i].measurements[0].transducer_type = 'P';
+		(void)strcpy(xdr_data[i].measurements[0].transducer_id, "Baro");
+		xdr_data[i].measurements[0].units = 'B';
+		xdr_data[i].measurements[0].decimal_places = 4U;
+		xdr_data[i].measurements[0].measurement = 1.0132f - (float)i * 0.0051f;
+		xdr_data[i].measurements[1].transducer_type = 'C';
+		(void)strcpy(xdr_data[i].measurements[1].transducer_id, "ENGINE#0");
+		xdr_data[i].measurements[1].units = 'C';
+		xdr_data[i].measurements[1].decimal_places = 1U;
+		xdr_data[i].measurements[1].measurement = 45.0f + (float)i * 12.5f;
+
+		mda_data[i].data_available = NMEA_MDA_PRESSURE_INCHES_PRESENT | NMEA_MDA_PRESSURE_BARS_PRESENT |
+				NMEA_MDA_AIR_TEMPERATURE_PRESENT | NMEA_MDA_WATER_TEMPERATURE_PRESENT;
+		mda_data[i].pressure_bars = 1.0132f - (float)i * 0.0051f;
+		mda_data[i].pressure_inches = mda_data[i].pressure_bars * 29.53f;
+		mda_data[i].air_temperature = 18.5f;
+		mda_data[i].water_temperature = mtw_data[i].water_temperature;
+	}
+}
+
+// time one bench over its whole corpus and return ns per item, bytes is filled with bytes per corpus pass
+static double time_bench(const bench_t *bench, uint32_t iterations, uint64_t *bytes)
+{
+	uint32_t passes = iterations / (uint32_t)bench->corpus_length + 1U;
+	uint64_t start;
+	uint64_t elapsed;
+	uint32_t pass;
+	size_t i;
+
+	*bytes = 0U;
+	for (i = 0U; i < bench->corpus_length; i++)
+	{
+		bench->run(i);
+		encoded_bytes = strlen(encode_buffer) + 5U;			// checksum and cr lf added by nmea_process()
+		*bytes += bench->item_bytes(i);
+	}
+
+	start = now_ns();
+	for (pass = 0U; pass < passes; pass++)
+	{
+		for (i = 0U; i < bench->corpus_length; i++)
+		{
+			bench->run(i);
+		}
+	}
+	elapsed = now_ns() - start;
+
+	return (double)elapsed / (double)(passes * bench->corpus_length);
+}
+
+static void *stack_job(void *parameters)
+{
+	const stack_job_t *job = (const stack_job_t *)parameters;
+	size_t i;
+
+	for (i = 0U; i < job->bench->corpus_length; i++)
+	{
+		job->bench->run(i);
+	}
+
+	return NULL;
+}
+
+static void no_operation(size_t i)
+{
+	sink += (uint32_t)i;
+}
+
+static size_t no_bytes(size_t i)
+{
+	(void)i;
+
+	return 0U;
+}
+
+// run the bench once over its corpus on a painted thread stack and return the deepest stack use in bytes
+// including thread start up, which stack_baseline() measures so that it can be taken off
+static size_t measure_stack(const bench_t *bench)
+{
+	pthread_attr_t attr;
+	pthread_t thread;
+	stack_job_t job = {bench, 1U};
+	uint8_t *stack;
+	size_t i;
+
+	if (posix_memalign((void **)&stack, 4096U, MEASURE_STACK_SIZE) != 0)
+	{
+		return 0U;
+	}
+	(void)memset(stack, STACK_PAINT, MEASURE_STACK_SIZE);
+	(void)pthread_attr_init(&attr);
+	(void)pthread_attr_setstack(&attr, stack, MEASURE_STACK_SIZE);
+	if (pthread_create(&thread, &attr, stack_job, &job) == 0)
+	{
+		(void)pthread_join(thread, NULL);
+	}
+	(void)pthread_attr_destroy(&attr);
+
+	// stack grows down, so the first overwritten byte from the bottom is the high water mark
+	for (i = 0U; i < MEASURE_STACK_SIZE && stack[i] == STACK_PAINT; i++)
+	{
+	}
+	free(stack);
+
+	return MEASURE_STACK_SIZE - i;
+}
+
+// receive callbacks as in main.cpp, GGA and VDM are decoded and forwarded to Bluetooth straight away, VDM without the
+// AIS filtering of main.cpp so that the load does not depend on the targets, ais_bench measures that
+static void gga_receive_callback(const char *data)
+{
+	if (nmea_decode_GGA(data, &gga_data[0]) == nmea_error_none)
+	{
+		rx_sentences_decoded++;
+		nmea_transmit_message_now(PORT_BLUETOOTH, nmea_message_GGA);
+	}
+}
+
+static void vdm_receive_callback(const char *data)
+{
+	if (nmea_decode_VDM(data, &vdm_data[0]) == nmea_error_none)
+	{
+		rx_sentences_decoded++;
+		nmea_transmit_message_now(PORT_BLUETOOTH, nmea_message_VDM);
+	}
+}
+
+static void rmc_receive_callback(const char *data)
+{
+	if (nmea_decode_RMC(data, &rmc_data[0]) == nmea_error_none)
+	{
+		rx_sentences_decoded++;
+	}
+}
+
+static void no_transmit_data(void)
+{
+}
+
+#define TRANSMIT(type, port, period, data) \
+	{nmea_message_##type, port, period, no_transmit_data, &data[1], nmea_encode_##type}
+
+// message set and periods as main.cpp
+static const transmit_message_details_t transmit_details[] = {
+	TRANSMIT(MWD, PORT_BLUETOOTH, 2000UL, mwd_data),
+	TRANSMIT(MWV, PORT_BLUETOOTH, 1000UL, mwv_data),
+	TRANSMIT(VLW, PORT_BLUETOOTH, 1000UL, vlw_data),
+	TRANSMIT(HDM, PORT_BLUETOOTH, 1000UL, hdm_data),
+	TRANSMIT(HDT, PORT_BLUETOOTH, 1000UL, hdt_data),
+	TRANSMIT(VHW, PORT_BLUETOOTH, 1000UL, vhw_data),
+	TRANSMIT(MTW, PORT_BLUETOOTH, 2000UL, mtw_data),
+	TRANSMIT(DPT, PORT_BLUETOOTH, 500UL, dpt_data),
+	TRANSMIT(GGA, PORT_BLUETOOTH, 0UL, gga_data),
+	TRANSMIT(VDM, PORT_BLUETOOTH, 0UL, vdm_data),
+	TRANSMIT(RMC, PORT_BLUETOOTH, 1000UL, rmc_data),
+	TRANSMIT(XDR, PORT_BLUETOOTH, 10000UL, xdr_data),
+	TRANSMIT(MDA, PORT_BLUETOOTH, 10000UL, mda_data)
+};
+
+static const nmea_receive_message_details_t receive_details[] = {
+	{nmea_message_GGA, PORT_N0183, gga_receive_callback},
+	{nmea_message_VDM, PORT_N0183, vdm_receive_callback},
+	{nmea_message_RMC, PORT_N0183, rmc_receive_callback}
+};
+
+// sentences that the receive framer must reject, in one of each counter
+static const char *const error_sentences[] = {
+	"$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6B\r\n",
+	"$GPXXX,AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA*00\r\n",
+	"$GPGGA,123519,4807.038,N"
+};
+
+// build the port 0 byte stream for the scenario: RMC and GGA once a second plus AIS, clipped to what the baud rate carries
+static char *build_traffic(uint32_t seconds, uint32_t ais_per_second, uint32_t baud, size_t *length)
+{
+	size_t capacity = (size_t)seconds * (baud / 10UL) + NMEA_MAX_MESSAGE_LENGTH;
+	char *traffic = (char *)malloc(capacity + 1U);
+	uint32_t second;
+	uint32_t n;
+	size_t used = 0U;
+
+	for (second = 0U; second < seconds && traffic != NULL; second++)
+	{
+		size_t second_start = used;
+		const char *sentence;
+
+		if (second % ERROR_PERIOD_S == ERROR_PERIOD_S - 1UL)
+		{
+			for (n = 0U; n < ARRAY_LENGTH(error_sentences); n++)
+			{
+				(void)memcpy(traffic + used, error_sentences[n], strlen(error_sentences[n]));
+				used += strlen(error_sentences[n]);
+			}
+		}
+
+		for (n = 0U; n < ais_per_second + 2U; n++)
+		{
+			if (n == 0U)
+			{
+				sentence = rmc_corpus[second % ARRAY_LENGTH(rmc_corpus)];
+			}
+			else if (n == 1U)
+			{
+				sentence = gga_corpus[second % ARRAY_LENGTH(gga_corpus)];
+			}
+			else
+			{
+				sentence = vdm_corpus[(second * ais_per_second + n) % ARRAY_LENGTH(vdm_corpus)];
+			}
+
+			if (used - second_start + strlen(sentence) > baud / 10UL)
+			{
+				break;
+			}
+			(void)memcpy(traffic + used, sentence, strlen(sentence));
+			used += strlen(sentence);
+		}
+		// pad the rest of the second with idle so that bytes arrive at their real time
+		(void)memset(traffic + used, ' ', second_start + baud / 10UL - used);
+		used = second_start + baud / 10UL;
+	}
+	if (traffic != NULL)
+	{
+		traffic[used] = '\0';
+	}
+	*length = used;
+
+	return traffic;
+}
+
+static void run_traffic(uint32_t seconds, uint32_t ais_per_second, uint32_t baud, uint32_t bluetooth_rate, bool first)
+{
+	nmea_receive_stats_t stats_before;
+	nmea_receive_stats_t stats;
+	nmea_transmit_stats_t transmit_before;
+	nmea_transmit_stats_t transmit;
+	nmea_output_stats_t output_before;
+	nmea_output_stats_t output;
+	uint32_t decoded_before = rx_sentences_decoded;
+	uint64_t tx_before = tx_bytes[PORT_BLUETOOTH];
+	char *traffic;
+	uint32_t calls = 0UL;
+	uint32_t elapsed_ms = 0UL;
+	uint32_t wait_ms = PROCESS_PERIOD_MS;
+	uint32_t next_transmit_ms;
+	uint64_t cpu_total = 0U;
+	uint64_t cpu_max = 0U;
+	size_t i;
+
+	traffic = build_traffic(seconds, ais_per_second, baud, &rx_length);
+	if (traffic == NULL)
+	{
+		return;
+	}
+	rx_data = traffic;
+	rx_position = 0U;
+	rx_allowed = 0U;
+
+	nmea_get_receive_stats(PORT_N0183, &stats_before);
+	nmea_get_transmit_stats(PORT_BLUETOOTH, &transmit_before);
+	nmea_get_output_stats(PORT_BLUETOOTH, &output_before);
+	host_time_set_virtual(true);
+	nmea_set_port_rate(PORT_BLUETOOTH, bluetooth_rate);
+	for (i = 0U; i < ARRAY_LENGTH(transmit_details); i++)
+	{
+		nmea_enable_transmit_message(&transmit_details[i]);
+	}
+	for (i = 0U; i < ARRAY_LENGTH(receive_details); i++)
+	{
+		nmea_enable_receive_message(&receive_details[i]);
+	}
+
+	// called as the firmware timer calls it, every 25 ms or sooner when a message is due before then
+	while (elapsed_ms < seconds * 1000UL)
+	{
+		uint64_t start;
+		uint64_t elapsed;
+
+		host_time_advance_us((int64_t)wait_ms * 1000LL);
+		elapsed_ms += wait_ms;
+		rx_allowed = (size_t)((uint64_t)elapsed_ms * (baud / 10UL) / 1000ULL);
+		if (rx_allowed > rx_length)
+		{
+			rx_allowed = rx_length;
+		}
+
+		start = host_time_get_cpu_ns();
+		next_transmit_ms = nmea_process();
+		elapsed = host_time_get_cpu_ns() - start;
+		calls++;
+		wait_ms = next_transmit_ms < PROCESS_PERIOD_MS ? (next_transmit_ms > 0UL ? next_transmit_ms : 1UL) : PROCESS_PERIOD_MS;
+
+		cpu_total += elapsed;
+		if (elapsed > cpu_max)
+		{
+			cpu_max = elapsed;
+		}
+	}
+
+	nmea_get_receive_stats(PORT_N0183, &stats);
+	nmea_get_transmit_stats(PORT_BLUETOOTH, &transmit);
+	nmea_get_output_stats(PORT_BLUETOOTH, &output);
+
+	printf("%s{\"baud\":%u,\"bluetooth_rate\":%u,\"simulated_seconds\":%u,\"ais_per_second\":%u,\"process_calls\":%u,"
+			"\"rx_bytes\":%zu,\"rx_sentences_decoded\":%u,\"rx_malformed\":%u,\"rx_over_length\":%u,"
+			"\"rx_checksum_failed\":%u,\"tx_bytes_bluetooth\":%llu,"
+			"\"cpu_ns_per_second\":%.0f,\"cpu_ns_per_call_avg\":%.0f,\"cpu_ns_per_call_max\":%llu,"
+			"\"callback_budget_used_max_percent\":%.3f",
+			first ? "" : ",", baud, bluetooth_rate, seconds, ais_per_second, calls, rx_length, rx_sentences_decoded - decoded_before,
+			stats.malformed - stats_before.malformed, stats.over_length - stats_before.over_length,
+			stats.checksum_failed - stats_before.checksum_failed,
+			(unsigned long long)(tx_bytes[PORT_BLUETOOTH] - tx_before),
+			(double)cpu_total / (double)seconds, (double)cpu_total / (double)calls, (unsigned long long)cpu_max,
+			(double)cpu_max / (double)(PROCESS_PERIOD_MS * 10000UL));
+	printf(",\"tx_periodic_sent\":%u,\"tx_resynchronised\":%u,\"tx_period_error_ms\":[",
+			(unsigned int)(transmit.sent - transmit_before.sent),
+			(unsigned int)(transmit.resynchronised - transmit_before.resynchronised));
+	for (i = 0U; i < NMEA_PERIOD_ERROR_BUCKETS; i++)
+	{
+		printf("%s%u", i == 0U ? "" : ",", (unsigned int)(transmit.period_error[i] - transmit_before.period_error[i]));
+	}
+	printf("],\"output\":[");
+	for (i = 0U; i < (size_t)nmea_priority_max; i++)
+	{
+		const nmea_output_class_stats_t *after = &output.classes[i];
+		const nmea_output_class_stats_t *before = &output_before.classes[i];
+		uint32_t sent = after->sent - before->sent;
+
+		// delay max is the worst since the start, the unlimited runs come first and never wait
+		printf("%s{\"class\":%zu,\"queued\":%u,\"sent\":%u,\"dropped\":%u,\"delay_avg_ms\":%.1f,\"delay_max_ms\":%u}",
+				i == 0U ? "" : ",", i, (unsigned int)(after->queued - before->queued), (unsigned int)sent,
+				(unsigned int)(after->dropped - before->dropped),
+				sent > 0UL ? (double)(after->delay_total_ms - before->delay_total_ms) / (double)sent : 0.0,
+				(unsigned int)after->delay_max_ms);
+	}
+	printf("]}");
+
+	// next run starts its virtual clock again from 0
+	for (i = 0U; i < ARRAY_LENGTH(transmit_details); i++)
+	{
+		nmea_disable_transmit_message(transmit_details[i].port, transmit_details[i].message_type);
+	}
+	free(traffic);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t iterations = DEFAULT_ITERATIONS;
+	uint32_t seconds = DEFAULT_SECONDS;
+	uint32_t ais_per_second = DEFAULT_AIS_PER_SECOND;
+	uint32_t limited_rate = DEFAULT_LIMITED_RATE;
+	size_t b;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "i:s:a:b:h")) != -1)
+	{
+		switch (opt)
+		{
+		case 'i':
+			iterations = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+
+		case 's':
+			seconds = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+
+		case 'a':
+			ais_per_second = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+
+		case 'b':
+			limited_rate = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+
+		default:
+			fprintf(stderr, "usage: %s [-i iterations] [-s simulated_seconds] [-a ais_sentences_per_second] [-b limited_bluetooth_bytes_per_second]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (iterations == 0U || seconds == 0U || limited_rate == 0U)
+	{
+		fprintf(stderr, "bad parameter\n");
+		return 1;
+	}
+
+	fill_encoder_inputs();
+	{
+		static const bench_t baseline = {"baseline", no_operation, 1U, no_bytes};
+
+		stack_baseline = measure_stack(&baseline);
+	}
+
+	printf("{\"benchmark\":\"nmea0183\",\"iterations\":%u,\"results\":[", iterations);
+	for (b = 0U; b < ARRAY_LENGTH(benches); b++)
+	{
+		uint64_t bytes;
+		double ns = time_bench(&benches[b], iterations, &bytes);
+		double bytes_per_item = (double)bytes / (double)benches[b].corpus_length;
+
+		printf("%s{\"name\":\"%s\",\"corpus\":%zu,\"ns_per_sentence\":%.1f,\"bytes_per_s\":%.0f,\"stack_bytes\":%zu}",
+				b == 0U ? "" : ",", benches[b].name, benches[b].corpus_length, ns,
+				bytes_per_item * 1e9 / ns, measure_stack(&benches[b]) - stack_baseline);
+	}
+	printf("],\"traffic\":[");
+	run_traffic(seconds, ais_per_second, N0183_BAUD, 0UL, true);
+	run_traffic(seconds, ais_per_second * (N0183_FAST_BAUD / N0183_BAUD), N0183_FAST_BAUD, 0UL, false);
+	run_traffic(seconds, ais_per_second, N0183_BAUD, limited_rate, false);
+	printf("]}\n");
+
+	return sink == 0xffffffffUL ? 1 : 0;
+}
@@ -0,0 +1,552 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+/*
+telemetry_bench.c
+
+Checks and measures the binary MQTT data payload of main/telemetry.c and the
+decoder in host/telemetry. Golden vectors are payloads built from fixed
+samples that must come out byte for byte as listed, so a change to the
+encoder or the format shows here; a change on purpose needs a new
+TELEMETRY_BINARY_VERSION. Each is decoded again and every field compared with
+the comma separated payload built from the same sample.
+
+A random walk of boat data, with fields coming and going and one publish in
+20 failing, is then published both ways with delta publishing. The decoder
+view of the binary payloads is checked against what the encoder recorded as
+sent after every publish it received, and the average payload sizes are given.
+
+The size comparison gives, for a typical and a full payload, the bytes of the
+comma separated and binary keyframes, the MQTT PUBLISH packet and the number
+of MODEM_MAX_TCP_WRITE_SIZE CIPSEND writes it takes.
+
+Output is a single JSON object on stdout.
+
+Usage: telemetry_bench [-i iterations] [-S seed]
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "telemetry.h"
+#include "telemetry_decoder.h"
+#include "modem.h"
+
+#define DEFAULT_ITERATIONS 100000UL
+#define PAYLOAD_SIZE 220U
+#define TOPIC_LENGTH 12U			// e.g. 1A2B3C4D/all
+#define FAIL_EVERY 20UL
+#define FIXED_TEXT_SIZE 24U			// sign, 10 digits, point, decimals and terminator
+
+typedef struct
+{
+	const char *name;
+	const char *hex;
+} golden_t;
+
+// full, delta of the full sample with changes and typical, in that order
+static const golden_t goldens[] =
+{
+	{"full_keyframe", "010100ffff0f3ece051dfa01ee0180890ff2c001cc05a4138e079515ea079b118faa29b1cbb801a89e0180c60aba10"},
+	{"delta", "0102018047808008149811900895aa29"},
+	{"empty_delta", "01000200"},
+	{"typical_keyframe", "010100ffff0f24ee039c027a74c28301d803f603ee02a6029008fa028006e08d47ddb006cc9d013c00"}
+};
+
+static uint32_t random_state;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t next_random(void)
+{
+	random_state = random_state * 1103515245UL + 12345UL;
+
+	return random_state >> 8;
+}
+
+static float random_float(float low, float high)
+{
+	return low + (high - low) * (float)(next_random() & 0xffffUL) / 65535.0f;
+}
+
+// bytes of an MQTT PUBLISH packet at QoS 0 with a payload on a 12 character topic
+static size_t publish_packet_bytes(size_t payload_length)
+{
+	size_t remaining = 2U + TOPIC_LENGTH + payload_length;
+
+	return 1U + (remaining < 128U ? 1U : 2U) + remaining;
+}
+
+static void set_field(telemetry_sample_t *sample, telemetry_field_t field, float value)
+{
+	sample->values[field] = value;
+	sample->present |= 1UL << field;
+}
+
+// every field with the longest values it has on a boat
+static void make_full_sample(telemetry_sample_t *sample)
+{
+	memset(sample, 0, sizeof(telemetry_sample_t));
+	set_field(sample, telemetry_field_signal_strength, 31.0f);
+	set_field(sample, telemetry_field_course_over_ground, 359.0f);
+	set_field(sample, telemetry_field_seawater_temperature, -1.5f);
+	set_field(sample, telemetry_field_speed_over_ground, 12.5f);
+	set_field(sample, telemetry_field_boat_speed, 11.9f);
+	set_field(sample, telemetry_field_total_distance, 123456.0f);
+	set_field(sample, telemetry_field_trip, 1234.5f);
+	set_field(sample, telemetry_field_heading_true, 358.0f);
+	set_field(sample, telemetry_field_depth, 123.4f);
+	set_field(sample, telemetry_field_true_wind_speed, 45.5f);
+	set_field(sample, telemetry_field_true_wind_angle, -135.5f);
+	set_field(sample, telemetry_field_apparent_wind_speed, 50.1f);
+	set_field(sample, telemetry_field_apparent_wind_angle, -110.2f);
+	set_field(sample, telemetry_field_latitude, -33.8568f);
+	set_field(sample, telemetry_field_longitude, -151.2153f);
+	set_field(sample, telemetry_field_pressure, 1013.2f);
+	set_field(sample, telemetry_field_publishing_period, 86400.0f);
+	set_field(sample, telemetry_field_exhaust_temperature, 105.3f);
+}
+
+// a cruising boat without exhaust sensor, so exhaust temperature is 0
+static void make_typical_sample(telemetry_sample_t *sample)
+{
+	memset(sample, 0, sizeof(telemetry_sample_t));
+	set_field(sample, telemetry_field_signal_strength, 18.0f);
+	set_field(sample, telemetry_field_course_over_ground, 247.0f);
+	set_field(sample, telemetry_field_seawater_temperature, 14.2f);
+	set_field(sample, telemetry_field_speed_over_ground, 6.1f);
+	set_field(sample, telemetry_field_boat_speed, 5.8f);
+	set_field(sample, telemetry_field_total_distance, 8417.0f);
+	set_field(sample, telemetry_field_trip, 23.6f);
+	set_field(sample, telemetry_field_heading_true, 251.0f);
+	set_field(sample, telemetry_field_depth, 18.3f);
+	set_field(sample, telemetry_field_true_wind_speed, 14.7f);
+	set_field(sample, telemetry_field_true_wind_angle, 52.0f);
+	set_field(sample, telemetry_field_apparent_wind_speed, 18.9f);
+	set_field(sample, telemetry_field_apparent_wind_angle, 38.4f);
+	set_field(sample, telemetry_field_latitude, 58.2512f);
+	set_field(sample, telemetry_field_longitude, -5.2271f);
+	set_field(sample, telemetry_field_pressure, 1008.6f);
+	set_field(sample, telemetry_field_publishing_period, 30.0f);
+	set_field(sample, telemetry_field_exhaust_temperature, 0.0f);
+}
+
+// writes a fixed point value as the comma separated payload shows it, "#" if it does not fit so it never matches
+static void fixed_text(uint8_t field, int32_t value, char *text, size_t size)
+{
+	uint8_t decimals = telemetry_decoder_field_decimals(field);
+	uint32_t magnitude = value < 0L ? (uint32_t)(-value) : (uint32_t)value;
+	uint32_t scale = 1UL;
+	int written;
+	uint8_t i;
+
+	for (i = 0U; i < decimals; i++)
+	{
+		scale *= 10UL;
+	}
+	if (decimals == 0U)
+	{
+		written = snprintf(text, size, "%u", (unsigned int)magnitude);
+	}
+	else
+	{
+		written = snprintf(text, size, "%s%u.%0*u", value < 0L ? "-" : "", (unsigned int)(magnitude / scale), (int)decimals,
+				(unsigned int)(magnitude % scale));
+	}
+	if (written < 0 || (size_t)written >= size)
+	{
+		(void)snprintf(text, size, "#");
+	}
+}
+
+// compares decoded fields with the fields of a comma separated payload, empty there means not in the frame
+static uint32_t compare_with_csv(const telemetry_decoder_frame_t *frame, const char *csv)
+{
+	char text[FIXED_TEXT_SIZE];
+	const char *start = csv;
+	const char *end;
+	uint32_t differences = 0UL;
+	uint8_t field;
+
+	for (field = 0U; field < TELEMETRY_DECODER_FIELDS; field++)
+	{
+		end = strchr(start, ',');
+		if (end == NULL)
+		{
+			return differences + 1UL;
+		}
+		if ((frame->present & (1UL << field)) != 0UL)
+		{
+			fixed_text(field, frame->values[field], text, sizeof(text));
+			if (strlen(text) != (size_t)(end - start) || strncmp(text, start, (size_t)(end - start)) != 0)
+			{
+				differences++;
+			}
+		}
+		else if ((frame->cleared & (1UL << field)) != 0UL)
+		{
+			differences += (end - start == 1 && *start == '-') ? 0UL : 1UL;
+		}
+		else if (end != start)
+		{
+			differences++;
+		}
+		start = end + 1;
+	}
+
+	return differences;
+}
+
+static void to_hex(const uint8_t *data, size_t length, char *hex)
+{
+	size_t i;
+
+	for (i = 0U; i < length; i++)
+	{
+		(void)sprintf(&hex[i * 2U], "%02x", data[i]);
+	}
+	hex[length * 2U] = '\0';
+}
+
+static void run_goldens(void)
+{
+	telemetry_state_t binary_state;
+	telemetry_state_t csv_state;
+	telemetry_sample_t sample;
+	telemetry_decoder_frame_t frame;
+	telemetry_decoder_status_t status;
+	uint8_t payload[TELEMETRY_BINARY_MAX_LENGTH];
+	char csv[PAYLOAD_SIZE];
+	char hex[TELEMETRY_BINARY_MAX_LENGTH * 2U + 1U];
+	size_t length;
+	size_t prefix;
+	size_t i;
+	bool prefixes_rejected;
+
+	telemetry_init(&binary_state, TELEMETRY_DEFAULT_KEYFRAME_INTERVAL);
+	telemetry_init(&csv_state, TELEMETRY_DEFAULT_KEYFRAME_INTERVAL);
+	printf("\"golden\":[");
+	for (i = 0U; i < sizeof(goldens) / sizeof(goldens[0]); i++)
+	{
+		switch (i)
+		{
+		case 0U:
+		case 2U:
+			make_full_sample(&sample);
+			break;
+		case 1U:
+			make_full_sample(&sample);
+			sample.values[telemetry_field_depth] = 110.0f;
+			sample.values[telemetry_field_latitude] = -33.8571f;
+			sample.values[telemetry_field_heading_true] = 10.0f;
+			sample.values[telemetry_field_true_wind_speed] = 52.0f;
+			sample.present &= ~(1UL << telemetry_field_exhaust_temperature);
+			break;
+		default:
+			telemetry_init(&binary_state, TELEMETRY_DEFAULT_KEYFRAME_INTERVAL);
+			telemetry_init(&csv_state, TELEMETRY_DEFAULT_KEYFRAME_INTERVAL);
+			make_typical_sample(&sample);
+			break;
+		}
+		if (i == 2U)
+		{
+			// same as the delta before, nothing to send
+			sample.values[telemetry_field_depth] = 110.0f;
+			sample.values[telemetry_field_latitude] = -33.8571f;
+			sample.values[telemetry_field_heading_true] = 10.0f;
+			sample.values[telemetry_field_true_wind_speed] = 52.0f;
+			sample.present &= ~(1UL << telemetry_field_exhaust_temperature);
+		}
+
+		length = telemetry_build_binary(&binary_state, &sample, payload, sizeof(payload));
+		telemetry_publish_result(&binary_state, true);
+		(void)telemetry_build_csv(&csv_state, &sample, csv, sizeof(csv));
+		telemetry_publish_result(&csv_state, true);
+		to_hex(payload, length, hex);
+		// every shorter payload must be refused
+		prefixes_rejected = true;
+		for (prefix = 0U; prefix < length; prefix++)
+		{
+			prefixes_rejected = prefixes_rejected && telemetry_decoder_decode(payload, prefix, &frame) != telemetry_decoder_ok;
+		}
+		status = telemetry_decoder_decode(payload, length, &frame);
+
+		printf("%s{\"name\":\"%s\",\"bytes\":%u,\"hex\":\"%s\",\"csv\":\"%s\",\"match\":%s,\"decode\":\"%s\",\"csv_differences\":%u,"
+				"\"prefixes_rejected\":%s}", i == 0U ? "" : ",", goldens[i].name, (unsigned int)length, hex, csv,
+				strcmp(hex, goldens[i].hex) == 0 ? "true" : "false", telemetry_decoder_status_text(status),
+				(unsigned int)compare_with_csv(&frame, csv), prefixes_rejected ? "true" : "false");
+	}
+	printf("]");
+}
+
+// moves each field a little and now and then takes it away or brings it back
+static void walk_sample(telemetry_sample_t *sample)
+{
+	static const float steps[telemetry_field_max] = {1.0f, 4.0f, 0.05f, 0.3f, 0.3f, 0.02f, 0.02f, 4.0f, 0.5f, 1.0f, 6.0f, 1.0f,
+			6.0f, 0.00005f, 0.00008f, 0.1f, 0.0f, 1.0f};
+	uint32_t field;
+	float value;
+
+	for (field = 0UL; field < (uint32_t)telemetry_field_max; field++)
+	{
+		value = sample->values[field] + random_float(-steps[field], steps[field]);
+		if (field == (uint32_t)telemetry_field_course_over_ground || field == (uint32_t)telemetry_field_heading_true)
+		{
+			value = value < 0.0f ? value + 360.0f : (value >= 360.0f ? value - 360.0f : value);
+		}
+		else if (value < 0.0f && field != (uint32_t)telemetry_field_seawater_temperature &&
+				field != (uint32_t)telemetry_field_true_wind_angle && field != (uint32_t)telemetry_field_apparent_wind_angle &&
+				field != (uint32_t)telemetry_field_latitude && field != (uint32_t)telemetry_field_longitude)
+		{
+			value = 0.0f;
+		}
+		sample->values[field] = value;
+		if (next_random() % 500UL == 0UL)
+		{
+			sample->present ^= 1UL << field;
+		}
+	}
+}
+
+// values a whole field can get that are out of its range, built both ways, must show the same in each
+static void run_out_of_range(void)
+{
+	static const float values[] = {-5.0f, -0.5f, 359.9f, 720.0f, 5.0e9f, NAN};
+	telemetry_state_t binary_state;
+	telemetry_state_t csv_state;
+	telemetry_sample_t sample;
+	telemetry_decoder_frame_t frame;
+	uint8_t payload[TELEMETRY_BINARY_MAX_LENGTH];
+	char csv[PAYLOAD_SIZE];
+	size_t length;
+	size_t i;
+	uint32_t differences = 0UL;
+
+	for (i = 0U; i < sizeof(values) / sizeof(values[0]); i++)
+	{
+		telemetry_init(&binary_state, 1U);
+		telemetry_init(&csv_state, 1U);
+		make_full_sample(&sample);
+		sample.values[telemetry_field_course_over_ground] = values[i];
+		sample.values[telemetry_field_signal_strength] = values[i];
+		length = telemetry_build_binary(&binary_state, &sample, payload, sizeof(payload));
+		(void)telemetry_build_csv(&csv_state, &sample, csv, sizeof(csv));
+		if (length == 0U || telemetry_decoder_decode(payload, length, &frame) != telemetry_decoder_ok)
+		{
+			differences++;
+			continue;
+		}
+		differences += compare_with_csv(&frame, csv);
+	}
+	printf("\"out_of_range\":{\"values\":%u,\"csv_differences\":%u}", (unsigned int)(sizeof(values) / sizeof(values[0])),
+			(unsigned int)differences);
+}
+
+// publishes a random walk both ways and checks the decoder view against what the encoder has as sent
+static void run_walk(uint32_t iterations)
+{
+	telemetry_state_t binary_state;
+	telemetry_state_t csv_state;
+	telemetry_sample_t sample;
+	telemetry_decoder_frame_t frame;
+	telemetry_decoder_view_t view;
+	uint8_t payload[TELEMETRY_BINARY_MAX_LENGTH];
+	char csv[PAYLOAD_SIZE];
+	char view_text[FIXED_TEXT_SIZE];
+	char sent_text[FIXED_TEXT_SIZE];
+	size_t length;
+	uint64_t binary_bytes = 0ULL;
+	uint64_t csv_bytes = 0ULL;
+	uint64_t encode_ns = 0ULL;
+	uint64_t decode_ns = 0ULL;
+	uint64_t start;
+	uint32_t received = 0UL;
+	uint32_t decode_errors = 0UL;
+	uint32_t checked = 0UL;
+	uint32_t mismatches = 0UL;
+	uint32_t i;
+	uint8_t field;
+	bool published;
+
+	telemetry_init(&binary_state, TELEMETRY_DEFAULT_KEYFRAME_INTERVAL);
+	telemetry_init(&csv_state, TELEMETRY_DEFAULT_KEYFRAME_INTERVAL);
+	telemetry_decoder_view_init(&view);
+	make_typical_sample(&sample);
+
+	for (i = 0UL; i < iterations; i++)
+	{
+		walk_sample(&sample);
+		start = now_ns();
+		length = telemetry_build_binary(&binary_state, &sample, payload, sizeof(payload));
+		encode_ns += now_ns() - start;
+		binary_bytes += length;
+		csv_bytes += telemetry_build_csv(&csv_state, &sample, csv, sizeof(csv));
+
+		published = i % FAIL_EVERY != FAIL_EVERY - 1UL;
+		telemetry_publish_result(&binary_state, published);
+		telemetry_publish_result(&csv_state, published);
+		if (!published)
+		{
+			continue;
+		}
+
+		start = now_ns();
+		if (telemetry_decoder_decode(payload, length, &frame) != telemetry_decoder_ok)
+		{
+			decode_errors++;
+			continue;
+		}
+		telemetry_decoder_view_apply(&view, &frame);
+		decode_ns += now_ns() - start;
+		received++;
+
+		if (!view.in_sync)
+		{
+			mismatches++;
+			continue;
+		}
+		checked++;
+		for (field = 0U; field < TELEMETRY_DECODER_FIELDS; field++)
+		{
+			if ((view.available & (1UL << field)) != (binary_state.sent.present & (1UL << field)))
+			{
+				mismatches++;
+			}
+			else if ((view.available & (1UL << field)) != 0UL)
+			{
+				// the value as sent, built alone so it is not a delta
+				telemetry_state_t single;
+				telemetry_sample_t one;
+
+				memset(&one, 0, sizeof(one));
+				one.present = 1UL << field;
+				one.values[field] = binary_state.sent.values[field];
+				telemetry_init(&single, 1U);
+				(void)telemetry_build_csv(&single, &one, csv, sizeof(csv));
+				// the fields before are empty so the value starts after field commas
+				(void)snprintf(sent_text, sizeof(sent_text), "%.*s", (int)strcspn(&csv[field], ","), &csv[field]);
+				fixed_text(field, view.values[field], view_text, sizeof(view_text));
+				mismatches += strcmp(view_text, sent_text) == 0 ? 0UL : 1UL;
+			}
+		}
+	}
+
+	printf("\"walk\":{\"publishes\":%u,\"received\":%u,\"checked\":%u,\"mismatches\":%u,\"decode_errors\":%u,\"missed\":%u,"
+			"\"csv_bytes_per_publish\":%.1f,\"binary_bytes_per_publish\":%.1f,\"encode_ns\":%.1f,\"decode_ns\":%.1f}",
+			(unsigned int)iterations, (unsigned int)received, (unsigned int)checked, (unsigned int)mismatches,
+			(unsigned int)decode_errors, (unsigned int)view.missed, (double)csv_bytes / (double)iterations,
+			(double)binary_bytes / (double)iterations, (double)encode_ns / (double)iterations,
+			(double)decode_ns / (double)(received > 0UL ? received : 1UL));
+}
+
+// keyframe sizes both ways and what they cost to send
+static void run_sizes(void)
+{
+	static const char * const names[] = {"typical", "full"};
+	telemetry_state_t state;
+	telemetry_sample_t sample;
+	uint8_t payload[TELEMETRY_BINARY_MAX_LENGTH];
+	char csv[PAYLOAD_SIZE];
+	size_t csv_length;
+	size_t binary_length;
+	size_t i;
+
+	printf("\"sizes\":[");
+	for (i = 0U; i < sizeof(names) / sizeof(names[0]); i++)
+	{
+		if (i == 0U)
+		{
+			make_typical_sample(&sample);
+		}
+		else
+		{
+			make_full_sample(&sample);
+		}
+		telemetry_init(&state, 1U);
+		csv_length = telemetry_build_csv(&state, &sample, csv, sizeof(csv));
+		telemetry_init(&state, 1U);
+		binary_length = telemetry_build_binary(&state, &sample, payload, sizeof(payload));
+		printf("%s{\"payload\":\"%s\",\"csv_bytes\":%u,\"binary_bytes\":%u,\"csv_packet_bytes\":%u,\"binary_packet_bytes\":%u,"
+				"\"csv_tcp_writes\":%u,\"binary_tcp_writes\":%u}", i == 0U ? "" : ",", names[i], (unsigned int)csv_length,
+				(unsigned int)binary_length, (unsigned int)publish_packet_bytes(csv_length),
+				(unsigned int)publish_packet_bytes(binary_length),
+				(unsigned int)((publish_packet_bytes(csv_length) + MODEM_MAX_TCP_WRITE_SIZE - 1UL) / MODEM_MAX_TCP_WRITE_SIZE),
+				(unsigned int)((publish_packet_bytes(binary_length) + MODEM_MAX_TCP_WRITE_SIZE - 1UL) / MODEM_MAX_TCP_WRITE_SIZE));
+	}
+	printf("]");
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t iterations = DEFAULT_ITERATIONS;
+	int opt;
+
+	random_state = 1UL;
+	while ((opt = getopt(argc, argv, "i:S:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'i':
+			iterations = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'S':
+			random_state = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-i iterations] [-S seed]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (iterations < 100UL)
+	{
+		fprintf(stderr, "bad parameter\n");
+		return 1;
+	}
+
+	printf("{\"benchmark\":\"telemetry\",\"version\":%u,", TELEMETRY_BINARY_VERSION);
+	run_goldens();
+	printf(",");
+	run_out_of_range();
+	printf(",");
+	run_sizes();
+	printf(",");
+	run_walk(iterations);
+	printf("}\n");
+
+	return 0;
+}
@@ -0,0 +1,196 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+/*
+ESP-IDF ADC1 driver and calibration on a Linux host. A reading is the input
+voltage set with host_adc_set_input_mv scaled to the full scale range of the
+channel attenuation, with a couple of counts of noise like the real ADC.
+The calibration is the straight line the same full scale ranges give, so a
+noise free reading converts back to the voltage set.
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include "driver/adc.h"
+#include "esp_adc_cal.h"
+#include "esp_hal_host.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define DEFAULT_VREF_MV			1100UL		///< Reference voltage used when the caller gives none
+#define NOISE_COUNTS			2			///< Readings vary by up to this many counts either side
+
+/************
+*** TYPES ***
+************/
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static uint32_t get_full_scale_mv(adc_atten_t atten, uint32_t vref);
+static uint32_t get_max_count(adc_bits_width_t width);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static adc_bits_width_t adc1_width = ADC_WIDTH_BIT_12;		///< Configured reading width
+static adc_atten_t channel_atten[ADC1_CHANNEL_MAX];			///< Configured attenuation of each channel
+static uint32_t input_mv[ADC1_CHANNEL_MAX];				///< Voltage on each channel
+static uint32_t noise_state = 1UL;							///< Noise generator state
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/**
+ * Get the input voltage that gives the largest reading
+ *
+ * @param atten The attenuation
+ * @param vref Reference voltage in millivolts
+ * @return Full scale voltage in millivolts
+ */
+static uint32_t get_full_scale_mv(adc_atten_t atten, uint32_t vref)
+{
+	switch (atten)
+	{
+	case ADC_ATTEN_DB_2_5:
+		return vref * 15UL / 11UL;
+	case ADC_ATTEN_DB_6:
+		return vref * 2UL;
+	case ADC_ATTEN_DB_11:
+		return vref * 39UL / 11UL;
+	default:
+		return vref;
+	}
+}
+
+/**
+ * Get the largest reading
+ *
+ * @param width The reading width
+ * @return Largest count
+ */
+static uint32_t get_max_count(adc_bits_width_t width)
+{
+	return (1UL << (9U + (unsigned int)width)) - 1UL;
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+esp_err_t adc1_config_width(adc_bits_width_t width_bit)
+{
+	if (width_bit < ADC_WIDTH_BIT_9 || width_bit > ADC_WIDTH_BIT_12)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	adc1_width = width_bit;
+
+	return ESP_OK;
+}
+
+esp_err_t adc1_config_channel_atten(adc1_channel_t channel, adc_atten_t atten)
+{
+	if (channel < ADC1_CHANNEL_0 || channel >= ADC1_CHANNEL_MAX)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	channel_atten[channel] = atten;
+
+	return ESP_OK;
+}
+
+int adc1_get_raw(adc1_channel_t channel)
+{
+	uint32_t max_count = get_max_count(adc1_width);
+	int32_t reading;
+
+	if (channel < ADC1_CHANNEL_0 || channel >= ADC1_CHANNEL_MAX)
+	{
+		return -1;
+	}
+
+	noise_state = noise_state * 1103515245UL + 12345UL;
+	reading = (int32_t)((uint64_t)input_mv[channel] * max_count / get_full_scale_mv(channel_atten[channel], DEFAULT_VREF_MV));
+	reading += (int32_t)((noise_state >> 16) % (2U * NOISE_COUNTS + 1U)) - NOISE_COUNTS;
+	if (reading < 0L)
+	{
+		reading = 0L;
+	}
+	if (reading > (int32_t)max_count)
+	{
+		reading = (int32_t)max_count;
+	}
+
+	return (int)reading;
+}
+
+esp_err_t esp_adc_cal_check_efuse(esp_adc_cal_value_t value_type)
+{
+	(void)value_type;
+
+	return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t adc_num, adc_atten_t atten, adc_bits_width_t bit_width, uint32_t default_vref,
+		esp_adc_cal_characteristics_t *chars)
+{
+	chars->adc_num = adc_num;
+	chars->atten = atten;
+	chars->bit_width = bit_width;
+	chars->vref = default_vref == 0UL ? DEFAULT_VREF_MV : default_vref;
+	chars->coeff_a = get_full_scale_mv(atten, chars->vref);
+	chars->coeff_b = 0UL;
+
+	return ESP_ADC_CAL_VAL_DEFAULT_VREF;
+}
+
+uint32_t esp_adc_cal_raw_to_voltage(uint32_t adc_reading, const esp_adc_cal_characteristics_t *chars)
+{
+	return (uint32_t)((uint64_t)adc_reading * chars->coeff_a / get_max_count(chars->bit_width)) + chars->coeff_b;
+}
+
+void host_adc_set_input_mv(adc1_channel_t channel, uint32_t millivolts)
+{
+	if (channel >= ADC1_CHANNEL_0 && channel < ADC1_CHANNEL_MAX)
+	{
+		input_mv[channel] = millivolts;
+	}
+}
@@ -0,0 +1,441 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+/*
+ESP-IDF Bluetooth controller, Bluedroid, GAP and SPP on a Linux host. A
+simulated phone takes the place of the remote device. SPP callbacks are made
+from a task standing in for the Bluedroid BTC task, in the order ESP-IDF
+makes them: INIT after esp_spp_init, START after esp_spp_start_srv, then if
+a phone is set to connect SRV_OPEN a few seconds later. A write is completed
+with WRITE after the time the data takes at the link rate, and data sent by
+the phone arrives as DATA_IND. Pairing, congestion and disconnection are not
+simulated.
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_bt.h"
+#include "esp_bt_main.h"
+#include "esp_bt_device.h"
+#include "esp_gap_bt_api.h"
+#include "esp_spp_api.h"
+#include "esp_hal_host.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define BTC_TASK_STACK_SIZE			3072U			///< ESP-IDF default BTC task stack
+#define BTC_TASK_PRIORITY			19U				///< ESP-IDF BTC task priority
+#define EVENT_QUEUE_LENGTH			16U				///< Events waiting for the BTC task
+#define PHONE_CONNECT_DELAY_MS		3000UL			///< Time from server start to the phone connecting
+#define PHONE_DEFAULT_RATE			20000UL			///< Default link throughput in bytes per second
+#define SPP_CONNECTION_HANDLE		0x81UL			///< Handle given to the phone connection
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Event for the BTC task
+ */
+typedef struct
+{
+	esp_spp_cb_event_t event;		///< SPP event to deliver
+	uint8_t *data;					///< Copy of data written or received, freed by the BTC task
+	size_t length;					///< Length of data
+} bt_event_t;
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static bool post_event(esp_spp_cb_event_t event, const uint8_t *data, size_t length);
+static void deliver_event(const bt_event_t *bt_event);
+static void btc_task(void *parameters);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static bool controller_initialised;
+static bool controller_enabled;
+static bool bluedroid_initialised;
+static bool bluedroid_enabled;
+static QueueHandle_t event_queue;									///< Events for the BTC task
+static esp_spp_cb_t *spp_callback;									///< Firmware SPP callback
+static esp_bt_gap_cb_t gap_callback;								///< Firmware GAP callback, never called
+static bool phone_connects = true;									///< Phone connects once the server has started
+static uint32_t phone_rate = PHONE_DEFAULT_RATE;					///< Link throughput in bytes per second
+static host_bt_phone_rx_handler_t phone_rx_handler;				///< Given data sent to the phone
+static bool connect_pending;										///< Server started and phone not yet connected
+static TickType_t connect_tick;										///< Tick the phone connects at
+static host_bt_stats_t stats;										///< Usage figures
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/**
+ * Queue an event for the BTC task
+ *
+ * @param event The SPP event
+ * @param data Data to copy into the event or NULL
+ * @param length Length of data
+ * @return true if queued
+ */
+static bool post_event(esp_spp_cb_event_t event, const uint8_t *data, size_t length)
+{
+	bt_event_t bt_event = {event, NULL, length};
+
+	if (event_queue == NULL)
+	{
+		return false;
+	}
+
+	if (data != NULL && length > 0U)
+	{
+		bt_event.data = malloc(length);
+		if (bt_event.data == NULL)
+		{
+			return false;
+		}
+		(void)memcpy(bt_event.data, data, length);
+	}
+
+	if (xQueueSend(event_queue, &bt_event, (TickType_t)0) != pdPASS)
+	{
+		free(bt_event.data);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Do what an event needs and call the firmware SPP callback
+ *
+ * @param bt_event The event
+ */
+static void deliver_event(const bt_event_t *bt_event)
+{
+	esp_spp_cb_param_t param;
+	TickType_t transfer_ticks;
+
+	(void)memset(&param, 0, sizeof(param));
+
+	switch (bt_event->event)
+	{
+	case ESP_SPP_INIT_EVT:
+		param.init.status = ESP_SPP_SUCCESS;
+		break;
+
+	case ESP_SPP_START_EVT:
+		param.start.status = ESP_SPP_SUCCESS;
+		param.start.handle = SPP_CONNECTION_HANDLE - 1UL;
+		if (phone_connects)
+		{
+			connect_pending = true;
+			connect_tick = xTaskGetTickCount() + pdMS_TO_TICKS(PHONE_CONNECT_DELAY_MS);
+		}
+		break;
+
+	case ESP_SPP_SRV_OPEN_EVT:
+		param.srv_open.status = ESP_SPP_SUCCESS;
+		param.srv_open.handle = SPP_CONNECTION_HANDLE;
+		stats.connected = true;
+		break;
+
+	case ESP_SPP_WRITE_EVT:
+		// the link is busy for as long as the data takes to send
+		transfer_ticks = (TickType_t)(((uint64_t)bt_event->length * configTICK_RATE_HZ + phone_rate - 1U) / phone_rate);
+		if (transfer_ticks > (TickType_t)0)
+		{
+			vTaskDelay(transfer_ticks);
+		}
+		if (phone_rx_handler != NULL)
+		{
+			phone_rx_handler(bt_event->data, bt_event->length);
+		}
+		stats.tx_bytes += (uint64_t)bt_event->length;
+		param.write.status = ESP_SPP_SUCCESS;
+		param.write.handle = SPP_CONNECTION_HANDLE;
+		param.write.len = (int)bt_event->length;
+		param.write.cong = false;
+		break;
+
+	case ESP_SPP_DATA_IND_EVT:
+		stats.rx_bytes += (uint64_t)bt_event->length;
+		param.data_ind.status = ESP_SPP_SUCCESS;
+		param.data_ind.handle = SPP_CONNECTION_HANDLE;
+		param.data_ind.len = (uint16_t)bt_event->length;
+		param.data_ind.data = bt_event->data;
+		break;
+
+	default:
+		break;
+	}
+
+	if (spp_callback != NULL)
+	{
+		spp_callback(bt_event->event, &param);
+	}
+}
+
+/**
+ * Stand in for the Bluedroid BTC task that makes the SPP callbacks
+ *
+ * @param parameters Unused
+ */
+static void btc_task(void *parameters)
+{
+	bt_event_t bt_event;
+	TickType_t wait;
+	TickType_t now;
+
+	(void)parameters;
+
+	while (true)
+	{
+		wait = portMAX_DELAY;
+		if (connect_pending)
+		{
+			now = xTaskGetTickCount();
+			wait = (int32_t)(connect_tick - now) > 0L ? connect_tick - now : (TickType_t)0;
+		}
+
+		if (xQueueReceive(event_queue, &bt_event, wait) == pdTRUE)
+		{
+			deliver_event(&bt_event);
+			free(bt_event.data);
+		}
+		else if (connect_pending)
+		{
+			connect_pending = false;
+			bt_event.event = ESP_SPP_SRV_OPEN_EVT;
+			bt_event.data = NULL;
+			bt_event.length = 0U;
+			deliver_event(&bt_event);
+		}
+	}
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+esp_err_t esp_bt_controller_init(esp_bt_controller_config_t *cfg)
+{
+	if (cfg == NULL)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	if (controller_initialised)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+	controller_initialised = true;
+
+	return ESP_OK;
+}
+
+esp_err_t esp_bt_controller_enable(esp_bt_mode_t mode)
+{
+	if (!controller_initialised || controller_enabled || (mode & ESP_BT_MODE_CLASSIC_BT) == 0)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+	controller_enabled = true;
+
+	return ESP_OK;
+}
+
+esp_err_t esp_bt_controller_mem_release(esp_bt_mode_t mode)
+{
+	(void)mode;
+
+	return controller_initialised ? ESP_ERR_INVALID_STATE : ESP_OK;
+}
+
+esp_err_t esp_bluedroid_init(void)
+{
+	if (!controller_enabled || bluedroid_initialised)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+	bluedroid_initialised = true;
+
+	return ESP_OK;
+}
+
+esp_err_t esp_bluedroid_enable(void)
+{
+	if (!bluedroid_initialised || bluedroid_enabled)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	event_queue = xQueueCreate(EVENT_QUEUE_LENGTH, sizeof(bt_event_t));
+	if (event_queue == NULL)
+	{
+		return ESP_ERR_NO_MEM;
+	}
+	vQueueAddToRegistry(event_queue, "btc events");
+	if (xTaskCreatePinnedToCore(btc_task, "BTC_TASK", BTC_TASK_STACK_SIZE, NULL, BTC_TASK_PRIORITY, NULL, 0) != pdPASS)
+	{
+		return ESP_ERR_NO_MEM;
+	}
+	bluedroid_enabled = true;
+
+	return ESP_OK;
+}
+
+esp_err_t esp_bt_dev_set_device_name(const char *name)
+{
+	return bluedroid_enabled && name != NULL ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_bt_gap_register_callback(esp_bt_gap_cb_t callback)
+{
+	gap_callback = callback;
+	(void)gap_callback;
+
+	return bluedroid_enabled ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_bt_gap_set_scan_mode(esp_bt_connection_mode_t c_mode, esp_bt_discovery_mode_t d_mode)
+{
+	(void)c_mode;
+	(void)d_mode;
+
+	return bluedroid_enabled ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_bt_gap_set_pin(esp_bt_pin_type_t pin_type, uint8_t pin_code_len, esp_bt_pin_code_t pin_code)
+{
+	(void)pin_type;
+	(void)pin_code_len;
+	(void)pin_code;
+
+	return bluedroid_enabled ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_bt_gap_pin_reply(esp_bd_addr_t bd_addr, bool accept, uint8_t pin_code_len, esp_bt_pin_code_t pin_code)
+{
+	(void)bd_addr;
+	(void)accept;
+	(void)pin_code_len;
+	(void)pin_code;
+
+	return bluedroid_enabled ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_spp_register_callback(esp_spp_cb_t *callback)
+{
+	if (!bluedroid_enabled)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+	spp_callback = callback;
+
+	return ESP_OK;
+}
+
+esp_err_t esp_spp_init(esp_spp_mode_t mode)
+{
+	if (!bluedroid_enabled || mode != ESP_SPP_MODE_CB)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	return post_event(ESP_SPP_INIT_EVT, NULL, 0U) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_spp_start_srv(esp_spp_sec_t sec_mask, esp_spp_role_t role, uint8_t local_scn, const char *name)
+{
+	(void)sec_mask;
+	(void)role;
+	(void)local_scn;
+	(void)name;
+
+	return post_event(ESP_SPP_START_EVT, NULL, 0U) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_spp_write(uint32_t handle, int len, uint8_t *p_data)
+{
+	if (!stats.connected || handle != SPP_CONNECTION_HANDLE || len <= 0 || p_data == NULL ||
+			!post_event(ESP_SPP_WRITE_EVT, p_data, (size_t)len))
+	{
+		stats.write_fails++;
+		return ESP_FAIL;
+	}
+	stats.writes++;
+
+	return ESP_OK;
+}
+
+void host_bt_set_phone(bool connect, uint32_t bytes_per_second)
+{
+	phone_connects = connect;
+	phone_rate = bytes_per_second > 0UL ? bytes_per_second : PHONE_DEFAULT_RATE;
+}
+
+void host_bt_set_phone_rx_handler(host_bt_phone_rx_handler_t handler)
+{
+	phone_rx_handler = handler;
+}
+
+bool host_bt_phone_send(const uint8_t *data, size_t length)
+{
+	if (!stats.connected || data == NULL || length == 0U || length > UINT16_MAX)
+	{
+		return false;
+	}
+
+	return post_event(ESP_SPP_DATA_IND_EVT, data, length);
+}
+
+void host_bt_get_stats(host_bt_stats_t *stats_out)
+{
+	if (stats_out != NULL)
+	{
+		*stats_out = stats;
+	}
+}
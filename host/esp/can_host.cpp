@@ -0,0 +1,161 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+can_host.cpp
+
+The ESP32 CAN node on a Linux host. The bus is run to the current host time
+whenever the firmware sends or polls for a frame, so frames move at the
+250 kbit/s rate against whichever clock host_time.h is using. Once the node
+is open a task at the highest priority stands in for the CAN controller: it
+sleeps until the frame on the bus has been sent and runs the bus then, so
+received frames reach the firmware without it polling, as they would by
+interrupt on the device. Its wakeups are on tick boundaries, so a frame can
+arrive up to 1 ms later than it would on the device.
+
+*/
+
+#include <string.h>
+#include "NMEA2000_esp32.h"
+#include "host_time.h"
+
+#define BUS_TASK_STACK_SIZE 4096U
+
+static TaskHandle_t bus_task=NULL;
+
+//*****************************************************************************
+tVirtualCANBus &host_can_get_bus() {
+  static tVirtualCANBus Bus(250000);
+  return Bus;
+}
+
+//*****************************************************************************
+void host_can_run_bus() {
+  tVirtualCANBus &Bus=host_can_get_bus();
+
+  Bus.Run(host_time_get_us());
+  // A frame was queued by some other task, the bus task has to plan its wakeup again
+  if ( bus_task!=NULL && xTaskGetCurrentTaskHandle()!=bus_task && Bus.GetNextFrameEndTime()>=0 ) xTaskNotifyGive(bus_task);
+}
+
+//*****************************************************************************
+static void host_can_bus_task(void *) {
+  tVirtualCANBus &Bus=host_can_get_bus();
+
+  for (;;) {
+    Bus.Run(host_time_get_us());
+
+    int64_t EndTime=Bus.GetNextFrameEndTime();
+    TickType_t Wait=portMAX_DELAY;
+    if ( EndTime>=0 ) {
+      int64_t WaitUs=EndTime-host_time_get_us();
+      Wait=(TickType_t)((WaitUs+portTICK_PERIOD_MS*1000-1)/(portTICK_PERIOD_MS*1000));
+      if ( Wait==0 ) Wait=1;
+    }
+    (void)ulTaskNotifyTake(pdTRUE,Wait);
+  }
+}
+
+//*****************************************************************************
+tNMEA2000_esp32::tNMEA2000_esp32(gpio_num_t _TxPin,  gpio_num_t _RxPin) :
+  tNMEA2000_host(&host_can_get_bus()), TxPin(_TxPin), RxPin(_RxPin), RxFrameHook(0),
+  RxFilterEnabled(false), RxFilterBypass(false), RxAccepted(0), RxRejected(0), RxNotifyTask(NULL) {
+  memset(RxLatencyHistogram,0,sizeof(RxLatencyHistogram));
+}
+
+//*****************************************************************************
+bool tNMEA2000_esp32::CANOpen() {
+  RxFilter.Clear();
+  if ( RxFilterEnabled ) AddReceiveFilterPGNs(RxFilter);
+  RxFilter.Update();
+  if ( bus_task==NULL ) {
+    (void)xTaskCreate(host_can_bus_task,"CAN bus",BUS_TASK_STACK_SIZE,NULL,configMAX_PRIORITIES-1,&bus_task);
+  }
+  return tNMEA2000_host::CANOpen();
+}
+
+//*****************************************************************************
+bool tNMEA2000_esp32::CANSendFrame(unsigned long id, unsigned char len, const unsigned char *buf, bool wait_sent) {
+  bool result=tNMEA2000_host::CANSendFrame(id,len,buf,wait_sent);
+  host_can_run_bus();
+  return result;
+}
+
+//*****************************************************************************
+bool tNMEA2000_esp32::CANGetFrame(unsigned long &id, unsigned char &len, unsigned char *buf) {
+  host_can_run_bus();
+  return tNMEA2000_host::CANGetFrame(id,len,buf);
+}
+
+//*****************************************************************************
+// Frames the controller filter drops never reach the driver, so are not counted.
+bool tNMEA2000_esp32::AcceptRxFrame(const tCANFrame &frame) {
+  if ( RxFilterBypass ) {
+    RxAccepted++;
+    return true;
+  }
+  if ( !RxFilter.IsAcceptedByController(frame.id) ) return false;
+  if ( !RxFilter.IsAccepted(frame.id) ) {
+    RxRejected++;
+    return false;
+  }
+  RxAccepted++;
+  return true;
+}
+
+//*****************************************************************************
+void tNMEA2000_esp32::HandleRxFrame(const tCANFrame &frame) {
+  if ( RxFrameHook!=0 ) RxFrameHook(frame.id,frame.len,frame.buf);
+}
+
+//*****************************************************************************
+void tNMEA2000_esp32::HandleRxFrameQueued(const tCANFrame &/*frame*/) {
+  if ( RxNotifyTask!=NULL ) xTaskNotifyGive(RxNotifyTask);
+}
+
+//*****************************************************************************
+void tNMEA2000_esp32::RecordRxLatency() {
+  int64_t Latency=host_time_get_us()-LastRxFrameTime;
+  int Bucket=0;
+
+  for (; Latency>1 && Bucket<RxLatencyBuckets-1; Latency>>=1, Bucket++);
+  RxLatencyHistogram[Bucket]++;
+}
+
+//*****************************************************************************
+bool tNMEA2000_esp32::InjectRxFrame(unsigned long id, unsigned char len, const unsigned char *buf) {
+  tCANFrame frame;
+
+  // full queue is reported to the caller rather than counted as an overrun of frames from the bus
+  if ( RxQueue==0 || RxQueue->count()+1>=RxQueue->getSize() ) return false;
+
+  frame.id=id;
+  frame.len=len>8?8:len;
+  memcpy(frame.buf,buf,frame.len);
+  frame.Time=host_time_get_us();
+
+  if ( !QueueRxFrame(frame) ) return false;
+  if ( RxNotifyTask!=NULL ) xTaskNotifyGive(RxNotifyTask);
+
+  return true;
+}
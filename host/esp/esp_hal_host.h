@@ -0,0 +1,253 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+#ifndef ESP_HAL_HOST_H
+#define ESP_HAL_HOST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "driver/gpio.h"
+#include "driver/uart.h"
+#include "driver/i2c.h"
+#include "driver/adc.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Function called with data written by the firmware to a UART
+ *
+ * @param port The UART written to
+ * @param data The bytes written
+ * @param length Number of bytes
+ */
+typedef void (*host_uart_tx_handler_t)(uart_port_t port, const uint8_t *data, size_t length);
+
+/**
+ * Usage figures of a UART
+ */
+typedef struct
+{
+	uint64_t tx_bytes;				///< Bytes accepted for transmission
+	uint64_t rx_bytes;				///< Bytes read by the firmware
+	uint64_t rx_dropped;			///< Bytes lost because the receive buffer was full
+	size_t rx_high_water;			///< Most bytes ever waiting in the receive buffer
+	uint32_t tx_short_writes;		///< Writes that could not take all the data offered
+} host_uart_stats_t;
+
+/**
+ * Model of a device on an I2C bus
+ */
+typedef struct
+{
+	uint8_t address;												///< 7 bit device address
+	bool (*write)(void *context, const uint8_t *data, size_t length);	///< Called with the bytes of a write transaction, return false to NACK
+	bool (*read)(void *context, uint8_t *data, size_t length);		///< Called to fill the bytes of a read transaction, return false to NACK
+	void *context;													///< Passed to write and read
+} host_i2c_device_t;
+
+/**
+ * Function called with data sent over Bluetooth SPP to the simulated phone
+ *
+ * @param data The bytes received by the phone
+ * @param length Number of bytes
+ */
+typedef void (*host_bt_phone_rx_handler_t)(const uint8_t *data, size_t length);
+
+/**
+ * Usage figures of the Bluetooth SPP link
+ */
+typedef struct
+{
+	uint32_t writes;				///< Calls to esp_spp_write that were accepted
+	uint32_t write_fails;			///< Calls to esp_spp_write with no connection
+	uint64_t tx_bytes;				///< Bytes delivered to the phone
+	uint64_t rx_bytes;				///< Bytes delivered from the phone
+	bool connected;					///< Phone currently connected
+} host_bt_stats_t;
+
+/*************************
+*** EXTERNAL VARIABLES ***
+*************************/
+
+/***************************
+*** FUNCTIONS PROTOTYPES ***
+***************************/
+
+/**
+ * Seed the esp_random generator so runs can be repeated
+ *
+ * @param seed Any value, 0 is replaced by a fixed non zero seed
+ */
+void host_esp_set_random_seed(uint32_t seed);
+
+/**
+ * Get the number of times the firmware has called esp_restart
+ *
+ * @return Restart count
+ */
+uint32_t host_esp_get_restart_count(void);
+
+/**
+ * Choose whether esp_restart ends the run by stopping the scheduler or is only counted
+ *
+ * @param end_run true to stop the scheduler, false to count the restart and carry on
+ */
+void host_esp_set_restart_ends_run(bool end_run);
+
+/**
+ * Get the level last set on a GPIO output
+ *
+ * @param gpio_num The pin
+ * @return 0 or 1
+ */
+uint32_t host_gpio_get_output(gpio_num_t gpio_num);
+
+/**
+ * Get the number of times a GPIO output has changed from 0 to 1
+ *
+ * @param gpio_num The pin
+ * @return Rising edge count
+ */
+uint32_t host_gpio_get_rising_edges(gpio_num_t gpio_num);
+
+/**
+ * Give data to a UART as if it arrived on the receive pin
+ *
+ * @param port The UART
+ * @param data The bytes received
+ * @param length Number of bytes
+ * @return Number of bytes that fitted in the receive buffer, the rest are counted as dropped
+ */
+size_t host_uart_inject(uart_port_t port, const uint8_t *data, size_t length);
+
+/**
+ * Set the function called with everything the firmware writes to a UART
+ *
+ * @param port The UART
+ * @param handler The function, or NULL for none
+ */
+void host_uart_set_tx_handler(uart_port_t port, host_uart_tx_handler_t handler);
+
+/**
+ * Connect a UART to a file descriptor, a serial device or one end of a pseudo terminal. Data written by the firmware is
+ * written to it and data read from it is received by the firmware. The descriptor is set non-blocking.
+ *
+ * @param port The UART
+ * @param fd The open file descriptor, or -1 to disconnect
+ */
+void host_uart_attach_fd(uart_port_t port, int fd);
+
+/**
+ * Scheduler idle hook that reads attached file descriptors, install with host_freertos_set_idle_hook. With the
+ * virtual clock it waits a short real time for the reply to data just written so the virtual clock does not run
+ * ahead of an external device.
+ *
+ * @param wait_us Longest real time to wait for input
+ */
+void host_uart_idle_hook(int64_t wait_us);
+
+/**
+ * Get usage figures of a UART
+ *
+ * @param port The UART
+ * @param stats Structure to fill
+ */
+void host_uart_get_stats(uart_port_t port, host_uart_stats_t *stats);
+
+/**
+ * Attach a device model to an I2C bus
+ *
+ * @param port The I2C bus
+ * @param device The model, copied
+ * @return true if attached, false if the bus already has the most devices allowed
+ */
+bool host_i2c_attach_device(i2c_port_t port, const host_i2c_device_t *device);
+
+/**
+ * Set the voltage on an ADC1 input pin
+ *
+ * @param channel The ADC1 channel
+ * @param millivolts The voltage
+ */
+void host_adc_set_input_mv(adc1_channel_t channel, uint32_t millivolts);
+
+/**
+ * Set the file non-volatile storage is loaded from by nvs_flash_init and saved to by nvs_commit
+ *
+ * @param path The file, or NULL to keep values in memory only
+ */
+void host_nvs_set_file(const char *path);
+
+/**
+ * Set whether a phone connects once the SPP server has started and how fast the link is
+ *
+ * @param connect true for a phone to connect
+ * @param bytes_per_second Link throughput, writes are completed after the time to send them at this rate
+ */
+void host_bt_set_phone(bool connect, uint32_t bytes_per_second);
+
+/**
+ * Set the function called with data the firmware sends to the phone
+ *
+ * @param handler The function, or NULL for none
+ */
+void host_bt_set_phone_rx_handler(host_bt_phone_rx_handler_t handler);
+
+/**
+ * Send data from the phone to the firmware
+ *
+ * @param data The bytes to send
+ * @param length Number of bytes
+ * @return true if the data was queued, false if no phone is connected or the event queue is full
+ */
+bool host_bt_phone_send(const uint8_t *data, size_t length);
+
+/**
+ * Get usage figures of the Bluetooth SPP link
+ *
+ * @param stats Structure to fill
+ */
+void host_bt_get_stats(host_bt_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
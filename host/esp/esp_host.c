@@ -0,0 +1,281 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+/*
+System, logging and GPIO parts of the ESP-IDF on a Linux host.
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "esp_hal_host.h"
+#include "host_time.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define RANDOM_DEFAULT_SEED		0x2545f491UL		///< Seed used when none is given
+#define LOG_HEX_BYTES_PER_LINE	16					///< Bytes shown on each line by esp_log_buffer_hex
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Name of an error code
+ */
+typedef struct
+{
+	esp_err_t code;				///< The error code
+	const char *name;			///< Its name
+} error_name_t;
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static esp_log_level_t log_level = ESP_LOG_INFO;					///< Level of messages logged for all tags
+static uint32_t random_state = RANDOM_DEFAULT_SEED;				///< xorshift32 state for esp_random
+static uint32_t restart_count;									///< Calls to esp_restart
+static bool restart_ends_run = true;							///< esp_restart stops the scheduler
+static uint8_t gpio_levels[GPIO_NUM_MAX];						///< Last level set on each pin
+static uint32_t gpio_rising_edges[GPIO_NUM_MAX];				///< Number of 0 to 1 changes on each pin
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+static const error_name_t error_names[] =
+{
+	{ESP_OK, "ESP_OK"},
+	{ESP_FAIL, "ESP_FAIL"},
+	{ESP_ERR_NO_MEM, "ESP_ERR_NO_MEM"},
+	{ESP_ERR_INVALID_ARG, "ESP_ERR_INVALID_ARG"},
+	{ESP_ERR_INVALID_STATE, "ESP_ERR_INVALID_STATE"},
+	{ESP_ERR_INVALID_SIZE, "ESP_ERR_INVALID_SIZE"},
+	{ESP_ERR_NOT_FOUND, "ESP_ERR_NOT_FOUND"},
+	{ESP_ERR_NOT_SUPPORTED, "ESP_ERR_NOT_SUPPORTED"},
+	{ESP_ERR_TIMEOUT, "ESP_ERR_TIMEOUT"},
+	{ESP_ERR_NVS_NOT_INITIALIZED, "ESP_ERR_NVS_NOT_INITIALIZED"},
+	{ESP_ERR_NVS_NOT_FOUND, "ESP_ERR_NVS_NOT_FOUND"},
+	{ESP_ERR_NVS_READ_ONLY, "ESP_ERR_NVS_READ_ONLY"},
+	{ESP_ERR_NVS_INVALID_HANDLE, "ESP_ERR_NVS_INVALID_HANDLE"},
+	{ESP_ERR_NVS_INVALID_LENGTH, "ESP_ERR_NVS_INVALID_LENGTH"},
+	{ESP_ERR_NVS_NO_FREE_PAGES, "ESP_ERR_NVS_NO_FREE_PAGES"},
+	{ESP_ERR_NVS_NEW_VERSION_FOUND, "ESP_ERR_NVS_NEW_VERSION_FOUND"}
+};
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+	(void)tag;
+	log_level = level;
+}
+
+esp_log_level_t esp_log_level_get(void)
+{
+	return log_level;
+}
+
+uint32_t esp_log_timestamp(void)
+{
+	return (uint32_t)(host_time_get_us() / 1000LL);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+	va_list args;
+
+	(void)tag;
+	if (level > log_level)
+	{
+		return;
+	}
+
+	va_start(args, format);
+	(void)vfprintf(stderr, format, args);
+	va_end(args);
+}
+
+void esp_log_buffer_hex(const char *tag, const void *buffer, uint16_t buff_len)
+{
+	const uint8_t *bytes = (const uint8_t *)buffer;
+	char line[LOG_HEX_BYTES_PER_LINE * 3 + 1];
+	uint16_t i;
+	uint16_t j;
+
+	for (i = 0U; i < buff_len; i += LOG_HEX_BYTES_PER_LINE)
+	{
+		for (j = 0U; j < LOG_HEX_BYTES_PER_LINE && i + j < buff_len; j++)
+		{
+			(void)snprintf(line + j * 3U, 4, "%02x ", bytes[i + j]);
+		}
+		ESP_LOGI(tag, "%s", line);
+	}
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+	size_t i;
+
+	for (i = 0U; i < sizeof(error_names) / sizeof(error_names[0]); i++)
+	{
+		if (error_names[i].code == code)
+		{
+			return error_names[i].name;
+		}
+	}
+
+	return "UNKNOWN ERROR";
+}
+
+void _esp_error_check_failed(esp_err_t rc, const char *file, int line, const char *function, const char *expression)
+{
+	(void)fprintf(stderr, "ESP_ERROR_CHECK failed: esp_err_t 0x%x (%s) at %s:%d\nfunction: %s\nexpression: %s\n",
+			rc, esp_err_to_name(rc), file, line, function, expression);
+	abort();
+}
+
+void esp_restart(void)
+{
+	restart_count++;
+	ESP_LOGW("esp_host", "esp_restart called from %s", pcTaskGetName(NULL));
+	if (restart_ends_run)
+	{
+		vTaskEndScheduler();
+	}
+}
+
+uint32_t esp_random(void)
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+
+	return random_state;
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+	return (uint32_t)xPortGetFreeHeapSize();
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+	return (uint32_t)xPortGetMinimumEverFreeHeapSize();
+}
+
+esp_err_t gpio_config(const gpio_config_t *pGPIOConfig)
+{
+	if (pGPIOConfig == NULL || pGPIOConfig->pin_bit_mask >> GPIO_NUM_MAX != 0ULL)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+	if (gpio_num < GPIO_NUM_0 || gpio_num >= GPIO_NUM_MAX)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	level = level ? 1U : 0U;
+	if (level == 1U && gpio_levels[gpio_num] == 0U)
+	{
+		gpio_rising_edges[gpio_num]++;
+	}
+	gpio_levels[gpio_num] = (uint8_t)level;
+
+	return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+	if (gpio_num < GPIO_NUM_0 || gpio_num >= GPIO_NUM_MAX)
+	{
+		return 0;
+	}
+
+	return (int)gpio_levels[gpio_num];
+}
+
+void host_esp_set_random_seed(uint32_t seed)
+{
+	random_state = seed == 0UL ? RANDOM_DEFAULT_SEED : seed;
+}
+
+uint32_t host_esp_get_restart_count(void)
+{
+	return restart_count;
+}
+
+void host_esp_set_restart_ends_run(bool end_run)
+{
+	restart_ends_run = end_run;
+}
+
+uint32_t host_gpio_get_output(gpio_num_t gpio_num)
+{
+	return (uint32_t)gpio_get_level(gpio_num);
+}
+
+uint32_t host_gpio_get_rising_edges(gpio_num_t gpio_num)
+{
+	if (gpio_num < GPIO_NUM_0 || gpio_num >= GPIO_NUM_MAX)
+	{
+		return 0UL;
+	}
+
+	return gpio_rising_edges[gpio_num];
+}
@@ -0,0 +1,408 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+/*
+ESP-IDF I2C master driver on a Linux host. A command link is a list of the
+start, write, read and stop steps queued by the i2c_master_ functions. It is
+run by i2c_master_cmd_begin against the device models attached to the bus
+with host_i2c_attach_device. The bytes written between a start and the next
+start or stop are given to the device in one call, as are the bytes read.
+Bus timing is not modelled, a transaction takes no time.
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "driver/i2c.h"
+#include "esp_hal_host.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define DEVICES_PER_BUS_MAX		8U			///< Most device models on one bus
+#define TRANSFER_MAX			64U			///< Most bytes in one write or read step
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Kind of command link step
+ */
+typedef enum
+{
+	STEP_START,						///< Start or repeated start
+	STEP_WRITE,						///< Write bytes
+	STEP_READ,						///< Read bytes
+	STEP_STOP						///< Stop
+} step_type_t;
+
+/**
+ * One step in a command link
+ */
+typedef struct step_t
+{
+	step_type_t type;				///< What the step does
+	uint8_t data[TRANSFER_MAX];		///< Bytes to write
+	uint8_t *destination;			///< Where read bytes go
+	size_t length;					///< Number of bytes written or read
+	struct step_t *next;			///< Next step
+} step_t;
+
+/**
+ * A command link
+ */
+typedef struct
+{
+	step_t *first;					///< First step
+	step_t *last;					///< Last step
+} cmd_link_t;
+
+/**
+ * State of one bus
+ */
+typedef struct
+{
+	bool installed;										///< i2c_driver_install has been called
+	host_i2c_device_t devices[DEVICES_PER_BUS_MAX];		///< Attached device models
+	size_t device_count;								///< Number of entries used in devices
+} bus_t;
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static esp_err_t add_step(i2c_cmd_handle_t cmd_handle, step_type_t type, const uint8_t *data, uint8_t *destination, size_t length);
+static const host_i2c_device_t *find_device(const bus_t *bus, uint8_t address);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static bus_t buses[I2C_NUM_MAX];
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/**
+ * Add a step to the end of a command link
+ *
+ * @param cmd_handle The command link
+ * @param type What the step does
+ * @param data Bytes to write or NULL
+ * @param destination Where read bytes go or NULL
+ * @param length Number of bytes written or read
+ * @return ESP_OK, or an error if the step could not be added
+ */
+static esp_err_t add_step(i2c_cmd_handle_t cmd_handle, step_type_t type, const uint8_t *data, uint8_t *destination, size_t length)
+{
+	cmd_link_t *link = (cmd_link_t *)cmd_handle;
+	step_t *step;
+
+	if (link == NULL || length > TRANSFER_MAX)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	step = calloc(1U, sizeof(step_t));
+	if (step == NULL)
+	{
+		return ESP_ERR_NO_MEM;
+	}
+	step->type = type;
+	if (data != NULL)
+	{
+		(void)memcpy(step->data, data, length);
+	}
+	step->destination = destination;
+	step->length = length;
+
+	if (link->last == NULL)
+	{
+		link->first = step;
+	}
+	else
+	{
+		link->last->next = step;
+	}
+	link->last = step;
+
+	return ESP_OK;
+}
+
+/**
+ * Find the model of the device with an address
+ *
+ * @param bus The bus
+ * @param address 7 bit address
+ * @return The device or NULL if none answers
+ */
+static const host_i2c_device_t *find_device(const bus_t *bus, uint8_t address)
+{
+	size_t i;
+
+	for (i = 0U; i < bus->device_count; i++)
+	{
+		if (bus->devices[i].address == address)
+		{
+			return &bus->devices[i];
+		}
+	}
+
+	return NULL;
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t *i2c_conf)
+{
+	if (i2c_num < I2C_NUM_0 || i2c_num >= I2C_NUM_MAX || i2c_conf == NULL || i2c_conf->mode != I2C_MODE_MASTER)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	return ESP_OK;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t i2c_num, i2c_mode_t mode, size_t slv_rx_buf_len, size_t slv_tx_buf_len, int intr_alloc_flags)
+{
+	(void)slv_rx_buf_len;
+	(void)slv_tx_buf_len;
+	(void)intr_alloc_flags;
+
+	if (i2c_num < I2C_NUM_0 || i2c_num >= I2C_NUM_MAX || mode != I2C_MODE_MASTER)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	if (buses[i2c_num].installed)
+	{
+		return ESP_FAIL;
+	}
+	buses[i2c_num].installed = true;
+
+	return ESP_OK;
+}
+
+esp_err_t i2c_driver_delete(i2c_port_t i2c_num)
+{
+	if (i2c_num < I2C_NUM_0 || i2c_num >= I2C_NUM_MAX)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	buses[i2c_num].installed = false;
+
+	return ESP_OK;
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create(void)
+{
+	return (i2c_cmd_handle_t)calloc(1U, sizeof(cmd_link_t));
+}
+
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd_handle)
+{
+	cmd_link_t *link = (cmd_link_t *)cmd_handle;
+	step_t *step;
+	step_t *next;
+
+	if (link == NULL)
+	{
+		return;
+	}
+
+	for (step = link->first; step != NULL; step = next)
+	{
+		next = step->next;
+		free(step);
+	}
+	free(link);
+}
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd_handle)
+{
+	return add_step(cmd_handle, STEP_START, NULL, NULL, 0U);
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd_handle)
+{
+	return add_step(cmd_handle, STEP_STOP, NULL, NULL, 0U);
+}
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd_handle, uint8_t data, bool ack_en)
+{
+	(void)ack_en;
+
+	return add_step(cmd_handle, STEP_WRITE, &data, NULL, 1U);
+}
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd_handle, const uint8_t *data, size_t data_len, bool ack_en)
+{
+	(void)ack_en;
+
+	if (data == NULL)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	return add_step(cmd_handle, STEP_WRITE, data, NULL, data_len);
+}
+
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd_handle, uint8_t *data, i2c_ack_type_t ack)
+{
+	(void)ack;
+
+	if (data == NULL)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	return add_step(cmd_handle, STEP_READ, NULL, data, 1U);
+}
+
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd_handle, uint8_t *data, size_t data_len, i2c_ack_type_t ack)
+{
+	(void)ack;
+
+	if (data == NULL || data_len == 0U)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	return add_step(cmd_handle, STEP_READ, NULL, data, data_len);
+}
+
+esp_err_t i2c_master_cmd_begin(i2c_port_t i2c_num, i2c_cmd_handle_t cmd_handle, TickType_t ticks_to_wait)
+{
+	cmd_link_t *link = (cmd_link_t *)cmd_handle;
+	const host_i2c_device_t *device = NULL;
+	uint8_t written[TRANSFER_MAX];
+	size_t written_length = 0U;
+	bool address_next = false;
+	bool reading = false;
+	step_t *step;
+	size_t offset;
+
+	(void)ticks_to_wait;
+
+	if (i2c_num < I2C_NUM_0 || i2c_num >= I2C_NUM_MAX || link == NULL)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	if (!buses[i2c_num].installed)
+	{
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	for (step = link->first; step != NULL; step = step->next)
+	{
+		if (step->type == STEP_START || step->type == STEP_STOP)
+		{
+			if (written_length > 0U)
+			{
+				if (device->write == NULL || !device->write(device->context, written, written_length))
+				{
+					return ESP_FAIL;
+				}
+				written_length = 0U;
+			}
+			address_next = step->type == STEP_START;
+			continue;
+		}
+
+		offset = 0U;
+		if (address_next)
+		{
+			// first byte after a start is the address and direction, no reply means no device
+			address_next = false;
+			device = find_device(&buses[i2c_num], (uint8_t)(step->data[0] >> 1));
+			if (device == NULL)
+			{
+				return ESP_FAIL;
+			}
+			reading = (step->data[0] & 0x01U) != 0U;
+			offset = 1U;
+		}
+		if (device == NULL)
+		{
+			return ESP_ERR_INVALID_STATE;
+		}
+
+		if (step->type == STEP_WRITE)
+		{
+			if (step->length == offset)
+			{
+				continue;
+			}
+			if (reading || written_length + step->length - offset > sizeof(written))
+			{
+				return ESP_FAIL;
+			}
+			(void)memcpy(written + written_length, step->data + offset, step->length - offset);
+			written_length += step->length - offset;
+		}
+		else
+		{
+			if (!reading || device->read == NULL || !device->read(device->context, step->destination, step->length))
+			{
+				return ESP_FAIL;
+			}
+		}
+	}
+
+	return ESP_OK;
+}
+
+bool host_i2c_attach_device(i2c_port_t port, const host_i2c_device_t *device)
+{
+	bus_t *bus;
+
+	if (port < I2C_NUM_0 || port >= I2C_NUM_MAX || device == NULL)
+	{
+		return false;
+	}
+	bus = &buses[port];
+	if (bus->device_count >= DEVICES_PER_BUS_MAX)
+	{
+		return false;
+	}
+	bus->devices[bus->device_count++] = *device;
+
+	return true;
+}
@@ -0,0 +1,84 @@
+/*
+Host stand-in for the n2klib NMEA2000_esp32.h, found first on the include
+path so NMEA2000_CAN.h with USE_N2K_CAN 7 builds unchanged. The ESP32 CAN
+controller is replaced by a node on the virtual CAN bus returned by
+host_can_get_bus, which other simulated nodes attach to, see can_host.cpp.
+*/
+
+#ifndef _NMEA2000_ESP32_H_
+#define _NMEA2000_ESP32_H_
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "NMEA2000_host.h"
+
+#ifndef ESP32_CAN_TX_PIN
+#define ESP32_CAN_TX_PIN GPIO_NUM_5
+#endif
+#ifndef ESP32_CAN_RX_PIN
+#define ESP32_CAN_RX_PIN GPIO_NUM_4
+#endif
+
+// The bus shared by the firmware and the simulated nodes. Created on first use so it exists before the static
+// initialiser in NMEA2000_CAN.h constructs the firmware node.
+tVirtualCANBus &host_can_get_bus();
+
+// Transmit whatever the bus has had time to send up to the current host time.
+void host_can_run_bus();
+
+class tNMEA2000_esp32 : public tNMEA2000_host
+{
+public:
+  typedef void (*tRxFrameHook)(unsigned long id, unsigned char len, const unsigned char *buf);
+  static const int RxLatencyBuckets=16;
+
+protected:
+  gpio_num_t TxPin;
+  gpio_num_t RxPin;
+  tRxFrameHook RxFrameHook;
+  bool RxFilterEnabled;
+  bool RxFilterBypass;
+  tN2kRxFilter RxFilter;
+  uint32_t RxAccepted;
+  uint32_t RxRejected;
+  TaskHandle_t RxNotifyTask;
+  uint32_t RxLatencyHistogram[RxLatencyBuckets];
+
+protected:
+  bool CANSendFrame(unsigned long id, unsigned char len, const unsigned char *buf, bool wait_sent=true);
+  bool CANOpen();
+  bool CANGetFrame(unsigned long &id, unsigned char &len, unsigned char *buf);
+  bool AcceptRxFrame(const tCANFrame &frame);
+  void HandleRxFrame(const tCANFrame &frame);
+  void HandleRxFrameQueued(const tCANFrame &frame);
+
+public:
+  tNMEA2000_esp32(gpio_num_t _TxPin=ESP32_CAN_TX_PIN,  gpio_num_t _RxPin=ESP32_CAN_RX_PIN);
+
+  // Same as the device driver, the hook is called as each frame reaches the controller.
+  void SetRxFrameHook(tRxFrameHook hook) { RxFrameHook=hook; }
+  // Both filter stages are run in AcceptRxFrame, the controller stage with the code and mask the device would use.
+  void EnableRxFilter(bool Enable=true) { if (RxQueue==0) RxFilterEnabled=Enable; }
+  // No controller reset here, so no frames are missed when switching.
+  void SetRxFilterBypass(bool Bypass) { RxFilterBypass=Bypass; }
+  uint32_t GetRxAcceptedFrames() const { return RxAccepted; }
+  uint32_t GetRxRejectedFrames() const { return RxRejected; }
+  bool InjectRxFrame(unsigned long id, unsigned char len, const unsigned char *buf);
+  // The virtual bus has no controller FIFO, so there are no hardware overruns.
+  uint32_t GetRxOverruns() const { return Statistics.RxOverruns; }
+  uint16_t GetRxHighWater() const { return Statistics.RxHighWater; }
+  uint32_t GetRxHardwareOverruns() const { return 0; }
+  // Nothing goes wrong on the virtual bus.
+  uint8_t GetTxErrorCounter() const { return 0; }
+  uint8_t GetRxErrorCounter() const { return 0; }
+  uint16_t GetRxPendingFrames() { return GetRxQueueCount(); }
+  // The task is notified as frames are queued by the bus, which is run by a task standing in for the
+  // controller so that frames arrive when they end on the bus, see host_can_bus_task.
+  void SetRxNotifyTask(TaskHandle_t Task) { RxNotifyTask=Task; }
+  void RecordRxLatency();
+  const uint32_t *GetRxLatencyHistogram() const { return RxLatencyHistogram; }
+};
+
+#endif
@@ -0,0 +1,43 @@
+/*
+Host stand-in for the ESP-IDF esp_adc_cal.h. Characterization is a straight
+line through zero using the default reference voltage, see adc_host.c.
+*/
+
+#ifndef __ESP_ADC_CAL_H__
+#define __ESP_ADC_CAL_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/adc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+	ESP_ADC_CAL_VAL_EFUSE_VREF = 0,
+	ESP_ADC_CAL_VAL_EFUSE_TP = 1,
+	ESP_ADC_CAL_VAL_DEFAULT_VREF = 2
+} esp_adc_cal_value_t;
+
+typedef struct
+{
+	adc_unit_t adc_num;
+	adc_atten_t atten;
+	adc_bits_width_t bit_width;
+	uint32_t coeff_a;
+	uint32_t coeff_b;
+	uint32_t vref;
+} esp_adc_cal_characteristics_t;
+
+esp_err_t esp_adc_cal_check_efuse(esp_adc_cal_value_t value_type);
+esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t adc_num, adc_atten_t atten, adc_bits_width_t bit_width, uint32_t default_vref,
+		esp_adc_cal_characteristics_t *chars);
+uint32_t esp_adc_cal_raw_to_voltage(uint32_t adc_reading, const esp_adc_cal_characteristics_t *chars);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,48 @@
+/*
+Host stand-in for the ESP-IDF esp_bt.h. The controller calls only record
+state, see bt_host.c.
+*/
+
+#ifndef __ESP_BT_H__
+#define __ESP_BT_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_bt_defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+	ESP_BT_MODE_IDLE = 0x00,
+	ESP_BT_MODE_BLE = 0x01,
+	ESP_BT_MODE_CLASSIC_BT = 0x02,
+	ESP_BT_MODE_BTDM = 0x03
+} esp_bt_mode_t;
+
+typedef struct
+{
+	uint16_t controller_task_stack_size;
+	uint8_t controller_task_prio;
+	uint8_t mode;
+	uint8_t bt_max_acl_conn;
+} esp_bt_controller_config_t;
+
+#define BT_CONTROLLER_INIT_CONFIG_DEFAULT() {	\
+	.controller_task_stack_size = 4096,			\
+	.controller_task_prio = 23,					\
+	.mode = ESP_BT_MODE_CLASSIC_BT,				\
+	.bt_max_acl_conn = 2						\
+}
+
+esp_err_t esp_bt_controller_init(esp_bt_controller_config_t *cfg);
+esp_err_t esp_bt_controller_enable(esp_bt_mode_t mode);
+esp_err_t esp_bt_controller_mem_release(esp_bt_mode_t mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,21 @@
+/*
+Host stand-in for the ESP-IDF esp_bt_main.h, see bt_host.c.
+*/
+
+#ifndef __ESP_BT_MAIN_H__
+#define __ESP_BT_MAIN_H__
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t esp_bluedroid_init(void);
+esp_err_t esp_bluedroid_enable(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
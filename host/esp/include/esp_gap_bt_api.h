@@ -0,0 +1,92 @@
+/*
+Host stand-in for the ESP-IDF esp_gap_bt_api.h. Pairing is not simulated so
+the GAP callback is registered but never called, see bt_host.c.
+*/
+
+#ifndef __ESP_GAP_BT_API_H__
+#define __ESP_GAP_BT_API_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_bt_defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_BT_GAP_MAX_BDNAME_LEN		248
+#define ESP_BT_PIN_CODE_LEN				16
+
+typedef uint8_t esp_bt_pin_code_t[ESP_BT_PIN_CODE_LEN];
+
+typedef enum
+{
+	ESP_BT_PIN_TYPE_VARIABLE = 0,
+	ESP_BT_PIN_TYPE_FIXED = 1
+} esp_bt_pin_type_t;
+
+typedef enum
+{
+	ESP_BT_NON_CONNECTABLE,
+	ESP_BT_CONNECTABLE
+} esp_bt_connection_mode_t;
+
+typedef enum
+{
+	ESP_BT_NON_DISCOVERABLE,
+	ESP_BT_LIMITED_DISCOVERABLE,
+	ESP_BT_GENERAL_DISCOVERABLE
+} esp_bt_discovery_mode_t;
+
+typedef enum
+{
+	ESP_BT_GAP_DISC_RES_EVT = 0,
+	ESP_BT_GAP_DISC_STATE_CHANGED_EVT,
+	ESP_BT_GAP_RMT_SRVCS_EVT,
+	ESP_BT_GAP_RMT_SRVC_REC_EVT,
+	ESP_BT_GAP_AUTH_CMPL_EVT,
+	ESP_BT_GAP_PIN_REQ_EVT,
+	ESP_BT_GAP_CFM_REQ_EVT,
+	ESP_BT_GAP_KEY_NOTIF_EVT,
+	ESP_BT_GAP_KEY_REQ_EVT,
+	ESP_BT_GAP_READ_RSSI_DELTA_EVT,
+	ESP_BT_GAP_CONFIG_EIR_DATA_EVT,
+	ESP_BT_GAP_SET_AFH_CHANNELS_EVT,
+	ESP_BT_GAP_READ_REMOTE_NAME_EVT,
+	ESP_BT_GAP_MODE_CHG_EVT,
+	ESP_BT_GAP_EVT_MAX
+} esp_bt_gap_cb_event_t;
+
+typedef union
+{
+	struct auth_cmpl_param
+	{
+		esp_bd_addr_t bda;
+		esp_bt_status_t stat;
+		uint8_t device_name[ESP_BT_GAP_MAX_BDNAME_LEN + 1];
+	} auth_cmpl;
+	struct pin_req_param
+	{
+		esp_bd_addr_t bda;
+		bool min_16_digit;
+	} pin_req;
+	struct mode_chg_param
+	{
+		esp_bd_addr_t bda;
+		uint8_t mode;
+	} mode_chg;
+} esp_bt_gap_cb_param_t;
+
+typedef void (*esp_bt_gap_cb_t)(esp_bt_gap_cb_event_t event, esp_bt_gap_cb_param_t *param);
+
+esp_err_t esp_bt_gap_register_callback(esp_bt_gap_cb_t callback);
+esp_err_t esp_bt_gap_set_scan_mode(esp_bt_connection_mode_t c_mode, esp_bt_discovery_mode_t d_mode);
+esp_err_t esp_bt_gap_set_pin(esp_bt_pin_type_t pin_type, uint8_t pin_code_len, esp_bt_pin_code_t pin_code);
+esp_err_t esp_bt_gap_pin_reply(esp_bd_addr_t bd_addr, bool accept, uint8_t pin_code_len, esp_bt_pin_code_t pin_code);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,465 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+/*
+ESP-IDF non-volatile storage on a Linux host. Only blobs are supported as
+that is all the firmware stores. Values are kept in memory and, if a file
+has been given with host_nvs_set_file, loaded from it by nvs_flash_init and
+written back to it by nvs_commit so settings survive between runs.
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "esp_hal_host.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define NAME_LENGTH_MAX		16U			///< Longest namespace or key name including terminator, as ESP-IDF
+#define ENTRIES_MAX			32U			///< Most values stored
+#define HANDLES_MAX			8U			///< Most namespaces open at once
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * One stored value
+ */
+typedef struct
+{
+	char name_space[NAME_LENGTH_MAX];	///< Namespace the value is in
+	char key[NAME_LENGTH_MAX];			///< Key of the value
+	uint8_t *value;						///< The value, NULL if the entry is unused
+	size_t length;						///< Length of value in bytes
+} entry_t;
+
+/**
+ * An open namespace
+ */
+typedef struct
+{
+	bool open;							///< Handle is in use
+	char name_space[NAME_LENGTH_MAX];	///< The namespace
+	nvs_open_mode_t mode;				///< Read only or read write
+} open_handle_t;
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static open_handle_t *get_handle(nvs_handle_t handle);
+static entry_t *find_entry(const char *name_space, const char *key);
+static bool namespace_exists(const char *name_space);
+static void clear_entries(void);
+static void load_file(void);
+static esp_err_t save_file(void);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static entry_t entries[ENTRIES_MAX];
+static open_handle_t handles[HANDLES_MAX];
+static bool initialised;					///< nvs_flash_init has been called
+static const char *file_path;				///< File values are saved to or NULL
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/**
+ * Look up an open handle
+ *
+ * @param handle The handle
+ * @return Its state or NULL if the handle is not open
+ */
+static open_handle_t *get_handle(nvs_handle_t handle)
+{
+	if (handle == 0UL || handle > HANDLES_MAX || !handles[handle - 1UL].open)
+	{
+		return NULL;
+	}
+
+	return &handles[handle - 1UL];
+}
+
+/**
+ * Find a stored value
+ *
+ * @param name_space Namespace of the value
+ * @param key Key of the value
+ * @return The entry or NULL if there is no value
+ */
+static entry_t *find_entry(const char *name_space, const char *key)
+{
+	size_t i;
+
+	for (i = 0U; i < ENTRIES_MAX; i++)
+	{
+		if (entries[i].value != NULL && strcmp(entries[i].name_space, name_space) == 0 && strcmp(entries[i].key, key) == 0)
+		{
+			return &entries[i];
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Find out if any value is stored in a namespace
+ *
+ * @param name_space The namespace
+ * @return true if it holds a value
+ */
+static bool namespace_exists(const char *name_space)
+{
+	size_t i;
+
+	for (i = 0U; i < ENTRIES_MAX; i++)
+	{
+		if (entries[i].value != NULL && strcmp(entries[i].name_space, name_space) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Remove all stored values
+ */
+static void clear_entries(void)
+{
+	size_t i;
+
+	for (i = 0U; i < ENTRIES_MAX; i++)
+	{
+		free(entries[i].value);
+		entries[i].value = NULL;
+		entries[i].length = 0U;
+	}
+}
+
+/**
+ * Load the stored values from the file, if there is one. The file holds for each value its namespace and key padded
+ * to NAME_LENGTH_MAX, its length as a 32 bit host order value and then the value.
+ */
+static void load_file(void)
+{
+	FILE *file;
+	entry_t *entry;
+	uint32_t length;
+	size_t i;
+
+	if (file_path == NULL)
+	{
+		return;
+	}
+	file = fopen(file_path, "rb");
+	if (file == NULL)
+	{
+		return;
+	}
+
+	for (i = 0U; i < ENTRIES_MAX; i++)
+	{
+		entry = &entries[i];
+		if (fread(entry->name_space, NAME_LENGTH_MAX, 1U, file) != 1U || fread(entry->key, NAME_LENGTH_MAX, 1U, file) != 1U ||
+				fread(&length, sizeof(length), 1U, file) != 1U)
+		{
+			break;
+		}
+		entry->name_space[NAME_LENGTH_MAX - 1U] = '\0';
+		entry->key[NAME_LENGTH_MAX - 1U] = '\0';
+		entry->value = malloc(length > 0UL ? (size_t)length : 1U);
+		if (entry->value == NULL || fread(entry->value, 1U, (size_t)length, file) != (size_t)length)
+		{
+			free(entry->value);
+			entry->value = NULL;
+			break;
+		}
+		entry->length = (size_t)length;
+	}
+
+	(void)fclose(file);
+}
+
+/**
+ * Write all stored values to the file, if there is one
+ *
+ * @return ESP_OK or ESP_FAIL if the file could not be written
+ */
+static esp_err_t save_file(void)
+{
+	FILE *file;
+	uint32_t length;
+	bool ok = true;
+	size_t i;
+
+	if (file_path == NULL)
+	{
+		return ESP_OK;
+	}
+	file = fopen(file_path, "wb");
+	if (file == NULL)
+	{
+		return ESP_FAIL;
+	}
+
+	for (i = 0U; i < ENTRIES_MAX && ok; i++)
+	{
+		if (entries[i].value == NULL)
+		{
+			continue;
+		}
+		length = (uint32_t)entries[i].length;
+		ok = fwrite(entries[i].name_space, NAME_LENGTH_MAX, 1U, file) == 1U && fwrite(entries[i].key, NAME_LENGTH_MAX, 1U, file) == 1U &&
+				fwrite(&length, sizeof(length), 1U, file) == 1U && fwrite(entries[i].value, 1U, entries[i].length, file) == entries[i].length;
+	}
+
+	if (fclose(file) != 0)
+	{
+		ok = false;
+	}
+
+	return ok ? ESP_OK : ESP_FAIL;
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+esp_err_t nvs_flash_init(void)
+{
+	if (!initialised)
+	{
+		load_file();
+		initialised = true;
+	}
+
+	return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+	clear_entries();
+
+	return save_file();
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+	size_t i;
+
+	if (out_handle == NULL)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	*out_handle = 0UL;
+	if (!initialised)
+	{
+		return ESP_ERR_NVS_NOT_INITIALIZED;
+	}
+	if (name == NULL || strlen(name) >= NAME_LENGTH_MAX)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	if (open_mode == NVS_READONLY && !namespace_exists(name))
+	{
+		return ESP_ERR_NVS_NOT_FOUND;
+	}
+
+	for (i = 0U; i < HANDLES_MAX; i++)
+	{
+		if (!handles[i].open)
+		{
+			handles[i].open = true;
+			(void)strcpy(handles[i].name_space, name);
+			handles[i].mode = open_mode;
+			*out_handle = (nvs_handle_t)(i + 1U);
+			return ESP_OK;
+		}
+	}
+
+	return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+	open_handle_t *open_handle = get_handle(handle);
+
+	if (open_handle != NULL)
+	{
+		open_handle->open = false;
+	}
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+	open_handle_t *open_handle = get_handle(handle);
+	entry_t *entry;
+	uint8_t *copy;
+	size_t i;
+
+	if (open_handle == NULL)
+	{
+		return ESP_ERR_NVS_INVALID_HANDLE;
+	}
+	if (open_handle->mode == NVS_READONLY)
+	{
+		return ESP_ERR_NVS_READ_ONLY;
+	}
+	if (key == NULL || strlen(key) >= NAME_LENGTH_MAX || (value == NULL && length > 0U))
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	copy = malloc(length > 0U ? length : 1U);
+	if (copy == NULL)
+	{
+		return ESP_ERR_NO_MEM;
+	}
+	if (length > 0U)
+	{
+		(void)memcpy(copy, value, length);
+	}
+
+	entry = find_entry(open_handle->name_space, key);
+	for (i = 0U; entry == NULL && i < ENTRIES_MAX; i++)
+	{
+		if (entries[i].value == NULL)
+		{
+			entry = &entries[i];
+			(void)strcpy(entry->name_space, open_handle->name_space);
+			(void)strcpy(entry->key, key);
+		}
+	}
+	if (entry == NULL)
+	{
+		free(copy);
+		return ESP_ERR_NVS_NO_FREE_PAGES;
+	}
+
+	free(entry->value);
+	entry->value = copy;
+	entry->length = length;
+
+	return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+	open_handle_t *open_handle = get_handle(handle);
+	entry_t *entry;
+
+	if (open_handle == NULL)
+	{
+		return ESP_ERR_NVS_INVALID_HANDLE;
+	}
+	if (key == NULL || length == NULL)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	entry = find_entry(open_handle->name_space, key);
+	if (entry == NULL)
+	{
+		return ESP_ERR_NVS_NOT_FOUND;
+	}
+	if (out_value == NULL)
+	{
+		*length = entry->length;
+		return ESP_OK;
+	}
+	if (*length < entry->length)
+	{
+		*length = entry->length;
+		return ESP_ERR_NVS_INVALID_LENGTH;
+	}
+
+	(void)memcpy(out_value, entry->value, entry->length);
+	*length = entry->length;
+
+	return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+	open_handle_t *open_handle = get_handle(handle);
+	entry_t *entry;
+
+	if (open_handle == NULL)
+	{
+		return ESP_ERR_NVS_INVALID_HANDLE;
+	}
+	if (open_handle->mode == NVS_READONLY)
+	{
+		return ESP_ERR_NVS_READ_ONLY;
+	}
+
+	entry = find_entry(open_handle->name_space, key);
+	if (entry == NULL)
+	{
+		return ESP_ERR_NVS_NOT_FOUND;
+	}
+	free(entry->value);
+	entry->value = NULL;
+	entry->length = 0U;
+
+	return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+	if (get_handle(handle) == NULL)
+	{
+		return ESP_ERR_NVS_INVALID_HANDLE;
+	}
+
+	return save_file();
+}
+
+void host_nvs_set_file(const char *path)
+{
+	file_path = path;
+}
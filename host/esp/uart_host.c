@@ -0,0 +1,637 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+/*
+ESP-IDF UART driver on a Linux host. Each port has the receive buffer size
+given to uart_driver_install, filled by host_uart_inject or from an attached
+file descriptor. Transmitted bytes go into a model of the 128 byte hardware
+FIFO plus the driver transmit buffer that drains at the configured baud rate,
+so uart_tx_chars returns short and uart_write_bytes blocks as on the device.
+
+With the virtual clock a poll that finds nothing waiting moves the clock on
+by one character time. Firmware that spins polling for a byte therefore sees
+time pass and reaches its timeout instead of hanging the scheduler.
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/uart.h"
+#include "esp_hal_host.h"
+#include "host_time.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define DEFAULT_BAUD_RATE		115200				///< Baud rate before uart_param_config is called
+#define BITS_PER_CHARACTER		10LL				///< Start, 8 data and stop bit
+#define LINK_WAIT_MS			100					///< Longest real wait for a reply from an attached device with the virtual clock
+#define LINK_QUIET_MS			2					///< Gap that ends a reply from an attached device
+#define READ_CHUNK				256U				///< Bytes read from an attached device at a time
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * State of one UART
+ */
+typedef struct
+{
+	bool installed;							///< uart_driver_install has been called
+	int baud_rate;							///< Configured baud rate
+	uint8_t *rx_buffer;						///< Receive ring buffer
+	size_t rx_size;							///< Size of rx_buffer
+	size_t rx_head;							///< Index of next byte to read
+	size_t rx_count;						///< Bytes waiting in rx_buffer
+	size_t tx_buffer_size;					///< Driver transmit buffer size, 0 for none
+	int64_t tx_done_us;						///< Time the last byte queued for transmission leaves the pin
+	int fd;									///< Attached file descriptor or -1
+	bool reply_pending;						///< Data has been written to fd and nothing read back since
+	host_uart_tx_handler_t tx_handler;		///< Function given transmitted data
+	host_uart_stats_t stats;				///< Usage figures
+} uart_state_t;
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static uart_state_t *get_uart(uart_port_t port);
+static int64_t get_character_us(const uart_state_t *uart);
+static size_t get_tx_queued(const uart_state_t *uart);
+static size_t put_rx(uart_state_t *uart, const uint8_t *data, size_t length);
+static bool read_fd(uart_state_t *uart);
+static void transmit(uart_port_t port, uart_state_t *uart, const uint8_t *data, size_t length);
+static bool read_polled(const struct pollfd *fds, uart_state_t * const *polled, nfds_t count);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static uart_state_t uarts[UART_NUM_MAX] = {{.fd = -1}, {.fd = -1}, {.fd = -1}};
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/**
+ * Get the state of a port
+ *
+ * @param port The UART
+ * @return Its state or NULL if port is out of range
+ */
+static uart_state_t *get_uart(uart_port_t port)
+{
+	if (port < UART_NUM_0 || port >= UART_NUM_MAX)
+	{
+		return NULL;
+	}
+
+	return &uarts[port];
+}
+
+/**
+ * Get the time taken to send one character
+ *
+ * @param uart The UART
+ * @return Character time in microseconds, at least 1
+ */
+static int64_t get_character_us(const uart_state_t *uart)
+{
+	int64_t us = BITS_PER_CHARACTER * 1000000LL / (int64_t)(uart->baud_rate > 0 ? uart->baud_rate : DEFAULT_BAUD_RATE);
+
+	return us > 0LL ? us : 1LL;
+}
+
+/**
+ * Get the number of bytes written but not yet sent
+ *
+ * @param uart The UART
+ * @return Bytes in the FIFO and transmit buffer
+ */
+static size_t get_tx_queued(const uart_state_t *uart)
+{
+	int64_t remaining = uart->tx_done_us - host_time_get_us();
+	int64_t character_us = get_character_us(uart);
+
+	if (remaining <= 0LL)
+	{
+		return 0U;
+	}
+
+	return (size_t)((remaining + character_us - 1LL) / character_us);
+}
+
+/**
+ * Add bytes to the receive buffer
+ *
+ * @param uart The UART
+ * @param data The bytes received
+ * @param length Number of bytes
+ * @return Number of bytes that fitted
+ */
+static size_t put_rx(uart_state_t *uart, const uint8_t *data, size_t length)
+{
+	size_t space = uart->rx_size - uart->rx_count;
+	size_t stored = length < space ? length : space;
+	size_t i;
+
+	for (i = 0U; i < stored; i++)
+	{
+		uart->rx_buffer[(uart->rx_head + uart->rx_count + i) % uart->rx_size] = data[i];
+	}
+	uart->rx_count += stored;
+	if (uart->rx_count > uart->stats.rx_high_water)
+	{
+		uart->stats.rx_high_water = uart->rx_count;
+	}
+	uart->stats.rx_dropped += (uint64_t)(length - stored);
+
+	return stored;
+}
+
+/**
+ * Move whatever is waiting on the attached file descriptor into the receive buffer. Data that does not fit is left
+ * in the descriptor as a real device would hold off with flow control.
+ *
+ * @param uart The UART
+ * @return true if any bytes were read
+ */
+static bool read_fd(uart_state_t *uart)
+{
+	uint8_t chunk[READ_CHUNK];
+	bool got_data = false;
+	size_t space;
+	ssize_t length;
+
+	if (uart->fd < 0 || !uart->installed)
+	{
+		return false;
+	}
+
+	while ((space = uart->rx_size - uart->rx_count) > 0U)
+	{
+		length = read(uart->fd, chunk, space < sizeof(chunk) ? space : sizeof(chunk));
+		if (length <= 0)
+		{
+			break;
+		}
+		(void)put_rx(uart, chunk, (size_t)length);
+		got_data = true;
+	}
+
+	if (got_data)
+	{
+		uart->reply_pending = false;
+	}
+
+	return got_data;
+}
+
+/**
+ * Send bytes that have been accepted into the FIFO or transmit buffer
+ *
+ * @param port The UART
+ * @param uart Its state
+ * @param data The bytes
+ * @param length Number of bytes
+ */
+static void transmit(uart_port_t port, uart_state_t *uart, const uint8_t *data, size_t length)
+{
+	int64_t now = host_time_get_us();
+	size_t written = 0U;
+	ssize_t result;
+
+	if (length == 0U)
+	{
+		return;
+	}
+
+	if (uart->tx_done_us < now)
+	{
+		uart->tx_done_us = now;
+	}
+	uart->tx_done_us += (int64_t)length * get_character_us(uart);
+	uart->stats.tx_bytes += (uint64_t)length;
+
+	if (uart->tx_handler != NULL)
+	{
+		uart->tx_handler(port, data, length);
+	}
+
+	if (uart->fd >= 0)
+	{
+		while (written < length)
+		{
+			result = write(uart->fd, data + written, length - written);
+			if (result < 0)
+			{
+				if (errno == EAGAIN || errno == EINTR)
+				{
+					(void)usleep(1000U);
+					continue;
+				}
+				break;
+			}
+			written += (size_t)result;
+		}
+		uart->reply_pending = true;
+	}
+}
+
+/**
+ * Read the descriptors that poll found readable
+ *
+ * @param fds Result of poll
+ * @param polled UART of each entry in fds
+ * @param count Number of entries
+ * @return true if any bytes were read
+ */
+static bool read_polled(const struct pollfd *fds, uart_state_t * const *polled, nfds_t count)
+{
+	bool got_data = false;
+	nfds_t i;
+
+	for (i = 0U; i < count; i++)
+	{
+		if ((fds[i].revents & POLLIN) != 0 && read_fd(polled[i]))
+		{
+			got_data = true;
+		}
+	}
+
+	return got_data;
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size, int queue_size, QueueHandle_t *uart_queue,
+		int intr_alloc_flags)
+{
+	uart_state_t *uart = get_uart(uart_num);
+
+	(void)queue_size;
+	(void)intr_alloc_flags;
+
+	if (uart == NULL || rx_buffer_size <= UART_FIFO_LEN || (tx_buffer_size != 0 && tx_buffer_size <= UART_FIFO_LEN))
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	if (uart->installed)
+	{
+		return ESP_FAIL;
+	}
+
+	uart->rx_buffer = malloc((size_t)rx_buffer_size);
+	if (uart->rx_buffer == NULL)
+	{
+		return ESP_ERR_NO_MEM;
+	}
+	uart->rx_size = (size_t)rx_buffer_size;
+	uart->rx_head = 0U;
+	uart->rx_count = 0U;
+	uart->tx_buffer_size = (size_t)tx_buffer_size;
+	uart->tx_done_us = 0LL;
+	uart->installed = true;
+	if (uart_queue != NULL)
+	{
+		*uart_queue = NULL;
+	}
+
+	return ESP_OK;
+}
+
+esp_err_t uart_driver_delete(uart_port_t uart_num)
+{
+	uart_state_t *uart = get_uart(uart_num);
+
+	if (uart == NULL || !uart->installed)
+	{
+		return ESP_FAIL;
+	}
+
+	free(uart->rx_buffer);
+	uart->rx_buffer = NULL;
+	uart->rx_size = 0U;
+	uart->rx_count = 0U;
+	uart->installed = false;
+
+	return ESP_OK;
+}
+
+bool uart_is_driver_installed(uart_port_t uart_num)
+{
+	uart_state_t *uart = get_uart(uart_num);
+
+	return uart != NULL && uart->installed;
+}
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config)
+{
+	uart_state_t *uart = get_uart(uart_num);
+
+	if (uart == NULL || uart_config == NULL || uart_config->baud_rate <= 0)
+	{
+		return ESP_ERR_INVALID_ARG;
+	}
+	uart->baud_rate = uart_config->baud_rate;
+
+	return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num)
+{
+	(void)tx_io_num;
+	(void)rx_io_num;
+	(void)rts_io_num;
+	(void)cts_io_num;
+
+	return get_uart(uart_num) == NULL ? ESP_ERR_INVALID_ARG : ESP_OK;
+}
+
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+	uart_state_t *uart = get_uart(uart_num);
+	uint8_t *out = (uint8_t *)buf;
+	TickType_t start = xTaskGetTickCount();
+	uint32_t got = 0UL;
+
+	if (uart == NULL || !uart->installed || buf == NULL)
+	{
+		return -1;
+	}
+
+	while (got < length)
+	{
+		(void)read_fd(uart);
+		while (got < length && uart->rx_count > 0U)
+		{
+			out[got++] = uart->rx_buffer[uart->rx_head];
+			uart->rx_head = (uart->rx_head + 1U) % uart->rx_size;
+			uart->rx_count--;
+		}
+		if (got == length || (TickType_t)(xTaskGetTickCount() - start) >= ticks_to_wait)
+		{
+			break;
+		}
+		vTaskDelay((TickType_t)1);
+	}
+
+	if (got == 0UL && length > 0UL && ticks_to_wait == (TickType_t)0)
+	{
+		host_time_advance_us(get_character_us(uart));
+	}
+	uart->stats.rx_bytes += (uint64_t)got;
+
+	return (int)got;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size)
+{
+	uart_state_t *uart = get_uart(uart_num);
+	const uint8_t *data = (const uint8_t *)src;
+	size_t capacity;
+	size_t queued;
+	size_t sent = 0U;
+	size_t chunk;
+
+	if (uart == NULL || !uart->installed || src == NULL)
+	{
+		return -1;
+	}
+
+	capacity = (size_t)UART_FIFO_LEN + uart->tx_buffer_size;
+	while (sent < size)
+	{
+		queued = get_tx_queued(uart);
+		if (queued >= capacity)
+		{
+			vTaskDelay((TickType_t)1);
+			continue;
+		}
+		chunk = capacity - queued;
+		if (chunk > size - sent)
+		{
+			chunk = size - sent;
+		}
+		transmit(uart_num, uart, data + sent, chunk);
+		sent += chunk;
+	}
+
+	return (int)size;
+}
+
+int uart_tx_chars(uart_port_t uart_num, const char *buffer, uint32_t len)
+{
+	uart_state_t *uart = get_uart(uart_num);
+	size_t queued;
+	size_t space;
+	size_t length = (size_t)len;
+
+	if (uart == NULL || !uart->installed || buffer == NULL)
+	{
+		return -1;
+	}
+
+	queued = get_tx_queued(uart);
+	space = queued < (size_t)UART_FIFO_LEN ? (size_t)UART_FIFO_LEN - queued : 0U;
+	if (length > space)
+	{
+		length = space;
+		uart->stats.tx_short_writes++;
+	}
+	transmit(uart_num, uart, (const uint8_t *)buffer, length);
+
+	return (int)length;
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size)
+{
+	uart_state_t *uart = get_uart(uart_num);
+
+	if (uart == NULL || !uart->installed || size == NULL)
+	{
+		return ESP_FAIL;
+	}
+
+	(void)read_fd(uart);
+	*size = uart->rx_count;
+	if (uart->rx_count == 0U)
+	{
+		host_time_advance_us(get_character_us(uart));
+	}
+
+	return ESP_OK;
+}
+
+esp_err_t uart_flush_input(uart_port_t uart_num)
+{
+	uart_state_t *uart = get_uart(uart_num);
+
+	if (uart == NULL || !uart->installed)
+	{
+		return ESP_FAIL;
+	}
+
+	uart->rx_head = 0U;
+	uart->rx_count = 0U;
+
+	return ESP_OK;
+}
+
+size_t host_uart_inject(uart_port_t port, const uint8_t *data, size_t length)
+{
+	uart_state_t *uart = get_uart(port);
+
+	if (uart == NULL || data == NULL)
+	{
+		return 0U;
+	}
+	if (!uart->installed)
+	{
+		uart->stats.rx_dropped += (uint64_t)length;
+		return 0U;
+	}
+
+	return put_rx(uart, data, length);
+}
+
+void host_uart_set_tx_handler(uart_port_t port, host_uart_tx_handler_t handler)
+{
+	uart_state_t *uart = get_uart(port);
+
+	if (uart != NULL)
+	{
+		uart->tx_handler = handler;
+	}
+}
+
+void host_uart_attach_fd(uart_port_t port, int fd)
+{
+	uart_state_t *uart = get_uart(port);
+	int flags;
+
+	if (uart == NULL)
+	{
+		return;
+	}
+
+	if (fd >= 0)
+	{
+		flags = fcntl(fd, F_GETFL, 0);
+		if (flags >= 0)
+		{
+			(void)fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+		}
+	}
+	uart->fd = fd;
+	uart->reply_pending = false;
+}
+
+void host_uart_idle_hook(int64_t wait_us)
+{
+	struct pollfd fds[UART_NUM_MAX];
+	uart_state_t *polled[UART_NUM_MAX];
+	nfds_t count = 0U;
+	int timeout_ms;
+	int i;
+
+	for (i = 0; i < (int)UART_NUM_MAX; i++)
+	{
+		if (uarts[i].fd >= 0 && uarts[i].installed)
+		{
+			fds[count].fd = uarts[i].fd;
+			fds[count].events = POLLIN;
+			polled[count] = &uarts[i];
+			count++;
+		}
+	}
+
+	if (count == 0U)
+	{
+		if (wait_us > 0LL)
+		{
+			(void)usleep((useconds_t)wait_us);
+		}
+		return;
+	}
+
+	if (host_time_is_virtual())
+	{
+		// give a device that has just been written to the chance to reply before the clock jumps, then keep
+		// reading until it goes quiet so the whole reply arrives at one virtual time
+		timeout_ms = 0;
+		for (i = 0; i < (int)count; i++)
+		{
+			if (polled[i]->reply_pending)
+			{
+				timeout_ms = LINK_WAIT_MS;
+			}
+		}
+		while (poll(fds, count, timeout_ms) > 0 && read_polled(fds, polled, count))
+		{
+			timeout_ms = LINK_QUIET_MS;
+		}
+	}
+	else
+	{
+		timeout_ms = (int)((wait_us + 999LL) / 1000LL);
+		if (poll(fds, count, timeout_ms) > 0 && !read_polled(fds, polled, count))
+		{
+			// hung up descriptors poll ready with nothing to read
+			(void)usleep((useconds_t)wait_us);
+		}
+	}
+}
+
+void host_uart_get_stats(uart_port_t port, host_uart_stats_t *stats)
+{
+	uart_state_t *uart = get_uart(port);
+
+	if (uart != NULL && stats != NULL)
+	{
+		*stats = uart->stats;
+	}
+}
@@ -0,0 +1,801 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+/*
+The boat around the firmware when it runs on a Linux host. A task moves a
+boat along a slowly varying course through a tidal stream in steady wind and
+sends what its instruments would: NMEA2000 messages from a simulated
+instrument node on the virtual CAN bus, and GPS and AIS sentences into the
+NMEA0183 UART. It also provides the BMP280 pressure sensor on the I2C bus
+and the PT1000 exhaust temperature divider on the ADC, and counts what the
+firmware sends to the simulated phone over Bluetooth.
+
+Besides the messages the firmware handles, the instruments send engine,
+battery and rudder messages that it has to receive and discard, as on a
+real bus.
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "NMEA2000_esp32.h"
+#include "N2kMessages.h"
+#include "esp_hal_host.h"
+#include "boat_sim.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define SIM_TASK_STACK_SIZE			8192U				///< Stack size for boat simulation task
+#define SIM_TASK_PRIORITY			5U					///< Above the firmware tasks as the instruments are separate hardware
+#define SIM_N2K_ADDRESS				30U					///< Preferred NMEA2000 source address of the instrument node
+#define START_DAYS_SINCE_1970		19144U				///< 1 June 2022
+#define KNOTS_TO_MS					(1852.0 / 3600.0)	///< Knots to metres per second
+#define METRES_PER_DEGREE_LAT		(1852.0 * 60.0)		///< Metres in one degree of latitude
+#define KELVIN_OFFSET				273.15				///< 0 degrees C in kelvin
+#define BMP280_ADDRESS				0x76U				///< I2C address of the pressure sensor
+#define BMP280_CHIP_ID				0x58U				///< Value of BMP280 id register
+#define BMP280_REG_ID				0xd0U				///< Id register
+#define BMP280_REG_CTRL_MEAS		0xf4U				///< Measurement control register
+#define BMP280_REG_PRESS_MSB		0xf7U				///< First measurement result register
+#define BMP280_REG_CALIBRATION		0x88U				///< First calibration register
+#define PT1000_DIVIDER_RESISTANCE	9310.0				///< Fixed resistor above the PT1000
+#define PT1000_SUPPLY_VOLTS			5.0					///< Voltage across the divider
+#define PT1000_ADC_OFFSET_VOLTS		0.08				///< Reading error the firmware corrects for
+#define SENTENCE_LENGTH_MAX			100U				///< Longest NMEA0183 sentence with terminator
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * A message the simulation sends at a fixed rate
+ */
+typedef struct
+{
+	uint32_t period_ms;				///< Nominal period before the traffic multiplier
+	void (*send)(void);				///< Function that sends it
+} scheduled_message_t;
+
+/**
+ * State of the simulated boat and surroundings
+ */
+typedef struct
+{
+	double time_s;					///< Seconds since the start of the run
+	double latitude;				///< Degrees north
+	double longitude;				///< Degrees east
+	double heading;					///< Degrees true
+	double speed_through_water;		///< Knots
+	double course_over_ground;		///< Degrees true
+	double speed_over_ground;		///< Knots
+	double depth;					///< Metres below transducer
+	double true_wind_speed;			///< Knots
+	double true_wind_direction;		///< Degrees true the wind blows from
+	double apparent_wind_speed;		///< Knots
+	double apparent_wind_angle;		///< Degrees from the bow, 0 to 360
+	double log;						///< Metres travelled through the water since launch
+	double trip;					///< Metres travelled through the water this run
+	double water_temperature;		///< Degrees C
+	double pressure;				///< Pascal
+	double air_temperature;			///< Degrees C
+	double exhaust_temperature;		///< Degrees C
+} boat_t;
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static double noise(double amplitude);
+static void update_boat(double dt);
+static void send_n2k(const tN2kMsg &N2kMsg);
+static void send_sentence(const char *body);
+static void send_heading(void);
+static void send_boat_speed(void);
+static void send_depth(void);
+static void send_wind(void);
+static void send_log(void);
+static void send_environment(void);
+static void send_position(void);
+static void send_cog_sog(void);
+static void send_engine(void);
+static void send_battery(void);
+static void send_rudder(void);
+static void send_gps(void);
+static void send_ais(void);
+static int32_t bmp280_compensate_t_fine(int32_t adc_T);
+static uint32_t bmp280_compensate_P(int32_t adc_P, int32_t t_fine);
+static void bmp280_measure(void);
+static bool bmp280_write(void *context, const uint8_t *data, size_t length);
+static bool bmp280_read(void *context, uint8_t *data, size_t length);
+static void update_exhaust_sensor(void);
+static void phone_rx_handler(const uint8_t *data, size_t length);
+static void boat_sim_task(void *parameters);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static boat_sim_config_t sim_config;					///< Settings
+static boat_sim_stats_t sim_stats;						///< Traffic figures
+static boat_t boat;										///< The boat
+static tNMEA2000_host *instruments;						///< The instrument node
+static uint32_t noise_state;							///< Noise generator state
+static unsigned char sid;								///< Sequence id shared by related instrument messages
+static uint8_t bmp280_registers[256];					///< BMP280 register map
+static uint8_t bmp280_pointer;							///< BMP280 register address for the next read
+static bool wind_true_next;								///< Next wind message is true rather than apparent
+static uint32_t ais_next;								///< Next AIS sentence to send
+static bool phone_line_start = true;					///< Next byte the phone receives starts a sentence
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**
+ * Messages sent by the simulation and their periods
+ */
+static const scheduled_message_t schedule[] =
+{
+	{100UL, send_heading},
+	{100UL, send_wind},
+	{100UL, send_position},
+	{100UL, send_engine},
+	{100UL, send_rudder},
+	{300UL, send_cog_sog},
+	{1000UL, send_boat_speed},
+	{1000UL, send_depth},
+	{1000UL, send_log},
+	{1000UL, send_battery},
+	{1000UL, send_gps},
+	{2000UL, send_environment},
+	{3000UL, send_ais}
+};
+
+/**
+ * AIS sentence bodies the simulated AIS receiver cycles through, checksums are added when sent
+ */
+static const char * const ais_sentences[] =
+{
+	"AIVDM,1,1,,A,13u?etPv2;0n:dDPwUM1U1Cb069D,0",
+	"AIVDM,1,1,,B,177KQJ5000G?tO`K>RA1wUbN0TKH,0",
+	"AIVDM,1,1,,B,15N4cJ`005Jrek0H@9n`DW5608EP,0",
+	"AIVDM,1,1,,A,15RTgt0PAso;90TKcjM8h6g208CQ,0"
+};
+
+/**
+ * BMP280 calibration values, the example values from the Bosch datasheet
+ */
+static const uint16_t bmp280_calibration[12] = {27504U, 26435U, (uint16_t)-1000, 36477U, (uint16_t)-10685, 3024U, 2855U, 140U,
+		(uint16_t)-7, 15500U, (uint16_t)-14600, 6000U};
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/**
+ * Get a random value for sensor noise
+ *
+ * @param amplitude Largest value either side of zero
+ * @return Value between -amplitude and amplitude
+ */
+static double noise(double amplitude)
+{
+	noise_state = noise_state * 1664525UL + 1013904223UL;
+
+	return amplitude * (2.0 * (double)(noise_state >> 8) / (double)(1UL << 24) - 1.0);
+}
+
+/**
+ * Move the boat and its surroundings on
+ *
+ * @param dt Seconds since the last update
+ */
+static void update_boat(double dt)
+{
+	const double two_pi = 2.0 * M_PI;
+	double t;
+	double east;
+	double north;
+	double boat_east;
+	double boat_north;
+	double wind_east;
+	double wind_north;
+	double relative;
+
+	boat.time_s += dt;
+	t = boat.time_s;
+
+	boat.heading = fmod(45.0 + 20.0 * sin(two_pi * t / 1800.0) + noise(0.5) + 360.0, 360.0);
+	boat.speed_through_water = 6.0 + sin(two_pi * t / 600.0) + noise(0.05);
+	boat.depth = 12.0 + 6.0 * sin(two_pi * t / 900.0) + noise(0.1);
+	boat.true_wind_speed = 12.0 + 3.0 * sin(two_pi * t / 300.0) + noise(0.5);
+	boat.true_wind_direction = fmod(220.0 + 10.0 * sin(two_pi * t / 3600.0) + 360.0, 360.0);
+	boat.water_temperature = 15.0 + sin(two_pi * t / 86400.0);
+	boat.air_temperature = 18.0 + 4.0 * sin(two_pi * t / 86400.0);
+	boat.pressure = 101325.0 + 800.0 * sin(two_pi * t / 86400.0) + noise(5.0);
+	boat.exhaust_temperature = 45.0 + 5.0 * sin(two_pi * t / 1200.0) + noise(0.2);
+
+	// ground track is the water track plus a tidal stream setting east at half a knot
+	boat_east = boat.speed_through_water * sin(boat.heading * M_PI / 180.0);
+	boat_north = boat.speed_through_water * cos(boat.heading * M_PI / 180.0);
+	east = boat_east + 0.5;
+	north = boat_north;
+	boat.speed_over_ground = sqrt(east * east + north * north);
+	boat.course_over_ground = fmod(atan2(east, north) * 180.0 / M_PI + 360.0, 360.0);
+
+	boat.latitude += north * KNOTS_TO_MS * dt / METRES_PER_DEGREE_LAT;
+	boat.longitude += east * KNOTS_TO_MS * dt / (METRES_PER_DEGREE_LAT * cos(boat.latitude * M_PI / 180.0));
+	boat.log += boat.speed_through_water * KNOTS_TO_MS * dt;
+	boat.trip += boat.speed_through_water * KNOTS_TO_MS * dt;
+
+	// apparent wind is the true wind less the boat's movement through the water
+	wind_east = -boat.true_wind_speed * sin(boat.true_wind_direction * M_PI / 180.0) - boat_east;
+	wind_north = -boat.true_wind_speed * cos(boat.true_wind_direction * M_PI / 180.0) - boat_north;
+	boat.apparent_wind_speed = sqrt(wind_east * wind_east + wind_north * wind_north);
+	relative = atan2(-wind_east, -wind_north) * 180.0 / M_PI - boat.heading;
+	boat.apparent_wind_angle = fmod(relative + 720.0, 360.0);
+}
+
+/**
+ * Send a message from the instrument node
+ *
+ * @param N2kMsg The message
+ */
+static void send_n2k(const tN2kMsg &N2kMsg)
+{
+	if (instruments->SendMsg(N2kMsg))
+	{
+		sim_stats.n2k_sent++;
+	}
+	else
+	{
+		sim_stats.n2k_send_fails++;
+	}
+	host_can_run_bus();
+}
+
+/**
+ * Add the start character, checksum and line end to a sentence body and send it to the NMEA0183 port
+ *
+ * @param body Sentence without start character and checksum, starting with ! for encapsulated sentences
+ */
+static void send_sentence(const char *body)
+{
+	char sentence[SENTENCE_LENGTH_MAX];
+	uint8_t checksum = 0U;
+	const char *p;
+	char start = '$';
+	int length;
+
+	if (*body == '!')
+	{
+		start = '!';
+		body++;
+	}
+	for (p = body; *p != '\0'; p++)
+	{
+		checksum ^= (uint8_t)*p;
+	}
+	length = snprintf(sentence, sizeof(sentence), "%c%s*%02X\r\n", start, body, checksum);
+	if (length > 0 && (size_t)length < sizeof(sentence))
+	{
+		(void)host_uart_inject(UART_NUM_2, (const uint8_t *)sentence, (size_t)length);
+		sim_stats.n0183_sent++;
+	}
+}
+
+/**
+ * Send true heading
+ */
+static void send_heading(void)
+{
+	tN2kMsg N2kMsg;
+
+	SetN2kTrueHeading(N2kMsg, sid, DegToRad(boat.heading));
+	send_n2k(N2kMsg);
+}
+
+/**
+ * Send speed through water
+ */
+static void send_boat_speed(void)
+{
+	tN2kMsg N2kMsg;
+
+	SetN2kBoatSpeed(N2kMsg, sid, boat.speed_through_water * KNOTS_TO_MS);
+	send_n2k(N2kMsg);
+}
+
+/**
+ * Send depth
+ */
+static void send_depth(void)
+{
+	tN2kMsg N2kMsg;
+
+	SetN2kWaterDepth(N2kMsg, sid, boat.depth, 0.5);
+	send_n2k(N2kMsg);
+}
+
+/**
+ * Send apparent and true wind alternately
+ */
+static void send_wind(void)
+{
+	tN2kMsg N2kMsg;
+	double true_wind_angle;
+
+	if (wind_true_next)
+	{
+		true_wind_angle = fmod(boat.true_wind_direction - boat.heading + 360.0, 360.0);
+		SetN2kWindSpeed(N2kMsg, sid, boat.true_wind_speed * KNOTS_TO_MS, DegToRad(true_wind_angle), N2kWind_True_boat);
+	}
+	else
+	{
+		SetN2kWindSpeed(N2kMsg, sid, boat.apparent_wind_speed * KNOTS_TO_MS, DegToRad(boat.apparent_wind_angle), N2kWind_Apparent);
+	}
+	wind_true_next = !wind_true_next;
+	send_n2k(N2kMsg);
+}
+
+/**
+ * Send distance log
+ */
+static void send_log(void)
+{
+	tN2kMsg N2kMsg;
+	uint16_t days = (uint16_t)(START_DAYS_SINCE_1970 + (uint32_t)(boat.time_s / 86400.0));
+
+	SetN2kDistanceLog(N2kMsg, days, fmod(boat.time_s, 86400.0), (uint32_t)boat.log, (uint32_t)boat.trip);
+	send_n2k(N2kMsg);
+}
+
+/**
+ * Send water temperature
+ */
+static void send_environment(void)
+{
+	tN2kMsg N2kMsg;
+
+	SetN2kOutsideEnvironmentalParameters(N2kMsg, sid, boat.water_temperature + KELVIN_OFFSET, boat.air_temperature + KELVIN_OFFSET);
+	send_n2k(N2kMsg);
+}
+
+/**
+ * Send position
+ */
+static void send_position(void)
+{
+	tN2kMsg N2kMsg;
+
+	SetN2kLatLonRapid(N2kMsg, boat.latitude, boat.longitude);
+	send_n2k(N2kMsg);
+	sid = (unsigned char)((sid + 1U) % 253U);
+}
+
+/**
+ * Send course and speed over ground
+ */
+static void send_cog_sog(void)
+{
+	tN2kMsg N2kMsg;
+
+	SetN2kCOGSOGRapid(N2kMsg, sid, N2khr_true, DegToRad(boat.course_over_ground), boat.speed_over_ground * KNOTS_TO_MS);
+	send_n2k(N2kMsg);
+}
+
+/**
+ * Send engine speed, which the firmware does not use
+ */
+static void send_engine(void)
+{
+	tN2kMsg N2kMsg;
+
+	SetN2kEngineParamRapid(N2kMsg, 0U, 1800.0 + noise(20.0));
+	send_n2k(N2kMsg);
+}
+
+/**
+ * Send battery status, which the firmware does not use
+ */
+static void send_battery(void)
+{
+	tN2kMsg N2kMsg;
+
+	SetN2kDCBatStatus(N2kMsg, 0U, 13.2 + noise(0.05), 4.0 + noise(0.5), N2kDoubleNA, sid);
+	send_n2k(N2kMsg);
+}
+
+/**
+ * Send rudder angle, which the firmware does not use
+ */
+static void send_rudder(void)
+{
+	tN2kMsg N2kMsg;
+
+	SetN2kRudder(N2kMsg, DegToRad(noise(5.0)));
+	send_n2k(N2kMsg);
+}
+
+/**
+ * Send GPS fix sentences to the NMEA0183 port
+ */
+static void send_gps(void)
+{
+	char body[SENTENCE_LENGTH_MAX];
+	double seconds = fmod(boat.time_s, 86400.0);
+	uint32_t day = 1UL + (uint32_t)(boat.time_s / 86400.0) % 30UL;
+	unsigned int hours = (unsigned int)(seconds / 3600.0);
+	unsigned int minutes = (unsigned int)(fmod(seconds, 3600.0) / 60.0);
+	double secs = fmod(seconds, 60.0);
+	double latitude = fabs(boat.latitude);
+	double longitude = fabs(boat.longitude);
+	double latitude_minutes = (latitude - floor(latitude)) * 60.0;
+	double longitude_minutes = (longitude - floor(longitude)) * 60.0;
+
+	(void)snprintf(body, sizeof(body), "GPRMC,%02u%02u%05.2f,A,%02d%07.4f,%c,%03d%07.4f,%c,%.1f,%.1f,%02u0622,,,A",
+			hours, minutes, secs, (int)latitude, latitude_minutes, boat.latitude >= 0.0 ? 'N' : 'S',
+			(int)longitude, longitude_minutes, boat.longitude >= 0.0 ? 'E' : 'W',
+			boat.speed_over_ground, boat.course_over_ground, (unsigned int)day);
+	send_sentence(body);
+
+	(void)snprintf(body, sizeof(body), "GPGGA,%02u%02u%05.2f,%02d%07.4f,%c,%03d%07.4f,%c,1,08,0.9,5.0,M,47.0,M,,",
+			hours, minutes, secs, (int)latitude, latitude_minutes, boat.latitude >= 0.0 ? 'N' : 'S',
+			(int)longitude, longitude_minutes, boat.longitude >= 0.0 ? 'E' : 'W');
+	send_sentence(body);
+}
+
+/**
+ * Send the next AIS sentence to the NMEA0183 port
+ */
+static void send_ais(void)
+{
+	char body[SENTENCE_LENGTH_MAX];
+
+	(void)snprintf(body, sizeof(body), "!%s", ais_sentences[ais_next]);
+	send_sentence(body);
+	ais_next = (ais_next + 1UL) % (uint32_t)(sizeof(ais_sentences) / sizeof(ais_sentences[0]));
+}
+
+/**
+ * BMP280 temperature compensation from the datasheet
+ *
+ * @param adc_T Raw temperature
+ * @return t_fine, temperature in degrees C is (t_fine * 5 + 128) / 25600
+ */
+static int32_t bmp280_compensate_t_fine(int32_t adc_T)
+{
+	int32_t T1 = (int32_t)bmp280_calibration[0];
+	int32_t T2 = (int32_t)(int16_t)bmp280_calibration[1];
+	int32_t T3 = (int32_t)(int16_t)bmp280_calibration[2];
+	int32_t var1 = ((((adc_T >> 3) - (T1 << 1))) * T2) >> 11;
+	int32_t var2 = (((((adc_T >> 4) - T1) * ((adc_T >> 4) - T1)) >> 12) * T3) >> 14;
+
+	return var1 + var2;
+}
+
+/**
+ * BMP280 64 bit pressure compensation from the datasheet, as used by the firmware
+ *
+ * @param adc_P Raw pressure
+ * @param t_fine Result of temperature compensation
+ * @return Pressure in Pascal * 256
+ */
+static uint32_t bmp280_compensate_P(int32_t adc_P, int32_t t_fine)
+{
+	int64_t P1 = (int64_t)bmp280_calibration[3];
+	int64_t P[10];
+	int64_t var1;
+	int64_t var2;
+	int64_t p;
+	int i;
+
+	for (i = 2; i <= 9; i++)
+	{
+		P[i] = (int64_t)(int16_t)bmp280_calibration[i + 2];
+	}
+
+	var1 = (int64_t)t_fine - 128000LL;
+	var2 = var1 * var1 * P[6];
+	var2 = var2 + ((var1 * P[5]) << 17);
+	var2 = var2 + (P[4] << 35);
+	var1 = ((var1 * var1 * P[3]) >> 8) + ((var1 * P[2]) << 12);
+	var1 = (((((int64_t)1) << 47) + var1)) * P1 >> 33;
+	if (var1 == 0LL)
+	{
+		return 0UL;
+	}
+	p = 1048576LL - (int64_t)adc_P;
+	p = (((p << 31) - var2) * 3125LL) / var1;
+	var1 = (P[9] * (p >> 13) * (p >> 13)) >> 25;
+	var2 = (P[8] * p) >> 19;
+	p = ((p + var1 + var2) >> 8) + (P[7] << 4);
+
+	return (uint32_t)p;
+}
+
+/**
+ * Make a BMP280 forced measurement of the current air temperature and pressure. The raw values are found by binary
+ * search through the datasheet compensation so the firmware's compensation gives back the simulated values.
+ */
+static void bmp280_measure(void)
+{
+	int32_t low = 0L;
+	int32_t high = (1L << 20) - 1L;
+	int32_t middle;
+	int32_t adc_T;
+	int32_t adc_P;
+	int32_t t_fine;
+	int32_t target_t = (int32_t)(boat.air_temperature * 100.0);
+	uint32_t target_p = (uint32_t)(boat.pressure * 256.0);
+
+	// temperature rises with the raw value
+	while (low < high)
+	{
+		middle = (low + high) / 2L;
+		if (((bmp280_compensate_t_fine(middle) * 5L + 128L) >> 8) < target_t)
+		{
+			low = middle + 1L;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	adc_T = low;
+	t_fine = bmp280_compensate_t_fine(adc_T);
+
+	// pressure falls as the raw value rises
+	low = 0L;
+	high = (1L << 20) - 1L;
+	while (low < high)
+	{
+		middle = (low + high) / 2L;
+		if (bmp280_compensate_P(middle, t_fine) > target_p)
+		{
+			low = middle + 1L;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	adc_P = low;
+
+	bmp280_registers[BMP280_REG_PRESS_MSB] = (uint8_t)(adc_P >> 12);
+	bmp280_registers[BMP280_REG_PRESS_MSB + 1U] = (uint8_t)(adc_P >> 4);
+	bmp280_registers[BMP280_REG_PRESS_MSB + 2U] = (uint8_t)((adc_P & 0x0f) << 4);
+	bmp280_registers[BMP280_REG_PRESS_MSB + 3U] = (uint8_t)(adc_T >> 12);
+	bmp280_registers[BMP280_REG_PRESS_MSB + 4U] = (uint8_t)(adc_T >> 4);
+	bmp280_registers[BMP280_REG_PRESS_MSB + 5U] = (uint8_t)((adc_T & 0x0f) << 4);
+}
+
+/**
+ * BMP280 I2C write, the first byte sets the register address and any more are written from there
+ *
+ * @param context Unused
+ * @param data Bytes written
+ * @param length Number of bytes
+ * @return true
+ */
+static bool bmp280_write(void *context, const uint8_t *data, size_t length)
+{
+	size_t i;
+
+	(void)context;
+
+	bmp280_pointer = data[0];
+	for (i = 1U; i < length; i++)
+	{
+		bmp280_registers[bmp280_pointer] = data[i];
+		if (bmp280_pointer == BMP280_REG_CTRL_MEAS && (data[i] & 0x03U) != 0U)
+		{
+			bmp280_measure();
+		}
+		bmp280_pointer++;
+	}
+
+	return true;
+}
+
+/**
+ * BMP280 I2C read from the current register address
+ *
+ * @param context Unused
+ * @param data Where to put the bytes
+ * @param length Number of bytes
+ * @return true
+ */
+static bool bmp280_read(void *context, uint8_t *data, size_t length)
+{
+	size_t i;
+
+	(void)context;
+
+	for (i = 0U; i < length; i++)
+	{
+		data[i] = bmp280_registers[bmp280_pointer++];
+	}
+
+	return true;
+}
+
+/**
+ * Set the ADC input to the voltage the PT1000 divider gives at the exhaust temperature
+ */
+static void update_exhaust_sensor(void)
+{
+	const double A = 3.90802e-3;
+	const double B = -5.80195e-7;
+	double t = boat.exhaust_temperature;
+	double r = 1000.0 * (1.0 + A * t + B * t * t);
+	double volts = PT1000_SUPPLY_VOLTS * r / (r + PT1000_DIVIDER_RESISTANCE) + PT1000_ADC_OFFSET_VOLTS;
+
+	host_adc_set_input_mv(ADC1_CHANNEL_4, (uint32_t)(volts * 1000.0));
+}
+
+/**
+ * Count what the simulated phone receives
+ *
+ * @param data Bytes received
+ * @param length Number of bytes
+ */
+static void phone_rx_handler(const uint8_t *data, size_t length)
+{
+	size_t i;
+
+	sim_stats.phone_bytes += (uint64_t)length;
+	for (i = 0U; i < length; i++)
+	{
+		if (phone_line_start && (data[i] == '$' || data[i] == '!'))
+		{
+			sim_stats.phone_sentences++;
+		}
+		phone_line_start = data[i] == '\n';
+	}
+}
+
+/**
+ * Task that moves the boat and sends each message when it is due
+ *
+ * @param parameters Unused
+ */
+static void boat_sim_task(void *parameters)
+{
+	const size_t count = sizeof(schedule) / sizeof(schedule[0]);
+	uint32_t periods[sizeof(schedule) / sizeof(schedule[0])];
+	uint32_t due[sizeof(schedule) / sizeof(schedule[0])];
+	TickType_t last = xTaskGetTickCount();
+	TickType_t now;
+	TickType_t next;
+	size_t i;
+
+	(void)parameters;
+
+	for (i = 0U; i < count; i++)
+	{
+		periods[i] = (uint32_t)((double)schedule[i].period_ms / sim_config.traffic_multiplier);
+		if (periods[i] == 0UL)
+		{
+			periods[i] = 1UL;
+		}
+		due[i] = (uint32_t)last + periods[i];
+	}
+
+	while (true)
+	{
+		now = xTaskGetTickCount();
+		update_boat((double)(now - last) / (double)configTICK_RATE_HZ);
+		update_exhaust_sensor();
+		last = now;
+
+		instruments->ParseMessages();
+		// replies and heartbeats the library queued have to be put on the bus
+		host_can_run_bus();
+		next = now + (TickType_t)1000;
+		for (i = 0U; i < count; i++)
+		{
+			if ((int32_t)(now - due[i]) >= 0L)
+			{
+				if (sim_config.traffic)
+				{
+					schedule[i].send();
+				}
+				due[i] += periods[i];
+			}
+			if ((int32_t)(due[i] - next) < 0L)
+			{
+				next = due[i];
+			}
+		}
+
+		if ((int32_t)(next - now) > 0L)
+		{
+			vTaskDelay(next - now);
+		}
+	}
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+void boat_sim_init(const boat_sim_config_t *config)
+{
+	host_i2c_device_t bmp280 = {BMP280_ADDRESS, bmp280_write, bmp280_read, NULL};
+	size_t i;
+
+	sim_config = *config;
+	if (sim_config.traffic_multiplier <= 0.0)
+	{
+		sim_config.traffic_multiplier = 1.0;
+	}
+	noise_state = sim_config.seed;
+
+	boat.latitude = 50.75;
+	boat.longitude = -1.30;
+	boat.log = 12345.0 * 1852.0;
+	update_boat(0.0);
+
+	bmp280_registers[BMP280_REG_ID] = BMP280_CHIP_ID;
+	for (i = 0U; i < sizeof(bmp280_calibration) / sizeof(bmp280_calibration[0]); i++)
+	{
+		bmp280_registers[BMP280_REG_CALIBRATION + 2U * i] = (uint8_t)bmp280_calibration[i];
+		bmp280_registers[BMP280_REG_CALIBRATION + 2U * i + 1U] = (uint8_t)(bmp280_calibration[i] >> 8);
+	}
+	(void)host_i2c_attach_device(I2C_NUM_0, &bmp280);
+	update_exhaust_sensor();
+
+	host_bt_set_phone_rx_handler(phone_rx_handler);
+
+	instruments = new tNMEA2000_host(&host_can_get_bus());
+	instruments->SetProductInformation("00000030", 30, "BoatSim instruments", "1.0", "1.0");
+	instruments->SetDeviceInformation(30, 135, 60, 2046);
+	instruments->SetMode(tNMEA2000::N2km_NodeOnly, SIM_N2K_ADDRESS);
+	instruments->EnableForward(false);
+	instruments->Open();
+}
+
+void boat_sim_start(void)
+{
+	(void)xTaskCreate(boat_sim_task, "boat sim", SIM_TASK_STACK_SIZE, NULL, SIM_TASK_PRIORITY, NULL);
+}
+
+void boat_sim_get_stats(boat_sim_stats_t *stats)
+{
+	*stats = sim_stats;
+}
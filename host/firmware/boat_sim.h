@@ -0,0 +1,102 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+#ifndef BOAT_SIM_H
+#define BOAT_SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**************
+*** DEFINES ***
+**************/
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Boat simulation settings
+ */
+typedef struct
+{
+	double traffic_multiplier;		///< NMEA2000 and NMEA0183 message rates are multiplied by this
+	uint32_t seed;					///< Seed for sensor noise, the same seed gives the same run
+	bool traffic;					///< Send NMEA2000 and NMEA0183 messages, false when a capture is replayed instead
+} boat_sim_config_t;
+
+/**
+ * Traffic generated and seen by the boat simulation
+ */
+typedef struct
+{
+	uint64_t n2k_sent;				///< NMEA2000 messages sent by the simulated instruments
+	uint64_t n2k_send_fails;		///< NMEA2000 messages the simulated instruments could not queue
+	uint64_t n0183_sent;			///< NMEA0183 sentences sent to the firmware NMEA0183 port
+	uint64_t phone_sentences;		///< NMEA0183 sentences received by the simulated phone
+	uint64_t phone_bytes;			///< Bytes received by the simulated phone
+} boat_sim_stats_t;
+
+/*************************
+*** EXTERNAL VARIABLES ***
+*************************/
+
+/***************************
+*** FUNCTIONS PROTOTYPES ***
+***************************/
+
+/**
+ * Attach the pressure and temperature sensor models and create the simulated NMEA2000 instruments. Call before
+ * the scheduler is started.
+ *
+ * @param config Simulation settings, copied
+ */
+void boat_sim_init(const boat_sim_config_t *config);
+
+/**
+ * Create the task that moves the boat and sends instrument traffic
+ */
+void boat_sim_start(void);
+
+/**
+ * Get the traffic figures
+ *
+ * @param stats Structure to fill
+ */
+void boat_sim_get_stats(boat_sim_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
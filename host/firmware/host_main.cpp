@@ -0,0 +1,850 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+/*
+host_main.cpp
+
+Runs the BlueBridge firmware on a Linux host. app_main() from main/main.cpp
+is started in a task on the host FreeRTOS scheduler with the ESP-IDF drivers
+replaced by the shims in host/esp and the boat around it simulated by
+boat_sim.cpp. The whole task graph runs unchanged: the main task, publisher,
+pressure sensor, NMEA2000, Bluetooth transmit, modem and timer tasks.
+
+With -v the scheduler runs on the virtual clock, jumping time forward
+whenever every task is blocked, so a day of boat time takes seconds. Every
+report period a JSON object is printed on stdout with the processor time
+used by each task, stack high water marks, queue depths, heap use and the
+traffic through each interface. Processor time is host time; -k scales it
+by how much slower the ESP32 is than the host to estimate device headroom.
+
+The modem and NMEA0183 UARTs can be connected to real devices or emulators
+by naming a serial device or pty in BLUEBRIDGE_UART1 or BLUEBRIDGE_UART2,
+for example the sim800_emulator pty for the modem. BLUEBRIDGE_NVS names a
+file used as non-volatile storage so settings survive between runs.
+
+-c records the CAN, NMEA0183 and Bluetooth input of the run to a capture
+file, see capture.h. -p replays a capture in place of the simulated
+instruments at the speed given by -x, 0 for as fast as the firmware takes it.
+
+The publisher only runs with a modem, so a task here builds the MQTT data
+payload at the publishing period, comma separated and binary, with and
+without delta publishing and the telemetry section of the report gives the
+average bytes of each.
+
+-g has the simulated phone turn on the raw NMEA2000 gateway once connected,
+with the fields of a $BBGWY command, for example -g YDR or -g PCD,+129025.
+With -g ACT, -a has the phone also send Actisense messages for the bus at the
+given rate per second, GNSS positions that are allowed and every tenth one a
+rudder message that the gateway refuses. -o has the phone turn the gateway
+off again with $BBGWY,OFF after the given seconds; the run fails if the
+gateway is still on at the end or has sent Actisense input to the bus since.
+
+Usage: bluebridge_host [-v] [-d seconds] [-r report_seconds] [-k cpu_scale]
+                       [-m traffic_multiplier] [-l log_level] [-S seed] [-n]
+                       [-c capture_file] [-p replay_file] [-x replay_speed]
+                       [-g gateway_fields] [-a actisense_rate] [-o off_seconds]
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos_host.h"
+#include "esp_log.h"
+#include "NMEA2000_esp32.h"
+#include "N2kMessages.h"
+#include "esp_hal_host.h"
+#include "host_time.h"
+#include "boat_sim.h"
+#include "capture.h"
+#include "main.h"
+#include "nmea.h"
+#include "ais.h"
+#include "cpa.h"
+#include "boat_data.h"
+#include "telemetry.h"
+#include "settings.h"
+#include "timer.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define MAIN_TASK_STACK_SIZE		3584U			///< ESP-IDF default main task stack size
+#define MAIN_TASK_PRIORITY			1U				///< ESP-IDF main task priority
+#define MONITOR_TASK_STACK_SIZE		8192U			///< Stack size for report task
+#define MONITOR_TASK_PRIORITY		(configMAX_PRIORITIES - 1U)	///< Highest so reports are on time
+#define PHONE_INPUT_TASK_STACK_SIZE	4096U			///< Stack size for Actisense input task
+#define PHONE_INPUT_TASK_PRIORITY	1U				///< Same as main task
+#define PHONE_COMMAND_TASK_STACK_SIZE	4096U		///< Stack size for gateway command task
+#define PHONE_COMMAND_TASK_PRIORITY	1U				///< Same as main task
+#define GATEWAY_OFF_SETTLE_MS		1000UL			///< Time after $BBGWY,OFF for input already sent to have been handled
+#define TELEMETRY_TASK_STACK_SIZE	8192U			///< Stack size for telemetry payload task
+#define TELEMETRY_TASK_PRIORITY		1U				///< Same as publisher task
+#define TELEMETRY_STRENGTH			20U				///< Signal strength put in telemetry payloads, there is no modem
+#define TASKS_MAX					20U				///< Most tasks reported
+#define QUEUES_MAX					32U				///< Most queues reported
+#define DEFAULT_DURATION_S			86400UL			///< One day
+#define DEFAULT_REPORT_S			3600UL			///< One hour
+#define PHONE_BYTES_PER_SECOND		20000UL			///< Typical SPP throughput to a phone
+#define CAPTURE_BUFFER_SIZE			(32U * 1024U)	///< RAM buffer between capture and file
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Run settings from the command line
+ */
+typedef struct
+{
+	uint32_t duration_s;			///< Simulated run time
+	uint32_t report_s;				///< Time between reports
+	double cpu_scale;				///< ESP32 processor time per host processor time
+	bool phone;						///< Simulated phone connects over Bluetooth
+	const char *capture_path;		///< File to capture input to or NULL
+	const char *replay_path;		///< Capture file to replay or NULL
+	uint32_t replay_speed;			///< Replay speed multiplier, 0 for maximum
+	const char *gateway_fields;		///< Fields of $BBGWY command the phone sends or NULL
+	uint32_t actisense_rate;		///< Actisense messages per second the phone sends, 0 for none
+	uint32_t gateway_off_s;			///< Time the phone sends $BBGWY,OFF, 0 for never
+} run_config_t;
+
+/**
+ * Processor time of a task at the previous report
+ */
+typedef struct
+{
+	TaskHandle_t handle;			///< The task
+	uint64_t run_time;				///< Run time counter
+} task_time_t;
+
+/**
+ * Writes what is printed to it to the Bluetooth link as phone input
+ */
+class tPhoneStream : public N2kStream
+{
+public:
+	int read() { return -1; }
+	size_t write(const uint8_t *data, size_t size) { return host_bt_phone_send(data, size) ? size : 0U; }
+};
+
+/**
+ * MQTT data payloads built at the publishing period as the publisher would send them
+ */
+typedef struct
+{
+	uint32_t publishes;				///< Payloads built
+	uint64_t csv_bytes;				///< Bytes of the payloads without delta publishing
+	uint64_t delta_bytes;			///< Bytes of the payloads with delta publishing
+	uint64_t binary_bytes;			///< Bytes of the binary payloads without delta publishing
+	uint64_t binary_delta_bytes;	///< Bytes of the binary payloads with delta publishing
+	uint32_t keyframes;				///< Delta publishing payloads that were keyframes
+} telemetry_stats_t;
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static void main_task(void *parameters);
+static void phone_input_task(void *parameters);
+static void phone_command_task(void *parameters);
+static void monitor_task(void *parameters);
+static void telemetry_task(void *parameters);
+static void report(uint32_t sequence, bool final);
+static void send_gateway_command(const char *fields);
+static bool check_gateway_off(void);
+static uint64_t previous_run_time(TaskHandle_t handle);
+static void attach_uart(uart_port_t port, const char *variable);
+static size_t capture_file_sink(const uint8_t *data, size_t length);
+static size_t replay_file_source(uint8_t *data, size_t length);
+static esp_log_level_t parse_log_level(const char *name);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static run_config_t run_config = {DEFAULT_DURATION_S, DEFAULT_REPORT_S, 1.0, true, NULL, NULL, 1UL, NULL, 0UL, 0UL};
+static task_time_t task_times[TASKS_MAX];						///< Task processor times at the previous report
+static UBaseType_t task_times_count;							///< Entries used in task_times
+static int64_t previous_report_us;								///< Clock at the previous report
+static int64_t start_us;										///< Clock when the scheduler started
+static uint64_t start_cpu_ns;									///< Host processor time when the scheduler started
+static FILE *capture_file;										///< Capture output
+static FILE *replay_file;										///< Replay input
+static telemetry_stats_t telemetry_stats;						///< MQTT data payload sizes
+static bool gateway_off_sent;									///< If the phone has sent $BBGWY,OFF
+static n2k_gateway_stats_t gateway_off_stats;					///< Gateway counters once $BBGWY,OFF has been handled
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+extern tNMEA2000 &NMEA2000;
+
+/***************************
+*** FUNCTIONS PROTOTYPES ***
+***************************/
+
+extern "C" void app_main(void);
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/**
+ * The ESP-IDF main task that calls app_main
+ *
+ * @param parameters Unused
+ */
+static void main_task(void *parameters)
+{
+	(void)parameters;
+
+	app_main();
+	vTaskDelete(NULL);
+}
+
+/**
+ * Send Actisense messages from the simulated phone for the gateway to put on the bus
+ *
+ * @param parameters Unused
+ */
+static void phone_input_task(void *parameters)
+{
+	TickType_t period = pdMS_TO_TICKS(1000UL) / run_config.actisense_rate;
+	TickType_t last_wake;
+	tPhoneStream stream;
+	tN2kMsg N2kMsg;
+	uint32_t count = 0UL;
+
+	(void)parameters;
+
+	if (period == (TickType_t)0)
+	{
+		period = (TickType_t)1;
+	}
+	// let the monitor task turn the gateway on first
+	vTaskDelay(pdMS_TO_TICKS(5000UL));
+	last_wake = xTaskGetTickCount();
+	while (true)
+	{
+		if (count % 10UL == 9UL)
+		{
+			SetN2kRudder(N2kMsg, 0.05);
+		}
+		else
+		{
+			SetN2kGNSS(N2kMsg, 1, 19000U, 43200.0 + count, 60.1, 24.9, 12.0, N2kGNSSt_GPS, N2kGNSSm_GNSSfix, 9, 0.8, 1.2, 47.0, 0,
+					N2kGNSSt_GPS, 0, 0.0);
+		}
+		N2kMsg.Source = 70U;
+		N2kMsg.SendInActisenseFormat(&stream);
+		count++;
+		vTaskDelayUntil(&last_wake, period);
+	}
+}
+
+/**
+ * Send the $BBGWY command of the run from the simulated phone and, if asked, turn the gateway off again later and
+ * keep the counters at that time for check_gateway_off
+ *
+ * @param parameters Unused
+ */
+static void phone_command_task(void *parameters)
+{
+	(void)parameters;
+
+	send_gateway_command(run_config.gateway_fields);
+	if (run_config.gateway_off_s == 0UL)
+	{
+		vTaskDelete(NULL);
+	}
+
+	vTaskDelay(pdMS_TO_TICKS(run_config.gateway_off_s * 1000UL));
+	send_gateway_command("OFF");
+	vTaskDelay(pdMS_TO_TICKS(GATEWAY_OFF_SETTLE_MS));
+	get_n2k_gateway_stats(&gateway_off_stats);
+	gateway_off_sent = true;
+	vTaskDelete(NULL);
+}
+
+/**
+ * Build the MQTT data payload every publishing period from the boat data, comma separated and binary, both as it
+ * was before delta publishing and with it, and count the bytes of each. The publisher only runs with a modem so this stands in for it.
+ *
+ * @param parameters Unused
+ */
+static void telemetry_task(void *parameters)
+{
+	static telemetry_state_t csv_state;
+	static telemetry_state_t delta_state;
+	static telemetry_state_t binary_state;
+	static telemetry_state_t binary_delta_state;
+	boat_data_snapshot_t snapshot;
+	telemetry_sample_t sample;
+	char payload[220];
+	size_t length;
+	size_t i;
+	uint32_t commas;
+	uint32_t time_ms;
+
+	(void)parameters;
+
+	telemetry_init(&csv_state, 1U);
+	telemetry_init(&delta_state, TELEMETRY_DEFAULT_KEYFRAME_INTERVAL);
+	telemetry_init(&binary_state, 1U);
+	telemetry_init(&binary_delta_state, TELEMETRY_DEFAULT_KEYFRAME_INTERVAL);
+	while (true)
+	{
+		vTaskDelay(pdMS_TO_TICKS(settings_get_publishing_period_s() * 1000UL));
+		time_ms = timer_get_time_ms();
+		boat_data_get_all(&snapshot);
+		telemetry_make_sample(&snapshot, time_ms, TELEMETRY_STRENGTH, settings_get_publishing_period_s(), &sample);
+
+		// the payload before delta publishing is a keyframe without the sequence number and frame type
+		length = telemetry_build_csv(&csv_state, &sample, payload, sizeof(payload));
+		telemetry_publish_result(&csv_state, true);
+		for (i = 0U, commas = 0UL; i < length && commas < (uint32_t)telemetry_field_max; i++)
+		{
+			if (payload[i] == ',')
+			{
+				commas++;
+			}
+		}
+		telemetry_stats.csv_bytes += i;
+
+		length = telemetry_build_csv(&delta_state, &sample, payload, sizeof(payload));
+		telemetry_publish_result(&delta_state, true);
+		telemetry_stats.delta_bytes += length;
+		if (payload[length - 1U] == 'K')
+		{
+			telemetry_stats.keyframes++;
+		}
+		telemetry_stats.binary_bytes += telemetry_build_binary(&binary_state, &sample, (uint8_t *)payload, sizeof(payload));
+		telemetry_publish_result(&binary_state, true);
+		telemetry_stats.binary_delta_bytes += telemetry_build_binary(&binary_delta_state, &sample, (uint8_t *)payload, sizeof(payload));
+		telemetry_publish_result(&binary_delta_state, true);
+		telemetry_stats.publishes++;
+	}
+}
+
+/**
+ * Print a report every report period and stop the run at the end of the duration
+ *
+ * @param parameters Unused
+ */
+static void monitor_task(void *parameters)
+{
+	TickType_t last_wake = xTaskGetTickCount();
+	uint32_t elapsed_s = 0UL;
+	uint32_t sequence = 0UL;
+	uint32_t step_s;
+
+	(void)parameters;
+
+	while (elapsed_s < run_config.duration_s)
+	{
+		step_s = run_config.duration_s - elapsed_s;
+		if (step_s > run_config.report_s)
+		{
+			step_s = run_config.report_s;
+		}
+		vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(step_s * 1000UL));
+		elapsed_s += step_s;
+		if (elapsed_s >= run_config.duration_s && capture_file != NULL)
+		{
+			capture_stop();
+		}
+		report(sequence++, elapsed_s >= run_config.duration_s);
+	}
+
+	vTaskEndScheduler();
+}
+
+/**
+ * Send a $BBGWY command from the simulated phone, waiting for it to connect
+ *
+ * @param fields The fields of the command after $BBGWY,
+ */
+static void send_gateway_command(const char *fields)
+{
+	char command[80];
+	uint8_t checksum = 0U;
+	size_t i;
+
+	for (i = 0U; fields[i] != '\0'; i++)
+	{
+		checksum ^= (uint8_t)fields[i];
+	}
+	checksum ^= (uint8_t)('B' ^ 'B' ^ 'G' ^ 'W' ^ 'Y' ^ ',');
+	(void)snprintf(command, sizeof(command), "$BBGWY,%s*%02X\r\n", fields, (unsigned int)checksum);
+
+	while (!host_bt_phone_send((const uint8_t *)command, strlen(command)))
+	{
+		vTaskDelay(pdMS_TO_TICKS(100UL));
+	}
+}
+
+/**
+ * Check that $BBGWY,OFF from the phone turned the gateway off, also from Actisense format where Bluetooth input is
+ * binary, and that no Actisense input reached the bus after it
+ *
+ * @return true if the gateway is off as it should be
+ */
+static bool check_gateway_off(void)
+{
+	n2k_gateway_stats_t gateway;
+
+	get_n2k_gateway_stats(&gateway);
+	if (!gateway_off_sent || strcmp(gateway.format, "OFF") != 0 || strcmp(gateway_off_stats.format, "OFF") != 0)
+	{
+		fprintf(stderr, "gateway not turned off by $BBGWY,OFF, format %s\n", gateway.format);
+		return false;
+	}
+	if (gateway.input_sent != gateway_off_stats.input_sent || gateway.input_refused != gateway_off_stats.input_refused)
+	{
+		fprintf(stderr, "gateway input handled after $BBGWY,OFF, %u sent and %u refused\n",
+				(unsigned int)(gateway.input_sent - gateway_off_stats.input_sent),
+				(unsigned int)(gateway.input_refused - gateway_off_stats.input_refused));
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Find the processor time of a task at the previous report
+ *
+ * @param handle The task
+ * @return Run time counter at the previous report, 0 if it did not exist then
+ */
+static uint64_t previous_run_time(TaskHandle_t handle)
+{
+	UBaseType_t i;
+
+	for (i = 0U; i < task_times_count; i++)
+	{
+		if (task_times[i].handle == handle)
+		{
+			return task_times[i].run_time;
+		}
+	}
+
+	return 0ULL;
+}
+
+/**
+ * Print a JSON report of the run since the previous report
+ *
+ * @param sequence Report number
+ * @param final true for the last report of the run
+ */
+static void report(uint32_t sequence, bool final)
+{
+	static TaskStatus_t tasks[TASKS_MAX];
+	static host_queue_stats_t queues[QUEUES_MAX];
+	UBaseType_t task_count;
+	UBaseType_t queue_count;
+	UBaseType_t i;
+	configRUN_TIME_COUNTER_TYPE total_run_time;
+	uint64_t busy_us = 0ULL;
+	uint64_t run_time;
+	int64_t now_us = host_time_get_us();
+	double period_us = (double)(now_us - previous_report_us);
+	host_heap_stats_t heap;
+	host_uart_stats_t uart;
+	host_bt_stats_t bt;
+	boat_sim_stats_t sim;
+	capture_stats_t capture;
+	n2k_health_t health;
+	n2k_gateway_stats_t gateway;
+	nmea_transmit_stats_t nmea_transmit;
+	nmea_output_stats_t nmea_output;
+	ais_stats_t ais;
+	cpa_stats_t cpa;
+	struct mallinfo2 host_heap = mallinfo2();
+	tNMEA2000_esp32 *n2k = static_cast<tNMEA2000_esp32 *>(&NMEA2000);
+	const tNMEA2000_host::tStatistics &n2k_stats = n2k->GetStatistics();
+	int port;
+	double publishes;
+
+	task_count = uxTaskGetSystemState(tasks, TASKS_MAX, &total_run_time);
+	printf("{\"report\":%u,\"final\":%s,\"simulated_s\":%.3f,\"host_cpu_s\":%.3f,\"switches\":%llu,\"restarts\":%u,\"tasks\":[",
+			(unsigned int)sequence, final ? "true" : "false", (double)(now_us - start_us) / 1e6,
+			(double)(host_time_get_cpu_ns() - start_cpu_ns) / 1e9,
+			(unsigned long long)host_freertos_get_switch_count(), (unsigned int)host_esp_get_restart_count());
+	for (i = 0U; i < task_count; i++)
+	{
+		run_time = tasks[i].ulRunTimeCounter - previous_run_time(tasks[i].xHandle);
+		busy_us += run_time;
+		printf("%s{\"name\":\"%s\",\"priority\":%u,\"cpu_us\":%llu,\"load_pct\":%.4f,\"host_stack_free\":%u}",
+				i == 0U ? "" : ",", tasks[i].pcTaskName, (unsigned int)tasks[i].uxCurrentPriority,
+				(unsigned long long)run_time, 100.0 * (double)run_time * run_config.cpu_scale / period_us,
+				(unsigned int)tasks[i].usStackHighWaterMark);
+	}
+	printf("],\"load_pct\":%.4f,\"headroom_pct\":%.4f,\"queues\":[",
+			100.0 * (double)busy_us * run_config.cpu_scale / period_us,
+			100.0 - 100.0 * (double)busy_us * run_config.cpu_scale / period_us);
+
+	// remember run times for the next report's figures
+	for (i = 0U; i < task_count; i++)
+	{
+		task_times[i].handle = tasks[i].xHandle;
+		task_times[i].run_time = tasks[i].ulRunTimeCounter;
+	}
+	task_times_count = task_count;
+	previous_report_us = now_us;
+
+	queue_count = host_freertos_get_queue_stats(queues, QUEUES_MAX);
+	for (i = 0U; i < queue_count; i++)
+	{
+		printf("%s{\"name\":\"%s\",\"owner\":\"%s\",\"type\":%u,\"length\":%u,\"waiting\":%u,\"high_water\":%u,\"send_fails\":%u}",
+				i == 0U ? "" : ",", queues[i].name == NULL ? "" : queues[i].name, queues[i].owner, (unsigned int)queues[i].type,
+				(unsigned int)queues[i].length, (unsigned int)queues[i].waiting, (unsigned int)queues[i].high_water,
+				(unsigned int)queues[i].send_fails);
+	}
+
+	host_freertos_get_heap_stats(&heap);
+	printf("],\"heap\":{\"current\":%zu,\"peak\":%zu,\"allocations\":%u,\"frees\":%u,\"failures\":%u,\"host_in_use\":%zu},",
+			heap.current, heap.peak, (unsigned int)heap.allocations, (unsigned int)heap.frees, (unsigned int)heap.failures,
+			host_heap.uordblks);
+
+	printf("\"n2k\":{\"bus_frames\":%llu,\"bus_load_pct\":%.2f,\"rx_frames\":%u,\"rx_read\":%u,\"rx_overruns\":%u,"
+			"\"rx_high_water\":%u,\"rx_accepted\":%u,\"rx_rejected\":%u,\"tx_frames\":%u,\"tx_queue_full\":%u,\"rx_latency_us\":[",
+			(unsigned long long)host_can_get_bus().GetFrameCount(),
+			100.0 * (double)host_can_get_bus().GetBitCount() / ((double)host_can_get_bus().GetBitRate() * (double)(now_us - start_us) / 1e6),
+			(unsigned int)n2k_stats.RxFrames, (unsigned int)n2k_stats.RxRead, (unsigned int)n2k_stats.RxOverruns,
+			(unsigned int)n2k_stats.RxHighWater, (unsigned int)n2k->GetRxAcceptedFrames(), (unsigned int)n2k->GetRxRejectedFrames(),
+			(unsigned int)n2k_stats.TxFrames, (unsigned int)n2k_stats.TxQueueFull);
+	for (i = 0U; i < (UBaseType_t)tNMEA2000_esp32::RxLatencyBuckets; i++)
+	{
+		printf("%s%u", i == 0U ? "" : ",", (unsigned int)n2k->GetRxLatencyHistogram()[i]);
+	}
+	get_n2k_health(&health);
+	printf("],\"health\":{\"load_1s_pct\":%.1f,\"load_60s_pct\":%.1f,\"frames_per_s\":%u,\"sources\":%u,\"busiest_source\":%u,"
+			"\"send_blocked\":%u}},",
+			health.bus_load, health.long_bus_load, (unsigned int)health.frames_per_second, (unsigned int)health.sources,
+			(unsigned int)health.busiest_source, (unsigned int)health.send_blocked);
+	get_n2k_gateway_stats(&gateway);
+	printf("\"gateway\":{\"format\":\"%s\",\"messages\":%u,\"filtered\":%u,\"writes\":%u,\"bytes\":%u,\"dropped_messages\":%u,"
+			"\"dropped_bytes\":%u,\"input_sent\":%u,\"input_refused\":%u,\"input_bad\":%u},\"uarts\":[",
+			gateway.format, (unsigned int)gateway.messages, (unsigned int)gateway.filtered, (unsigned int)gateway.writes,
+			(unsigned int)gateway.bytes, (unsigned int)gateway.dropped_messages, (unsigned int)gateway.dropped_bytes,
+			(unsigned int)gateway.input_sent, (unsigned int)gateway.input_refused, (unsigned int)gateway.input_bad);
+	for (port = 0; port < UART_NUM_MAX; port++)
+	{
+		host_uart_get_stats((uart_port_t)port, &uart);
+		printf("%s{\"port\":%d,\"tx_bytes\":%llu,\"rx_bytes\":%llu,\"rx_dropped\":%llu,\"rx_high_water\":%zu,\"tx_short_writes\":%u}",
+				port == 0 ? "" : ",", port, (unsigned long long)uart.tx_bytes, (unsigned long long)uart.rx_bytes,
+				(unsigned long long)uart.rx_dropped, uart.rx_high_water, (unsigned int)uart.tx_short_writes);
+	}
+
+	host_bt_get_stats(&bt);
+	boat_sim_get_stats(&sim);
+	capture_get_stats(&capture);
+	printf("],\"bluetooth\":{\"connected\":%s,\"writes\":%u,\"write_fails\":%u,\"tx_bytes\":%llu,\"rx_bytes\":%llu},"
+			"\"sim\":{\"n2k_sent\":%llu,\"n2k_send_fails\":%llu,\"n0183_sent\":%llu,\"phone_sentences\":%llu,\"phone_bytes\":%llu}",
+			bt.connected ? "true" : "false", (unsigned int)bt.writes, (unsigned int)bt.write_fails,
+			(unsigned long long)bt.tx_bytes, (unsigned long long)bt.rx_bytes,
+			(unsigned long long)sim.n2k_sent, (unsigned long long)sim.n2k_send_fails, (unsigned long long)sim.n0183_sent,
+			(unsigned long long)sim.phone_sentences, (unsigned long long)sim.phone_bytes);
+	printf(",\"nmea0183_tx\":[");
+	for (port = 0; port < (int)NMEA_NUMBER_OF_PORTS; port++)
+	{
+		nmea_get_transmit_stats((uint8_t)port, &nmea_transmit);
+		printf("%s{\"port\":%d,\"periodic_sent\":%u,\"resynchronised\":%u,\"period_error_ms\":[", port == 0 ? "" : ",", port,
+				(unsigned int)nmea_transmit.sent, (unsigned int)nmea_transmit.resynchronised);
+		for (i = 0U; i < (UBaseType_t)NMEA_PERIOD_ERROR_BUCKETS; i++)
+		{
+			printf("%s%u", i == 0U ? "" : ",", (unsigned int)nmea_transmit.period_error[i]);
+		}
+		nmea_get_output_stats((uint8_t)port, &nmea_output);
+		printf("],\"output_sent\":[");
+		for (i = 0U; i < (UBaseType_t)nmea_priority_max; i++)
+		{
+			printf("%s%u", i == 0U ? "" : ",", (unsigned int)nmea_output.classes[i].sent);
+		}
+		printf("],\"output_dropped\":[");
+		for (i = 0U; i < (UBaseType_t)nmea_priority_max; i++)
+		{
+			printf("%s%u", i == 0U ? "" : ",", (unsigned int)nmea_output.classes[i].dropped);
+		}
+		printf("]}");
+	}
+	printf("]");
+	ais_get_stats(&ais);
+	printf(",\"ais\":{\"fragments\":%u,\"messages\":%u,\"forwarded\":%u,\"suppressed\":%u,\"passed_on\":%u,"
+			"\"reassembly_failed\":%u,\"targets\":%u}", (unsigned int)ais.fragments, (unsigned int)ais.messages,
+			(unsigned int)ais.forwarded, (unsigned int)ais.suppressed, (unsigned int)ais.passed_on,
+			(unsigned int)ais.reassembly_failed, (unsigned int)ais_get_target_count());
+	cpa_get_stats(&cpa);
+	printf(",\"cpa\":{\"targets\":%u,\"own_ship_tracks\":%u,\"recomputes\":%u,\"events\":%u,\"alarms_raised\":%u,"
+			"\"alarms_cleared\":%u,\"active_alarms\":%u}", (unsigned int)cpa.targets, (unsigned int)cpa.own_ship_tracks,
+			(unsigned int)cpa.recomputes, (unsigned int)cpa.events, (unsigned int)cpa.alarms_raised,
+			(unsigned int)cpa.alarms_cleared, (unsigned int)cpa.active_alarms);
+	publishes = telemetry_stats.publishes == 0UL ? 1.0 : (double)telemetry_stats.publishes;
+	printf(",\"telemetry\":{\"publishes\":%u,\"keyframes\":%u,\"csv_bytes_per_publish\":%.1f,\"delta_bytes_per_publish\":%.1f,"
+			"\"binary_bytes_per_publish\":%.1f,\"binary_delta_bytes_per_publish\":%.1f}",
+			(unsigned int)telemetry_stats.publishes, (unsigned int)telemetry_stats.keyframes,
+			(double)telemetry_stats.csv_bytes / publishes, (double)telemetry_stats.delta_bytes / publishes,
+			(double)telemetry_stats.binary_bytes / publishes, (double)telemetry_stats.binary_delta_bytes / publishes);
+	printf(",\"capture\":{\"capturing\":%s,\"captured\":[%u,%u,%u],\"bytes\":%llu,\"overflows\":%u,"
+			"\"replaying\":%s,\"replayed\":[%u,%u,%u],\"dropped\":[%u,%u,%u],\"stalls\":%u,\"errors\":%u,\"replay_time_s\":%.3f}}\n",
+			capture.capturing ? "true" : "false", (unsigned int)capture.captured[CAPTURE_STREAM_CAN],
+			(unsigned int)capture.captured[CAPTURE_STREAM_N0183], (unsigned int)capture.captured[CAPTURE_STREAM_SPP],
+			(unsigned long long)capture.capture_bytes, (unsigned int)capture.capture_overflows,
+			capture.replaying ? "true" : "false", (unsigned int)capture.replayed[CAPTURE_STREAM_CAN],
+			(unsigned int)capture.replayed[CAPTURE_STREAM_N0183], (unsigned int)capture.replayed[CAPTURE_STREAM_SPP],
+			(unsigned int)capture.replay_dropped[CAPTURE_STREAM_CAN], (unsigned int)capture.replay_dropped[CAPTURE_STREAM_N0183],
+			(unsigned int)capture.replay_dropped[CAPTURE_STREAM_SPP], (unsigned int)capture.replay_stalls,
+			(unsigned int)capture.replay_errors, (double)capture.replay_time_us / 1e6);
+	fflush(stdout);
+}
+
+/**
+ * Connect a UART to a real device if named in an environment variable
+ *
+ * @param port The UART
+ * @param variable Name of the environment variable holding the device path
+ */
+static void attach_uart(uart_port_t port, const char *variable)
+{
+	const char *path = getenv(variable);
+	int fd;
+
+	if (path == NULL || *path == '\0')
+	{
+		return;
+	}
+
+	fd = open(path, O_RDWR | O_NOCTTY);
+	if (fd < 0)
+	{
+		fprintf(stderr, "cannot open %s=%s\n", variable, path);
+		exit(EXIT_FAILURE);
+	}
+	host_uart_attach_fd(port, fd);
+}
+
+/**
+ * Write capture data to the capture file
+ *
+ * @param data The capture data
+ * @param length Number of bytes
+ * @return Number of bytes written
+ */
+static size_t capture_file_sink(const uint8_t *data, size_t length)
+{
+	return fwrite(data, (size_t)1, length, capture_file);
+}
+
+/**
+ * Read capture data from the replay file
+ *
+ * @param data Where to put the data
+ * @param length Most bytes wanted
+ * @return Number of bytes read, 0 at the end of the file
+ */
+static size_t replay_file_source(uint8_t *data, size_t length)
+{
+	return fread(data, (size_t)1, length, replay_file);
+}
+
+/**
+ * Convert a log level name to an ESP-IDF log level
+ *
+ * @param name One of none, error, warn, info, debug, verbose
+ * @return The level, ESP_LOG_ERROR if not recognised
+ */
+static esp_log_level_t parse_log_level(const char *name)
+{
+	static const char * const names[] = {"none", "error", "warn", "info", "debug", "verbose"};
+	size_t i;
+
+	for (i = 0U; i < sizeof(names) / sizeof(names[0]); i++)
+	{
+		if (strcmp(name, names[i]) == 0)
+		{
+			return (esp_log_level_t)i;
+		}
+	}
+
+	return ESP_LOG_ERROR;
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+int main(int argc, char **argv)
+{
+	boat_sim_config_t sim_config = {1.0, 1UL, true};
+	esp_log_level_t log_level = ESP_LOG_ERROR;
+	bool virtual_time = false;
+	const char *nvs_path;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "vd:r:k:m:l:S:nc:p:x:g:a:o:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'v':
+			virtual_time = true;
+			break;
+		case 'd':
+			run_config.duration_s = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			run_config.report_s = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'k':
+			run_config.cpu_scale = atof(optarg);
+			break;
+		case 'm':
+			sim_config.traffic_multiplier = atof(optarg);
+			break;
+		case 'l':
+			log_level = parse_log_level(optarg);
+			break;
+		case 'S':
+			sim_config.seed = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'n':
+			run_config.phone = false;
+			break;
+		case 'c':
+			run_config.capture_path = optarg;
+			break;
+		case 'p':
+			run_config.replay_path = optarg;
+			break;
+		case 'x':
+			run_config.replay_speed = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'g':
+			run_config.gateway_fields = optarg;
+			break;
+		case 'a':
+			run_config.actisense_rate = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'o':
+			run_config.gateway_off_s = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-v] [-d seconds] [-r report_seconds] [-k cpu_scale] [-m traffic_multiplier] "
+					"[-l none|error|warn|info|debug|verbose] [-S seed] [-n]\n"
+					"       [-c capture_file] [-p replay_file] [-x replay_speed] [-g gateway_fields]\n"
+					"       [-a actisense_rate] [-o off_seconds]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (run_config.duration_s == 0UL || run_config.report_s == 0UL || run_config.cpu_scale <= 0.0 ||
+			sim_config.traffic_multiplier <= 0.0 || (run_config.gateway_off_s > 0UL && run_config.gateway_fields == NULL))
+	{
+		fprintf(stderr, "bad parameter\n");
+		return EXIT_FAILURE;
+	}
+
+	host_time_set_virtual(virtual_time);
+	esp_log_level_set("*", log_level);
+	host_esp_set_random_seed(sim_config.seed);
+	nvs_path = getenv("BLUEBRIDGE_NVS");
+	if (nvs_path != NULL && *nvs_path != '\0')
+	{
+		host_nvs_set_file(nvs_path);
+	}
+	attach_uart(UART_NUM_1, "BLUEBRIDGE_UART1");
+	attach_uart(UART_NUM_2, "BLUEBRIDGE_UART2");
+	host_freertos_set_idle_hook(host_uart_idle_hook);
+	host_bt_set_phone(run_config.phone, PHONE_BYTES_PER_SECOND);
+
+	if (run_config.capture_path != NULL)
+	{
+		capture_file = fopen(run_config.capture_path, "wb");
+		if (capture_file == NULL || !capture_start(CAPTURE_BUFFER_SIZE, capture_file_sink))
+		{
+			fprintf(stderr, "cannot capture to %s\n", run_config.capture_path);
+			return EXIT_FAILURE;
+		}
+	}
+	if (run_config.replay_path != NULL)
+	{
+		replay_file = fopen(run_config.replay_path, "rb");
+		if (replay_file == NULL || !capture_replay_start(replay_file_source, run_config.replay_speed))
+		{
+			fprintf(stderr, "cannot replay %s\n", run_config.replay_path);
+			return EXIT_FAILURE;
+		}
+		sim_config.traffic = false;
+	}
+
+	boat_sim_init(&sim_config);
+	boat_sim_start();
+	(void)xTaskCreate(main_task, "main", MAIN_TASK_STACK_SIZE, NULL, MAIN_TASK_PRIORITY, NULL);
+	(void)xTaskCreate(monitor_task, "monitor", MONITOR_TASK_STACK_SIZE, NULL, MONITOR_TASK_PRIORITY, NULL);
+	(void)xTaskCreate(telemetry_task, "telemetry", TELEMETRY_TASK_STACK_SIZE, NULL, TELEMETRY_TASK_PRIORITY, NULL);
+	if (run_config.gateway_fields != NULL)
+	{
+		(void)xTaskCreate(phone_command_task, "phone_command", PHONE_COMMAND_TASK_STACK_SIZE, NULL, PHONE_COMMAND_TASK_PRIORITY,
+				NULL);
+	}
+	if (run_config.actisense_rate > 0UL)
+	{
+		(void)xTaskCreate(phone_input_task, "phone_input", PHONE_INPUT_TASK_STACK_SIZE, NULL, PHONE_INPUT_TASK_PRIORITY, NULL);
+	}
+
+	start_us = host_time_get_us();
+	previous_report_us = start_us;
+	start_cpu_ns = host_time_get_cpu_ns();
+	vTaskStartScheduler();
+
+	if (capture_file != NULL)
+	{
+		(void)fclose(capture_file);
+	}
+	if (replay_file != NULL)
+	{
+		(void)fclose(replay_file);
+	}
+	if (run_config.gateway_off_s > 0UL && !check_gateway_off())
+	{
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,1782 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/*
+The FreeRTOS API on a Linux host. Every task is a ucontext coroutine on its
+own mmap'd stack with a guard page below it, and all tasks run on the one
+thread that called vTaskStartScheduler. A task runs until it blocks, delays,
+yields or readies a task of higher priority; the highest priority ready task
+then runs next, equal priorities in the order they became ready. There is no
+time slicing, so a task that spins waiting for time to pass must call
+something that blocks or moves the virtual clock on.
+
+When no task is ready the scheduler sleeps on the real clock until the
+earliest timeout, or with the virtual clock from host_time.h moves the clock
+straight to it, so an idle system runs as fast as the host can switch tasks.
+Task run time is measured in real microseconds between switches.
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include "freertos/event_groups.h"
+#include "freertos/stream_buffer.h"
+#include "freertos_host.h"
+#include "host_time.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define TICK_US					(1000000LL / (int64_t)configTICK_RATE_HZ)	///< Length of a tick in microseconds
+#define WAIT_FOREVER_US			INT64_MAX			///< Wake time of a task blocked with no timeout
+#define STACK_SCALE				4U					///< Host stack is this many times the requested depth as x86-64 code uses more stack than xtensa
+#define STACK_MINIMUM			(64U * 1024U)		///< Smallest host stack given to a task in bytes
+#define STACK_PAINT				0xa5U				///< Value unused stack is filled with for high water measurement
+#define HEAP_HEADER_SIZE		16U					///< Bytes before each pvPortMalloc block holding its size, keeps 16 byte alignment
+#define IDLE_REAL_WAIT_MAX_US	100000LL			///< Longest real sleep when every task waits forever
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * What a blocked task is waiting for
+ */
+typedef enum
+{
+	WAIT_NONE,					///< Not blocked
+	WAIT_DELAY,					///< Delay, only its timeout wakes it
+	WAIT_RECEIVE,				///< Item in a queue or semaphore, or bytes in a stream buffer
+	WAIT_SEND,					///< Space in a queue or stream buffer
+	WAIT_NOTIFY,				///< Task notification
+	WAIT_EVENT_BITS,			///< Bits in an event group
+	WAIT_TIMER_COMMAND			///< Timer service task waiting for a timer to expire or change
+} wait_reason_t;
+
+/**
+ * Task control block
+ */
+struct tskTaskControlBlock
+{
+	ucontext_t context;							///< Saved registers while not running
+	TaskFunction_t function;					///< Task function
+	void *parameters;							///< Parameter passed to task function
+	char name[configMAX_TASK_NAME_LEN];			///< Task name, truncated like FreeRTOS
+	UBaseType_t priority;						///< Task priority
+	UBaseType_t number;							///< Creation order
+	eTaskState state;							///< Current state
+	uint8_t *mapping;							///< Start of stack mapping including guard page
+	size_t mapping_size;						///< Size of stack mapping
+	uint8_t *stack;								///< Lowest usable stack address
+	size_t stack_size;							///< Usable stack in bytes
+	wait_reason_t wait_reason;					///< What the task is blocked on
+	void *wait_object;							///< Queue, stream buffer, event group or timer list the task is blocked on
+	int64_t wake_time_us;						///< Time the block times out
+	bool timed_out;								///< Set when the block ended because of its timeout
+	uint64_t order;								///< Sequence number of when the task last became ready or blocked
+	uint32_t notify_count;						///< Task notification value used as a counting semaphore
+	EventBits_t wait_bits;						///< Event group bits waited for
+	bool wait_all_bits;							///< All of wait_bits are needed rather than any
+	bool wait_clear_bits;						///< Clear wait_bits when the wait is satisfied
+	EventBits_t event_bits_result;				///< Event group value that satisfied the wait
+	uint64_t run_time_us;						///< Total real time spent running
+	struct tskTaskControlBlock *next;			///< Next task in list of all tasks
+};
+
+/**
+ * Queue, also used for semaphores and mutexes with zero size items
+ */
+struct QueueDefinition
+{
+	uint8_t type;								///< One of queueQUEUE_TYPE_...
+	UBaseType_t length;							///< Maximum number of items
+	UBaseType_t item_size;						///< Size of one item in bytes
+	uint8_t *storage;							///< Item storage
+	bool static_storage;						///< Storage supplied by caller so is not freed
+	UBaseType_t head;							///< Index of next item to receive
+	UBaseType_t count;							///< Number of items in queue
+	TaskHandle_t holder;						///< Task holding the mutex
+	const char *registry_name;					///< Name given by vQueueAddToRegistry
+	char owner[configMAX_TASK_NAME_LEN];		///< Name of task that created the queue
+	UBaseType_t number;							///< Creation order
+	UBaseType_t high_water;						///< Most items ever in queue
+	uint32_t send_fails;						///< Sends that failed because the queue stayed full
+	struct QueueDefinition *next;				///< Next queue in list of all queues
+};
+
+/**
+ * Software timer
+ */
+struct tmrTimerControl
+{
+	const char *name;							///< Timer name
+	TickType_t period;							///< Period in ticks
+	bool auto_reload;							///< Restart automatically on expiry
+	void *id;									///< Timer identifier for use by callback
+	TimerCallbackFunction_t callback;			///< Function called on expiry
+	bool active;								///< Timer is running
+	int64_t expiry_tick;						///< Tick count of next expiry when active
+	struct tmrTimerControl *next;				///< Next timer in list of all timers
+};
+
+/**
+ * Event group
+ */
+struct EventGroupDef_t
+{
+	EventBits_t bits;							///< Current bits
+};
+
+/**
+ * Stream buffer, bytes in a ring
+ */
+struct StreamBufferDef_t
+{
+	uint8_t *storage;							///< Byte storage
+	size_t size;								///< Capacity in bytes
+	size_t trigger_level;						///< Bytes needed to unblock a waiting reader
+	size_t head;								///< Index of next byte to receive
+	size_t count;								///< Number of bytes in buffer
+};
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static int64_t get_monotonic_us(void);
+static int64_t get_tick_count(void);
+static int64_t get_tick_deadline(TickType_t ticks);
+static void switch_to_scheduler(void);
+static bool block_current(wait_reason_t reason, void *object, int64_t wake_time_us);
+static void make_ready(TaskHandle_t task);
+static void check_preemption(void);
+static TaskHandle_t get_highest_waiter(wait_reason_t reason, const void *object);
+static TaskHandle_t select_ready(void);
+static void wake_timed_out(void);
+static int64_t get_earliest_wake_time(void);
+static void free_task(TaskHandle_t task);
+static void unlink_task(TaskHandle_t task);
+static void task_entry(void);
+static QueueHandle_t create_queue(UBaseType_t length, UBaseType_t item_size, uint8_t *storage, uint8_t type);
+static BaseType_t queue_receive(QueueHandle_t queue, void *buffer, TickType_t ticks, bool peek);
+static void wake_timer_service(void);
+static TimerHandle_t get_earliest_timer(void);
+static void timer_service_task(void *parameters);
+static bool event_bits_satisfied(EventBits_t bits, EventBits_t wait_bits, bool wait_all);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static TaskHandle_t task_list;					///< All tasks that have not been deleted
+static TaskHandle_t current_task;				///< Running task or NULL when scheduler has control
+static TaskHandle_t timer_task;					///< Timer service task
+static QueueHandle_t queue_list;				///< All queues that have not been deleted
+static TimerHandle_t timer_list;				///< All timers that have not been deleted
+static ucontext_t scheduler_context;			///< Context of the scheduler loop
+static bool scheduler_running;					///< Scheduler loop keeps going while set
+static uint64_t order_counter;					///< Source of task order sequence numbers
+static UBaseType_t task_counter;				///< Source of task numbers
+static UBaseType_t queue_counter;				///< Source of queue numbers
+static uint64_t switch_count;					///< Number of switches to a task
+static uint64_t idle_us;						///< Real time spent with no task ready
+static int64_t scheduler_start_us;				///< Real time the scheduler started
+static host_freertos_idle_hook_t idle_hook;		///< Function called when no task is ready
+static host_heap_stats_t heap_stats;			///< pvPortMalloc usage
+static size_t page_size;						///< Host memory page size
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/**
+ * Get real time for run time measurement
+ *
+ * @return Monotonic time in microseconds
+ */
+static int64_t get_monotonic_us(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t)ts.tv_sec * 1000000LL + (int64_t)ts.tv_nsec / 1000LL;
+}
+
+/**
+ * Get the tick count without wrapping at 32 bits
+ *
+ * @return Ticks since start up
+ */
+static int64_t get_tick_count(void)
+{
+	return host_time_get_us() / TICK_US;
+}
+
+/**
+ * Get the time a block of a number of ticks from now ends. Like FreeRTOS the block ends on a tick boundary.
+ *
+ * @param ticks Number of ticks, portMAX_DELAY for no timeout
+ * @return Time in microseconds
+ */
+static int64_t get_tick_deadline(TickType_t ticks)
+{
+	if (ticks == portMAX_DELAY)
+	{
+		return WAIT_FOREVER_US;
+	}
+
+	return (get_tick_count() + (int64_t)ticks) * TICK_US;
+}
+
+/**
+ * Save the running task's context and give control to the scheduler loop
+ */
+static void switch_to_scheduler(void)
+{
+	(void)swapcontext(&current_task->context, &scheduler_context);
+}
+
+/**
+ * Block the running task until made ready or until a time
+ *
+ * @param reason What the task waits for
+ * @param object What the task waits on
+ * @param wake_time_us Time the block times out, WAIT_FOREVER_US for none
+ * @return true if made ready before the time out else false
+ */
+static bool block_current(wait_reason_t reason, void *object, int64_t wake_time_us)
+{
+	TaskHandle_t task = current_task;
+
+	task->state = eBlocked;
+	task->wait_reason = reason;
+	task->wait_object = object;
+	task->wake_time_us = wake_time_us;
+	task->timed_out = false;
+	task->order = ++order_counter;
+	switch_to_scheduler();
+
+	return !task->timed_out;
+}
+
+/**
+ * Move a task to the ready state. Does not switch task.
+ *
+ * @param task The task
+ */
+static void make_ready(TaskHandle_t task)
+{
+	task->state = eReady;
+	task->wait_reason = WAIT_NONE;
+	task->wait_object = NULL;
+	task->order = ++order_counter;
+}
+
+/**
+ * Give up the processor if a task of higher priority than the running task is ready
+ */
+static void check_preemption(void)
+{
+	TaskHandle_t task;
+
+	if (current_task == NULL)
+	{
+		return;
+	}
+
+	for (task = task_list; task != NULL; task = task->next)
+	{
+		if (task->state == eReady && task->priority > current_task->priority)
+		{
+			vPortYield();
+			return;
+		}
+	}
+}
+
+/**
+ * Find the task that should be given an object next, highest priority then longest waiting
+ *
+ * @param reason What the task must be waiting for
+ * @param object What the task must be waiting on
+ * @return The task or NULL if none waiting
+ */
+static TaskHandle_t get_highest_waiter(wait_reason_t reason, const void *object)
+{
+	TaskHandle_t task;
+	TaskHandle_t best = NULL;
+
+	for (task = task_list; task != NULL; task = task->next)
+	{
+		if (task->state == eBlocked && task->wait_reason == reason && task->wait_object == object)
+		{
+			if (best == NULL || task->priority > best->priority || (task->priority == best->priority && task->order < best->order))
+			{
+				best = task;
+			}
+		}
+	}
+
+	return best;
+}
+
+/**
+ * Find the task to run next
+ *
+ * @return The task or NULL if none ready
+ */
+static TaskHandle_t select_ready(void)
+{
+	TaskHandle_t task;
+	TaskHandle_t best = NULL;
+
+	for (task = task_list; task != NULL; task = task->next)
+	{
+		if (task->state == eReady)
+		{
+			if (best == NULL || task->priority > best->priority || (task->priority == best->priority && task->order < best->order))
+			{
+				best = task;
+			}
+		}
+	}
+
+	return best;
+}
+
+/**
+ * Make ready all blocked tasks whose time out has passed
+ */
+static void wake_timed_out(void)
+{
+	TaskHandle_t task;
+	int64_t now = host_time_get_us();
+
+	for (task = task_list; task != NULL; task = task->next)
+	{
+		if (task->state == eBlocked && task->wake_time_us <= now)
+		{
+			make_ready(task);
+			task->timed_out = true;
+		}
+	}
+}
+
+/**
+ * Get the earliest time a blocked task times out
+ *
+ * @return Time in microseconds, WAIT_FOREVER_US if none has a time out
+ */
+static int64_t get_earliest_wake_time(void)
+{
+	TaskHandle_t task;
+	int64_t earliest = WAIT_FOREVER_US;
+
+	for (task = task_list; task != NULL; task = task->next)
+	{
+		if (task->state == eBlocked && task->wake_time_us < earliest)
+		{
+			earliest = task->wake_time_us;
+		}
+	}
+
+	return earliest;
+}
+
+/**
+ * Release the memory of a task that is not running
+ *
+ * @param task The task
+ */
+static void free_task(TaskHandle_t task)
+{
+	(void)munmap(task->mapping, task->mapping_size);
+	free(task);
+}
+
+/**
+ * Remove a task from the list of all tasks
+ *
+ * @param task The task
+ */
+static void unlink_task(TaskHandle_t task)
+{
+	TaskHandle_t *link;
+
+	for (link = &task_list; *link != NULL; link = &(*link)->next)
+	{
+		if (*link == task)
+		{
+			*link = task->next;
+			return;
+		}
+	}
+}
+
+/**
+ * First function run on a new task's stack. A task function should never return but if it does the task is deleted.
+ */
+static void task_entry(void)
+{
+	TaskHandle_t task = current_task;
+
+	task->function(task->parameters);
+	(void)fprintf(stderr, "freertos_host: task %s returned from its function\n", task->name);
+	vTaskDelete(NULL);
+}
+
+/**
+ * Allocate and initialize a queue
+ *
+ * @param length Maximum number of items
+ * @param item_size Size of an item in bytes
+ * @param storage Caller supplied item storage or NULL to allocate
+ * @param type One of queueQUEUE_TYPE_...
+ * @return The queue or NULL if out of memory
+ */
+static QueueHandle_t create_queue(UBaseType_t length, UBaseType_t item_size, uint8_t *storage, uint8_t type)
+{
+	QueueHandle_t queue;
+
+	if (length == (UBaseType_t)0)
+	{
+		return NULL;
+	}
+
+	queue = (QueueHandle_t)calloc((size_t)1, sizeof(struct QueueDefinition));
+	if (queue == NULL)
+	{
+		return NULL;
+	}
+
+	queue->static_storage = storage != NULL;
+	if (storage == NULL && item_size > (UBaseType_t)0)
+	{
+		storage = (uint8_t *)malloc((size_t)length * (size_t)item_size);
+		if (storage == NULL)
+		{
+			free(queue);
+			return NULL;
+		}
+	}
+
+	queue->type = type;
+	queue->length = length;
+	queue->item_size = item_size;
+	queue->storage = storage;
+	queue->number = ++queue_counter;
+	(void)snprintf(queue->owner, sizeof(queue->owner), "%s", current_task != NULL ? current_task->name : "(init)");
+	queue->next = queue_list;
+	queue_list = queue;
+
+	return queue;
+}
+
+/**
+ * Receive or peek an item from a queue, blocking if empty
+ *
+ * @param queue The queue
+ * @param buffer Where to copy the item, unused for semaphores
+ * @param ticks Longest time to block
+ * @param peek Leave the item in the queue
+ * @return pdTRUE if an item was received else pdFALSE
+ */
+static BaseType_t queue_receive(QueueHandle_t queue, void *buffer, TickType_t ticks, bool peek)
+{
+	int64_t deadline = 0LL;
+	bool deadline_set = false;
+	TaskHandle_t waiter;
+
+	if (queue == NULL)
+	{
+		return pdFALSE;
+	}
+
+	while (true)
+	{
+		if (queue->count > (UBaseType_t)0)
+		{
+			if (queue->item_size > (UBaseType_t)0 && buffer != NULL)
+			{
+				(void)memcpy(buffer, queue->storage + (size_t)queue->head * (size_t)queue->item_size, (size_t)queue->item_size);
+			}
+			if (!peek)
+			{
+				queue->head = (queue->head + (UBaseType_t)1) % queue->length;
+				queue->count--;
+				if (queue->type == queueQUEUE_TYPE_MUTEX)
+				{
+					queue->holder = current_task;
+				}
+				waiter = get_highest_waiter(WAIT_SEND, queue);
+				if (waiter != NULL)
+				{
+					make_ready(waiter);
+				}
+			}
+			else
+			{
+				// a peek leaves the item so other receivers may take it
+				waiter = get_highest_waiter(WAIT_RECEIVE, queue);
+				if (waiter != NULL)
+				{
+					make_ready(waiter);
+				}
+			}
+			check_preemption();
+
+			return pdTRUE;
+		}
+
+		if (ticks == (TickType_t)0 || current_task == NULL)
+		{
+			return pdFALSE;
+		}
+
+		if (!deadline_set)
+		{
+			deadline = get_tick_deadline(ticks);
+			deadline_set = true;
+		}
+
+		if (!block_current(WAIT_RECEIVE, queue, deadline))
+		{
+			return pdFALSE;
+		}
+	}
+}
+
+/**
+ * Make the timer service task re-evaluate its timers if it is waiting
+ */
+static void wake_timer_service(void)
+{
+	if (timer_task != NULL && timer_task->state == eBlocked && timer_task->wait_reason == WAIT_TIMER_COMMAND)
+	{
+		make_ready(timer_task);
+		check_preemption();
+	}
+}
+
+/**
+ * Find the active timer that expires first
+ *
+ * @return The timer or NULL if no timer is active
+ */
+static TimerHandle_t get_earliest_timer(void)
+{
+	TimerHandle_t timer;
+	TimerHandle_t earliest = NULL;
+
+	for (timer = timer_list; timer != NULL; timer = timer->next)
+	{
+		if (timer->active && (earliest == NULL || timer->expiry_tick < earliest->expiry_tick))
+		{
+			earliest = timer;
+		}
+	}
+
+	return earliest;
+}
+
+/**
+ * Timer service task. Calls the callbacks of expired timers in expiry order then blocks until the next expiry.
+ * Auto reload timers are reloaded from their expiry time, not the time the callback ran, as in FreeRTOS.
+ *
+ * @param parameters Unused
+ */
+static void timer_service_task(void *parameters)
+{
+	TimerHandle_t timer;
+
+	(void)parameters;
+
+	while (true)
+	{
+		while ((timer = get_earliest_timer()) != NULL && timer->expiry_tick <= get_tick_count())
+		{
+			if (timer->auto_reload && timer->period > (TickType_t)0)
+			{
+				timer->expiry_tick += (int64_t)timer->period;
+			}
+			else
+			{
+				timer->active = false;
+			}
+			timer->callback(timer);
+		}
+
+		(void)block_current(WAIT_TIMER_COMMAND, &timer_list, timer != NULL ? timer->expiry_tick * TICK_US : WAIT_FOREVER_US);
+	}
+}
+
+/**
+ * Test event group bits against what a task waits for
+ *
+ * @param bits Event group bits
+ * @param wait_bits Bits waited for
+ * @param wait_all All wait_bits are needed rather than any
+ * @return true if the wait is satisfied
+ */
+static bool event_bits_satisfied(EventBits_t bits, EventBits_t wait_bits, bool wait_all)
+{
+	if (wait_all)
+	{
+		return (bits & wait_bits) == wait_bits;
+	}
+
+	return (bits & wait_bits) != (EventBits_t)0;
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+void host_freertos_set_idle_hook(host_freertos_idle_hook_t hook)
+{
+	idle_hook = hook;
+}
+
+UBaseType_t host_freertos_get_queue_stats(host_queue_stats_t *stats, UBaseType_t max_count)
+{
+	QueueHandle_t queue;
+	UBaseType_t count = (UBaseType_t)0;
+
+	for (queue = queue_list; queue != NULL && count < max_count; queue = queue->next)
+	{
+		stats[count].name = queue->registry_name;
+		stats[count].owner = queue->owner;
+		stats[count].number = queue->number;
+		stats[count].type = queue->type;
+		stats[count].length = queue->length;
+		stats[count].item_size = queue->item_size;
+		stats[count].waiting = queue->count;
+		stats[count].high_water = queue->high_water;
+		stats[count].send_fails = queue->send_fails;
+		count++;
+	}
+
+	return count;
+}
+
+void host_freertos_get_heap_stats(host_heap_stats_t *stats)
+{
+	*stats = heap_stats;
+}
+
+uint64_t host_freertos_get_switch_count(void)
+{
+	return switch_count;
+}
+
+uint64_t host_freertos_get_idle_us(void)
+{
+	return idle_us;
+}
+
+void *pvPortMalloc(size_t xSize)
+{
+	uint8_t *block;
+
+	block = (uint8_t *)malloc(xSize + (size_t)HEAP_HEADER_SIZE);
+	if (block == NULL)
+	{
+		heap_stats.failures++;
+		return NULL;
+	}
+
+	(void)memcpy(block, &xSize, sizeof(size_t));
+	heap_stats.current += xSize;
+	if (heap_stats.current > heap_stats.peak)
+	{
+		heap_stats.peak = heap_stats.current;
+	}
+	heap_stats.allocations++;
+
+	return block + HEAP_HEADER_SIZE;
+}
+
+void vPortFree(void *pv)
+{
+	uint8_t *block;
+	size_t size;
+
+	if (pv == NULL)
+	{
+		return;
+	}
+
+	block = (uint8_t *)pv - HEAP_HEADER_SIZE;
+	(void)memcpy(&size, block, sizeof(size_t));
+	heap_stats.current -= size;
+	heap_stats.frees++;
+	free(block);
+}
+
+size_t xPortGetFreeHeapSize(void)
+{
+	return heap_stats.current < (size_t)configTOTAL_HEAP_SIZE ? (size_t)configTOTAL_HEAP_SIZE - heap_stats.current : (size_t)0;
+}
+
+size_t xPortGetMinimumEverFreeHeapSize(void)
+{
+	return heap_stats.peak < (size_t)configTOTAL_HEAP_SIZE ? (size_t)configTOTAL_HEAP_SIZE - heap_stats.peak : (size_t)0;
+}
+
+void vPortYield(void)
+{
+	if (current_task == NULL)
+	{
+		return;
+	}
+
+	current_task->state = eReady;
+	current_task->order = ++order_counter;
+	switch_to_scheduler();
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char * const pcName, const configSTACK_DEPTH_TYPE usStackDepth,
+		void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask)
+{
+	TaskHandle_t task;
+	size_t stack_size;
+
+	if (page_size == (size_t)0)
+	{
+		page_size = (size_t)sysconf(_SC_PAGESIZE);
+	}
+
+	task = (TaskHandle_t)calloc((size_t)1, sizeof(struct tskTaskControlBlock));
+	if (task == NULL)
+	{
+		return pdFAIL;
+	}
+
+	stack_size = (size_t)usStackDepth * (size_t)STACK_SCALE;
+	if (stack_size < (size_t)STACK_MINIMUM)
+	{
+		stack_size = (size_t)STACK_MINIMUM;
+	}
+	stack_size = (stack_size + page_size - (size_t)1) & ~(page_size - (size_t)1);
+
+	task->mapping_size = stack_size + page_size;
+	task->mapping = (uint8_t *)mmap(NULL, task->mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (task->mapping == (uint8_t *)MAP_FAILED)
+	{
+		free(task);
+		return pdFAIL;
+	}
+
+	// guard page below the stack turns an overflow into a fault rather than silent corruption
+	(void)mprotect(task->mapping, page_size, PROT_NONE);
+	task->stack = task->mapping + page_size;
+	task->stack_size = stack_size;
+	(void)memset(task->stack, STACK_PAINT, stack_size);
+
+	(void)getcontext(&task->context);
+	task->context.uc_stack.ss_sp = task->stack;
+	task->context.uc_stack.ss_size = stack_size;
+	task->context.uc_link = NULL;
+	makecontext(&task->context, task_entry, 0);
+
+	task->function = pxTaskCode;
+	task->parameters = pvParameters;
+	(void)snprintf(task->name, sizeof(task->name), "%s", pcName != NULL ? pcName : "");
+	task->priority = uxPriority < (UBaseType_t)configMAX_PRIORITIES ? uxPriority : (UBaseType_t)(configMAX_PRIORITIES - 1);
+	task->number = ++task_counter;
+	task->wake_time_us = WAIT_FOREVER_US;
+	make_ready(task);
+	task->next = task_list;
+	task_list = task;
+
+	if (pxCreatedTask != NULL)
+	{
+		*pxCreatedTask = task;
+	}
+
+	check_preemption();
+
+	return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char * const pcName, const uint32_t usStackDepth,
+		void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask, const BaseType_t xCoreID)
+{
+	(void)xCoreID;
+
+	return xTaskCreate(pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxCreatedTask);
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+	if (xTaskToDelete == NULL || xTaskToDelete == current_task)
+	{
+		if (current_task == NULL)
+		{
+			return;
+		}
+
+		// the scheduler frees the stack once it is no longer running on it
+		current_task->state = eDeleted;
+		switch_to_scheduler();
+		return;
+	}
+
+	unlink_task(xTaskToDelete);
+	free_task(xTaskToDelete);
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay)
+{
+	if (current_task == NULL)
+	{
+		return;
+	}
+
+	if (xTicksToDelay == (TickType_t)0)
+	{
+		vPortYield();
+		return;
+	}
+
+	(void)block_current(WAIT_DELAY, NULL, get_tick_deadline(xTicksToDelay));
+}
+
+void vTaskDelayUntil(TickType_t * const pxPreviousWakeTime, const TickType_t xTimeIncrement)
+{
+	TickType_t now = xTaskGetTickCount();
+	TickType_t wake_time = *pxPreviousWakeTime + xTimeIncrement;
+
+	*pxPreviousWakeTime = wake_time;
+	if ((TickType_t)(wake_time - now) <= xTimeIncrement && wake_time != now)
+	{
+		vTaskDelay((TickType_t)(wake_time - now));
+	}
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	return (TickType_t)get_tick_count();
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+	return (TickType_t)get_tick_count();
+}
+
+char *pcTaskGetName(TaskHandle_t xTaskToQuery)
+{
+	static char no_task_name[] = "host";
+
+	if (xTaskToQuery == NULL)
+	{
+		xTaskToQuery = current_task;
+	}
+
+	if (xTaskToQuery == NULL)
+	{
+		return no_task_name;
+	}
+
+	return xTaskToQuery->name;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+	return current_task;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t xTask)
+{
+	if (xTask == NULL)
+	{
+		xTask = current_task;
+	}
+
+	return xTask != NULL ? xTask->priority : (UBaseType_t)0;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void)
+{
+	TaskHandle_t task;
+	UBaseType_t count = (UBaseType_t)0;
+
+	for (task = task_list; task != NULL; task = task->next)
+	{
+		count++;
+	}
+
+	return count;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask)
+{
+	size_t unused = (size_t)0;
+
+	if (xTask == NULL)
+	{
+		xTask = current_task;
+	}
+
+	if (xTask == NULL)
+	{
+		return (UBaseType_t)0;
+	}
+
+	while (unused < xTask->stack_size && xTask->stack[unused] == (uint8_t)STACK_PAINT)
+	{
+		unused++;
+	}
+
+	return (UBaseType_t)unused;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t * const pxTaskStatusArray, const UBaseType_t uxArraySize, configRUN_TIME_COUNTER_TYPE * const pulTotalRunTime)
+{
+	TaskHandle_t task;
+	UBaseType_t count = (UBaseType_t)0;
+
+	for (task = task_list; task != NULL && count < uxArraySize; task = task->next)
+	{
+		pxTaskStatusArray[count].xHandle = task;
+		pxTaskStatusArray[count].pcTaskName = task->name;
+		pxTaskStatusArray[count].xTaskNumber = task->number;
+		pxTaskStatusArray[count].eCurrentState = task->state;
+		pxTaskStatusArray[count].uxCurrentPriority = task->priority;
+		pxTaskStatusArray[count].uxBasePriority = task->priority;
+		pxTaskStatusArray[count].ulRunTimeCounter = task->run_time_us;
+		pxTaskStatusArray[count].pxStackBase = task->stack;
+		pxTaskStatusArray[count].usStackHighWaterMark = (uint32_t)uxTaskGetStackHighWaterMark(task);
+		count++;
+	}
+
+	if (pulTotalRunTime != NULL)
+	{
+		*pulTotalRunTime = scheduler_start_us > 0LL ? (configRUN_TIME_COUNTER_TYPE)(get_monotonic_us() - scheduler_start_us) : 0U;
+	}
+
+	return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify)
+{
+	if (xTaskToNotify == NULL)
+	{
+		return pdFAIL;
+	}
+
+	xTaskToNotify->notify_count++;
+	if (xTaskToNotify->state == eBlocked && xTaskToNotify->wait_reason == WAIT_NOTIFY)
+	{
+		make_ready(xTaskToNotify);
+		check_preemption();
+	}
+
+	return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken)
+{
+	if (pxHigherPriorityTaskWoken != NULL)
+	{
+		*pxHigherPriorityTaskWoken = pdFALSE;
+	}
+	(void)xTaskNotifyGive(xTaskToNotify);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+	uint32_t value;
+
+	if (current_task == NULL)
+	{
+		return 0UL;
+	}
+
+	if (current_task->notify_count == 0UL && xTicksToWait != (TickType_t)0)
+	{
+		(void)block_current(WAIT_NOTIFY, NULL, get_tick_deadline(xTicksToWait));
+	}
+
+	value = current_task->notify_count;
+	if (value > 0UL)
+	{
+		current_task->notify_count = xClearCountOnExit ? 0UL : value - 1UL;
+	}
+
+	return value;
+}
+
+void vTaskStartScheduler(void)
+{
+	TaskHandle_t task;
+	int64_t now;
+	int64_t wake_time;
+	int64_t start;
+
+	if (xTaskCreate(timer_service_task, "Tmr Svc", configTIMER_TASK_STACK_DEPTH, NULL, configTIMER_TASK_PRIORITY, &timer_task) != pdPASS)
+	{
+		return;
+	}
+
+	scheduler_running = true;
+	scheduler_start_us = get_monotonic_us();
+
+	while (scheduler_running)
+	{
+		wake_timed_out();
+
+		task = select_ready();
+		if (task != NULL)
+		{
+			current_task = task;
+			task->state = eRunning;
+			switch_count++;
+			start = get_monotonic_us();
+			(void)swapcontext(&scheduler_context, &task->context);
+			task->run_time_us += (uint64_t)(get_monotonic_us() - start);
+			current_task = NULL;
+
+			if (task->state == eDeleted)
+			{
+				unlink_task(task);
+				free_task(task);
+			}
+			continue;
+		}
+
+		now = host_time_get_us();
+		wake_time = get_earliest_wake_time();
+		start = get_monotonic_us();
+
+		if (host_time_is_virtual())
+		{
+			if (idle_hook != NULL)
+			{
+				idle_hook(0LL);
+			}
+
+			// the hook may have readied a task by giving to a queue, if so run it at the current time
+			if (select_ready() == NULL)
+			{
+				if (wake_time == WAIT_FOREVER_US)
+				{
+					(void)fprintf(stderr, "freertos_host: all tasks blocked with no timeout\n");
+					scheduler_running = false;
+				}
+				else
+				{
+					host_time_advance_us(wake_time - now);
+				}
+			}
+		}
+		else
+		{
+			int64_t wait_us = wake_time == WAIT_FOREVER_US ? IDLE_REAL_WAIT_MAX_US : wake_time - now;
+
+			if (wait_us > 0LL)
+			{
+				if (idle_hook != NULL)
+				{
+					idle_hook(wait_us);
+				}
+				else
+				{
+					(void)usleep((useconds_t)wait_us);
+				}
+			}
+		}
+
+		idle_us += (uint64_t)(get_monotonic_us() - start);
+	}
+
+	timer_task = NULL;
+}
+
+void vTaskEndScheduler(void)
+{
+	scheduler_running = false;
+	if (current_task != NULL)
+	{
+		// the task never runs again
+		current_task->state = eSuspended;
+		switch_to_scheduler();
+	}
+}
+
+QueueHandle_t xQueueGenericCreate(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize, const uint8_t ucQueueType)
+{
+	return create_queue(uxQueueLength, uxItemSize, NULL, ucQueueType);
+}
+
+QueueHandle_t xQueueGenericCreateStatic(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize, uint8_t *pucQueueStorage,
+		StaticQueue_t *pxStaticQueue, const uint8_t ucQueueType)
+{
+	(void)pxStaticQueue;
+
+	return create_queue(uxQueueLength, uxItemSize, pucQueueStorage, ucQueueType);
+}
+
+QueueHandle_t xQueueCreateMutex(const uint8_t ucQueueType)
+{
+	QueueHandle_t queue = create_queue((UBaseType_t)1, (UBaseType_t)0, NULL, ucQueueType);
+
+	if (queue != NULL)
+	{
+		queue->count = (UBaseType_t)1;
+	}
+
+	return queue;
+}
+
+QueueHandle_t xQueueCreateCountingSemaphore(const UBaseType_t uxMaxCount, const UBaseType_t uxInitialCount)
+{
+	QueueHandle_t queue = create_queue(uxMaxCount, (UBaseType_t)0, NULL, queueQUEUE_TYPE_COUNTING_SEMAPHORE);
+
+	if (queue != NULL)
+	{
+		queue->count = uxInitialCount <= uxMaxCount ? uxInitialCount : uxMaxCount;
+	}
+
+	return queue;
+}
+
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void * const pvItemToQueue, TickType_t xTicksToWait, const BaseType_t xCopyPosition)
+{
+	int64_t deadline = 0LL;
+	bool deadline_set = false;
+	UBaseType_t position;
+	TaskHandle_t waiter;
+
+	if (xQueue == NULL)
+	{
+		return pdFAIL;
+	}
+
+	if (xQueue->type == queueQUEUE_TYPE_MUTEX)
+	{
+		// only the holder may give a mutex
+		if (xQueue->count > (UBaseType_t)0 || xQueue->holder != current_task)
+		{
+			return pdFAIL;
+		}
+		xQueue->holder = NULL;
+	}
+
+	while (true)
+	{
+		if (xQueue->count < xQueue->length)
+		{
+			if (xCopyPosition == queueSEND_TO_FRONT)
+			{
+				xQueue->head = (xQueue->head + xQueue->length - (UBaseType_t)1) % xQueue->length;
+				position = xQueue->head;
+			}
+			else
+			{
+				position = (xQueue->head + xQueue->count) % xQueue->length;
+			}
+			if (xQueue->item_size > (UBaseType_t)0)
+			{
+				(void)memcpy(xQueue->storage + (size_t)position * (size_t)xQueue->item_size, pvItemToQueue, (size_t)xQueue->item_size);
+			}
+			xQueue->count++;
+			if (xQueue->count > xQueue->high_water)
+			{
+				xQueue->high_water = xQueue->count;
+			}
+
+			waiter = get_highest_waiter(WAIT_RECEIVE, xQueue);
+			if (waiter != NULL)
+			{
+				make_ready(waiter);
+			}
+			check_preemption();
+
+			return pdPASS;
+		}
+
+		if (xTicksToWait == (TickType_t)0 || current_task == NULL)
+		{
+			xQueue->send_fails++;
+			return errQUEUE_FULL;
+		}
+
+		if (!deadline_set)
+		{
+			deadline = get_tick_deadline(xTicksToWait);
+			deadline_set = true;
+		}
+
+		if (!block_current(WAIT_SEND, xQueue, deadline))
+		{
+			xQueue->send_fails++;
+			return errQUEUE_FULL;
+		}
+	}
+}
+
+BaseType_t xQueueGenericSendFromISR(QueueHandle_t xQueue, const void * const pvItemToQueue, BaseType_t * const pxHigherPriorityTaskWoken,
+		const BaseType_t xCopyPosition)
+{
+	if (pxHigherPriorityTaskWoken != NULL)
+	{
+		*pxHigherPriorityTaskWoken = pdFALSE;
+	}
+
+	return xQueueGenericSend(xQueue, pvItemToQueue, (TickType_t)0, xCopyPosition);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void * const pvBuffer, TickType_t xTicksToWait)
+{
+	return queue_receive(xQueue, pvBuffer, xTicksToWait, false);
+}
+
+BaseType_t xQueueReceiveFromISR(QueueHandle_t xQueue, void * const pvBuffer, BaseType_t * const pxHigherPriorityTaskWoken)
+{
+	if (pxHigherPriorityTaskWoken != NULL)
+	{
+		*pxHigherPriorityTaskWoken = pdFALSE;
+	}
+
+	return queue_receive(xQueue, pvBuffer, (TickType_t)0, false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t xQueue, void * const pvBuffer, TickType_t xTicksToWait)
+{
+	return queue_receive(xQueue, pvBuffer, xTicksToWait, true);
+}
+
+BaseType_t xQueueSemaphoreTake(QueueHandle_t xQueue, TickType_t xTicksToWait)
+{
+	return queue_receive(xQueue, NULL, xTicksToWait, false);
+}
+
+BaseType_t xQueueReset(QueueHandle_t xQueue)
+{
+	TaskHandle_t waiter;
+
+	if (xQueue == NULL)
+	{
+		return pdFAIL;
+	}
+
+	xQueue->head = (UBaseType_t)0;
+	xQueue->count = (UBaseType_t)0;
+	waiter = get_highest_waiter(WAIT_SEND, xQueue);
+	if (waiter != NULL)
+	{
+		make_ready(waiter);
+		check_preemption();
+	}
+
+	return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue)
+{
+	return xQueue != NULL ? xQueue->count : (UBaseType_t)0;
+}
+
+UBaseType_t uxQueueMessagesWaitingFromISR(const QueueHandle_t xQueue)
+{
+	return uxQueueMessagesWaiting(xQueue);
+}
+
+UBaseType_t uxQueueSpacesAvailable(const QueueHandle_t xQueue)
+{
+	return xQueue != NULL ? xQueue->length - xQueue->count : (UBaseType_t)0;
+}
+
+void vQueueDelete(QueueHandle_t xQueue)
+{
+	QueueHandle_t *link;
+
+	if (xQueue == NULL)
+	{
+		return;
+	}
+
+	for (link = &queue_list; *link != NULL; link = &(*link)->next)
+	{
+		if (*link == xQueue)
+		{
+			*link = xQueue->next;
+			break;
+		}
+	}
+
+	if (!xQueue->static_storage)
+	{
+		free(xQueue->storage);
+	}
+	free(xQueue);
+}
+
+void vQueueAddToRegistry(QueueHandle_t xQueue, const char *pcQueueName)
+{
+	if (xQueue != NULL)
+	{
+		xQueue->registry_name = pcQueueName;
+	}
+}
+
+const char *pcQueueGetName(QueueHandle_t xQueue)
+{
+	return xQueue != NULL ? xQueue->registry_name : NULL;
+}
+
+TimerHandle_t xTimerCreate(const char * const pcTimerName, const TickType_t xTimerPeriodInTicks, const UBaseType_t uxAutoReload,
+		void * const pvTimerID, TimerCallbackFunction_t pxCallbackFunction)
+{
+	TimerHandle_t timer;
+
+	if (xTimerPeriodInTicks == (TickType_t)0 || pxCallbackFunction == NULL)
+	{
+		return NULL;
+	}
+
+	timer = (TimerHandle_t)calloc((size_t)1, sizeof(struct tmrTimerControl));
+	if (timer == NULL)
+	{
+		return NULL;
+	}
+
+	timer->name = pcTimerName;
+	timer->period = xTimerPeriodInTicks;
+	timer->auto_reload = uxAutoReload != (UBaseType_t)0;
+	timer->id = pvTimerID;
+	timer->callback = pxCallbackFunction;
+	timer->next = timer_list;
+	timer_list = timer;
+
+	return timer;
+}
+
+BaseType_t xTimerStart(TimerHandle_t xTimer, TickType_t xTicksToWait)
+{
+	(void)xTicksToWait;
+
+	if (xTimer == NULL)
+	{
+		return pdFAIL;
+	}
+
+	xTimer->active = true;
+	xTimer->expiry_tick = get_tick_count() + (int64_t)xTimer->period;
+	wake_timer_service();
+
+	return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t xTimer, TickType_t xTicksToWait)
+{
+	(void)xTicksToWait;
+
+	if (xTimer == NULL)
+	{
+		return pdFAIL;
+	}
+
+	xTimer->active = false;
+	wake_timer_service();
+
+	return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t xTimer, TickType_t xTicksToWait)
+{
+	return xTimerStart(xTimer, xTicksToWait);
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t xTimer, TickType_t xNewPeriod, TickType_t xTicksToWait)
+{
+	if (xTimer == NULL || xNewPeriod == (TickType_t)0)
+	{
+		return pdFAIL;
+	}
+
+	// changing the period also starts the timer
+	xTimer->period = xNewPeriod;
+
+	return xTimerStart(xTimer, xTicksToWait);
+}
+
+BaseType_t xTimerDelete(TimerHandle_t xTimer, TickType_t xTicksToWait)
+{
+	TimerHandle_t *link;
+
+	(void)xTicksToWait;
+
+	if (xTimer == NULL)
+	{
+		return pdFAIL;
+	}
+
+	for (link = &timer_list; *link != NULL; link = &(*link)->next)
+	{
+		if (*link == xTimer)
+		{
+			*link = xTimer->next;
+			break;
+		}
+	}
+	free(xTimer);
+	wake_timer_service();
+
+	return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t xTimer)
+{
+	return xTimer != NULL && xTimer->active ? pdTRUE : pdFALSE;
+}
+
+void *pvTimerGetTimerID(const TimerHandle_t xTimer)
+{
+	return xTimer != NULL ? xTimer->id : NULL;
+}
+
+void vTimerSetTimerID(TimerHandle_t xTimer, void *pvNewID)
+{
+	if (xTimer != NULL)
+	{
+		xTimer->id = pvNewID;
+	}
+}
+
+const char *pcTimerGetName(TimerHandle_t xTimer)
+{
+	return xTimer != NULL ? xTimer->name : NULL;
+}
+
+TickType_t xTimerGetPeriod(TimerHandle_t xTimer)
+{
+	return xTimer != NULL ? xTimer->period : (TickType_t)0;
+}
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+	return (EventGroupHandle_t)calloc((size_t)1, sizeof(struct EventGroupDef_t));
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet)
+{
+	TaskHandle_t task;
+	EventBits_t bits_to_clear = (EventBits_t)0;
+	EventBits_t bits;
+
+	if (xEventGroup == NULL)
+	{
+		return (EventBits_t)0;
+	}
+
+	xEventGroup->bits |= uxBitsToSet;
+	bits = xEventGroup->bits;
+
+	for (task = task_list; task != NULL; task = task->next)
+	{
+		if (task->state == eBlocked && task->wait_reason == WAIT_EVENT_BITS && task->wait_object == xEventGroup &&
+				event_bits_satisfied(bits, task->wait_bits, task->wait_all_bits))
+		{
+			task->event_bits_result = bits;
+			if (task->wait_clear_bits)
+			{
+				bits_to_clear |= task->wait_bits;
+			}
+			make_ready(task);
+		}
+	}
+
+	// clearing is done once all waiting tasks have seen the bits as in FreeRTOS
+	xEventGroup->bits &= ~bits_to_clear;
+	bits = xEventGroup->bits;
+	check_preemption();
+
+	return bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToClear)
+{
+	EventBits_t bits;
+
+	if (xEventGroup == NULL)
+	{
+		return (EventBits_t)0;
+	}
+
+	bits = xEventGroup->bits;
+	xEventGroup->bits &= ~uxBitsToClear;
+
+	return bits;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup)
+{
+	return xEventGroup != NULL ? xEventGroup->bits : (EventBits_t)0;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToWaitFor, const BaseType_t xClearOnExit,
+		const BaseType_t xWaitForAllBits, TickType_t xTicksToWait)
+{
+	EventBits_t bits;
+
+	if (xEventGroup == NULL)
+	{
+		return (EventBits_t)0;
+	}
+
+	bits = xEventGroup->bits;
+	if (event_bits_satisfied(bits, uxBitsToWaitFor, xWaitForAllBits != pdFALSE))
+	{
+		if (xClearOnExit != pdFALSE)
+		{
+			xEventGroup->bits &= ~uxBitsToWaitFor;
+		}
+		return bits;
+	}
+
+	if (xTicksToWait == (TickType_t)0 || current_task == NULL)
+	{
+		return bits;
+	}
+
+	current_task->wait_bits = uxBitsToWaitFor;
+	current_task->wait_all_bits = xWaitForAllBits != pdFALSE;
+	current_task->wait_clear_bits = xClearOnExit != pdFALSE;
+	if (block_current(WAIT_EVENT_BITS, xEventGroup, get_tick_deadline(xTicksToWait)))
+	{
+		return current_task->event_bits_result;
+	}
+
+	return xEventGroup->bits;
+}
+
+void vEventGroupDelete(EventGroupHandle_t xEventGroup)
+{
+	free(xEventGroup);
+}
+
+StreamBufferHandle_t xStreamBufferCreate(size_t xBufferSizeBytes, size_t xTriggerLevelBytes)
+{
+	StreamBufferHandle_t stream_buffer;
+
+	if (xBufferSizeBytes == (size_t)0)
+	{
+		return NULL;
+	}
+
+	stream_buffer = (StreamBufferHandle_t)calloc((size_t)1, sizeof(struct StreamBufferDef_t));
+	if (stream_buffer == NULL)
+	{
+		return NULL;
+	}
+
+	stream_buffer->storage = (uint8_t *)malloc(xBufferSizeBytes);
+	if (stream_buffer->storage == NULL)
+	{
+		free(stream_buffer);
+		return NULL;
+	}
+
+	stream_buffer->size = xBufferSizeBytes;
+	stream_buffer->trigger_level = xTriggerLevelBytes == (size_t)0 ? (size_t)1 : xTriggerLevelBytes;
+	if (stream_buffer->trigger_level > xBufferSizeBytes)
+	{
+		stream_buffer->trigger_level = xBufferSizeBytes;
+	}
+
+	return stream_buffer;
+}
+
+size_t xStreamBufferSend(StreamBufferHandle_t xStreamBuffer, const void *pvTxData, size_t xDataLengthBytes, TickType_t xTicksToWait)
+{
+	int64_t deadline = 0LL;
+	bool deadline_set = false;
+	size_t length;
+	size_t position;
+	size_t first_part;
+	TaskHandle_t waiter;
+
+	if (xStreamBuffer == NULL || pvTxData == NULL)
+	{
+		return (size_t)0;
+	}
+
+	// like FreeRTOS wait for space for all the data, then send what fits
+	while (xStreamBuffer->size - xStreamBuffer->count < xDataLengthBytes && xTicksToWait != (TickType_t)0 && current_task != NULL)
+	{
+		if (!deadline_set)
+		{
+			deadline = get_tick_deadline(xTicksToWait);
+			deadline_set = true;
+		}
+
+		if (!block_current(WAIT_SEND, xStreamBuffer, deadline))
+		{
+			break;
+		}
+	}
+
+	length = xStreamBuffer->size - xStreamBuffer->count;
+	if (length > xDataLengthBytes)
+	{
+		length = xDataLengthBytes;
+	}
+	if (length == (size_t)0)
+	{
+		return (size_t)0;
+	}
+
+	position = (xStreamBuffer->head + xStreamBuffer->count) % xStreamBuffer->size;
+	first_part = xStreamBuffer->size - position;
+	if (first_part > length)
+	{
+		first_part = length;
+	}
+	(void)memcpy(xStreamBuffer->storage + position, pvTxData, first_part);
+	(void)memcpy(xStreamBuffer->storage, (const uint8_t *)pvTxData + first_part, length - first_part);
+	xStreamBuffer->count += length;
+
+	if (xStreamBuffer->count >= xStreamBuffer->trigger_level)
+	{
+		waiter = get_highest_waiter(WAIT_RECEIVE, xStreamBuffer);
+		if (waiter != NULL)
+		{
+			make_ready(waiter);
+		}
+		check_preemption();
+	}
+
+	return length;
+}
+
+size_t xStreamBufferReceive(StreamBufferHandle_t xStreamBuffer, void *pvRxData, size_t xBufferLengthBytes, TickType_t xTicksToWait)
+{
+	size_t length;
+	size_t first_part;
+	TaskHandle_t waiter;
+
+	if (xStreamBuffer == NULL || pvRxData == NULL)
+	{
+		return (size_t)0;
+	}
+
+	// like FreeRTOS block only while empty, a send reaching the trigger level wakes the reader
+	if (xStreamBuffer->count == (size_t)0 && xTicksToWait != (TickType_t)0 && current_task != NULL)
+	{
+		(void)block_current(WAIT_RECEIVE, xStreamBuffer, get_tick_deadline(xTicksToWait));
+	}
+
+	length = xStreamBuffer->count;
+	if (length > xBufferLengthBytes)
+	{
+		length = xBufferLengthBytes;
+	}
+	if (length == (size_t)0)
+	{
+		return (size_t)0;
+	}
+
+	first_part = xStreamBuffer->size - xStreamBuffer->head;
+	if (first_part > length)
+	{
+		first_part = length;
+	}
+	(void)memcpy(pvRxData, xStreamBuffer->storage + xStreamBuffer->head, first_part);
+	(void)memcpy((uint8_t *)pvRxData + first_part, xStreamBuffer->storage, length - first_part);
+	xStreamBuffer->head = (xStreamBuffer->head + length) % xStreamBuffer->size;
+	xStreamBuffer->count -= length;
+
+	waiter = get_highest_waiter(WAIT_SEND, xStreamBuffer);
+	if (waiter != NULL)
+	{
+		make_ready(waiter);
+		check_preemption();
+	}
+
+	return length;
+}
+
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t xStreamBuffer)
+{
+	return xStreamBuffer != NULL ? xStreamBuffer->count : (size_t)0;
+}
+
+size_t xStreamBufferSpacesAvailable(StreamBufferHandle_t xStreamBuffer)
+{
+	return xStreamBuffer != NULL ? xStreamBuffer->size - xStreamBuffer->count : (size_t)0;
+}
+
+BaseType_t xStreamBufferReset(StreamBufferHandle_t xStreamBuffer)
+{
+	// FreeRTOS refuses a reset while a task is blocked on the buffer
+	if (xStreamBuffer == NULL || get_highest_waiter(WAIT_SEND, xStreamBuffer) != NULL ||
+			get_highest_waiter(WAIT_RECEIVE, xStreamBuffer) != NULL)
+	{
+		return pdFAIL;
+	}
+
+	xStreamBuffer->head = (size_t)0;
+	xStreamBuffer->count = (size_t)0;
+
+	return pdPASS;
+}
+
+void vStreamBufferDelete(StreamBufferHandle_t xStreamBuffer)
+{
+	if (xStreamBuffer == NULL)
+	{
+		return;
+	}
+
+	free(xStreamBuffer->storage);
+	free(xStreamBuffer);
+}
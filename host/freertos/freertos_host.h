@@ -0,0 +1,136 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef FREERTOS_HOST_H
+#define FREERTOS_HOST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Function called by the scheduler when no task is ready to run
+ *
+ * @param wait_us On the real clock the longest time the hook may block waiting for input before a task is due to run.
+ *                On the virtual clock 0, the hook may still block for a short real time waiting for replies from
+ *                external devices before the scheduler moves the virtual clock on.
+ */
+typedef void (*host_freertos_idle_hook_t)(int64_t wait_us);
+
+/**
+ * Usage figures of a queue or semaphore
+ */
+typedef struct
+{
+	const char *name;				///< Name given by vQueueAddToRegistry or NULL
+	const char *owner;				///< Name of the task that created the queue
+	UBaseType_t number;				///< Creation order, stable while the queue exists
+	uint8_t type;					///< One of queueQUEUE_TYPE_...
+	UBaseType_t length;				///< Maximum number of items
+	UBaseType_t item_size;			///< Size of one item in bytes
+	UBaseType_t waiting;			///< Number of items currently in the queue
+	UBaseType_t high_water;			///< Most items ever in the queue
+	uint32_t send_fails;			///< Sends that failed because the queue stayed full
+} host_queue_stats_t;
+
+/**
+ * Usage figures of the pvPortMalloc heap
+ */
+typedef struct
+{
+	size_t current;					///< Bytes currently allocated
+	size_t peak;					///< Most bytes ever allocated
+	uint32_t allocations;			///< Successful calls to pvPortMalloc
+	uint32_t frees;					///< Calls to vPortFree with a non NULL pointer
+	uint32_t failures;				///< Calls to pvPortMalloc that returned NULL
+} host_heap_stats_t;
+
+/*************************
+*** EXTERNAL VARIABLES ***
+*************************/
+
+/***************************
+*** FUNCTIONS PROTOTYPES ***
+***************************/
+
+/**
+ * Set the function called when no task is ready to run. Used by device shims that read from real file descriptors.
+ *
+ * @param hook The function, or NULL to sleep on the real clock and jump the virtual clock with no waiting
+ */
+void host_freertos_set_idle_hook(host_freertos_idle_hook_t hook);
+
+/**
+ * Get usage figures of all queues and semaphores that exist
+ *
+ * @param stats Array to fill
+ * @param max_count Number of entries in stats
+ * @return Number of entries filled
+ */
+UBaseType_t host_freertos_get_queue_stats(host_queue_stats_t *stats, UBaseType_t max_count);
+
+/**
+ * Get usage figures of the pvPortMalloc heap
+ *
+ * @param stats Structure to fill
+ */
+void host_freertos_get_heap_stats(host_heap_stats_t *stats);
+
+/**
+ * Get the number of times the scheduler has switched to a task since it started
+ *
+ * @return Number of switches
+ */
+uint64_t host_freertos_get_switch_count(void);
+
+/**
+ * Get the real time the scheduler has spent with no task ready to run since it started
+ *
+ * @return Idle time in microseconds
+ */
+uint64_t host_freertos_get_idle_us(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
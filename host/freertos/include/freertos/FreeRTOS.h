@@ -0,0 +1,89 @@
+/*
+Host FreeRTOS API for running the whole firmware on Linux. This is not the
+FreeRTOS kernel, it is a cooperative scheduler in freertos_host.c that
+implements the subset of the API used by the BlueBridge sources with the
+ESP-IDF flavour of the types (stack depth in bytes, legacy handle names).
+Configuration matches sdkconfig.defaults and the ESP-IDF defaults.
+*/
+
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/* ESP-IDF portmacro.h pulls in stdio.h, stdlib.h and esp_system.h so firmware gets esp_restart() from here */
+#include "esp_system.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t TickType_t;
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint8_t StackType_t;
+
+#define configTICK_RATE_HZ				1000
+#define configMAX_PRIORITIES			25
+#define configMAX_TASK_NAME_LEN			16
+#define configMINIMAL_STACK_SIZE		768
+#define configTIMER_TASK_PRIORITY		1
+#define configTIMER_TASK_STACK_DEPTH	2048
+#define configSTACK_DEPTH_TYPE			uint32_t
+#define configTOTAL_HEAP_SIZE			(160U * 1024U)
+#define configRUN_TIME_COUNTER_TYPE		uint64_t
+
+#define portTICK_PERIOD_MS				((TickType_t)1000 / configTICK_RATE_HZ)
+#define portTICK_RATE_MS				portTICK_PERIOD_MS
+#define portMAX_DELAY					((TickType_t)0xffffffffUL)
+#define portNUM_PROCESSORS				1
+#define portYIELD()						vPortYield()
+#define portYIELD_FROM_ISR()			vPortYield()
+#define portEND_SWITCHING_ISR(x)		do { if (x) { vPortYield(); } } while (0)
+#define pdMS_TO_TICKS(ms)				((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000))
+
+#define pdFALSE							((BaseType_t)0)
+#define pdTRUE							((BaseType_t)1)
+#define pdPASS							pdTRUE
+#define pdFAIL							pdFALSE
+#define errQUEUE_EMPTY					((BaseType_t)0)
+#define errQUEUE_FULL					((BaseType_t)0)
+
+#define tskNO_AFFINITY					((BaseType_t)0x7fffffff)
+
+/* Only one task runs at a time and no task is preempted, so critical sections need no locking */
+typedef struct
+{
+	uint32_t owner;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED	{0UL}
+#define portENTER_CRITICAL(mux)			((void)(mux))
+#define portEXIT_CRITICAL(mux)			((void)(mux))
+#define portENTER_CRITICAL_ISR(mux)		((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux)		((void)(mux))
+#define portENTER_CRITICAL_SAFE(mux)	((void)(mux))
+#define portEXIT_CRITICAL_SAFE(mux)		((void)(mux))
+
+/* Statically allocated queue storage, only its size matters on the host */
+typedef struct
+{
+	void *pvDummy[8];
+} StaticQueue_t;
+typedef StaticQueue_t StaticSemaphore_t;
+
+void *pvPortMalloc(size_t xSize);
+void vPortFree(void *pv);
+size_t xPortGetFreeHeapSize(void);
+size_t xPortGetMinimumEverFreeHeapSize(void);
+void vPortYield(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,61 @@
+/*
+Host freertos/queue.h, see FreeRTOS.h in this directory. FromISR variants
+behave like the task versions with no wait as interrupts are not emulated.
+*/
+
+#ifndef INC_QUEUE_H
+#define INC_QUEUE_H
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct QueueDefinition *QueueHandle_t;
+typedef QueueHandle_t xQueueHandle;
+
+#define queueQUEUE_TYPE_BASE				((uint8_t)0U)
+#define queueQUEUE_TYPE_MUTEX				((uint8_t)1U)
+#define queueQUEUE_TYPE_COUNTING_SEMAPHORE	((uint8_t)2U)
+#define queueQUEUE_TYPE_BINARY_SEMAPHORE	((uint8_t)3U)
+
+#define queueSEND_TO_BACK					((BaseType_t)0)
+#define queueSEND_TO_FRONT					((BaseType_t)1)
+
+#define xQueueCreate(uxQueueLength, uxItemSize)		xQueueGenericCreate((uxQueueLength), (uxItemSize), queueQUEUE_TYPE_BASE)
+#define xQueueCreateStatic(uxQueueLength, uxItemSize, pucQueueStorage, pxQueueBuffer) \
+	xQueueGenericCreateStatic((uxQueueLength), (uxItemSize), (pucQueueStorage), (pxQueueBuffer), queueQUEUE_TYPE_BASE)
+#define xQueueSend(xQueue, pvItemToQueue, xTicksToWait) \
+	xQueueGenericSend((xQueue), (pvItemToQueue), (xTicksToWait), queueSEND_TO_BACK)
+#define xQueueSendToBack(xQueue, pvItemToQueue, xTicksToWait) \
+	xQueueGenericSend((xQueue), (pvItemToQueue), (xTicksToWait), queueSEND_TO_BACK)
+#define xQueueSendToFront(xQueue, pvItemToQueue, xTicksToWait) \
+	xQueueGenericSend((xQueue), (pvItemToQueue), (xTicksToWait), queueSEND_TO_FRONT)
+#define xQueueSendFromISR(xQueue, pvItemToQueue, pxHigherPriorityTaskWoken) \
+	xQueueGenericSendFromISR((xQueue), (pvItemToQueue), (pxHigherPriorityTaskWoken), queueSEND_TO_BACK)
+#define xQueueSendToBackFromISR(xQueue, pvItemToQueue, pxHigherPriorityTaskWoken) \
+	xQueueGenericSendFromISR((xQueue), (pvItemToQueue), (pxHigherPriorityTaskWoken), queueSEND_TO_BACK)
+
+QueueHandle_t xQueueGenericCreate(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize, const uint8_t ucQueueType);
+QueueHandle_t xQueueGenericCreateStatic(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize, uint8_t *pucQueueStorage,
+		StaticQueue_t *pxStaticQueue, const uint8_t ucQueueType);
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void * const pvItemToQueue, TickType_t xTicksToWait, const BaseType_t xCopyPosition);
+BaseType_t xQueueGenericSendFromISR(QueueHandle_t xQueue, const void * const pvItemToQueue, BaseType_t * const pxHigherPriorityTaskWoken,
+		const BaseType_t xCopyPosition);
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void * const pvBuffer, TickType_t xTicksToWait);
+BaseType_t xQueueReceiveFromISR(QueueHandle_t xQueue, void * const pvBuffer, BaseType_t * const pxHigherPriorityTaskWoken);
+BaseType_t xQueuePeek(QueueHandle_t xQueue, void * const pvBuffer, TickType_t xTicksToWait);
+BaseType_t xQueueReset(QueueHandle_t xQueue);
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue);
+UBaseType_t uxQueueMessagesWaitingFromISR(const QueueHandle_t xQueue);
+UBaseType_t uxQueueSpacesAvailable(const QueueHandle_t xQueue);
+void vQueueDelete(QueueHandle_t xQueue);
+void vQueueAddToRegistry(QueueHandle_t xQueue, const char *pcQueueName);
+const char *pcQueueGetName(QueueHandle_t xQueue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,37 @@
+/*
+Host freertos/semphr.h, see FreeRTOS.h in this directory. Semaphores are
+queues of zero sized items as in FreeRTOS. Mutexes record their holder but
+priority inheritance is not emulated.
+*/
+
+#ifndef SEMAPHORE_H
+#define SEMAPHORE_H
+
+#include "freertos/queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef QueueHandle_t SemaphoreHandle_t;
+typedef SemaphoreHandle_t xSemaphoreHandle;
+
+#define xSemaphoreCreateBinary()			xQueueGenericCreate((UBaseType_t)1, (UBaseType_t)0, queueQUEUE_TYPE_BINARY_SEMAPHORE)
+#define xSemaphoreCreateMutex()				xQueueCreateMutex(queueQUEUE_TYPE_MUTEX)
+#define xSemaphoreCreateCounting(uxMaxCount, uxInitialCount)	xQueueCreateCountingSemaphore((uxMaxCount), (uxInitialCount))
+#define xSemaphoreTake(xSemaphore, xBlockTime)	xQueueSemaphoreTake((xSemaphore), (xBlockTime))
+#define xSemaphoreGive(xSemaphore)			xQueueGenericSend((QueueHandle_t)(xSemaphore), NULL, (TickType_t)0, queueSEND_TO_BACK)
+#define xSemaphoreGiveFromISR(xSemaphore, pxHigherPriorityTaskWoken) \
+	xQueueGenericSendFromISR((QueueHandle_t)(xSemaphore), NULL, (pxHigherPriorityTaskWoken), queueSEND_TO_BACK)
+#define vSemaphoreDelete(xSemaphore)		vQueueDelete((QueueHandle_t)(xSemaphore))
+#define uxSemaphoreGetCount(xSemaphore)		uxQueueMessagesWaiting((QueueHandle_t)(xSemaphore))
+
+QueueHandle_t xQueueCreateMutex(const uint8_t ucQueueType);
+QueueHandle_t xQueueCreateCountingSemaphore(const UBaseType_t uxMaxCount, const UBaseType_t uxInitialCount);
+BaseType_t xQueueSemaphoreTake(QueueHandle_t xQueue, TickType_t xTicksToWait);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
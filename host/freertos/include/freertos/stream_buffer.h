@@ -0,0 +1,35 @@
+/*
+Host freertos/stream_buffer.h, see FreeRTOS.h in this directory. Like
+FreeRTOS a stream buffer has one writer and one reader. FromISR variants
+behave like the task versions with no wait as interrupts are not emulated.
+*/
+
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct StreamBufferDef_t *StreamBufferHandle_t;
+
+StreamBufferHandle_t xStreamBufferCreate(size_t xBufferSizeBytes, size_t xTriggerLevelBytes);
+size_t xStreamBufferSend(StreamBufferHandle_t xStreamBuffer, const void *pvTxData, size_t xDataLengthBytes, TickType_t xTicksToWait);
+size_t xStreamBufferReceive(StreamBufferHandle_t xStreamBuffer, void *pvRxData, size_t xBufferLengthBytes, TickType_t xTicksToWait);
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t xStreamBuffer);
+size_t xStreamBufferSpacesAvailable(StreamBufferHandle_t xStreamBuffer);
+BaseType_t xStreamBufferReset(StreamBufferHandle_t xStreamBuffer);
+void vStreamBufferDelete(StreamBufferHandle_t xStreamBuffer);
+
+#define xStreamBufferSendFromISR(xStreamBuffer, pvTxData, xDataLengthBytes, pxHigherPriorityTaskWoken) \
+	xStreamBufferSend((xStreamBuffer), (pvTxData), (xDataLengthBytes), (TickType_t)0)
+#define xStreamBufferReceiveFromISR(xStreamBuffer, pvRxData, xBufferLengthBytes, pxHigherPriorityTaskWoken) \
+	xStreamBufferReceive((xStreamBuffer), (pvRxData), (xBufferLengthBytes), (TickType_t)0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,40 @@
+/*
+Host freertos/timers.h, see FreeRTOS.h in this directory. Callbacks run in
+the timer service task at configTIMER_TASK_PRIORITY as on the device. The
+timer command queue is not emulated, commands take effect immediately.
+*/
+
+#ifndef TIMERS_H
+#define TIMERS_H
+
+#include "freertos/task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct tmrTimerControl *TimerHandle_t;
+typedef TimerHandle_t xTimerHandle;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t xTimer);
+
+TimerHandle_t xTimerCreate(const char * const pcTimerName, const TickType_t xTimerPeriodInTicks, const UBaseType_t uxAutoReload,
+		void * const pvTimerID, TimerCallbackFunction_t pxCallbackFunction);
+BaseType_t xTimerStart(TimerHandle_t xTimer, TickType_t xTicksToWait);
+BaseType_t xTimerStop(TimerHandle_t xTimer, TickType_t xTicksToWait);
+BaseType_t xTimerReset(TimerHandle_t xTimer, TickType_t xTicksToWait);
+BaseType_t xTimerChangePeriod(TimerHandle_t xTimer, TickType_t xNewPeriod, TickType_t xTicksToWait);
+BaseType_t xTimerDelete(TimerHandle_t xTimer, TickType_t xTicksToWait);
+BaseType_t xTimerIsTimerActive(TimerHandle_t xTimer);
+void *pvTimerGetTimerID(const TimerHandle_t xTimer);
+void vTimerSetTimerID(TimerHandle_t xTimer, void *pvNewID);
+const char *pcTimerGetName(TimerHandle_t xTimer);
+TickType_t xTimerGetPeriod(TimerHandle_t xTimer);
+
+#define xTimerStartFromISR(xTimer, pxHigherPriorityTaskWoken)	xTimerStart((xTimer), (TickType_t)0)
+#define xTimerStopFromISR(xTimer, pxHigherPriorityTaskWoken)	xTimerStop((xTimer), (TickType_t)0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,387 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/*
+Modem benchmark
+
+Runs the unmodified modem.c, mqtt.c and pdu.c against sim800_emulator through
+modem_interface_posix.c. Follows the same start up sequence as publisher.c,
+connects to the MQTT broker, then publishes a CSV payload of the size the
+publisher sends at a fixed period, timing each step. Incoming SMS are read,
+decoded and answered. Results are printed as JSON on stdout.
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include "host_time.h"
+#include "modem.h"
+#include "modem_interface_posix.h"
+#include "mqtt.h"
+#include "pdu.h"
+#include "util.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define BENCH_DEFAULT_BROKER		"127.0.0.1"		///< Address passed to AT+CIPSTART
+#define BENCH_DEFAULT_PORT			1883U			///< Port passed to AT+CIPSTART
+#define BENCH_DEFAULT_PUBLISHES		20UL			///< Number of publishes
+#define BENCH_DEFAULT_PERIOD_MS		1000UL			///< Time between publish starts
+#define BENCH_MQTT_KEEPALIVE_S		600U			///< Same as publisher.c
+#define BENCH_START_ATTEMPTS		5UL				///< Modem start up attempts before giving up
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Timing of one group of operations
+ */
+typedef struct
+{
+	uint32_t count;					///< Successful operations
+	uint32_t failures;				///< Failed operations
+	int64_t total_us;				///< Sum of successful operation times
+	int64_t max_us;					///< Longest successful operation time
+} timing_t;
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static void sms_notification_callback(uint32_t sms_id);
+static void timing_add(timing_t *timing, int64_t start_us, bool success);
+static void print_timing(const char *name, const timing_t *timing, bool last);
+static bool modem_start(void);
+static bool activate_data_connection(void);
+static bool open_mqtt_connection(void);
+static void handle_sms(uint32_t sms_id);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static volatile uint32_t new_sms_id;		///< Set by modem task when +CMTI arrives, 0 when none
+static const char *broker = BENCH_DEFAULT_BROKER;
+static uint16_t broker_port = BENCH_DEFAULT_PORT;
+static timing_t start_timing;
+static timing_t activate_timing;
+static timing_t connect_timing;
+static timing_t publish_timing;
+static timing_t sms_timing;
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+static void sms_notification_callback(uint32_t sms_id)
+{
+	new_sms_id = sms_id;
+}
+
+static void timing_add(timing_t *timing, int64_t start_us, bool success)
+{
+	int64_t elapsed = host_time_get_us() - start_us;
+
+	if (!success)
+	{
+		timing->failures++;
+		return;
+	}
+
+	timing->count++;
+	timing->total_us += elapsed;
+	if (elapsed > timing->max_us)
+	{
+		timing->max_us = elapsed;
+	}
+}
+
+static void print_timing(const char *name, const timing_t *timing, bool last)
+{
+	(void)printf("\"%s\":{\"count\":%u,\"failures\":%u,\"avg_ms\":%.1f,\"max_ms\":%.1f}%s",
+			name, timing->count, timing->failures,
+			timing->count > 0UL ? (double)timing->total_us / (double)timing->count / 1000.0 : 0.0,
+			(double)timing->max_us / 1000.0,
+			last ? "" : ",");
+}
+
+/**
+ * Register on network and set parameters, as modem_network_register() and modem_set_parameters() in publisher.c
+ */
+static bool modem_start(void)
+{
+	bool registered = false;
+	char imei[MODEM_MAX_IMEI_LENGTH + 1] = "";
+	uint32_t attempt;
+
+	if (ModemHello(250UL) != MODEM_OK)
+	{
+		return false;
+	}
+
+	for (attempt = 0UL; attempt < 10UL && !registered; attempt++)
+	{
+		(void)ModemGetNetworkRegistrationStatus(&registered, 250UL);
+		if (!registered)
+		{
+			(void)usleep(1000000U);
+		}
+	}
+
+	return registered &&
+			ModemGetIMEI(imei, MODEM_MAX_IMEI_LENGTH + 1, 1000UL) == MODEM_OK &&
+			ModemSmsDeleteAllMessages(25000UL) == MODEM_OK &&
+			ModemSetManualDataRead(250UL) == MODEM_OK &&
+			ModemSetSmsPduMode(250UL) == MODEM_OK &&
+			ModemSetSmsReceiveMode(250UL) == MODEM_OK;
+}
+
+/**
+ * Bring up GPRS, as modem_activate_data_connection() in publisher.c
+ */
+static bool activate_data_connection(void)
+{
+	char ip_address[MODEM_MAX_IP_ADDRESS_LENGTH + 1] = "";
+
+	return ModemDeactivateDataConnection(40000UL) == MODEM_SHUT_OK &&
+			ModemConfigureDataConnection("internet", "", "", 250UL) == MODEM_OK &&
+			ModemActivateDataConnection(40000UL) == MODEM_OK &&
+			ModemGetOwnIpAddress(ip_address, MODEM_MAX_IP_ADDRESS_LENGTH + 1, 250UL) == MODEM_OK;
+}
+
+/**
+ * Open TCP connection and MQTT session, as open_mqtt_connection() in publisher.c
+ */
+static bool open_mqtt_connection(void)
+{
+	return ModemOpenTcpConnection(broker, broker_port, 8000UL) == MODEM_OK &&
+			MqttConnect("1234", NULL, NULL, BENCH_MQTT_KEEPALIVE_S, 20000UL) == MQTT_OK;
+}
+
+/**
+ * Read an SMS, decode it and send it back to the sender, then clear storage
+ *
+ * @param sms_id Storage index from +CMTI
+ */
+static void handle_sms(uint32_t sms_id)
+{
+	uint8_t pdu_ascii_hex[MODEM_SMS_MAX_PDU_LENGTH_ASCII_HEX + 1];
+	uint8_t pdu_binary[MODEM_SMS_MAX_PDU_LENGTH_BINARY];
+	char reply_hex[MODEM_SMS_MAX_PDU_LENGTH_ASCII_HEX + 1] = "";
+	char phone_number[24];
+	char message_text[MODEM_SMS_MAX_TEXT_LENGTH + 1];
+	char ascii_hex_byte[3] = "";
+	time_t receive_time;
+	size_t length = 0U;
+	size_t i;
+	int pdu_length;
+	int64_t start_us = host_time_get_us();
+	bool success = false;
+
+	if (ModemSmsReceiveMessage((uint8_t)sms_id, &length, pdu_ascii_hex, sizeof(pdu_ascii_hex), 1000UL) == MODEM_OK && length > 0U)
+	{
+		for (i = 0U; i < length / 2U; i++)
+		{
+			ascii_hex_byte[0] = (char)pdu_ascii_hex[i * 2U];
+			ascii_hex_byte[1] = (char)pdu_ascii_hex[i * 2U + 1U];
+			pdu_binary[i] = (uint8_t)util_htoi(ascii_hex_byte);
+		}
+
+		if (pdu_decode(pdu_binary, (int)(length / 2U), &receive_time, phone_number, (int)sizeof(phone_number),
+				message_text, (int)sizeof(message_text)) > 0)
+		{
+			(void)fprintf(stderr, "SMS from %s: %s\n", phone_number, message_text);
+			pdu_length = pdu_encode(NULL, phone_number, message_text, pdu_binary, (int)sizeof(pdu_binary));
+			for (i = 0U; pdu_length > 0 && i < (size_t)pdu_length; i++)
+			{
+				(void)sprintf(ascii_hex_byte, "%02x", pdu_binary[i]);
+				(void)util_safe_strcat(reply_hex, sizeof(reply_hex), ascii_hex_byte);
+			}
+			success = pdu_length > 0 && ModemSmsSendMessage(reply_hex, 60000UL) == MODEM_OK;
+		}
+	}
+	(void)ModemSmsDeleteAllMessages(25000UL);
+	timing_add(&sms_timing, start_us, success);
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+int main(int argc, char **argv)
+{
+	uint32_t publishes = BENCH_DEFAULT_PUBLISHES;
+	uint32_t period_ms = BENCH_DEFAULT_PERIOD_MS;
+	uint32_t i;
+	uint32_t written;
+	uint32_t read;
+	uint32_t publish_serial_bytes = 0UL;
+	char topic[20];
+	char payload[220];
+	int64_t start_us;
+	bool success;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "b:P:n:p:h")) != -1)
+	{
+		switch (opt)
+		{
+		case 'b':
+			broker = optarg;
+			break;
+
+		case 'P':
+			broker_port = (uint16_t)strtoul(optarg, NULL, 10);
+			break;
+
+		case 'n':
+			publishes = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+
+		case 'p':
+			period_ms = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+
+		default:
+			(void)fprintf(stderr, "usage: %s [-b broker] [-P port] [-n publishes] [-p period_ms]\n"
+					"modem port is BLUEBRIDGE_MODEM_PORT or " MODEM_INTERFACE_POSIX_DEFAULT_PORT
+					", set BLUEBRIDGE_MODEM_LOG to log modem traffic\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// same topic and payload shape as publisher.c
+	(void)snprintf(topic, sizeof(topic), "%08X/all", util_hash_djb2("869170031234567"));
+	(void)snprintf(payload, sizeof(payload), "20,2715,14.8,6.2,6.0,12345,12.3,3,275,17.4,1012,81,12.7,0,5025.1234N,00115.5678W,1");
+
+	// retry start up as publisher.c does
+	for (i = 0UL; i < BENCH_START_ATTEMPTS; i++)
+	{
+		start_us = host_time_get_us();
+		success = ModemInit() == MODEM_OK && modem_start();
+		timing_add(&start_timing, start_us, success);
+		if (success)
+		{
+			break;
+		}
+		ModemDelete();
+	}
+	if (!success)
+	{
+		(void)fprintf(stderr, "modem start failed\n");
+		return 1;
+	}
+	(void)ModemSetSmsNotificationCallback(sms_notification_callback);
+
+	for (i = 0UL; i < publishes; i++)
+	{
+		int64_t period_start_us = host_time_get_us();
+		int64_t wait_us;
+
+		if (!ModemGetPdpActivatedState())
+		{
+			start_us = host_time_get_us();
+			timing_add(&activate_timing, start_us, activate_data_connection());
+		}
+
+		if (ModemGetPdpActivatedState() && !ModemGetTcpConnectedState())
+		{
+			start_us = host_time_get_us();
+			timing_add(&connect_timing, start_us, open_mqtt_connection());
+		}
+
+		if (ModemGetTcpConnectedState())
+		{
+			uint32_t written_before;
+			uint32_t read_before;
+
+			modem_interface_posix_get_byte_counts(&written_before, &read_before);
+			start_us = host_time_get_us();
+			timing_add(&publish_timing, start_us, MqttPublish(topic, (const uint8_t *)payload, strlen(payload), false, 10000UL) == MQTT_OK);
+			modem_interface_posix_get_byte_counts(&written, &read);
+			publish_serial_bytes += (written - written_before) + (read - read_before);
+			(void)MqttHandleResponse(1000UL);
+		}
+		else
+		{
+			publish_timing.failures++;
+		}
+
+		if (new_sms_id != 0UL)
+		{
+			uint32_t sms_id = new_sms_id;
+
+			new_sms_id = 0UL;
+			handle_sms(sms_id);
+		}
+
+		wait_us = (int64_t)period_ms * 1000LL - (host_time_get_us() - period_start_us);
+		if (wait_us > 0LL)
+		{
+			(void)usleep((useconds_t)wait_us);
+		}
+	}
+
+	if (ModemGetTcpConnectedState())
+	{
+		(void)MqttDisconnect(5000UL);
+		(void)ModemCloseTcpConnection(5000UL);
+	}
+	modem_interface_posix_get_byte_counts(&written, &read);
+
+	(void)printf("{");
+	print_timing("start", &start_timing, false);
+	print_timing("activate", &activate_timing, false);
+	print_timing("connect", &connect_timing, false);
+	print_timing("publish", &publish_timing, false);
+	print_timing("sms", &sms_timing, false);
+	(void)printf("\"payload_bytes\":%u,\"publish_serial_bytes_avg\":%.1f,\"serial_written\":%u,\"serial_read\":%u}\n",
+			(unsigned int)strlen(payload),
+			publish_timing.count > 0UL ? (double)publish_serial_bytes / (double)publish_timing.count : 0.0,
+			written, read);
+
+	ModemDelete();
+
+	return 0;
+}
@@ -0,0 +1,497 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include "freertos/FreeRTOS.h"
+#include "host_time.h"
+#include "modem_interface.h"
+#include "modem_interface_posix.h"
+#include "util.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define MODEM_QUEUE_LENGTH				10U					///< Number of items in each queue, same as ESP32 version
+#define MODEM_SERIAL_LOG_BUFFER_SIZE	1024				///< Size in bytes of buffer used for modem receive logging
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Fixed size item queue to stand in for a FreeRTOS queue
+ */
+typedef struct
+{
+	pthread_mutex_t mutex;				///< Protects all fields
+	pthread_cond_t changed;				///< Signalled when an item is added or removed
+	uint8_t *items;						///< Storage for MODEM_QUEUE_LENGTH items
+	size_t item_size;					///< Size in bytes of each item
+	uint32_t head;						///< Index of next item to write
+	uint32_t count;						///< Number of items in queue
+} posix_queue_t;
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static void *modem_interface_task(void *parameters);
+static void get_deadline(struct timespec *deadline, uint32_t timeout);
+static void queue_init(posix_queue_t *queue, size_t item_size);
+static void queue_deinit(posix_queue_t *queue);
+static posix_queue_t *get_queue(modem_interface_queue_t modem_interface_queue);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static int serial_fd = -1;						///< File descriptor of modem serial port
+static pthread_t modem_thread;					///< Thread used by modem
+static bool modem_thread_running;				///< If modem_thread has been created
+static posix_queue_t command_queue;				///< Queue used by modem to receive commands from client
+static posix_queue_t response_queue;			///< Queue used by modem to send responses to client
+static pthread_mutex_t modem_mutex;				///< Mutex used by modem for thread safety
+static modem_task_t modem_task;					///< Pointer to function in modem that implements the task
+static uint32_t bytes_written;					///< Count of bytes written to modem
+static uint32_t bytes_read;						///< Count of bytes read from modem
+static bool log_serial;							///< If received serial data is logged, set from BLUEBRIDGE_MODEM_LOG
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/**
+ * Wrapper function that is called by the thread that is created in this interface and the task code in the modem that implements the task
+ *
+ * @param parameters Unused
+ * @return Unused
+ */
+static void *modem_interface_task(void *parameters)
+{
+	(void)parameters;
+
+	modem_task();
+
+	return NULL;
+}
+
+/**
+ * Convert a timeout in operating system ticks to an absolute deadline for the pthread timed functions
+ *
+ * @param deadline Pointer to the deadline to fill in
+ * @param timeout Timeout in ticks
+ */
+static void get_deadline(struct timespec *deadline, uint32_t timeout)
+{
+	uint64_t ns;
+
+	(void)clock_gettime(CLOCK_REALTIME, deadline);
+	ns = (uint64_t)deadline->tv_nsec + (uint64_t)timeout * (1000000000ULL / (uint64_t)configTICK_RATE_HZ);
+	deadline->tv_sec += (time_t)(ns / 1000000000ULL);
+	deadline->tv_nsec = (long)(ns % 1000000000ULL);
+}
+
+/**
+ * Create a queue
+ *
+ * @param queue The queue to initialize
+ * @param item_size Size in bytes of each item
+ */
+static void queue_init(posix_queue_t *queue, size_t item_size)
+{
+	(void)pthread_mutex_init(&queue->mutex, NULL);
+	(void)pthread_cond_init(&queue->changed, NULL);
+	queue->items = (uint8_t *)malloc(item_size * MODEM_QUEUE_LENGTH);
+	queue->item_size = item_size;
+	queue->head = 0UL;
+	queue->count = 0UL;
+}
+
+/**
+ * Destroy a queue created by queue_init()
+ *
+ * @param queue The queue to destroy
+ */
+static void queue_deinit(posix_queue_t *queue)
+{
+	(void)pthread_cond_destroy(&queue->changed);
+	(void)pthread_mutex_destroy(&queue->mutex);
+	free(queue->items);
+	queue->items = NULL;
+}
+
+/**
+ * Map a queue enum to the queue it identifies
+ *
+ * @param modem_interface_queue The queue identifier
+ * @return The queue or NULL if identifier not recognised
+ */
+static posix_queue_t *get_queue(modem_interface_queue_t modem_interface_queue)
+{
+	if (modem_interface_queue == MODEM_INTERFACE_COMMAND_QUEUE)
+	{
+		return &command_queue;
+	}
+	else if (modem_interface_queue == MODEM_INTERFACE_RESPONSE_QUEUE)
+	{
+		return &response_queue;
+	}
+
+	return NULL;
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+void modem_interface_log(const char *message)
+{
+	(void)fprintf(stderr, "%10.3f modem: %s\n", (double)host_time_get_us() / 1000000.0, message);
+}
+
+void modem_interface_os_init(size_t command_queue_packet_size, size_t response_queue_command_size, modem_task_t task)
+{
+	modem_task = task;
+	(void)pthread_mutex_init(&modem_mutex, NULL);
+	queue_init(&command_queue, command_queue_packet_size);
+	queue_init(&response_queue, response_queue_command_size);
+	modem_thread_running = (pthread_create(&modem_thread, NULL, modem_interface_task, NULL) == 0);
+}
+
+void modem_interface_os_deinit(void)
+{
+	if (modem_thread_running)
+	{
+		(void)pthread_cancel(modem_thread);
+		(void)pthread_join(modem_thread, NULL);
+		modem_thread_running = false;
+	}
+	(void)pthread_mutex_destroy(&modem_mutex);
+	queue_deinit(&command_queue);
+	queue_deinit(&response_queue);
+}
+
+void modem_interface_serial_init(void)
+{
+	const char *port_name = getenv("BLUEBRIDGE_MODEM_PORT");
+	struct termios tio;
+
+	if (port_name == NULL)
+	{
+		port_name = MODEM_INTERFACE_POSIX_DEFAULT_PORT;
+	}
+	log_serial = (getenv("BLUEBRIDGE_MODEM_LOG") != NULL);
+
+	modem_interface_serial_close();
+	serial_fd = open(port_name, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (serial_fd < 0)
+	{
+		(void)fprintf(stderr, "cannot open modem port %s: %s\n", port_name, strerror(errno));
+		return;
+	}
+
+	if (tcgetattr(serial_fd, &tio) == 0)
+	{
+		cfmakeraw(&tio);
+		(void)cfsetispeed(&tio, B115200);
+		(void)cfsetospeed(&tio, B115200);
+		(void)tcsetattr(serial_fd, TCSANOW, &tio);
+	}
+
+	bytes_written = 0UL;
+	bytes_read = 0UL;
+}
+
+void modem_interface_serial_close(void)
+{
+	if (serial_fd >= 0)
+	{
+		(void)close(serial_fd);
+		serial_fd = -1;
+	}
+}
+
+size_t modem_interface_serial_received_bytes_waiting(void)
+{
+	int size = 0;
+
+	if (serial_fd < 0 || ioctl(serial_fd, FIONREAD, &size) != 0 || size < 0)
+	{
+		return (size_t)0;
+	}
+
+	return (size_t)size;
+}
+
+size_t modem_interface_serial_read_data(size_t buffer_length, uint8_t *data)
+{
+	ssize_t size;
+
+	if (serial_fd < 0)
+	{
+		return (size_t)0;
+	}
+
+	size = read(serial_fd, data, buffer_length);
+	if (size <= 0)
+	{
+		return (size_t)0;
+	}
+	bytes_read += (uint32_t)size;
+
+	if (log_serial)
+	{
+		static uint8_t debug_buffer[MODEM_SERIAL_LOG_BUFFER_SIZE];
+		static size_t debug_buffer_length = 0;
+
+		if ((size_t)size + debug_buffer_length + 1 > sizeof(debug_buffer))
+		{
+			// overflow, give up
+			debug_buffer_length = 0;
+		}
+		else
+		{
+			(void)memcpy(debug_buffer + debug_buffer_length, data, (size_t)size);
+			debug_buffer_length += (size_t)size;
+			if (debug_buffer_length > 0 && debug_buffer[debug_buffer_length - 1] == '\n')
+			{
+				debug_buffer[debug_buffer_length] = '\0';
+				util_replace_char((char *)debug_buffer,'\r', 'r');
+				util_replace_char((char *)debug_buffer,'\n', 'n');
+				modem_interface_log((const char *)debug_buffer);
+				debug_buffer_length = 0;
+			}
+		}
+	}
+
+	return (size_t)size;
+}
+
+size_t modem_interface_serial_write_data(size_t length, const uint8_t *data)
+{
+	size_t written = (size_t)0;
+	ssize_t result;
+
+	if (serial_fd < 0)
+	{
+		return (size_t)0;
+	}
+
+	while (written < length)
+	{
+		result = write(serial_fd, data + written, length - written);
+		if (result < 0)
+		{
+			if (errno == EAGAIN)
+			{
+				(void)usleep(1000);
+				continue;
+			}
+			break;
+		}
+		written += (size_t)result;
+	}
+	bytes_written += (uint32_t)written;
+
+	return written;
+}
+
+void modem_interface_task_delay(uint32_t delay_ms)
+{
+	if (delay_ms < 1UL)
+	{
+		delay_ms = 1UL;
+	}
+
+	(void)usleep((useconds_t)(delay_ms * 1000UL));
+}
+
+uint32_t modem_interface_get_time_ms(void)
+{
+	return (uint32_t)(host_time_get_us() / 1000LL);
+}
+
+modem_interface_status_t modem_interface_queue_put(modem_interface_queue_t modem_interface_queue, const void *msg_ptr, uint32_t timeout)
+{
+	modem_interface_status_t modem_interface_status = MODEM_INTERFACE_OK;
+	posix_queue_t *queue = get_queue(modem_interface_queue);
+	struct timespec deadline;
+
+	if (queue == NULL)
+	{
+		return MODEM_INTERFACE_ERROR;
+	}
+
+	get_deadline(&deadline, timeout);
+	(void)pthread_mutex_lock(&queue->mutex);
+	while (queue->count == MODEM_QUEUE_LENGTH)
+	{
+		if (timeout == 0UL)
+		{
+			modem_interface_status = MODEM_INTERFACE_ERROR;
+			break;
+		}
+		if (timeout == MODEM_INTERFACE_WAIT_FOREVER)
+		{
+			(void)pthread_cond_wait(&queue->changed, &queue->mutex);
+		}
+		else if (pthread_cond_timedwait(&queue->changed, &queue->mutex, &deadline) == ETIMEDOUT)
+		{
+			modem_interface_status = MODEM_INTERFACE_TIMEOUT;
+			break;
+		}
+	}
+
+	if (modem_interface_status == MODEM_INTERFACE_OK)
+	{
+		(void)memcpy(queue->items + (size_t)queue->head * queue->item_size, msg_ptr, queue->item_size);
+		queue->head = (queue->head + 1UL) % MODEM_QUEUE_LENGTH;
+		queue->count++;
+		(void)pthread_cond_broadcast(&queue->changed);
+	}
+	(void)pthread_mutex_unlock(&queue->mutex);
+
+	return modem_interface_status;
+}
+
+modem_interface_status_t modem_interface_queue_get(modem_interface_queue_t modem_interface_queue, void *msg_ptr, uint32_t timeout)
+{
+	modem_interface_status_t modem_interface_status = MODEM_INTERFACE_OK;
+	posix_queue_t *queue = get_queue(modem_interface_queue);
+	struct timespec deadline;
+	uint32_t tail;
+
+	if (queue == NULL)
+	{
+		return MODEM_INTERFACE_ERROR;
+	}
+
+	get_deadline(&deadline, timeout);
+	(void)pthread_mutex_lock(&queue->mutex);
+	while (queue->count == 0UL)
+	{
+		if (timeout == 0UL)
+		{
+			modem_interface_status = MODEM_INTERFACE_ERROR;
+			break;
+		}
+		if (timeout == MODEM_INTERFACE_WAIT_FOREVER)
+		{
+			(void)pthread_cond_wait(&queue->changed, &queue->mutex);
+		}
+		else if (pthread_cond_timedwait(&queue->changed, &queue->mutex, &deadline) == ETIMEDOUT)
+		{
+			modem_interface_status = MODEM_INTERFACE_TIMEOUT;
+			break;
+		}
+	}
+
+	if (modem_interface_status == MODEM_INTERFACE_OK)
+	{
+		tail = (queue->head + MODEM_QUEUE_LENGTH - queue->count) % MODEM_QUEUE_LENGTH;
+		(void)memcpy(msg_ptr, queue->items + (size_t)tail * queue->item_size, queue->item_size);
+		queue->count--;
+		(void)pthread_cond_broadcast(&queue->changed);
+	}
+	(void)pthread_mutex_unlock(&queue->mutex);
+
+	return modem_interface_status;
+}
+
+modem_interface_status_t modem_interface_acquire_mutex(uint32_t timeout)
+{
+	struct timespec deadline;
+	int result;
+
+	if (timeout == 0UL)
+	{
+		result = pthread_mutex_trylock(&modem_mutex);
+	}
+	else if (timeout == MODEM_INTERFACE_WAIT_FOREVER)
+	{
+		result = pthread_mutex_lock(&modem_mutex);
+	}
+	else
+	{
+		get_deadline(&deadline, timeout);
+		result = pthread_mutex_timedlock(&modem_mutex, &deadline);
+	}
+
+	if (result == 0)
+	{
+		return MODEM_INTERFACE_OK;
+	}
+
+	return timeout != 0UL ? MODEM_INTERFACE_TIMEOUT : MODEM_INTERFACE_ERROR;
+}
+
+modem_interface_status_t modem_interface_release_mutex(void)
+{
+	if (pthread_mutex_unlock(&modem_mutex) != 0)
+	{
+		return MODEM_INTERFACE_ERROR;
+	}
+
+	return MODEM_INTERFACE_OK;
+}
+
+void *modem_interface_malloc(size_t length)
+{
+	return malloc(length);
+}
+
+void modem_interface_free(void *address)
+{
+	free(address);
+}
+
+void modem_interface_posix_get_byte_counts(uint32_t *written, uint32_t *read)
+{
+	*written = bytes_written;
+	*read = bytes_read;
+}
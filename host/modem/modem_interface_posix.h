@@ -0,0 +1,71 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef MODEM_INTERFACE_POSIX_H
+#define MODEM_INTERFACE_POSIX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdint.h>
+#include "modem_interface.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define MODEM_INTERFACE_POSIX_DEFAULT_PORT	"/tmp/bluebridge-modem"		///< Serial device used when BLUEBRIDGE_MODEM_PORT is not set, matches sim800_emulator default link
+
+/************
+*** TYPES ***
+************/
+
+/*************************
+*** EXTERNAL VARIABLES ***
+*************************/
+
+/***************************
+*** FUNCTIONS PROTOTYPES ***
+***************************/
+
+/**
+ * Get the number of bytes written to and read from the modem serial port since the port was opened
+ *
+ * @param written Pointer to variable to receive count of bytes written to the modem
+ * @param read Pointer to variable to receive count of bytes read from the modem
+ */
+void modem_interface_posix_get_byte_counts(uint32_t *written, uint32_t *read);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,441 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/*
+MQTT broker stand-in
+
+Minimal MQTT 3.1.1 server for use with sim800_emulator when a real broker is
+not wanted. Accepts any CONNECT, answers SUBSCRIBE, UNSUBSCRIBE, PINGREQ and
+QoS 1 PUBLISH, prints every PUBLISH received and forwards it to clients whose
+subscriptions match exactly or with a trailing # wildcard. Retained messages
+are not stored.
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+/**************
+*** DEFINES ***
+**************/
+
+#define BROKER_DEFAULT_PORT			1883U		///< Standard MQTT port
+#define BROKER_MAX_CLIENTS			8U			///< Simultaneous connections
+#define BROKER_MAX_SUBSCRIPTIONS	4U			///< Subscriptions per client
+#define BROKER_MAX_TOPIC			128U		///< Longest topic filter stored
+#define BROKER_BUFFER_SIZE			4096U		///< Receive buffer per client, largest packet accepted
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * A connected client
+ */
+typedef struct
+{
+	int fd;													///< Socket, -1 when slot is free
+	uint8_t buffer[BROKER_BUFFER_SIZE];						///< Bytes received not yet handled
+	size_t length;											///< Number of bytes in buffer
+	char subscriptions[BROKER_MAX_SUBSCRIPTIONS][BROKER_MAX_TOPIC + 1];	///< Topic filters, empty when unused
+} client_t;
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static void handle_client(client_t *client);
+static size_t handle_packet(client_t *client);
+static void send_packet(client_t *client, uint8_t type, const uint8_t *body, size_t length);
+static void forward_publish(const client_t *sender, const char *topic, const uint8_t *payload, size_t payload_length);
+static bool topic_matches(const char *filter, const char *topic);
+static void drop_client(client_t *client);
+static void handle_signal(int signal_number);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static client_t clients[BROKER_MAX_CLIENTS];
+static volatile sig_atomic_t stop_requested;
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+static void handle_client(client_t *client)
+{
+	ssize_t length;
+	size_t used;
+
+	length = recv(client->fd, client->buffer + client->length, sizeof(client->buffer) - client->length, 0);
+	if (length <= 0)
+	{
+		drop_client(client);
+		return;
+	}
+	client->length += (size_t)length;
+
+	while (client->fd >= 0 && (used = handle_packet(client)) > 0U)
+	{
+		(void)memmove(client->buffer, client->buffer + used, client->length - used);
+		client->length -= used;
+	}
+
+	if (client->fd >= 0 && client->length == sizeof(client->buffer))
+	{
+		(void)printf("client %d packet too big\n", client->fd);
+		drop_client(client);
+	}
+}
+
+/**
+ * Handle the first complete packet in a client's buffer
+ *
+ * @param client The client
+ * @return Number of bytes used or 0 if no complete packet yet
+ */
+static size_t handle_packet(client_t *client)
+{
+	const uint8_t *packet = client->buffer;
+	size_t remaining = 0U;
+	size_t multiplier = 1U;
+	size_t header = 1U;
+	const uint8_t *body;
+	uint8_t type;
+
+	if (client->length < 2U)
+	{
+		return 0U;
+	}
+	do
+	{
+		if (header >= client->length || header > 4U)
+		{
+			return 0U;
+		}
+		remaining += (size_t)(packet[header] & 0x7fU) * multiplier;
+		multiplier *= 128U;
+	} while ((packet[header++] & 0x80U) != 0U);
+
+	if (header + remaining > client->length)
+	{
+		return 0U;
+	}
+	body = packet + header;
+	type = packet[0] & 0xf0U;
+
+	switch (type)
+	{
+	case 0x10U:			// CONNECT
+	{
+		static const uint8_t connack[] = {0x00U, 0x00U};
+
+		(void)printf("client %d connect\n", client->fd);
+		send_packet(client, 0x20U, connack, sizeof(connack));
+		break;
+	}
+
+	case 0x30U:			// PUBLISH
+	{
+		char topic[BROKER_MAX_TOPIC + 1];
+		size_t topic_length = ((size_t)body[0] << 8) | body[1];
+		uint8_t qos = (packet[0] >> 1) & 0x03U;
+		size_t payload_start = 2U + topic_length + (qos > 0U ? 2U : 0U);
+
+		if (topic_length > BROKER_MAX_TOPIC || payload_start > remaining)
+		{
+			drop_client(client);
+			return 0U;
+		}
+		(void)memcpy(topic, body + 2, topic_length);
+		topic[topic_length] = '\0';
+		(void)printf("client %d publish %s %.*s\n", client->fd, topic, (int)(remaining - payload_start), (const char *)body + payload_start);
+		if (qos == 1U)
+		{
+			send_packet(client, 0x40U, body + 2U + topic_length, 2U);
+		}
+		forward_publish(client, topic, body + payload_start, remaining - payload_start);
+		break;
+	}
+
+	case 0x80U:			// SUBSCRIBE
+	{
+		uint8_t suback[3] = {body[0], body[1], 0x80U};
+		size_t topic_length = ((size_t)body[2] << 8) | body[3];
+		uint32_t i;
+
+		if (topic_length <= BROKER_MAX_TOPIC && 4U + topic_length <= remaining)
+		{
+			for (i = 0UL; i < BROKER_MAX_SUBSCRIPTIONS; i++)
+			{
+				if (client->subscriptions[i][0] == '\0')
+				{
+					(void)memcpy(client->subscriptions[i], body + 4, topic_length);
+					client->subscriptions[i][topic_length] = '\0';
+					(void)printf("client %d subscribe %s\n", client->fd, client->subscriptions[i]);
+					suback[2] = 0x00U;
+					break;
+				}
+			}
+		}
+		send_packet(client, 0x90U, suback, sizeof(suback));
+		break;
+	}
+
+	case 0xa0U:			// UNSUBSCRIBE
+	{
+		char topic[BROKER_MAX_TOPIC + 1];
+		size_t topic_length = ((size_t)body[2] << 8) | body[3];
+		uint32_t i;
+
+		if (topic_length <= BROKER_MAX_TOPIC && 4U + topic_length <= remaining)
+		{
+			(void)memcpy(topic, body + 4, topic_length);
+			topic[topic_length] = '\0';
+			for (i = 0UL; i < BROKER_MAX_SUBSCRIPTIONS; i++)
+			{
+				if (strcmp(client->subscriptions[i], topic) == 0)
+				{
+					client->subscriptions[i][0] = '\0';
+				}
+			}
+		}
+		send_packet(client, 0xb0U, body, 2U);
+		break;
+	}
+
+	case 0xc0U:			// PINGREQ
+		send_packet(client, 0xd0U, NULL, 0U);
+		break;
+
+	case 0xe0U:			// DISCONNECT
+		(void)printf("client %d disconnect\n", client->fd);
+		drop_client(client);
+		return 0U;
+
+	default:
+		break;
+	}
+	(void)fflush(stdout);
+
+	return header + remaining;
+}
+
+static void send_packet(client_t *client, uint8_t type, const uint8_t *body, size_t length)
+{
+	uint8_t packet[BROKER_BUFFER_SIZE + 5U];
+	size_t header = 1U;
+	size_t remaining = length;
+
+	packet[0] = type;
+	do
+	{
+		packet[header] = (uint8_t)(remaining % 128U);
+		remaining /= 128U;
+		if (remaining > 0U)
+		{
+			packet[header] |= 0x80U;
+		}
+		header++;
+	} while (remaining > 0U);
+
+	if (length > 0U)
+	{
+		(void)memcpy(packet + header, body, length);
+	}
+	(void)send(client->fd, packet, header + length, MSG_NOSIGNAL);
+}
+
+static void forward_publish(const client_t *sender, const char *topic, const uint8_t *payload, size_t payload_length)
+{
+	uint8_t body[BROKER_BUFFER_SIZE];
+	size_t topic_length = strlen(topic);
+	uint32_t i;
+	uint32_t j;
+
+	if (2U + topic_length + payload_length > sizeof(body))
+	{
+		return;
+	}
+	body[0] = (uint8_t)(topic_length >> 8);
+	body[1] = (uint8_t)topic_length;
+	(void)memcpy(body + 2, topic, topic_length);
+	(void)memcpy(body + 2U + topic_length, payload, payload_length);
+
+	for (i = 0UL; i < BROKER_MAX_CLIENTS; i++)
+	{
+		if (clients[i].fd < 0 || &clients[i] == sender)
+		{
+			continue;
+		}
+		for (j = 0UL; j < BROKER_MAX_SUBSCRIPTIONS; j++)
+		{
+			if (clients[i].subscriptions[j][0] != '\0' && topic_matches(clients[i].subscriptions[j], topic))
+			{
+				send_packet(&clients[i], 0x30U, body, 2U + topic_length + payload_length);
+				break;
+			}
+		}
+	}
+}
+
+static bool topic_matches(const char *filter, const char *topic)
+{
+	size_t length = strlen(filter);
+
+	if (length > 0U && filter[length - 1U] == '#')
+	{
+		return strncmp(filter, topic, length - 1U) == 0;
+	}
+
+	return strcmp(filter, topic) == 0;
+}
+
+static void drop_client(client_t *client)
+{
+	(void)close(client->fd);
+	client->fd = -1;
+	client->length = 0U;
+	(void)memset(client->subscriptions, 0, sizeof(client->subscriptions));
+}
+
+static void handle_signal(int signal_number)
+{
+	(void)signal_number;
+
+	stop_requested = 1;
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+int main(int argc, char **argv)
+{
+	struct sockaddr_in address;
+	int listen_fd;
+	int flag = 1;
+	uint16_t port = BROKER_DEFAULT_PORT;
+	uint32_t i;
+
+	if (argc > 1)
+	{
+		port = (uint16_t)strtoul(argv[1], NULL, 10);
+	}
+
+	for (i = 0UL; i < BROKER_MAX_CLIENTS; i++)
+	{
+		clients[i].fd = -1;
+	}
+
+	listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	(void)setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+	(void)memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+	if (listen_fd < 0 || bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listen_fd, 4) != 0)
+	{
+		perror("listen");
+		return 1;
+	}
+	(void)printf("MQTT broker stand-in on 127.0.0.1:%u\n", (unsigned int)port);
+	(void)fflush(stdout);
+
+	(void)signal(SIGINT, handle_signal);
+	(void)signal(SIGTERM, handle_signal);
+
+	while (!stop_requested)
+	{
+		struct pollfd fds[BROKER_MAX_CLIENTS + 1U];
+
+		fds[0].fd = listen_fd;
+		fds[0].events = POLLIN;
+		for (i = 0UL; i < BROKER_MAX_CLIENTS; i++)
+		{
+			fds[i + 1UL].fd = clients[i].fd;
+			fds[i + 1UL].events = POLLIN;
+		}
+
+		if (poll(fds, BROKER_MAX_CLIENTS + 1U, 100) <= 0)
+		{
+			continue;
+		}
+
+		if (fds[0].revents & POLLIN)
+		{
+			int fd = accept(listen_fd, NULL, NULL);
+
+			for (i = 0UL; i < BROKER_MAX_CLIENTS && fd >= 0; i++)
+			{
+				if (clients[i].fd < 0)
+				{
+					(void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+					clients[i].fd = fd;
+					break;
+				}
+			}
+			if (i == BROKER_MAX_CLIENTS && fd >= 0)
+			{
+				(void)close(fd);
+			}
+		}
+
+		for (i = 0UL; i < BROKER_MAX_CLIENTS; i++)
+		{
+			if (clients[i].fd >= 0 && (fds[i + 1UL].revents & (POLLIN | POLLHUP | POLLERR)))
+			{
+				handle_client(&clients[i]);
+			}
+		}
+	}
+
+	(void)close(listen_fd);
+
+	return 0;
+}
@@ -0,0 +1,1355 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/*
+SIM800L emulator
+
+Speaks the subset of the SIM800L AT command set used by main/modem.c on a
+pseudo terminal so that modem.c, mqtt.c and publisher logic can run on a PC
+against host/modem/modem_interface_posix.c. TCP connections opened with
+AT+CIPSTART are relayed to a real socket, normally mqtt_broker_stub or a local
+broker, and data is returned with the manual AT+CIPRXGET reads that modem.c
+uses. SMS messages are held in PDU mode and can be injected from stdin.
+
+Lines typed on stdin while running:
+	sms <number> <text>		store an incoming SMS and send +CMTI
+	close					drop the TCP connection and send CLOSED
+	deact					drop the data connection and send +PDP: DEACT
+	creg <n>				set registration status returned by AT+CREG?
+	csq <n>					set signal strength returned by AT+CSQ
+	stats					print statistics
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+/**************
+*** DEFINES ***
+**************/
+
+#define EMULATOR_DEFAULT_LINK		"/tmp/bluebridge-modem"		///< Symlink to the pty slave that the firmware opens
+#define EMULATOR_MAX_LINE			700U						///< Longest command line accepted
+#define EMULATOR_OUTPUT_SIZE		16384U						///< Size of buffer holding bytes waiting to go to the firmware
+#define EMULATOR_RX_SIZE			8192U						///< Size of buffer holding TCP bytes waiting for AT+CIPRXGET
+#define EMULATOR_MAX_RX_CHUNKS		64U							///< Maximum number of TCP receptions waiting for network latency
+#define EMULATOR_MAX_SMS			10U							///< SMS storage slots
+#define EMULATOR_MAX_PDU_HEX		400U						///< Longest SMS PDU in ascii hex
+#define EMULATOR_IMEI				"869170031234567"			///< IMEI returned by AT+GSN
+#define EMULATOR_OWN_IP				"10.64.12.34"				///< Address returned by AT+CIFSR
+#define EMULATOR_CTRL_Z				0x1aU						///< Ends SMS PDU entry
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * What the emulator does with bytes received from the firmware
+ */
+typedef enum
+{
+	input_command,					///< Collecting an AT command line
+	input_tcp_data,					///< Collecting data after AT+CIPSEND prompt
+	input_sms_pdu					///< Collecting SMS PDU after AT+CMGS prompt
+} input_mode_t;
+
+/**
+ * Command line options
+ */
+typedef struct
+{
+	const char *link_path;			///< Where to create the pty symlink
+	const char *relay_host;			///< If not NULL all TCP connections go here instead of the requested host
+	uint16_t relay_port;			///< Port used with relay_host
+	uint32_t at_latency_ms;			///< Delay before answering any command
+	uint32_t connect_latency_ms;	///< Delay between AT+CIPSTART OK and CONNECT OK
+	uint32_t send_latency_ms;		///< Delay between last data byte and SEND OK
+	uint32_t network_latency_ms;	///< Delay before TCP data from the server can be read
+	uint32_t baud;					///< Serial speed used to pace bytes to the firmware, 0 for unpaced
+	uint32_t error_percent;			///< Chance of answering a command with ERROR
+	uint32_t timeout_percent;		///< Chance of not answering a command at all
+	uint32_t close_percent;			///< Chance of dropping the TCP connection after SEND OK
+	uint32_t report_period_s;		///< Period of statistics reports, 0 for none
+} options_t;
+
+/**
+ * TCP data received from the server, held until network latency has elapsed
+ */
+typedef struct
+{
+	uint64_t ready_time_us;			///< When these bytes become visible to AT+CIPRXGET
+	uint32_t length;				///< Number of bytes
+} rx_chunk_t;
+
+/**
+ * Tracks MQTT packet boundaries in one direction of the TCP stream
+ */
+typedef struct
+{
+	uint8_t header[5];				///< Fixed header bytes collected so far
+	uint32_t header_length;			///< Number of valid bytes in header
+	uint32_t remaining;				///< Bytes of current packet still to come, 0 between packets
+	uint8_t type;					///< Type of current packet, upper 4 bits of first byte
+} mqtt_tracker_t;
+
+/**
+ * Measurements reported by print_statistics()
+ */
+typedef struct
+{
+	uint64_t serial_in;				///< Bytes received from firmware
+	uint64_t serial_out;			///< Bytes sent to firmware
+	uint64_t tcp_up;				///< TCP bytes relayed to server
+	uint64_t tcp_down;				///< TCP bytes relayed from server
+	uint32_t commands;				///< AT commands handled
+	uint32_t injected_errors;		///< Commands answered with ERROR by injection
+	uint32_t injected_timeouts;		///< Commands not answered by injection
+	uint32_t injected_closes;		///< Connections dropped by injection
+	uint32_t connects;				///< Completed MQTT connects (CONNACK read by firmware)
+	uint64_t connect_us_total;		///< Sum of AT+CIPSTART to CONNACK read times
+	uint64_t connect_us_max;		///< Longest AT+CIPSTART to CONNACK read time
+	uint32_t publishes;				///< Completed MQTT PUBLISH packets
+	uint64_t publish_us_total;		///< Sum of first AT+CIPSEND to last SEND OK times
+	uint64_t publish_us_max;		///< Longest first AT+CIPSEND to last SEND OK time
+	uint64_t publish_serial_bytes;	///< Serial bytes in both directions during publishes
+	uint32_t sms_sent;				///< SMS sent by firmware with AT+CMGS
+	uint32_t sms_received;			///< SMS injected and notified
+} statistics_t;
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static uint64_t get_time_us(void);
+static bool roll(uint32_t percent);
+static void output_bytes(const uint8_t *data, size_t length);
+static void output_text(const char *text);
+static void output_response(const char *text);
+static void output_urc(const char *text);
+static void flush_output(void);
+static void handle_input_byte(uint8_t byte);
+static void handle_command(char *line);
+static void handle_tcp_data_complete(void);
+static void handle_sms_pdu_complete(void);
+static void tcp_open(const char *host, uint16_t port);
+static void tcp_close(void);
+static void tcp_receive(void);
+static uint32_t rx_ready_length(void);
+static void rx_consume(uint32_t length, uint8_t *data);
+static void mqtt_track(mqtt_tracker_t *tracker, const uint8_t *data, size_t length, bool up);
+static void mqtt_packet_complete(uint8_t type, bool up);
+static void handle_control_line(char *line);
+static int encode_deliver_pdu(const char *number, const char *text, char *hex, size_t hex_size);
+static int decode_submit_pdu(const char *hex, char *number, size_t number_size, char *text, size_t text_size);
+static void print_statistics(void);
+static void handle_signal(int signal_number);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static options_t options = {EMULATOR_DEFAULT_LINK, NULL, 0U, 20UL, 500UL, 100UL, 50UL, 115200UL, 0UL, 0UL, 0UL, 0UL};
+static int pty_fd = -1;							///< Master side of the pty
+static int tcp_fd = -1;							///< Socket relayed to, -1 when not connected
+static bool tcp_connect_pending;				///< CONNECT OK is waiting for connect latency
+static uint64_t tcp_connect_ready_us;			///< When CONNECT OK is sent
+static bool pdp_active;							///< Data connection state
+static bool echo_on = true;						///< ATE setting
+static uint32_t registration_status = 1UL;		///< Value reported by AT+CREG?
+static uint32_t signal_strength = 20UL;			///< Value reported by AT+CSQ
+static input_mode_t input_mode = input_command;
+static char line[EMULATOR_MAX_LINE + 1];
+static size_t line_length;
+static uint8_t data_buffer[EMULATOR_MAX_LINE];	///< Data collected after a prompt
+static size_t data_expected;
+static size_t data_length;
+static uint8_t output[EMULATOR_OUTPUT_SIZE];	///< Bytes waiting to be written to the pty
+static size_t output_length;
+static uint64_t output_not_before_us;			///< Latency hold on output
+static uint64_t output_credit_time_us;			///< Time at which baud pacing was last calculated
+static uint8_t rx_buffer[EMULATOR_RX_SIZE];		///< TCP data from server not yet read by firmware
+static uint32_t rx_length;
+static rx_chunk_t rx_chunks[EMULATOR_MAX_RX_CHUNKS];
+static uint32_t rx_chunk_count;
+static bool rx_urc_pending;						///< +CIPRXGET: 1 to be sent when data becomes ready
+static bool send_ok_pending;					///< SEND OK is waiting for send latency
+static bool closed_urc_pending;					///< Server closed the connection, CLOSED to be sent after any SEND OK
+static uint64_t send_ok_ready_us;
+static char sms_store[EMULATOR_MAX_SMS][EMULATOR_MAX_PDU_HEX + 1];
+static mqtt_tracker_t up_tracker;
+static mqtt_tracker_t down_tracker;
+static uint64_t cipstart_time_us;				///< When the current connection was requested
+static uint64_t cipsend_time_us;				///< When the AT+CIPSEND carrying current upstream data arrived
+static uint64_t publish_start_us;				///< When the AT+CIPSEND carrying the first byte of the current PUBLISH arrived
+static uint64_t publish_start_serial;			///< Serial byte count at publish_start_us
+static bool publish_in_progress;				///< A PUBLISH packet has started but SEND OK for its last byte not sent yet
+static bool publish_wait_send_ok;				///< The PUBLISH is complete and timing stops at next SEND OK
+static bool connack_wait;						///< Waiting for the firmware to read a CONNACK
+static statistics_t statistics;
+static volatile sig_atomic_t stop_requested;
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+static uint64_t get_time_us(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+/**
+ * Decide if an injected fault happens
+ *
+ * @param percent Chance in percent
+ * @return true if the fault should be injected
+ */
+static bool roll(uint32_t percent)
+{
+	return percent > 0UL && (uint32_t)(rand() % 100) < percent;
+}
+
+static void output_bytes(const uint8_t *data, size_t length)
+{
+	if (output_length + length > sizeof(output))
+	{
+		(void)fprintf(stderr, "emulator: output buffer overflow, %zu bytes lost\n", length);
+		return;
+	}
+
+	(void)memcpy(output + output_length, data, length);
+	output_length += length;
+}
+
+static void output_text(const char *text)
+{
+	output_bytes((const uint8_t *)text, strlen(text));
+}
+
+/**
+ * Queue a command response, held back by the configured AT latency
+ *
+ * @param text Response text including any \r\n framing
+ */
+static void output_response(const char *text)
+{
+	uint64_t not_before = get_time_us() + (uint64_t)options.at_latency_ms * 1000ULL;
+
+	if (not_before > output_not_before_us)
+	{
+		output_not_before_us = not_before;
+	}
+	output_text(text);
+}
+
+/**
+ * Queue an unsolicited result code. These are framed like the modem does it, \r\n before and after.
+ *
+ * @param text URC text without framing
+ */
+static void output_urc(const char *text)
+{
+	output_text("\r\n");
+	output_text(text);
+	output_text("\r\n");
+}
+
+/**
+ * Write as much waiting output as latency and baud rate pacing allow
+ */
+static void flush_output(void)
+{
+	uint64_t now = get_time_us();
+	size_t allowed = output_length;
+	ssize_t written;
+
+	if (output_length == 0U)
+	{
+		output_credit_time_us = now;
+		return;
+	}
+
+	if (now < output_not_before_us)
+	{
+		output_credit_time_us = now;
+		return;
+	}
+
+	if (options.baud > 0UL)
+	{
+		// 10 bits per byte on the wire
+		allowed = (size_t)((now - output_credit_time_us) * (uint64_t)options.baud / 10000000ULL);
+		if (allowed == 0U)
+		{
+			return;
+		}
+		if (allowed > output_length)
+		{
+			allowed = output_length;
+		}
+	}
+
+	written = write(pty_fd, output, allowed);
+	if (written > 0)
+	{
+		(void)memmove(output, output + written, output_length - (size_t)written);
+		output_length -= (size_t)written;
+		statistics.serial_out += (uint64_t)written;
+		output_credit_time_us = now;
+	}
+}
+
+static void handle_input_byte(uint8_t byte)
+{
+	statistics.serial_in++;
+
+	switch (input_mode)
+	{
+	case input_command:
+		if (echo_on)
+		{
+			output_bytes(&byte, 1U);
+		}
+		if (byte == '\r')
+		{
+			line[line_length] = '\0';
+			if (line_length > 0U)
+			{
+				handle_command(line);
+			}
+			line_length = 0U;
+		}
+		else if (byte != '\n' && line_length < EMULATOR_MAX_LINE)
+		{
+			line[line_length++] = (char)byte;
+		}
+		break;
+
+	case input_tcp_data:
+		output_bytes(&byte, 1U);
+		data_buffer[data_length++] = byte;
+		if (data_length == data_expected)
+		{
+			input_mode = input_command;
+			handle_tcp_data_complete();
+		}
+		break;
+
+	case input_sms_pdu:
+		output_bytes(&byte, 1U);
+		if (byte == EMULATOR_CTRL_Z)
+		{
+			data_buffer[data_length] = '\0';
+			input_mode = input_command;
+			handle_sms_pdu_complete();
+		}
+		else if (data_length < sizeof(data_buffer) - 1U)
+		{
+			data_buffer[data_length++] = byte;
+		}
+		break;
+	}
+}
+
+static void handle_command(char *command)
+{
+	char response[EMULATOR_RX_SIZE + 64U];
+	char host[100];
+	unsigned int port;
+	unsigned int n;
+	unsigned int i;
+
+	statistics.commands++;
+
+	if (roll(options.timeout_percent))
+	{
+		statistics.injected_timeouts++;
+		return;
+	}
+	if (roll(options.error_percent))
+	{
+		statistics.injected_errors++;
+		output_response("\r\nERROR\r\n");
+		return;
+	}
+
+	for (i = 0U; command[i] != '\0' && command[i] != '=' && command[i] != '?'; i++)
+	{
+		command[i] = (char)toupper((unsigned char)command[i]);
+	}
+
+	if (strcmp(command, "AT") == 0 || strcmp(command, "AT+CMGF=0") == 0 || strncmp(command, "AT+CNMI=", 8) == 0 ||
+			strcmp(command, "AT+CIPRXGET=1") == 0 || strncmp(command, "AT+CSTT=", 8) == 0)
+	{
+		output_response("\r\nOK\r\n");
+	}
+	else if (strcmp(command, "ATE0") == 0 || strcmp(command, "ATE1") == 0)
+	{
+		echo_on = command[3] == '1';
+		output_response("\r\nOK\r\n");
+	}
+	else if (strcmp(command, "AT+CFUN=1,1") == 0)
+	{
+		tcp_close();
+		pdp_active = false;
+		echo_on = true;
+		output_response("\r\nOK\r\n");
+	}
+	else if (strcmp(command, "AT+CSQ") == 0)
+	{
+		(void)snprintf(response, sizeof(response), "\r\n+CSQ: %u,0\r\n\r\nOK\r\n", signal_strength);
+		output_response(response);
+	}
+	else if (strcmp(command, "AT+CREG?") == 0)
+	{
+		(void)snprintf(response, sizeof(response), "\r\n+CREG: 0,%u\r\n\r\nOK\r\n", registration_status);
+		output_response(response);
+	}
+	else if (strcmp(command, "AT+COPS?") == 0)
+	{
+		output_response("\r\n+COPS: 0,0,\"EMULATOR\"\r\n\r\nOK\r\n");
+	}
+	else if (strcmp(command, "AT+GSN") == 0)
+	{
+		output_response("\r\n" EMULATOR_IMEI "\r\n\r\nOK\r\n");
+	}
+	else if (strcmp(command, "AT+CIICR") == 0)
+	{
+		if (registration_status == 1UL || registration_status == 5UL)
+		{
+			pdp_active = true;
+			output_response("\r\nOK\r\n");
+		}
+		else
+		{
+			output_response("\r\nERROR\r\n");
+		}
+	}
+	else if (strcmp(command, "AT+CIFSR") == 0)
+	{
+		output_response(pdp_active ? "\r\n" EMULATOR_OWN_IP "\r\n" : "\r\nERROR\r\n");
+	}
+	else if (strcmp(command, "AT+CIPSHUT") == 0)
+	{
+		tcp_close();
+		pdp_active = false;
+		output_response("\r\nSHUT OK\r\n");
+	}
+	else if (strcmp(command, "AT+CIPCLOSE") == 0)
+	{
+		if (tcp_fd >= 0 || tcp_connect_pending)
+		{
+			tcp_close();
+			output_response("\r\nCLOSE OK\r\n");
+		}
+		else
+		{
+			output_response("\r\nERROR\r\n");
+		}
+	}
+	else if (strcmp(command, "AT+CPOWD=1") == 0)
+	{
+		tcp_close();
+		pdp_active = false;
+		output_response("\r\nNORMAL POWER DOWN\r\n");
+	}
+	else if (sscanf(command, "AT+CIPSTART=\"TCP\",\"%99[^\"]\",\"%u\"", host, &port) == 2 ||
+			sscanf(command, "AT+CIPSTART=\"TCP\",\"%99[^\"]\",%u", host, &port) == 2)
+	{
+		if (!pdp_active || tcp_fd >= 0 || tcp_connect_pending)
+		{
+			output_response("\r\nERROR\r\n");
+		}
+		else
+		{
+			output_response("\r\nOK\r\n");
+			cipstart_time_us = get_time_us();
+			tcp_open(host, (uint16_t)port);
+		}
+	}
+	else if (sscanf(command, "AT+CIPSEND=%u", &n) == 1)
+	{
+		if (tcp_fd < 0 || n == 0U || n > sizeof(data_buffer))
+		{
+			output_response("\r\nERROR\r\n");
+		}
+		else
+		{
+			output_response("\r\n> ");
+			input_mode = input_tcp_data;
+			data_expected = (size_t)n;
+			data_length = 0U;
+			cipsend_time_us = get_time_us();
+		}
+	}
+	else if (strcmp(command, "AT+CIPRXGET=4") == 0)
+	{
+		(void)snprintf(response, sizeof(response), "\r\n+CIPRXGET: 4,%u\r\n\r\nOK\r\n", rx_ready_length());
+		output_response(response);
+	}
+	else if (sscanf(command, "AT+CIPRXGET=2,%u", &n) == 1)
+	{
+		uint8_t data[EMULATOR_RX_SIZE];
+		uint32_t available = rx_ready_length();
+		size_t length;
+
+		if (n > available)
+		{
+			n = available;
+		}
+		rx_consume(n, data);
+		// the data may be binary so the response is built with output_bytes() rather than output_response()
+		output_response("");
+		length = (size_t)snprintf(response, sizeof(response), "\r\n+CIPRXGET: 2,%u,%u\r\n", n, rx_ready_length());
+		(void)memcpy(response + length, data, n);
+		length += n;
+		(void)memcpy(response + length, "\r\nOK\r\n", 6U);
+		output_bytes((const uint8_t *)response, length + 6U);
+	}
+	else if (sscanf(command, "AT+CMGR=%u", &n) == 1)
+	{
+		if (n >= 1U && n <= EMULATOR_MAX_SMS && sms_store[n - 1U][0] != '\0')
+		{
+			(void)snprintf(response, sizeof(response), "\r\n+CMGR: 0,,%u\r\n%s\r\n\r\nOK\r\n",
+					(unsigned int)(strlen(sms_store[n - 1U]) / 2U - 1U), sms_store[n - 1U]);
+			output_response(response);
+		}
+		else
+		{
+			output_response("\r\nOK\r\n");
+		}
+	}
+	else if (strcmp(command, "AT+CMGD=1,4") == 0)
+	{
+		for (i = 0U; i < EMULATOR_MAX_SMS; i++)
+		{
+			sms_store[i][0] = '\0';
+		}
+		output_response("\r\nOK\r\n");
+	}
+	else if (sscanf(command, "AT+CMGS=%u", &n) == 1)
+	{
+		output_response("\r\n> ");
+		input_mode = input_sms_pdu;
+		data_length = 0U;
+	}
+	else
+	{
+		(void)fprintf(stderr, "emulator: unsupported command %s\n", command);
+		output_response("\r\nERROR\r\n");
+	}
+}
+
+static void handle_tcp_data_complete(void)
+{
+	ssize_t sent;
+
+	mqtt_track(&up_tracker, data_buffer, data_length, true);
+
+	sent = send(tcp_fd, data_buffer, data_length, MSG_NOSIGNAL);
+	if (sent != (ssize_t)data_length)
+	{
+		tcp_close();
+		output_response("\r\nCLOSED\r\n");
+		return;
+	}
+	statistics.tcp_up += (uint64_t)sent;
+
+	send_ok_pending = true;
+	send_ok_ready_us = get_time_us() + (uint64_t)options.send_latency_ms * 1000ULL;
+}
+
+static void handle_sms_pdu_complete(void)
+{
+	char number[32];
+	char text[200];
+	static unsigned int message_reference;
+
+	if (decode_submit_pdu((const char *)data_buffer, number, sizeof(number), text, sizeof(text)) >= 0)
+	{
+		(void)printf("SMS to %s: %s\n", number, text);
+	}
+	else
+	{
+		(void)printf("SMS with undecodable PDU %s\n", (const char *)data_buffer);
+	}
+	(void)fflush(stdout);
+	statistics.sms_sent++;
+	message_reference = (message_reference + 1U) % 256U;
+
+	{
+		char response[40];
+
+		(void)snprintf(response, sizeof(response), "\r\n+CMGS: %u\r\n\r\nOK\r\n", message_reference);
+		output_response(response);
+	}
+}
+
+static void tcp_open(const char *host, uint16_t port)
+{
+	struct addrinfo hints;
+	struct addrinfo *result;
+	char port_text[8];
+	int flag = 1;
+
+	if (options.relay_host != NULL)
+	{
+		host = options.relay_host;
+		port = options.relay_port;
+	}
+
+	(void)memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	(void)snprintf(port_text, sizeof(port_text), "%u", (unsigned int)port);
+
+	if (getaddrinfo(host, port_text, &hints, &result) != 0)
+	{
+		output_urc("CONNECT FAIL");
+		return;
+	}
+
+	tcp_fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+	if (tcp_fd >= 0 && connect(tcp_fd, result->ai_addr, result->ai_addrlen) != 0)
+	{
+		(void)close(tcp_fd);
+		tcp_fd = -1;
+	}
+	freeaddrinfo(result);
+
+	if (tcp_fd < 0)
+	{
+		output_urc("CONNECT FAIL");
+		return;
+	}
+
+	(void)setsockopt(tcp_fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+	(void)memset(&up_tracker, 0, sizeof(up_tracker));
+	(void)memset(&down_tracker, 0, sizeof(down_tracker));
+	rx_length = 0UL;
+	rx_chunk_count = 0UL;
+	publish_in_progress = false;
+	publish_wait_send_ok = false;
+	connack_wait = false;
+	tcp_connect_pending = true;
+	tcp_connect_ready_us = get_time_us() + (uint64_t)options.connect_latency_ms * 1000ULL;
+}
+
+static void tcp_close(void)
+{
+	if (tcp_fd >= 0)
+	{
+		(void)close(tcp_fd);
+		tcp_fd = -1;
+	}
+	tcp_connect_pending = false;
+	send_ok_pending = false;
+	closed_urc_pending = false;
+	rx_urc_pending = false;
+	rx_length = 0UL;
+	rx_chunk_count = 0UL;
+}
+
+static void tcp_receive(void)
+{
+	ssize_t length;
+
+	if (rx_length >= sizeof(rx_buffer) || rx_chunk_count == EMULATOR_MAX_RX_CHUNKS)
+	{
+		// firmware not reading, leave data in the socket
+		return;
+	}
+
+	length = recv(tcp_fd, rx_buffer + rx_length, sizeof(rx_buffer) - rx_length, 0);
+	if (length <= 0)
+	{
+		// any SEND OK still due goes out before CLOSED as on the real modem
+		(void)close(tcp_fd);
+		tcp_fd = -1;
+		closed_urc_pending = true;
+		return;
+	}
+
+	statistics.tcp_down += (uint64_t)length;
+	rx_length += (uint32_t)length;
+	rx_chunks[rx_chunk_count].ready_time_us = get_time_us() + (uint64_t)options.network_latency_ms * 1000ULL;
+	rx_chunks[rx_chunk_count].length = (uint32_t)length;
+	rx_chunk_count++;
+	rx_urc_pending = true;
+}
+
+/**
+ * Get number of received TCP bytes whose network latency has elapsed
+ *
+ * @return Bytes available to AT+CIPRXGET
+ */
+static uint32_t rx_ready_length(void)
+{
+	uint64_t now = get_time_us();
+	uint32_t length = 0UL;
+	uint32_t i;
+
+	for (i = 0UL; i < rx_chunk_count && rx_chunks[i].ready_time_us <= now; i++)
+	{
+		length += rx_chunks[i].length;
+	}
+
+	return length;
+}
+
+static void rx_consume(uint32_t length, uint8_t *data)
+{
+	uint32_t remaining = length;
+
+	(void)memcpy(data, rx_buffer, length);
+	(void)memmove(rx_buffer, rx_buffer + length, rx_length - length);
+	rx_length -= length;
+
+	while (remaining > 0UL && rx_chunk_count > 0UL)
+	{
+		if (rx_chunks[0].length <= remaining)
+		{
+			remaining -= rx_chunks[0].length;
+			(void)memmove(&rx_chunks[0], &rx_chunks[1], sizeof(rx_chunk_t) * (rx_chunk_count - 1UL));
+			rx_chunk_count--;
+		}
+		else
+		{
+			rx_chunks[0].length -= remaining;
+			remaining = 0UL;
+		}
+	}
+
+	mqtt_track(&down_tracker, data, length, false);
+}
+
+/**
+ * Follow MQTT fixed headers through a TCP stream so that connects and publishes can be timed
+ *
+ * @param tracker State for this direction
+ * @param data Bytes of the stream
+ * @param length Number of bytes
+ * @param up true for firmware to server direction
+ */
+static void mqtt_track(mqtt_tracker_t *tracker, const uint8_t *data, size_t length, bool up)
+{
+	size_t i = 0U;
+
+	while (i < length)
+	{
+		if (tracker->remaining > 0UL)
+		{
+			size_t take = length - i;
+
+			if (take > tracker->remaining)
+			{
+				take = tracker->remaining;
+			}
+			tracker->remaining -= (uint32_t)take;
+			i += take;
+			if (tracker->remaining == 0UL)
+			{
+				mqtt_packet_complete(tracker->type, up);
+			}
+			continue;
+		}
+
+		tracker->header[tracker->header_length++] = data[i++];
+		if (tracker->header_length == 1UL)
+		{
+			tracker->type = tracker->header[0] & 0xf0U;
+			if (up && tracker->type == 0x30U && !publish_in_progress)
+			{
+				publish_in_progress = true;
+				publish_start_us = cipsend_time_us;
+				publish_start_serial = statistics.serial_in + statistics.serial_out;
+			}
+		}
+		else if ((tracker->header[tracker->header_length - 1UL] & 0x80U) == 0U || tracker->header_length == 5UL)
+		{
+			uint32_t multiplier = 1UL;
+			uint32_t j;
+
+			tracker->remaining = 0UL;
+			for (j = 1UL; j < tracker->header_length; j++)
+			{
+				tracker->remaining += (uint32_t)(tracker->header[j] & 0x7fU) * multiplier;
+				multiplier *= 128UL;
+			}
+			tracker->header_length = 0UL;
+			if (tracker->remaining == 0UL)
+			{
+				mqtt_packet_complete(tracker->type, up);
+			}
+		}
+	}
+}
+
+static void mqtt_packet_complete(uint8_t type, bool up)
+{
+	if (up && type == 0x10U)
+	{
+		connack_wait = true;
+	}
+	else if (up && type == 0x30U)
+	{
+		publish_wait_send_ok = true;
+	}
+	else if (!up && type == 0x20U && connack_wait)
+	{
+		uint64_t elapsed = get_time_us() - cipstart_time_us;
+
+		connack_wait = false;
+		statistics.connects++;
+		statistics.connect_us_total += elapsed;
+		if (elapsed > statistics.connect_us_max)
+		{
+			statistics.connect_us_max = elapsed;
+		}
+	}
+}
+
+static void handle_control_line(char *control_line)
+{
+	char number[32];
+	char text[200];
+	char hex[EMULATOR_MAX_PDU_HEX + 1];
+	unsigned int value;
+	unsigned int i;
+
+	if (sscanf(control_line, "sms %31s %199[^\n]", number, text) == 2)
+	{
+		for (i = 0U; i < EMULATOR_MAX_SMS && sms_store[i][0] != '\0'; i++)
+		{
+		}
+		if (i == EMULATOR_MAX_SMS)
+		{
+			(void)printf("SMS storage full\n");
+		}
+		else if (encode_deliver_pdu(number, text, hex, sizeof(hex)) < 0)
+		{
+			(void)printf("SMS cannot be encoded\n");
+		}
+		else
+		{
+			char urc[32];
+
+			(void)strcpy(sms_store[i], hex);
+			(void)snprintf(urc, sizeof(urc), "+CMTI: \"SM\",%u", i + 1U);
+			output_urc(urc);
+			statistics.sms_received++;
+		}
+	}
+	else if (strncmp(control_line, "close", 5) == 0)
+	{
+		if (tcp_fd >= 0)
+		{
+			tcp_close();
+			output_urc("CLOSED");
+		}
+	}
+	else if (strncmp(control_line, "deact", 5) == 0)
+	{
+		tcp_close();
+		pdp_active = false;
+		output_urc("+PDP: DEACT");
+	}
+	else if (sscanf(control_line, "creg %u", &value) == 1)
+	{
+		registration_status = value;
+	}
+	else if (sscanf(control_line, "csq %u", &value) == 1)
+	{
+		signal_strength = value;
+	}
+	else if (strncmp(control_line, "stats", 5) == 0)
+	{
+		print_statistics();
+	}
+	else
+	{
+		(void)printf("commands: sms <number> <text> | close | deact | creg <n> | csq <n> | stats\n");
+	}
+	(void)fflush(stdout);
+}
+
+/**
+ * Make the ascii hex of an SMS-DELIVER PDU with no SMSC, as the SIM800L returns from AT+CMGR in PDU mode
+ *
+ * @param number Sender number, digits with optional leading +
+ * @param text 7 bit text
+ * @param hex Buffer for the ascii hex
+ * @param hex_size Size of hex
+ * @return Length of hex or -1 if it does not fit
+ */
+static int encode_deliver_pdu(const char *number, const char *text, char *hex, size_t hex_size)
+{
+	uint8_t pdu[200];
+	size_t length = 0U;
+	size_t digits;
+	size_t text_length = strlen(text);
+	size_t i;
+	uint32_t bits = 0UL;
+	uint32_t bit_count = 0UL;
+	time_t now = time(NULL);
+	struct tm *utc = gmtime(&now);
+
+	if (*number == '+')
+	{
+		number++;
+	}
+	digits = strlen(number);
+	if (digits > 20U || text_length > 160U)
+	{
+		return -1;
+	}
+
+	pdu[length++] = 0x00U;						// no SMSC
+	pdu[length++] = 0x04U;						// SMS-DELIVER
+	pdu[length++] = (uint8_t)digits;
+	pdu[length++] = 0x91U;						// international
+	for (i = 0U; i < digits; i += 2U)
+	{
+		uint8_t low = (uint8_t)(number[i] - '0');
+		uint8_t high = (i + 1U < digits) ? (uint8_t)(number[i + 1U] - '0') : 0x0fU;
+
+		pdu[length++] = (uint8_t)((high << 4) | low);
+	}
+	pdu[length++] = 0x00U;						// PID
+	pdu[length++] = 0x00U;						// DCS, 7 bit
+	{
+		int fields[7] = {utc->tm_year % 100, utc->tm_mon + 1, utc->tm_mday, utc->tm_hour, utc->tm_min, utc->tm_sec, 0};
+
+		for (i = 0U; i < 7U; i++)
+		{
+			pdu[length++] = (uint8_t)(((fields[i] % 10) << 4) | (fields[i] / 10));
+		}
+	}
+	pdu[length++] = (uint8_t)text_length;
+	for (i = 0U; i < text_length; i++)
+	{
+		bits |= ((uint32_t)text[i] & 0x7fUL) << bit_count;
+		bit_count += 7UL;
+		while (bit_count >= 8UL)
+		{
+			pdu[length++] = (uint8_t)bits;
+			bits >>= 8;
+			bit_count -= 8UL;
+		}
+	}
+	if (bit_count > 0UL)
+	{
+		pdu[length++] = (uint8_t)bits;
+	}
+
+	if (length * 2U + 1U > hex_size)
+	{
+		return -1;
+	}
+	for (i = 0U; i < length; i++)
+	{
+		(void)sprintf(hex + i * 2U, "%02X", pdu[i]);
+	}
+
+	return (int)(length * 2U);
+}
+
+/**
+ * Decode the ascii hex SMS-SUBMIT PDU that the firmware sends with AT+CMGS
+ *
+ * @param hex The PDU
+ * @param number Buffer for destination number
+ * @param number_size Size of number
+ * @param text Buffer for message text
+ * @param text_size Size of text
+ * @return Text length or -1 if PDU not understood
+ */
+static int decode_submit_pdu(const char *hex, char *number, size_t number_size, char *text, size_t text_size)
+{
+	uint8_t pdu[200];
+	size_t length = strlen(hex) / 2U;
+	size_t pos;
+	size_t digits;
+	size_t text_length;
+	size_t i;
+	uint32_t bits = 0UL;
+	uint32_t bit_count = 0UL;
+	unsigned int byte;
+
+	if (length > sizeof(pdu))
+	{
+		return -1;
+	}
+	for (i = 0U; i < length; i++)
+	{
+		if (sscanf(hex + i * 2U, "%2x", &byte) != 1)
+		{
+			return -1;
+		}
+		pdu[i] = (uint8_t)byte;
+	}
+
+	pos = 1U + (size_t)pdu[0];					// skip SMSC
+	if (pos + 4U > length || (pdu[pos] & 0x03U) != 0x01U)
+	{
+		return -1;
+	}
+	pos += 2U;									// type and message reference
+	digits = pdu[pos];
+	pos += 2U;									// length and type of address
+	if (digits + 1U > number_size || pos + (digits + 1U) / 2U + 4U > length)
+	{
+		return -1;
+	}
+	for (i = 0U; i < digits; i++)
+	{
+		number[i] = (char)('0' + ((i % 2U) == 0U ? (pdu[pos + i / 2U] & 0x0fU) : (pdu[pos + i / 2U] >> 4)));
+	}
+	number[digits] = '\0';
+	pos += (digits + 1U) / 2U;
+	pos += 2U;									// PID and DCS
+	if ((pdu[1U + (size_t)pdu[0]] & 0x18U) == 0x10U)	// relative validity period present
+	{
+		pos++;
+	}
+	if (pos >= length)
+	{
+		return -1;
+	}
+	text_length = pdu[pos++];
+	if (text_length + 1U > text_size)
+	{
+		return -1;
+	}
+	for (i = 0U; i < text_length; i++)
+	{
+		while (bit_count < 7UL && pos < length)
+		{
+			bits |= (uint32_t)pdu[pos++] << bit_count;
+			bit_count += 8UL;
+		}
+		text[i] = (char)(bits & 0x7fUL);
+		bits >>= 7;
+		bit_count -= 7UL;
+	}
+	text[text_length] = '\0';
+
+	return (int)text_length;
+}
+
+static void print_statistics(void)
+{
+	(void)printf("{\"serial_in\":%llu,\"serial_out\":%llu,\"tcp_up\":%llu,\"tcp_down\":%llu,\"commands\":%u,"
+			"\"injected_errors\":%u,\"injected_timeouts\":%u,\"injected_closes\":%u,"
+			"\"connects\":%u,\"connect_ms_avg\":%.1f,\"connect_ms_max\":%.1f,"
+			"\"publishes\":%u,\"publish_ms_avg\":%.1f,\"publish_ms_max\":%.1f,\"publish_serial_bytes_avg\":%.1f,"
+			"\"sms_sent\":%u,\"sms_received\":%u}\n",
+			(unsigned long long)statistics.serial_in, (unsigned long long)statistics.serial_out,
+			(unsigned long long)statistics.tcp_up, (unsigned long long)statistics.tcp_down,
+			statistics.commands, statistics.injected_errors, statistics.injected_timeouts, statistics.injected_closes,
+			statistics.connects,
+			statistics.connects > 0UL ? (double)statistics.connect_us_total / (double)statistics.connects / 1000.0 : 0.0,
+			(double)statistics.connect_us_max / 1000.0,
+			statistics.publishes,
+			statistics.publishes > 0UL ? (double)statistics.publish_us_total / (double)statistics.publishes / 1000.0 : 0.0,
+			(double)statistics.publish_us_max / 1000.0,
+			statistics.publishes > 0UL ? (double)statistics.publish_serial_bytes / (double)statistics.publishes : 0.0,
+			statistics.sms_sent, statistics.sms_received);
+	(void)fflush(stdout);
+}
+
+static void handle_signal(int signal_number)
+{
+	(void)signal_number;
+
+	stop_requested = 1;
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+int main(int argc, char **argv)
+{
+	struct termios tio;
+	char control_line[256];
+	size_t control_length = 0U;
+	uint64_t next_report_us;
+	unsigned int seed = 1U;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "l:r:a:c:s:n:b:e:t:x:S:R:h")) != -1)
+	{
+		switch (opt)
+		{
+		case 'l':
+			options.link_path = optarg;
+			break;
+
+		case 'r':
+		{
+			static char relay_host[100];
+			unsigned int relay_port;
+
+			if (sscanf(optarg, "%99[^:]:%u", relay_host, &relay_port) != 2)
+			{
+				(void)fprintf(stderr, "relay must be host:port\n");
+				return 1;
+			}
+			options.relay_host = relay_host;
+			options.relay_port = (uint16_t)relay_port;
+			break;
+		}
+
+		case 'a':
+			options.at_latency_ms = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+
+		case 'c':
+			options.connect_latency_ms = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+
+		case 's':
+			options.send_latency_ms = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+
+		case 'n':
+			options.network_latency_ms = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+
+		case 'b':
+			options.baud = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+
+		case 'e':
+			options.error_percent = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+
+		case 't':
+			options.timeout_percent = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+
+		case 'x':
+			options.close_percent = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+
+		case 'S':
+			seed = (unsigned int)strtoul(optarg, NULL, 10);
+			break;
+
+		case 'R':
+			options.report_period_s = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+
+		default:
+			(void)fprintf(stderr,
+					"usage: %s [-l link] [-r relay_host:port] [-a at_latency_ms] [-c connect_latency_ms]\n"
+					"          [-s send_latency_ms] [-n network_latency_ms] [-b baud] [-e error_%%]\n"
+					"          [-t timeout_%%] [-x close_%%] [-S seed] [-R report_period_s]\n", argv[0]);
+			return 1;
+		}
+	}
+	srand(seed);
+
+	pty_fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if (pty_fd < 0 || grantpt(pty_fd) != 0 || unlockpt(pty_fd) != 0)
+	{
+		perror("pty");
+		return 1;
+	}
+	if (tcgetattr(pty_fd, &tio) == 0)
+	{
+		cfmakeraw(&tio);
+		(void)tcsetattr(pty_fd, TCSANOW, &tio);
+	}
+	(void)fcntl(pty_fd, F_SETFL, fcntl(pty_fd, F_GETFL) | O_NONBLOCK);
+
+	(void)unlink(options.link_path);
+	if (symlink(ptsname(pty_fd), options.link_path) != 0)
+	{
+		perror("symlink");
+		return 1;
+	}
+	(void)printf("SIM800L emulator on %s -> %s\n", options.link_path, ptsname(pty_fd));
+	(void)fflush(stdout);
+
+	(void)signal(SIGINT, handle_signal);
+	(void)signal(SIGTERM, handle_signal);
+	(void)signal(SIGPIPE, SIG_IGN);
+	next_report_us = get_time_us() + (uint64_t)options.report_period_s * 1000000ULL;
+
+	while (!stop_requested)
+	{
+		struct pollfd fds[3];
+		nfds_t count = 0U;
+		uint64_t now;
+
+		fds[count].fd = pty_fd;
+		fds[count].events = POLLIN;
+		count++;
+		fds[count].fd = STDIN_FILENO;
+		fds[count].events = POLLIN;
+		count++;
+		if (tcp_fd >= 0 && !tcp_connect_pending)
+		{
+			fds[count].fd = tcp_fd;
+			fds[count].events = POLLIN;
+			count++;
+		}
+
+		(void)poll(fds, count, 1);
+
+		if (fds[0].revents & POLLIN)
+		{
+			uint8_t buffer[256];
+			ssize_t length = read(pty_fd, buffer, sizeof(buffer));
+			ssize_t i;
+
+			for (i = 0; i < length; i++)
+			{
+				handle_input_byte(buffer[i]);
+			}
+		}
+
+		if (fds[1].revents & POLLIN)
+		{
+			char byte;
+
+			if (read(STDIN_FILENO, &byte, 1U) == 1)
+			{
+				if (byte == '\n')
+				{
+					control_line[control_length] = '\0';
+					handle_control_line(control_line);
+					control_length = 0U;
+				}
+				else if (control_length < sizeof(control_line) - 1U)
+				{
+					control_line[control_length++] = byte;
+				}
+			}
+		}
+
+		if (count == 3U && (fds[2].revents & (POLLIN | POLLHUP)))
+		{
+			tcp_receive();
+		}
+
+		now = get_time_us();
+
+		if (tcp_connect_pending && now >= tcp_connect_ready_us)
+		{
+			tcp_connect_pending = false;
+			output_urc("CONNECT OK");
+		}
+
+		if (send_ok_pending && now >= send_ok_ready_us)
+		{
+			send_ok_pending = false;
+			output_text("\r\nSEND OK\r\n");
+			if (publish_wait_send_ok)
+			{
+				uint64_t elapsed = now - publish_start_us;
+
+				publish_wait_send_ok = false;
+				publish_in_progress = false;
+				statistics.publishes++;
+				statistics.publish_us_total += elapsed;
+				if (elapsed > statistics.publish_us_max)
+				{
+					statistics.publish_us_max = elapsed;
+				}
+				statistics.publish_serial_bytes += statistics.serial_in + statistics.serial_out + output_length - publish_start_serial;
+			}
+			if (roll(options.close_percent))
+			{
+				statistics.injected_closes++;
+				tcp_close();
+				output_urc("CLOSED");
+			}
+		}
+
+		if (closed_urc_pending && !send_ok_pending)
+		{
+			closed_urc_pending = false;
+			tcp_close();
+			output_urc("CLOSED");
+		}
+
+		// only announce data between commands so the URC does not land inside a response
+		if (rx_urc_pending && input_mode == input_command && line_length == 0U && output_length == 0U &&
+				!send_ok_pending && rx_ready_length() > 0UL)
+		{
+			rx_urc_pending = false;
+			output_urc("+CIPRXGET: 1");
+		}
+
+		flush_output();
+
+		if (options.report_period_s > 0UL && now >= next_report_us)
+		{
+			print_statistics();
+			next_report_us = now + (uint64_t)options.report_period_s * 1000000ULL;
+		}
+	}
+
+	print_statistics();
+	tcp_close();
+	(void)unlink(options.link_path);
+	(void)close(pty_fd);
+
+	return 0;
+}
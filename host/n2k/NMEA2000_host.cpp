@@ -0,0 +1,233 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+NMEA2000_host.cpp
+
+See NMEA2000_host.h
+
+*/
+
+#include <string.h>
+#include "NMEA2000_host.h"
+
+//*****************************************************************************
+tNMEA2000_host::tNMEA2000_host(tVirtualCANBus *_Bus) : tNMEA2000() {
+  Bus=_Bus;
+  RxQueue=0;
+  TxQueue=0;
+  HasTxHead=false;
+  LastRxFrameTime=0;
+  ResetStatistics();
+  if ( Bus!=0 ) Bus->Attach(this);
+}
+
+//*****************************************************************************
+tNMEA2000_host::~tNMEA2000_host() {
+  if ( Bus!=0 ) Bus->Detach(this);
+  delete RxQueue;
+  delete TxQueue;
+}
+
+//*****************************************************************************
+void tNMEA2000_host::ResetStatistics() {
+  memset(&Statistics,0,sizeof(Statistics));
+}
+
+//*****************************************************************************
+bool tNMEA2000_host::CANSendFrame(unsigned long id, unsigned char len, const unsigned char *buf, bool /*wait_sent*/) {
+  tCANFrame *frame;
+
+  if ( TxQueue==0 ) return false;
+  frame=TxQueue->getAddRef((id>>26) & 0x7);
+  if ( frame==0 ) {
+    Statistics.TxQueueFull++;
+    return false;
+  }
+
+  if ( len>8 ) len=8;
+  frame->id=id;
+  frame->len=len;
+  memcpy(frame->buf,buf,len);
+
+  return true;
+}
+
+//*****************************************************************************
+bool tNMEA2000_host::CANOpen() {
+  return Bus!=0;
+}
+
+//*****************************************************************************
+bool tNMEA2000_host::CANGetFrame(unsigned long &id, unsigned char &len, unsigned char *buf) {
+  tCANFrame frame;
+
+  if ( RxQueue==0 || !RxQueue->read(frame) ) return false;
+
+  id=frame.id;
+  len=frame.len;
+  memcpy(buf,frame.buf,frame.len);
+  LastRxFrameTime=frame.Time;
+  Statistics.RxRead++;
+
+  return true;
+}
+
+//*****************************************************************************
+void tNMEA2000_host::InitCANFrameBuffers() {
+    // Same sizing as tNMEA2000_esp32
+    if (MaxCANReceiveFrames<10 ) MaxCANReceiveFrames=50;
+    if (MaxCANSendFrames<10 ) MaxCANSendFrames=40;
+    uint16_t CANGlobalBufSize=MaxCANSendFrames-4;
+    MaxCANSendFrames=4;
+    if ( RxQueue==0 ) RxQueue=new tSPSCRingBuffer<tCANFrame>(MaxCANReceiveFrames);
+    if ( TxQueue==0 ) TxQueue=new tPriorityRingBuffer<tCANFrame>(CANGlobalBufSize,8);
+
+    tNMEA2000::InitCANFrameBuffers(); // call main initialization
+}
+
+//*****************************************************************************
+void tNMEA2000_host::ReceiveFrame(const tCANFrame &frame) {
+  if ( RxQueue==0 ) return; // Not open, frame does not reach controller
+  if ( !AcceptRxFrame(frame) ) return;
+
+  HandleRxFrame(frame);
+  if ( QueueRxFrame(frame) ) HandleRxFrameQueued(frame);
+}
+
+//*****************************************************************************
+bool tNMEA2000_host::QueueRxFrame(const tCANFrame &frame) {
+  uint16_t count;
+
+  if ( RxQueue==0 ) return false;
+
+  if ( !RxQueue->add(frame) ) {
+    Statistics.RxOverruns++;
+    HandleRxOverrun(frame);
+    return false;
+  }
+
+  Statistics.RxFrames++;
+  count=RxQueue->count();
+  if ( count>Statistics.RxHighWater ) Statistics.RxHighWater=count;
+  return true;
+}
+
+//*****************************************************************************
+const tNMEA2000_host::tCANFrame *tNMEA2000_host::PeekTxFrame() {
+  if ( !HasTxHead ) {
+    if ( TxQueue==0 || !TxQueue->read(TxHead) ) return 0;
+    HasTxHead=true;
+  }
+  return &TxHead;
+}
+
+//*****************************************************************************
+void tNMEA2000_host::PopTxFrame() {
+  if ( HasTxHead ) {
+    HasTxHead=false;
+    Statistics.TxFrames++;
+  }
+}
+
+//*****************************************************************************
+tVirtualCANBus::tVirtualCANBus(uint32_t _BitRate) {
+  NodeCount=0;
+  BitRate=_BitRate;
+  BusFreeTime=0;
+  Frames=0;
+  Bits=0;
+}
+
+//*****************************************************************************
+void tVirtualCANBus::Attach(tNMEA2000_host *Node) {
+  if ( NodeCount>=MaxNodes ) return;
+  Nodes[NodeCount]=Node;
+  NodeCount++;
+}
+
+//*****************************************************************************
+void tVirtualCANBus::Detach(tNMEA2000_host *Node) {
+  for (int i=0; i<NodeCount; i++) {
+    if ( Nodes[i]==Node ) {
+      for (; i<NodeCount-1; i++) Nodes[i]=Nodes[i+1];
+      NodeCount--;
+      return;
+    }
+  }
+}
+
+//*****************************************************************************
+int64_t tVirtualCANBus::GetNextFrameEndTime() {
+  const tNMEA2000_host::tCANFrame *WinnerFrame=0;
+
+  for (int i=0; i<NodeCount; i++) {
+    const tNMEA2000_host::tCANFrame *frame=Nodes[i]->PeekTxFrame();
+    if ( frame!=0 && (WinnerFrame==0 || frame->id<WinnerFrame->id) ) WinnerFrame=frame;
+  }
+
+  if ( WinnerFrame==0 ) return -1;
+  return BusFreeTime+(int64_t)FrameBits(WinnerFrame->len)*1000000LL/(int64_t)BitRate;
+}
+
+//*****************************************************************************
+// Arbitration: lowest CAN id among head frames wins, like on real bus. Each
+// node sends its own frames in queue order.
+uint32_t tVirtualCANBus::Run(int64_t Now) {
+  uint32_t Transmitted=0;
+
+  while (true) {
+    tNMEA2000_host *Winner=0;
+    const tNMEA2000_host::tCANFrame *WinnerFrame=0;
+
+    for (int i=0; i<NodeCount; i++) {
+      const tNMEA2000_host::tCANFrame *frame=Nodes[i]->PeekTxFrame();
+      if ( frame!=0 && (WinnerFrame==0 || frame->id<WinnerFrame->id) ) {
+        Winner=Nodes[i];
+        WinnerFrame=frame;
+      }
+    }
+
+    if ( Winner==0 ) { // Bus idle
+      if ( BusFreeTime<Now ) BusFreeTime=Now;
+      break;
+    }
+
+    uint32_t FrameLen=FrameBits(WinnerFrame->len);
+    int64_t EndTime=BusFreeTime+(int64_t)FrameLen*1000000LL/(int64_t)BitRate;
+    if ( EndTime>Now ) break; // Frame still on the wire
+
+    tNMEA2000_host::tCANFrame Received=*WinnerFrame;
+    Received.Time=EndTime;
+    for (int i=0; i<NodeCount; i++) {
+      if ( Nodes[i]!=Winner ) Nodes[i]->ReceiveFrame(Received);
+    }
+    Winner->PopTxFrame();
+    BusFreeTime=EndTime;
+    Frames++;
+    Bits+=FrameLen;
+    Transmitted++;
+  }
+
+  return Transmitted;
+}
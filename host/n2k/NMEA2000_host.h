@@ -0,0 +1,143 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+NMEA2000_host.h
+
+Inherited NMEA2000 object for building the library on a Linux host. Frames do
+not go to hardware. Every tNMEA2000_host is attached to a tVirtualCANBus, which
+arbitrates queued frames by CAN id and delivers each frame to all other nodes
+at the bit timing of the configured bit rate. Time is taken from host_time so
+the bus and the library run together on the virtual clock when it is enabled.
+
+Queue sizes mirror tNMEA2000_esp32 so that overruns seen on the host are the
+ones the device would see with the same parse cadence.
+
+*/
+
+#ifndef _NMEA2000_HOST_H_
+#define _NMEA2000_HOST_H_
+
+#include <stdint.h>
+#include "NMEA2000.h"
+#include "N2kMsg.h"
+#include "RingBuffer.h"
+
+class tVirtualCANBus;
+
+class tNMEA2000_host : public tNMEA2000
+{
+  friend class tVirtualCANBus;
+public:
+  struct tCANFrame {
+    unsigned long id; // can identifier
+    uint8_t len; // length of data
+    uint8_t buf[8];
+    int64_t Time; // us, when frame had been received from the bus
+  };
+
+  struct tStatistics {
+    uint32_t TxFrames;     // frames put on the bus by this node
+    uint32_t TxQueueFull;  // frames refused because tx queue was full
+    uint32_t RxFrames;     // frames delivered to rx queue
+    uint32_t RxOverruns;   // frames lost because rx queue was full
+    uint32_t RxRead;       // frames read by the library
+    uint16_t RxHighWater;  // maximum rx queue fill seen
+  };
+
+protected:
+  tVirtualCANBus *Bus;
+  tSPSCRingBuffer<tCANFrame> *RxQueue; // same ring as the device interrupt fills
+  tPriorityRingBuffer<tCANFrame> *TxQueue; // by N2k priority as on the device
+  tStatistics Statistics;
+  tCANFrame TxHead; // frame taken from TxQueue and competing for the bus, as in controller transmit buffer
+  bool HasTxHead;
+  int64_t LastRxFrameTime; // Time of the frame last read by CANGetFrame
+
+protected:
+  // Called when frame is lost because rx queue is full. Override to trace losses.
+  virtual void HandleRxOverrun(const tCANFrame &/*frame*/) {}
+  // Called with every frame on the bus. Return false to drop it as a controller acceptance filter would.
+  virtual bool AcceptRxFrame(const tCANFrame &/*frame*/) { return true; }
+  // Called with every frame that reaches the controller, before it is queued.
+  virtual void HandleRxFrame(const tCANFrame &/*frame*/) {}
+  // Called after frame from the bus has been put to rx queue, where device driver would raise interrupt.
+  virtual void HandleRxFrameQueued(const tCANFrame &/*frame*/) {}
+  // Put frame to rx queue. Returns false if it was lost because the queue is full.
+  bool QueueRxFrame(const tCANFrame &frame);
+
+protected:
+  // Called by bus.
+  void ReceiveFrame(const tCANFrame &frame);
+  const tCANFrame *PeekTxFrame();
+  void PopTxFrame();
+
+protected:
+  bool CANSendFrame(unsigned long id, unsigned char len, const unsigned char *buf, bool wait_sent=true);
+  bool CANOpen();
+  bool CANGetFrame(unsigned long &id, unsigned char &len, unsigned char *buf);
+  virtual void InitCANFrameBuffers();
+  uint16_t CANGetSendFrameSpace() { return (TxQueue!=0?TxQueue->getFreeCount():0); }
+
+public:
+  tNMEA2000_host(tVirtualCANBus *_Bus);
+  virtual ~tNMEA2000_host();
+  const tStatistics &GetStatistics() const { return Statistics; }
+  void ResetStatistics();
+  uint16_t GetRxQueueCount() { return (RxQueue!=0?RxQueue->count():0); }
+};
+
+//*****************************************************************************
+// In-memory CAN bus connecting any number of tNMEA2000_host nodes up to
+// MaxNodes. Call Run() regularly with current time - it transmits as many
+// frames as bus bit time since the previous call allows.
+class tVirtualCANBus
+{
+public:
+  static const int MaxNodes=16;
+
+protected:
+  tNMEA2000_host *Nodes[MaxNodes];
+  int NodeCount;
+  uint32_t BitRate;
+  int64_t BusFreeTime; // us, time when bus can start next frame
+  uint64_t Frames;
+  uint64_t Bits;
+
+public:
+  tVirtualCANBus(uint32_t _BitRate=250000);
+  void Attach(tNMEA2000_host *Node);
+  void Detach(tNMEA2000_host *Node);
+  // Transmit queued frames up to time Now (us). Returns number of frames transmitted.
+  uint32_t Run(int64_t Now);
+  // Time (us) when frame now winning arbitration has been transmitted or -1, if no node has frames to send.
+  int64_t GetNextFrameEndTime();
+  // Nominal bits for extended frame without stuff bits, including inter frame space.
+  static uint32_t FrameBits(uint8_t len) { return 67+8*(uint32_t)len; }
+  uint32_t GetBitRate() const { return BitRate; }
+  uint64_t GetFrameCount() const { return Frames; }
+  uint64_t GetBitCount() const { return Bits; }
+  void ResetStatistics() { Frames=0; Bits=0; }
+};
+
+#endif
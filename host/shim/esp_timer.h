@@ -0,0 +1,22 @@
+/*
+Host stand-in for the ESP-IDF esp_timer API. Only what the BlueBridge sources
+use is declared. Time comes from host_time.c so it follows the virtual clock
+when that is enabled.
+*/
+
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int64_t esp_timer_get_time(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,35 @@
+/*
+Host stand-in for the FreeRTOS headers. Only the types and macros used by the
+BlueBridge sources built on the host are declared. The tick rate matches
+CONFIG_FREERTOS_HZ in sdkconfig.defaults.
+*/
+
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t TickType_t;
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+
+#define configTICK_RATE_HZ		1000
+#define portTICK_PERIOD_MS		((TickType_t)1000 / configTICK_RATE_HZ)
+#define portTICK_RATE_MS		portTICK_PERIOD_MS
+#define pdMS_TO_TICKS(ms)		((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000))
+#define portMAX_DELAY			((TickType_t)0xffffffffUL)
+#define pdFALSE					((BaseType_t)0)
+#define pdTRUE					((BaseType_t)1)
+#define pdPASS					pdTRUE
+#define pdFAIL					pdFALSE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,2 @@
+/* main/timer.c includes the FreeRTOS header with this case, which matters on Linux */
+#include "FreeRTOS.h"
@@ -0,0 +1,22 @@
+/*
+Host stand-in for freertos/task.h. vTaskDelay in host_task.c sleeps on the
+real clock or advances the virtual clock, see host_time.h.
+*/
+
+#ifndef INC_TASK_H
+#define INC_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+TickType_t xTaskGetTickCount(void);
+void vTaskDelay(const TickType_t ticks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,100 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdbool.h>
+#include "host_compat.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+/************
+*** TYPES ***
+************/
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+char *itoa(int value, char *buffer, int base)
+{
+	char digits[33];
+	unsigned int magnitude;
+	int length = 0;
+	int i = 0;
+	bool negative = (value < 0 && base == 10);
+
+	if (base < 2 || base > 36)
+	{
+		buffer[0] = '\0';
+		return buffer;
+	}
+
+	magnitude = negative ? 0U - (unsigned int)value : (unsigned int)value;
+	do
+	{
+		unsigned int digit = magnitude % (unsigned int)base;
+
+		digits[length++] = (char)(digit < 10U ? '0' + digit : 'a' + digit - 10U);
+		magnitude /= (unsigned int)base;
+	} while (magnitude > 0U);
+
+	if (negative)
+	{
+		buffer[i++] = '-';
+	}
+	while (length > 0)
+	{
+		buffer[i++] = digits[--length];
+	}
+	buffer[i] = '\0';
+
+	return buffer;
+}
@@ -0,0 +1,93 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/*
+Single threaded stand-ins for the two FreeRTOS task functions used by the
+host benchmarks. The whole firmware build uses the scheduler in
+host/freertos instead.
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <unistd.h>
+#include "host_time.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define TICK_US		(1000000LL / (int64_t)configTICK_RATE_HZ)		///< Length of a tick in microseconds
+
+/************
+*** TYPES ***
+************/
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+TickType_t xTaskGetTickCount(void)
+{
+	return (TickType_t)(host_time_get_us() / TICK_US);
+}
+
+void vTaskDelay(const TickType_t ticks)
+{
+	int64_t us = (int64_t)ticks * TICK_US;
+
+	if (host_time_is_virtual())
+	{
+		host_time_advance_us(us);
+	}
+	else
+	{
+		(void)usleep((useconds_t)us);
+	}
+}
@@ -0,0 +1,128 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <time.h>
+#include "host_time.h"
+#include "esp_timer.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+/************
+*** TYPES ***
+************/
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static int64_t get_monotonic_us(void);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static bool virtual_clock;
+static int64_t virtual_time_us;
+static int64_t start_time_us = -1LL;
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+static int64_t get_monotonic_us(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t)ts.tv_sec * 1000000LL + (int64_t)ts.tv_nsec / 1000LL;
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+void host_time_set_virtual(bool enable)
+{
+	virtual_clock = enable;
+	virtual_time_us = 0LL;
+}
+
+bool host_time_is_virtual(void)
+{
+	return virtual_clock;
+}
+
+void host_time_advance_us(int64_t us)
+{
+	if (virtual_clock && us > 0LL)
+	{
+		virtual_time_us += us;
+	}
+}
+
+int64_t host_time_get_us(void)
+{
+	if (virtual_clock)
+	{
+		return virtual_time_us;
+	}
+
+	if (start_time_us < 0LL)
+	{
+		start_time_us = get_monotonic_us();
+	}
+
+	return get_monotonic_us() - start_time_us;
+}
+
+uint64_t host_time_get_cpu_ns(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int64_t esp_timer_get_time(void)
+{
+	return host_time_get_us();
+}
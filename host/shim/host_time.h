@@ -0,0 +1,97 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef HOST_TIME_H
+#define HOST_TIME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**************
+*** DEFINES ***
+**************/
+
+/************
+*** TYPES ***
+************/
+
+/*************************
+*** EXTERNAL VARIABLES ***
+*************************/
+
+/***************************
+*** FUNCTIONS PROTOTYPES ***
+***************************/
+
+/**
+ * Switch the host clock between real monotonic time and a virtual clock that only moves when advanced.
+ * The virtual clock starts at zero each time it is enabled.
+ *
+ * @param enable true to use the virtual clock, false for the real monotonic clock
+ */
+void host_time_set_virtual(bool enable);
+
+/**
+ * Find out if the virtual clock is in use
+ *
+ * @return true if the virtual clock is in use
+ */
+bool host_time_is_virtual(void);
+
+/**
+ * Move the virtual clock forward. Does nothing when the real clock is in use.
+ *
+ * @param us Number of microseconds to advance
+ */
+void host_time_advance_us(int64_t us);
+
+/**
+ * Get time since start up in microseconds from whichever clock is in use
+ *
+ * @return Time in microseconds
+ */
+int64_t host_time_get_us(void);
+
+/**
+ * Get CPU time used by the calling thread in nanoseconds, for measuring processing cost independent of either clock
+ *
+ * @return Thread CPU time in nanoseconds
+ */
+uint64_t host_time_get_cpu_ns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,267 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <string.h>
+#include "telemetry_decoder.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define VARINT_MAX_BYTES			5U				///< Bytes of the longest varint of a 32 bit value
+#define FIELD_MASK					((1UL << TELEMETRY_DECODER_FIELDS) - 1UL)	///< Bits of the fields of this version
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Schema of a field in a version 1 payload
+ */
+typedef struct
+{
+	const char *name;				///< Field name
+	uint8_t decimals;				///< Decimals of the fixed point value
+} field_schema_t;
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static telemetry_decoder_status_t read_varint(const uint8_t *payload, size_t length, size_t *position, uint32_t *value);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+static const field_schema_t field_schemas[TELEMETRY_DECODER_FIELDS] =
+{
+	{"strength", 0U},
+	{"cog", 0U},
+	{"temp", 1U},
+	{"sog", 1U},
+	{"boatspeed", 1U},
+	{"log", 0U},
+	{"trip", 1U},
+	{"heading", 0U},
+	{"depth", 1U},
+	{"tws", 1U},
+	{"twa", 1U},
+	{"aws", 1U},
+	{"awa", 1U},
+	{"lat", 4U},
+	{"long", 4U},
+	{"pressure", 1U},
+	{"period", 0U},
+	{"exhaust_temp", 1U}
+};
+
+static const double scales[] = {1.0, 10.0, 100.0, 1000.0, 10000.0};
+
+static const char * const status_texts[telemetry_decoder_status_max] =
+{
+	"ok", "truncated", "bad version", "bad varint", "unknown field", "trailing bytes"
+};
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/**
+ * Read a varint, 7 bits per byte least significant first with the top bit set on all but the last byte
+ *
+ * @param payload The payload
+ * @param length Bytes in payload
+ * @param position Position of the varint, moved past it
+ * @param value Written with the value
+ * @return telemetry_decoder_ok, telemetry_decoder_truncated or telemetry_decoder_bad_varint
+ */
+static telemetry_decoder_status_t read_varint(const uint8_t *payload, size_t length, size_t *position, uint32_t *value)
+{
+	uint32_t result = 0UL;
+	uint8_t byte;
+	size_t i;
+
+	for (i = 0U; i < VARINT_MAX_BYTES; i++)
+	{
+		if (*position >= length)
+		{
+			return telemetry_decoder_truncated;
+		}
+		byte = payload[(*position)++];
+		// the fifth byte only has the top 4 bits of 32
+		if (i == VARINT_MAX_BYTES - 1U && byte > 0x0fU)
+		{
+			return telemetry_decoder_bad_varint;
+		}
+		result |= (uint32_t)(byte & 0x7fU) << (7U * i);
+		if ((byte & 0x80U) == 0U)
+		{
+			*value = result;
+			return telemetry_decoder_ok;
+		}
+	}
+
+	return telemetry_decoder_bad_varint;
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+telemetry_decoder_status_t telemetry_decoder_decode(const uint8_t *payload, size_t length, telemetry_decoder_frame_t *frame)
+{
+	telemetry_decoder_status_t status;
+	size_t position = 2U;
+	uint32_t sequence;
+	uint32_t value;
+	uint8_t field;
+
+	(void)memset(frame, 0, sizeof(telemetry_decoder_frame_t));
+	if (length < 1U)
+	{
+		return telemetry_decoder_truncated;
+	}
+	if (payload[0] != TELEMETRY_DECODER_VERSION)
+	{
+		return telemetry_decoder_bad_version;
+	}
+	if (length < 2U)
+	{
+		return telemetry_decoder_truncated;
+	}
+	frame->keyframe = (payload[1] & TELEMETRY_DECODER_FLAG_KEYFRAME) != 0U;
+
+	status = read_varint(payload, length, &position, &sequence);
+	if (status != telemetry_decoder_ok)
+	{
+		return status;
+	}
+	if (sequence > 0xffffUL)
+	{
+		return telemetry_decoder_bad_varint;
+	}
+	frame->sequence = (uint16_t)sequence;
+
+	status = read_varint(payload, length, &position, &frame->present);
+	if (status != telemetry_decoder_ok)
+	{
+		return status;
+	}
+	if ((payload[1] & TELEMETRY_DECODER_FLAG_CLEARED) != 0U)
+	{
+		status = read_varint(payload, length, &position, &frame->cleared);
+		if (status != telemetry_decoder_ok)
+		{
+			return status;
+		}
+	}
+	if (((frame->present | frame->cleared) & ~FIELD_MASK) != 0UL)
+	{
+		return telemetry_decoder_unknown_field;
+	}
+
+	for (field = 0U; field < TELEMETRY_DECODER_FIELDS; field++)
+	{
+		if ((frame->present & (1UL << field)) != 0UL)
+		{
+			status = read_varint(payload, length, &position, &value);
+			if (status != telemetry_decoder_ok)
+			{
+				return status;
+			}
+			// undo zigzag, (n << 1) ^ (n >> 31)
+			frame->values[field] = (int32_t)((value >> 1) ^ (0UL - (value & 1UL)));
+		}
+	}
+
+	return position == length ? telemetry_decoder_ok : telemetry_decoder_trailing_bytes;
+}
+
+void telemetry_decoder_view_init(telemetry_decoder_view_t *view)
+{
+	(void)memset(view, 0, sizeof(telemetry_decoder_view_t));
+}
+
+void telemetry_decoder_view_apply(telemetry_decoder_view_t *view, const telemetry_decoder_frame_t *frame)
+{
+	uint8_t field;
+
+	if (view->frames > 0UL && frame->sequence != view->next_sequence)
+	{
+		view->missed += (uint16_t)(frame->sequence - view->next_sequence);
+		view->in_sync = false;
+	}
+
+	if (frame->keyframe)
+	{
+		view->available = 0UL;
+		view->in_sync = true;
+	}
+	view->available = (view->available | frame->present) & ~frame->cleared;
+	for (field = 0U; field < TELEMETRY_DECODER_FIELDS; field++)
+	{
+		if ((frame->present & (1UL << field)) != 0UL)
+		{
+			view->values[field] = frame->values[field];
+		}
+	}
+
+	view->next_sequence = (uint16_t)(frame->sequence + 1U);
+	view->frames++;
+}
+
+const char *telemetry_decoder_field_name(uint8_t field)
+{
+	return field < TELEMETRY_DECODER_FIELDS ? field_schemas[field].name : "";
+}
+
+uint8_t telemetry_decoder_field_decimals(uint8_t field)
+{
+	return field < TELEMETRY_DECODER_FIELDS ? field_schemas[field].decimals : 0U;
+}
+
+double telemetry_decoder_field_value(uint8_t field, int32_t value)
+{
+	return (double)value / scales[telemetry_decoder_field_decimals(field)];
+}
+
+const char *telemetry_decoder_status_text(telemetry_decoder_status_t status)
+{
+	return status < telemetry_decoder_status_max ? status_texts[status] : "";
+}
@@ -0,0 +1,178 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+/*
+telemetry_decoder.h
+
+Decoder for the binary MQTT data payload that BlueBridge publishes on topic
+<code>/bin, see telemetry_build_binary() in main/telemetry.h for the format.
+Portable C99 with no dependencies on the firmware, for brokers, servers and
+anything else that reads the payload.
+
+A payload is decoded to a frame of fixed point field values. Frames are then
+applied in order to a view that follows the fields as the firmware sent them,
+filling in the unchanged fields of deltas and noticing missed payloads.
+*/
+
+#ifndef TELEMETRY_DECODER_H
+#define TELEMETRY_DECODER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**************
+*** DEFINES ***
+**************/
+
+#define TELEMETRY_DECODER_VERSION				1U			///< Payload version this decoder reads
+#define TELEMETRY_DECODER_FIELDS				18U			///< Fields of a version 1 payload
+#define TELEMETRY_DECODER_FLAG_KEYFRAME			0x01U		///< Flags byte bit, the payload is a keyframe
+#define TELEMETRY_DECODER_FLAG_CLEARED			0x02U		///< Flags byte bit, a bitmap of fields no longer available follows
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Result of decoding a payload
+ */
+typedef enum
+{
+	telemetry_decoder_ok,					///< Payload decoded
+	telemetry_decoder_truncated,			///< Payload ended part way through
+	telemetry_decoder_bad_version,			///< First byte is not TELEMETRY_DECODER_VERSION
+	telemetry_decoder_bad_varint,			///< A varint is longer than 5 bytes or more than 32 bits
+	telemetry_decoder_unknown_field,		///< A bitmap has a field this version does not have
+	telemetry_decoder_trailing_bytes,		///< Bytes after the last field
+	telemetry_decoder_status_max			/* must be last value */
+} telemetry_decoder_status_t;
+
+/**
+ * One decoded payload
+ */
+typedef struct
+{
+	bool keyframe;								///< Payload is a keyframe with every available field
+	uint16_t sequence;							///< Sequence number
+	uint32_t present;							///< Bit per field in the payload
+	uint32_t cleared;							///< Bit per field no longer available, always 0 in a keyframe
+	int32_t values[TELEMETRY_DECODER_FIELDS];	///< Fixed point values, meaningful for fields in present
+} telemetry_decoder_frame_t;
+
+/**
+ * Fields as the firmware sent them, built up from frames
+ */
+typedef struct
+{
+	uint32_t available;							///< Bit per field that is available
+	int32_t values[TELEMETRY_DECODER_FIELDS];	///< Fixed point values, meaningful for fields in available
+	bool in_sync;								///< No payload missed since the last keyframe, so available fields are current
+	uint16_t next_sequence;						///< Sequence number expected next
+	uint32_t frames;							///< Frames applied
+	uint32_t missed;							///< Payloads missed, from gaps in the sequence numbers
+} telemetry_decoder_view_t;
+
+/*************************
+*** EXTERNAL VARIABLES ***
+*************************/
+
+/***************************
+*** FUNCTIONS PROTOTYPES ***
+***************************/
+
+/**
+ * Decode a binary payload
+ *
+ * @param payload The payload
+ * @param length Bytes in payload
+ * @param frame Written with the decoded payload, only complete when telemetry_decoder_ok is returned
+ * @return telemetry_decoder_ok or what was wrong with the payload
+ */
+telemetry_decoder_status_t telemetry_decoder_decode(const uint8_t *payload, size_t length, telemetry_decoder_frame_t *frame);
+
+/**
+ * Start a view with nothing available and out of sync until the first keyframe
+ *
+ * @param view The view
+ */
+void telemetry_decoder_view_init(telemetry_decoder_view_t *view);
+
+/**
+ * Apply the next frame to a view. A keyframe replaces every field and brings the view in sync. A delta sets the fields
+ * it has and clears those it marks as no longer available. A gap in the sequence numbers takes the view out of sync
+ * until the next keyframe, as fields may have changed in the payloads missed.
+ *
+ * @param view The view
+ * @param frame Decoded frame
+ */
+void telemetry_decoder_view_apply(telemetry_decoder_view_t *view, const telemetry_decoder_frame_t *frame);
+
+/**
+ * Name of a field, as the website and app call it
+ *
+ * @param field Field number 0 to TELEMETRY_DECODER_FIELDS - 1
+ * @return Name, e.g. depth or lat, empty if field is out of range
+ */
+const char *telemetry_decoder_field_name(uint8_t field);
+
+/**
+ * Decimals of a field's fixed point value
+ *
+ * @param field Field number 0 to TELEMETRY_DECODER_FIELDS - 1
+ * @return Decimals, 0 for whole numbers and fields out of range
+ */
+uint8_t telemetry_decoder_field_decimals(uint8_t field);
+
+/**
+ * Convert a field's fixed point value to a number
+ *
+ * @param field Field number 0 to TELEMETRY_DECODER_FIELDS - 1
+ * @param value Fixed point value
+ * @return The value in the field's units, e.g. metres for depth
+ */
+double telemetry_decoder_field_value(uint8_t field, int32_t value);
+
+/**
+ * Text of a decode status
+ *
+ * @param status The status
+ * @return Text, e.g. "truncated"
+ */
+const char *telemetry_decoder_status_text(telemetry_decoder_status_t status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
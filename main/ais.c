@@ -0,0 +1,959 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include "ais.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define AIS_MAXIMUM_PAYLOAD_BITS		(AIS_MAXIMUM_FRAGMENTS * NMEA_VDM_MAX_AIS_DATA_FIELD_LENGTH * 6U)	///< Bits in the longest reassembled payload
+#define AIS_AGEING_INTERVAL_MS			5000UL				///< How often ais_receive_fragment removes old targets
+#define AIS_NO_MESSAGE_IDENTIFIER		10U					///< Key of fragments without a sequential message identifier, they are 0 to 9
+#define AIS_STATIC_DATA_START			38U					///< First bit after type, repeat indicator and MMSI
+#define AIS_METRES_PER_UNIT				0.1852f				///< Metres of latitude in 1/10000 minute
+#define AIS_RADIANS_PER_UNIT			(3.14159265f / (180.0f * 600000.0f))	///< Radians in 1/10000 minute
+#define AIS_INDEX_NONE					0U					///< Unused target_index entry, entries hold the target number + 1
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * A multi-fragment message being reassembled
+ */
+typedef struct
+{
+	bool in_use;											///< If fragments are being collected
+	char channel_code;										///< Channel the fragments came on, '\0' if not given
+	uint8_t message_identifier;								///< Sequential message identifier or AIS_NO_MESSAGE_IDENTIFIER
+	uint8_t fragment_count;									///< Fragments in the message
+	uint8_t fragments_received;								///< Fragments received so far, always in order
+	uint32_t start_time;									///< Time the first fragment arrived
+	nmea_message_data_VDM_t fragments[AIS_MAXIMUM_FRAGMENTS];	///< The fragments, kept to forward them unchanged
+} reassembly_t;
+
+/**
+ * A reassembled payload as bits, most significant bit of the first byte first
+ */
+typedef struct
+{
+	uint16_t length;										///< Bits in the payload
+	uint8_t bits[(AIS_MAXIMUM_PAYLOAD_BITS + 7U) / 8U];		///< The bits
+} payload_t;
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static ais_result_t receive_multiple(const nmea_message_data_VDM_t *fragment, uint32_t time_ms,
+		const nmea_message_data_VDM_t **fragments, uint8_t *fragment_count);
+static ais_result_t process_message(const nmea_message_data_VDM_t *fragments, uint8_t fragment_count, uint32_t time_ms);
+static bool unpack_payload(const nmea_message_data_VDM_t *fragments, uint8_t fragment_count, payload_t *payload);
+static uint32_t get_unsigned(const payload_t *payload, uint16_t start, uint8_t length);
+static int32_t get_signed(const payload_t *payload, uint16_t start, uint8_t length);
+static void get_text(const payload_t *payload, uint16_t start, uint8_t characters, char *text);
+static uint32_t get_check(const payload_t *payload, uint16_t start);
+static bool decode_position(const payload_t *payload, uint8_t type, ais_target_t *target);
+static bool decode_static(const payload_t *payload, uint8_t type, ais_target_t *target, uint8_t *part);
+static bool position_is_news(const ais_target_t *target, uint32_t time_ms);
+static uint16_t angle_difference(uint16_t a, uint16_t b, uint16_t full_circle);
+static uint16_t index_home(uint32_t mmsi);
+static uint16_t index_find(uint32_t mmsi);
+static ais_target_t *add_target(uint32_t mmsi, uint32_t time_ms);
+static void remove_target(uint16_t number);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static reassembly_t reassemblies[AIS_REASSEMBLY_SLOTS];			///< Multi-fragment messages being collected
+static payload_t payload;										///< Payload of the message being decoded, too big for the stack
+static ais_target_t targets[AIS_MAXIMUM_TARGETS];				///< The target table, an entry with MMSI 0 is unused
+static uint16_t target_index[AIS_TARGET_INDEX_SIZE];				///< Open addressed MMSI index, entries are target number + 1
+static uint16_t target_count;									///< Targets in the table
+static ais_position_callback_t position_callback;				///< Called when a position report has updated a target
+static uint32_t last_ageing_time;								///< Time old targets were last removed
+static ais_stats_t stats;										///< Counters
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/**
+ * Collect a fragment of a multi-fragment message. Fragments of a message must arrive in order and within
+ * AIS_REASSEMBLY_TIMEOUT_MS, otherwise what has been collected is dropped.
+ *
+ * @param fragment The fragment
+ * @param time_ms Time now
+ * @param fragments Set to the fragments of the message when it is complete
+ * @param fragment_count Set to the number of fragments when the message is complete
+ * @return ais_result_incomplete until the last fragment, then the result of processing the message
+ */
+static ais_result_t receive_multiple(const nmea_message_data_VDM_t *fragment, uint32_t time_ms,
+		const nmea_message_data_VDM_t **fragments, uint8_t *fragment_count)
+{
+	reassembly_t *reassembly = NULL;
+	uint8_t message_identifier = AIS_NO_MESSAGE_IDENTIFIER;
+	char channel_code = '\0';
+	uint8_t i;
+
+	if (fragment->data_available & NMEA_VDM_MESSAGE_IDENTIFIER_PRESENT)
+	{
+		message_identifier = fragment->message_identifier;
+	}
+	if (fragment->data_available & NMEA_VDM_CHANNEL_CODE_PRESENT)
+	{
+		channel_code = fragment->channel_code;
+	}
+
+	for (i = 0U; i < AIS_REASSEMBLY_SLOTS; i++)
+	{
+		if (reassemblies[i].in_use && reassemblies[i].message_identifier == message_identifier &&
+				reassemblies[i].channel_code == channel_code)
+		{
+			reassembly = &reassemblies[i];
+			break;
+		}
+	}
+
+	if (fragment->fragment_number == 1U)
+	{
+		// a new message with the same key replaces one that never finished, otherwise a free or the oldest slot is used
+		if (reassembly == NULL)
+		{
+			reassembly = &reassemblies[0];
+			for (i = 0U; i < AIS_REASSEMBLY_SLOTS; i++)
+			{
+				if (!reassemblies[i].in_use)
+				{
+					reassembly = &reassemblies[i];
+					break;
+				}
+				if (time_ms - reassemblies[i].start_time > time_ms - reassembly->start_time)
+				{
+					reassembly = &reassemblies[i];
+				}
+			}
+		}
+		if (reassembly->in_use)
+		{
+			stats.reassembly_failed++;
+		}
+
+		reassembly->in_use = true;
+		reassembly->channel_code = channel_code;
+		reassembly->message_identifier = message_identifier;
+		reassembly->fragment_count = fragment->fragment_count;
+		reassembly->fragments_received = 1U;
+		reassembly->start_time = time_ms;
+		reassembly->fragments[0] = *fragment;
+
+		return ais_result_incomplete;
+	}
+
+	if (reassembly == NULL)
+	{
+		stats.reassembly_failed++;
+		return ais_result_error;
+	}
+
+	if (fragment->fragment_number != reassembly->fragments_received + 1U ||
+			fragment->fragment_count != reassembly->fragment_count ||
+			time_ms - reassembly->start_time > AIS_REASSEMBLY_TIMEOUT_MS)
+	{
+		reassembly->in_use = false;
+		stats.reassembly_failed++;
+		return ais_result_error;
+	}
+
+	reassembly->fragments[reassembly->fragments_received] = *fragment;
+	reassembly->fragments_received++;
+	if (reassembly->fragments_received < reassembly->fragment_count)
+	{
+		return ais_result_incomplete;
+	}
+
+	// the fragments stay where they are until the slot is used again, which is not before the next call
+	reassembly->in_use = false;
+	*fragments = reassembly->fragments;
+	*fragment_count = reassembly->fragment_count;
+
+	return process_message(reassembly->fragments, reassembly->fragment_count, time_ms);
+}
+
+/**
+ * Decode a complete message, update its target and decide if it is forwarded
+ *
+ * @param fragments The fragments of the message
+ * @param fragment_count Number of fragments
+ * @param time_ms Time now
+ * @return ais_result_forward, ais_result_suppressed or ais_result_error
+ */
+static ais_result_t process_message(const nmea_message_data_VDM_t *fragments, uint8_t fragment_count, uint32_t time_ms)
+{
+	ais_target_t *target;
+	uint32_t mmsi;
+	uint32_t check;
+	uint8_t type;
+	uint8_t part;
+	bool forward;
+
+	stats.messages++;
+	if (!unpack_payload(fragments, fragment_count, &payload) || payload.length < 6U)
+	{
+		stats.payload_errors++;
+		return ais_result_error;
+	}
+
+	type = (uint8_t)get_unsigned(&payload, 0U, 6U);
+	switch (type)
+	{
+	case 1U:
+	case 2U:
+	case 3U:
+	case 5U:
+	case 18U:
+	case 19U:
+	case 24U:
+		break;
+
+	default:
+		stats.passed_on++;
+		return ais_result_forward;
+	}
+
+	mmsi = payload.length >= AIS_STATIC_DATA_START ? get_unsigned(&payload, 8U, 30U) : 0UL;
+	if (mmsi == 0UL)
+	{
+		stats.payload_errors++;
+		return ais_result_error;
+	}
+
+	target = (ais_target_t *)ais_get_target(mmsi);
+	if (target == NULL)
+	{
+		target = add_target(mmsi, time_ms);
+		if (target == NULL)
+		{
+			stats.untracked++;
+			return ais_result_forward;
+		}
+	}
+
+	if (type == 5U || type == 24U)
+	{
+		if (!decode_static(&payload, type, target, &part))
+		{
+			stats.payload_errors++;
+			return ais_result_error;
+		}
+
+		// static data is forwarded when it changes and now and then so that a newly connected client learns it
+		check = get_check(&payload, AIS_STATIC_DATA_START);
+		forward = check != target->static_check[part] ||
+				time_ms - target->last_static_forward_time[part] >= AIS_FORWARD_STATIC_INTERVAL_MS;
+		if (forward)
+		{
+			target->static_check[part] = check;
+			target->last_static_forward_time[part] = time_ms;
+		}
+	}
+	else
+	{
+		if (!decode_position(&payload, type, target))
+		{
+			stats.payload_errors++;
+			return ais_result_error;
+		}
+
+		if (position_callback != NULL)
+		{
+			position_callback((uint16_t)(target - targets), target, time_ms);
+		}
+
+		forward = position_is_news(target, time_ms);
+		if (forward)
+		{
+			target->forwarded = true;
+			target->last_forward_time = time_ms;
+			target->forwarded_latitude = target->latitude;
+			target->forwarded_longitude = target->longitude;
+			target->forwarded_sog = target->sog;
+			target->forwarded_cog = target->cog;
+			target->forwarded_heading = target->heading;
+			target->forwarded_navigation_status = target->navigation_status;
+		}
+	}
+
+	target->last_report_time = time_ms;
+	target->last_message_type = type;
+	stats.decoded++;
+	if (!forward)
+	{
+		stats.suppressed++;
+		return ais_result_suppressed;
+	}
+	stats.forwarded++;
+
+	return ais_result_forward;
+}
+
+/**
+ * Turn the 6 bit characters of the fragments of a message into bits
+ *
+ * @param fragments The fragments of the message
+ * @param fragment_count Number of fragments
+ * @param payload The bits
+ * @return If all characters were valid and the payload fitted
+ */
+static bool unpack_payload(const nmea_message_data_VDM_t *fragments, uint8_t fragment_count, payload_t *payload)
+{
+	uint32_t accumulator = 0UL;
+	uint8_t accumulated_bits = 0U;
+	uint16_t bytes = 0U;
+	uint16_t characters = 0U;
+	uint8_t fill_bits = 0U;
+	uint8_t fragment;
+	const char *data;
+	uint8_t value;
+
+	for (fragment = 0U; fragment < fragment_count; fragment++)
+	{
+		if ((fragments[fragment].data_available & NMEA_VDM_DATA_PRESENT) == 0UL)
+		{
+			return false;
+		}
+
+		for (data = fragments[fragment].data; *data != '\0'; data++)
+		{
+			// '0' to 'W' are 0 to 39 and '`' to 'w' are 40 to 63
+			value = (uint8_t)(*data - '0');
+			if (value > 39U)
+			{
+				value = (uint8_t)(value - 8U);
+				if (value < 40U || value > 63U)
+				{
+					return false;
+				}
+			}
+
+			accumulator = (accumulator << 6) | value;
+			accumulated_bits = (uint8_t)(accumulated_bits + 6U);
+			if (accumulated_bits >= 8U)
+			{
+				accumulated_bits = (uint8_t)(accumulated_bits - 8U);
+				payload->bits[bytes++] = (uint8_t)(accumulator >> accumulated_bits);
+			}
+			characters++;
+		}
+	}
+
+	if (accumulated_bits > 0U)
+	{
+		payload->bits[bytes] = (uint8_t)(accumulator << (8U - accumulated_bits));
+	}
+
+	if (fragments[fragment_count - 1U].data_available & NMEA_VDM_FILL_BITS_PRESENT)
+	{
+		fill_bits = fragments[fragment_count - 1U].fill_bits;
+	}
+	if (fill_bits > 5U || characters * 6U < fill_bits)
+	{
+		return false;
+	}
+	payload->length = (uint16_t)(characters * 6U - fill_bits);
+
+	return true;
+}
+
+/**
+ * Read an unsigned field from a payload
+ *
+ * @param payload The payload
+ * @param start First bit of the field
+ * @param length Bits in the field, 1 to 31
+ * @return The field
+ */
+static uint32_t get_unsigned(const payload_t *payload, uint16_t start, uint8_t length)
+{
+	uint32_t value = 0UL;
+	uint16_t byte = (uint16_t)(start >> 3);
+	uint8_t bits_left = (uint8_t)(8U - (start & 7U));
+	uint8_t take;
+
+	// whole bytes where the field allows, the first and last may be partial
+	while (length > 0U)
+	{
+		take = length < bits_left ? length : bits_left;
+		value = (value << take) | (((uint32_t)payload->bits[byte] >> (bits_left - take)) & ((1UL << take) - 1UL));
+		length = (uint8_t)(length - take);
+		byte++;
+		bits_left = 8U;
+	}
+
+	return value;
+}
+
+/**
+ * Read a two's complement field from a payload
+ *
+ * @param payload The payload
+ * @param start First bit of the field
+ * @param length Bits in the field, 2 to 31
+ * @return The field
+ */
+static int32_t get_signed(const payload_t *payload, uint16_t start, uint8_t length)
+{
+	uint32_t value = get_unsigned(payload, start, length);
+
+	if (value & (1UL << (length - 1U)))
+	{
+		value |= ~((1UL << length) - 1UL);
+	}
+
+	return (int32_t)value;
+}
+
+/**
+ * Read a text field of 6 bit characters from a payload, trailing @ and spaces are removed
+ *
+ * @param payload The payload
+ * @param start First bit of the field
+ * @param characters Characters in the field
+ * @param text Buffer for characters + 1 bytes
+ */
+static void get_text(const payload_t *payload, uint16_t start, uint8_t characters, char *text)
+{
+	uint8_t length = 0U;
+	uint8_t i;
+	uint8_t value;
+
+	for (i = 0U; i < characters; i++)
+	{
+		value = (uint8_t)get_unsigned(payload, (uint16_t)(start + i * 6U), 6U);
+		text[i] = (char)(value < 32U ? value + 64U : value);
+		if (text[i] != '@' && text[i] != ' ')
+		{
+			length = (uint8_t)(i + 1U);
+		}
+	}
+	text[length] = '\0';
+}
+
+/**
+ * Work out a check value of the payload from a bit to the end, FNV-1a over its bytes
+ *
+ * @param payload The payload
+ * @param start First bit to include
+ * @return The check value
+ */
+static uint32_t get_check(const payload_t *payload, uint16_t start)
+{
+	uint32_t check = 2166136261UL;
+	uint16_t bit;
+	uint8_t length;
+
+	for (bit = start; bit < payload->length; bit = (uint16_t)(bit + length))
+	{
+		length = payload->length - bit < 8 ? (uint8_t)(payload->length - bit) : 8U;
+		check = (check ^ get_unsigned(payload, bit, length)) * 16777619UL;
+	}
+
+	return check;
+}
+
+/**
+ * Decode a position report, type 1, 2 or 3 from class A or 18 or 19 from class B, into its target
+ *
+ * @param payload The payload
+ * @param type The message type
+ * @param target The target
+ * @return If the payload was long enough for its type
+ */
+static bool decode_position(const payload_t *payload, uint8_t type, ais_target_t *target)
+{
+	if (type <= 3U)
+	{
+		if (payload->length < 137U)
+		{
+			return false;
+		}
+		target->class_b = false;
+		target->navigation_status = (uint8_t)get_unsigned(payload, 38U, 4U);
+		target->sog = (uint16_t)get_unsigned(payload, 50U, 10U);
+		target->longitude = get_signed(payload, 61U, 28U);
+		target->latitude = get_signed(payload, 89U, 27U);
+		target->cog = (uint16_t)get_unsigned(payload, 116U, 12U);
+		target->heading = (uint16_t)get_unsigned(payload, 128U, 9U);
+
+		return true;
+	}
+
+	if (payload->length < (type == 19U ? 301U : 133U))
+	{
+		return false;
+	}
+	target->class_b = true;
+	target->navigation_status = AIS_NAVIGATION_STATUS_NOT_DEFINED;
+	target->sog = (uint16_t)get_unsigned(payload, 46U, 10U);
+	target->longitude = get_signed(payload, 57U, 28U);
+	target->latitude = get_signed(payload, 85U, 27U);
+	target->cog = (uint16_t)get_unsigned(payload, 112U, 12U);
+	target->heading = (uint16_t)get_unsigned(payload, 124U, 9U);
+
+	// extended class B report carries static data too, it is kept but forwarding goes by the position
+	if (type == 19U)
+	{
+		get_text(payload, 143U, AIS_NAME_LENGTH, target->name);
+		target->ship_type = (uint8_t)get_unsigned(payload, 263U, 8U);
+		target->to_bow = (uint16_t)get_unsigned(payload, 271U, 9U);
+		target->to_stern = (uint16_t)get_unsigned(payload, 280U, 9U);
+		target->to_port = (uint8_t)get_unsigned(payload, 289U, 6U);
+		target->to_starboard = (uint8_t)get_unsigned(payload, 295U, 6U);
+	}
+
+	return true;
+}
+
+/**
+ * Decode static data, type 5 from class A or 24 part A or B from class B, into its target
+ *
+ * @param payload The payload
+ * @param type The message type
+ * @param target The target
+ * @param part Set to the static data part, 0 for type 5 and type 24 part A, 1 for type 24 part B
+ * @return If the payload was long enough for its type and part
+ */
+static bool decode_static(const payload_t *payload, uint8_t type, ais_target_t *target, uint8_t *part)
+{
+	if (type == 5U)
+	{
+		if (payload->length < 422U)
+		{
+			return false;
+		}
+		*part = 0U;
+		target->class_b = false;
+		target->imo_number = get_unsigned(payload, 40U, 30U);
+		get_text(payload, 70U, AIS_CALLSIGN_LENGTH, target->callsign);
+		get_text(payload, 112U, AIS_NAME_LENGTH, target->name);
+		target->ship_type = (uint8_t)get_unsigned(payload, 232U, 8U);
+		target->to_bow = (uint16_t)get_unsigned(payload, 240U, 9U);
+		target->to_stern = (uint16_t)get_unsigned(payload, 249U, 9U);
+		target->to_port = (uint8_t)get_unsigned(payload, 258U, 6U);
+		target->to_starboard = (uint8_t)get_unsigned(payload, 264U, 6U);
+		target->draught = (uint8_t)get_unsigned(payload, 294U, 8U);
+		get_text(payload, 302U, AIS_NAME_LENGTH, target->destination);
+
+		return true;
+	}
+
+	if (payload->length < 40U)
+	{
+		return false;
+	}
+	*part = (uint8_t)get_unsigned(payload, 38U, 2U);
+	if (*part == 0U)
+	{
+		if (payload->length < 160U)
+		{
+			return false;
+		}
+		get_text(payload, 40U, AIS_NAME_LENGTH, target->name);
+	}
+	else if (*part == 1U)
+	{
+		if (payload->length < 162U)
+		{
+			return false;
+		}
+		target->ship_type = (uint8_t)get_unsigned(payload, 40U, 8U);
+		get_text(payload, 90U, AIS_CALLSIGN_LENGTH, target->callsign);
+		target->to_bow = (uint16_t)get_unsigned(payload, 132U, 9U);
+		target->to_stern = (uint16_t)get_unsigned(payload, 141U, 9U);
+		target->to_port = (uint8_t)get_unsigned(payload, 150U, 6U);
+		target->to_starboard = (uint8_t)get_unsigned(payload, 156U, 6U);
+	}
+	else
+	{
+		return false;
+	}
+	target->class_b = true;
+
+	return true;
+}
+
+/**
+ * Decide if a target's latest position report tells something the last forwarded one did not
+ *
+ * @param target The target, updated with the latest report
+ * @param time_ms Time now
+ * @return If the report should be forwarded
+ */
+static bool position_is_news(const ais_target_t *target, uint32_t time_ms)
+{
+	float north_m;
+	float east_m;
+	uint16_t difference;
+	bool available;
+	bool forwarded_available;
+
+	if (!target->forwarded || time_ms - target->last_forward_time >= AIS_FORWARD_MAXIMUM_INTERVAL_MS ||
+			target->navigation_status != target->forwarded_navigation_status)
+	{
+		return true;
+	}
+
+	if ((target->sog == AIS_SOG_NOT_AVAILABLE) != (target->forwarded_sog == AIS_SOG_NOT_AVAILABLE))
+	{
+		return true;
+	}
+	difference = target->sog > target->forwarded_sog ? target->sog - target->forwarded_sog : target->forwarded_sog - target->sog;
+	if (target->sog != AIS_SOG_NOT_AVAILABLE && difference >= AIS_FORWARD_SOG_CHANGE)
+	{
+		return true;
+	}
+
+	// COG of a slow or stopped vessel wanders, only a turn under way counts
+	if ((target->cog < AIS_COG_NOT_AVAILABLE) != (target->forwarded_cog < AIS_COG_NOT_AVAILABLE))
+	{
+		return true;
+	}
+	if (target->cog < AIS_COG_NOT_AVAILABLE && target->sog != AIS_SOG_NOT_AVAILABLE && target->sog >= AIS_FORWARD_COG_MINIMUM_SOG &&
+			angle_difference(target->cog, target->forwarded_cog, 3600U) >= AIS_FORWARD_COG_CHANGE)
+	{
+		return true;
+	}
+
+	if ((target->heading < 360U) != (target->forwarded_heading < 360U))
+	{
+		return true;
+	}
+	if (target->heading < 360U && angle_difference(target->heading, target->forwarded_heading, 360U) >= AIS_FORWARD_HEADING_CHANGE)
+	{
+		return true;
+	}
+
+	available = target->latitude != AIS_LATITUDE_NOT_AVAILABLE && target->longitude != AIS_LONGITUDE_NOT_AVAILABLE;
+	forwarded_available = target->forwarded_latitude != AIS_LATITUDE_NOT_AVAILABLE &&
+			target->forwarded_longitude != AIS_LONGITUDE_NOT_AVAILABLE;
+	if (available != forwarded_available)
+	{
+		return true;
+	}
+	if (available)
+	{
+		// flat earth is plenty over tens of metres
+		north_m = (float)(target->latitude - target->forwarded_latitude) * AIS_METRES_PER_UNIT;
+		east_m = (float)(target->longitude - target->forwarded_longitude) * AIS_METRES_PER_UNIT *
+				cosf((float)target->latitude * AIS_RADIANS_PER_UNIT);
+		if (north_m * north_m + east_m * east_m >= AIS_FORWARD_DISTANCE_M * AIS_FORWARD_DISTANCE_M)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Work out the smaller difference between two angles
+ *
+ * @param a First angle
+ * @param b Second angle
+ * @param full_circle A full circle in the units of the angles
+ * @return The difference, 0 to half a circle
+ */
+static uint16_t angle_difference(uint16_t a, uint16_t b, uint16_t full_circle)
+{
+	uint16_t difference = a > b ? a - b : b - a;
+
+	if (difference > full_circle / 2U)
+	{
+		difference = full_circle - difference;
+	}
+
+	return difference;
+}
+
+/**
+ * Work out where in the index an MMSI is first looked for
+ *
+ * @param mmsi The MMSI
+ * @return Index entry
+ */
+static uint16_t index_home(uint32_t mmsi)
+{
+	return (uint16_t)(((mmsi * 2654435761UL) >> 16) & (AIS_TARGET_INDEX_SIZE - 1U));
+}
+
+/**
+ * Find the index entry of an MMSI by linear probing from its home entry
+ *
+ * @param mmsi The MMSI
+ * @return The entry holding the MMSI or the unused entry where it would go
+ */
+static uint16_t index_find(uint32_t mmsi)
+{
+	uint16_t entry = index_home(mmsi);
+
+	while (target_index[entry] != AIS_INDEX_NONE && targets[target_index[entry] - 1U].mmsi != mmsi)
+	{
+		entry = (uint16_t)((entry + 1U) & (AIS_TARGET_INDEX_SIZE - 1U));
+	}
+
+	return entry;
+}
+
+/**
+ * Add a target to the table, making room by removing the one heard from longest ago if the table is full. When every
+ * target has been heard from within AIS_EVICTION_MINIMUM_AGE_MS nothing is removed, as taking turns in the table
+ * would leave no target there long enough to suppress any of its reports.
+ *
+ * @param mmsi The MMSI, not already in the table
+ * @param time_ms Time now
+ * @return The new target or NULL if there was no room
+ */
+static ais_target_t *add_target(uint32_t mmsi, uint32_t time_ms)
+{
+	ais_target_t *target;
+	uint16_t number = 0U;
+	uint16_t i;
+
+	if (target_count == AIS_MAXIMUM_TARGETS)
+	{
+		for (i = 1U; i < AIS_MAXIMUM_TARGETS; i++)
+		{
+			if (time_ms - targets[i].last_report_time > time_ms - targets[number].last_report_time)
+			{
+				number = i;
+			}
+		}
+		if (time_ms - targets[number].last_report_time < AIS_EVICTION_MINIMUM_AGE_MS)
+		{
+			return NULL;
+		}
+		remove_target(number);
+		stats.targets_evicted++;
+	}
+	else
+	{
+		while (targets[number].mmsi != 0UL)
+		{
+			number++;
+		}
+	}
+
+	target = &targets[number];
+	(void)memset(target, 0, sizeof(ais_target_t));
+	target->mmsi = mmsi;
+	target->last_report_time = time_ms;
+	target->latitude = AIS_LATITUDE_NOT_AVAILABLE;
+	target->longitude = AIS_LONGITUDE_NOT_AVAILABLE;
+	target->sog = AIS_SOG_NOT_AVAILABLE;
+	target->cog = AIS_COG_NOT_AVAILABLE;
+	target->heading = AIS_HEADING_NOT_AVAILABLE;
+	target->navigation_status = AIS_NAVIGATION_STATUS_NOT_DEFINED;
+	for (i = 0U; i < AIS_STATIC_PARTS; i++)
+	{
+		target->last_static_forward_time[i] = time_ms - AIS_FORWARD_STATIC_INTERVAL_MS;
+	}
+	target_index[index_find(mmsi)] = (uint16_t)(number + 1U);
+	target_count++;
+	stats.targets_added++;
+
+	return target;
+}
+
+/**
+ * Remove a target from the table and its index entry. Entries after it in the same probe run are moved back so that
+ * lookups do not need markers for removed entries.
+ *
+ * @param number The target's position in the table
+ */
+static void remove_target(uint16_t number)
+{
+	uint16_t empty = index_find(targets[number].mmsi);
+	uint16_t entry = empty;
+	uint16_t home;
+
+	target_index[empty] = AIS_INDEX_NONE;
+	for (;;)
+	{
+		entry = (uint16_t)((entry + 1U) & (AIS_TARGET_INDEX_SIZE - 1U));
+		if (target_index[entry] == AIS_INDEX_NONE)
+		{
+			break;
+		}
+
+		// an entry whose home is not cyclically between the gap and itself would not be found past the gap
+		home = index_home(targets[target_index[entry] - 1U].mmsi);
+		if (((entry - home) & (AIS_TARGET_INDEX_SIZE - 1U)) >= ((entry - empty) & (AIS_TARGET_INDEX_SIZE - 1U)))
+		{
+			target_index[empty] = target_index[entry];
+			target_index[entry] = AIS_INDEX_NONE;
+			empty = entry;
+		}
+	}
+
+	targets[number].mmsi = 0UL;
+	target_count--;
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+void ais_init(void)
+{
+	(void)memset(reassemblies, 0, sizeof(reassemblies));
+	(void)memset(targets, 0, sizeof(targets));
+	(void)memset(target_index, 0, sizeof(target_index));
+	(void)memset(&stats, 0, sizeof(stats));
+	target_count = 0U;
+	last_ageing_time = 0UL;
+}
+
+ais_result_t ais_receive_fragment(const nmea_message_data_VDM_t *fragment, uint32_t time_ms,
+		const nmea_message_data_VDM_t **fragments, uint8_t *fragment_count)
+{
+	if (fragment == NULL || fragments == NULL || fragment_count == NULL)
+	{
+		return ais_result_error;
+	}
+
+	stats.fragments++;
+	if (time_ms - last_ageing_time >= AIS_AGEING_INTERVAL_MS)
+	{
+		ais_remove_old_targets(time_ms);
+	}
+
+	// a sentence without fragment fields is taken as a whole message
+	if ((fragment->data_available & NMEA_VDM_FRAGMENT_COUNT_PRESENT) == 0UL || fragment->fragment_count == 1U)
+	{
+		*fragments = fragment;
+		*fragment_count = 1U;
+		return process_message(fragment, 1U, time_ms);
+	}
+
+	if ((fragment->data_available & NMEA_VDM_FRAGMENT_NUMBER_PRESENT) == 0UL || fragment->fragment_count == 0U ||
+			fragment->fragment_number == 0U || fragment->fragment_number > fragment->fragment_count)
+	{
+		stats.payload_errors++;
+		return ais_result_error;
+	}
+
+	// messages too long to reassemble go on a fragment at a time as they arrive
+	if (fragment->fragment_count > AIS_MAXIMUM_FRAGMENTS)
+	{
+		if (fragment->fragment_number == 1U)
+		{
+			stats.passed_on++;
+		}
+		*fragments = fragment;
+		*fragment_count = 1U;
+		return ais_result_forward;
+	}
+
+	return receive_multiple(fragment, time_ms, fragments, fragment_count);
+}
+
+const ais_target_t *ais_get_target(uint32_t mmsi)
+{
+	uint16_t entry;
+
+	if (mmsi == 0UL)
+	{
+		return NULL;
+	}
+
+	entry = index_find(mmsi);
+	if (target_index[entry] == AIS_INDEX_NONE)
+	{
+		return NULL;
+	}
+
+	return &targets[target_index[entry] - 1U];
+}
+
+const ais_target_t *ais_get_target_at(uint16_t index)
+{
+	if (index >= AIS_MAXIMUM_TARGETS || targets[index].mmsi == 0UL)
+	{
+		return NULL;
+	}
+
+	return &targets[index];
+}
+
+uint16_t ais_get_target_count(void)
+{
+	return target_count;
+}
+
+void ais_set_position_callback(ais_position_callback_t callback)
+{
+	position_callback = callback;
+}
+
+void ais_remove_old_targets(uint32_t time_ms)
+{
+	uint16_t i;
+
+	last_ageing_time = time_ms;
+	for (i = 0U; i < AIS_MAXIMUM_TARGETS; i++)
+	{
+		if (targets[i].mmsi != 0UL && time_ms - targets[i].last_report_time >= AIS_TARGET_TIMEOUT_MS)
+		{
+			remove_target(i);
+			stats.targets_aged++;
+		}
+	}
+}
+
+void ais_get_stats(ais_stats_t *stats_copy)
+{
+	if (stats_copy != NULL)
+	{
+		*stats_copy = stats;
+	}
+}
@@ -0,0 +1,232 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef AIS_H
+#define AIS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nmea.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define AIS_MAXIMUM_TARGETS						256U				///< Targets kept in the table, the one heard from longest ago makes room for a new one
+#define AIS_EVICTION_MINIMUM_AGE_MS				60000UL				///< A target heard from more recently than this is not removed to make room, the new one goes untracked
+#define AIS_TARGET_INDEX_SIZE					512U				///< Slots in the MMSI index, a power of 2 and at least twice AIS_MAXIMUM_TARGETS
+#define AIS_MAXIMUM_FRAGMENTS					3U					///< Most VDM fragments of a message that are reassembled, longer messages are passed on unchanged
+#define AIS_REASSEMBLY_SLOTS					4U					///< Multi-fragment messages being reassembled at the same time
+#define AIS_REASSEMBLY_TIMEOUT_MS				2000UL				///< Time allowed from the first to the last fragment of a message
+#define AIS_TARGET_TIMEOUT_MS					420000UL			///< Targets not heard from for this long are removed, 7 minutes covers a class A ship at anchor
+#define AIS_FORWARD_MAXIMUM_INTERVAL_MS			30000UL				///< Position reports of a target are forwarded at least this often
+#define AIS_FORWARD_STATIC_INTERVAL_MS			360000UL			///< Unchanged static data of a target is forwarded at least this often
+#define AIS_FORWARD_DISTANCE_M					30.0f				///< Movement since the last forwarded position that makes a report worth forwarding
+#define AIS_FORWARD_SOG_CHANGE					10U					///< Change in SOG in 0.1 knots since the last forwarded report that makes it worth forwarding
+#define AIS_FORWARD_COG_CHANGE					50U					///< Change in COG in 0.1 degrees since the last forwarded report that makes it worth forwarding
+#define AIS_FORWARD_HEADING_CHANGE				5U					///< Change in heading in degrees since the last forwarded report that makes it worth forwarding
+#define AIS_FORWARD_COG_MINIMUM_SOG				10U					///< SOG in 0.1 knots below which COG changes are ignored as noise
+#define AIS_STATIC_PARTS						2U					///< Parts static data is sent in, type 5 or 24 part A is part 0 and type 24 part B is part 1
+#define AIS_NAME_LENGTH							20U					///< Characters in a name or destination
+#define AIS_CALLSIGN_LENGTH						7U					///< Characters in a callsign
+#define AIS_LATITUDE_NOT_AVAILABLE				(54000000L)			///< 91 degrees in 1/10000 minutes
+#define AIS_LONGITUDE_NOT_AVAILABLE				(108600000L)		///< 181 degrees in 1/10000 minutes
+#define AIS_SOG_NOT_AVAILABLE					1023U				///< SOG value when not available
+#define AIS_COG_NOT_AVAILABLE					3600U				///< COG value when not available
+#define AIS_HEADING_NOT_AVAILABLE				511U				///< Heading value when not available
+#define AIS_NAVIGATION_STATUS_NOT_DEFINED		15U					///< Navigation status value when not defined
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * What to do with the fragments of a received message
+ */
+typedef enum
+{
+	ais_result_incomplete,			///< More fragments are needed, nothing to forward yet
+	ais_result_forward,				///< Forward the fragments given back
+	ais_result_suppressed,			///< The message tells nothing new about its target and is not forwarded
+	ais_result_error				///< The fragment was out of sequence or its payload could not be decoded, it is dropped
+} ais_result_t;
+
+/**
+ * A vessel heard on AIS. Positions and movement are kept in the units they are sent in.
+ */
+typedef struct
+{
+	uint32_t mmsi;									///< MMSI, 0 for an unused table entry
+	uint32_t last_report_time;						///< Time in ms the target was last heard from
+	uint32_t last_forward_time;						///< Time in ms a position report was last forwarded
+	uint32_t last_static_forward_time[AIS_STATIC_PARTS];	///< Time in ms each part of the static data was last forwarded
+	uint32_t static_check[AIS_STATIC_PARTS];		///< Check value of each part of the static data last forwarded
+	int32_t latitude;								///< Latitude in 1/10000 minutes, north positive, AIS_LATITUDE_NOT_AVAILABLE if not known
+	int32_t longitude;								///< Longitude in 1/10000 minutes, east positive, AIS_LONGITUDE_NOT_AVAILABLE if not known
+	int32_t forwarded_latitude;						///< Latitude of the last forwarded position report
+	int32_t forwarded_longitude;					///< Longitude of the last forwarded position report
+	uint16_t sog;									///< Speed over ground in 0.1 knots, AIS_SOG_NOT_AVAILABLE if not known
+	uint16_t cog;									///< Course over ground in 0.1 degrees, AIS_COG_NOT_AVAILABLE if not known
+	uint16_t heading;								///< True heading in degrees, AIS_HEADING_NOT_AVAILABLE if not known
+	uint16_t forwarded_sog;							///< SOG of the last forwarded position report
+	uint16_t forwarded_cog;							///< COG of the last forwarded position report
+	uint16_t forwarded_heading;						///< Heading of the last forwarded position report
+	uint8_t navigation_status;						///< Navigation status, class A only
+	uint8_t forwarded_navigation_status;			///< Navigation status of the last forwarded position report
+	uint8_t last_message_type;						///< AIS message type last received
+	bool class_b;									///< If the target is a class B station
+	bool forwarded;									///< If a position report of the target has been forwarded
+	uint8_t ship_type;								///< Ship and cargo type, 0 if not known
+	uint32_t imo_number;							///< IMO number, 0 if not known
+	uint16_t to_bow;								///< Distance from reference point to bow in m
+	uint16_t to_stern;								///< Distance from reference point to stern in m
+	uint8_t to_port;								///< Distance from reference point to port side in m
+	uint8_t to_starboard;							///< Distance from reference point to starboard side in m
+	uint8_t draught;								///< Draught in 0.1 m, 0 if not known
+	char name[AIS_NAME_LENGTH + 1];					///< Name, trailing spaces and @ removed
+	char callsign[AIS_CALLSIGN_LENGTH + 1];			///< Callsign, trailing spaces and @ removed
+	char destination[AIS_NAME_LENGTH + 1];			///< Destination, class A only
+} ais_target_t;
+
+/**
+ * Counters of AIS messages received
+ */
+typedef struct
+{
+	uint32_t fragments;				///< VDM fragments given to ais_receive_fragment
+	uint32_t messages;				///< Complete messages
+	uint32_t decoded;				///< Messages of the types decoded into the target table
+	uint32_t passed_on;				///< Messages of other types or too long to reassemble, forwarded unchanged
+	uint32_t reassembly_failed;		///< Partly received messages dropped because a fragment was missing or late
+	uint32_t payload_errors;		///< Messages dropped because their payload was bad or too short for their type
+	uint32_t forwarded;				///< Decoded messages forwarded
+	uint32_t suppressed;			///< Decoded messages not forwarded as they told nothing new
+	uint32_t targets_added;			///< Targets added to the table
+	uint32_t targets_aged;			///< Targets removed as not heard from for AIS_TARGET_TIMEOUT_MS
+	uint32_t targets_evicted;		///< Targets removed to make room for a new one
+	uint32_t untracked;				///< Messages forwarded without a target as the table was full of targets heard recently
+} ais_stats_t;
+
+/**
+ * Typedef of callback function called when a position report of a target has been decoded
+ *
+ * @param index The target's index in the table, as used by ais_get_target_at
+ * @param target The target with the new position
+ * @param time_ms Time the report was received
+ */
+typedef void (*ais_position_callback_t)(uint16_t index, const ais_target_t *target, uint32_t time_ms);
+
+/*************************
+*** EXTERNAL VARIABLES ***
+*************************/
+
+/***************************
+*** FUNCTIONS PROTOTYPES ***
+***************************/
+
+/**
+ * Clear the target table, partly received messages and counters
+ */
+void ais_init(void);
+
+/**
+ * Give a received VDM fragment. Fragments of a message are collected by channel and sequential message identifier
+ * until the last one arrives. The complete message is then decoded and, for message types 1, 2, 3, 5, 18, 19 and 24,
+ * its target in the table is updated. The result tells if the message should be forwarded, a position report only
+ * when the target has moved, turned, changed speed or status or has not been forwarded for
+ * AIS_FORWARD_MAXIMUM_INTERVAL_MS and static data only when it has changed or has not been forwarded for
+ * AIS_FORWARD_STATIC_INTERVAL_MS. Messages of other types are always forwarded, as are messages of targets that do not
+ * fit in the table.
+ *
+ * @note Not thread safe, call from the task that runs nmea_process() and read targets from there too
+ * @param fragment The decoded VDM sentence
+ * @param time_ms Time now
+ * @param fragments Set to the fragments to forward when the result is ais_result_forward, valid until the next call
+ * @param fragment_count Set to the number of fragments to forward when the result is ais_result_forward
+ * @return What to do with the message
+ */
+ais_result_t ais_receive_fragment(const nmea_message_data_VDM_t *fragment, uint32_t time_ms,
+		const nmea_message_data_VDM_t **fragments, uint8_t *fragment_count);
+
+/**
+ * Find a target by MMSI
+ *
+ * @param mmsi The MMSI
+ * @return The target or NULL if it is not in the table
+ */
+const ais_target_t *ais_get_target(uint32_t mmsi);
+
+/**
+ * Get a table entry by its index, to go through all targets
+ *
+ * @param index From 0 to AIS_MAXIMUM_TARGETS - 1
+ * @return The target or NULL if the entry is unused or index is out of range
+ */
+const ais_target_t *ais_get_target_at(uint16_t index);
+
+/**
+ * Get the number of targets in the table
+ *
+ * @return Targets in the table
+ */
+uint16_t ais_get_target_count(void);
+
+/**
+ * Set the function called whenever a position report has updated a target, forwarded or not. The index of a target
+ * is given to the next target added when it is removed.
+ *
+ * @param callback The function or NULL for none
+ */
+void ais_set_position_callback(ais_position_callback_t callback);
+
+/**
+ * Remove targets not heard from for AIS_TARGET_TIMEOUT_MS. This is also done by ais_receive_fragment every few
+ * seconds so only needs calling when no AIS is received.
+ *
+ * @param time_ms Time now
+ */
+void ais_remove_old_targets(uint32_t time_ms);
+
+/**
+ * Get the counters, counted since ais_init
+ *
+ * @param stats Where to copy the counters
+ */
+void ais_get_stats(ais_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
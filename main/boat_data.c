@@ -0,0 +1,291 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "boat_data.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+/************
+*** TYPES ***
+************/
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static void read_group(uint8_t group, boat_data_entry_t *destination);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static boat_data_entry_t entries[boat_data_channel_max];		///< All channels, written only inside boat_data_mux
+static uint32_t sequences[boat_data_group_max];					///< Per group count of write starts and ends, odd while a write is in progress
+static portMUX_TYPE boat_data_mux = portMUX_INITIALIZER_UNLOCKED;	///< Serialises writers, readers never take it
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**
+ * First channel of each group, and one after the last channel of the last group
+ */
+static const uint8_t group_first_channels[boat_data_group_max + 1] =
+{
+	boat_data_latitude,
+	boat_data_speed_over_ground,
+	boat_data_heading_true,
+	boat_data_depth,
+	boat_data_trip,
+	boat_data_apparent_wind_speed,
+	boat_data_true_wind_speed,
+	boat_data_pressure,
+	boat_data_gmt,
+	boat_data_channel_max
+};
+
+/**
+ * Group of each channel
+ */
+static const uint8_t channel_groups[boat_data_channel_max] =
+{
+	boat_data_group_position,			// latitude
+	boat_data_group_position,			// longitude
+	boat_data_group_motion,				// SOG
+	boat_data_group_motion,				// COG
+	boat_data_group_heading,			// heading true
+	boat_data_group_heading,			// variation
+	boat_data_group_water,				// depth
+	boat_data_group_water,				// boat speed
+	boat_data_group_water,				// water temperature
+	boat_data_group_log,				// trip
+	boat_data_group_log,				// total distance
+	boat_data_group_apparent_wind,		// AWS
+	boat_data_group_apparent_wind,		// AWA
+	boat_data_group_true_wind,			// TWS
+	boat_data_group_true_wind,			// TWA
+	boat_data_group_true_wind,			// wind direction true
+	boat_data_group_true_wind,			// wind direction magnetic
+	boat_data_group_environment,		// pressure
+	boat_data_group_environment,		// exhaust temperature
+	boat_data_group_time,				// time
+	boat_data_group_time				// date
+};
+
+/**
+ * Maximum age of each channel before it is considered stale
+ */
+static const uint32_t max_ages[boat_data_channel_max] =
+{
+	LATITUDE_MAX_DATA_AGE_MS,
+	LONGITUDE_MAX_DATA_AGE_MS,
+	SOG_MAX_DATA_AGE_MS,
+	COG_MAX_DATA_AGE_MS,
+	HEADING_TRUE_MAX_DATA_AGE_MS,
+	WMM_CALCULATION_MAX_DATA_AGE,
+	DEPTH_MAX_DATA_AGE_MS,
+	BOAT_SPEED_MAX_DATA_AGE_MS,
+	TEMPERATURE_MAX_DATA_AGE_MS,
+	TRIP_MAX_DATA_AGE_MS,
+	TOTAL_DISTANCE_MAX_DATA_AGE_MS,
+	APPARENT_WIND_SPEED_MAX_DATA_AGE_MS,
+	APPARENT_WIND_ANGLE_MAX_DATA_AGE_MS,
+	TRUE_WIND_SPEED_MAX_DATA_AGE_MS,
+	TRUE_WIND_ANGLE_MAX_DATA_AGE_MS,
+	WIND_DIRECTION_TRUE_MAX_DATA_AGE_MS,
+	WIND_DIRECTION_MAGNETIC_MAX_DATA_AGE_MS,
+	PRESSURE_MAX_DATA_AGE_MS,
+	EXHAUST_TEMPERATURE_MAX_DATA_AGE_MS,
+	GMT_MAX_DATA_AGE_MS,
+	DATE_MAX_DATA_AGE_MS
+};
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/**
+ * Copy a group's channels as they were between two writes. The sequence is even and unchanged across the copy only
+ * if no write to the group started or ended during it. A writer on this core cannot be interrupted by the reader as it
+ * is in a critical section, so the copy is only tried again when a writer on the other core was at work.
+ *
+ * @param group The group
+ * @param destination Channel array to copy into, indexed by channel
+ */
+static void read_group(uint8_t group, boat_data_entry_t *destination)
+{
+	uint8_t first = group_first_channels[group];
+	size_t size = (size_t)(group_first_channels[group + 1U] - first) * sizeof(boat_data_entry_t);
+	uint32_t start;
+	uint32_t end;
+
+	do
+	{
+		start = __atomic_load_n(&sequences[group], __ATOMIC_ACQUIRE);
+		(void)memcpy(&destination[first], &entries[first], size);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		end = __atomic_load_n(&sequences[group], __ATOMIC_RELAXED);
+	}
+	while ((start & 1UL) != 0UL || start != end);
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+void boat_data_init(void)
+{
+	portENTER_CRITICAL(&boat_data_mux);
+	(void)memset(entries, 0, sizeof(entries));
+	portEXIT_CRITICAL(&boat_data_mux);
+}
+
+void boat_data_set(boat_data_channel_t channel, float number, boat_data_source_t source, uint32_t time_ms)
+{
+	boat_data_update_t update;
+
+	update.channel = channel;
+	update.value.number = number;
+	boat_data_set_values(&update, 1U, source, time_ms);
+}
+
+void boat_data_set_values(const boat_data_update_t *updates, uint8_t count, boat_data_source_t source, uint32_t time_ms)
+{
+	uint32_t groups = 0UL;
+	uint8_t group;
+	uint8_t i;
+
+	if (updates == NULL)
+	{
+		return;
+	}
+	if (count > BOAT_DATA_MAX_UPDATES)
+	{
+		count = BOAT_DATA_MAX_UPDATES;
+	}
+
+	for (i = 0U; i < count; i++)
+	{
+		if (updates[i].channel < boat_data_channel_max)
+		{
+			groups |= 1UL << channel_groups[updates[i].channel];
+		}
+	}
+	if (groups == 0UL)
+	{
+		return;
+	}
+
+	portENTER_CRITICAL(&boat_data_mux);
+
+	// sequences go odd before any entry changes and even again after all have
+	for (group = 0U; group < (uint8_t)boat_data_group_max; group++)
+	{
+		if ((groups & (1UL << group)) != 0UL)
+		{
+			__atomic_store_n(&sequences[group], sequences[group] + 1UL, __ATOMIC_RELAXED);
+		}
+	}
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	for (i = 0U; i < count; i++)
+	{
+		if (updates[i].channel < boat_data_channel_max)
+		{
+			entries[updates[i].channel].value = updates[i].value;
+			entries[updates[i].channel].time_ms = time_ms;
+			entries[updates[i].channel].source = source;
+			entries[updates[i].channel].valid = true;
+		}
+	}
+
+	for (group = 0U; group < (uint8_t)boat_data_group_max; group++)
+	{
+		if ((groups & (1UL << group)) != 0UL)
+		{
+			__atomic_store_n(&sequences[group], sequences[group] + 1UL, __ATOMIC_RELEASE);
+		}
+	}
+
+	portEXIT_CRITICAL(&boat_data_mux);
+}
+
+void boat_data_get_group(boat_data_group_t group, boat_data_snapshot_t *snapshot)
+{
+	if (snapshot == NULL || group >= boat_data_group_max)
+	{
+		return;
+	}
+
+	read_group((uint8_t)group, snapshot->entries);
+}
+
+void boat_data_get_all(boat_data_snapshot_t *snapshot)
+{
+	uint8_t group;
+
+	if (snapshot == NULL)
+	{
+		return;
+	}
+
+	for (group = 0U; group < (uint8_t)boat_data_group_max; group++)
+	{
+		read_group(group, snapshot->entries);
+	}
+}
+
+bool boat_data_fresh(const boat_data_snapshot_t *snapshot, boat_data_channel_t channel, uint32_t time_ms)
+{
+	const boat_data_entry_t *entry;
+
+	if (snapshot == NULL || channel >= boat_data_channel_max)
+	{
+		return false;
+	}
+
+	// signed so a value written just after time_ms was read is fresh, not 49 days old
+	entry = &snapshot->entries[channel];
+	return entry->valid && (int32_t)(time_ms - entry->time_ms) < (int32_t)max_ages[channel];
+}
+
+uint32_t boat_data_max_age(boat_data_channel_t channel)
+{
+	if (channel >= boat_data_channel_max)
+	{
+		return 0UL;
+	}
+
+	return max_ages[channel];
+}
@@ -0,0 +1,263 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef BOAT_DATA_H
+#define BOAT_DATA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**************
+*** DEFINES ***
+**************/
+
+#define PRESSURE_MAX_DATA_AGE_MS				30000UL						///< Maximum age allowed for atmospheric pressure data before it is considered stale in milliseconds
+#define GMT_MAX_DATA_AGE_MS						12000UL						///< Maximum age allowed for time data before it is considered stale in milliseconds
+#define DATE_MAX_DATA_AGE_MS					12000UL						///< Maximum age allowed for date data before it is considered stale in milliseconds
+#define COG_MAX_DATA_AGE_MS						4000UL						///< Maximum age allowed for COG data before it is considered stale in milliseconds
+#define SOG_MAX_DATA_AGE_MS						4000UL						///< Maximum age allowed for SOG data before it is considered stale in milliseconds
+#define LATITUDE_MAX_DATA_AGE_MS				4000UL						///< Maximum age allowed for latitude data before it is considered stale in milliseconds
+#define LONGITUDE_MAX_DATA_AGE_MS				4000UL						///< Maximum age allowed for longitude data before it is considered stale in milliseconds
+#define DEPTH_MAX_DATA_AGE_MS					4000UL						///< Maximum age allowed for depth data before it is considered stale in milliseconds
+#define HEADING_TRUE_MAX_DATA_AGE_MS			4000UL						///< Maximum age allowed for compass heading data before it is considered stale in milliseconds
+#define BOAT_SPEED_MAX_DATA_AGE_MS				4000UL						///< Maximum age allowed for boat speed through water data before it is considered stale in milliseconds
+#define WMM_CALCULATION_MAX_DATA_AGE			(60UL * 60UL * 1000UL)		///< Maximum age allowed for world magnetic model calculation data before it is considered stale in milliseconds
+#define APPARENT_WIND_ANGLE_MAX_DATA_AGE_MS		4000UL						///< Maximum age allowed for apparent wind angle data before it is considered stale in milliseconds
+#define APPARENT_WIND_SPEED_MAX_DATA_AGE_MS		4000UL						///< Maximum age allowed for apparent wind speed data before it is considered stale in milliseconds
+#define TRIP_MAX_DATA_AGE_MS					8000UL						///< Maximum age allowed for trip distance data before it is considered stale in milliseconds
+#define TOTAL_DISTANCE_MAX_DATA_AGE_MS			8000UL						///< Maximum age allowed for total distance data before it is considered stale in milliseconds
+#define TEMPERATURE_MAX_DATA_AGE_MS				4000UL						///< Maximum age allowed for water temperature data before it is considered stale in milliseconds
+#define TRUE_WIND_ANGLE_MAX_DATA_AGE_MS			4000UL						///< Maximum age allowed for true wind angle data before it is considered stale in milliseconds
+#define TRUE_WIND_SPEED_MAX_DATA_AGE_MS			4000UL						///< Maximum age allowed for truw wind speed data before it is considered stale in milliseconds
+#define WIND_DIRECTION_MAGNETIC_MAX_DATA_AGE_MS	4000UL						///< Maximum age allowed for wind direction magnetic data before it is considered stale in milliseconds
+#define WIND_DIRECTION_TRUE_MAX_DATA_AGE_MS		4000UL						///< Maximum age allowed for wind direction true data before it is considered stale in milliseconds
+#define EXHAUST_TEMPERATURE_MAX_DATA_AGE_MS		4000UL						///< Maximum age allowed for engine exhaust temperature data before it is considered stale in milliseconds
+#define BOAT_DATA_MAX_UPDATES					8U							///< Most channels written in one call of boat_data_set_values
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Structure to hold a date
+ */
+typedef struct
+{
+	uint8_t year;		///< Year of 21st century 0-99
+	uint8_t month;		///< Month 1-12
+	uint8_t date;		///< Date 1-31
+} my_date_t;
+
+/**
+ * Structure to hold a time
+ */
+typedef struct
+{
+	uint8_t hour;		///< Hour 0-23
+	uint8_t minute;		///< Minute 0-59
+	uint8_t second;		///< Second 0-59
+} my_time_t;
+
+/**
+ * Groups of channels that are read together. A group is always read as it was after one write, so for example
+ * latitude and longitude never come from different fixes.
+ */
+typedef enum
+{
+	boat_data_group_position,			///< Latitude and longitude
+	boat_data_group_motion,				///< SOG and COG
+	boat_data_group_heading,			///< Heading true and magnetic variation
+	boat_data_group_water,				///< Depth, boat speed through water and water temperature
+	boat_data_group_log,				///< Trip and total distance
+	boat_data_group_apparent_wind,		///< AWS and AWA
+	boat_data_group_true_wind,			///< TWS, TWA and wind directions, all worked out from one apparent wind message
+	boat_data_group_environment,		///< Atmospheric pressure and engine exhaust temperature
+	boat_data_group_time,				///< Time and date
+	boat_data_group_max					/* must be last value */
+} boat_data_group_t;
+
+/**
+ * All boat data channels, ordered by group so a group's channels are next to each other
+ */
+typedef enum
+{
+	boat_data_latitude,					///< Latitude in degrees, north positive
+	boat_data_longitude,				///< Longitude in degrees, east positive
+	boat_data_speed_over_ground,		///< SOG in knots
+	boat_data_course_over_ground,		///< COG in whole degrees true
+	boat_data_heading_true,				///< Compass heading in degrees true
+	boat_data_variation,				///< Magnetic variation from world magnetic model in degrees, east positive
+	boat_data_depth,					///< Depth below surface, or below transducer if offset is not known, in m
+	boat_data_boat_speed,				///< Boat speed through water in knots
+	boat_data_seawater_temperature,		///< Water temperature in C
+	boat_data_trip,						///< Trip distance in nautical miles
+	boat_data_total_distance,			///< Total distance in nautical miles
+	boat_data_apparent_wind_speed,		///< AWS in knots
+	boat_data_apparent_wind_angle,		///< AWA in degrees
+	boat_data_true_wind_speed,			///< TWS in knots
+	boat_data_true_wind_angle,			///< TWA in degrees
+	boat_data_wind_direction_true,		///< Wind direction in degrees true
+	boat_data_wind_direction_magnetic,	///< Wind direction in degrees magnetic
+	boat_data_pressure,					///< Atmospheric pressure in mb
+	boat_data_exhaust_temperature,		///< Engine exhaust temperature in C
+	boat_data_gmt,						///< Time UTC, in value.time
+	boat_data_date,						///< Date UTC, in value.date
+	boat_data_channel_max				/* must be last value */
+} boat_data_channel_t;
+
+/**
+ * Where a channel's value came from
+ */
+typedef enum
+{
+	boat_data_source_none,				///< Never written
+	boat_data_source_n2k,				///< Received on NMEA2000
+	boat_data_source_nmea0183,			///< Received on NMEA0183
+	boat_data_source_sensor,			///< Read from a sensor on this board
+	boat_data_source_calculated,		///< Worked out here from other channels
+	boat_data_source_test				///< Simulated test data
+} boat_data_source_t;
+
+/**
+ * Value of a channel. Time and date channels use time and date, all others number.
+ */
+typedef union
+{
+	float number;						///< Value of a numeric channel
+	my_time_t time;						///< Value of boat_data_gmt
+	my_date_t date;						///< Value of boat_data_date
+} boat_data_value_t;
+
+/**
+ * A channel as stored and as copied to a snapshot
+ */
+typedef struct
+{
+	boat_data_value_t value;			///< Latest value
+	uint32_t time_ms;					///< Time the value was written
+	boat_data_source_t source;			///< Where the value came from
+	bool valid;							///< If the channel has been written since boat_data_init
+} boat_data_entry_t;
+
+/**
+ * A new value for one channel
+ */
+typedef struct
+{
+	boat_data_channel_t channel;		///< The channel
+	boat_data_value_t value;			///< Its new value
+} boat_data_update_t;
+
+/**
+ * Copy of channels, each group in it as it was after one write
+ */
+typedef struct
+{
+	boat_data_entry_t entries[boat_data_channel_max];	///< Indexed by channel
+} boat_data_snapshot_t;
+
+/*************************
+*** EXTERNAL VARIABLES ***
+*************************/
+
+/***************************
+*** FUNCTIONS PROTOTYPES ***
+***************************/
+
+/**
+ * Mark all channels as never written. Call before any task reads or writes.
+ */
+void boat_data_init(void);
+
+/**
+ * Write one numeric channel
+ *
+ * @param channel The channel
+ * @param number Its new value
+ * @param source Where the value came from
+ * @param time_ms Time now
+ */
+void boat_data_set(boat_data_channel_t channel, float number, boat_data_source_t source, uint32_t time_ms);
+
+/**
+ * Write channels that belong together, such as latitude and longitude of one fix, so that no reader sees some new and
+ * some old. Channels may be from several groups. Any task may write, writers are serialised by a short critical
+ * section.
+ *
+ * @param updates The channels and new values
+ * @param count Number of updates, up to BOAT_DATA_MAX_UPDATES, more are ignored
+ * @param source Where the values came from
+ * @param time_ms Time now
+ */
+void boat_data_set_values(const boat_data_update_t *updates, uint8_t count, boat_data_source_t source, uint32_t time_ms);
+
+/**
+ * Copy the channels of one group to a snapshot, other channels in it are left alone. Never blocks, the copy is only
+ * tried again if a write to the group happened during it.
+ *
+ * @param group The group
+ * @param snapshot Where to copy the group's channels
+ */
+void boat_data_get_group(boat_data_group_t group, boat_data_snapshot_t *snapshot);
+
+/**
+ * Copy all channels to a snapshot, group by group
+ *
+ * @param snapshot Where to copy the channels
+ */
+void boat_data_get_all(boat_data_snapshot_t *snapshot);
+
+/**
+ * Check if a channel in a snapshot has been written and is not older than the channel's maximum data age
+ *
+ * @param snapshot The snapshot
+ * @param channel The channel
+ * @param time_ms Time now, may be slightly before the channel was written when read before the snapshot was taken
+ * @return If fresh
+ */
+bool boat_data_fresh(const boat_data_snapshot_t *snapshot, boat_data_channel_t channel, uint32_t time_ms);
+
+/**
+ * Get the maximum age of a channel's value before it is considered stale
+ *
+ * @param channel The channel
+ * @return The age in ms
+ */
+uint32_t boat_data_max_age(boat_data_channel_t channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,634 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+/***************
+*** INCLUDES ***
+***************/
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "capture.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define CAPTURE_TASK_STACK_SIZE		2048U		///< Stack size for task that empties the capture buffer
+#define CAPTURE_TASK_PRIORITY		1U			///< Same as the main task, the sink may be slow
+#define CAPTURE_DRAIN_PERIOD_MS		100U		///< Time between emptying the capture buffer
+#define CAPTURE_DRAIN_CHUNK			256U		///< Most bytes passed to the sink at once
+#define REPLAY_TASK_STACK_SIZE		3072U		///< Stack size for replay task
+#define REPLAY_TASK_PRIORITY		4U			///< Above the firmware tasks as it stands in for interrupts
+#define REPLAY_SERIAL_BUFFER_SIZE	2048U		///< Same as the UART driver receive buffer
+#define HEADER_LENGTH				8U			///< Bytes in capture header
+#define RECORD_LENGTH_MAX			(1U + 10U + 1U + 255U)	///< Tag, longest varint, length byte and data
+#define TAG_STREAM_SHIFT			4U			///< Stream number is in the top nibble of a record tag
+#define TAG_CAN_LENGTH_MASK			0x0fU		///< CAN data length is in the bottom nibble of a CAN record tag
+#define SERIAL_RECORD_DATA_MAX		255U		///< Most bytes in one serial record
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Byte ring buffer
+ */
+typedef struct
+{
+	uint8_t *data;				///< Storage
+	size_t size;				///< Size of storage
+	size_t head;				///< Index of next byte written
+	size_t tail;				///< Index of next byte read
+	size_t used;				///< Bytes in the buffer
+} byte_ring_t;
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static void ring_write(byte_ring_t *ring, const uint8_t *data, size_t length);
+static size_t ring_read(byte_ring_t *ring, uint8_t *data, size_t length);
+static size_t encode_varint(uint64_t value, uint8_t *data);
+static void capture_record(uint8_t tag, const uint8_t *prefix, size_t prefix_length, const uint8_t *data, size_t length);
+static void capture_drain(void);
+static void capture_task(void *parameters);
+static bool replay_read_exact(uint8_t *data, size_t length);
+static bool replay_read_varint(uint64_t *value);
+static bool replay_deliver(capture_stream_t stream, unsigned long id, const uint8_t *data, size_t length);
+static void replay_task(void *parameters);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static portMUX_TYPE capture_mux = portMUX_INITIALIZER_UNLOCKED;	///< Guards the ring buffers and figures
+static capture_stats_t capture_stats;							///< Figures
+static byte_ring_t capture_ring;								///< Encoded records waiting for the sink
+static capture_sink_t capture_sink;								///< Where capture data goes
+static int64_t capture_last_us;									///< Time of the previous captured record
+static TaskHandle_t capture_task_handle;						///< Task that empties the capture buffer
+static SemaphoreHandle_t capture_drain_mutex;					///< Keeps sink writes in order when capture_stop drains
+static byte_ring_t replay_rings[CAPTURE_STREAM_COUNT];			///< Replayed serial bytes waiting to be read
+static capture_source_t replay_source;							///< Where replay data comes from
+static uint32_t replay_speed;									///< Replay speed multiplier, 0 for maximum
+static capture_can_injector_t can_injector;						///< Where replayed CAN frames go
+static bool replay_running;										///< Replay task exists
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+static const uint8_t header_magic[4] = {'B', 'B', 'C', 'P'};	///< First bytes of a capture
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/**
+ * Write to a ring buffer, caller checks there is space and holds capture_mux
+ *
+ * @param ring The ring buffer
+ * @param data The bytes to write
+ * @param length Number of bytes
+ */
+static void ring_write(byte_ring_t *ring, const uint8_t *data, size_t length)
+{
+	size_t first = ring->size - ring->head;
+
+	if (first > length)
+	{
+		first = length;
+	}
+	(void)memcpy(&ring->data[ring->head], data, first);
+	(void)memcpy(ring->data, &data[first], length - first);
+	ring->head = (ring->head + length) % ring->size;
+	ring->used += length;
+}
+
+/**
+ * Read from a ring buffer, caller holds capture_mux
+ *
+ * @param ring The ring buffer
+ * @param data Where to put the bytes
+ * @param length Most bytes to read
+ * @return Number of bytes read
+ */
+static size_t ring_read(byte_ring_t *ring, uint8_t *data, size_t length)
+{
+	size_t first;
+
+	if (length > ring->used)
+	{
+		length = ring->used;
+	}
+	first = ring->size - ring->tail;
+	if (first > length)
+	{
+		first = length;
+	}
+	(void)memcpy(data, &ring->data[ring->tail], first);
+	(void)memcpy(&data[first], ring->data, length - first);
+	ring->tail = (ring->tail + length) % ring->size;
+	ring->used -= length;
+
+	return length;
+}
+
+/**
+ * Encode an unsigned LEB128 varint
+ *
+ * @param value The value
+ * @param data Where to put the encoding, at least 10 bytes
+ * @return Number of bytes used
+ */
+static size_t encode_varint(uint64_t value, uint8_t *data)
+{
+	size_t length = 0U;
+
+	do
+	{
+		data[length] = (uint8_t)(value & 0x7fU);
+		value >>= 7;
+		if (value != 0ULL)
+		{
+			data[length] |= 0x80U;
+		}
+		length++;
+	}
+	while (value != 0ULL);
+
+	return length;
+}
+
+/**
+ * Encode a record and add it to the capture buffer
+ *
+ * @param tag Record tag
+ * @param prefix Bytes after the time, the CAN identifier or serial length
+ * @param prefix_length Number of prefix bytes
+ * @param data Record data
+ * @param length Number of data bytes
+ */
+static void capture_record(uint8_t tag, const uint8_t *prefix, size_t prefix_length, const uint8_t *data, size_t length)
+{
+	uint8_t header[1U + 10U + 4U];
+	size_t header_length;
+	int64_t now;
+
+	portENTER_CRITICAL_SAFE(&capture_mux);
+	if (capture_stats.capturing)
+	{
+		now = esp_timer_get_time();
+		header[0] = tag;
+		header_length = 1U + encode_varint((uint64_t)(now - capture_last_us), &header[1]);
+		(void)memcpy(&header[header_length], prefix, prefix_length);
+		header_length += prefix_length;
+
+		if (capture_ring.size - capture_ring.used >= header_length + length)
+		{
+			ring_write(&capture_ring, header, header_length);
+			ring_write(&capture_ring, data, length);
+			capture_last_us = now;
+			capture_stats.captured[tag >> TAG_STREAM_SHIFT]++;
+		}
+		else
+		{
+			capture_stats.capture_overflows++;
+		}
+	}
+	portEXIT_CRITICAL_SAFE(&capture_mux);
+}
+
+/**
+ * Pass everything in the capture buffer to the sink
+ */
+static void capture_drain(void)
+{
+	uint8_t chunk[CAPTURE_DRAIN_CHUNK];
+	size_t length;
+
+	(void)xSemaphoreTake(capture_drain_mutex, portMAX_DELAY);
+	if (capture_ring.data != NULL)
+	{
+		do
+		{
+			portENTER_CRITICAL(&capture_mux);
+			length = ring_read(&capture_ring, chunk, sizeof(chunk));
+			portEXIT_CRITICAL(&capture_mux);
+
+			if (length > 0U && capture_sink(chunk, length) < length)
+			{
+				// sink is full or failed so nothing more can be stored, throw away the rest
+				portENTER_CRITICAL(&capture_mux);
+				capture_stats.capturing = false;
+				capture_ring.used = 0U;
+				capture_ring.tail = capture_ring.head;
+				portEXIT_CRITICAL(&capture_mux);
+				break;
+			}
+			capture_stats.capture_bytes += (uint64_t)length;
+		}
+		while (length > 0U);
+	}
+	(void)xSemaphoreGive(capture_drain_mutex);
+}
+
+/**
+ * Task that empties the capture buffer to the sink until capture stops
+ *
+ * @param parameters Unused
+ */
+static void capture_task(void *parameters)
+{
+	(void)parameters;
+
+	while (capture_stats.capturing)
+	{
+		vTaskDelay(pdMS_TO_TICKS(CAPTURE_DRAIN_PERIOD_MS));
+		capture_drain();
+	}
+
+	(void)xSemaphoreTake(capture_drain_mutex, portMAX_DELAY);
+	vPortFree(capture_ring.data);
+	capture_ring.data = NULL;
+	capture_task_handle = NULL;
+	(void)xSemaphoreGive(capture_drain_mutex);
+	vTaskDelete(NULL);
+}
+
+/**
+ * Read bytes from the replay source
+ *
+ * @param data Where to put the bytes
+ * @param length Number of bytes wanted
+ * @return true if all bytes were read, false at the end of the capture
+ */
+static bool replay_read_exact(uint8_t *data, size_t length)
+{
+	size_t read;
+
+	while (length > 0U)
+	{
+		read = replay_source(data, length);
+		if (read == 0U)
+		{
+			return false;
+		}
+		data += read;
+		length -= read;
+	}
+
+	return true;
+}
+
+/**
+ * Read an unsigned LEB128 varint from the replay source
+ *
+ * @param value Where to put the value
+ * @return true if read, false at the end of the capture or if too long
+ */
+static bool replay_read_varint(uint64_t *value)
+{
+	uint8_t byte;
+	uint32_t shift = 0UL;
+
+	*value = 0ULL;
+	do
+	{
+		if (shift > 63UL || !replay_read_exact(&byte, (size_t)1))
+		{
+			return false;
+		}
+		*value |= (uint64_t)(byte & 0x7fU) << shift;
+		shift += 7UL;
+	}
+	while ((byte & 0x80U) != 0U);
+
+	return true;
+}
+
+/**
+ * Give a replayed record to the firmware
+ *
+ * @param stream The stream the record is from
+ * @param id CAN identifier, unused for serial streams
+ * @param data Record data
+ * @param length Number of data bytes
+ * @return true if delivered, false if the receiving queue or buffer was full
+ */
+static bool replay_deliver(capture_stream_t stream, unsigned long id, const uint8_t *data, size_t length)
+{
+	bool delivered = false;
+
+	if (stream == CAPTURE_STREAM_CAN)
+	{
+		return can_injector != NULL && can_injector(id, (unsigned char)length, data);
+	}
+
+	portENTER_CRITICAL(&capture_mux);
+	if (replay_rings[stream].size - replay_rings[stream].used >= length)
+	{
+		ring_write(&replay_rings[stream], data, length);
+		delivered = true;
+	}
+	portEXIT_CRITICAL(&capture_mux);
+
+	return delivered;
+}
+
+/**
+ * Task that reads the capture and delivers each record when due
+ *
+ * @param parameters Unused
+ */
+static void replay_task(void *parameters)
+{
+	uint8_t header[HEADER_LENGTH];
+	uint8_t data[SERIAL_RECORD_DATA_MAX];
+	uint8_t id_bytes[4];
+	uint8_t tag;
+	uint8_t length;
+	uint64_t delta_us;
+	uint64_t record_us = 0ULL;
+	int64_t start_us;
+	int64_t wait_us;
+	unsigned long id = 0UL;
+	capture_stream_t stream;
+
+	(void)parameters;
+
+	if (!replay_read_exact(header, sizeof(header)) || memcmp(header, header_magic, sizeof(header_magic)) != 0 ||
+			header[4] != (uint8_t)CAPTURE_FORMAT_VERSION)
+	{
+		capture_stats.replay_errors++;
+	}
+	else
+	{
+		start_us = esp_timer_get_time();
+		while (replay_read_exact(&tag, (size_t)1))
+		{
+			stream = (capture_stream_t)(tag >> TAG_STREAM_SHIFT);
+			if (stream >= CAPTURE_STREAM_COUNT || !replay_read_varint(&delta_us))
+			{
+				capture_stats.replay_errors++;
+				break;
+			}
+
+			if (stream == CAPTURE_STREAM_CAN)
+			{
+				length = tag & TAG_CAN_LENGTH_MASK;
+				if (length > 8U || !replay_read_exact(id_bytes, sizeof(id_bytes)))
+				{
+					capture_stats.replay_errors++;
+					break;
+				}
+				id = (unsigned long)id_bytes[0] | ((unsigned long)id_bytes[1] << 8) | ((unsigned long)id_bytes[2] << 16) |
+						((unsigned long)id_bytes[3] << 24);
+			}
+			else if (!replay_read_exact(&length, (size_t)1))
+			{
+				capture_stats.replay_errors++;
+				break;
+			}
+			if (!replay_read_exact(data, (size_t)length))
+			{
+				capture_stats.replay_errors++;
+				break;
+			}
+			record_us += delta_us;
+
+			if (replay_speed == 0UL)
+			{
+				while (!replay_deliver(stream, id, data, (size_t)length))
+				{
+					capture_stats.replay_stalls++;
+					vTaskDelay((TickType_t)1);
+				}
+			}
+			else
+			{
+				wait_us = start_us + (int64_t)(record_us / replay_speed) - esp_timer_get_time();
+				if (wait_us >= (int64_t)portTICK_PERIOD_MS * 1000LL)
+				{
+					vTaskDelay((TickType_t)(wait_us / ((int64_t)portTICK_PERIOD_MS * 1000LL)));
+				}
+				if (!replay_deliver(stream, id, data, (size_t)length))
+				{
+					capture_stats.replay_dropped[stream]++;
+					continue;
+				}
+			}
+			capture_stats.replayed[stream]++;
+			capture_stats.replay_time_us = record_us;
+		}
+	}
+
+	replay_running = false;
+	vTaskDelete(NULL);
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+bool capture_start(size_t buffer_size, capture_sink_t sink)
+{
+	uint8_t header[HEADER_LENGTH] = {0U};
+
+	if (capture_stats.capturing || capture_task_handle != NULL || sink == NULL || buffer_size < RECORD_LENGTH_MAX)
+	{
+		return false;
+	}
+
+	if (capture_drain_mutex == NULL)
+	{
+		capture_drain_mutex = xSemaphoreCreateMutex();
+		if (capture_drain_mutex == NULL)
+		{
+			return false;
+		}
+	}
+
+	capture_ring.data = pvPortMalloc(buffer_size);
+	if (capture_ring.data == NULL)
+	{
+		return false;
+	}
+	capture_ring.size = buffer_size;
+	capture_ring.head = 0U;
+	capture_ring.tail = 0U;
+	capture_ring.used = 0U;
+	capture_sink = sink;
+
+	(void)memcpy(header, header_magic, sizeof(header_magic));
+	header[4] = (uint8_t)CAPTURE_FORMAT_VERSION;
+	ring_write(&capture_ring, header, sizeof(header));
+
+	(void)memset(capture_stats.captured, 0, sizeof(capture_stats.captured));
+	capture_stats.capture_bytes = 0ULL;
+	capture_stats.capture_overflows = 0UL;
+	capture_last_us = esp_timer_get_time();
+	capture_stats.capturing = true;
+
+	if (xTaskCreate(capture_task, "capture", CAPTURE_TASK_STACK_SIZE, NULL, CAPTURE_TASK_PRIORITY, &capture_task_handle) != pdPASS)
+	{
+		capture_stats.capturing = false;
+		vPortFree(capture_ring.data);
+		capture_ring.data = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+void capture_stop(void)
+{
+	portENTER_CRITICAL(&capture_mux);
+	capture_stats.capturing = false;
+	portEXIT_CRITICAL(&capture_mux);
+
+	if (capture_drain_mutex != NULL)
+	{
+		capture_drain();
+	}
+}
+
+void capture_can_frame(unsigned long id, unsigned char length, const unsigned char *data)
+{
+	uint8_t id_bytes[4];
+
+	if (!capture_stats.capturing)
+	{
+		return;
+	}
+
+	if (length > 8U)
+	{
+		length = 8U;
+	}
+	id_bytes[0] = (uint8_t)id;
+	id_bytes[1] = (uint8_t)(id >> 8);
+	id_bytes[2] = (uint8_t)(id >> 16);
+	id_bytes[3] = (uint8_t)(id >> 24);
+	capture_record((uint8_t)length, id_bytes, sizeof(id_bytes), data, (size_t)length);
+}
+
+void capture_serial(capture_stream_t stream, const uint8_t *data, size_t length)
+{
+	uint8_t chunk_length;
+
+	if (!capture_stats.capturing || stream == CAPTURE_STREAM_CAN || stream >= CAPTURE_STREAM_COUNT)
+	{
+		return;
+	}
+
+	while (length > 0U)
+	{
+		chunk_length = length > SERIAL_RECORD_DATA_MAX ? (uint8_t)SERIAL_RECORD_DATA_MAX : (uint8_t)length;
+		capture_record((uint8_t)((uint32_t)stream << TAG_STREAM_SHIFT), &chunk_length, (size_t)1, data, (size_t)chunk_length);
+		data += chunk_length;
+		length -= chunk_length;
+	}
+}
+
+void capture_set_can_injector(capture_can_injector_t injector)
+{
+	can_injector = injector;
+}
+
+bool capture_replay_start(capture_source_t source, uint32_t speed)
+{
+	capture_stream_t stream;
+
+	if (replay_running || source == NULL)
+	{
+		return false;
+	}
+
+	for (stream = CAPTURE_STREAM_N0183; stream < CAPTURE_STREAM_COUNT; stream++)
+	{
+		if (replay_rings[stream].data == NULL)
+		{
+			replay_rings[stream].data = pvPortMalloc(REPLAY_SERIAL_BUFFER_SIZE);
+			if (replay_rings[stream].data == NULL)
+			{
+				return false;
+			}
+			replay_rings[stream].size = REPLAY_SERIAL_BUFFER_SIZE;
+		}
+	}
+
+	replay_source = source;
+	replay_speed = speed;
+	(void)memset(capture_stats.replayed, 0, sizeof(capture_stats.replayed));
+	(void)memset(capture_stats.replay_dropped, 0, sizeof(capture_stats.replay_dropped));
+	capture_stats.replay_stalls = 0UL;
+	capture_stats.replay_time_us = 0ULL;
+	replay_running = true;
+
+	if (xTaskCreate(replay_task, "replay", REPLAY_TASK_STACK_SIZE, NULL, REPLAY_TASK_PRIORITY, NULL) != pdPASS)
+	{
+		replay_running = false;
+		return false;
+	}
+
+	return true;
+}
+
+bool capture_replay_is_active(void)
+{
+	return replay_running || replay_rings[CAPTURE_STREAM_N0183].used > 0U || replay_rings[CAPTURE_STREAM_SPP].used > 0U;
+}
+
+size_t capture_replay_read(capture_stream_t stream, size_t buffer_length, uint8_t *data)
+{
+	size_t length;
+
+	if (stream == CAPTURE_STREAM_CAN || stream >= CAPTURE_STREAM_COUNT || replay_rings[stream].data == NULL)
+	{
+		return (size_t)0;
+	}
+
+	portENTER_CRITICAL(&capture_mux);
+	length = ring_read(&replay_rings[stream], data, buffer_length);
+	portEXIT_CRITICAL(&capture_mux);
+
+	return length;
+}
+
+void capture_get_stats(capture_stats_t *stats)
+{
+	portENTER_CRITICAL(&capture_mux);
+	*stats = capture_stats;
+	stats->replaying = replay_running;
+	portEXIT_CRITICAL(&capture_mux);
+}
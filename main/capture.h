@@ -0,0 +1,206 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**************
+*** DEFINES ***
+**************/
+
+#define CAPTURE_FORMAT_VERSION		1U			///< Version byte written in the capture header
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Input streams that can be captured and replayed
+ */
+typedef enum
+{
+	CAPTURE_STREAM_CAN = 0,			///< NMEA2000 CAN frames as read from the CAN controller
+	CAPTURE_STREAM_N0183,			///< Bytes read from the NMEA0183 UART by serial_1_read_data
+	CAPTURE_STREAM_SPP,				///< Bytes read from Bluetooth SPP by serial_2_read_data
+	CAPTURE_STREAM_COUNT			///< Number of streams, not a stream
+} capture_stream_t;
+
+/**
+ * Function that stores capture data
+ *
+ * @param data The capture data
+ * @param length Number of bytes
+ * @return Number of bytes stored, less than length stops the capture
+ */
+typedef size_t (*capture_sink_t)(const uint8_t *data, size_t length);
+
+/**
+ * Function that supplies capture data for replay
+ *
+ * @param data Where to put the data
+ * @param length Most bytes wanted
+ * @return Number of bytes supplied, 0 at the end of the capture
+ */
+typedef size_t (*capture_source_t)(uint8_t *data, size_t length);
+
+/**
+ * Function that puts a CAN frame into the receive queue of the CAN driver as if it had been received
+ *
+ * @param id The 29 bit frame identifier
+ * @param length Number of data bytes, 0 to 8
+ * @param data The data bytes
+ * @return true if queued, false if the receive queue was full
+ */
+typedef bool (*capture_can_injector_t)(unsigned long id, unsigned char length, const unsigned char *data);
+
+/**
+ * Capture and replay figures
+ */
+typedef struct
+{
+	bool capturing;									///< Capture is running
+	uint32_t captured[CAPTURE_STREAM_COUNT];		///< Records captured per stream
+	uint64_t capture_bytes;							///< Bytes passed to the sink including the header
+	uint32_t capture_overflows;						///< Records lost because the capture buffer was full
+	bool replaying;									///< Replay is running
+	uint32_t replayed[CAPTURE_STREAM_COUNT];		///< Records delivered per stream
+	uint32_t replay_dropped[CAPTURE_STREAM_COUNT];	///< Records lost because the receiving queue or buffer was full
+	uint32_t replay_stalls;							///< Waits for space in a receiving queue at maximum speed
+	uint32_t replay_errors;							///< Replays stopped by a bad header or a truncated record
+	uint64_t replay_time_us;						///< Capture time of the last record delivered
+} capture_stats_t;
+
+/*************************
+*** EXTERNAL VARIABLES ***
+*************************/
+
+/***************************
+*** FUNCTIONS PROTOTYPES ***
+***************************/
+
+/**
+ * Start capturing the input streams. Records are encoded into a buffer in RAM which a task empties to the sink every
+ * 100 ms, so the sink is never called from an interrupt. The sink can be slow but if the buffer fills records are lost
+ * and counted.
+ *
+ * Capture format, all values little endian:
+ *  header  'B' 'B' 'C' 'P' version 0 0 0
+ *  record  tag, microseconds since the previous record as an unsigned LEB128 varint, then
+ *          for CAN (tag 0x00 + data length) the 32 bit identifier and the data bytes,
+ *          for a serial stream (tag 0x10 * stream) a length byte of 1 to 255 and the bytes
+ *
+ * @param buffer_size Size of the RAM buffer in bytes
+ * @param sink Function that stores the capture data
+ * @return true if started, false if already capturing or no memory
+ */
+bool capture_start(size_t buffer_size, capture_sink_t sink);
+
+/**
+ * Stop capturing and pass everything buffered to the sink before returning
+ */
+void capture_stop(void);
+
+/**
+ * Record a CAN frame received by the CAN controller. Safe to call from an interrupt. Does nothing when not capturing.
+ *
+ * @param id The 29 bit frame identifier
+ * @param length Number of data bytes, 0 to 8
+ * @param data The data bytes
+ */
+void capture_can_frame(unsigned long id, unsigned char length, const unsigned char *data);
+
+/**
+ * Record bytes read from a serial stream. Does nothing when not capturing.
+ *
+ * @param stream CAPTURE_STREAM_N0183 or CAPTURE_STREAM_SPP
+ * @param data The bytes read
+ * @param length Number of bytes
+ */
+void capture_serial(capture_stream_t stream, const uint8_t *data, size_t length);
+
+/**
+ * Set the function used to replay CAN frames
+ *
+ * @param injector The function, NULL to drop replayed CAN frames
+ */
+void capture_set_can_injector(capture_can_injector_t injector);
+
+/**
+ * Start replaying a capture in a task. While replaying, serial_1_read_data and serial_2_read_data return replayed bytes
+ * instead of reading the UART and Bluetooth, and CAN frames are given to the CAN injector alongside any frames from the
+ * bus.
+ *
+ * At a speed of 1 or more the records are delivered at the captured times divided by the speed and records that do not
+ * fit in the receiving queue are dropped and counted, as they would be on a bus or serial line that much faster. At speed 0
+ * the records are delivered as fast as the firmware takes them, waiting a tick whenever a receiving queue is full, which
+ * gives the highest rate the firmware can sustain.
+ *
+ * @param source Function that supplies the capture data
+ * @param speed Replay speed multiplier, 0 for maximum
+ * @return true if started, false if already replaying
+ */
+bool capture_replay_start(capture_source_t source, uint32_t speed);
+
+/**
+ * Find out if a replay is running
+ *
+ * @return true if replaying
+ */
+bool capture_replay_is_active(void);
+
+/**
+ * Read replayed bytes of a serial stream, used in place of reading the device while replaying
+ *
+ * @param stream CAPTURE_STREAM_N0183 or CAPTURE_STREAM_SPP
+ * @param buffer_length The length of the supplied buffer
+ * @param data The buffer to read data into
+ * @return How many bytes were read
+ */
+size_t capture_replay_read(capture_stream_t stream, size_t buffer_length, uint8_t *data);
+
+/**
+ * Get capture and replay figures
+ *
+ * @param stats Structure to fill
+ */
+void capture_get_stats(capture_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
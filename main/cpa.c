@@ -0,0 +1,703 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include "cpa.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define CPA_METRES_PER_UNIT				0.1852f				///< Metres of latitude in 1/10000 minute
+#define CPA_RADIANS_PER_DEGREE			(3.14159265f / 180.0f)	///< Radians in a degree
+#define CPA_UNITS_PER_DEGREE			600000.0f			///< 1/10000 minutes in a degree
+#define CPA_HALF_CIRCLE_UNITS			108000000L			///< 180 degrees in 1/10000 minutes
+#define CPA_MPS_PER_KNOT				0.514444f			///< Metres per second in a knot
+#define CPA_MINIMUM_SPEED_SQUARED		1.0e-4f				///< Relative speed squared in (m/s)^2 below which targets keep their distance
+#define CPA_NO_EVENT					0xffffU				///< heap_position of a target with no event pending
+#define CPA_WINDOWS						2U					///< Alarm windows of a target, one per alarm type
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Own ship moving in a straight line at constant speed, as assumed by the last recompute of all targets
+ */
+typedef struct
+{
+	bool valid;								///< If own ship is known
+	int32_t latitude;						///< Latitude at time_ms in 1/10000 minutes
+	int32_t longitude;						///< Longitude at time_ms in 1/10000 minutes
+	float east_mps;							///< Velocity east
+	float north_mps;						///< Velocity north
+	float metres_per_unit_east;				///< Metres of longitude in 1/10000 minute at own ship's latitude
+	uint32_t time_ms;						///< Time the track started
+	uint32_t last_fix_time;					///< Time of the last fix, on the track or not
+} track_t;
+
+/**
+ * What is known of a target. Its position relative to own ship is worked out once per report or own ship track and
+ * the alarm windows follow from that, as both move in straight lines.
+ */
+typedef struct
+{
+	uint32_t mmsi;							///< MMSI, 0 for an unused entry
+	uint32_t report_time;					///< Time of the last position report
+	int32_t latitude;						///< Latitude reported in 1/10000 minutes
+	int32_t longitude;						///< Longitude reported in 1/10000 minutes
+	float east_mps;							///< Velocity east
+	float north_mps;						///< Velocity north
+	uint32_t generation;					///< Own ship track generation the values below were worked out for
+	uint32_t reference_time;				///< Time the values below are for
+	float relative_east_m;					///< Position east of own ship at reference_time
+	float relative_north_m;					///< Position north of own ship at reference_time
+	float relative_east_mps;				///< Velocity east relative to own ship
+	float relative_north_mps;				///< Velocity north relative to own ship
+	float cpa_m;							///< Distance at closest point of approach
+	float tcpa_s;							///< Time from reference_time to closest point of approach
+	float window_start_s[CPA_WINDOWS];		///< Start of each alarm window from reference_time, start > end if none
+	float window_end_s[CPA_WINDOWS];		///< End of each alarm window from reference_time
+	uint32_t last_raise_time[CPA_WINDOWS];	///< Time each alarm was last raised
+	uint32_t event_time;					///< Time of the next alarm state change or timeout
+	uint16_t heap_position;					///< Position in event heap or CPA_NO_EVENT
+	uint8_t alarms;							///< Alarm conditions true now as cpa_alarm_type_t bits
+	uint8_t reported;						///< Alarms raised through the callback and not yet cleared
+} target_t;
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static void to_velocity(float sog_knots, float cog_degrees, float *east_mps, float *north_mps);
+static void compute(target_t *target, uint32_t time_ms);
+static void evaluate(uint16_t index, uint32_t time_ms);
+static void set_alarms(uint16_t index, uint8_t alarms, uint32_t time_ms);
+static void make_alarm(uint16_t index, cpa_alarm_type_t type, bool raised, uint32_t time_ms);
+static void remove_target(uint16_t index, uint32_t time_ms);
+static bool heap_earlier(uint16_t a, uint16_t b);
+static void heap_swap(uint16_t a, uint16_t b);
+static void heap_up(uint16_t position);
+static void heap_down(uint16_t position);
+static void heap_set(uint16_t index, uint32_t event_time);
+static void heap_remove(uint16_t index);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static target_t targets[AIS_MAXIMUM_TARGETS];				///< Targets by their AIS table index
+static uint16_t heap[AIS_MAXIMUM_TARGETS];					///< Min-heap of target indexes by event_time, heap[0] is next due
+static uint16_t heap_count;									///< Targets in heap
+static track_t own_ship;									///< Own ship track
+static uint32_t generation;									///< Own ship track generation, changed with every new track
+static uint16_t recompute_cursor;							///< Next target index looked at for recomputing
+static cpa_alarm_callback_t alarm_callback;					///< Called when an alarm is raised or cleared
+static cpa_stats_t stats;									///< Counters
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+static const cpa_alarm_type_t window_types[CPA_WINDOWS] = {cpa_alarm_collision, cpa_alarm_proximity};	///< Alarm of each window
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/**
+ * Turn speed and course into a velocity. Below CPA_STATIONARY_SOG_KNOTS or with course not known the vessel is taken
+ * as not moving.
+ *
+ * @param sog_knots Speed over ground in knots
+ * @param cog_degrees Course over ground in degrees true, negative if not known
+ * @param east_mps Set to velocity east
+ * @param north_mps Set to velocity north
+ */
+static void to_velocity(float sog_knots, float cog_degrees, float *east_mps, float *north_mps)
+{
+	float speed_mps;
+
+	if (sog_knots < CPA_STATIONARY_SOG_KNOTS || cog_degrees < 0.0f)
+	{
+		*east_mps = 0.0f;
+		*north_mps = 0.0f;
+		return;
+	}
+
+	speed_mps = sog_knots * CPA_MPS_PER_KNOT;
+	*east_mps = speed_mps * sinf(cog_degrees * CPA_RADIANS_PER_DEGREE);
+	*north_mps = speed_mps * cosf(cog_degrees * CPA_RADIANS_PER_DEGREE);
+}
+
+/**
+ * Work out closest point of approach and the alarm windows of a target against the own ship track. Distances are on a
+ * plane through own ship, which is close enough at the ranges alarms are raised at.
+ *
+ * @param target The target
+ * @param time_ms Time now, becomes the target's reference time
+ */
+static void compute(target_t *target, uint32_t time_ms)
+{
+	float target_s;
+	float own_s;
+	float speed_squared;
+	float half_s;
+	int32_t longitude_difference;
+	uint8_t i;
+
+	if (target->generation != generation)
+	{
+		target->generation = generation;
+		stats.backlog--;
+	}
+	target->reference_time = time_ms;
+	for (i = 0U; i < CPA_WINDOWS; i++)
+	{
+		target->window_start_s[i] = 1.0f;
+		target->window_end_s[i] = 0.0f;
+	}
+	if (!own_ship.valid)
+	{
+		return;
+	}
+
+	longitude_difference = target->longitude - own_ship.longitude;
+	if (longitude_difference > CPA_HALF_CIRCLE_UNITS)
+	{
+		longitude_difference -= 2L * CPA_HALF_CIRCLE_UNITS;
+	}
+	else if (longitude_difference < -CPA_HALF_CIRCLE_UNITS)
+	{
+		longitude_difference += 2L * CPA_HALF_CIRCLE_UNITS;
+	}
+
+	// both positions moved on to now along their tracks
+	target_s = (float)(int32_t)(time_ms - target->report_time) / 1000.0f;
+	own_s = (float)(int32_t)(time_ms - own_ship.time_ms) / 1000.0f;
+	target->relative_east_m = (float)longitude_difference * own_ship.metres_per_unit_east +
+			target->east_mps * target_s - own_ship.east_mps * own_s;
+	target->relative_north_m = (float)(target->latitude - own_ship.latitude) * CPA_METRES_PER_UNIT +
+			target->north_mps * target_s - own_ship.north_mps * own_s;
+	target->relative_east_mps = target->east_mps - own_ship.east_mps;
+	target->relative_north_mps = target->north_mps - own_ship.north_mps;
+
+	speed_squared = target->relative_east_mps * target->relative_east_mps +
+			target->relative_north_mps * target->relative_north_mps;
+	if (speed_squared < CPA_MINIMUM_SPEED_SQUARED)
+	{
+		// keeping station, range stays as it is until the next report
+		target->tcpa_s = 0.0f;
+		target->cpa_m = sqrtf(target->relative_east_m * target->relative_east_m +
+				target->relative_north_m * target->relative_north_m);
+		if (target->cpa_m < CPA_PROXIMITY_DISTANCE_M)
+		{
+			target->window_start_s[1] = -INFINITY;
+			target->window_end_s[1] = INFINITY;
+		}
+		return;
+	}
+
+	target->tcpa_s = -(target->relative_east_m * target->relative_east_mps +
+			target->relative_north_m * target->relative_north_mps) / speed_squared;
+	target->cpa_m = hypotf(target->relative_east_m + target->relative_east_mps * target->tcpa_s,
+			target->relative_north_m + target->relative_north_mps * target->tcpa_s);
+
+	if (target->cpa_m < CPA_COLLISION_DISTANCE_M)
+	{
+		target->window_start_s[0] = target->tcpa_s - CPA_COLLISION_TIME_S;
+		target->window_end_s[0] = target->tcpa_s;
+	}
+
+	// range is under the limit for as long as it takes to cover the chord of the limit circle the track cuts
+	if (target->cpa_m < CPA_PROXIMITY_DISTANCE_M)
+	{
+		half_s = sqrtf((CPA_PROXIMITY_DISTANCE_M * CPA_PROXIMITY_DISTANCE_M - target->cpa_m * target->cpa_m) /
+				speed_squared);
+		target->window_start_s[1] = target->tcpa_s - half_s;
+		target->window_end_s[1] = target->tcpa_s + half_s;
+	}
+}
+
+/**
+ * Set a target's alarms from where now is in its alarm windows and schedule its next event, the nearest window edge
+ * ahead or its timeout
+ *
+ * @param index The target's index
+ * @param time_ms Time now
+ */
+static void evaluate(uint16_t index, uint32_t time_ms)
+{
+	target_t *target = &targets[index];
+	float now_s = (float)(int32_t)(time_ms - target->reference_time) / 1000.0f;
+	float next_s = INFINITY;
+	uint32_t event_delay_ms = 0UL;
+	uint8_t alarms = 0U;
+	uint8_t i;
+
+	if (time_ms - target->report_time < CPA_TARGET_TIMEOUT_MS)
+	{
+		event_delay_ms = CPA_TARGET_TIMEOUT_MS - (time_ms - target->report_time);
+	}
+
+	for (i = 0U; i < CPA_WINDOWS; i++)
+	{
+		if (target->window_start_s[i] > target->window_end_s[i])
+		{
+			continue;
+		}
+		if (now_s >= target->window_start_s[i] && now_s < target->window_end_s[i])
+		{
+			alarms |= (uint8_t)window_types[i];
+			if (target->window_end_s[i] < next_s)
+			{
+				next_s = target->window_end_s[i];
+			}
+		}
+		else if (now_s < target->window_start_s[i] && target->window_start_s[i] < next_s)
+		{
+			next_s = target->window_start_s[i];
+		}
+	}
+	set_alarms(index, alarms, time_ms);
+
+	// rounded up so the edge has been passed when the event is handled
+	if ((next_s - now_s) * 1000.0f < (float)event_delay_ms)
+	{
+		event_delay_ms = (uint32_t)((next_s - now_s) * 1000.0f) + 1UL;
+	}
+	heap_set(index, time_ms + event_delay_ms);
+}
+
+/**
+ * Change a target's alarm conditions, raising or clearing alarms through the callback
+ *
+ * @param index The target's index
+ * @param alarms Alarm conditions true now
+ * @param time_ms Time now
+ */
+static void set_alarms(uint16_t index, uint8_t alarms, uint32_t time_ms)
+{
+	target_t *target = &targets[index];
+	uint8_t bit;
+	uint8_t i;
+
+	for (i = 0U; i < CPA_WINDOWS; i++)
+	{
+		bit = (uint8_t)window_types[i];
+		if ((alarms & bit) != 0U && (target->alarms & bit) == 0U)
+		{
+			// a target wandering across a limit would otherwise raise an alarm each time
+			if ((target->reported & bit) == 0U && time_ms - target->last_raise_time[i] >= CPA_REALARM_INTERVAL_MS)
+			{
+				if (target->reported == 0U)
+				{
+					stats.active_alarms++;
+				}
+				target->reported |= bit;
+				target->last_raise_time[i] = time_ms;
+				stats.alarms_raised++;
+				make_alarm(index, window_types[i], true, time_ms);
+			}
+			else
+			{
+				stats.alarms_held++;
+			}
+		}
+		else if ((alarms & bit) == 0U && (target->reported & bit) != 0U)
+		{
+			target->reported &= (uint8_t)~bit;
+			if (target->reported == 0U)
+			{
+				stats.active_alarms--;
+			}
+			stats.alarms_cleared++;
+			make_alarm(index, window_types[i], false, time_ms);
+		}
+	}
+	target->alarms = alarms;
+}
+
+/**
+ * Give an alarm of a target to the callback
+ *
+ * @param index The target's index
+ * @param type The alarm
+ * @param raised If it is raised or cleared
+ * @param time_ms Time now
+ */
+static void make_alarm(uint16_t index, cpa_alarm_type_t type, bool raised, uint32_t time_ms)
+{
+	const target_t *target = &targets[index];
+	float now_s = (float)(int32_t)(time_ms - target->reference_time) / 1000.0f;
+	cpa_alarm_t alarm;
+
+	if (alarm_callback == NULL)
+	{
+		return;
+	}
+
+	alarm.mmsi = target->mmsi;
+	alarm.index = index;
+	alarm.type = type;
+	alarm.raised = raised;
+	alarm.cpa_m = target->cpa_m;
+	alarm.tcpa_s = target->tcpa_s - now_s;
+	alarm.range_m = hypotf(target->relative_east_m + target->relative_east_mps * now_s,
+			target->relative_north_m + target->relative_north_mps * now_s);
+	alarm_callback(&alarm);
+}
+
+/**
+ * Forget a target, clearing any alarms it has raised
+ *
+ * @param index The target's index
+ * @param time_ms Time now
+ */
+static void remove_target(uint16_t index, uint32_t time_ms)
+{
+	target_t *target = &targets[index];
+
+	set_alarms(index, 0U, time_ms);
+	heap_remove(index);
+	if (target->generation != generation)
+	{
+		stats.backlog--;
+	}
+	target->mmsi = 0UL;
+	stats.targets--;
+}
+
+/**
+ * Compare event times of two targets, times wrap so compared by difference
+ *
+ * @param a Index of a target
+ * @param b Index of another target
+ * @return If a's event is earlier than b's
+ */
+static bool heap_earlier(uint16_t a, uint16_t b)
+{
+	return (int32_t)(targets[a].event_time - targets[b].event_time) < 0L;
+}
+
+/**
+ * Swap two heap entries, keeping targets' heap positions up to date
+ *
+ * @param a Heap position
+ * @param b Another heap position
+ */
+static void heap_swap(uint16_t a, uint16_t b)
+{
+	uint16_t index = heap[a];
+
+	heap[a] = heap[b];
+	heap[b] = index;
+	targets[heap[a]].heap_position = a;
+	targets[heap[b]].heap_position = b;
+}
+
+/**
+ * Move a heap entry towards the top until its parent is not later
+ *
+ * @param position Heap position
+ */
+static void heap_up(uint16_t position)
+{
+	uint16_t parent;
+
+	while (position > 0U)
+	{
+		parent = (uint16_t)((position - 1U) / 2U);
+		if (!heap_earlier(heap[position], heap[parent]))
+		{
+			break;
+		}
+		heap_swap(position, parent);
+		position = parent;
+	}
+}
+
+/**
+ * Move a heap entry towards the bottom until no child is earlier
+ *
+ * @param position Heap position
+ */
+static void heap_down(uint16_t position)
+{
+	uint16_t child;
+
+	for (;;)
+	{
+		child = (uint16_t)(position * 2U + 1U);
+		if (child >= heap_count)
+		{
+			break;
+		}
+		if (child + 1U < heap_count && heap_earlier(heap[child + 1U], heap[child]))
+		{
+			child++;
+		}
+		if (!heap_earlier(heap[child], heap[position]))
+		{
+			break;
+		}
+		heap_swap(position, child);
+		position = child;
+	}
+}
+
+/**
+ * Set or move a target's event
+ *
+ * @param index The target's index
+ * @param event_time Time of the event
+ */
+static void heap_set(uint16_t index, uint32_t event_time)
+{
+	target_t *target = &targets[index];
+
+	target->event_time = event_time;
+	if (target->heap_position == CPA_NO_EVENT)
+	{
+		target->heap_position = heap_count;
+		heap[heap_count] = index;
+		heap_count++;
+	}
+	heap_up(target->heap_position);
+	heap_down(target->heap_position);
+}
+
+/**
+ * Remove a target's event if it has one
+ *
+ * @param index The target's index
+ */
+static void heap_remove(uint16_t index)
+{
+	uint16_t position = targets[index].heap_position;
+
+	if (position == CPA_NO_EVENT)
+	{
+		return;
+	}
+
+	heap_count--;
+	if (position != heap_count)
+	{
+		heap_swap(position, heap_count);
+		heap_up(position);
+		heap_down(position);
+	}
+	targets[index].heap_position = CPA_NO_EVENT;
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+void cpa_init(cpa_alarm_callback_t callback)
+{
+	uint16_t i;
+
+	(void)memset(targets, 0, sizeof(targets));
+	for (i = 0U; i < AIS_MAXIMUM_TARGETS; i++)
+	{
+		targets[i].heap_position = CPA_NO_EVENT;
+	}
+	(void)memset(&own_ship, 0, sizeof(own_ship));
+	(void)memset(&stats, 0, sizeof(stats));
+	heap_count = 0U;
+	generation = 0UL;
+	recompute_cursor = 0U;
+	alarm_callback = callback;
+}
+
+void cpa_update_own_ship(float latitude, float longitude, float sog, float cog, uint32_t time_ms)
+{
+	float east_mps;
+	float north_mps;
+	float track_s;
+	float east_error_m;
+	float north_error_m;
+	int32_t fix_latitude = (int32_t)lroundf(latitude * CPA_UNITS_PER_DEGREE);
+	int32_t fix_longitude = (int32_t)lroundf(longitude * CPA_UNITS_PER_DEGREE);
+
+	stats.own_ship_updates++;
+	to_velocity(sog, cog, &east_mps, &north_mps);
+	own_ship.last_fix_time = time_ms;
+
+	if (own_ship.valid)
+	{
+		// the fix is compared with where the track says own ship is now
+		track_s = (float)(int32_t)(time_ms - own_ship.time_ms) / 1000.0f;
+		east_error_m = (float)(fix_longitude - own_ship.longitude) * own_ship.metres_per_unit_east -
+				own_ship.east_mps * track_s;
+		north_error_m = (float)(fix_latitude - own_ship.latitude) * CPA_METRES_PER_UNIT - own_ship.north_mps * track_s;
+		if (east_error_m * east_error_m + north_error_m * north_error_m <
+				CPA_OWN_SHIP_POSITION_ERROR_M * CPA_OWN_SHIP_POSITION_ERROR_M &&
+				(east_mps - own_ship.east_mps) * (east_mps - own_ship.east_mps) +
+				(north_mps - own_ship.north_mps) * (north_mps - own_ship.north_mps) <
+				CPA_OWN_SHIP_VELOCITY_ERROR_MPS * CPA_OWN_SHIP_VELOCITY_ERROR_MPS)
+		{
+			return;
+		}
+	}
+
+	own_ship.valid = true;
+	own_ship.latitude = fix_latitude;
+	own_ship.longitude = fix_longitude;
+	own_ship.east_mps = east_mps;
+	own_ship.north_mps = north_mps;
+	own_ship.metres_per_unit_east = CPA_METRES_PER_UNIT * cosf(latitude * CPA_RADIANS_PER_DEGREE);
+	own_ship.time_ms = time_ms;
+	generation++;
+	recompute_cursor = 0U;
+	stats.backlog = stats.targets;
+	stats.own_ship_tracks++;
+}
+
+void cpa_update_target(uint16_t index, const ais_target_t *target, uint32_t time_ms)
+{
+	target_t *entry;
+
+	if (index >= AIS_MAXIMUM_TARGETS || target == NULL || target->mmsi == 0UL ||
+			target->latitude == AIS_LATITUDE_NOT_AVAILABLE || target->longitude == AIS_LONGITUDE_NOT_AVAILABLE)
+	{
+		return;
+	}
+
+	stats.target_updates++;
+	entry = &targets[index];
+	if (entry->mmsi != target->mmsi)
+	{
+		// the AIS table gave the index to another target
+		if (entry->mmsi != 0UL)
+		{
+			remove_target(index, time_ms);
+		}
+		(void)memset(entry, 0, sizeof(target_t));
+		entry->mmsi = target->mmsi;
+		entry->heap_position = CPA_NO_EVENT;
+		entry->generation = generation;
+		entry->last_raise_time[0] = time_ms - CPA_REALARM_INTERVAL_MS;
+		entry->last_raise_time[1] = time_ms - CPA_REALARM_INTERVAL_MS;
+		stats.targets++;
+	}
+
+	entry->report_time = time_ms;
+	entry->latitude = target->latitude;
+	entry->longitude = target->longitude;
+	to_velocity(target->sog == AIS_SOG_NOT_AVAILABLE ? 0.0f : (float)target->sog / 10.0f,
+			target->cog == AIS_COG_NOT_AVAILABLE ? -1.0f : (float)target->cog / 10.0f, &entry->east_mps, &entry->north_mps);
+	compute(entry, time_ms);
+	evaluate(index, time_ms);
+}
+
+void cpa_process(uint32_t time_ms)
+{
+	uint16_t index;
+	uint8_t done;
+
+	if (own_ship.valid && time_ms - own_ship.last_fix_time >= CPA_OWN_SHIP_TIMEOUT_MS)
+	{
+		// recomputing without own ship clears every alarm
+		own_ship.valid = false;
+		generation++;
+		recompute_cursor = 0U;
+		stats.backlog = stats.targets;
+		stats.own_ship_tracks++;
+	}
+
+	for (done = 0U; done < CPA_RECOMPUTE_BUDGET && stats.backlog > 0U && recompute_cursor < AIS_MAXIMUM_TARGETS;
+			recompute_cursor++)
+	{
+		if (targets[recompute_cursor].mmsi != 0UL && targets[recompute_cursor].generation != generation)
+		{
+			compute(&targets[recompute_cursor], time_ms);
+			evaluate(recompute_cursor, time_ms);
+			stats.recomputes++;
+			done++;
+		}
+	}
+
+	for (done = 0U; done < CPA_EVENT_BUDGET && heap_count > 0U &&
+			(int32_t)(time_ms - targets[heap[0]].event_time) >= 0L; done++)
+	{
+		index = heap[0];
+		stats.events++;
+		if (time_ms - targets[index].report_time >= CPA_TARGET_TIMEOUT_MS)
+		{
+			remove_target(index, time_ms);
+			continue;
+		}
+		if (targets[index].generation != generation)
+		{
+			// due before the recompute got to it, its windows are for the old track
+			compute(&targets[index], time_ms);
+			stats.recomputes++;
+		}
+		evaluate(index, time_ms);
+	}
+}
+
+bool cpa_get_target(uint16_t index, uint32_t time_ms, float *cpa_m, float *tcpa_s)
+{
+	const target_t *target;
+
+	if (index >= AIS_MAXIMUM_TARGETS || cpa_m == NULL || tcpa_s == NULL)
+	{
+		return false;
+	}
+
+	target = &targets[index];
+	if (target->mmsi == 0UL || !own_ship.valid || target->generation != generation)
+	{
+		return false;
+	}
+
+	*cpa_m = target->cpa_m;
+	*tcpa_s = target->tcpa_s - (float)(int32_t)(time_ms - target->reference_time) / 1000.0f;
+
+	return true;
+}
+
+void cpa_get_stats(cpa_stats_t *stats_copy)
+{
+	if (stats_copy != NULL)
+	{
+		*stats_copy = stats;
+	}
+}
@@ -0,0 +1,181 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef CPA_H
+#define CPA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ais.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define CPA_COLLISION_DISTANCE_M				926.0f				///< A target passing closer than this, half a nautical mile, raises a collision alarm
+#define CPA_COLLISION_TIME_S					600.0f				///< The collision alarm is raised this long before the closest point of approach
+#define CPA_PROXIMITY_DISTANCE_M				60.0f				///< A target closer than this now raises a proximity alarm, sized for boats swinging at anchor
+#define CPA_TARGET_TIMEOUT_MS					AIS_TARGET_TIMEOUT_MS	///< A target not heard from for this long is dropped and its alarms cleared
+#define CPA_OWN_SHIP_TIMEOUT_MS					10000UL				///< Own ship track is dropped when not updated for this long and all alarms cleared
+#define CPA_OWN_SHIP_POSITION_ERROR_M			20.0f				///< Own ship position this far off its track starts a new track
+#define CPA_OWN_SHIP_VELOCITY_ERROR_MPS			0.25f				///< Own ship velocity this different from its track's starts a new track
+#define CPA_STATIONARY_SOG_KNOTS				0.3f				///< Speed below which a vessel is taken as not moving, as COG is then noise
+#define CPA_RECOMPUTE_BUDGET					16U					///< Targets recomputed against a new own ship track in one call of cpa_process
+#define CPA_EVENT_BUDGET						16U					///< Alarm state changes handled in one call of cpa_process
+#define CPA_REALARM_INTERVAL_MS					120000UL			///< An alarm of a target is not raised again sooner than this after it was last raised
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Alarm types, as bits in a mask
+ */
+typedef enum
+{
+	cpa_alarm_collision = 0x01,		///< The target will pass closer than CPA_COLLISION_DISTANCE_M within CPA_COLLISION_TIME_S
+	cpa_alarm_proximity = 0x02		///< The target is closer than CPA_PROXIMITY_DISTANCE_M
+} cpa_alarm_type_t;
+
+/**
+ * An alarm being raised or cleared
+ */
+typedef struct
+{
+	uint32_t mmsi;					///< MMSI of the target
+	uint16_t index;					///< Index of the target in the AIS table, unique among targets with alarms
+	cpa_alarm_type_t type;			///< The alarm
+	bool raised;					///< If the alarm is raised, otherwise it is cleared
+	float cpa_m;					///< Distance at the closest point of approach in m
+	float tcpa_s;					///< Time to the closest point of approach in s, negative when it has passed
+	float range_m;					///< Distance to the target now in m
+} cpa_alarm_t;
+
+/**
+ * Counters of the engine's work
+ */
+typedef struct
+{
+	uint32_t target_updates;		///< Target position reports given to cpa_update_target
+	uint32_t own_ship_updates;		///< Own ship fixes given to cpa_update_own_ship
+	uint32_t own_ship_tracks;		///< New own ship tracks started, each needs all targets recomputed
+	uint32_t recomputes;			///< Targets recomputed against a new own ship track
+	uint32_t events;				///< Alarm state changes and target timeouts handled
+	uint32_t alarms_raised;			///< Alarms raised
+	uint32_t alarms_cleared;		///< Alarms cleared
+	uint32_t alarms_held;			///< Alarms not raised again within CPA_REALARM_INTERVAL_MS
+	uint16_t targets;				///< Targets known now
+	uint16_t active_alarms;			///< Targets with an alarm raised now
+	uint16_t backlog;				///< Targets waiting to be recomputed against the own ship track now
+} cpa_stats_t;
+
+/**
+ * Typedef of callback function called when an alarm is raised or cleared
+ *
+ * @param alarm The alarm
+ */
+typedef void (*cpa_alarm_callback_t)(const cpa_alarm_t *alarm);
+
+/*************************
+*** EXTERNAL VARIABLES ***
+*************************/
+
+/***************************
+*** FUNCTIONS PROTOTYPES ***
+***************************/
+
+/**
+ * Forget all targets, own ship and counters
+ *
+ * @param callback Function called when an alarm is raised or cleared, NULL for none
+ */
+void cpa_init(cpa_alarm_callback_t callback);
+
+/**
+ * Give own ship position and movement. Targets are only recomputed when own ship leaves the straight track at constant
+ * speed the last recompute assumed, by more than CPA_OWN_SHIP_POSITION_ERROR_M or CPA_OWN_SHIP_VELOCITY_ERROR_MPS. They
+ * are then recomputed CPA_RECOMPUTE_BUDGET at a time by cpa_process, so call this as often as fixes arrive.
+ *
+ * @note Not thread safe, call from the task that calls cpa_process
+ * @param latitude Latitude in degrees, north positive
+ * @param longitude Longitude in degrees, east positive
+ * @param sog Speed over ground in knots
+ * @param cog Course over ground in degrees true
+ * @param time_ms Time of the fix
+ */
+void cpa_update_own_ship(float latitude, float longitude, float sog, float cog, uint32_t time_ms);
+
+/**
+ * Give a target's new position report. Its closest point of approach is worked out at once. Has the signature of
+ * ais_position_callback_t so it can be given to ais_set_position_callback.
+ *
+ * @note Not thread safe, call from the task that calls cpa_process
+ * @param index The target's index in the AIS table
+ * @param target The target
+ * @param time_ms Time the report was received
+ */
+void cpa_update_target(uint16_t index, const ais_target_t *target, uint32_t time_ms);
+
+/**
+ * Recompute up to CPA_RECOMPUTE_BUDGET targets waiting after an own ship track change and handle up to CPA_EVENT_BUDGET
+ * alarm state changes due by now. Alarm changes of a target happen when time passes its alarm window edges or its
+ * timeout, which are kept in a heap so no target is looked at until it is due. Call every few tens of ms.
+ *
+ * @param time_ms Time now
+ */
+void cpa_process(uint32_t time_ms);
+
+/**
+ * Get closest point of approach of a target as last worked out
+ *
+ * @param index The target's index in the AIS table
+ * @param time_ms Time now, the time to CPA is given from here
+ * @param cpa_m Set to distance at the closest point of approach in m
+ * @param tcpa_s Set to time to the closest point of approach in s, negative when it has passed
+ * @return If the target and own ship are known
+ */
+bool cpa_get_target(uint16_t index, uint32_t time_ms, float *cpa_m, float *tcpa_s);
+
+/**
+ * Get the counters, counted since cpa_init
+ *
+ * @param stats Where to copy the counters
+ */
+void cpa_get_stats(cpa_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,261 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "format.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define FORMAT_TEXT_SIZE			24U					///< Longest number text, sign, 10 digits, point and 9 decimals, rounded up
+#define FORMAT_UINT32_RANGE			4294967296.0f		///< 2^32, numbers must be below this to fit in a uint32_t
+
+/************
+*** TYPES ***
+************/
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static char *put_digits(char *end, uint32_t value, uint8_t width);
+static size_t copy_out(char *dest, size_t size, const char *text, size_t length);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**
+ * Scale of each number of decimals
+ */
+static const uint32_t powers_of_ten[FORMAT_MAX_DECIMALS + 1U] =
+{
+	1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL, 100000000UL, 1000000000UL
+};
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/**
+ * Write the decimal digits of a number backwards from the end of a buffer
+ *
+ * @param end Pointer to one past where the last digit goes
+ * @param value The number to write
+ * @param width Minimum number of digits, zero padded
+ * @return Pointer to the first digit written
+ */
+static char *put_digits(char *end, uint32_t value, uint8_t width)
+{
+	uint8_t digits = 0U;
+
+	do
+	{
+		*--end = (char)('0' + (char)(value % 10UL));
+		value /= 10UL;
+		digits++;
+	}
+	while (value > 0UL || digits < width);
+
+	return end;
+}
+
+/**
+ * Copy formatted text to the caller's buffer if it fits
+ *
+ * @param dest Buffer to write to
+ * @param size Size in bytes of dest including the terminator
+ * @param text The text to copy, need not be terminated
+ * @param length Length of text
+ * @return Length of text if it was copied, 0 if not
+ */
+static size_t copy_out(char *dest, size_t size, const char *text, size_t length)
+{
+	if (dest == NULL || length + (size_t)1 > size)
+	{
+		return 0U;
+	}
+
+	(void)memcpy(dest, text, length);
+	dest[length] = '\0';
+
+	return length;
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+size_t format_uint(char *dest, size_t size, uint32_t value, uint8_t width)
+{
+	char text[FORMAT_TEXT_SIZE];
+	char *start;
+
+	if (width > FORMAT_MAX_WIDTH)
+	{
+		return 0U;
+	}
+
+	start = put_digits(&text[FORMAT_TEXT_SIZE], value, width);
+
+	return copy_out(dest, size, start, (size_t)(&text[FORMAT_TEXT_SIZE] - start));
+}
+
+size_t format_int(char *dest, size_t size, int32_t value, uint8_t width)
+{
+	char text[FORMAT_TEXT_SIZE];
+	char *start;
+
+	if (width > FORMAT_MAX_WIDTH)
+	{
+		return 0U;
+	}
+
+	if (value < 0L)
+	{
+		start = put_digits(&text[FORMAT_TEXT_SIZE], 0UL - (uint32_t)value, width);
+		*--start = '-';
+	}
+	else
+	{
+		start = put_digits(&text[FORMAT_TEXT_SIZE], (uint32_t)value, width);
+	}
+
+	return copy_out(dest, size, start, (size_t)(&text[FORMAT_TEXT_SIZE] - start));
+}
+
+size_t format_fixed(char *dest, size_t size, float value, uint8_t decimals, uint8_t width)
+{
+	char text[FORMAT_TEXT_SIZE];
+	char *start = &text[FORMAT_TEXT_SIZE];
+	float magnitude;
+	uint32_t whole;
+	uint32_t fraction;
+
+	if (decimals > FORMAT_MAX_DECIMALS || width > FORMAT_MAX_WIDTH || !isfinite(value))
+	{
+		return 0U;
+	}
+
+	magnitude = fabsf(value);
+	if (magnitude >= FORMAT_UINT32_RANGE)
+	{
+		return 0U;
+	}
+
+	format_split_fixed(magnitude, decimals, &whole, &fraction);
+
+	if (decimals > 0U)
+	{
+		start = put_digits(start, fraction, decimals);
+		*--start = '.';
+	}
+	start = put_digits(start, whole, width);
+	if (value < 0.0f && (whole > 0UL || fraction > 0UL))
+	{
+		*--start = '-';
+	}
+
+	return copy_out(dest, size, start, (size_t)(&text[FORMAT_TEXT_SIZE] - start));
+}
+
+void format_split_fixed(float value, uint8_t decimals, uint32_t *whole, uint32_t *fraction)
+{
+	float magnitude = fabsf(value);
+	float fraction_part;
+	uint32_t bits;
+	uint32_t exponent;
+	uint32_t shift;
+	uint64_t scaled;
+	uint64_t rest;
+	uint64_t half;
+	bool odd;
+
+	// taking the whole part off a float is exact, so only the fraction is scaled and rounded
+	*whole = (uint32_t)magnitude;
+	fraction_part = magnitude - (float)*whole;
+
+	// the fraction is mantissa * 2^-shift exactly, at most 24 bits times 10^9 fits in 64 bits
+	(void)memcpy(&bits, &fraction_part, sizeof(bits));
+	exponent = (bits >> 23) & 0xffUL;
+	scaled = (uint64_t)(bits & 0x7fffffUL);
+	if (exponent == 0UL)
+	{
+		shift = 149UL;
+	}
+	else
+	{
+		scaled |= 0x800000ULL;
+		shift = 150UL - exponent;
+	}
+	scaled *= (uint64_t)powers_of_ten[decimals];
+
+	if (scaled == 0ULL || shift >= 64UL)
+	{
+		// no fraction, or one under 2^-40 that rounds to 0 with any number of decimals
+		*fraction = 0UL;
+		return;
+	}
+
+	*fraction = (uint32_t)(scaled >> shift);
+	rest = scaled & ((1ULL << shift) - 1ULL);
+	half = 1ULL << (shift - 1UL);
+	odd = decimals > 0U ? (*fraction & 1UL) != 0UL : (*whole & 1UL) != 0UL;
+	if (rest > half || (rest == half && odd))
+	{
+		(*fraction)++;
+		if (*fraction >= powers_of_ten[decimals])
+		{
+			*fraction -= powers_of_ten[decimals];
+			(*whole)++;
+		}
+	}
+}
+
+size_t format_text(char *dest, size_t size, const char *text)
+{
+	if (text == NULL)
+	{
+		return 0U;
+	}
+
+	return copy_out(dest, size, text, strlen(text));
+}
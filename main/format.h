@@ -0,0 +1,126 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**************
+*** DEFINES ***
+**************/
+
+#define FORMAT_MAX_DECIMALS			9U			///< Most digits after the decimal point format_fixed writes
+#define FORMAT_MAX_WIDTH			10U			///< Most digits numbers are zero padded to
+
+/************
+*** TYPES ***
+************/
+
+/*************************
+*** EXTERNAL VARIABLES ***
+*************************/
+
+/***************************
+*** FUNCTIONS PROTOTYPES ***
+***************************/
+
+/**
+ * Write an unsigned integer in decimal. All format functions write into the caller's buffer, terminate it and return
+ * the number of characters written so that the caller can append the next item at that position. They do not use
+ * static buffers or printf and can be called from any task.
+ *
+ * @param dest Buffer to write to
+ * @param size Size in bytes of dest including the terminator
+ * @param value The number to write
+ * @param width Minimum number of digits, zero padded, up to FORMAT_MAX_WIDTH, 0 for no padding
+ * @return Characters written not counting the terminator, 0 if it did not fit in which case nothing is written
+ */
+size_t format_uint(char *dest, size_t size, uint32_t value, uint8_t width);
+
+/**
+ * Write a signed integer in decimal, with a minus sign if negative
+ *
+ * @param dest Buffer to write to
+ * @param size Size in bytes of dest including the terminator
+ * @param value The number to write
+ * @param width Minimum number of digits after any sign, zero padded, up to FORMAT_MAX_WIDTH, 0 for no padding
+ * @return Characters written not counting the terminator, 0 if it did not fit in which case nothing is written
+ */
+size_t format_int(char *dest, size_t size, int32_t value, uint8_t width);
+
+/**
+ * Write a number with a fixed number of decimals, rounded to nearest with ties to even as printf does, see
+ * format_split_fixed. The whole part and the scaled fraction are written with integer arithmetic. Zero padding of the
+ * integer part gives NMEA0183 degrees and minutes fields, e.g. 807.5 with 3 decimals and width 4 is 0807.500. A number
+ * that rounds to 0 is written without a sign.
+ *
+ * @param dest Buffer to write to
+ * @param size Size in bytes of dest including the terminator
+ * @param value The number to write
+ * @param decimals Digits after the decimal point, up to FORMAT_MAX_DECIMALS, 0 for none and no decimal point
+ * @param width Minimum number of digits before the decimal point, zero padded, up to FORMAT_MAX_WIDTH
+ * @return Characters written not counting the terminator, 0 if it did not fit, the number is not finite or its
+ *         magnitude is 2^32 or more, in which case nothing is written
+ */
+size_t format_fixed(char *dest, size_t size, float value, uint8_t decimals, uint8_t width);
+
+/**
+ * Split the magnitude of a number into its whole part and its fraction scaled to a number of decimals, rounded as
+ * format_fixed writes it. The fraction of a float is exact, so it is rounded from its bits, to nearest with ties to
+ * even, and gives the same digits as printf. For encoders that must give the same number as format_fixed.
+ *
+ * @param value The number, finite and with magnitude below 2^32
+ * @param decimals Digits after the decimal point, up to FORMAT_MAX_DECIMALS
+ * @param whole Written with the whole part of the magnitude after rounding
+ * @param fraction Written with the fraction scaled to decimals digits
+ */
+void format_split_fixed(float value, uint8_t decimals, uint32_t *whole, uint32_t *fraction);
+
+/**
+ * Write a string
+ *
+ * @param dest Buffer to write to
+ * @param size Size in bytes of dest including the terminator
+ * @param text The string to write
+ * @return Characters written not counting the terminator, 0 if it did not fit or text is empty
+ */
+size_t format_text(char *dest, size_t size, const char *text);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
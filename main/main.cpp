@@ -31,21 +31,37 @@ SOFTWARE.
 #include <stdint.h>
 #include <stdbool.h>
 #include <math.h>
+#include <string.h>
 #include "main.h"
 #include "freertos/timers.h"
+#include "freertos/queue.h"
+#include "freertos/stream_buffer.h"
 #include "NMEA2000_CAN.h"  
 #include "N2kMessages.h"
+#include "N2kBusStats.h"
+#include "N2kGateway.h"
+#include "ActisenseReader.h"
 #include "pressure_sensor.h"
 #include "temperature_sensor.h"
 #include "esp_log.h"
 #include "serial.h"
 #include "nmea.h"
+#include "ais.h"
+#include "cpa.h"
+#include "boat_data.h"
+#include "format.h"
 #include "timer.h"
 #include "wmm.h"
 #include "publisher.h"
 #include "settings.h"
 #include "sms.h"
 #include "led.h"
+#include "capture.h"
+#include "spp_acceptor.h"
+#ifdef N2K_ACCESSOR_BENCH_CODE
+#include "esp_timer.h"
+#include "n2k_bench.h"
+#endif
 
 /**************
 *** DEFINES ***
@@ -53,7 +69,20 @@ SOFTWARE.
 
 #define PORT_N0183								0				///< Serial port used by NMEA0183 library that corresponds to first serial port in serial driver
 #define PORT_BLUETOOTH							1				///< Serial port used by NMEA0183 library that corresponds to second serial port in serial driver
+#define N0183_BAUD_RATE							38400UL			///< Baud rate of the NMEA0183 serial port
+#define BLUETOOTH_NMEA0183_BYTES_PER_SECOND		12000UL			///< NMEA0183 output rate to Bluetooth, well inside what SPP carries to a phone so its queue stays short
 #define PUBLISHER_TASK_STACK_SIZE				8096U			///< Stack size for boat iot thread
+#define N2K_TASK_STACK_SIZE						4096U			///< Stack size for NMEA2000 processing thread
+#define N2K_TASK_PRIORITY						2U				///< Above publisher so received frames are handled first
+#define N2K_FRAMES_PER_PARSE					32				///< Frames handled before the NMEA2000 task yields
+#define N2K_TASK_MAX_WAIT_MS					100UL			///< Longest sleep of NMEA2000 task, picks up frames buffered by other tasks
+#define N2K_SEND_QUEUE_LENGTH					8U				///< Messages from timer callbacks waiting to be sent by NMEA2000 task
+#define N2K_HEALTH_PERIOD_MS					1000UL			///< How often NMEA2000 task updates bus statistics and the health snapshot
+#define N2K_GATEWAY_INPUT_BLOCK_SIZE			256U			///< Bytes of Actisense input from Bluetooth read at a time
+#define N2K_GATEWAY_INPUT_BUFFER_SIZE			1024U			///< Bytes of Actisense input passed from timer task waiting for NMEA2000 task
+#define ALARM_SMS_QUEUE_LENGTH					2U				///< Alarm texts from timer task waiting to be sent by SMS by publisher task, more are dropped
+#define ALARM_SMS_MINIMUM_INTERVAL_MS			600000UL		///< Shortest time between alarm SMS texts
+#define AIS_SAFETY_MESSAGE_ID					14U				///< AIS message type of safety related broadcast, used for alarms sent on NMEA2000
 #define MAIN_TASK_SW_TIMER_COUNT				3				///< Number of FreeRTOS soft timers used
 #define SW_TIMER_25_MS							0				///< Corresponds to 25 millisecond period FreeRTOS timer
 #define SW_TIMER_1_S							1				///< Corresponds to 1 second period FreeRTOS timer
@@ -76,6 +105,39 @@ typedef struct
 	void (*Handler)(const tN2kMsg &N2kMsg); 	///< Handler for this PGN message type
 } tNMEA2000Handler;
 
+/**
+ * NMEA2000 message passed from timer callbacks to NMEA2000 task for sending, plain data so it can go through a queue
+ */
+typedef struct
+{
+	unsigned long PGN;							///< NMEA2000 PGN number
+	unsigned char priority;						///< Message priority, 0 highest
+	unsigned char destination;					///< Destination address, 0xff for broadcast
+	int data_length;							///< Number of bytes used in data
+	unsigned char data[tN2kMsg::MaxDataLen];	///< Message data
+} n2k_send_message_t;
+
+/**
+ * Raw gateway settings received from the phone for the NMEA2000 task to apply
+ */
+typedef struct
+{
+	bool pending;										///< If settings wait to be applied
+	tN2kGateway::tFormat format;						///< Format to stream in
+	uint8_t filter_count;								///< PGN filter entries used
+	uint32_t filter_pgns[NMEA_GWY_MAX_FILTER_PGNS];		///< PGNs to include or exclude
+	bool filter_exclude[NMEA_GWY_MAX_FILTER_PGNS];		///< If PGN at same index is excluded
+} n2k_gateway_request_t;
+
+/**
+ * Map of raw gateway format names in $BBGWY to formats
+ */
+typedef struct
+{
+	const char *name;							///< Format name in $BBGWY
+	tN2kGateway::tFormat format;				///< The format
+} n2k_gateway_format_t;
+
 /********************************
 *** LOCAL FUNCTION PROTOTYPES ***
 ********************************/
@@ -86,7 +148,11 @@ static void GGA_receive_callback(const char *data);
 static void RMC_transmit_callback(void);
 static void XDR_transmit_callback(void);
 static void MDA_transmit_callback(void);
-static void VDM_transmit_callback(void);
+static void N2K_receive_callback(const char *data);
+static void cpa_alarm_callback(const cpa_alarm_t *alarm);
+static void N2K_transmit_callback(void);
+static void GWY_receive_callback(const char *data);
+static void GWY_transmit_callback(void);
 static void GGA_transmit_callback(void);
 static void DPT_transmit_callback(void);
 static void MTW_transmit_callback(void);
@@ -96,6 +162,8 @@ static void HDM_transmit_callback(void);
 static void VLW_transmit_callback(void);
 static void MWV_transmit_callback(void);
 static void MWD_transmit_callback(void);
+static void get_time_now(const boat_data_snapshot_t *snapshot, uint32_t time_ms, my_time_t *time);
+static float course_whole_degrees(double degrees);
 static void vTimerCallback25ms(TimerHandle_t xTimer);
 static void vTimerCallback1s(TimerHandle_t xTimer);
 static void vTimerCallback8s(TimerHandle_t xTimer);
@@ -108,9 +176,25 @@ static void environmental_handler(const tN2kMsg &N2kMsg);
 static void latlong_handler(const tN2kMsg &N2kMsg);
 static void sogcog_handler(const tN2kMsg &N2kMsg);
 static void HandleNMEA2000Msg(const tN2kMsg &N2kMsg);
+static bool inject_can_frame(unsigned long id, unsigned char length, const unsigned char *data);
+static void n2k_task(void *parameters);
+static void n2k_send(const tN2kMsg &N2kMsg);
+static bool n2k_send_queued(void);
+static void n2k_update_health(void);
+static void n2k_gateway_set_format(tN2kGateway::tFormat format);
+static void n2k_gateway_apply_request(void);
+static const char *n2k_gateway_format_name(tN2kGateway::tFormat format);
+static bool n2k_gateway_receive(void);
+static bool n2k_gateway_input_allowed(unsigned long PGN);
+static uint16_t n2k_gateway_forward_input(const uint8_t *data, uint16_t length);
+static void n2k_gateway_request_format(tN2kGateway::tFormat format, const nmea_message_data_GWY_t *filters);
 #ifdef CREATE_TEST_DATA_CODE
 static void test_data(void);
 #endif
+#ifdef N2K_ACCESSOR_BENCH_CODE
+static uint64_t bench_clock_ns(void);
+static void run_n2k_accessor_bench(void);
+#endif
 
 /**********************
 *** LOCAL VARIABLES ***
@@ -118,10 +202,27 @@ static void test_data(void);
 
 static TimerHandle_t xTimers[MAIN_TASK_SW_TIMER_COUNT];		///< Array of all FreeRTOS timers used here
 static TaskHandle_t main_task_handle;						///< Handle of main task used by other tasks to communicate with main task
+static TaskHandle_t n2k_task_handle;						///< Handle of NMEA2000 task, notified when a message is queued for sending
+static QueueHandle_t n2k_send_queue;						///< Messages from timer callbacks for NMEA2000 task to send
+static QueueHandle_t alarm_sms_queue;						///< Alarm texts from timer task for publisher task to send by SMS
+static tN2kBusStats n2k_bus_stats;							///< NMEA2000 traffic statistics, only used in NMEA2000 task
+static n2k_health_t n2k_health;								///< Snapshot of bus health for other tasks, guarded by n2k_health_mux
+static portMUX_TYPE n2k_health_mux = portMUX_INITIALIZER_UNLOCKED;	///< Guards n2k_health
+static nmea_message_data_N2K_t nmea_message_data_N2K;		///< Message data for BlueBridge N2K message type
+static tN2kGateway n2k_gateway(0, spp_write_no_wait, (uint16_t)SPP_TX_MAX);	///< Raw NMEA2000 stream to Bluetooth, only used in NMEA2000 task
+static n2k_gateway_request_t n2k_gateway_request;			///< Gateway settings from phone, guarded by n2k_health_mux
+static n2k_gateway_stats_t n2k_gateway_stats = {};		///< Snapshot of gateway counters for other tasks, guarded by n2k_health_mux
+static nmea_message_data_GWY_t nmea_message_data_GWY;		///< Message data for BlueBridge GWY message type
+static tActisenseReader n2k_actisense_reader;				///< Actisense input from Bluetooth in gateway mode, only used in NMEA2000 task
+static StreamBufferHandle_t n2k_gateway_input;				///< Actisense input from Bluetooth, written by timer task and read by NMEA2000 task
+static tN2kGateway::tFormat n2k_gateway_requested_format = tN2kGateway::gwf_Off;	///< Last format asked for, only used in timer task
+static uint32_t n2k_gateway_input_sent;						///< Actisense messages sent to the bus, only used in NMEA2000 task
+static uint32_t n2k_gateway_input_refused;					///< Actisense messages not sent, only used in NMEA2000 task
 static nmea_message_data_XDR_t nmea_message_data_XDR;		///< Message data for NMEA0183 XDR message type
 static nmea_message_data_MDA_t nmea_message_data_MDA;		///< Message data for NMEA0183 MDA message type 
 static nmea_message_data_RMC_t nmea_message_data_RMC;		///< Message data for NMEA0183 RMC message type 
 static nmea_message_data_VDM_t nmea_message_data_VDM;		///< Message data for NMEA0183 VDM message type 
+static nmea_message_data_ALR_t nmea_message_data_ALR;		///< Message data for NMEA0183 ALR message type 
 static nmea_message_data_GGA_t nmea_message_data_GGA;		///< Message data for NMEA0183 GGA message type 
 static nmea_message_data_DPT_t nmea_message_data_DPT;		///< Message data for NMEA0183 DPT message type 
 static nmea_message_data_MTW_t nmea_message_data_MTW;		///< Message data for NMEA0183 MTW message type 
@@ -136,40 +237,42 @@ static nmea_message_data_MWD_t nmea_message_data_MWD;		///< Message data for NME
 *** GLOBAL VARIABLES ***
 ***********************/
 
-volatile float variation_wmm_data;							///< Latest value of world magnetic model variation calculated data
-volatile float pressure_data;                               ///< Latest value of atmospheric pressure data
-volatile float speed_over_ground_data;                      ///< Latest value of SOG data
-volatile float latitude_data;                               ///< Latest value of latitude data
-volatile float longitude_data;                              ///< Latest value of longitude data
-volatile int16_t course_over_ground_data;                   ///< Latest value of COG data
-volatile float depth_data;                                  ///< Latest value of depth data
-volatile float heading_true_data;                           ///< Latest value of compass heading data
-volatile float boat_speed_data;                             ///< Latest value of boat speed through water data
-volatile float apparent_wind_speed_data;                    ///< Latest value of AWS data
-volatile float apparent_wind_angle_data;                    ///< Latest value of AWA data
-volatile float true_wind_speed_data;                        ///< Latest value of TWS data
-volatile float true_wind_angle_data;                        ///< Latest value of TWA data
-volatile float trip_data;                                   ///< Latest value of trip distance data
-volatile float total_distance_data;                         ///< Latest value of total distance data
-volatile float seawater_temeperature_data;                  ///< Latest value of water temperature data
-volatile float wind_direction_magnetic_data;                ///< Latest value of wind direction magnetic data
-volatile float wind_direction_true_data;                    ///< Latest value of wind direction true data
-volatile float exhaust_temperature_data;					///< Latest value of engine exhaust temperature;
-volatile my_time_t gmt_data;                                ///< Latest value of time data
-volatile my_date_t date_data;								///< Latest value of date data
-volatile boat_data_reception_time_t boat_data_reception_time;		///< struct that holds all boat data last received time
-
 /****************
 *** CONSTANTS ***
 ****************/
 
+/**
+ * Raw gateway format names as used in $BBGWY
+ */
+static const n2k_gateway_format_t n2k_gateway_formats[] =
+{
+	{"OFF", tN2kGateway::gwf_Off},
+	{"ACT", tN2kGateway::gwf_Actisense},
+	{"PCD", tN2kGateway::gwf_Seasmart},
+	{"YDR", tN2kGateway::gwf_YDRaw},
+};
+
 /**
  * Array of PGN's of NMEA2000 messages that are transmitted 
  */
 static const unsigned long n2k_transmit_messages[] = {130310UL, // atmospheric pressure
 													  127489UL,	// engine data
+													  129802UL,	// AIS safety related broadcast, for collision and proximity alarms
 													  0UL};
 													  
+/**
+ * Array of PGN's of NMEA2000 messages a PC or phone may send to the bus through the raw gateway. Only navigation data,
+ * nothing that commands other devices or takes part in network management.
+ */
+static const unsigned long n2k_gateway_input_messages[] = {126992UL,	// system time
+														   129025UL,	// lat/long rapid
+														   129026UL,	// sog/cog rapid
+														   129029UL,	// GNSS position
+														   129283UL,	// cross track error
+														   129284UL,	// navigation data
+														   129285UL,	// route/waypoint information
+														   0UL};
+
 /**
  * Array of PGN's of NMEA2000 messages that are received 
  */													  
@@ -208,7 +311,7 @@ static const transmit_message_details_t nmea_transmit_message_details_MWD =
 	2000UL, 
 	MWD_transmit_callback, 
 	&nmea_message_data_MWD, 
-	(nmea_encoder_function_t)nmea_encode_MWD
+	nmea_encode_MWD
 };
 
 /**
@@ -221,7 +324,7 @@ static const transmit_message_details_t nmea_transmit_message_details_MWV =
 	1000UL, 
 	MWV_transmit_callback, 
 	&nmea_message_data_MWV, 
-	(nmea_encoder_function_t)nmea_encode_MWV
+	nmea_encode_MWV
 };
 
 /**
@@ -234,7 +337,7 @@ static const transmit_message_details_t nmea_transmit_message_details_VLW =
 	1000UL, 
 	VLW_transmit_callback, 
 	&nmea_message_data_VLW, 
-	(nmea_encoder_function_t)nmea_encode_VLW
+	nmea_encode_VLW
 };
 
 /**
@@ -247,7 +350,7 @@ static const transmit_message_details_t nmea_transmit_message_details_HDM =
 	1000UL, 
 	HDM_transmit_callback, 
 	&nmea_message_data_HDM, 
-	(nmea_encoder_function_t)nmea_encode_HDM
+	nmea_encode_HDM
 };
 
 /**
@@ -260,7 +363,7 @@ static const transmit_message_details_t nmea_transmit_message_details_HDT =
 	1000UL, 
 	HDT_transmit_callback, 
 	&nmea_message_data_HDT, 
-	(nmea_encoder_function_t)nmea_encode_HDT
+	nmea_encode_HDT
 };
 
 /**
@@ -273,7 +376,7 @@ static const transmit_message_details_t nmea_transmit_message_details_VHW =
 	1000UL, 
 	VHW_transmit_callback, 
 	&nmea_message_data_VHW, 
-	(nmea_encoder_function_t)nmea_encode_VHW
+	nmea_encode_VHW
 };
 
 /**
@@ -286,7 +389,7 @@ static const transmit_message_details_t nmea_transmit_message_details_MTW =
 	2000UL, 
 	MTW_transmit_callback, 
 	&nmea_message_data_MTW, 
-	(nmea_encoder_function_t)nmea_encode_MTW
+	nmea_encode_MTW
 };
 
 /**
@@ -299,7 +402,7 @@ static const transmit_message_details_t nmea_transmit_message_details_DPT =
 	500UL, 
 	DPT_transmit_callback, 
 	&nmea_message_data_DPT, 
-	(nmea_encoder_function_t)nmea_encode_DPT
+	nmea_encode_DPT
 };
 
 /**
@@ -312,20 +415,7 @@ static const transmit_message_details_t nmea_transmit_message_details_GGA =
 	0UL, 	// transmitted as soon as received, transmit callback does nothing
 	GGA_transmit_callback, 
 	&nmea_message_data_GGA, 
-	(nmea_encoder_function_t)nmea_encode_GGA
-};
-
-/**
- * Constant data for transmitting message NMEA0183 message type VDM
- */
-static const transmit_message_details_t nmea_transmit_message_details_VDM = 
-{
-	nmea_message_VDM,	
-	PORT_BLUETOOTH, 
-	0UL, 	// transmitted as soon as received, transmit callback does nothing
-	VDM_transmit_callback, 
-	&nmea_message_data_VDM, 
-	(nmea_encoder_function_t)nmea_encode_VDM
+	nmea_encode_GGA
 };
 
 /**
@@ -338,7 +428,7 @@ static const transmit_message_details_t nmea_transmit_message_details_RMC_blueto
 	1000UL, 
 	RMC_transmit_callback, 
 	&nmea_message_data_RMC, 
-	(nmea_encoder_function_t)nmea_encode_RMC
+	nmea_encode_RMC
 };
 
 /**
@@ -351,7 +441,7 @@ static const transmit_message_details_t nmea_transmit_message_details_XDR =
 	10000UL, 
 	XDR_transmit_callback,	
 	&nmea_message_data_XDR,	
-	(nmea_encoder_function_t)nmea_encode_XDR
+	nmea_encode_XDR
 };
 
 /**
@@ -364,7 +454,33 @@ static const transmit_message_details_t nmea_transmit_message_details_MDA =
 	10000UL, 
 	MDA_transmit_callback,	
 	&nmea_message_data_MDA,	
-	(nmea_encoder_function_t)nmea_encode_MDA
+	nmea_encode_MDA
+};
+
+/**
+ * Constant data for transmitting BlueBridge message type N2K
+ */
+static const transmit_message_details_t nmea_transmit_message_details_N2K = 
+{
+	nmea_message_N2K,	
+	PORT_BLUETOOTH, 
+	0UL, 	// transmitted only as reply to query
+	N2K_transmit_callback, 
+	&nmea_message_data_N2K, 
+	nmea_encode_N2K
+};
+
+/**
+ * Constant data for transmitting BlueBridge message type GWY
+ */
+static const transmit_message_details_t nmea_transmit_message_details_GWY = 
+{
+	nmea_message_GWY,	
+	PORT_BLUETOOTH, 
+	0UL, 	// transmitted only as reply to command or query
+	GWY_transmit_callback, 
+	&nmea_message_data_GWY, 
+	nmea_encode_GWY
 };
 
 /**
@@ -387,6 +503,26 @@ static const nmea_receive_message_details_t nmea_receive_message_details_VDM =
 	VDM_receive_callback
 };
 
+/**
+ * Constant data for receiving BlueBridge message type N2K, which is a query for bus health
+ */
+static const nmea_receive_message_details_t nmea_receive_message_details_N2K = 
+{
+	nmea_message_N2K, 
+	PORT_BLUETOOTH, 
+	N2K_receive_callback
+};
+
+/**
+ * Constant data for receiving BlueBridge message type GWY, which sets raw gateway format and PGN filter or queries counters
+ */
+static const nmea_receive_message_details_t nmea_receive_message_details_GWY = 
+{
+	nmea_message_GWY, 
+	PORT_BLUETOOTH, 
+	GWY_receive_callback
+};
+
 /**
  * Constant data for receiving message NMEA0183 message type RMC
  */
@@ -401,24 +537,81 @@ static const nmea_receive_message_details_t nmea_receive_message_details_RMC =
 *** LOCAL FUNCTIONS ***
 **********************/
 
+/**
+ * Get time now from the last received time, counting on the whole seconds since it was received but not past midnight,
+ * as the date would not follow
+ *
+ * @param snapshot Snapshot holding the last received time
+ * @param time_ms Time now
+ * @param time Set to the time now
+ */
+static void get_time_now(const boat_data_snapshot_t *snapshot, uint32_t time_ms, my_time_t *time)
+{
+	const boat_data_entry_t *entry = &snapshot->entries[boat_data_gmt];
+	uint32_t seconds;
+
+	seconds = (uint32_t)entry->value.time.hour * 3600UL + (uint32_t)entry->value.time.minute * 60UL + 
+			(uint32_t)entry->value.time.second;
+	if ((int32_t)(time_ms - entry->time_ms) > 0L)
+	{
+		seconds += (time_ms - entry->time_ms) / 1000UL;
+	}
+	if (seconds > 24UL * 3600UL - 1UL)
+	{
+		seconds = 24UL * 3600UL - 1UL;
+	}
+
+	time->hour = (uint8_t)(seconds / 3600UL);
+	time->minute = (uint8_t)((seconds / 60UL) % 60UL);
+	time->second = (uint8_t)(seconds % 60UL);
+}
+
+/**
+ * Get a course as it is kept in boat data, whole degrees from 0 to 359
+ *
+ * @param degrees The course in degrees, any number of turns either way
+ * @return The course in whole degrees
+ */
+static float course_whole_degrees(double degrees)
+{
+	int32_t whole;
+	
+	if (!isfinite(degrees))
+	{
+		return 0.0f;
+	}
+	
+	whole = (int32_t)fmod(degrees, 360.0);
+	if (whole < 0L)
+	{
+		whole += 360L;
+	}
+	
+	return (float)whole;
+}
+
 /**
  * Callback function from NMEA0183 processor to obtain measured data called before encoding and transmitting new message of type MWD
  */
 static void MWD_transmit_callback(void)
 {
-	nmea_message_data_MWD.wind_speed_knots = true_wind_speed_data;
+	boat_data_snapshot_t snapshot;
+	uint32_t time_ms = timer_get_time_ms();
+
+	boat_data_get_group(boat_data_group_true_wind, &snapshot);
+	nmea_message_data_MWD.wind_speed_knots = snapshot.entries[boat_data_true_wind_speed].value.number;
 	nmea_message_data_MWD.data_available = NMEA_MWD_WIND_SPEED_KTS_PRESENT;
 	
-	if (timer_get_time_ms() - boat_data_reception_time.wind_direction_magnetic_received_time < WIND_DIRECTION_MAGNETIC_MAX_DATA_AGE_MS)
+	if (boat_data_fresh(&snapshot, boat_data_wind_direction_magnetic, time_ms))
 	{
 		nmea_message_data_MWD.data_available |= NMEA_MWD_WIND_DIRECTION_MAG_PRESENT;
-		nmea_message_data_MWD.wind_direction_magnetic = wind_direction_magnetic_data;
+		nmea_message_data_MWD.wind_direction_magnetic = snapshot.entries[boat_data_wind_direction_magnetic].value.number;
 	}
 
-	if (timer_get_time_ms() - boat_data_reception_time.wind_direction_true_received_time < WIND_DIRECTION_TRUE_MAX_DATA_AGE_MS)
+	if (boat_data_fresh(&snapshot, boat_data_wind_direction_true, time_ms))
 	{
 		nmea_message_data_MWD.data_available |= NMEA_MWD_WIND_DIRECTION_TRUE_PRESENT;
-		nmea_message_data_MWD.wind_direction_true = wind_direction_true_data;
+		nmea_message_data_MWD.wind_direction_true = snapshot.entries[boat_data_wind_direction_true].value.number;
 	}
 }
 
@@ -427,8 +620,11 @@ static void MWD_transmit_callback(void)
  */
 static void MWV_transmit_callback(void)
 {
+	boat_data_snapshot_t snapshot;
 	uint32_t time_ms = timer_get_time_ms();
 	static bool message_type_toggle = false;
+	boat_data_channel_t angle_channel;
+	boat_data_channel_t speed_channel;
 
 	nmea_message_data_MWV.data_available = NMEA_MWV_REFERENCE_PRESENT | NMEA_MWV_WIND_SPEED_UNITS_PRESENT;
 	nmea_message_data_MWV.wind_speed_units = 'N';
@@ -436,38 +632,30 @@ static void MWV_transmit_callback(void)
 	if (message_type_toggle)
 	{
 		nmea_message_data_MWV.reference = 'T';
-
-		if (time_ms - boat_data_reception_time.true_wind_angle_received_time < TRUE_WIND_ANGLE_MAX_DATA_AGE_MS)
-		{
-			nmea_message_data_MWV.wind_angle = true_wind_angle_data;
-			nmea_message_data_MWV.status = 'A';
-			nmea_message_data_MWV.data_available |= (NMEA_MWV_WIND_ANGLE_PRESENT | NMEA_MWV_STATUS_PRESENT);
-		}
-
-		if (time_ms - boat_data_reception_time.true_wind_speed_received_time < TRUE_WIND_SPEED_MAX_DATA_AGE_MS)
-		{
-			nmea_message_data_MWV.wind_speed = true_wind_speed_data;
-			nmea_message_data_MWV.status = 'A';
-			nmea_message_data_MWV.data_available |= (NMEA_MWV_WIND_SPEED_PRESENT | NMEA_MWV_STATUS_PRESENT);
-		}
+		boat_data_get_group(boat_data_group_true_wind, &snapshot);
+		angle_channel = boat_data_true_wind_angle;
+		speed_channel = boat_data_true_wind_speed;
 	}
 	else	
 	{
 		nmea_message_data_MWV.reference = 'R';
+		boat_data_get_group(boat_data_group_apparent_wind, &snapshot);
+		angle_channel = boat_data_apparent_wind_angle;
+		speed_channel = boat_data_apparent_wind_speed;
+	}
 
-		if (time_ms - boat_data_reception_time.apparent_wind_angle_received_time < APPARENT_WIND_ANGLE_MAX_DATA_AGE_MS)
-		{
-			nmea_message_data_MWV.wind_angle = apparent_wind_angle_data;
-			nmea_message_data_MWV.status = 'A';
-			nmea_message_data_MWV.data_available |= (NMEA_MWV_WIND_ANGLE_PRESENT | NMEA_MWV_STATUS_PRESENT);
-		}
+	if (boat_data_fresh(&snapshot, angle_channel, time_ms))
+	{
+		nmea_message_data_MWV.wind_angle = snapshot.entries[angle_channel].value.number;
+		nmea_message_data_MWV.status = 'A';
+		nmea_message_data_MWV.data_available |= (NMEA_MWV_WIND_ANGLE_PRESENT | NMEA_MWV_STATUS_PRESENT);
+	}
 
-		if (time_ms - boat_data_reception_time.apparent_wind_speed_received_time < APPARENT_WIND_SPEED_MAX_DATA_AGE_MS)
-		{
-			nmea_message_data_MWV.wind_speed = apparent_wind_speed_data;
-			nmea_message_data_MWV.status = 'A';
-			nmea_message_data_MWV.data_available |= (NMEA_MWV_WIND_SPEED_PRESENT | NMEA_MWV_STATUS_PRESENT);
-		}
+	if (boat_data_fresh(&snapshot, speed_channel, time_ms))
+	{
+		nmea_message_data_MWV.wind_speed = snapshot.entries[speed_channel].value.number;
+		nmea_message_data_MWV.status = 'A';
+		nmea_message_data_MWV.data_available |= (NMEA_MWV_WIND_SPEED_PRESENT | NMEA_MWV_STATUS_PRESENT);
 	}
 
 	message_type_toggle = !message_type_toggle;
@@ -478,18 +666,21 @@ static void MWV_transmit_callback(void)
  */
 static void VLW_transmit_callback(void)
 {
+	boat_data_snapshot_t snapshot;
 	uint32_t time_ms = timer_get_time_ms();
+
+	boat_data_get_group(boat_data_group_log, &snapshot);
 	nmea_message_data_VLW.data_available = 0UL;
 
-	if (time_ms - boat_data_reception_time.trip_received_time < TRIP_MAX_DATA_AGE_MS)
+	if (boat_data_fresh(&snapshot, boat_data_trip, time_ms))
 	{
-		nmea_message_data_VLW.trip_water_distance = trip_data;
+		nmea_message_data_VLW.trip_water_distance = snapshot.entries[boat_data_trip].value.number;
 		nmea_message_data_VLW.data_available |= NMEA_VLW_TRIP_WATER_DISTANCE_PRESENT;
 	}
 
-	if (time_ms - boat_data_reception_time.total_distance_received_time < TOTAL_DISTANCE_MAX_DATA_AGE_MS)
+	if (boat_data_fresh(&snapshot, boat_data_total_distance, time_ms))
 	{
-		nmea_message_data_VLW.total_water_distance = total_distance_data;
+		nmea_message_data_VLW.total_water_distance = snapshot.entries[boat_data_total_distance].value.number;
 		nmea_message_data_VLW.data_available |= NMEA_VLW_TOTAL_WATER_DISTANCE_PRESENT;
 	}
 }
@@ -499,7 +690,11 @@ static void VLW_transmit_callback(void)
  */
 static void HDM_transmit_callback(void)
 {
-	nmea_message_data_HDM.magnetic_heading = heading_true_data - variation_wmm_data;
+	boat_data_snapshot_t snapshot;
+
+	boat_data_get_group(boat_data_group_heading, &snapshot);
+	nmea_message_data_HDM.magnetic_heading = snapshot.entries[boat_data_heading_true].value.number - 
+			snapshot.entries[boat_data_variation].value.number;
 	nmea_message_data_HDM.data_available = NMEA_HDM_MAG_HEADING_PRESENT;
 }
 
@@ -508,7 +703,10 @@ static void HDM_transmit_callback(void)
  */
 static void HDT_transmit_callback(void)
 {
-	nmea_message_data_HDT.true_heading = heading_true_data;
+	boat_data_snapshot_t snapshot;
+
+	boat_data_get_group(boat_data_group_heading, &snapshot);
+	nmea_message_data_HDT.true_heading = snapshot.entries[boat_data_heading_true].value.number;
 	nmea_message_data_HDT.data_available = NMEA_HDT_TRUE_HEADING_PRESENT;
 }
 
@@ -517,7 +715,10 @@ static void HDT_transmit_callback(void)
  */
 static void VHW_transmit_callback(void)
 {
-	nmea_message_data_VHW.water_speed_knots = boat_speed_data;
+	boat_data_snapshot_t snapshot;
+
+	boat_data_get_group(boat_data_group_water, &snapshot);
+	nmea_message_data_VHW.water_speed_knots = snapshot.entries[boat_data_boat_speed].value.number;
 	nmea_message_data_VHW.data_available = NMEA_VHW_WATER_SPEED_KTS_PRESENT;
 }
 
@@ -526,7 +727,10 @@ static void VHW_transmit_callback(void)
  */
 static void MTW_transmit_callback(void)
 {
-	nmea_message_data_MTW.water_temperature = seawater_temeperature_data;
+	boat_data_snapshot_t snapshot;
+
+	boat_data_get_group(boat_data_group_water, &snapshot);
+	nmea_message_data_MTW.water_temperature = snapshot.entries[boat_data_seawater_temperature].value.number;
 	nmea_message_data_MTW.data_available = NMEA_MTW_WATER_TEMPERATURE_PRESENT;
 }
 
@@ -535,7 +739,10 @@ static void MTW_transmit_callback(void)
  */
 static void DPT_transmit_callback(void)
 {
-	nmea_message_data_DPT.depth = depth_data;
+	boat_data_snapshot_t snapshot;
+
+	boat_data_get_group(boat_data_group_water, &snapshot);
+	nmea_message_data_DPT.depth = snapshot.entries[boat_data_depth].value.number;
 	nmea_message_data_DPT.data_available = NMEA_DPT_DEPTH_PRESENT;
 }
 
@@ -563,28 +770,241 @@ static void GGA_transmit_callback(void)
 }
 
 /**
- * Callback function from NMEA0183 processor when a message of type VDM has been received to decode data and immediately retransmit the message
+ * Callback function from NMEA0183 processor when a message of type VDM has been received. The fragments of a message
+ * are collected and decoded into the AIS target table and retransmitted unchanged as a group when the message is
+ * complete, unless it tells nothing new about its target. Position reports decoded into the table are given to the CPA engine by the
+ * AIS module's position callback.
  *
  * @param data The NMEA0183 encoded message
  */
 static void VDM_receive_callback(const char *data)
 {
-	if (nmea_decode_VDM(data, &nmea_message_data_VDM) == nmea_error_none)
+	const nmea_message_data_VDM_t *fragments;
+	uint8_t fragment_count;
+
+	if (nmea_decode_VDM(data, &nmea_message_data_VDM) == nmea_error_none &&
+			ais_receive_fragment(&nmea_message_data_VDM, timer_get_time_ms(), &fragments, &fragment_count) == ais_result_forward)
 	{
-		nmea_transmit_message_now(PORT_BLUETOOTH, nmea_message_VDM);
+		(void)nmea_transmit_message_group(PORT_BLUETOOTH, nmea_message_VDM, nmea_encode_VDM, fragments,
+				sizeof(fragments[0]), fragment_count);
 	}
 }
 
 /**
- * Callback function from NMEA0183 processor to obtain measured data called before encoding and transmitting new message of type VDM
+ * Callback function from NMEA0183 processor when a BlueBridge N2K query has been received, replies with bus health
+ *
+ * @param data The NMEA0183 encoded message, unused as the query has no fields
  */
-static void VDM_transmit_callback(void)
+static void N2K_receive_callback(const char *data)
 {
-	// do nothing as transmitted immediately on receive unchanged
+	(void)data;
+	
+	nmea_transmit_message_now(PORT_BLUETOOTH, nmea_message_N2K);
 }
 
 /**
- * Callback function from NMEA0183 processor when a message of type RMC has been received to decode data 
+ * Callback function from CPA engine when an AIS target raises or clears an alarm. Raising and clearing are sent as ALR
+ * to Bluetooth. A raised alarm also goes to NMEA2000 as AIS safety related broadcast text, there being no alert PGN in
+ * the library. A raised proximity alarm goes to the publisher task to send by SMS, no more often than
+ * ALARM_SMS_MINIMUM_INTERVAL_MS, as collision alarms from traffic passing an anchorage would be too many to text.
+ *
+ * @param alarm The alarm
+ */
+static void cpa_alarm_callback(const cpa_alarm_t *alarm)
+{
+	static uint32_t sms_time;
+	static bool sms_sent = false;
+	tN2kMsg N2kMsg;
+	char text[ALARM_SMS_TEXT_LENGTH + 1];
+	size_t length;
+	boat_data_snapshot_t snapshot;
+	my_time_t utc;
+	uint32_t time_ms = timer_get_time_ms();
+
+	// CPA 230123456 0.31NM 6.5MIN or PROXIMITY 230123456 45M
+	if (alarm->type == cpa_alarm_collision)
+	{
+		length = format_text(text, sizeof(text), "CPA ");
+		length += format_uint(&text[length], sizeof(text) - length, alarm->mmsi, 9U);
+		length += format_text(&text[length], sizeof(text) - length, " ");
+		length += format_fixed(&text[length], sizeof(text) - length, alarm->cpa_m / 1852.0f, 2U, 0U);
+		length += format_text(&text[length], sizeof(text) - length, "NM ");
+		length += format_fixed(&text[length], sizeof(text) - length, alarm->tcpa_s > 0.0f ? alarm->tcpa_s / 60.0f : 0.0f, 1U, 0U);
+		(void)format_text(&text[length], sizeof(text) - length, "MIN");
+	}
+	else
+	{
+		length = format_text(text, sizeof(text), "PROXIMITY ");
+		length += format_uint(&text[length], sizeof(text) - length, alarm->mmsi, 9U);
+		length += format_text(&text[length], sizeof(text) - length, " ");
+		length += format_uint(&text[length], sizeof(text) - length, (uint32_t)alarm->range_m, 0U);
+		(void)format_text(&text[length], sizeof(text) - length, "M");
+	}
+
+	// each alarm of each target has its own number so a client can tell them apart
+	nmea_message_data_ALR.data_available = 0UL;
+	boat_data_get_group(boat_data_group_time, &snapshot);
+	if (boat_data_fresh(&snapshot, boat_data_gmt, time_ms))
+	{
+		get_time_now(&snapshot, time_ms, &utc);
+		nmea_message_data_ALR.data_available = NMEA_ALR_UTC_PRESENT;
+		nmea_message_data_ALR.utc.hours = utc.hour;
+		nmea_message_data_ALR.utc.minutes = utc.minute;
+		nmea_message_data_ALR.utc.seconds = (float)utc.second;
+	}
+	nmea_message_data_ALR.alarm_number = (uint16_t)(1U + alarm->index * 2U + (alarm->type == cpa_alarm_collision ? 0U : 1U));
+	nmea_message_data_ALR.condition = alarm->raised;
+	nmea_message_data_ALR.acknowledged = false;
+	(void)strcpy(nmea_message_data_ALR.text, text);
+	(void)nmea_transmit_message_data(PORT_BLUETOOTH, nmea_message_ALR, nmea_encode_ALR,
+			(void *)&nmea_message_data_ALR);
+
+	if (alarm->raised)
+	{
+		SetN2kAISSafetyRelatedBroadcastMsg(N2kMsg, AIS_SAFETY_MESSAGE_ID, N2kaisr_Initial, 0UL,
+				N2kaisown_information_not_broadcast, text);
+		n2k_send(N2kMsg);
+
+		if (alarm->type == cpa_alarm_proximity && (!sms_sent || time_ms - sms_time >= ALARM_SMS_MINIMUM_INTERVAL_MS) &&
+				xQueueSendToBack(alarm_sms_queue, text, (TickType_t)0) == pdPASS)
+		{
+			sms_sent = true;
+			sms_time = time_ms;
+		}
+	}
+}
+
+/**
+ * Callback function from NMEA0183 processor to obtain data called before encoding and transmitting new message of type N2K
+ */
+static void N2K_transmit_callback(void)
+{
+	n2k_health_t health;
+	
+	get_n2k_health(&health);
+	nmea_message_data_N2K.bus_load = health.bus_load;
+	nmea_message_data_N2K.long_bus_load = health.long_bus_load;
+	nmea_message_data_N2K.frames_per_second = health.frames_per_second;
+	nmea_message_data_N2K.sources = health.sources;
+	nmea_message_data_N2K.busiest_source = health.busiest_source;
+	nmea_message_data_N2K.tx_errors = health.tx_errors;
+	nmea_message_data_N2K.rx_errors = health.rx_errors;
+	nmea_message_data_N2K.max_tx_errors = health.max_tx_errors;
+	nmea_message_data_N2K.max_rx_errors = health.max_rx_errors;
+	nmea_message_data_N2K.rx_overruns = health.rx_overruns;
+	nmea_message_data_N2K.send_blocked = health.send_blocked;
+}
+
+/**
+ * Callback function from NMEA0183 processor when a BlueBridge GWY message has been received. A command is passed to
+ * the NMEA2000 task, which sends the counters as reply once it is applied. A query is replied to straight away. In
+ * Actisense format the reply is not sent, as all NMEA0183 output on Bluetooth is muted to keep the binary stream clean,
+ * but commands are still received so $BBGWY,OFF ends it.
+ *
+ * @param data The NMEA0183 encoded message
+ */
+static void GWY_receive_callback(const char *data)
+{
+	uint8_t i;
+	
+	if (nmea_decode_GWY(data, &nmea_message_data_GWY) != nmea_error_none)
+	{
+		return;
+	}
+	
+	if (nmea_message_data_GWY.format[0] != '\0')
+	{
+		for (i = 0U; i < (uint8_t)(sizeof(n2k_gateway_formats) / sizeof(n2k_gateway_formats[0])); i++)
+		{
+			if (strcmp(nmea_message_data_GWY.format, n2k_gateway_formats[i].name) == 0)
+			{
+				break;
+			}
+		}
+		if (i == (uint8_t)(sizeof(n2k_gateway_formats) / sizeof(n2k_gateway_formats[0])))
+		{
+			return;
+		}
+		
+		n2k_gateway_request_format(n2k_gateway_formats[i].format, &nmea_message_data_GWY);
+		return;
+	}
+	
+	nmea_transmit_message_now(PORT_BLUETOOTH, nmea_message_GWY);
+}
+
+/**
+ * Pass new raw gateway settings to the NMEA2000 task. In Actisense format Bluetooth input is passed on to the NMEA2000
+ * task from the end of the command that asked for it, as well as being read for NMEA0183 commands. Called only from the
+ * timer task, which is the only reader of Bluetooth input, so no input is lost or read twice when the format changes.
+ *
+ * @param format The new format
+ * @param filters Message holding the PGN filters, NULL for none
+ */
+static void n2k_gateway_request_format(tN2kGateway::tFormat format, const nmea_message_data_GWY_t *filters)
+{
+	portENTER_CRITICAL(&n2k_health_mux);
+	n2k_gateway_request.format = format;
+	n2k_gateway_request.filter_count = 0U;
+	if (filters != NULL)
+	{
+		n2k_gateway_request.filter_count = filters->filter_count;
+		(void)memcpy(n2k_gateway_request.filter_pgns, filters->filter_pgns, sizeof(n2k_gateway_request.filter_pgns));
+		(void)memcpy(n2k_gateway_request.filter_exclude, filters->filter_exclude, sizeof(n2k_gateway_request.filter_exclude));
+	}
+	n2k_gateway_request.pending = true;
+	portEXIT_CRITICAL(&n2k_health_mux);
+	
+	// input from now on is for the NMEA2000 task, the request is pending first so it is not taken as stale
+	n2k_gateway_requested_format = format;
+	nmea_set_port_receive_forward(PORT_BLUETOOTH, format == tN2kGateway::gwf_Actisense ? n2k_gateway_forward_input : NULL);
+	
+	if (n2k_task_handle != NULL)
+	{
+		(void)xTaskNotifyGive(n2k_task_handle);
+	}
+}
+
+/**
+ * Take Bluetooth input for the NMEA2000 task while the raw gateway is in Actisense format, called from the NMEA0183
+ * processor in the timer task
+ *
+ * @param data The received data
+ * @param length Bytes in data, 0 to only ask for the space
+ * @return Bytes that can be taken now
+ */
+static uint16_t n2k_gateway_forward_input(const uint8_t *data, uint16_t length)
+{
+	if (length > 0U)
+	{
+		(void)xStreamBufferSend(n2k_gateway_input, data, (size_t)length, (TickType_t)0);
+		if (n2k_task_handle != NULL)
+		{
+			(void)xTaskNotifyGive(n2k_task_handle);
+		}
+	}
+	
+	return (uint16_t)xStreamBufferSpacesAvailable(n2k_gateway_input);
+}
+
+/**
+ * Callback function from NMEA0183 processor to obtain data called before encoding and transmitting new message of type GWY
+ */
+static void GWY_transmit_callback(void)
+{
+	n2k_gateway_stats_t stats;
+	
+	get_n2k_gateway_stats(&stats);
+	(void)strcpy(nmea_message_data_GWY.format, stats.format);
+	nmea_message_data_GWY.messages = stats.messages;
+	nmea_message_data_GWY.bytes = stats.bytes;
+	nmea_message_data_GWY.dropped_messages = stats.dropped_messages;
+	nmea_message_data_GWY.dropped_bytes = stats.dropped_bytes;
+}
+
+/**
+ * Callback function from NMEA0183 processor when a message of type RMC has been received to decode data. All its
+ * fields are written to the boat data store in one go so readers see them from the same fix.
  *
  * @param data The NMEA0183 encoded message
  */
@@ -595,6 +1015,8 @@ static void RMC_receive_callback(const char *data)
 	uint32_t time_ms = timer_get_time_ms();	
 	float int_part;
 	float frac_part;
+	boat_data_update_t updates[6];
+	uint8_t count = 0U;
 	
 	if (nmea_decode_RMC(data, &nmea_message_data_RMC) == nmea_error_none)
 	{		
@@ -602,52 +1024,57 @@ static void RMC_receive_callback(const char *data)
 		{
 			if (nmea_message_data_RMC.data_available & NMEA_RMC_UTC_PRESENT)
 			{
-				gmt_data.hour = nmea_message_data_RMC.utc.hours;
-				gmt_data.minute = nmea_message_data_RMC.utc.minutes;
-				gmt_data.second = (uint8_t)nmea_message_data_RMC.utc.seconds;
-				boat_data_reception_time.gmt_received_time = time_ms;
+				updates[count].channel = boat_data_gmt;
+				updates[count].value.time.hour = nmea_message_data_RMC.utc.hours;
+				updates[count].value.time.minute = nmea_message_data_RMC.utc.minutes;
+				updates[count].value.time.second = (uint8_t)nmea_message_data_RMC.utc.seconds;
+				count++;
 			}
 
 			if (nmea_message_data_RMC.data_available & NMEA_RMC_DATE_PRESENT)
 			{
-				date_data.year = (uint8_t)(nmea_message_data_RMC.date.year - 2000U);
-				date_data.month = nmea_message_data_RMC.date.month;
-				date_data.date = nmea_message_data_RMC.date.date;
-				boat_data_reception_time.date_received_time = time_ms;
+				updates[count].channel = boat_data_date;
+				updates[count].value.date.year = (uint8_t)(nmea_message_data_RMC.date.year - 2000U);
+				updates[count].value.date.month = nmea_message_data_RMC.date.month;
+				updates[count].value.date.date = nmea_message_data_RMC.date.date;
+				count++;
 			}
 
 			if (nmea_message_data_RMC.data_available & NMEA_RMC_SOG_PRESENT)
 			{
-				speed_over_ground_data = nmea_message_data_RMC.SOG;
-				boat_data_reception_time.speed_over_ground_received_time = time_ms;			
+				updates[count].channel = boat_data_speed_over_ground;
+				updates[count].value.number = nmea_message_data_RMC.SOG;
+				count++;
 			}
 
+			updates[count].channel = boat_data_course_over_ground;
 			if (nmea_message_data_RMC.data_available & NMEA_RMC_COG_PRESENT)
 			{
-				course_over_ground_data = nmea_message_data_RMC.COG;
-				boat_data_reception_time.course_over_ground_received_time = time_ms;	
+				updates[count].value.number = course_whole_degrees((double)nmea_message_data_RMC.COG);
 			}
 			else		// same horrible hack as PGN129026 message as emtrak devices do not put out cog when sog is very small
 			{
-				course_over_ground_data = 0;
-				boat_data_reception_time.course_over_ground_received_time = time_ms;
+				updates[count].value.number = 0.0f;
 			}
+			count++;
 
 			if (nmea_message_data_RMC.data_available & NMEA_RMC_LATITUDE_PRESENT)
 			{
 				frac_part = modff(nmea_message_data_RMC.latitude / 100.0f, &int_part);
-				latitude_data = int_part;
-				latitude_data += frac_part / 0.6f;
-				boat_data_reception_time.latitude_received_time = time_ms;		
+				updates[count].channel = boat_data_latitude;
+				updates[count].value.number = int_part + frac_part / 0.6f;
+				count++;
 			}
 
 			if (nmea_message_data_RMC.data_available & NMEA_RMC_LONGITUDE_PRESENT)
 			{
 				frac_part = modff(nmea_message_data_RMC.longitude / 100.0f, &int_part);
-				longitude_data = int_part;
-				longitude_data += frac_part / 0.6f;
-				boat_data_reception_time.longitude_received_time = time_ms;		
+				updates[count].channel = boat_data_longitude;
+				updates[count].value.number = int_part + frac_part / 0.6f;
+				count++;
 			}
+
+			boat_data_set_values(updates, count, boat_data_source_nmea0183, time_ms);
 		}
 	}
 #endif
@@ -658,33 +1085,40 @@ static void RMC_receive_callback(const char *data)
  */
 static void RMC_transmit_callback(void)
 {
+	boat_data_snapshot_t snapshot;
+	my_time_t utc;
 	float int_part;
 	float frac_part;	
+	float variation;
+	uint32_t time_ms = timer_get_time_ms();
 
+	boat_data_get_all(&snapshot);
+	get_time_now(&snapshot, time_ms, &utc);
 	nmea_message_data_RMC.status = 'A';
-	nmea_message_data_RMC.utc.seconds = (float)gmt_data.second;
-	nmea_message_data_RMC.utc.minutes = gmt_data.minute;
-	nmea_message_data_RMC.utc.hours = gmt_data.hour;
-	nmea_message_data_RMC.date.year = (uint16_t)date_data.year + 2000U;
-	nmea_message_data_RMC.date.month = date_data.month;
-	nmea_message_data_RMC.date.date = date_data.date;
-	nmea_message_data_RMC.SOG = speed_over_ground_data;
-	nmea_message_data_RMC.COG = course_over_ground_data;
-	frac_part = modff(latitude_data, &int_part);
+	nmea_message_data_RMC.utc.seconds = (float)utc.second;
+	nmea_message_data_RMC.utc.minutes = utc.minute;
+	nmea_message_data_RMC.utc.hours = utc.hour;
+	nmea_message_data_RMC.date.year = (uint16_t)snapshot.entries[boat_data_date].value.date.year + 2000U;
+	nmea_message_data_RMC.date.month = snapshot.entries[boat_data_date].value.date.month;
+	nmea_message_data_RMC.date.date = snapshot.entries[boat_data_date].value.date.date;
+	nmea_message_data_RMC.SOG = snapshot.entries[boat_data_speed_over_ground].value.number;
+	nmea_message_data_RMC.COG = snapshot.entries[boat_data_course_over_ground].value.number;
+	frac_part = modff(snapshot.entries[boat_data_latitude].value.number, &int_part);
 	nmea_message_data_RMC.latitude = int_part * 100.0f;
 	nmea_message_data_RMC.latitude += frac_part * 60.0f;
-	frac_part = modff(longitude_data, &int_part);
+	frac_part = modff(snapshot.entries[boat_data_longitude].value.number, &int_part);
 	nmea_message_data_RMC.longitude = int_part * 100.0f;
 	nmea_message_data_RMC.longitude += frac_part * 60.0f;
 	nmea_message_data_RMC.mode = 'A';
-	if (variation_wmm_data < 0.0f)
+	variation = snapshot.entries[boat_data_variation].value.number;
+	if (variation < 0.0f)
 	{
-		nmea_message_data_RMC.magnetic_variation = - variation_wmm_data;
+		nmea_message_data_RMC.magnetic_variation = - variation;
 		nmea_message_data_RMC.magnetic_variation_direction = 'W';
 	}
 	else
 	{
-		nmea_message_data_RMC.magnetic_variation = variation_wmm_data;
+		nmea_message_data_RMC.magnetic_variation = variation;
 		nmea_message_data_RMC.magnetic_variation_direction = 'E';
 	}
 	nmea_message_data_RMC.navigation_status = 'S';
@@ -698,11 +1132,14 @@ static void RMC_transmit_callback(void)
  */
 static void XDR_transmit_callback(void)
 {
+	boat_data_snapshot_t snapshot;
+
+	boat_data_get_group(boat_data_group_environment, &snapshot);
 	nmea_message_data_XDR.measurements[0].decimal_places = 4U;
 	nmea_message_data_XDR.measurements[0].transducer_type = 'P';
 	nmea_message_data_XDR.measurements[0].transducer_id[0] = '\0';
 	nmea_message_data_XDR.measurements[0].units = 'B';
-	nmea_message_data_XDR.measurements[0].measurement = pressure_data / 1000.0f;
+	nmea_message_data_XDR.measurements[0].measurement = snapshot.entries[boat_data_pressure].value.number / 1000.0f;
 	nmea_message_data_XDR.data_available = NMEA_XDR_MEASUREMENT_1_PRESENT;
 }
 
@@ -711,7 +1148,10 @@ static void XDR_transmit_callback(void)
  */
 static void MDA_transmit_callback(void)
 {
-	nmea_message_data_MDA.pressure_bars = pressure_data / 1000.0f;
+	boat_data_snapshot_t snapshot;
+
+	boat_data_get_group(boat_data_group_environment, &snapshot);
+	nmea_message_data_MDA.pressure_bars = snapshot.entries[boat_data_pressure].value.number / 1000.0f;
 	nmea_message_data_MDA.data_available = NMEA_MDA_PRESSURE_BARS_PRESENT;
 }
 
@@ -726,19 +1166,102 @@ TaskHandle_t get_main_task_handle(void)
 }
 
 /**
- * Callback function when FreeRTOS task fires every 25ms
+ * Get the latest NMEA2000 bus health snapshot, updated once a second by the NMEA2000 task
+ *
+ * @param health Where to copy the snapshot
+ */
+void get_n2k_health(n2k_health_t *health)
+{
+	portENTER_CRITICAL(&n2k_health_mux);
+	*health = n2k_health;
+	portEXIT_CRITICAL(&n2k_health_mux);
+}
+
+/**
+ * Get the latest NMEA2000 raw gateway counters, updated once a second by the NMEA2000 task
+ *
+ * @param stats Where to copy the counters
+ */
+void get_n2k_gateway_stats(n2k_gateway_stats_t *stats)
+{
+	portENTER_CRITICAL(&n2k_health_mux);
+	*stats = n2k_gateway_stats;
+	portEXIT_CRITICAL(&n2k_health_mux);
+}
+
+/**
+ * Get the next alarm text waiting to be sent by SMS, queued by the timer task when an AIS target raises an alarm
+ *
+ * @param text Where to copy the text, ALARM_SMS_TEXT_LENGTH + 1 bytes
+ * @return If there was a text waiting
+ */
+bool get_alarm_sms(char *text)
+{
+	return alarm_sms_queue != NULL && xQueueReceive(alarm_sms_queue, text, (TickType_t)0) == pdPASS;
+}
+
+/**
+ * Callback function when FreeRTOS task fires every 25ms, or sooner when an NMEA0183 message is due before then
  * 
- * @param xTimer Unused
+ * @param xTimer This timer
  */
 static void vTimerCallback25ms(TimerHandle_t xTimer)
 {
-	(void)xTimer;
+	static TickType_t period = (TickType_t)25;
+	static uint32_t own_ship_fix_time = 0UL;
+	TickType_t next_period;
+	uint32_t next_transmit_ms;
+	uint32_t time_ms;
+	boat_data_snapshot_t snapshot;
+	float cog;
 	
-	nmea_process();
+	// gateway mode lasts while the client that asked for it is connected
+	if (n2k_gateway_requested_format != tN2kGateway::gwf_Off && !spp_is_connected())
+	{
+		n2k_gateway_request_format(tN2kGateway::gwf_Off, NULL);
+	}
+	next_transmit_ms = nmea_process();
+	
+	// own ship goes to the CPA engine when a new fix has arrived, from NMEA2000 or RMC, with SOG and COG still fresh
+	time_ms = timer_get_time_ms();
+	boat_data_get_group(boat_data_group_position, &snapshot);
+	boat_data_get_group(boat_data_group_motion, &snapshot);
+	if (snapshot.entries[boat_data_latitude].valid && snapshot.entries[boat_data_longitude].valid &&
+			snapshot.entries[boat_data_latitude].time_ms != own_ship_fix_time &&
+			boat_data_fresh(&snapshot, boat_data_speed_over_ground, time_ms) &&
+			boat_data_fresh(&snapshot, boat_data_course_over_ground, time_ms))
+	{
+		own_ship_fix_time = snapshot.entries[boat_data_latitude].time_ms;
+		cog = snapshot.entries[boat_data_course_over_ground].value.number;
+		if (cog < 0.0f)
+		{
+			cog += 360.0f;
+		}
+		cpa_update_own_ship(snapshot.entries[boat_data_latitude].value.number, snapshot.entries[boat_data_longitude].value.number,
+				snapshot.entries[boat_data_speed_over_ground].value.number, cog, time_ms);
+	}
+	cpa_process(time_ms);
+	
+	// received data is read every 25ms but a message due in between is sent on time
+	next_period = (TickType_t)25;
+	if (next_transmit_ms < 25UL)
+	{
+		next_period = pdMS_TO_TICKS(next_transmit_ms);
+		if (next_period == (TickType_t)0)
+		{
+			next_period = (TickType_t)1;
+		}
+	}
+	if (next_period != period)
+	{
+		period = next_period;
+		(void)xTimerChangePeriod(xTimer, period, (TickType_t)0);
+	}
 }
 
 /**
- * Callback function when FreeRTOS task fires every 1s
+ * Callback function when FreeRTOS task fires every 1s. Switches NMEA0183 messages on and off from one snapshot of all
+ * boat data.
  * 
  * @param xTimer Unused
  */
@@ -746,13 +1269,16 @@ static void vTimerCallback1s(TimerHandle_t xTimer)
 {	
 	tN2kMsg N2kMsg;
 	tN2kEngineDiscreteStatus1 Status1;
+	boat_data_snapshot_t snapshot;
+	float exhaust_temperature;
 	uint32_t time_ms;
 
 	(void)xTimer;
 	
 	// read and check against alarm setting engine exhaust temperature
-	exhaust_temperature_data = temperature_sensor_read();
-	if (exhaust_temperature_data > (float)settings_get_exhaust_alarm_temperature())
+	exhaust_temperature = temperature_sensor_read();
+	boat_data_set(boat_data_exhaust_temperature, exhaust_temperature, boat_data_source_sensor, timer_get_time_ms());
+	if (exhaust_temperature > (float)settings_get_exhaust_alarm_temperature())
 	{	
 		Status1.Bits.WaterFlow = true;
 	}
@@ -766,32 +1292,15 @@ static void vTimerCallback1s(TimerHandle_t xTimer)
 						   N2kDoubleNA, N2kDoubleNA, N2kDoubleNA, N2kDoubleNA,
 						   N2kInt8NA, N2kInt8NA,
 						   Status1, (tN2kEngineDiscreteStatus2)0);
-	NMEA2000.SendMsg(N2kMsg);	
+	n2k_send(N2kMsg);	
 
 	time_ms = timer_get_time_ms();
-	
-	// update local time by 1 second (unless it's 23:59:59) if latest received time is more than 1 second old
-	if (time_ms - boat_data_reception_time.gmt_received_time > 1000UL)
-	{
-		if (!(gmt_data.hour == 23U && gmt_data.minute == 59U && gmt_data.second == 59U))
-		{
-			gmt_data.second++;
-			if (gmt_data.second > 59U)
-			{
-				gmt_data.second = 0U;
-				gmt_data.minute++;
-				if (gmt_data.minute > 59U)
-				{
-					gmt_data.hour++;
-				}
-			}
-		}
-	}	
+	boat_data_get_all(&snapshot);
 	
     // switch on or off MWD message transmission here
-	if ((time_ms - boat_data_reception_time.wind_direction_magnetic_received_time < WIND_DIRECTION_MAGNETIC_MAX_DATA_AGE_MS ||
-			time_ms - boat_data_reception_time.wind_direction_magnetic_received_time < WIND_DIRECTION_TRUE_MAX_DATA_AGE_MS) &&
-			time_ms - boat_data_reception_time.true_wind_speed_received_time < TRUE_WIND_SPEED_MAX_DATA_AGE_MS)
+	if ((boat_data_fresh(&snapshot, boat_data_wind_direction_magnetic, time_ms) ||
+			boat_data_fresh(&snapshot, boat_data_wind_direction_true, time_ms)) &&
+			boat_data_fresh(&snapshot, boat_data_true_wind_speed, time_ms))
 	{
 		nmea_enable_transmit_message(&nmea_transmit_message_details_MWD);
 	}
@@ -801,10 +1310,10 @@ static void vTimerCallback1s(TimerHandle_t xTimer)
 	}	
 	
     // switch on or off MWV message transmission here
-	if (time_ms - boat_data_reception_time.apparent_wind_angle_received_time < APPARENT_WIND_ANGLE_MAX_DATA_AGE_MS ||
-			time_ms - boat_data_reception_time.apparent_wind_speed_received_time < APPARENT_WIND_SPEED_MAX_DATA_AGE_MS ||
-			time_ms - boat_data_reception_time.true_wind_angle_received_time < TRUE_WIND_ANGLE_MAX_DATA_AGE_MS ||
-			time_ms - boat_data_reception_time.true_wind_speed_received_time < TRUE_WIND_SPEED_MAX_DATA_AGE_MS)
+	if (boat_data_fresh(&snapshot, boat_data_apparent_wind_angle, time_ms) ||
+			boat_data_fresh(&snapshot, boat_data_apparent_wind_speed, time_ms) ||
+			boat_data_fresh(&snapshot, boat_data_true_wind_angle, time_ms) ||
+			boat_data_fresh(&snapshot, boat_data_true_wind_speed, time_ms))
 	{
 		nmea_enable_transmit_message(&nmea_transmit_message_details_MWV);
 	}
@@ -814,8 +1323,7 @@ static void vTimerCallback1s(TimerHandle_t xTimer)
 	}
 
     // switch on or off VLW message transmission here
-	if (time_ms - boat_data_reception_time.trip_received_time < TRIP_MAX_DATA_AGE_MS ||
-			time_ms - boat_data_reception_time.total_distance_received_time < TOTAL_DISTANCE_MAX_DATA_AGE_MS)
+	if (boat_data_fresh(&snapshot, boat_data_trip, time_ms) || boat_data_fresh(&snapshot, boat_data_total_distance, time_ms))
 	{
 		nmea_enable_transmit_message(&nmea_transmit_message_details_VLW);
 	}
@@ -825,11 +1333,11 @@ static void vTimerCallback1s(TimerHandle_t xTimer)
 	}	
 	
     // switch on or off HDM/HDT message transmission here
-	if (time_ms - boat_data_reception_time.heading_true_received_time < HEADING_TRUE_MAX_DATA_AGE_MS)
+	if (boat_data_fresh(&snapshot, boat_data_heading_true, time_ms))
 	{
 		nmea_enable_transmit_message(&nmea_transmit_message_details_HDT);
 
-		if (time_ms - boat_data_reception_time.wmm_calculation_time < WMM_CALCULATION_MAX_DATA_AGE)
+		if (boat_data_fresh(&snapshot, boat_data_variation, time_ms))
 		{
 			nmea_enable_transmit_message(&nmea_transmit_message_details_HDM);
 		}
@@ -845,7 +1353,7 @@ static void vTimerCallback1s(TimerHandle_t xTimer)
 	}	
 	
     // switch on or off VHW message transmission here
-	if (time_ms - boat_data_reception_time.boat_speed_received_time < BOAT_SPEED_MAX_DATA_AGE_MS)
+	if (boat_data_fresh(&snapshot, boat_data_boat_speed, time_ms))
 	{
 		nmea_enable_transmit_message(&nmea_transmit_message_details_VHW);
 	}
@@ -855,7 +1363,7 @@ static void vTimerCallback1s(TimerHandle_t xTimer)
 	}	
 	
     // switch on or off MTW message transmission here
-	if (time_ms - boat_data_reception_time.seawater_temperature_received_time < TEMPERATURE_MAX_DATA_AGE_MS)
+	if (boat_data_fresh(&snapshot, boat_data_seawater_temperature, time_ms))
 	{
 		nmea_enable_transmit_message(&nmea_transmit_message_details_MTW);
 	}
@@ -865,7 +1373,7 @@ static void vTimerCallback1s(TimerHandle_t xTimer)
 	}	
 	
     // switch on or off DPT message transmission here
-	if (time_ms - boat_data_reception_time.depth_received_time < DEPTH_MAX_DATA_AGE_MS)
+	if (boat_data_fresh(&snapshot, boat_data_depth, time_ms))
 	{
 		nmea_enable_transmit_message(&nmea_transmit_message_details_DPT);
 	}
@@ -875,12 +1383,12 @@ static void vTimerCallback1s(TimerHandle_t xTimer)
 	}	
 	
     // switch on or off RMC message transmission here
-	if (time_ms - boat_data_reception_time.gmt_received_time < GMT_MAX_DATA_AGE_MS &&
-			time_ms - boat_data_reception_time.date_received_time < DATE_MAX_DATA_AGE_MS &&
-			time_ms - boat_data_reception_time.speed_over_ground_received_time < SOG_MAX_DATA_AGE_MS &&
-			time_ms - boat_data_reception_time.course_over_ground_received_time < COG_MAX_DATA_AGE_MS &&
-			time_ms - boat_data_reception_time.latitude_received_time < LATITUDE_MAX_DATA_AGE_MS &&
-			time_ms - boat_data_reception_time.longitude_received_time < LONGITUDE_MAX_DATA_AGE_MS)
+	if (boat_data_fresh(&snapshot, boat_data_gmt, time_ms) &&
+			boat_data_fresh(&snapshot, boat_data_date, time_ms) &&
+			boat_data_fresh(&snapshot, boat_data_speed_over_ground, time_ms) &&
+			boat_data_fresh(&snapshot, boat_data_course_over_ground, time_ms) &&
+			boat_data_fresh(&snapshot, boat_data_latitude, time_ms) &&
+			boat_data_fresh(&snapshot, boat_data_longitude, time_ms))
 	{		
 		nmea_enable_transmit_message(&nmea_transmit_message_details_RMC_bluetooth);
 	}
@@ -890,7 +1398,7 @@ static void vTimerCallback1s(TimerHandle_t xTimer)
 	}	
 	
 	// switch on or off XDR and MDA message transmission here
-	if (time_ms - boat_data_reception_time.pressure_received_time < PRESSURE_MAX_DATA_AGE_MS)
+	if (boat_data_fresh(&snapshot, boat_data_pressure, time_ms))
 	{
 		nmea_enable_transmit_message(&nmea_transmit_message_details_XDR);
 		nmea_enable_transmit_message(&nmea_transmit_message_details_MDA);
@@ -915,37 +1423,41 @@ static void vTimerCallback1s(TimerHandle_t xTimer)
 static void vTimerCallback8s(TimerHandle_t xTimer)
 {
 	float wmm_date;
-	float variation_wmm_data_temp;
+	float variation;
+	float pressure;
+	boat_data_snapshot_t snapshot;
 	uint32_t time_ms = timer_get_time_ms();
 
 	(void)xTimer;
 	
 	// check if a pressure reading is available
-	if (pressure_sensor_read_measurement_mb((float *)&pressure_data) == true)
+	if (pressure_sensor_read_measurement_mb(&pressure) == true)
 	{          
 		tN2kMsg N2kMsg;
-		SetN2kOutsideEnvironmentalParameters(N2kMsg, 1U, N2kDoubleNA, N2kDoubleNA, mBarToPascal((double)pressure_data));
-		NMEA2000.SendMsg(N2kMsg);
-		boat_data_reception_time.pressure_received_time = timer_get_time_ms();	
+		SetN2kOutsideEnvironmentalParameters(N2kMsg, 1U, N2kDoubleNA, N2kDoubleNA, mBarToPascal((double)pressure));
+		n2k_send(N2kMsg);
+		boat_data_set(boat_data_pressure, pressure, boat_data_source_sensor, timer_get_time_ms());
 	}	
 
     // check if it's time to do a wmm calculation and if it is check that required parameters are fresh
-	if (time_ms - boat_data_reception_time.wmm_calculation_time > WMM_CALCULATION_MAX_DATA_AGE &&
-			time_ms - boat_data_reception_time.latitude_received_time < LATITUDE_MAX_DATA_AGE_MS &&
-			time_ms - boat_data_reception_time.longitude_received_time < LONGITUDE_MAX_DATA_AGE_MS &&
-			time_ms - boat_data_reception_time.date_received_time < DATE_MAX_DATA_AGE_MS)
+	boat_data_get_group(boat_data_group_heading, &snapshot);
+	boat_data_get_group(boat_data_group_position, &snapshot);
+	boat_data_get_group(boat_data_group_time, &snapshot);
+	if (!boat_data_fresh(&snapshot, boat_data_variation, time_ms) &&
+			boat_data_fresh(&snapshot, boat_data_latitude, time_ms) &&
+			boat_data_fresh(&snapshot, boat_data_longitude, time_ms) &&
+			boat_data_fresh(&snapshot, boat_data_date, time_ms))
 	{
 		// it's time and every parameter is fresh so do a wmm calculation
 
 		// convert date into format required by wmm
-		wmm_date = wmm_get_date(date_data.year, date_data.month, date_data.date);
+		wmm_date = wmm_get_date(snapshot.entries[boat_data_date].value.date.year, snapshot.entries[boat_data_date].value.date.month, 
+				snapshot.entries[boat_data_date].value.date.date);
 
-		// do the calculation
-		E0000(latitude_data, longitude_data, wmm_date, &variation_wmm_data_temp);
-		variation_wmm_data = variation_wmm_data_temp;
-		
-		// save this calculation time
-		boat_data_reception_time.wmm_calculation_time = time_ms;
+		// do the calculation and save it with this calculation time
+		E0000(snapshot.entries[boat_data_latitude].value.number, snapshot.entries[boat_data_longitude].value.number, wmm_date, 
+				&variation);
+		boat_data_set(boat_data_variation, variation, boat_data_source_calculated, time_ms);
 	}
 }
 
@@ -956,6 +1468,8 @@ static void vTimerCallback8s(TimerHandle_t xTimer)
  */
 static void HandleNMEA2000Msg(const tN2kMsg &N2kMsg) 
 {	
+	static_cast<tNMEA2000_esp32 &>(NMEA2000).RecordRxLatency();
+
 	for (uint32_t i = 0UL; i < (uint32_t)(sizeof(NMEA2000Handlers) / sizeof(tNMEA2000Handler)); i++)
 	{
 		if (N2kMsg.PGN == NMEA2000Handlers[i].PGN)
@@ -969,6 +1483,360 @@ static void HandleNMEA2000Msg(const tN2kMsg &N2kMsg)
 	}
 }
 
+/**
+ * Handle NMEA2000 traffic. Woken by the CAN driver when frames have been received, otherwise sleeps until the
+ * library next has timed work to do, such as heartbeat, address claim or transport protocol sends.
+ *
+ * @param parameters Unused
+ */
+static void n2k_task(void *parameters)
+{
+	tNMEA2000_esp32 &n2k = static_cast<tNMEA2000_esp32 &>(NMEA2000);
+	
+	(void)parameters;
+	
+	n2k.SetRxNotifyTask(xTaskGetCurrentTaskHandle());
+	
+	while (true)
+	{
+		bool send_blocked;
+		
+		n2k_gateway_apply_request();
+		send_blocked = n2k_send_queued();
+		if (!send_blocked)
+		{
+			send_blocked = n2k_gateway_receive();
+		}
+		
+		NMEA2000.ParseMessages();
+		n2k_gateway.Flush();
+		n2k_update_health();
+		if (NMEA2000.ReadResetAddressChanged())
+		{
+			settings_set_device_address(NMEA2000.GetN2kSource());
+			settings_save();
+		}
+		
+		if (n2k.GetRxPendingFrames() > 0U)
+		{
+			// frame budget used up, let other tasks at this priority run before the rest
+			taskYIELD();
+		}
+		else if (send_blocked)
+		{
+			// send buffers drain as frames go out on the bus, retry the held message on next tick
+			(void)ulTaskNotifyTake(pdTRUE, (TickType_t)1);
+		}
+		else
+		{
+			// one tick more as the library acts only once its due time has passed
+			(void)ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(NMEA2000.GetHousekeepingDelay(N2K_TASK_MAX_WAIT_MS)) + (TickType_t)1);
+		}
+	}
+}
+
+/**
+ * Queue a message for the NMEA2000 task to send. Sending only from that task keeps the check that all frames of a
+ * message fit in the send buffers valid until they have been queued. Called from timer callbacks only.
+ *
+ * @param N2kMsg The message to send
+ */
+static void n2k_send(const tN2kMsg &N2kMsg)
+{
+	static n2k_send_message_t message;		// static to keep it off the timer task stack
+	
+	message.PGN = N2kMsg.PGN;
+	message.priority = N2kMsg.Priority;
+	message.destination = N2kMsg.Destination;
+	message.data_length = N2kMsg.DataLen;
+	(void)memcpy(message.data, N2kMsg.Data, (size_t)N2kMsg.DataLen);
+	
+	if (xQueueSendToBack(n2k_send_queue, &message, (TickType_t)0) == pdPASS && n2k_task_handle != NULL)
+	{
+		(void)xTaskNotifyGive(n2k_task_handle);
+	}
+}
+
+/**
+ * Send messages queued by n2k_send. A message the send buffers have no room for is held and tried again on the next
+ * call, so it is not lost while the bus is busy.
+ *
+ * @return true if a message is held because the send buffers are full
+ */
+static bool n2k_send_queued(void)
+{
+	static n2k_send_message_t message;
+	static bool message_held = false;
+	tN2kMsg N2kMsg;
+	
+	while (message_held || xQueueReceive(n2k_send_queue, &message, (TickType_t)0) == pdPASS)
+	{
+		message_held = true;
+		N2kMsg.Init(message.priority, message.PGN, NMEA2000.GetN2kSource(), message.destination);
+		N2kMsg.DataLen = message.data_length;
+		(void)memcpy(N2kMsg.Data, message.data, (size_t)message.data_length);
+		if (!NMEA2000.SendMsg(N2kMsg) && NMEA2000.IsSendBlocked())
+		{
+			break;
+		}
+		message_held = false;
+	}
+	
+	return message_held;
+}
+
+/**
+ * Keep bus statistics up to date and once a second sample the controller error counters and refresh the health
+ * snapshot other tasks read. Frames dropped by the receive filter in the driver still used the bus, so they are added
+ * to bus load. Frames dropped by the controller acceptance filter are not seen at all.
+ */
+static void n2k_update_health(void)
+{
+	static uint32_t last_update_ms = 0UL;
+	static uint32_t last_rx_rejected = 0UL;
+	tNMEA2000_esp32 &n2k = static_cast<tNMEA2000_esp32 &>(NMEA2000);
+	uint32_t time_ms = timer_get_time_ms();
+	uint32_t rx_rejected;
+	n2k_health_t health;
+	
+	// close statistics seconds as they pass so frames are counted in the second they arrived
+	rx_rejected = n2k.GetRxRejectedFrames();
+	n2k_bus_stats.AddDroppedFrames(rx_rejected - last_rx_rejected);
+	last_rx_rejected = rx_rejected;
+	n2k_bus_stats.Update(time_ms);
+	
+	if (time_ms - last_update_ms < N2K_HEALTH_PERIOD_MS)
+	{
+		return;
+	}
+	last_update_ms = time_ms;
+	
+	n2k_bus_stats.SetErrorCounters(n2k.GetTxErrorCounter(), n2k.GetRxErrorCounter());
+	
+	if (n2k_gateway.GetStatistics().DroppedMessages != n2k_gateway_stats.dropped_messages)
+	{
+		ESP_LOGI(pcTaskGetName(NULL), "Gateway dropped %u messages, Bluetooth link too slow",
+				(unsigned int)(n2k_gateway.GetStatistics().DroppedMessages - n2k_gateway_stats.dropped_messages));
+	}
+
+	health.bus_load = n2k_bus_stats.GetLoad();
+	health.long_bus_load = n2k_bus_stats.GetLongLoad();
+	health.frames_per_second = n2k_bus_stats.GetLastSecondFrames();
+	health.sources = n2k_bus_stats.GetActiveSources();
+	health.busiest_source = n2k_bus_stats.GetBusiestSource();
+	health.tx_errors = n2k_bus_stats.GetTxErrors();
+	health.rx_errors = n2k_bus_stats.GetRxErrors();
+	health.max_tx_errors = n2k_bus_stats.GetMaxTxErrors();
+	health.max_rx_errors = n2k_bus_stats.GetMaxRxErrors();
+	health.rx_overruns = n2k.GetRxOverruns() + n2k.GetRxHardwareOverruns();
+	health.send_blocked = NMEA2000.GetSendBlockedCount();
+	
+	portENTER_CRITICAL(&n2k_health_mux);
+	n2k_health = health;
+	portEXIT_CRITICAL(&n2k_health_mux);
+	n2k_gateway_set_format(n2k_gateway.GetFormat());
+}
+
+/**
+ * Switch raw gateway format and refresh the gateway counters snapshot. While the gateway is on, the CAN receive
+ * filter is bypassed so the whole bus is streamed. Actisense format is binary, so NMEA0183 output on Bluetooth is
+ * muted while it is used and Bluetooth input passed on by the timer task is read as Actisense messages for the bus.
+ *
+ * @param format The new format, the current one to only refresh the counters
+ */
+static void n2k_gateway_set_format(tN2kGateway::tFormat format)
+{
+	const tN2kGateway::tStatistics &statistics = n2k_gateway.GetStatistics();
+	
+	if (format != n2k_gateway.GetFormat())
+	{
+		n2k_gateway.Flush();
+		n2k_gateway.SetFormat(format);
+		static_cast<tNMEA2000_esp32 &>(NMEA2000).SetRxFilterBypass(format != tN2kGateway::gwf_Off);
+		nmea_set_port_transmit_muted(PORT_BLUETOOTH, format == tN2kGateway::gwf_Actisense);
+		n2k_actisense_reader.ClearBuffer();
+	}
+	
+	portENTER_CRITICAL(&n2k_health_mux);
+	(void)strcpy(n2k_gateway_stats.format, n2k_gateway_format_name(format));
+	n2k_gateway_stats.messages = statistics.Messages;
+	n2k_gateway_stats.filtered = statistics.Filtered;
+	n2k_gateway_stats.writes = statistics.Writes;
+	n2k_gateway_stats.bytes = statistics.Bytes;
+	n2k_gateway_stats.dropped_messages = statistics.DroppedMessages;
+	n2k_gateway_stats.dropped_bytes = statistics.DroppedBytes;
+	n2k_gateway_stats.input_sent = n2k_gateway_input_sent;
+	n2k_gateway_stats.input_refused = n2k_gateway_input_refused;
+	n2k_gateway_stats.input_bad = n2k_actisense_reader.GetBadMessages();
+	portEXIT_CRITICAL(&n2k_health_mux);
+}
+
+/**
+ * Apply raw gateway settings received from the phone, if any, then reply with the counters in the new format
+ */
+static void n2k_gateway_apply_request(void)
+{
+	n2k_gateway_request_t request;
+	uint8_t i;
+	
+	portENTER_CRITICAL(&n2k_health_mux);
+	request = n2k_gateway_request;
+	n2k_gateway_request.pending = false;
+	portEXIT_CRITICAL(&n2k_health_mux);
+	
+	if (!request.pending)
+	{
+		return;
+	}
+	
+	n2k_gateway.ClearFilter();
+	for (i = 0U; i < request.filter_count; i++)
+	{
+		(void)n2k_gateway.AddFilterPGN((unsigned long)request.filter_pgns[i], request.filter_exclude[i]);
+	}
+	n2k_gateway_set_format(request.format);
+	ESP_LOGI(pcTaskGetName(NULL), "Gateway format %s, %u PGN filters", n2k_gateway_format_name(request.format),
+			(unsigned int)request.filter_count);
+	nmea_transmit_message_now(PORT_BLUETOOTH, nmea_message_GWY);
+}
+
+/**
+ * Send Actisense messages received on Bluetooth to the NMEA2000 bus while the gateway is in Actisense format. Input is
+ * read in blocks and only PGNs in n2k_gateway_input_messages are sent, always from this device's address. Reading
+ * stops while a message waits for send buffer space, so later input waits, first in n2k_gateway_input and once that
+ * is full in the Bluetooth receive queue. In other formats input left over from Actisense format is thrown away.
+ *
+ * @return true if a message is held because the send buffers are full
+ */
+static bool n2k_gateway_receive(void)
+{
+	static uint8_t buffer[N2K_GATEWAY_INPUT_BLOCK_SIZE];
+	static size_t buffer_length = 0U;
+	static size_t buffer_used = 0U;
+	static tN2kMsg N2kMsg;
+	static bool message_held = false;
+	bool message_ready;
+	bool request_pending;
+	size_t stale_length;
+	
+	if (n2k_gateway.GetFormat() != tN2kGateway::gwf_Actisense)
+	{
+		buffer_length = 0U;
+		buffer_used = 0U;
+		message_held = false;
+		
+		// input that was there before any new request was made is left from Actisense format
+		stale_length = xStreamBufferBytesAvailable(n2k_gateway_input);
+		portENTER_CRITICAL(&n2k_health_mux);
+		request_pending = n2k_gateway_request.pending;
+		portEXIT_CRITICAL(&n2k_health_mux);
+		while (!request_pending && stale_length > 0U)
+		{
+			stale_length -= xStreamBufferReceive(n2k_gateway_input, buffer,
+					stale_length < sizeof(buffer) ? stale_length : sizeof(buffer), (TickType_t)0);
+		}
+		return false;
+	}
+	
+	while (true)
+	{
+		if (message_held)
+		{
+			if (NMEA2000.SendMsg(N2kMsg))
+			{
+				n2k_gateway_input_sent++;
+			}
+			else if (NMEA2000.IsSendBlocked())
+			{
+				return true;
+			}
+			else
+			{
+				n2k_gateway_input_refused++;
+			}
+			message_held = false;
+		}
+		
+		if (buffer_used == buffer_length)
+		{
+			buffer_length = xStreamBufferReceive(n2k_gateway_input, buffer, sizeof(buffer), (TickType_t)0);
+			buffer_used = 0U;
+			if (buffer_length == 0U)
+			{
+				return false;
+			}
+		}
+		
+		buffer_used += n2k_actisense_reader.ParseBlock(&buffer[buffer_used], buffer_length - buffer_used, N2kMsg, message_ready);
+		if (message_ready)
+		{
+			if (n2k_gateway_input_allowed(N2kMsg.PGN))
+			{
+				message_held = true;
+			}
+			else
+			{
+				n2k_gateway_input_refused++;
+			}
+		}
+	}
+}
+
+/**
+ * Check if a PGN may be sent to the bus from the raw gateway input
+ *
+ * @param PGN The PGN
+ * @return true if allowed
+ */
+static bool n2k_gateway_input_allowed(unsigned long PGN)
+{
+	uint8_t i;
+	
+	for (i = 0U; n2k_gateway_input_messages[i] != 0UL; i++)
+	{
+		if (n2k_gateway_input_messages[i] == PGN)
+		{
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+/**
+ * Get the $BBGWY name of a raw gateway format
+ *
+ * @param format The format
+ * @return The name
+ */
+static const char *n2k_gateway_format_name(tN2kGateway::tFormat format)
+{
+	uint8_t i;
+	
+	for (i = 0U; i < (uint8_t)(sizeof(n2k_gateway_formats) / sizeof(n2k_gateway_formats[0])); i++)
+	{
+		if (n2k_gateway_formats[i].format == format)
+		{
+			return n2k_gateway_formats[i].name;
+		}
+	}
+	
+	return "OFF";
+}
+
+/**
+ * Put a replayed CAN frame into the CAN driver receive queue as if received from the bus
+ *
+ * @param id The 29 bit frame identifier
+ * @param length Number of data bytes
+ * @param data The data bytes
+ * @return true if queued, false if the receive queue was full
+ */
+static bool inject_can_frame(unsigned long id, unsigned char length, const unsigned char *data)
+{
+	return static_cast<tNMEA2000_esp32 &>(NMEA2000).InjectRxFrame(id, length, data);
+}
+
 /**
  * Handle an incoming NMEA2000 heading message
  *
@@ -978,9 +1846,11 @@ static void heading_handler(const tN2kMsg &N2kMsg)
 {
     unsigned char SID;
     tN2kHeadingReference HeadingReference;
-    double Heading;
-    double Deviation;
-    double Variation;
+    float Heading;
+    float Deviation;
+    float Variation;
+	boat_data_snapshot_t snapshot;
+	uint32_t time_ms = timer_get_time_ms();
 	
     if (ParseN2kHeading(N2kMsg, SID, Heading, Deviation, Variation, HeadingReference)) 
 	{
@@ -988,18 +1858,18 @@ static void heading_handler(const tN2kMsg &N2kMsg)
 		{
 			if (!N2kIsNA(Heading))
 			{
-				heading_true_data = (float)RadToDeg(Heading);
-				boat_data_reception_time.heading_true_received_time = timer_get_time_ms();
+				boat_data_set(boat_data_heading_true, RadToDeg(Heading), boat_data_source_n2k, time_ms);
 			}
 		}
 		else if (HeadingReference == N2khr_magnetic)
 		{
 			if (!N2kIsNA(Heading))
 			{
-				if (timer_get_time_ms() - boat_data_reception_time.wmm_calculation_time < WMM_CALCULATION_MAX_DATA_AGE)
+				boat_data_get_group(boat_data_group_heading, &snapshot);
+				if (boat_data_fresh(&snapshot, boat_data_variation, time_ms))
 				{
-					heading_true_data = (float)RadToDeg(Heading) + variation_wmm_data;
-					boat_data_reception_time.heading_true_received_time = timer_get_time_ms();				
+					boat_data_set(boat_data_heading_true, RadToDeg(Heading) + snapshot.entries[boat_data_variation].value.number,
+							boat_data_source_n2k, time_ms);
 				}
 			}				
 		}
@@ -1014,8 +1884,8 @@ static void heading_handler(const tN2kMsg &N2kMsg)
 static void depth_handler(const tN2kMsg &N2kMsg) 
 {
     unsigned char SID;
-    double depth_below_transducer;
-    double offset;
+    float depth_below_transducer;
+    float offset;
 	
 	if (ParseN2kWaterDepth(N2kMsg, SID, depth_below_transducer, offset)) 
 	{
@@ -1025,15 +1895,14 @@ static void depth_handler(const tN2kMsg &N2kMsg)
 			if (!N2kIsNA(offset))
 			{
 				// have a good offset as well so use it
-				depth_data = (float)(depth_below_transducer + offset);
+				boat_data_set(boat_data_depth, depth_below_transducer + offset, boat_data_source_n2k, timer_get_time_ms());
 			}
 			else
 			{
 				// don't have offset so ignore
-				depth_data = (float)(depth_below_transducer);
+				boat_data_set(boat_data_depth, depth_below_transducer, boat_data_source_n2k, timer_get_time_ms());
 			}
 		}
-		boat_data_reception_time.depth_received_time = timer_get_time_ms();
 	}
 }
 
@@ -1045,31 +1914,41 @@ static void depth_handler(const tN2kMsg &N2kMsg)
 static void boat_speed_handler(const tN2kMsg &N2kMsg) 
 {
     unsigned char SID;
-    double SOW;
-    double SOG;
+    float SOW;
+    float SOG;
     tN2kSpeedWaterReferenceType SWRT;
 	
     if (ParseN2kBoatSpeed(N2kMsg, SID, SOW, SOG, SWRT)) 
 	{
 		if (!N2kIsNA(SOW) && SWRT != N2kSWRT_Error && SWRT != N2kSWRT_Unavailable)
 		{
-			boat_speed_data = (float)msToKnots(SOW);
-			boat_data_reception_time.boat_speed_received_time = timer_get_time_ms();
+			boat_data_set(boat_data_boat_speed, msToKnots(SOW), boat_data_source_n2k, timer_get_time_ms());
 		}
     }	
 }	
 
 /**
- * Handle an incoming NMEA2000 wind message
+ * Handle an incoming NMEA2000 wind message. True wind and wind directions are worked out from apparent wind, boat
+ * speed and heading and written in one go, so readers never see a true wind angle with the speed of another message.
  *
  * @param N2kMsg Reference to the incoming message
  */
 static void wind_handler(const tN2kMsg &N2kMsg) 
 {
     unsigned char SID;
-	double WindSpeed;
-	double WindAngle;
+	float WindSpeed;
+	float WindAngle;
 	tN2kWindReference WindReference;
+	boat_data_snapshot_t snapshot;
+	boat_data_update_t updates[4];
+	uint8_t count = 0U;
+	float boat_speed;
+	float apparent_wind_speed;
+	float apparent_wind_angle;
+	float true_wind_speed;
+	float true_wind_angle;
+	float wind_direction_true;
+	float wind_direction_magnetic;
 	uint32_t time_ms = timer_get_time_ms();
 
     if (ParseN2kWindSpeed(N2kMsg, SID, WindSpeed, WindAngle, WindReference)) 
@@ -1078,80 +1957,99 @@ static void wind_handler(const tN2kMsg &N2kMsg)
 		{
 			if (!N2kIsNA(WindSpeed))
 			{
-				apparent_wind_speed_data = (float)msToKnots(WindSpeed);
-				boat_data_reception_time.apparent_wind_speed_received_time = time_ms;
+				updates[count].channel = boat_data_apparent_wind_speed;
+				updates[count].value.number = msToKnots(WindSpeed);
+				count++;
 			}
 			
 			if (!N2kIsNA(WindAngle))
 			{
-				apparent_wind_angle_data = (float)RadToDeg(WindAngle);
-				boat_data_reception_time.apparent_wind_angle_received_time = time_ms;
+				updates[count].channel = boat_data_apparent_wind_angle;
+				updates[count].value.number = RadToDeg(WindAngle);
+				count++;
 			}			
+			boat_data_set_values(updates, count, boat_data_source_n2k, time_ms);
+			count = 0U;
 		}
 		
 		// calculate derived data
-		if (time_ms - boat_data_reception_time.boat_speed_received_time < BOAT_SPEED_MAX_DATA_AGE_MS)
+		boat_data_get_group(boat_data_group_water, &snapshot);
+		boat_data_get_group(boat_data_group_heading, &snapshot);
+		boat_data_get_group(boat_data_group_apparent_wind, &snapshot);
+		if (boat_data_fresh(&snapshot, boat_data_boat_speed, time_ms))
 		{
-			if (boat_speed_data < 0.01f)
+			boat_speed = snapshot.entries[boat_data_boat_speed].value.number;
+			apparent_wind_speed = snapshot.entries[boat_data_apparent_wind_speed].value.number;
+			apparent_wind_angle = snapshot.entries[boat_data_apparent_wind_angle].value.number;
+			if (boat_speed < 0.01f)
 			{
-				true_wind_speed_data = apparent_wind_speed_data;
-				true_wind_angle_data = apparent_wind_angle_data;
+				true_wind_speed = apparent_wind_speed;
+				true_wind_angle = apparent_wind_angle;
 			}
 			else
 			{
-				float x = boat_speed_data * sinf(apparent_wind_angle_data / DEGREES_TO_RADIANS);
-				float y = boat_speed_data * cosf(apparent_wind_angle_data / DEGREES_TO_RADIANS);
-				float z = apparent_wind_speed_data - y;
-				true_wind_speed_data = sqrtf(z * z + x * x);
-				if (true_wind_speed_data == 0.0f)
+				float x = boat_speed * sinf(apparent_wind_angle / DEGREES_TO_RADIANS);
+				float y = boat_speed * cosf(apparent_wind_angle / DEGREES_TO_RADIANS);
+				float z = apparent_wind_speed - y;
+				true_wind_speed = sqrtf(z * z + x * x);
+				if (true_wind_speed == 0.0f)
 				{
-					true_wind_angle_data = 0.0f;
+					true_wind_angle = 0.0f;
 				}
 				else
 				{
-					float t = (M_PI_2_F - apparent_wind_angle_data / DEGREES_TO_RADIANS) + acosf(x / true_wind_speed_data);
-					true_wind_angle_data = M_PI_F - t;
+					float t = (M_PI_2_F - apparent_wind_angle / DEGREES_TO_RADIANS) + acosf(x / true_wind_speed);
+					true_wind_angle = M_PI_F - t;
 				}
-				true_wind_angle_data *= DEGREES_TO_RADIANS;
-				if (true_wind_angle_data < 0.0f)
+				true_wind_angle *= DEGREES_TO_RADIANS;
+				if (true_wind_angle < 0.0f)
 				{
-					true_wind_angle_data += 360.0f;
+					true_wind_angle += 360.0f;
 				}
 				
-				if (true_wind_angle_data < 0.0f)
+				if (true_wind_angle < 0.0f)
 				{
-					true_wind_angle_data += 360.0f;
+					true_wind_angle += 360.0f;
 				}
 			}
 				
-			boat_data_reception_time.true_wind_speed_received_time = time_ms;
-			boat_data_reception_time.true_wind_angle_received_time = time_ms;
+			updates[count].channel = boat_data_true_wind_speed;
+			updates[count].value.number = true_wind_speed;
+			count++;
+			updates[count].channel = boat_data_true_wind_angle;
+			updates[count].value.number = true_wind_angle;
+			count++;
 				
-			if (time_ms - boat_data_reception_time.heading_true_received_time < HEADING_TRUE_MAX_DATA_AGE_MS)
+			if (boat_data_fresh(&snapshot, boat_data_heading_true, time_ms))
 			{
-				wind_direction_true_data = heading_true_data + true_wind_angle_data;
-				if (wind_direction_true_data >= 360.0f)
+				wind_direction_true = snapshot.entries[boat_data_heading_true].value.number + true_wind_angle;
+				if (wind_direction_true >= 360.0f)
 				{
-					wind_direction_true_data -= 360.0f;
+					wind_direction_true -= 360.0f;
 				}
 				
-				boat_data_reception_time.wind_direction_true_received_time = time_ms;
+				updates[count].channel = boat_data_wind_direction_true;
+				updates[count].value.number = wind_direction_true;
+				count++;
 		
-				if (time_ms - boat_data_reception_time.wmm_calculation_time < WMM_CALCULATION_MAX_DATA_AGE)
+				if (boat_data_fresh(&snapshot, boat_data_variation, time_ms))
 				{
-					wind_direction_magnetic_data = wind_direction_true_data - variation_wmm_data;
-					if (wind_direction_magnetic_data >= 360.0f)
+					wind_direction_magnetic = wind_direction_true - snapshot.entries[boat_data_variation].value.number;
+					if (wind_direction_magnetic >= 360.0f)
 					{
-						wind_direction_magnetic_data -= 360.0f;
+						wind_direction_magnetic -= 360.0f;
 					}					
-					else if (wind_direction_magnetic_data < 0.0f)
+					else if (wind_direction_magnetic < 0.0f)
 					{
-						wind_direction_magnetic_data += 360.0f;
+						wind_direction_magnetic += 360.0f;
 					}	
 					
-					boat_data_reception_time.wind_direction_magnetic_received_time = time_ms;
+					updates[count].channel = boat_data_wind_direction_magnetic;
+					updates[count].value.number = wind_direction_magnetic;
+					count++;
 				}
 			}			
+			boat_data_set_values(updates, count, boat_data_source_calculated, time_ms);
 		}
     }	
 }	
@@ -1164,23 +2062,28 @@ static void wind_handler(const tN2kMsg &N2kMsg)
 static void log_handler(const tN2kMsg &N2kMsg) 
 {
 	uint16_t DaysSince1970;
-	double SecondsSinceMidnight;
+	float SecondsSinceMidnight;
 	uint32_t Log;
 	uint32_t TripLog;
+	boat_data_update_t updates[2];
+	uint8_t count = 0U;
 	
     if (ParseN2kDistanceLog(N2kMsg, DaysSince1970, SecondsSinceMidnight, Log, TripLog)) 
 	{
-		if (!N2kIsNA(Log))
+		if (!N2kIsNA(TripLog))
 		{
-			trip_data = ((float)TripLog) / 1852.0f;
-			boat_data_reception_time.trip_received_time = timer_get_time_ms();
+			updates[count].channel = boat_data_trip;
+			updates[count].value.number = ((float)TripLog) / 1852.0f;
+			count++;
 		}
 		
 		if (!N2kIsNA(Log))
 		{
-			total_distance_data = ((float)Log) / 1852.0f;
-			boat_data_reception_time.total_distance_received_time = timer_get_time_ms();
+			updates[count].channel = boat_data_total_distance;
+			updates[count].value.number = ((float)Log) / 1852.0f;
+			count++;
 		}			
+		boat_data_set_values(updates, count, boat_data_source_n2k, timer_get_time_ms());
     }	
 }	
 
@@ -1192,16 +2095,15 @@ static void log_handler(const tN2kMsg &N2kMsg)
 static void environmental_handler(const tN2kMsg &N2kMsg) 
 {
     unsigned char SID;
-	double WaterTemperature;
-	double OutsideAmbientAirTemperature;
-	double AtmosphericPressure;
+	float WaterTemperature;
+	float OutsideAmbientAirTemperature;
+	float AtmosphericPressure;
 
 	if (ParseN2kOutsideEnvironmentalParameters(N2kMsg, SID, WaterTemperature, OutsideAmbientAirTemperature, AtmosphericPressure)) 
 	{
 		if (!N2kIsNA(WaterTemperature))
 		{
-			seawater_temeperature_data = (float)KelvinToC(WaterTemperature);
-			boat_data_reception_time.seawater_temperature_received_time = timer_get_time_ms();
+			boat_data_set(boat_data_seawater_temperature, KelvinToC(WaterTemperature), boat_data_source_n2k, timer_get_time_ms());
 		}
 	}
 }
@@ -1214,22 +2116,27 @@ static void environmental_handler(const tN2kMsg &N2kMsg)
 static void latlong_handler(const tN2kMsg &N2kMsg) 
 {
 #ifndef CREATE_TEST_DATA_CODE					
-	double latitude;
-	double longitude;
+	float latitude;
+	float longitude;
+	boat_data_update_t updates[2];
+	uint8_t count = 0U;
 	
 	if (ParseN2kPositionRapid(N2kMsg, latitude, longitude)) 
 	{
 		if (!N2kIsNA(latitude))
 		{
-			latitude_data = (float)latitude;
-			boat_data_reception_time.latitude_received_time = timer_get_time_ms();				
+			updates[count].channel = boat_data_latitude;
+			updates[count].value.number = latitude;
+			count++;
 		}
 		
 		if (!N2kIsNA(longitude))
 		{
-			longitude_data = (float)longitude;
-			boat_data_reception_time.longitude_received_time = timer_get_time_ms();				
+			updates[count].channel = boat_data_longitude;
+			updates[count].value.number = longitude;
+			count++;
 		}		
+		boat_data_set_values(updates, count, boat_data_source_n2k, timer_get_time_ms());
 	}
 #endif			
 }
@@ -1244,40 +2151,83 @@ static void sogcog_handler(const tN2kMsg &N2kMsg)
 #ifndef CREATE_TEST_DATA_CODE					
 
     unsigned char SID;
-	double sog;
-	double cog;
+	float sog;
+	float cog;
 	tN2kHeadingReference ref;
+	boat_data_snapshot_t snapshot;
+	boat_data_update_t updates[2];
+	uint8_t count = 0U;
+	uint32_t time_ms = timer_get_time_ms();
 	
 	if (ParseN2kCOGSOGRapid(N2kMsg, SID, ref, cog, sog)) 
 	{
 		if (!N2kIsNA(sog))
 		{
-			speed_over_ground_data = (float)msToKnots(sog);
-			boat_data_reception_time.speed_over_ground_received_time = timer_get_time_ms();					
+			updates[count].channel = boat_data_speed_over_ground;
+			updates[count].value.number = msToKnots(sog);
+			count++;
 		}
 		
+		// COG is kept in whole degrees from 0 to 359, with variation added it can be outside that
 		if (!N2kIsNA(cog))
 		{
 			if (ref == N2khr_true)
 			{
-				course_over_ground_data = (int16_t)RadToDeg(cog);
-				boat_data_reception_time.course_over_ground_received_time = timer_get_time_ms();
+				updates[count].channel = boat_data_course_over_ground;
+				updates[count].value.number = course_whole_degrees(RadToDeg(cog));
+				count++;
 			}
-			else if (ref == N2khr_magnetic && timer_get_time_ms() - boat_data_reception_time.wmm_calculation_time < WMM_CALCULATION_MAX_DATA_AGE)
+			else if (ref == N2khr_magnetic)
 			{
-				course_over_ground_data = (int16_t)RadToDeg(cog) + variation_wmm_data;
-				boat_data_reception_time.course_over_ground_received_time = timer_get_time_ms();
+				boat_data_get_group(boat_data_group_heading, &snapshot);
+				if (boat_data_fresh(&snapshot, boat_data_variation, time_ms))
+				{
+					updates[count].channel = boat_data_course_over_ground;
+					updates[count].value.number = course_whole_degrees(RadToDeg(cog) + snapshot.entries[boat_data_variation].value.number);
+					count++;
+				}
 			}					
 		}	
 		else
 		{
-			course_over_ground_data = 0;		// same horrible hack as RMC message as emtrak devices do not put out cog when sog is very small
-			boat_data_reception_time.course_over_ground_received_time = timer_get_time_ms();
+			updates[count].channel = boat_data_course_over_ground;
+			updates[count].value.number = 0.0f;		// same horrible hack as RMC message as emtrak devices do not put out cog when sog is very small
+			count++;
 		}
+		boat_data_set_values(updates, count, boat_data_source_n2k, time_ms);
 	}
 #endif		
 }
 
+#ifdef N2K_ACCESSOR_BENCH_CODE
+/**
+ * Clock for the NMEA2000 accessor benchmark
+ *
+ * @return Time since boot in nanoseconds
+ */
+static uint64_t bench_clock_ns(void)
+{
+	return (uint64_t)esp_timer_get_time() * 1000ULL;
+}
+
+/**
+ * Time the double, float and fixed point NMEA2000 message functions on this CPU and log the results
+ */
+static void run_n2k_accessor_bench(void)
+{
+	static const char *path_names[N2K_BENCH_PATH_COUNT] = {"double", "float", "fixed"};
+	n2k_bench_result_t result;
+	uint32_t i;
+	
+	n2k_bench_run(10000UL, bench_clock_ns, &result);
+	for (i = 0UL; i < N2K_BENCH_PATH_COUNT; i++)
+	{
+		ESP_LOGI(pcTaskGetName(NULL), "N2k %s: parse %u ns, set %u ns per message, %u mismatches", path_names[i], 
+				(uint32_t)(result.parse_ns[i] / result.messages), (uint32_t)(result.set_ns[i] / result.messages), result.mismatches[i]);
+	}
+}
+#endif
+
 #ifdef CREATE_TEST_DATA_CODE
 /**
  * Create simulated boat data
@@ -1286,136 +2236,152 @@ static void test_data(void)
 {
 	static uint32_t i;
 	static bool init = false;
+	static float depth;
+	static float heading_true;
+	static int16_t course_over_ground;
+	static float boat_speed;
+	static float speed_over_ground;
+	static float seawater_temperature;
+	static float true_wind_speed;
+	static float true_wind_angle;
+	boat_data_update_t updates[6];
+	uint32_t time_ms;
 	
 	if (!init)
 	{
 		init = true;
-		depth_data = 3.0f;	
-		heading_true_data = 80.0f;
-		course_over_ground_data = 220;
-		trip_data = 0.1f;
-		total_distance_data = 32445.0;
-		boat_speed_data = 0.0f;
-		speed_over_ground_data = 0.0f;
-		seawater_temeperature_data = 6.5f;
-		latitude_data = 58.251f;
-		longitude_data = -5.227f;	
-		true_wind_speed_data = 18.0f;
-		true_wind_angle_data = 0.0f;
-		apparent_wind_speed_data = 18.0f;
-		apparent_wind_angle_data = 0.0f;
+		depth = 3.0f;	
+		heading_true = 80.0f;
+		course_over_ground = 220;
+		boat_speed = 0.0f;
+		speed_over_ground = 0.0f;
+		seawater_temperature = 6.5f;
+		true_wind_speed = 18.0f;
+		true_wind_angle = 0.0f;
 	}
 
 	i++;
 	if (i % 100UL == 0UL)
 	{
-		depth_data += (0.2f * (float)esp_random() / (float)UINT32_MAX) - 0.1f;
-		if (depth_data < 2.0f)
+		time_ms = timer_get_time_ms();
+
+		depth += (0.2f * (float)esp_random() / (float)UINT32_MAX) - 0.1f;
+		if (depth < 2.0f)
 		{
-			depth_data = 2.0f;
+			depth = 2.0f;
 		}
-		if (depth_data > 4.0f)
+		if (depth > 4.0f)
 		{
-			depth_data = 4.0f;
+			depth = 4.0f;
 		}		
-		boat_data_reception_time.depth_received_time = timer_get_time_ms();		
+		boat_data_set(boat_data_depth, depth, boat_data_source_test, time_ms);
 		
-		heading_true_data += (10.0f * (float)esp_random() / (float)UINT32_MAX) - 5.0f;
-		if (heading_true_data < 60.0f)
+		heading_true += (10.0f * (float)esp_random() / (float)UINT32_MAX) - 5.0f;
+		if (heading_true < 60.0f)
 		{
-			heading_true_data = 60.0f;
+			heading_true = 60.0f;
 		}
-		if (heading_true_data > 100.0f)
+		if (heading_true > 100.0f)
 		{
-			heading_true_data = 100.0f;
+			heading_true = 100.0f;
 		}		
-		boat_data_reception_time.heading_true_received_time = timer_get_time_ms();		
+		boat_data_set(boat_data_heading_true, heading_true, boat_data_source_test, time_ms);
 		
-		course_over_ground_data += (int16_t)(90.0f * (float)esp_random() / (float)UINT32_MAX) - 45;
-		if (course_over_ground_data < 0)
+		course_over_ground += (int16_t)(90.0f * (float)esp_random() / (float)UINT32_MAX) - 45;
+		if (course_over_ground < 0)
 		{
-			course_over_ground_data += 360;
+			course_over_ground += 360;
 		}
-		if (course_over_ground_data >= 360)
+		if (course_over_ground >= 360)
 		{
-			course_over_ground_data -= 360;
+			course_over_ground -= 360;
 		}		
-		boat_data_reception_time.course_over_ground_received_time = timer_get_time_ms();				
 		
-		boat_speed_data += (0.1f * (float)esp_random() / (float)UINT32_MAX) - 0.05f;
-		if (boat_speed_data < 0.0f)
+		boat_speed += (0.1f * (float)esp_random() / (float)UINT32_MAX) - 0.05f;
+		if (boat_speed < 0.0f)
 		{
-			boat_speed_data = 0.0f;
+			boat_speed = 0.0f;
 		}
-		if (boat_speed_data > 0.2f)
+		if (boat_speed > 0.2f)
 		{
-			boat_speed_data = 0.2f;
+			boat_speed = 0.2f;
 		}		
-		boat_data_reception_time.boat_speed_received_time = timer_get_time_ms();		
+		boat_data_set(boat_data_boat_speed, boat_speed, boat_data_source_test, time_ms);
 
-		speed_over_ground_data += (0.1f * (float)esp_random() / (float)UINT32_MAX) - 0.05f;
-		if (speed_over_ground_data < 0.0f)
+		speed_over_ground += (0.1f * (float)esp_random() / (float)UINT32_MAX) - 0.05f;
+		if (speed_over_ground < 0.0f)
 		{
-			speed_over_ground_data = 0.0f;
+			speed_over_ground = 0.0f;
 		}
-		if (speed_over_ground_data > 0.2f)
+		if (speed_over_ground > 0.2f)
 		{
-			speed_over_ground_data = 0.2f;
+			speed_over_ground = 0.2f;
 		}		
-		boat_data_reception_time.speed_over_ground_received_time = timer_get_time_ms();	
+		updates[0].channel = boat_data_speed_over_ground;
+		updates[0].value.number = speed_over_ground;
+		updates[1].channel = boat_data_course_over_ground;
+		updates[1].value.number = (float)course_over_ground;
+		boat_data_set_values(updates, 2U, boat_data_source_test, time_ms);
 		
-		seawater_temeperature_data += (0.1f * (float)esp_random() / (float)UINT32_MAX) - 0.05f;
-		if (seawater_temeperature_data < 6.0f)
+		seawater_temperature += (0.1f * (float)esp_random() / (float)UINT32_MAX) - 0.05f;
+		if (seawater_temperature < 6.0f)
 		{
-			seawater_temeperature_data = 6.0f;
+			seawater_temperature = 6.0f;
 		}
-		if (seawater_temeperature_data > 7.0f)
+		if (seawater_temperature > 7.0f)
 		{
-			seawater_temeperature_data = 7.0f;
+			seawater_temperature = 7.0f;
 		}		
-		boat_data_reception_time.seawater_temperature_received_time = timer_get_time_ms();			
+		boat_data_set(boat_data_seawater_temperature, seawater_temperature, boat_data_source_test, time_ms);
 
-		true_wind_speed_data += (10.1f * (float)esp_random() / (float)UINT32_MAX) - 5.0f;
-		if (true_wind_speed_data < 2.3f)
+		true_wind_speed += (10.1f * (float)esp_random() / (float)UINT32_MAX) - 5.0f;
+		if (true_wind_speed < 2.3f)
 		{
-			true_wind_speed_data = 2.3f;
+			true_wind_speed = 2.3f;
 		}
-		if (true_wind_speed_data > 25.1f)
+		if (true_wind_speed > 25.1f)
 		{
-			true_wind_speed_data = 25.1f;
+			true_wind_speed = 25.1f;
 		}		
-		boat_data_reception_time.true_wind_speed_received_time = timer_get_time_ms();		
 
-		true_wind_angle_data += (5.0f * (float)esp_random() / (float)UINT32_MAX) - 2.5f;	
-		if (true_wind_angle_data > 10.0f)
+		true_wind_angle += (5.0f * (float)esp_random() / (float)UINT32_MAX) - 2.5f;	
+		if (true_wind_angle > 10.0f)
 		{
-			true_wind_angle_data = 10.0f;
+			true_wind_angle = 10.0f;
 		}
-		if (true_wind_angle_data < -10.0f)
+		if (true_wind_angle < -10.0f)
 		{
-			true_wind_angle_data = -10.0f;
+			true_wind_angle = -10.0f;
 		}		
-		boat_data_reception_time.true_wind_angle_received_time = timer_get_time_ms();	
-
-		apparent_wind_speed_data = true_wind_speed_data + (1.0f * (float)esp_random() / (float)UINT32_MAX) - 0.5f;		
-		boat_data_reception_time.apparent_wind_speed_received_time = timer_get_time_ms();			
-		
-		apparent_wind_angle_data = true_wind_angle_data + (8.0f * (float)esp_random() / (float)UINT32_MAX) - 4.0f;		
-		boat_data_reception_time.apparent_wind_angle_received_time = timer_get_time_ms();		
-
-		gmt_data.hour = 12U;
-		gmt_data.minute = 33U;
-		gmt_data.second = 44U;
-		date_data.date = 3U;
-		date_data.month = 5U;
-		date_data.year = 22U;
-
-		boat_data_reception_time.trip_received_time = timer_get_time_ms();
-		boat_data_reception_time.total_distance_received_time = timer_get_time_ms();	
-		boat_data_reception_time.latitude_received_time = timer_get_time_ms();
-		boat_data_reception_time.longitude_received_time = timer_get_time_ms();		
-		boat_data_reception_time.date_received_time = timer_get_time_ms();		
-		boat_data_reception_time.gmt_received_time = timer_get_time_ms();		
+		updates[0].channel = boat_data_true_wind_speed;
+		updates[0].value.number = true_wind_speed;
+		updates[1].channel = boat_data_true_wind_angle;
+		updates[1].value.number = true_wind_angle;
+		boat_data_set_values(updates, 2U, boat_data_source_test, time_ms);
+
+		updates[0].channel = boat_data_apparent_wind_speed;
+		updates[0].value.number = true_wind_speed + (1.0f * (float)esp_random() / (float)UINT32_MAX) - 0.5f;		
+		updates[1].channel = boat_data_apparent_wind_angle;
+		updates[1].value.number = true_wind_angle + (8.0f * (float)esp_random() / (float)UINT32_MAX) - 4.0f;		
+		boat_data_set_values(updates, 2U, boat_data_source_test, time_ms);
+
+		updates[0].channel = boat_data_gmt;
+		updates[0].value.time.hour = 12U;
+		updates[0].value.time.minute = 33U;
+		updates[0].value.time.second = 44U;
+		updates[1].channel = boat_data_date;
+		updates[1].value.date.date = 3U;
+		updates[1].value.date.month = 5U;
+		updates[1].value.date.year = 22U;
+		updates[2].channel = boat_data_latitude;
+		updates[2].value.number = 58.251f;
+		updates[3].channel = boat_data_longitude;
+		updates[3].value.number = -5.227f;
+		updates[4].channel = boat_data_trip;
+		updates[4].value.number = 0.1f;
+		updates[5].channel = boat_data_total_distance;
+		updates[5].value.number = 32445.0f;
+		boat_data_set_values(updates, 6U, boat_data_source_test, time_ms);
 	}
 }
 #endif
@@ -1429,16 +2395,20 @@ extern "C" void app_main(void)
 	uint8_t task_started_count = 0U;
     
     main_task_handle = xTaskGetCurrentTaskHandle();
+#ifdef N2K_ACCESSOR_BENCH_CODE
+	run_n2k_accessor_bench();
+#endif
     pressure_sensor_init();
-	serial_init(38400UL, 0UL);
+	serial_init(N0183_BAUD_RATE, 0UL);
 	led_init();
 	wmm_init();
 	settings_init();
 	sms_init();
 	temperature_sensor_init();	
 		
-	// init all the reception times to some time a long time ago
-	(void)memset((void *)&boat_data_reception_time, 0x7f, sizeof(boat_data_reception_time));
+	// no boat data received yet
+	boat_data_init();
+	(void)strcpy(n2k_gateway_stats.format, n2k_gateway_format_name(tN2kGateway::gwf_Off));
 		
     // publisher task
     (void)xTaskCreate(publisher_task, "publisher task", PUBLISHER_TASK_STACK_SIZE, NULL, (UBaseType_t)1, NULL); 	
@@ -1466,17 +2436,40 @@ extern "C" void app_main(void)
     NMEA2000.SetDeviceInformation(1, 140, 75, 2040); 
     NMEA2000.SetMode(tNMEA2000::N2km_ListenAndNode, settings_get_device_address());
     NMEA2000.EnableForward(false);      
-	NMEA2000.SetN2kCANMsgBufSize(25);
+	NMEA2000.SetN2kCANMsgBufSize(16, 9);
     NMEA2000.ExtendTransmitMessages(n2k_transmit_messages);
 	NMEA2000.ExtendReceiveMessages(n2k_receive_messages);
 	NMEA2000.SetMsgHandler(HandleNMEA2000Msg);	
+	NMEA2000.AttachMsgHandler(&n2k_bus_stats);
+	NMEA2000.AttachMsgHandler(&n2k_gateway);
+	NMEA2000.SetMaxReadFramesOnParse(N2K_FRAMES_PER_PARSE);
+	static_cast<tNMEA2000_esp32 &>(NMEA2000).SetRxFrameHook(capture_can_frame);
+	static_cast<tNMEA2000_esp32 &>(NMEA2000).EnableRxFilter();
+	capture_set_can_injector(inject_can_frame);
     NMEA2000.Open();	
 	
+	ais_init();
+	cpa_init(cpa_alarm_callback);
+	ais_set_position_callback(cpa_update_target);
     nmea_enable_receive_message(&nmea_receive_message_details_RMC);	
 	nmea_enable_receive_message(&nmea_receive_message_details_VDM);
 	nmea_enable_receive_message(&nmea_receive_message_details_GGA);
-	nmea_enable_transmit_message(&nmea_transmit_message_details_VDM);
 	nmea_enable_transmit_message(&nmea_transmit_message_details_GGA);
+	nmea_enable_receive_message(&nmea_receive_message_details_N2K);
+	nmea_enable_transmit_message(&nmea_transmit_message_details_N2K);
+	nmea_enable_receive_message(&nmea_receive_message_details_GWY);
+	nmea_enable_transmit_message(&nmea_transmit_message_details_GWY);
+	
+	// 10 bits a byte on the serial port
+	nmea_set_port_rate(PORT_N0183, N0183_BAUD_RATE / 10UL);
+	nmea_set_port_rate(PORT_BLUETOOTH, BLUETOOTH_NMEA0183_BYTES_PER_SECOND);
+	
+	// timer callbacks pass NMEA2000 messages to NMEA2000 task
+	n2k_send_queue = xQueueCreate((UBaseType_t)N2K_SEND_QUEUE_LENGTH, (UBaseType_t)sizeof(n2k_send_message_t));
+	alarm_sms_queue = xQueueCreate((UBaseType_t)ALARM_SMS_QUEUE_LENGTH, (UBaseType_t)(ALARM_SMS_TEXT_LENGTH + 1U));
+	
+	// timer task passes Actisense input from Bluetooth to NMEA2000 task
+	n2k_gateway_input = xStreamBufferCreate((size_t)N2K_GATEWAY_INPUT_BUFFER_SIZE, (size_t)1);
 	
 	// create 25ms timer
 	xTimers[SW_TIMER_25_MS] = xTimerCreate(
@@ -1506,20 +2499,14 @@ extern "C" void app_main(void)
 	(void)xTimerStart(xTimers[SW_TIMER_1_S], (TickType_t)0);			
 	(void)xTimerStart(xTimers[SW_TIMER_8_S], (TickType_t)0);		
 	
+	// NMEA2000 task is woken by received frames, so they are handled as they arrive rather than every 10ms
+	(void)xTaskCreate(n2k_task, "n2k task", N2K_TASK_STACK_SIZE, NULL, (UBaseType_t)N2K_TASK_PRIORITY, &n2k_task_handle);
+	
+#ifdef CREATE_TEST_DATA_CODE				
 	while (true) 
 	{ 
-        // do N2K routine stuff
-		NMEA2000.ParseMessages();
-        if (NMEA2000.ReadResetAddressChanged())
-        {
-			settings_set_device_address(NMEA2000.GetN2kSource());
-			settings_save();
-        }	
-		
-		vTaskDelay(10);        		
-				
-#ifdef CREATE_TEST_DATA_CODE				
 		test_data();
+		vTaskDelay(10);        		
+	}		
 #endif
-    }		
 }
@@ -0,0 +1,704 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <string.h>
+#include <math.h>
+#include "N2kMessages.h"
+#include "n2k_bench.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define MAX_FIELDS					8U				///< Most scaled fields in one of the measured PGNs
+#define PGN_COUNT					9U				///< Number of PGNs measured
+#define FLOAT_TOLERANCE				2.5e-7			///< Relative error allowed in float results, 2 float roundings
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Functions and field resolutions of one measured PGN. Parse functions return the scaled fields in the type of the path,
+ * set functions build the message from those.
+ */
+typedef struct
+{
+	uint8_t field_count;
+	double resolution[MAX_FIELDS];
+	bool (*parse_double)(const tN2kMsg &N2kMsg, double *v);
+	bool (*parse_float)(const tN2kMsg &N2kMsg, float *v);
+	bool (*parse_fixed)(const tN2kMsg &N2kMsg, int64_t *v);
+	void (*set_double)(tN2kMsg &N2kMsg, const double *v);
+	void (*set_float)(tN2kMsg &N2kMsg, const float *v);
+	void (*set_fixed)(tN2kMsg &N2kMsg, const int64_t *v);
+} pgn_bench_t;
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static void make_messages(tN2kMsg *messages);
+static uint32_t count_mismatches(const pgn_bench_t &bench, const tN2kMsg &N2kMsg, uint32_t path);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static volatile uint32_t sink;		///< Keeps the compiler from dropping the measured calls
+
+/****************
+*** CONSTANTS ***
+****************/
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+// 127250 heading
+static bool parse_127250_double(const tN2kMsg &N2kMsg, double *v)
+{
+	unsigned char SID;
+	tN2kHeadingReference ref;
+
+	return ParseN2kHeading(N2kMsg, SID, v[0], v[1], v[2], ref);
+}
+
+static bool parse_127250_float(const tN2kMsg &N2kMsg, float *v)
+{
+	unsigned char SID;
+	tN2kHeadingReference ref;
+
+	return ParseN2kHeading(N2kMsg, SID, v[0], v[1], v[2], ref);
+}
+
+static bool parse_127250_fixed(const tN2kMsg &N2kMsg, int64_t *v)
+{
+	unsigned char SID;
+	tN2kHeadingReference ref;
+	uint32_t heading;
+	int32_t deviation;
+	int32_t variation;
+	bool result = ParseN2kHeading(N2kMsg, SID, heading, deviation, variation, ref);
+
+	v[0] = heading;
+	v[1] = deviation;
+	v[2] = variation;
+
+	return result;
+}
+
+static void set_127250_double(tN2kMsg &N2kMsg, const double *v)
+{
+	SetN2kPGN127250(N2kMsg, 1U, v[0], v[1], v[2], N2khr_magnetic);
+}
+
+static void set_127250_float(tN2kMsg &N2kMsg, const float *v)
+{
+	SetN2kPGN127250(N2kMsg, 1U, v[0], v[1], v[2], N2khr_magnetic);
+}
+
+static void set_127250_fixed(tN2kMsg &N2kMsg, const int64_t *v)
+{
+	SetN2kPGN127250(N2kMsg, 1U, (uint32_t)v[0], (int32_t)v[1], (int32_t)v[2], N2khr_magnetic);
+}
+
+// 128259 boat speed
+static bool parse_128259_double(const tN2kMsg &N2kMsg, double *v)
+{
+	unsigned char SID;
+	tN2kSpeedWaterReferenceType SWRT;
+
+	return ParseN2kBoatSpeed(N2kMsg, SID, v[0], v[1], SWRT);
+}
+
+static bool parse_128259_float(const tN2kMsg &N2kMsg, float *v)
+{
+	unsigned char SID;
+	tN2kSpeedWaterReferenceType SWRT;
+
+	return ParseN2kBoatSpeed(N2kMsg, SID, v[0], v[1], SWRT);
+}
+
+static bool parse_128259_fixed(const tN2kMsg &N2kMsg, int64_t *v)
+{
+	unsigned char SID;
+	tN2kSpeedWaterReferenceType SWRT;
+	uint32_t water;
+	uint32_t ground;
+	bool result = ParseN2kBoatSpeed(N2kMsg, SID, water, ground, SWRT);
+
+	v[0] = water;
+	v[1] = ground;
+
+	return result;
+}
+
+static void set_128259_double(tN2kMsg &N2kMsg, const double *v)
+{
+	SetN2kPGN128259(N2kMsg, 1U, v[0], v[1], N2kSWRT_Paddle_wheel);
+}
+
+static void set_128259_float(tN2kMsg &N2kMsg, const float *v)
+{
+	SetN2kPGN128259(N2kMsg, 1U, v[0], v[1], N2kSWRT_Paddle_wheel);
+}
+
+static void set_128259_fixed(tN2kMsg &N2kMsg, const int64_t *v)
+{
+	SetN2kPGN128259(N2kMsg, 1U, (uint32_t)v[0], (uint32_t)v[1], N2kSWRT_Paddle_wheel);
+}
+
+// 128267 water depth
+static bool parse_128267_double(const tN2kMsg &N2kMsg, double *v)
+{
+	unsigned char SID;
+
+	return ParseN2kPGN128267(N2kMsg, SID, v[0], v[1], v[2]);
+}
+
+static bool parse_128267_float(const tN2kMsg &N2kMsg, float *v)
+{
+	unsigned char SID;
+
+	return ParseN2kPGN128267(N2kMsg, SID, v[0], v[1], v[2]);
+}
+
+static bool parse_128267_fixed(const tN2kMsg &N2kMsg, int64_t *v)
+{
+	unsigned char SID;
+	uint32_t depth;
+	int32_t offset;
+	uint32_t range;
+	bool result = ParseN2kPGN128267(N2kMsg, SID, depth, offset, range);
+
+	v[0] = depth;
+	v[1] = offset;
+	v[2] = range;
+
+	return result;
+}
+
+static void set_128267_double(tN2kMsg &N2kMsg, const double *v)
+{
+	SetN2kPGN128267(N2kMsg, 1U, v[0], v[1], v[2]);
+}
+
+static void set_128267_float(tN2kMsg &N2kMsg, const float *v)
+{
+	SetN2kPGN128267(N2kMsg, 1U, v[0], v[1], v[2]);
+}
+
+static void set_128267_fixed(tN2kMsg &N2kMsg, const int64_t *v)
+{
+	SetN2kPGN128267(N2kMsg, 1U, (uint32_t)v[0], (int32_t)v[1], (uint32_t)v[2]);
+}
+
+// 128275 distance log
+static bool parse_128275_double(const tN2kMsg &N2kMsg, double *v)
+{
+	uint16_t days;
+	uint32_t log;
+	uint32_t trip;
+	bool result = ParseN2kDistanceLog(N2kMsg, days, v[0], log, trip);
+
+	v[1] = log;
+	v[2] = trip;
+
+	return result;
+}
+
+static bool parse_128275_float(const tN2kMsg &N2kMsg, float *v)
+{
+	uint16_t days;
+	uint32_t log;
+	uint32_t trip;
+	bool result = ParseN2kDistanceLog(N2kMsg, days, v[0], log, trip);
+
+	v[1] = (float)log;
+	v[2] = (float)trip;
+
+	return result;
+}
+
+static bool parse_128275_fixed(const tN2kMsg &N2kMsg, int64_t *v)
+{
+	uint16_t days;
+	uint32_t seconds;
+	uint32_t log;
+	uint32_t trip;
+	bool result = ParseN2kDistanceLog(N2kMsg, days, seconds, log, trip);
+
+	v[0] = seconds;
+	v[1] = log;
+	v[2] = trip;
+
+	return result;
+}
+
+static void set_128275_double(tN2kMsg &N2kMsg, const double *v)
+{
+	SetN2kPGN128275(N2kMsg, 19000U, v[0], (uint32_t)v[1], (uint32_t)v[2]);
+}
+
+static void set_128275_float(tN2kMsg &N2kMsg, const float *v)
+{
+	SetN2kPGN128275(N2kMsg, 19000U, v[0], (uint32_t)v[1], (uint32_t)v[2]);
+}
+
+static void set_128275_fixed(tN2kMsg &N2kMsg, const int64_t *v)
+{
+	SetN2kPGN128275(N2kMsg, 19000U, (uint32_t)v[0], (uint32_t)v[1], (uint32_t)v[2]);
+}
+
+// 129025 position rapid
+static bool parse_129025_double(const tN2kMsg &N2kMsg, double *v)
+{
+	return ParseN2kPositionRapid(N2kMsg, v[0], v[1]);
+}
+
+static bool parse_129025_float(const tN2kMsg &N2kMsg, float *v)
+{
+	return ParseN2kPositionRapid(N2kMsg, v[0], v[1]);
+}
+
+static bool parse_129025_fixed(const tN2kMsg &N2kMsg, int64_t *v)
+{
+	int32_t latitude;
+	int32_t longitude;
+	bool result = ParseN2kPositionRapid(N2kMsg, latitude, longitude);
+
+	v[0] = latitude;
+	v[1] = longitude;
+
+	return result;
+}
+
+static void set_129025_double(tN2kMsg &N2kMsg, const double *v)
+{
+	SetN2kPGN129025(N2kMsg, v[0], v[1]);
+}
+
+static void set_129025_float(tN2kMsg &N2kMsg, const float *v)
+{
+	SetN2kPGN129025(N2kMsg, v[0], v[1]);
+}
+
+static void set_129025_fixed(tN2kMsg &N2kMsg, const int64_t *v)
+{
+	SetN2kPGN129025(N2kMsg, (int32_t)v[0], (int32_t)v[1]);
+}
+
+// 129026 COG and SOG rapid
+static bool parse_129026_double(const tN2kMsg &N2kMsg, double *v)
+{
+	unsigned char SID;
+	tN2kHeadingReference ref;
+
+	return ParseN2kCOGSOGRapid(N2kMsg, SID, ref, v[0], v[1]);
+}
+
+static bool parse_129026_float(const tN2kMsg &N2kMsg, float *v)
+{
+	unsigned char SID;
+	tN2kHeadingReference ref;
+
+	return ParseN2kCOGSOGRapid(N2kMsg, SID, ref, v[0], v[1]);
+}
+
+static bool parse_129026_fixed(const tN2kMsg &N2kMsg, int64_t *v)
+{
+	unsigned char SID;
+	tN2kHeadingReference ref;
+	uint32_t cog;
+	uint32_t sog;
+	bool result = ParseN2kCOGSOGRapid(N2kMsg, SID, ref, cog, sog);
+
+	v[0] = cog;
+	v[1] = sog;
+
+	return result;
+}
+
+static void set_129026_double(tN2kMsg &N2kMsg, const double *v)
+{
+	SetN2kPGN129026(N2kMsg, 1U, N2khr_true, v[0], v[1]);
+}
+
+static void set_129026_float(tN2kMsg &N2kMsg, const float *v)
+{
+	SetN2kPGN129026(N2kMsg, 1U, N2khr_true, v[0], v[1]);
+}
+
+static void set_129026_fixed(tN2kMsg &N2kMsg, const int64_t *v)
+{
+	SetN2kPGN129026(N2kMsg, 1U, N2khr_true, (uint32_t)v[0], (uint32_t)v[1]);
+}
+
+// 129029 GNSS position, fields are time, latitude, longitude, altitude, HDOP, PDOP and geoidal separation
+static bool parse_129029_double(const tN2kMsg &N2kMsg, double *v)
+{
+	unsigned char SID;
+	uint16_t days;
+	tN2kGNSStype type;
+	tN2kGNSSmethod method;
+	unsigned char satellites;
+	unsigned char stations;
+	tN2kGNSStype station_type;
+	uint16_t station_id;
+	double age;
+
+	return ParseN2kGNSS(N2kMsg, SID, days, v[0], v[1], v[2], v[3], type, method, satellites, v[4], v[5], v[6], stations,
+			station_type, station_id, age);
+}
+
+static bool parse_129029_float(const tN2kMsg &N2kMsg, float *v)
+{
+	unsigned char SID;
+	uint16_t days;
+	tN2kGNSStype type;
+	tN2kGNSSmethod method;
+	unsigned char satellites;
+	unsigned char stations;
+	tN2kGNSStype station_type;
+	uint16_t station_id;
+	float age;
+
+	return ParseN2kPGN129029(N2kMsg, SID, days, v[0], v[1], v[2], v[3], type, method, satellites, v[4], v[5], v[6], stations,
+			station_type, station_id, age);
+}
+
+static bool parse_129029_fixed(const tN2kMsg &N2kMsg, int64_t *v)
+{
+	unsigned char SID;
+	uint16_t days;
+	uint32_t seconds;
+	tN2kGNSStype type;
+	tN2kGNSSmethod method;
+	unsigned char satellites;
+	int32_t hdop;
+	int32_t pdop;
+	int32_t separation;
+	unsigned char stations;
+	tN2kGNSStype station_type;
+	uint16_t station_id;
+	uint32_t age;
+	bool result = ParseN2kPGN129029(N2kMsg, SID, days, seconds, v[1], v[2], v[3], type, method, satellites, hdop, pdop,
+			separation, stations, station_type, station_id, age);
+
+	v[0] = seconds;
+	v[4] = hdop;
+	v[5] = pdop;
+	v[6] = separation;
+
+	return result;
+}
+
+static void set_129029_double(tN2kMsg &N2kMsg, const double *v)
+{
+	SetN2kPGN129029(N2kMsg, 1U, 19000U, v[0], v[1], v[2], v[3], N2kGNSSt_GPS, N2kGNSSm_GNSSfix, 9U, v[4], v[5], v[6], 0U,
+			N2kGNSSt_GPS, 0U, N2kDoubleNA);
+}
+
+static void set_129029_float(tN2kMsg &N2kMsg, const float *v)
+{
+	SetN2kPGN129029(N2kMsg, 1U, 19000U, v[0], v[1], v[2], v[3], N2kGNSSt_GPS, N2kGNSSm_GNSSfix, 9U, v[4], v[5], v[6], 0U,
+			N2kGNSSt_GPS, 0U, N2kFloatNA);
+}
+
+static void set_129029_fixed(tN2kMsg &N2kMsg, const int64_t *v)
+{
+	SetN2kPGN129029(N2kMsg, 1U, 19000U, (uint32_t)v[0], v[1], v[2], v[3], N2kGNSSt_GPS, N2kGNSSm_GNSSfix, 9U, (int32_t)v[4],
+			(int32_t)v[5], (int32_t)v[6], 0U, N2kGNSSt_GPS, 0U, N2kUInt32NA);
+}
+
+// 130306 wind
+static bool parse_130306_double(const tN2kMsg &N2kMsg, double *v)
+{
+	unsigned char SID;
+	tN2kWindReference reference;
+
+	return ParseN2kWindSpeed(N2kMsg, SID, v[0], v[1], reference);
+}
+
+static bool parse_130306_float(const tN2kMsg &N2kMsg, float *v)
+{
+	unsigned char SID;
+	tN2kWindReference reference;
+
+	return ParseN2kWindSpeed(N2kMsg, SID, v[0], v[1], reference);
+}
+
+static bool parse_130306_fixed(const tN2kMsg &N2kMsg, int64_t *v)
+{
+	unsigned char SID;
+	tN2kWindReference reference;
+	uint32_t speed;
+	uint32_t angle;
+	bool result = ParseN2kWindSpeed(N2kMsg, SID, speed, angle, reference);
+
+	v[0] = speed;
+	v[1] = angle;
+
+	return result;
+}
+
+static void set_130306_double(tN2kMsg &N2kMsg, const double *v)
+{
+	SetN2kPGN130306(N2kMsg, 1U, v[0], v[1], N2kWind_Apparent);
+}
+
+static void set_130306_float(tN2kMsg &N2kMsg, const float *v)
+{
+	SetN2kPGN130306(N2kMsg, 1U, v[0], v[1], N2kWind_Apparent);
+}
+
+static void set_130306_fixed(tN2kMsg &N2kMsg, const int64_t *v)
+{
+	SetN2kPGN130306(N2kMsg, 1U, (uint32_t)v[0], (uint32_t)v[1], N2kWind_Apparent);
+}
+
+// 130310 outside environmental parameters
+static bool parse_130310_double(const tN2kMsg &N2kMsg, double *v)
+{
+	unsigned char SID;
+
+	return ParseN2kOutsideEnvironmentalParameters(N2kMsg, SID, v[0], v[1], v[2]);
+}
+
+static bool parse_130310_float(const tN2kMsg &N2kMsg, float *v)
+{
+	unsigned char SID;
+
+	return ParseN2kOutsideEnvironmentalParameters(N2kMsg, SID, v[0], v[1], v[2]);
+}
+
+static bool parse_130310_fixed(const tN2kMsg &N2kMsg, int64_t *v)
+{
+	unsigned char SID;
+	uint32_t water;
+	uint32_t air;
+	uint32_t pressure;
+	bool result = ParseN2kOutsideEnvironmentalParameters(N2kMsg, SID, water, air, pressure);
+
+	v[0] = water;
+	v[1] = air;
+	v[2] = pressure;
+
+	return result;
+}
+
+static void set_130310_double(tN2kMsg &N2kMsg, const double *v)
+{
+	SetN2kPGN130310(N2kMsg, 1U, v[0], v[1], v[2]);
+}
+
+static void set_130310_float(tN2kMsg &N2kMsg, const float *v)
+{
+	SetN2kPGN130310(N2kMsg, 1U, v[0], v[1], v[2]);
+}
+
+static void set_130310_fixed(tN2kMsg &N2kMsg, const int64_t *v)
+{
+	SetN2kPGN130310(N2kMsg, 1U, (uint32_t)v[0], (uint32_t)v[1], (uint32_t)v[2]);
+}
+
+static const pgn_bench_t pgn_benches[PGN_COUNT] =
+{
+	{3U, {1e-4, 1e-4, 1e-4}, parse_127250_double, parse_127250_float, parse_127250_fixed, set_127250_double, set_127250_float, set_127250_fixed},
+	{2U, {0.01, 0.01}, parse_128259_double, parse_128259_float, parse_128259_fixed, set_128259_double, set_128259_float, set_128259_fixed},
+	{3U, {0.01, 0.001, 10.0}, parse_128267_double, parse_128267_float, parse_128267_fixed, set_128267_double, set_128267_float, set_128267_fixed},
+	{3U, {1e-4, 1.0, 1.0}, parse_128275_double, parse_128275_float, parse_128275_fixed, set_128275_double, set_128275_float, set_128275_fixed},
+	{2U, {1e-7, 1e-7}, parse_129025_double, parse_129025_float, parse_129025_fixed, set_129025_double, set_129025_float, set_129025_fixed},
+	{2U, {1e-4, 0.01}, parse_129026_double, parse_129026_float, parse_129026_fixed, set_129026_double, set_129026_float, set_129026_fixed},
+	{7U, {1e-4, 1e-16, 1e-16, 1e-6, 0.01, 0.01, 0.01}, parse_129029_double, parse_129029_float, parse_129029_fixed, set_129029_double, set_129029_float, set_129029_fixed},
+	{2U, {0.01, 1e-4}, parse_130306_double, parse_130306_float, parse_130306_fixed, set_130306_double, set_130306_float, set_130306_fixed},
+	{3U, {0.01, 0.01, 100.0}, parse_130310_double, parse_130310_float, parse_130310_fixed, set_130310_double, set_130310_float, set_130310_fixed}
+};
+
+/**
+ * Make one message of each measured PGN with typical values, in the same order as pgn_benches
+ *
+ * @param messages Array of PGN_COUNT messages to fill
+ */
+static void make_messages(tN2kMsg *messages)
+{
+	SetN2kMagneticHeading(messages[0], 1U, 3.1234, 0.0123, -0.0567);
+	SetN2kBoatSpeed(messages[1], 1U, 3.21, 3.45);
+	SetN2kWaterDepth(messages[2], 1U, 12.34, 0.456, 100.0);
+	SetN2kDistanceLog(messages[3], 19000U, 45296.789, 123456UL, 5432UL);
+	SetN2kLatLonRapid(messages[4], 60.1234567, -24.7654321);
+	SetN2kCOGSOGRapid(messages[5], 1U, N2khr_true, 2.3456, 3.33);
+	SetN2kGNSS(messages[6], 1U, 19000U, 45296.789, 60.12345678901, -24.76543210987, 12.345678, N2kGNSSt_GPS, N2kGNSSm_GNSSfix,
+			9U, 0.87, 1.45, 18.62);
+	SetN2kWindSpeed(messages[7], 1U, 7.89, 0.7854, N2kWind_Apparent);
+	SetN2kOutsideEnvironmentalParameters(messages[8], 1U, 288.15, 293.55, 101300.0);
+}
+
+/**
+ * Compare the results of the float or fixed point parse of a message to the double parse
+ *
+ * @param bench The PGN
+ * @param N2kMsg The message
+ * @param path N2K_BENCH_PATH_FLOAT or N2K_BENCH_PATH_FIXED
+ * @return Number of fields that differ by more than the field resolution or the float error
+ */
+static uint32_t count_mismatches(const pgn_bench_t &bench, const tN2kMsg &N2kMsg, uint32_t path)
+{
+	double reference[MAX_FIELDS];
+	float float_values[MAX_FIELDS];
+	int64_t fixed_values[MAX_FIELDS];
+	double value;
+	double tolerance;
+	uint32_t mismatches = 0UL;
+	uint8_t i;
+
+	(void)bench.parse_double(N2kMsg, reference);
+	if (path == N2K_BENCH_PATH_FLOAT)
+	{
+		(void)bench.parse_float(N2kMsg, float_values);
+	}
+	else
+	{
+		(void)bench.parse_fixed(N2kMsg, fixed_values);
+	}
+
+	for (i = 0U; i < bench.field_count; i++)
+	{
+		if (path == N2K_BENCH_PATH_FLOAT)
+		{
+			value = (double)float_values[i];
+			tolerance = bench.resolution[i] + fabs(reference[i]) * FLOAT_TOLERANCE;
+		}
+		else
+		{
+			value = (double)fixed_values[i] * bench.resolution[i];
+			tolerance = bench.resolution[i] * 0.001;
+		}
+		if (fabs(value - reference[i]) > tolerance)
+		{
+			mismatches++;
+		}
+	}
+
+	return mismatches;
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+void n2k_bench_run(uint32_t iterations, n2k_bench_clock_t clock, n2k_bench_result_t *result)
+{
+	static tN2kMsg messages[PGN_COUNT];
+	static tN2kMsg out;
+	double double_values[PGN_COUNT][MAX_FIELDS];
+	float float_values[PGN_COUNT][MAX_FIELDS];
+	int64_t fixed_values[PGN_COUNT][MAX_FIELDS];
+	uint32_t parsed = 0UL;
+	uint64_t start;
+	uint32_t iteration;
+	uint32_t i;
+
+	memset(result, 0, sizeof(n2k_bench_result_t));
+	make_messages(messages);
+	result->messages = iterations * PGN_COUNT;
+
+	for (i = 0UL; i < PGN_COUNT; i++)
+	{
+		result->mismatches[N2K_BENCH_PATH_FLOAT] += count_mismatches(pgn_benches[i], messages[i], N2K_BENCH_PATH_FLOAT);
+		result->mismatches[N2K_BENCH_PATH_FIXED] += count_mismatches(pgn_benches[i], messages[i], N2K_BENCH_PATH_FIXED);
+	}
+
+	start = clock();
+	for (iteration = 0UL; iteration < iterations; iteration++)
+	{
+		for (i = 0UL; i < PGN_COUNT; i++)
+		{
+			parsed += pgn_benches[i].parse_double(messages[i], double_values[i]) ? 1UL : 0UL;
+		}
+	}
+	result->parse_ns[N2K_BENCH_PATH_DOUBLE] = clock() - start;
+
+	start = clock();
+	for (iteration = 0UL; iteration < iterations; iteration++)
+	{
+		for (i = 0UL; i < PGN_COUNT; i++)
+		{
+			parsed += pgn_benches[i].parse_float(messages[i], float_values[i]) ? 1UL : 0UL;
+		}
+	}
+	result->parse_ns[N2K_BENCH_PATH_FLOAT] = clock() - start;
+
+	start = clock();
+	for (iteration = 0UL; iteration < iterations; iteration++)
+	{
+		for (i = 0UL; i < PGN_COUNT; i++)
+		{
+			parsed += pgn_benches[i].parse_fixed(messages[i], fixed_values[i]) ? 1UL : 0UL;
+		}
+	}
+	result->parse_ns[N2K_BENCH_PATH_FIXED] = clock() - start;
+
+	start = clock();
+	for (iteration = 0UL; iteration < iterations; iteration++)
+	{
+		for (i = 0UL; i < PGN_COUNT; i++)
+		{
+			pgn_benches[i].set_double(out, double_values[i]);
+			parsed += (uint32_t)out.DataLen;
+		}
+	}
+	result->set_ns[N2K_BENCH_PATH_DOUBLE] = clock() - start;
+
+	start = clock();
+	for (iteration = 0UL; iteration < iterations; iteration++)
+	{
+		for (i = 0UL; i < PGN_COUNT; i++)
+		{
+			pgn_benches[i].set_float(out, float_values[i]);
+			parsed += (uint32_t)out.DataLen;
+		}
+	}
+	result->set_ns[N2K_BENCH_PATH_FLOAT] = clock() - start;
+
+	start = clock();
+	for (iteration = 0UL; iteration < iterations; iteration++)
+	{
+		for (i = 0UL; i < PGN_COUNT; i++)
+		{
+			pgn_benches[i].set_fixed(out, fixed_values[i]);
+			parsed += (uint32_t)out.DataLen;
+		}
+	}
+	result->set_ns[N2K_BENCH_PATH_FIXED] = clock() - start;
+
+	sink = parsed;
+}
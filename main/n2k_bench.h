@@ -0,0 +1,84 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef N2K_BENCH_H
+#define N2K_BENCH_H
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdint.h>
+
+/**************
+*** DEFINES ***
+**************/
+
+#define N2K_BENCH_PATH_DOUBLE		0U		///< Index of the double ParseN2k/SetN2k functions in results
+#define N2K_BENCH_PATH_FLOAT		1U		///< Index of the float overloads in results
+#define N2K_BENCH_PATH_FIXED		2U		///< Index of the fixed point overloads in results
+#define N2K_BENCH_PATH_COUNT		3U		///< Number of paths measured
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Clock for timing, returns nanoseconds from any fixed point
+ */
+typedef uint64_t (*n2k_bench_clock_t)(void);
+
+/**
+ * Results of one benchmark run
+ */
+typedef struct
+{
+	uint32_t messages;									///< Messages parsed and set on each path
+	uint64_t parse_ns[N2K_BENCH_PATH_COUNT];			///< Time to parse all messages on each path
+	uint64_t set_ns[N2K_BENCH_PATH_COUNT];				///< Time to set all messages on each path
+	uint32_t mismatches[N2K_BENCH_PATH_COUNT];			///< Parsed values that differ from the double path by more than the field resolution
+} n2k_bench_result_t;
+
+/*************************
+*** EXTERNAL VARIABLES ***
+*************************/
+
+/***************************
+*** FUNCTIONS PROTOTYPES ***
+***************************/
+
+/**
+ * Time the double, float and fixed point ParseN2k and SetN2k functions of the PGNs the firmware receives, 127250, 128259,
+ * 128267, 128275, 129025, 129026, 129029, 130306 and 130310. Used by the host benchmark n2k_accessor_bench and on the 
+ * ESP32 when the firmware is built with N2K_ACCESSOR_BENCH_CODE defined.
+ *
+ * @param iterations Number of times each of the 9 messages is parsed and set on each path
+ * @param clock Function that returns the time in nanoseconds
+ * @param result Where the results are returned
+ */
+void n2k_bench_run(uint32_t iterations, n2k_bench_clock_t clock, n2k_bench_result_t *result);
+
+#endif
@@ -32,8 +32,10 @@ SOFTWARE.
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
+#include <stdlib.h>
 #include <stdio.h>
 #include "nmea.h"
+#include "format.h"
 #include "serial.h"
 #include "timer.h"
 
@@ -41,7 +43,42 @@ SOFTWARE.
 *** DEFINES ***
 **************/
 
-#define NMEA_MESSAGE_MAP_ENTRIES (sizeof(nmea_message_type_map) / sizeof(nmea_message_type_map_t))		///< Number of entries in the mapping table of message headers to message types
+#define NMEA_MAX_FIELDS					24U					///< Most fields in a received sentence including the address field
+#define NMEA_RECEIVE_BUFFER_SIZE		256U				///< Received bytes held per port in a ring, a power of 2 and at least twice the longest sentence
+#define NMEA_RECEIVE_BUFFER_MASK		(NMEA_RECEIVE_BUFFER_SIZE - 1U)	///< Mask of a count of received bytes to its index in the ring
+#define NMEA_RECEIVE_MIRROR_SIZE		NMEA_MAX_MESSAGE_LENGTH	///< Bytes at the start of the ring also held after its end
+#define NMEA_WORD_ONES					0x01010101UL		///< Word with every byte 1
+#define NMEA_WORD_HIGHS					0x80808080UL		///< Word with top bit of every byte set
+#define NMEA_OUTPUT_HEADER_SIZE			6U					///< Bytes before each queued sentence, its length, the time it was queued and its group byte
+#define NMEA_OUTPUT_GROUP_OFFSET		5U					///< Offset of the group byte in a queued sentence header
+#define NMEA_OUTPUT_GROUP_CONTINUED		0x80U				///< Group byte flag for a sentence that is not the first of its group
+#define NMEA_OUTPUT_GROUP_FOLLOWING		0x7fU				///< Group byte mask of the number of sentences after this one in its group
+
+#if (NMEA_RECEIVE_BUFFER_SIZE & NMEA_RECEIVE_BUFFER_MASK) != 0U || NMEA_RECEIVE_BUFFER_SIZE < 2U * NMEA_MAX_MESSAGE_LENGTH
+#error "receive counts wrap at 65536 so the receive ring is a power of 2, and it must hold a partial sentence and a read"
+#endif
+
+#if NMEA_MAXIMUM_TRANSMIT_MESSAGE_DETAILS > 32U
+#error "transmit_now_slots has a bit per transmit message details slot"
+#endif
+
+/**
+ * True if millisecond time now is at or after deadline, correct across wrap of the 32 bit millisecond time as long
+ * as the two are less than 24 days apart
+ */
+#define NMEA_TIME_REACHED(now, deadline)	((int32_t)((uint32_t)(now) - (uint32_t)(deadline)) >= 0)
+
+/**
+ * The 3 letter sentence formatter packed in a word so that sentence types can be told apart with one switch
+ */
+#define NMEA_FORMATTER(a, b, c)	(((uint32_t)(uint8_t)(a) << 16) | ((uint32_t)(uint8_t)(b) << 8) | (uint32_t)(uint8_t)(c))
+
+/**
+ * Non zero if any byte in a 32 bit word equals byte. Subtracting 1 from each byte only sets a top bit that was clear
+ * where the byte was 0, so this finds zero bytes of word XOR byte without looking at bytes one at a time.
+ */
+#define NMEA_WORD_HAS_BYTE(word, byte) \
+	((((word) ^ (NMEA_WORD_ONES * (uint32_t)(byte))) - NMEA_WORD_ONES) & ~((word) ^ (NMEA_WORD_ONES * (uint32_t)(byte))) & NMEA_WORD_HIGHS)
 
 /************
 *** TYPES ***
@@ -54,42 +91,117 @@ typedef struct
 {
     const transmit_message_details_t *transmit_message_details;		///< Pointer to a transmit message details structure owned by the application
     uint32_t next_transmit_time;                                    ///< Time in milliseconds when the next transmit is scheduled
-    uint32_t current_transmit_period_ms;                            ///< Transmit period in ms which may be throttled in out of bandwidth situation
-    bool transmit_now;                                              ///< Transmit immediately required flag
+    uint32_t last_transmit_time;                                    ///< Time in milliseconds of the last periodic transmit
+    bool transmitted;                                               ///< If last_transmit_time is set
 } transmit_message_info_t;
 
 /**
- * Structure of a line in the table that maps message headers to message types
+ * Periodic messages of a port as a binary min-heap of transmit_messages_infos slots ordered by next transmit time, so
+ * the next message due is always at the top and finding and rescheduling it takes log n steps rather than a scan
+ */
+typedef struct
+{
+	uint8_t count;											///< Slots in heap
+	uint8_t slots[NMEA_MAXIMUM_TRANSMIT_MESSAGE_DETAILS];	///< Heap of slot numbers, slots[0] is the next due
+} transmit_heap_t;
+
+/**
+ * Sentences of one priority class waiting to be written to a port, in a ring. Each sentence is held after a header of
+ * NMEA_OUTPUT_HEADER_SIZE bytes, a byte of its length, the time in ms it was queued and a group byte. Sentences that
+ * only make sense together, like the fragments of a VDM message, are queued as a group next to each other.
+ */
+typedef struct
+{
+	char data[NMEA_OUTPUT_QUEUE_SIZE];			///< Ring of headers and sentences
+	uint16_t head;								///< Index in data of the header of the oldest sentence
+	uint16_t used;								///< Bytes of data in use
+} output_queue_t;
+
+/**
+ * Output side of a port, its queues and a token bucket that limits the rate sentences are written at
+ */
+typedef struct
+{
+	output_queue_t queues[nmea_priority_max];	///< Queue per priority class
+	uint32_t bytes_per_second;					///< Rate limit, 0 for none
+	uint32_t tokens;							///< Thousandths of bytes that may be written now
+	uint32_t refill_time;						///< Time in ms tokens were last added
+	nmea_output_stats_t stats;					///< Counters, queued_bytes is filled in when read
+} output_port_t;
+
+/**
+ * Received data and sentence framing state of a port. Data is read straight into a ring buffer and scanned once, a
+ * word at a time where possible, for sentence boundaries while the checksum is worked out. The first
+ * NMEA_RECEIVE_MIRROR_SIZE bytes of the ring are copied after its end as they are read, so a sentence that wraps is
+ * still contiguous and every complete sentence is passed to decoders where it lies. Positions are counts of bytes
+ * received that wrap at 65536, the index in the ring is the count masked with NMEA_RECEIVE_BUFFER_MASK.
+ */
+typedef struct
+{
+	union
+	{
+		uint32_t words[(NMEA_RECEIVE_BUFFER_SIZE + NMEA_RECEIVE_MIRROR_SIZE) / 4U + 1U];	///< For word aligned reads
+		char bytes[NMEA_RECEIVE_BUFFER_SIZE + NMEA_RECEIVE_MIRROR_SIZE + 1U];				///< Ring, its mirrored start and room for a terminator
+	} buffer;												///< Received data
+	uint16_t received;										///< Count of bytes read into the ring
+	uint16_t scanned;										///< Count of bytes already scanned
+	uint16_t sentence_start;								///< Count at the $ or ! of the sentence being received
+	uint16_t forwarded;										///< Count of bytes already passed on to the port's forward function
+	bool in_sentence;										///< If a sentence is being received
+	uint32_t checksum_words;								///< XOR of whole words of the sentence scanned so far
+	uint8_t checksum;										///< XOR of single bytes of the sentence scanned so far
+	nmea_receive_stats_t stats;								///< Framing counters
+} receive_framer_t;
+
+/**
+ * Fields of a received sentence found in one pass by tokenize. The sentence itself is not changed, a field ends at the
+ * comma, asterisk or line end that follows it. Field 0 is the address field, e.g. $GPGGA.
  */
 typedef struct
 {
-	const char message_header[4];		///< The message header
-	nmea_message_type_t message_type;	///< The message type
-} nmea_message_type_map_t;
+	const char *sentence;						///< The sentence the fields are in
+	uint8_t count;								///< Number of fields
+	uint8_t start[NMEA_MAX_FIELDS + 1U];		///< Offset of each field in sentence, start[count] is one past the end of the last one
+} nmea_fields_t;
 
 /********************************
 *** LOCAL FUNCTION PROTOTYPES ***
 ********************************/
 
-static uint8_t decode(const char *buffer, uint8_t port);
+static void decode(const char *message, uint8_t port);
+static void frame_received_data(receive_framer_t *framer, uint8_t port);
+static uint16_t find_sentence_start(const receive_framer_t *framer, uint16_t position);
+static uint16_t scan_sentence(receive_framer_t *framer, uint16_t position);
+static void end_sentence(receive_framer_t *framer, uint16_t end, uint8_t port);
+static void receive_port(receive_framer_t *framer, uint8_t port);
 static nmea_error_t encode(const transmit_message_info_t *transmit_message_info, char *output_buffer);
-static void adjust_messages_speed(uint8_t port, uint32_t permil_period_adjustment);
+static nmea_priority_t get_message_priority(nmea_message_type_t message_type);
+static void queue_put(output_queue_t *queue, uint16_t position, const void *data, uint16_t length);
+static void queue_get(const output_queue_t *queue, uint16_t position, void *data, uint16_t length);
+static void output_enqueue(uint8_t port, const char **sentences, uint8_t count, nmea_message_type_t message_type,
+		uint32_t time_ms);
+static nmea_error_t encode_data(nmea_encoder_function_t encoder, const void *message_data, char *message_buffer);
+static uint32_t output_write(uint8_t port, uint32_t time_ms);
 static const nmea_receive_message_details_t *get_receive_message_details(uint8_t port, nmea_message_type_t message_type);
 static const transmit_message_details_t *get_transmit_message_details(uint8_t port, nmea_message_type_t message_type);
-static transmit_message_info_t *get_transmit_message_info(uint16_t details_number);
-static const char *my_strtok(const char *s1, const char *delimit);
+static bool transmit_before(uint8_t slot_a, uint8_t slot_b);
+static void transmit_heap_up(transmit_heap_t *heap, uint8_t position);
+static void transmit_heap_down(transmit_heap_t *heap, uint8_t position);
+static void transmit_heap_remove(transmit_heap_t *heap, uint8_t slot);
+static void record_period(uint8_t port, transmit_message_info_t *transmit_message_info, uint32_t time_ms);
 static nmea_message_type_t get_message_type_from_header(const char *header);
-static uint8_t count_commas(const char *text);
-static const char *my_ftoa(float number, uint8_t precision, uint8_t padding);
-static const char *my_itoa(int32_t number);
+static bool append_fixed(char *message_data, size_t *length, size_t max_length, float number, uint8_t precision, uint8_t padding);
+static bool append_uint(char *message_data, size_t *length, size_t max_length, uint32_t number, uint8_t padding);
+static bool append_text(char *message_data, size_t *length, size_t max_length, const char *text);
+static bool append_char(char *message_data, size_t *length, size_t max_length, char c);
 static uint32_t my_xtoi(const char *hex_string);
 static uint8_t calc_checksum(const char *message);
 static const char *create_checksum(const char *message);
-static bool verify_checksum(const char *message);
 static nmea_error_t send_data(uint8_t port, uint16_t data_size, const uint8_t *data, uint16_t *data_sent);
 static uint16_t receive_data(uint8_t port, uint16_t buffer_length, uint8_t *data);
-static bool safe_strcat(char *dest, size_t size, const char *src);
-static bool check_received_message(const char *message_data, uint8_t min_commas, uint8_t max_commas);
+static bool tokenize(const char *message_data, uint8_t min_fields, uint8_t max_fields, nmea_fields_t *fields);
+static const char *field_text(const nmea_fields_t *fields, uint8_t index);
+static uint8_t field_length(const nmea_fields_t *fields, uint8_t index);
 static uint8_t nmea_count_set_bits(uint32_t n, uint8_t start_bit, uint8_t length);
 
 /**********************
@@ -97,25 +209,57 @@ static uint8_t nmea_count_set_bits(uint32_t n, uint8_t start_bit, uint8_t length
 **********************/
 
 /**
- * Array of pointers to receive message details structures which are owned by the application. 
+ * Table of pointers to receive message details structures which are owned by the application, indexed by port and
+ * message type.
  */
-static const nmea_receive_message_details_t *receive_message_details[NMEA_MAXIMUM_RECEIVE_MESSAGE_DETAILS];
+static const nmea_receive_message_details_t *receive_message_details[NMEA_NUMBER_OF_PORTS][nmea_message_max];
 
  /**
   * Array of structures holding information on transmit messages, including their details structure pointer. 
   */
 static transmit_message_info_t transmit_messages_infos[NMEA_MAXIMUM_TRANSMIT_MESSAGE_DETAILS];
 
+/**
+ * Array of heaps (1 per port) of periodic messages ordered by when they are next due
+ */
+static transmit_heap_t transmit_heaps[NMEA_NUMBER_OF_PORTS];
+
+/**
+ * Array of bitfields (1 per port) of transmit_messages_infos slots to be transmitted immediately, bit n is slot n. Set
+ * from other tasks by nmea_transmit_message_now so only changed with atomic operations.
+ */
+static uint32_t transmit_now_slots[NMEA_NUMBER_OF_PORTS];
+
+/**
+ * Array of periodic transmit counters (1 per port)
+ */
+static nmea_transmit_stats_t transmit_stats[NMEA_NUMBER_OF_PORTS];
+
+/**
+ * Array of output queues and rate limits (1 per port)
+ */
+static output_port_t output_ports[NMEA_NUMBER_OF_PORTS];
+
 /**
  * Array of buffers (1 per port) of overflowed data that could not be sent but to be sent on next send/receive cycle. 
  */
 static char message_data_to_send_buffer[NMEA_NUMBER_OF_PORTS][NMEA_MAX_MESSAGE_LENGTH + 1];
 
 /**
- * Array of buffers (1 per port) of unprocessed received data that could not be decoded because it contains 
- * only part of a message to be processed on next send/receive cycle. 
+ * Array of receive framers (1 per port) holding received data that has not yet been decoded
  */
-static char message_data_to_read_buffer[NMEA_NUMBER_OF_PORTS][NMEA_MAX_MESSAGE_LENGTH + 1];
+static receive_framer_t receive_framers[NMEA_NUMBER_OF_PORTS];
+
+/**
+ * Array of flags (1 per port) of ports where nothing is written, set from another task.
+ */
+static volatile bool port_transmit_muted[NMEA_NUMBER_OF_PORTS];
+
+/**
+ * Array of functions (1 per port) that received data is passed on to or NULL, only used in the task that calls
+ * nmea_process
+ */
+static nmea_receive_forward_function_t port_receive_forwards[NMEA_NUMBER_OF_PORTS];
 
 /***********************
 *** GLOBAL VARIABLES ***
@@ -125,14 +269,6 @@ static char message_data_to_read_buffer[NMEA_NUMBER_OF_PORTS][NMEA_MAX_MESSAGE_L
 *** CONSTANTS ***
 ****************/
 
-/** 
- * Map of nmea message headers to types - receive message types only
- */
-static const nmea_message_type_map_t nmea_message_type_map[] = {
-		{"GGA", nmea_message_GGA},
-		{"RMC", nmea_message_RMC},
-		{"VDM", nmea_message_VDM}};
-		
 /**********************
 *** LOCAL FUNCTIONS ***
 **********************/		
@@ -140,86 +276,320 @@ static const nmea_message_type_map_t nmea_message_type_map[] = {
 /**
  * Top level decoder function that later calls individual message type decoders
  *
- * @param buffer Buffer containing received messager to decode
- * @param port The port the message was receivbed on
- * @return The bytes taken from buffer
+ * @param message Complete received message with good checksum, terminated after its line end
+ * @param port The port the message was received on
  */
-static uint8_t decode(const char *buffer, uint8_t port)
+static void decode(const char *message, uint8_t port)
 {
-    uint8_t bytes_used = 0U;
-    uint8_t next_message_next_position = 0U;
-    char next_byte;
-    uint8_t next_byte_position = 0U;
-    bool in_message = false;
-    char next_message[NMEA_MAX_MESSAGE_LENGTH + 1];
     nmea_message_type_t message_type;
     nmea_receive_message_callback_t receive_message_callback;
     const nmea_receive_message_details_t *receive_message_details;
 
-    while (next_byte_position < NMEA_MAX_MESSAGE_LENGTH)
+    message_type = get_message_type_from_header(&message[3]);
+
+    receive_message_details = get_receive_message_details(port, message_type);
+    if (receive_message_details != NULL)
     {
-        next_byte = buffer[next_byte_position];
+    	receive_message_callback = receive_message_details->receive_message_callback;
 
-        if (next_byte == 0)
+        if (receive_message_callback)
         {
-            break;
+        	receive_message_callback(message);
+        }
+    }
+}
+
+/**
+ * Read all waiting data from a port and decode the complete sentences in it
+ *
+ * @param framer The port's framer
+ * @param port The port
+ */
+static void receive_port(receive_framer_t *framer, uint8_t port)
+{
+    uint16_t index;
+    uint16_t space;
+    uint16_t held;
+    uint16_t forward_space;
+    uint16_t bytes_read;
+    nmea_receive_forward_function_t forward;
+
+    do
+    {
+        // only the sentence being received is still needed, read up to it or the end of the ring, whichever is first
+        held = framer->in_sentence ? (uint16_t)(framer->received - framer->sentence_start) : 0U;
+        index = framer->received & NMEA_RECEIVE_BUFFER_MASK;
+        space = NMEA_RECEIVE_BUFFER_SIZE - index;
+        if (NMEA_RECEIVE_BUFFER_SIZE - held < space)
+        {
+            space = NMEA_RECEIVE_BUFFER_SIZE - held;
         }
 
-        if (!in_message)
+        forward = port_receive_forwards[port];
+        if (forward != NULL)
         {
-            if (next_byte == '$' || next_byte == '!' )
+            // data that is passed on is read no faster than it is taken
+            forward_space = forward(NULL, 0U);
+            if (forward_space < space)
             {
-                in_message = true;
-                next_message[0] = next_byte;
-                next_message_next_position = 1U;
+                space = forward_space;
             }
-            else
+            if (space == 0U)
             {
-                bytes_used++;
+                break;
             }
         }
-        else
+
+        bytes_read = receive_data(port, space, (uint8_t *)&framer->buffer.bytes[index]);
+        if (index < NMEA_RECEIVE_MIRROR_SIZE && bytes_read > 0U)
         {
-            next_message[next_message_next_position] = next_byte;
-            next_message_next_position++;
+            (void)memcpy(&framer->buffer.bytes[NMEA_RECEIVE_BUFFER_SIZE + index], &framer->buffer.bytes[index],
+                    (size_t)(bytes_read < NMEA_RECEIVE_MIRROR_SIZE - index ? bytes_read : NMEA_RECEIVE_MIRROR_SIZE - index));
+        }
+        if (forward != NULL && bytes_read > 0U)
+        {
+            (void)forward((const uint8_t *)&framer->buffer.bytes[index], bytes_read);
+            framer->forwarded = framer->received + bytes_read;
+        }
+        framer->received += bytes_read;
+        frame_received_data(framer, port);
+    } while (bytes_read == space);
+}
 
-            if (next_byte == '\n')
+/**
+ * Find sentences in the data received since last call and decode the complete ones
+ *
+ * @param framer The port's framer
+ * @param port The port
+ */
+static void frame_received_data(receive_framer_t *framer, uint8_t port)
+{
+    uint16_t position = framer->scanned;
+    uint16_t index;
+    uint16_t count;
+    char next_byte;
+
+    while (position != framer->received)
+    {
+        if (!framer->in_sentence)
+        {
+            position = find_sentence_start(framer, position);
+            if (position == framer->received)
             {
-                in_message = false;
-                next_message[next_message_next_position] = 0;
+                break;
+            }
+            framer->in_sentence = true;
+            framer->sentence_start = position;
+            framer->checksum_words = 0UL;
+            framer->checksum = 0U;
+            position++;
+            continue;
+        }
 
-                bytes_used += (uint8_t)strlen(next_message);
+        position = scan_sentence(framer, position);
+        if ((uint16_t)(position - framer->sentence_start) >= NMEA_MAX_MESSAGE_LENGTH)
+        {
+            // longer than allowed before its end was found, skip to next start
+            framer->stats.over_length++;
+            framer->in_sentence = false;
+            continue;
+        }
+        if (position == framer->received)
+        {
+            break;
+        }
 
-                if (strlen(next_message) >= (size_t)(NMEA_MIN_MESSAGE_LENGTH))
+        next_byte = framer->buffer.bytes[position & NMEA_RECEIVE_BUFFER_MASK];
+        if (next_byte == '\n')
+        {
+            if (port_receive_forwards[port] == NULL)
+            {
+                // nothing is passed on yet, if this sentence starts it the data after it has already been read
+                framer->forwarded = position + 1U;
+            }
+            end_sentence(framer, position, port);
+            framer->in_sentence = false;
+            while (port_receive_forwards[port] != NULL && framer->forwarded != framer->received)
+            {
+                index = framer->forwarded & NMEA_RECEIVE_BUFFER_MASK;
+                count = (uint16_t)(framer->received - framer->forwarded);
+                if (count > NMEA_RECEIVE_BUFFER_SIZE - index)
                 {
-                    if (verify_checksum(next_message))
-                    {
-                        message_type = get_message_type_from_header(&next_message[3]);
-
-                        receive_message_details = get_receive_message_details(port, message_type);
-                        if (receive_message_details != NULL)
-                        {
-                        	receive_message_callback = receive_message_details->receive_message_callback;
-
-                            if (receive_message_callback)
-                            {
-                            	receive_message_callback(next_message);
-                            }
-                        }
-                    }
+                    count = NMEA_RECEIVE_BUFFER_SIZE - index;
                 }
+                (void)port_receive_forwards[port]((const uint8_t *)&framer->buffer.bytes[index], count);
+                framer->forwarded += count;
             }
         }
+        else
+        {
+            // start of another sentence before the end of this one
+            framer->stats.malformed++;
+            framer->sentence_start = position;
+            framer->checksum_words = 0UL;
+            framer->checksum = 0U;
+        }
+        position++;
+    }
+
+    framer->scanned = position;
+}
 
-        next_byte_position++;
+/**
+ * Find the next $ or ! in received data, a word at a time once word aligned
+ *
+ * @param framer The port's framer
+ * @param position Count of the first byte to look at
+ * @return Count at the start character or count received if none
+ */
+static uint16_t find_sentence_start(const receive_framer_t *framer, uint16_t position)
+{
+    const char *bytes = framer->buffer.bytes;
+    uint32_t word;
+    char next_byte;
+
+    while (position != framer->received && (position & 3U) != 0U)
+    {
+        next_byte = bytes[position & NMEA_RECEIVE_BUFFER_MASK];
+        if (next_byte == '$' || next_byte == '!')
+        {
+            return position;
+        }
+        position++;
+    }
+
+    // words are aligned so never run over the end of the ring
+    while ((uint16_t)(framer->received - position) >= 4U)
+    {
+        word = framer->buffer.words[(position & NMEA_RECEIVE_BUFFER_MASK) / 4U];
+        if ((NMEA_WORD_HAS_BYTE(word, '$') | NMEA_WORD_HAS_BYTE(word, '!')) != 0UL)
+        {
+            break;
+        }
+        position += 4U;
+    }
+
+    while (position != framer->received && bytes[position & NMEA_RECEIVE_BUFFER_MASK] != '$' &&
+            bytes[position & NMEA_RECEIVE_BUFFER_MASK] != '!')
+    {
+        position++;
+    }
+
+    return position;
+}
+
+/**
+ * Scan received data of a sentence for its line end or the start of another sentence, adding the bytes before it to
+ * the checksum, a word at a time once word aligned
+ *
+ * @param framer The port's framer
+ * @param position Count of the first byte to scan
+ * @return Count at the line end or start character or count received if none
+ */
+static uint16_t scan_sentence(receive_framer_t *framer, uint16_t position)
+{
+    const char *bytes = framer->buffer.bytes;
+    uint32_t checksum_words = framer->checksum_words;
+    uint8_t checksum = framer->checksum;
+    uint32_t word;
+    char next_byte;
+
+    while (position != framer->received && (position & 3U) != 0U)
+    {
+        next_byte = bytes[position & NMEA_RECEIVE_BUFFER_MASK];
+        if (next_byte == '\n' || next_byte == '$' || next_byte == '!')
+        {
+            break;
+        }
+        checksum ^= (uint8_t)next_byte;
+        position++;
+    }
+
+    if ((position & 3U) == 0U)
+    {
+        while ((uint16_t)(framer->received - position) >= 4U)
+        {
+            word = framer->buffer.words[(position & NMEA_RECEIVE_BUFFER_MASK) / 4U];
+            if ((NMEA_WORD_HAS_BYTE(word, '\n') | NMEA_WORD_HAS_BYTE(word, '$') | NMEA_WORD_HAS_BYTE(word, '!')) != 0UL)
+            {
+                break;
+            }
+            checksum_words ^= word;
+            position += 4U;
+        }
+
+        while (position != framer->received)
+        {
+            next_byte = bytes[position & NMEA_RECEIVE_BUFFER_MASK];
+            if (next_byte == '\n' || next_byte == '$' || next_byte == '!')
+            {
+                break;
+            }
+            checksum ^= (uint8_t)next_byte;
+            position++;
+        }
+    }
+
+    framer->checksum_words = checksum_words;
+    framer->checksum = checksum;
+
+    return position;
+}
+
+/**
+ * Check a sentence whose line end has been found and pass it to its decoder. The checksum of all bytes after the
+ * start character is already known, so the bytes from the * on are taken back out of it.
+ *
+ * @param framer The port's framer
+ * @param end_count Count at the line end
+ * @param port The port
+ */
+static void end_sentence(receive_framer_t *framer, uint16_t end_count, uint8_t port)
+{
+    char *bytes = framer->buffer.bytes;
+    uint16_t start = framer->sentence_start & NMEA_RECEIVE_BUFFER_MASK;
+    uint16_t end = start + (uint16_t)(end_count - framer->sentence_start);	// past the ring end if it wraps, in the mirror
+    uint16_t asterisk;
+    uint16_t i;
+    uint8_t checksum;
+    char saved;
+
+    if ((uint16_t)(end + 1U - start) < NMEA_MIN_MESSAGE_LENGTH)
+    {
+        framer->stats.malformed++;
+        return;
     }
 
-    if (next_byte_position == NMEA_MAX_MESSAGE_LENGTH && bytes_used == 0U)
+    // checksum field is *hh followed by \r\n or \n
+    for (asterisk = end - 1U; asterisk > start && asterisk + 5U > end && bytes[asterisk] != '*'; asterisk--)
     {
-        bytes_used = NMEA_MAX_MESSAGE_LENGTH;
+    }
+    if (bytes[asterisk] != '*' || asterisk + 5U <= end)
+    {
+        framer->stats.malformed++;
+        return;
     }
 
-    return bytes_used;
+    checksum = framer->checksum ^ (uint8_t)(framer->checksum_words ^ (framer->checksum_words >> 8) ^
+            (framer->checksum_words >> 16) ^ (framer->checksum_words >> 24));
+    for (i = asterisk; i < end; i++)
+    {
+        checksum ^= (uint8_t)bytes[i];
+    }
+
+    // terminate the sentence where it lies for the decoders, the byte after it may be the start of the next one
+    saved = bytes[end + 1U];
+    bytes[end + 1U] = '\0';
+    if ((uint32_t)checksum == my_xtoi(&bytes[asterisk + 1U]))
+    {
+        framer->stats.sentences++;
+        decode(&bytes[start], port);
+    }
+    else
+    {
+        framer->stats.checksum_failed++;
+    }
+    bytes[end + 1U] = saved;
 }
 
 /**
@@ -233,7 +603,7 @@ static nmea_error_t encode(const transmit_message_info_t *transmit_message_info,
 {
     nmea_get_transmit_data_callback_t transmit_data_callback;
     nmea_encoder_function_t encoder;
-    void *message_data;
+    const void *message_data;
     nmea_error_t error = nmea_error_param;
 
     if (transmit_message_info != NULL && transmit_message_info->transmit_message_details != NULL)
@@ -263,22 +633,33 @@ static nmea_error_t encode(const transmit_message_info_t *transmit_message_info,
 }
 
 /**
- * Get an enumerated message type from the header string
+ * Get an enumerated message type from the header string, receive message types only. The talker is not looked at.
  *
- * @param header 3 letter string
- * @return The enumerated message type
+ * @param header 3 letter sentence formatter
+ * @return The enumerated message type or nmea_message_min if not a receive message type
  */
 static nmea_message_type_t get_message_type_from_header(const char *header)
 {
-	for (uint8_t i = 0U; i < NMEA_MESSAGE_MAP_ENTRIES; i++)
-	{
-		if (strncmp(header, nmea_message_type_map[i].message_header, (size_t)3) == 0)
-		{
-			return nmea_message_type_map[i].message_type;
-		}
-	}
+    switch (NMEA_FORMATTER(header[0], header[1], header[2]))
+    {
+    case NMEA_FORMATTER('G', 'G', 'A'):
+        return nmea_message_GGA;
+
+    case NMEA_FORMATTER('R', 'M', 'C'):
+        return nmea_message_RMC;
 
-    return nmea_message_min;
+    case NMEA_FORMATTER('V', 'D', 'M'):
+        return nmea_message_VDM;
+
+    case NMEA_FORMATTER('N', '2', 'K'):
+        return nmea_message_N2K;
+
+    case NMEA_FORMATTER('G', 'W', 'Y'):
+        return nmea_message_GWY;
+
+    default:
+        return nmea_message_min;
+    }
 }
 
 /**
@@ -330,246 +711,453 @@ static uint32_t my_xtoi(const char *hex_string)
 }
 
 /**
- * Test a NMEA0183 checksum on a message
+ * Calculate and create a text checksum for a message
  *
- * @param pMessage The whole message to test the checksum for
- * @return true if checksum is ok otherwise false
+ * @param pMessage The message to calculate the checksum for
+ * @return The checksum text
+ * @note Not thread safe
  */
-static bool verify_checksum(const char *message)
+static const char *create_checksum(const char *message)
 {
-    size_t length;
-    uint8_t calculated_checksum = 0U;
-    uint32_t read_checksum;
-    char *checksum_start;
-
-    length = strlen(message);
+    static char checksum_text[4];
 
-    if (length < (size_t)12)
-    {
-        return false;
-    }
+    (void)snprintf(checksum_text, sizeof(checksum_text), "*%02X", calc_checksum(message));
 
-    if ((checksum_start = strchr(message, '*')) == NULL)
-    {
-        return false;
-    }
+    return checksum_text;
+}
 
-    message++;
-    while (*message != '*')
-    {
-        calculated_checksum ^= *message++;
-    }
+/**
+ * Append a number with fixed decimals to a message being encoded
+ *
+ * @param message_data The message being encoded
+ * @param length Pointer to the length of the message, advanced by what is appended
+ * @param max_length Most characters the message may have, not counting the terminator
+ * @param number The number to append
+ * @param precision The number of decimal places
+ * @param padding Minimum digits before the decimal point, zero padded, 0 means no padding
+ * @return true if appended, false if it did not fit
+ */
+static bool append_fixed(char *message_data, size_t *length, size_t max_length, float number, uint8_t precision, uint8_t padding)
+{
+    size_t written = format_fixed(&message_data[*length], max_length + (size_t)1 - *length, number, precision, padding);
 
-    read_checksum = my_xtoi(checksum_start + 1);
+    *length += written;
 
-    return ((uint32_t)calculated_checksum == read_checksum);
+    return written > (size_t)0;
 }
 
 /**
- * Calculate and create a text checksum for a message
+ * Append an unsigned integer to a message being encoded
  *
- * @param pMessage The message to calculate the checksum for
- * @return The checksum text
- * @note Not thread safe
+ * @param message_data The message being encoded
+ * @param length Pointer to the length of the message, advanced by what is appended
+ * @param max_length Most characters the message may have, not counting the terminator
+ * @param number The number to append
+ * @param padding Minimum digits, zero padded, 0 means no padding
+ * @return true if appended, false if it did not fit
  */
-static const char *create_checksum(const char *message)
+static bool append_uint(char *message_data, size_t *length, size_t max_length, uint32_t number, uint8_t padding)
 {
-    static char checksum_text[4];
+    size_t written = format_uint(&message_data[*length], max_length + (size_t)1 - *length, number, padding);
 
-    (void)snprintf(checksum_text, sizeof(checksum_text), "*%02X", calc_checksum(message));
+    *length += written;
 
-    return checksum_text;
+    return written > (size_t)0;
 }
 
 /**
- * Counts the number of commas in the given string
+ * Count the number of set bits in a bitfield
  *
- * @param   pString  pointer to the start of the string to count its commas
- * @return  Count of commas
+ * @param n The bitfield
+ * @param start_bit The bit to start counting from
+ * @param length The length of the bitfield in n
+ * @return The count of set bits found
  */
-static uint8_t count_commas(const char *text)
+static uint8_t nmea_count_set_bits(uint32_t n, uint8_t start_bit, uint8_t length)
 {
-    uint8_t comma_count = 0U;
+    uint8_t count = 0U;
+    uint32_t mask;
+    uint8_t bit;
 
-    while (*text)
+    mask = 1UL;
+    for (bit = 0U; bit < start_bit + length; bit++)
     {
-        if (*text == ',')
+        if (bit >= start_bit && (n & mask) > 0UL)
         {
-        	comma_count++;
+        	count++;
         }
-        text++;
+        mask <<= 1;
     }
 
-    return comma_count;
+    return count;
 }
 
 /**
- * Convert a floating point number to a string with specified decimal places
+ * Find which of two transmit_messages_infos slots is due first, the lower slot first if due at the same time
  *
- * @param number The number to convert
- * @param precision The number of decimal places
- * @param padding Number of zeros to pre-pad with, 0 means no pre-padding
- * @return A pointer to a static string containing the result.
- * @note The internal buffer is 24 bytes long and number must fit in this
- * @note Not thread safe
+ * @param slot_a First slot
+ * @param slot_b Second slot
+ * @return true if slot_a is due before slot_b
  */
-static const char *my_ftoa(float number, uint8_t precision, uint8_t padding)
+static bool transmit_before(uint8_t slot_a, uint8_t slot_b)
 {
-    static char buffer[24];
-    char format[9];
+    int32_t difference = (int32_t)(transmit_messages_infos[slot_a].next_transmit_time - transmit_messages_infos[slot_b].next_transmit_time);
 
-    buffer[0] = 0;
+    return difference < 0 || (difference == 0 && slot_a < slot_b);
+}
 
-    if (precision > 12U || padding > 12U)
+/**
+ * Move a heap entry towards the top until it is not due before its parent
+ *
+ * @param heap The heap
+ * @param position Position in heap of the entry
+ */
+static void transmit_heap_up(transmit_heap_t *heap, uint8_t position)
+{
+    uint8_t slot = heap->slots[position];
+    uint8_t parent;
+
+    while (position > 0U)
     {
-        return buffer;
+        parent = (uint8_t)((position - 1U) / 2U);
+        if (!transmit_before(slot, heap->slots[parent]))
+        {
+            break;
+        }
+        heap->slots[position] = heap->slots[parent];
+        position = parent;
     }
+    heap->slots[position] = slot;
+}
 
-    if (padding > 0U)
+/**
+ * Move a heap entry towards the bottom until neither child is due before it
+ *
+ * @param heap The heap
+ * @param position Position in heap of the entry
+ */
+static void transmit_heap_down(transmit_heap_t *heap, uint8_t position)
+{
+    uint8_t slot = heap->slots[position];
+    uint8_t child;
+
+    while ((child = (uint8_t)(position * 2U + 1U)) < heap->count)
     {
-        if (precision > 0U)
+        if (child + 1U < heap->count && transmit_before(heap->slots[child + 1U], heap->slots[child]))
         {
-        	(void)snprintf(format, sizeof(format), "%%0%u.%uf", padding + precision + 1U, precision);
+            child++;
         }
-        else
+        if (!transmit_before(heap->slots[child], slot))
         {
-        	(void)snprintf(format, sizeof(format), "%%0%u.%uf", padding + precision, precision);
+            break;
         }
+        heap->slots[position] = heap->slots[child];
+        position = child;
     }
-    else
+    heap->slots[position] = slot;
+}
+
+/**
+ * Take a slot out of a heap if it is there
+ *
+ * @param heap The heap
+ * @param slot The transmit_messages_infos slot
+ */
+static void transmit_heap_remove(transmit_heap_t *heap, uint8_t slot)
+{
+    uint8_t position;
+
+    for (position = 0U; position < heap->count; position++)
     {
-        (void)snprintf(format, sizeof(format), "%%.%uf", precision);
+        if (heap->slots[position] == slot)
+        {
+            heap->count--;
+            if (position < heap->count)
+            {
+                // last entry takes its place and may need to go either way
+                heap->slots[position] = heap->slots[heap->count];
+                transmit_heap_up(heap, position);
+                transmit_heap_down(heap, position);
+            }
+            return;
+        }
     }
+}
 
-    (void)snprintf(buffer, sizeof(buffer), format, number);
-
-    return buffer;
+/**
+ * Count a periodic transmit in the histogram of how far the time since the message was last sent was from its period
+ *
+ * @param port The port the message was transmitted on
+ * @param transmit_message_info The message transmitted
+ * @param time_ms Time it was transmitted
+ */
+static void record_period(uint8_t port, transmit_message_info_t *transmit_message_info, uint32_t time_ms)
+{
+    uint32_t period_ms;
+    uint32_t error_ms;
+    uint8_t bucket = 0U;
+
+    transmit_stats[port].sent++;
+    if (transmit_message_info->transmitted)
+    {
+        period_ms = time_ms - transmit_message_info->last_transmit_time;
+        error_ms = period_ms > transmit_message_info->transmit_message_details->transmit_period_ms ?
+                period_ms - transmit_message_info->transmit_message_details->transmit_period_ms :
+                transmit_message_info->transmit_message_details->transmit_period_ms - period_ms;
+        for (; error_ms > 0UL && bucket < NMEA_PERIOD_ERROR_BUCKETS - 1U; error_ms >>= 1, bucket++);
+        transmit_stats[port].period_error[bucket]++;
+    }
+    transmit_message_info->last_transmit_time = time_ms;
+    transmit_message_info->transmitted = true;
 }
 
 /**
- * Convert an integer number to a string
+ * Get the priority class a sentence is queued in for sending
  *
- * @param number The number to convert
- * @return A pointer to a static string containing the result
- * @note The internal buffer is 12 bytes long and number must fit in this
- * @note Not thread safe
+ * @param message_type The message type of the sentence
+ * @return The priority class
  */
-static const char *my_itoa(int32_t number)
+static nmea_priority_t get_message_priority(nmea_message_type_t message_type)
 {
-    static char buffer[12];
+    switch (message_type)
+    {
+    case nmea_message_VDM:
+    case nmea_message_GGA:
+    case nmea_message_RMC:
+    case nmea_message_ALR:
+        return nmea_priority_high;
 
-    (void)snprintf(buffer, sizeof(buffer), "%d", (int)number);
+    case nmea_message_MDA:
+    case nmea_message_XDR:
+    case nmea_message_MTW:
+        return nmea_priority_low;
 
-    return buffer;
+    default:
+        return nmea_priority_normal;
+    }
 }
 
 /**
- * Private implementation of strtok as the C library version is not thread safe.
+ * Copy data into an output queue ring, wrapping at its end
  *
- * @param s1 The string to parse.
- * @param delimit Array of delimiter characters.
- * @return The next token or NULL.
- * @note This works the same as the C library strtok and is still not thread safe but will not clash with
- *       uses of strtok in other threads if there are any.
+ * @param queue The queue
+ * @param position Offset from the head of the queue to copy to
+ * @param data Data to copy
+ * @param length Bytes to copy
  */
-static const char *my_strtok(const char *s1, const char *delimit)
+static void queue_put(output_queue_t *queue, uint16_t position, const void *data, uint16_t length)
 {
-    static char *last_token = NULL;
-    char *tmp;
+    uint16_t index = (uint16_t)((queue->head + position) % NMEA_OUTPUT_QUEUE_SIZE);
+    uint16_t first = (uint16_t)(NMEA_OUTPUT_QUEUE_SIZE - index);
 
-    if (s1 == NULL)
+    if (first >= length)
     {
-        s1 = last_token;
-        if (s1 == NULL)
-        {
-            return NULL;
-        }
+        (void)memcpy(&queue->data[index], data, (size_t)length);
     }
     else
     {
-        s1 += strspn(s1, delimit);
+        (void)memcpy(&queue->data[index], data, (size_t)first);
+        (void)memcpy(queue->data, (const char *)data + first, (size_t)(length - first));
     }
+}
 
-    tmp = strpbrk(s1, delimit);
-    if (tmp)
+/**
+ * Copy data out of an output queue ring, wrapping at its end
+ *
+ * @param queue The queue
+ * @param position Offset from the head of the queue to copy from
+ * @param data Where to copy to
+ * @param length Bytes to copy
+ */
+static void queue_get(const output_queue_t *queue, uint16_t position, void *data, uint16_t length)
+{
+    uint16_t index = (uint16_t)((queue->head + position) % NMEA_OUTPUT_QUEUE_SIZE);
+    uint16_t first = (uint16_t)(NMEA_OUTPUT_QUEUE_SIZE - index);
+
+    if (first >= length)
     {
-        *tmp = 0;
-        last_token = tmp + 1;
+        (void)memcpy(data, &queue->data[index], (size_t)length);
     }
     else
     {
-    	last_token = NULL;
+        (void)memcpy(data, &queue->data[index], (size_t)first);
+        (void)memcpy((char *)data + first, queue->data, (size_t)(length - first));
     }
-
-    return s1;
 }
 
 /**
- * Count the number of set bits in a bitfield
+ * Queue a group of encoded sentences for writing to a port in the queue of its priority class, usually a group of one.
+ * Room is made for the whole group first. If the queue is full the oldest groups of the class are dropped whole, as
+ * the new ones have newer data. If the oldest is the rest of a group that has been partly written it cannot be cut
+ * short, so the new group is refused instead.
  *
- * @param n The bitfield
- * @param start_bit The bit to start counting from
- * @param length The length of the bitfield in n
- * @return The count of set bits found
+ * @param port The port
+ * @param sentences The sentences with checksum and line end
+ * @param count Number of sentences, not more than NMEA_MAX_GROUP_SENTENCES
+ * @param message_type The message type of the sentences
+ * @param time_ms Time now
  */
-static uint8_t nmea_count_set_bits(uint32_t n, uint8_t start_bit, uint8_t length)
+static void output_enqueue(uint8_t port, const char **sentences, uint8_t count, nmea_message_type_t message_type,
+		uint32_t time_ms)
 {
-    uint8_t count = 0U;
-    uint32_t mask;
-    uint8_t bit;
+    nmea_priority_t priority = get_message_priority(message_type);
+    output_queue_t *queue = &output_ports[port].queues[priority];
+    nmea_output_class_stats_t *stats = &output_ports[port].stats.classes[priority];
+    uint8_t lengths[NMEA_MAX_GROUP_SENTENCES];
+    uint32_t needed = 0UL;
+    uint8_t dropped_length;
+    uint8_t group;
+    uint8_t i;
 
-    mask = 1UL;
-    for (bit = 0U; bit < start_bit + length; bit++)
+    for (i = 0U; i < count; i++)
     {
-        if (bit >= start_bit && (n & mask) > 0UL)
+        lengths[i] = (uint8_t)strlen(sentences[i]);
+        needed += (uint32_t)lengths[i] + NMEA_OUTPUT_HEADER_SIZE;
+    }
+    if (needed > NMEA_OUTPUT_QUEUE_SIZE)
+    {
+        stats->dropped += count;
+        return;
+    }
+
+    while (NMEA_OUTPUT_QUEUE_SIZE - queue->used < needed)
+    {
+        queue_get(queue, NMEA_OUTPUT_GROUP_OFFSET, &group, 1U);
+        if ((group & NMEA_OUTPUT_GROUP_CONTINUED) != 0U)
         {
-        	count++;
+            stats->dropped += count;
+            return;
+        }
+
+        for (i = 0U; i <= (group & NMEA_OUTPUT_GROUP_FOLLOWING); i++)
+        {
+            queue_get(queue, 0U, &dropped_length, 1U);
+            queue->head = (uint16_t)((queue->head + dropped_length + NMEA_OUTPUT_HEADER_SIZE) % NMEA_OUTPUT_QUEUE_SIZE);
+            queue->used = (uint16_t)(queue->used - dropped_length - NMEA_OUTPUT_HEADER_SIZE);
+            stats->dropped++;
         }
-        mask <<= 1;
     }
 
-    return count;
+    for (i = 0U; i < count; i++)
+    {
+        group = (uint8_t)(count - 1U - i) | (i > 0U ? NMEA_OUTPUT_GROUP_CONTINUED : 0U);
+        queue_put(queue, queue->used, &lengths[i], 1U);
+        queue_put(queue, (uint16_t)(queue->used + 1U), &time_ms, (uint16_t)sizeof(time_ms));
+        queue_put(queue, (uint16_t)(queue->used + NMEA_OUTPUT_GROUP_OFFSET), &group, 1U);
+        queue_put(queue, (uint16_t)(queue->used + NMEA_OUTPUT_HEADER_SIZE), sentences[i], lengths[i]);
+        queue->used = (uint16_t)(queue->used + lengths[i] + NMEA_OUTPUT_HEADER_SIZE);
+        stats->queued++;
+    }
 }
 
 /**
- * Get a pointer to a transmit message info structure.
+ * Encode a message from the data given and add its checksum and line end
  *
- * @param details_number The slot to get the transmit info structure from.
- * @return Pointer to the structure of NULL if details_number is out of range.
+ * @param encoder Encoder of the message type
+ * @param message_data Data to encode, of the type the encoder takes
+ * @param message_buffer Buffer of NMEA_MAX_MESSAGE_LENGTH + 1 bytes to hold the sentence
+ * @return Error code from the encoder
  */
-static transmit_message_info_t *get_transmit_message_info(uint16_t details_number)
+static nmea_error_t encode_data(nmea_encoder_function_t encoder, const void *message_data, char *message_buffer)
 {
-    if (details_number < NMEA_MAXIMUM_TRANSMIT_MESSAGE_DETAILS)
+    nmea_error_t error;
+
+    error = encoder(message_buffer, message_data);
+    if (error == nmea_error_none)
     {
-        return &transmit_messages_infos[details_number];
+        (void)strcat(message_buffer, create_checksum(message_buffer + 1));
+        (void)strcat(message_buffer, "\r\n");
     }
 
-    return NULL;
+    return error;
 }
 
 /**
- * Adjust message transmit period in case of not enough bandwidth to sent all required messages or bring period back up if previously slowed down
+ * Write queued sentences to a port, highest priority class first, while the port's token bucket allows. A sentence
+ * the port does not take all of is finished from message_data_to_send_buffer on later calls.
  *
- * @param port The port the message is transmitted on
- * @param permil_period_adjustment Part per thousand adjustment : < 1000 speeds up, > 1000 slows down
+ * @param port The port
+ * @param time_ms Time now
+ * @return Time in ms until there are tokens for the next queued sentence, UINT32_MAX if nothing is waiting for tokens
  */
-static void adjust_messages_speed(uint8_t port, uint32_t permil_period_adjustment)
+static uint32_t output_write(uint8_t port, uint32_t time_ms)
 {
-    uint16_t i;
+    output_port_t *output_port = &output_ports[port];
+    output_queue_t *queue;
+    nmea_output_class_stats_t *stats;
+    char message_buffer[NMEA_MAX_MESSAGE_LENGTH + 1];
+    uint32_t capacity;
+    uint32_t elapsed_ms;
+    uint32_t queued_time;
+    uint32_t delay_ms;
+    uint32_t needed;
+    uint16_t data_sent;
+    uint8_t length;
+    uint8_t priority;
 
-    for (i = 0U; i < NMEA_MAXIMUM_TRANSMIT_MESSAGE_DETAILS; i++)
+    if (output_port->bytes_per_second > 0UL)
     {
-        if (transmit_messages_infos[i].transmit_message_details != NULL &&
-                transmit_messages_infos[i].transmit_message_details->port == port)
+        // a bucket holds a burst worth of tokens and always enough for the longest sentence
+        capacity = output_port->bytes_per_second * NMEA_OUTPUT_BURST_MS;
+        if (capacity < NMEA_MAX_MESSAGE_LENGTH * 1000UL)
+        {
+            capacity = NMEA_MAX_MESSAGE_LENGTH * 1000UL;
+        }
+        elapsed_ms = time_ms - output_port->refill_time;
+        output_port->refill_time = time_ms;
+        if (elapsed_ms > 1000UL)
         {
-            transmit_messages_infos[i].current_transmit_period_ms = (uint16_t)(((uint32_t)transmit_messages_infos[i].current_transmit_period_ms * permil_period_adjustment) / 1000UL);
+            elapsed_ms = 1000UL;
+        }
+        output_port->tokens += output_port->bytes_per_second * elapsed_ms;
+        if (output_port->tokens > capacity)
+        {
+            output_port->tokens = capacity;
+        }
+    }
+
+    while (message_data_to_send_buffer[port][0] == '\0')
+    {
+        for (priority = 0U; priority < (uint8_t)nmea_priority_max && output_port->queues[priority].used == 0U; priority++);
+        if (priority == (uint8_t)nmea_priority_max)
+        {
+            break;
+        }
+        queue = &output_port->queues[priority];
+        stats = &output_port->stats.classes[priority];
 
-            if (transmit_messages_infos[i].current_transmit_period_ms < transmit_messages_infos[i].transmit_message_details->transmit_period_ms)
+        queue_get(queue, 0U, &length, 1U);
+        if (output_port->bytes_per_second > 0UL)
+        {
+            needed = (uint32_t)length * 1000UL;
+            if (output_port->tokens < needed)
             {
-                transmit_messages_infos[i].current_transmit_period_ms = transmit_messages_infos[i].transmit_message_details->transmit_period_ms;
+                return (needed - output_port->tokens + output_port->bytes_per_second - 1UL) / output_port->bytes_per_second;
             }
+            output_port->tokens -= needed;
+        }
+
+        queue_get(queue, 1U, &queued_time, (uint16_t)sizeof(queued_time));
+        queue_get(queue, NMEA_OUTPUT_HEADER_SIZE, message_buffer, length);
+        message_buffer[length] = '\0';
+        queue->head = (uint16_t)((queue->head + length + NMEA_OUTPUT_HEADER_SIZE) % NMEA_OUTPUT_QUEUE_SIZE);
+        queue->used = (uint16_t)(queue->used - length - NMEA_OUTPUT_HEADER_SIZE);
+
+        delay_ms = time_ms - queued_time;
+        stats->sent++;
+        stats->delay_total_ms += delay_ms;
+        if (delay_ms > stats->delay_max_ms)
+        {
+            stats->delay_max_ms = delay_ms;
+        }
+
+        if (send_data(port, (uint16_t)length, (const uint8_t *)message_buffer, &data_sent) != nmea_error_none)
+        {
+            (void)strcpy(&message_data_to_send_buffer[port][0], message_buffer + data_sent);
         }
     }
+
+    return UINT32_MAX;
 }
 
 /**
@@ -581,21 +1169,12 @@ static void adjust_messages_speed(uint8_t port, uint32_t permil_period_adjustmen
  */
 static const nmea_receive_message_details_t *get_receive_message_details(uint8_t port, nmea_message_type_t message_type)
 {
-   uint16_t i;
-
-   for (i = 0U; i < NMEA_MAXIMUM_RECEIVE_MESSAGE_DETAILS; i++)
-   {
-       if (receive_message_details[i] != NULL)
-       {
-           if (receive_message_details[i]->port == port &&
-                   receive_message_details[i]->message_type == message_type)
-           {
-               return receive_message_details[i];
-           }
-       }
-   }
+    if (port >= NMEA_NUMBER_OF_PORTS || message_type <= nmea_message_min || message_type >= nmea_message_max)
+    {
+        return NULL;
+    }
 
-   return NULL;
+    return receive_message_details[port][message_type];
 }
 
 /**
@@ -625,34 +1204,78 @@ static const transmit_message_details_t *get_transmit_message_details(uint8_t po
 }
 
 /**
- * Check a received message for basic syntax correctness - size, comma count, length after first comma
+ * Find the fields of a received message in one pass and check its basic syntax - field count, address field length
+ * and line end. Nothing is written to the message so this can be used on the same message from several tasks at once.
  *
- * @param message_data The message to check
- * @param min_commas Minimum commas expected
- * @param max_commas Maximum commas expected
+ * @param message_data The message to tokenize
+ * @param min_fields Minimum fields expected including the address field
+ * @param max_fields Maximum fields expected including the address field, not more than NMEA_MAX_FIELDS
+ * @param fields Caller's structure to fill with where the fields are
  * @return If check is ok true else false
  */
-static bool check_received_message(const char *message_data, uint8_t min_commas, uint8_t max_commas)
+static bool tokenize(const char *message_data, uint8_t min_fields, uint8_t max_fields, nmea_fields_t *fields)
 {
-	size_t length = strlen(message_data);
-	uint8_t comma_count = count_commas(message_data);
-
-	if (length < (size_t)NMEA_MIN_MESSAGE_LENGTH || message_data[length - (size_t)2] != '\r')
-	{
-		return false;
-	}
+    uint16_t i;
+    uint8_t count = 0U;
+    char c = '\0';
 
-	if (comma_count < min_commas || comma_count > max_commas)
-	{
-		return false;
-	}
+    fields->sentence = message_data;
+    fields->start[0] = 0U;
+    for (i = 0U; i < NMEA_MAX_MESSAGE_LENGTH; i++)
+    {
+        c = message_data[i];
+        if (c == ',' || c == '*' || c == '\r' || c == '\0')
+        {
+            if (count == max_fields)
+            {
+                return false;
+            }
+            count++;
+            fields->start[count] = (uint8_t)(i + 1U);
+            if (c != ',')
+            {
+                break;
+            }
+        }
+    }
+    fields->count = count;
 
-    if (strlen(my_strtok(message_data, ",")) != (size_t)6)
+    if (i == NMEA_MAX_MESSAGE_LENGTH || count < min_fields || field_length(fields, 0U) != 6U)
     {
         return false;
     }
 
-	return true;
+    // last field is followed by an optional *hh checksum and the line end
+    if (c == '*' && isxdigit((unsigned char)message_data[i + 1U]) && isxdigit((unsigned char)message_data[i + 2U]))
+    {
+        i += 3U;
+    }
+
+    return message_data[i] == '\r' && message_data[i + 1U] != '\0';
+}
+
+/**
+ * Get the text of a field found by tokenize. It is not terminated after the field.
+ *
+ * @param fields Fields found by tokenize
+ * @param index Index of the field, 0 is the address field
+ * @return Pointer to the first character of the field
+ */
+static const char *field_text(const nmea_fields_t *fields, uint8_t index)
+{
+    return &fields->sentence[fields->start[index]];
+}
+
+/**
+ * Get the length of a field found by tokenize
+ *
+ * @param fields Fields found by tokenize
+ * @param index Index of the field, 0 is the address field
+ * @return Number of characters in the field, 0 if empty
+ */
+static uint8_t field_length(const nmea_fields_t *fields, uint8_t index)
+{
+    return (uint8_t)(fields->start[index + 1U] - fields->start[index] - 1U);
 }
 
 /**
@@ -666,6 +1289,12 @@ static bool check_received_message(const char *message_data, uint8_t min_commas,
  */
 static nmea_error_t send_data(uint8_t port, uint16_t data_size, const uint8_t *data, uint16_t *data_sent)
 {
+	if (port < NMEA_NUMBER_OF_PORTS && port_transmit_muted[port])
+	{
+		*data_sent = data_size;
+		return nmea_error_none;
+	}
+	
 	switch (port)
 	{
 	case 0U:
@@ -717,46 +1346,66 @@ static uint16_t receive_data(uint8_t port, uint16_t buffer_length, uint8_t *data
 }
 
 /**
- * Perform a safe equivalent of strcat
- * 
- * @param dest Buffer to hold the concatenated string
- * @param size Size in bytes of dest
- * @param src The source string to append to what already exists in dest
- * @return true if string concatenated successfully
+ * Append a string to a message being encoded
+ *
+ * @param message_data The message being encoded
+ * @param length Pointer to the length of the message, advanced by what is appended
+ * @param max_length Most characters the message may have, not counting the terminator
+ * @param text The string to append, may be empty
+ * @return true if appended, false if it did not fit
  */
-static bool safe_strcat(char *dest, size_t size, const char *src)
+static bool append_text(char *message_data, size_t *length, size_t max_length, const char *text)
 {
-    if (dest == NULL || src == NULL || (strlen(dest) + strlen(src) + (size_t)1 > size))
+    size_t written = format_text(&message_data[*length], max_length + (size_t)1 - *length, text);
+
+    *length += written;
+
+    return written > (size_t)0 || *text == '\0';
+}
+
+/**
+ * Append a single character to a message being encoded
+ *
+ * @param message_data The message being encoded
+ * @param length Pointer to the length of the message, advanced by what is appended
+ * @param max_length Most characters the message may have, not counting the terminator
+ * @param c The character to append
+ * @return true if appended, false if it did not fit
+ */
+static bool append_char(char *message_data, size_t *length, size_t max_length, char c)
+{
+    if (*length + (size_t)1 > max_length)
     {
-    	return false;
+        return false;
     }
 
-	(void)strcat(dest, src);
-	
-	return true;
+    message_data[*length] = c;
+    (*length)++;
+    message_data[*length] = '\0';
+
+    return true;
 }
 
 /***********************
 *** GLOBAL FUNCTIONS ***
 ***********************/
 
-void nmea_process(void)
+uint32_t nmea_process(void)
 {
     volatile uint32_t time_ms;
-    uint16_t i;
     uint8_t port;
+    uint8_t slot;
+    uint32_t now_slots;
     char message_buffer[NMEA_MAX_MESSAGE_LENGTH + 1];
+    const char *sentence = message_buffer;
     uint16_t data_sent;
     nmea_error_t send_error;
-    uint8_t bytes_to_read;
-    uint16_t bytes_read;
-    uint8_t unread_length;
-    uint8_t bytes_used;
     uint16_t bytes_to_move;
-    uint32_t oldest_message_time;
-    uint16_t message_needs_transmitting;
+    uint32_t deadline;
+    uint32_t wait_ms;
+    uint32_t next_transmit_delay_ms = UINT32_MAX;
+    transmit_heap_t *heap;
     transmit_message_info_t *transmit_details_info;
-    transmit_message_info_t *oldest_message_details_info;
     uint16_t message_length;
 
     for (port = 0U; port < NMEA_NUMBER_OF_PORTS; port++)
@@ -787,119 +1436,118 @@ void nmea_process(void)
 
     for (port = 0U; port < NMEA_NUMBER_OF_PORTS; port++)
     {
-        send_error = nmea_error_none;
+        heap = &transmit_heaps[port];
 
-        if (strlen(&message_data_to_send_buffer[port][0]) > (size_t)0)
+        // messages to transmit immediately, lowest slot first
+        while ((now_slots = __atomic_load_n(&transmit_now_slots[port], __ATOMIC_ACQUIRE)) != 0UL)
         {
-            continue;
-        }
+            for (slot = 0U; (now_slots & (1UL << slot)) == 0UL; slot++);
+            (void)__atomic_fetch_and(&transmit_now_slots[port], ~(1UL << slot), __ATOMIC_ACQ_REL);
+            transmit_details_info = &transmit_messages_infos[slot];
 
-        for (i = 0U; i < NMEA_MAXIMUM_TRANSMIT_MESSAGE_DETAILS; i++)
-        {
-        	transmit_details_info = get_transmit_message_info(i);
-
-            if (transmit_details_info != NULL &&
-            		transmit_details_info->transmit_message_details != NULL &&
-					transmit_details_info->transmit_now &&
-					transmit_details_info->transmit_message_details->port == port)
+            if (encode(transmit_details_info, message_buffer) == nmea_error_none)
             {
-            	transmit_details_info->transmit_now = false;
-
-                if (encode(transmit_details_info, message_buffer) == nmea_error_none)
-                {
-                    send_error = send_data(port, (uint16_t)strlen(message_buffer), (uint8_t*)message_buffer, &data_sent);
-                    if (send_error != nmea_error_none)
-                    {
-                       	(void)strcpy(&message_data_to_send_buffer[port][0], message_buffer + data_sent);
-                        break;
-                    }
-                }
+                output_enqueue(port, &sentence, 1U, transmit_details_info->transmit_message_details->message_type, time_ms);
             }
         }
 
-        if (send_error != nmea_error_none)
+        // every periodic message that is due, most overdue first
+        while (heap->count > 0U && NMEA_TIME_REACHED(time_ms, transmit_messages_infos[heap->slots[0]].next_transmit_time))
         {
-            continue;
-        }
+            transmit_details_info = &transmit_messages_infos[heap->slots[0]];
+            deadline = transmit_details_info->next_transmit_time;
 
-        do
-        {
-            oldest_message_time = UINT32_MAX;
-            message_needs_transmitting = false;
-
-            for (i = 0U; i < NMEA_MAXIMUM_TRANSMIT_MESSAGE_DETAILS; i++)
+            if (encode(transmit_details_info, message_buffer) == nmea_error_none)
             {
-            	transmit_details_info = get_transmit_message_info(i);
-
-                if (transmit_details_info != NULL &&
-                		transmit_details_info->transmit_message_details != NULL &&
-						transmit_details_info->transmit_message_details->transmit_period_ms > 0UL &&
-						transmit_details_info->transmit_message_details->port == port &&
-						time_ms >= transmit_details_info->next_transmit_time)
-                {
-                    if (transmit_details_info->next_transmit_time < oldest_message_time)
-                    {
-                    	oldest_message_details_info = transmit_details_info;
-                        oldest_message_time = transmit_details_info->next_transmit_time;
-                        message_needs_transmitting = true;
-                    }
-                }
+                output_enqueue(port, &sentence, 1U, transmit_details_info->transmit_message_details->message_type, time_ms);
+                record_period(port, transmit_details_info, time_ms);
             }
 
-            if (message_needs_transmitting)
+            // next one is a period after this one was due so that late sends do not add up, unless a whole period has been missed
+            transmit_details_info->next_transmit_time = deadline + transmit_details_info->transmit_message_details->transmit_period_ms;
+            if (NMEA_TIME_REACHED(time_ms, transmit_details_info->next_transmit_time))
             {
-                if (encode(oldest_message_details_info, message_buffer) == nmea_error_none)
-                {
-                    send_error = send_data(port, (uint16_t)strlen(message_buffer), (uint8_t*)message_buffer, &data_sent);
-                    oldest_message_details_info->next_transmit_time = time_ms + oldest_message_details_info->current_transmit_period_ms;
-
-                    if (send_error != nmea_error_none)
-                    {
-                        if (send_error == nmea_error_overflow)
-                        {
-                        	(void)strcpy(&message_data_to_send_buffer[port][0], message_buffer + data_sent);
-                        	adjust_messages_speed(port, NMEA_SLOW_DOWN_MESSAGE_PERMIL_PERIOD_ADJUSTMENT);
-                        }
-                        break;
-                    }
-                }
-                else
-                {
-                	oldest_message_details_info->next_transmit_time = time_ms + oldest_message_details_info->current_transmit_period_ms;
-                }
-
+                transmit_details_info->next_transmit_time = time_ms + transmit_details_info->transmit_message_details->transmit_period_ms;
+                transmit_stats[port].resynchronised++;
             }
-        } while (message_needs_transmitting && send_error == nmea_error_none);
+            transmit_heap_down(heap, 0U);
+        }
 
-        if (send_error != nmea_error_none)
+        // a port that could not take all it was given waits for the next call, otherwise the next call is when the
+        // next message is due or there are tokens for a queued one
+        wait_ms = output_write(port, time_ms);
+        if (wait_ms < next_transmit_delay_ms)
+        {
+            next_transmit_delay_ms = wait_ms;
+        }
+        if (heap->count > 0U && transmit_messages_infos[heap->slots[0]].next_transmit_time - time_ms < next_transmit_delay_ms)
         {
-            continue;
+            next_transmit_delay_ms = transmit_messages_infos[heap->slots[0]].next_transmit_time - time_ms;
         }
-
-        adjust_messages_speed(port, NMEA_SPEED_UP_MESSAGE_PERMIL_PERIOD_ADJUSTMENT);
     }
 
     for (port = 0U; port < NMEA_NUMBER_OF_PORTS; port++)
     {
-        do
-        {
-            unread_length = (uint8_t)strlen(&message_data_to_read_buffer[port][0]);
-            bytes_to_read = NMEA_MAX_MESSAGE_LENGTH - unread_length;
-            bytes_read = receive_data(port, bytes_to_read, (uint8_t*)&message_data_to_read_buffer[port][unread_length]);
-			if (bytes_read > 0U)
-			{
-				message_data_to_read_buffer[port][unread_length + bytes_read] = 0;
-				bytes_used = decode(&message_data_to_read_buffer[port][0], port);
-
-				if (bytes_used > 0U)
-				{
-					(void)memmove(&message_data_to_read_buffer[port][0],
-							&message_data_to_read_buffer[port][bytes_used],
-							(size_t)((NMEA_MAX_MESSAGE_LENGTH + 1) - bytes_used));
-				}
-			}
-        } while (bytes_to_read == bytes_read);
+        receive_port(&receive_framers[port], port);
     }
+
+    return next_transmit_delay_ms;
+}
+
+void nmea_get_receive_stats(uint8_t port, nmea_receive_stats_t *stats)
+{
+	if (port < NMEA_NUMBER_OF_PORTS)
+	{
+		*stats = receive_framers[port].stats;
+	}
+}
+
+void nmea_get_transmit_stats(uint8_t port, nmea_transmit_stats_t *stats)
+{
+	if (port < NMEA_NUMBER_OF_PORTS)
+	{
+		*stats = transmit_stats[port];
+	}
+}
+
+void nmea_set_port_rate(uint8_t port, uint32_t bytes_per_second)
+{
+	if (port < NMEA_NUMBER_OF_PORTS)
+	{
+		output_ports[port].bytes_per_second = bytes_per_second;
+		output_ports[port].tokens = 0UL;
+		output_ports[port].refill_time = timer_get_time_ms() - NMEA_OUTPUT_BURST_MS;
+	}
+}
+
+void nmea_get_output_stats(uint8_t port, nmea_output_stats_t *stats)
+{
+	uint8_t priority;
+
+	if (port < NMEA_NUMBER_OF_PORTS)
+	{
+		*stats = output_ports[port].stats;
+		for (priority = 0U; priority < (uint8_t)nmea_priority_max; priority++)
+		{
+			stats->queued_bytes[priority] = output_ports[port].queues[priority].used;
+		}
+	}
+}
+
+void nmea_set_port_transmit_muted(uint8_t port, bool muted)
+{
+	if (port < NMEA_NUMBER_OF_PORTS)
+	{
+		port_transmit_muted[port] = muted;
+	}
+}
+
+void nmea_set_port_receive_forward(uint8_t port, nmea_receive_forward_function_t forward)
+{
+	if (port < NMEA_NUMBER_OF_PORTS)
+	{
+		port_receive_forwards[port] = forward;
+	}
 }
 
 void nmea_disable_transmit_message(uint8_t port, nmea_message_type_t message_type)
@@ -912,6 +1560,8 @@ void nmea_disable_transmit_message(uint8_t port, nmea_message_type_t message_typ
                 transmit_messages_infos[i].transmit_message_details->port == port &&
                 transmit_messages_infos[i].transmit_message_details->message_type == message_type)
         {
+            transmit_heap_remove(&transmit_heaps[port], (uint8_t)i);
+            (void)__atomic_fetch_and(&transmit_now_slots[port], ~(1UL << i), __ATOMIC_ACQ_REL);
             transmit_messages_infos[i].transmit_message_details = NULL;
             return;
         }
@@ -921,6 +1571,7 @@ void nmea_disable_transmit_message(uint8_t port, nmea_message_type_t message_typ
 void nmea_enable_transmit_message(const transmit_message_details_t *nmea_transmit_message_details)
 {
     uint16_t i;
+    transmit_heap_t *heap;
 
     for (i = 0U; i < NMEA_MAXIMUM_TRANSMIT_MESSAGE_DETAILS; i++)
     {
@@ -932,7 +1583,8 @@ void nmea_enable_transmit_message(const transmit_message_details_t *nmea_transmi
         }
     }
 
-    if (nmea_transmit_message_details->message_type >= nmea_message_max)
+    if (nmea_transmit_message_details->message_type >= nmea_message_max ||
+            nmea_transmit_message_details->port >= NMEA_NUMBER_OF_PORTS)
     {
         return;
     }
@@ -952,42 +1604,33 @@ void nmea_enable_transmit_message(const transmit_message_details_t *nmea_transmi
 
     transmit_messages_infos[i].transmit_message_details = nmea_transmit_message_details;
     transmit_messages_infos[i].next_transmit_time = timer_get_time_ms() + nmea_transmit_message_details->transmit_period_ms;
-    transmit_messages_infos[i].current_transmit_period_ms = nmea_transmit_message_details->transmit_period_ms;
+    transmit_messages_infos[i].transmitted = false;
+
+    if (nmea_transmit_message_details->transmit_period_ms > 0UL)
+    {
+        heap = &transmit_heaps[nmea_transmit_message_details->port];
+        heap->slots[heap->count] = (uint8_t)i;
+        heap->count++;
+        transmit_heap_up(heap, (uint8_t)(heap->count - 1U));
+    }
 }
 
 void nmea_enable_receive_message(const nmea_receive_message_details_t *nmea_receive_message_details)
 {
-    uint16_t i;
-
-    if (nmea_receive_message_details->message_type >= nmea_message_max)
+    if (nmea_receive_message_details->port >= NMEA_NUMBER_OF_PORTS ||
+            nmea_receive_message_details->message_type <= nmea_message_min ||
+            nmea_receive_message_details->message_type >= nmea_message_max)
     {
         return;
     }
 
-    for (i = 0U; i < NMEA_MAXIMUM_RECEIVE_MESSAGE_DETAILS; i++)
-    {
-        if (receive_message_details[i] != NULL &&
-                receive_message_details[i]->port == nmea_receive_message_details->port &&
-                receive_message_details[i]->message_type == nmea_receive_message_details->message_type)
-        {
-            return;
-        }
-    }
-
-    for (i = 0U; i < NMEA_MAXIMUM_RECEIVE_MESSAGE_DETAILS; i++)
-    {
-        if (receive_message_details[i] == NULL)
-        {
-            break;
-        }
-    }
-
-    if (i == NMEA_MAXIMUM_RECEIVE_MESSAGE_DETAILS)
+    if (receive_message_details[nmea_receive_message_details->port][nmea_receive_message_details->message_type] != NULL)
     {
         return;
     }
 
-    receive_message_details[i] = nmea_receive_message_details;
+    receive_message_details[nmea_receive_message_details->port][nmea_receive_message_details->message_type] =
+            nmea_receive_message_details;
 }
 
 void nmea_transmit_message_now(uint8_t port, nmea_message_type_t message_type)
@@ -1005,16 +1648,66 @@ void nmea_transmit_message_now(uint8_t port, nmea_message_type_t message_type)
     {
         if (transmit_messages_infos[i].transmit_message_details == transmit_message_details)
         {
-            transmit_messages_infos[i].transmit_now = true;
+            (void)__atomic_fetch_or(&transmit_now_slots[port], 1UL << i, __ATOMIC_ACQ_REL);
             break;
         }
     }
 }
 
+nmea_error_t nmea_transmit_message_data(uint8_t port, nmea_message_type_t message_type, nmea_encoder_function_t encoder,
+		const void *message_data)
+{
+    char message_buffer[NMEA_MAX_MESSAGE_LENGTH + 1];
+    const char *sentence = message_buffer;
+    nmea_error_t error;
+
+    if (port >= NMEA_NUMBER_OF_PORTS || encoder == NULL || message_data == NULL)
+    {
+        return nmea_error_param;
+    }
+
+    error = encode_data(encoder, message_data, message_buffer);
+    if (error == nmea_error_none)
+    {
+        output_enqueue(port, &sentence, 1U, message_type, timer_get_time_ms());
+    }
+
+    return error;
+}
+
+nmea_error_t nmea_transmit_message_group(uint8_t port, nmea_message_type_t message_type, nmea_encoder_function_t encoder,
+		const void *message_data, size_t message_data_size, uint8_t count)
+{
+    char message_buffers[NMEA_MAX_GROUP_SENTENCES][NMEA_MAX_MESSAGE_LENGTH + 1];
+    const char *sentences[NMEA_MAX_GROUP_SENTENCES];
+    nmea_error_t error;
+    uint8_t i;
+
+    if (port >= NMEA_NUMBER_OF_PORTS || encoder == NULL || message_data == NULL || count == 0U ||
+    		count > NMEA_MAX_GROUP_SENTENCES)
+    {
+        return nmea_error_param;
+    }
+
+    // all are encoded before any is queued so a group is sent whole or not at all
+    for (i = 0U; i < count; i++)
+    {
+        error = encode_data(encoder, (const uint8_t *)message_data + (size_t)i * message_data_size, message_buffers[i]);
+        if (error != nmea_error_none)
+        {
+            return error;
+        }
+        sentences[i] = message_buffers[i];
+    }
+    output_enqueue(port, sentences, count, message_type, timer_get_time_ms());
+
+    return nmea_error_none;
+}
+
 nmea_error_t nmea_encode_DPT(char *message_data, const void *source)
 {
     uint8_t max_message_length;
-    const char *next_field_data;
+    size_t length;
     const nmea_message_data_DPT_t *source_DPT;
 
     if (message_data == NULL || source == NULL)
@@ -1026,38 +1719,35 @@ nmea_error_t nmea_encode_DPT(char *message_data, const void *source)
 
     max_message_length = NMEA_MAX_MESSAGE_LENGTH - 5U;
 
-    (void)strcpy(message_data, "$IIDPT,");
+    length = format_text(message_data, (size_t)max_message_length + (size_t)1, "$IIDPT,");
 
     if (source_DPT->data_available & NMEA_DPT_DEPTH_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_DPT->depth), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_DPT->depth), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_DPT->data_available & NMEA_DPT_DEPTH_OFFSET_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_DPT->depth_offset), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_DPT->depth_offset), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
 	if (source_DPT->data_available & NMEA_DPT_DEPTH_MAX_RANGE_PRESENT)
 	{
-		next_field_data = my_ftoa((float)(source_DPT->depth_maximum_range), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+		if (!append_fixed(message_data, &length, max_message_length, (float)(source_DPT->depth_maximum_range), 1U, 0U))
         {
         	return nmea_error_message;
         }
@@ -1069,7 +1759,7 @@ nmea_error_t nmea_encode_DPT(char *message_data, const void *source)
 nmea_error_t nmea_encode_HDM(char *message_data, const void *source)
 {
     uint8_t max_message_length;
-    const char *next_field_data;
+    size_t length;
     const nmea_message_data_HDM_t *source_HDM;
 
     if (message_data == NULL || source == NULL)
@@ -1081,17 +1771,16 @@ nmea_error_t nmea_encode_HDM(char *message_data, const void *source)
 
     max_message_length = NMEA_MAX_MESSAGE_LENGTH - 5U;
 
-    (void)strcpy(message_data, "$IIHDM,");
+    length = format_text(message_data, (size_t)max_message_length + (size_t)1, "$IIHDM,");
 
     if (source_HDM->data_available & NMEA_HDM_MAG_HEADING_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_HDM->magnetic_heading), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_HDM->magnetic_heading), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",M"))
+    if (!append_text(message_data, &length, max_message_length, ",M"))
     {
     	return nmea_error_message;
     }
@@ -1102,7 +1791,7 @@ nmea_error_t nmea_encode_HDM(char *message_data, const void *source)
 nmea_error_t nmea_encode_HDT(char *message_data, const void *source)
 {
     uint8_t max_message_length;
-    const char *next_field_data;
+    size_t length;
     const nmea_message_data_HDT_t *source_HDT;
 
     if (message_data == NULL || source == NULL)
@@ -1114,17 +1803,16 @@ nmea_error_t nmea_encode_HDT(char *message_data, const void *source)
 
     max_message_length = NMEA_MAX_MESSAGE_LENGTH - 5U;
 
-    (void)strcpy(message_data, "$IIHDT,");
+    length = format_text(message_data, (size_t)max_message_length + (size_t)1, "$IIHDT,");
 
     if (source_HDT->data_available & NMEA_HDT_TRUE_HEADING_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_HDT->true_heading), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_HDT->true_heading), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",T"))
+    if (!append_text(message_data, &length, max_message_length, ",T"))
     {
     	return nmea_error_message;
     }
@@ -1135,7 +1823,7 @@ nmea_error_t nmea_encode_HDT(char *message_data, const void *source)
 nmea_error_t nmea_encode_MTW(char *message_data, const void *source)
 {
     uint8_t max_message_length;
-    const char *next_field_data;
+    size_t length;
     const nmea_message_data_MTW_t *source_MTW;
 
     if (message_data == NULL || source == NULL)
@@ -1147,17 +1835,16 @@ nmea_error_t nmea_encode_MTW(char *message_data, const void *source)
 
     max_message_length = NMEA_MAX_MESSAGE_LENGTH - 5U;
 
-    (void)strcpy(message_data, "$IIMTW,");
+    length = format_text(message_data, (size_t)max_message_length + (size_t)1, "$IIMTW,");
 
     if (source_MTW->data_available & NMEA_MTW_WATER_TEMPERATURE_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_MTW->water_temperature), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_MTW->water_temperature), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",C"))
+    if (!append_text(message_data, &length, max_message_length, ",C"))
     {
     	return nmea_error_message;
     }
@@ -1169,7 +1856,6 @@ nmea_error_t nmea_encode_XDR(char *message_data, const void *source)
 {
     uint8_t max_message_length;
     uint8_t tuple;
-    const char *next_field_data;
     const nmea_message_data_XDR_t *source_XDR;
     size_t length;
     uint8_t measurements_count;
@@ -1192,7 +1878,7 @@ nmea_error_t nmea_encode_XDR(char *message_data, const void *source)
 
     max_message_length = NMEA_MAX_MESSAGE_LENGTH - 5U;
 
-    (void)strcpy(message_data, "$IIXDR");
+    length = format_text(message_data, (size_t)max_message_length + (size_t)1, "$IIXDR");
 
     measurements_mask = 0x00000001UL;
     for (tuple = 0U; tuple < NMEA_XDR_MAX_MEASUREMENTS_COUNT; tuple++)
@@ -1204,36 +1890,15 @@ nmea_error_t nmea_encode_XDR(char *message_data, const void *source)
         }
         measurements_mask <<= 1;
 
-        length = strlen(message_data);
-        if (length + (size_t)3 > max_message_length)
-        {
-            return nmea_error_message;
-        }
-        (void)strcat(message_data, ",");
-        message_data[length + 1] = source_XDR->measurements[tuple].transducer_type;
-        message_data[length + 2] = '\0';
-        (void)strcat(message_data, ",");
-
-        next_field_data = my_ftoa((float)(source_XDR->measurements[tuple].measurement), source_XDR->measurements[tuple].decimal_places, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
-        {
-        	return nmea_error_message;
-        }
-        if (!safe_strcat(message_data, max_message_length, ","))
-        {
-        	return nmea_error_message;
-        }
-
-        length = strlen(message_data);
-        if (length + (size_t)2 > max_message_length)
-        {
-            return nmea_error_message;
-        }
-        message_data[length] = source_XDR->measurements[tuple].units;
-        message_data[length + (size_t)1] = '\0';
-        (void)strcat(message_data, ",");
-
-        if (!safe_strcat(message_data, max_message_length, source_XDR->measurements[tuple].transducer_id))
+        if (!append_char(message_data, &length, max_message_length, ',') ||
+                !append_char(message_data, &length, max_message_length, source_XDR->measurements[tuple].transducer_type) ||
+                !append_char(message_data, &length, max_message_length, ',') ||
+                !append_fixed(message_data, &length, max_message_length, (float)(source_XDR->measurements[tuple].measurement),
+                        source_XDR->measurements[tuple].decimal_places, 0U) ||
+                !append_char(message_data, &length, max_message_length, ',') ||
+                !append_char(message_data, &length, max_message_length, source_XDR->measurements[tuple].units) ||
+                !append_char(message_data, &length, max_message_length, ',') ||
+                !append_text(message_data, &length, max_message_length, source_XDR->measurements[tuple].transducer_id))
         {
         	return nmea_error_message;
         }
@@ -1245,7 +1910,7 @@ nmea_error_t nmea_encode_XDR(char *message_data, const void *source)
 nmea_error_t nmea_encode_VLW(char *message_data, const void *source)
 {
     uint8_t max_message_length;
-    const char *next_field_data;
+    size_t length;
     const nmea_message_data_VLW_t *source_VLW;
 
     if (message_data == NULL || source == NULL)
@@ -1257,56 +1922,52 @@ nmea_error_t nmea_encode_VLW(char *message_data, const void *source)
 
     max_message_length = NMEA_MAX_MESSAGE_LENGTH - 5U;
 
-    (void)strcpy(message_data, "$IIVLW,");
+    length = format_text(message_data, (size_t)max_message_length + (size_t)1, "$IIVLW,");
 
     if (source_VLW->data_available & NMEA_VLW_TOTAL_WATER_DISTANCE_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_VLW->total_water_distance), 2U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_VLW->total_water_distance), 2U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",N,"))
+    if (!append_text(message_data, &length, max_message_length, ",N,"))
     {
     	return nmea_error_message;
     }
 
     if (source_VLW->data_available & NMEA_VLW_TRIP_WATER_DISTANCE_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_VLW->trip_water_distance), 2U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_VLW->trip_water_distance), 2U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",N,"))
+    if (!append_text(message_data, &length, max_message_length, ",N,"))
     {
     	return nmea_error_message;
     }
 
 	if (source_VLW->data_available & NMEA_VLW_TOTAL_GROUND_DISTANCE_PRESENT)
 	{
-		next_field_data = my_ftoa((float)(source_VLW->total_ground_distance), 2U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+		if (!append_fixed(message_data, &length, max_message_length, (float)(source_VLW->total_ground_distance), 2U, 0U))
         {
         	return nmea_error_message;
         }
 	}
-    if (!safe_strcat(message_data, max_message_length, ",N,"))
+    if (!append_text(message_data, &length, max_message_length, ",N,"))
     {
     	return nmea_error_message;
     }
 
 	if (source_VLW->data_available & NMEA_VLW_TRIP_GROUND_DISTANCE_PRESENT)
 	{
-		next_field_data = my_ftoa((float)(source_VLW->trip_ground_distance), 2U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+		if (!append_fixed(message_data, &length, max_message_length, (float)(source_VLW->trip_ground_distance), 2U, 0U))
         {
         	return nmea_error_message;
         }
 	}
-    if (!safe_strcat(message_data, max_message_length, ",N"))
+    if (!append_text(message_data, &length, max_message_length, ",N"))
     {
     	return nmea_error_message;
     }
@@ -1317,7 +1978,7 @@ nmea_error_t nmea_encode_VLW(char *message_data, const void *source)
 nmea_error_t nmea_encode_VHW(char *message_data,  const void *source)
 {
     uint8_t max_message_length;
-    const char *next_field_data;
+    size_t length;
     const nmea_message_data_VHW_t *source_VHW;
 
     if (message_data == NULL || source == NULL)
@@ -1329,56 +1990,52 @@ nmea_error_t nmea_encode_VHW(char *message_data,  const void *source)
 
     max_message_length = NMEA_MAX_MESSAGE_LENGTH - 5U;
 
-    (void)strcpy(message_data, "$IIVHW,");
+    length = format_text(message_data, (size_t)max_message_length + (size_t)1, "$IIVHW,");
 
     if (source_VHW->data_available & NMEA_VHW_HEADING_TRUE_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_VHW->heading_true), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_VHW->heading_true), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",T,"))
+    if (!append_text(message_data, &length, max_message_length, ",T,"))
     {
     	return nmea_error_message;
     }
 
     if (source_VHW->data_available & NMEA_VHW_HEADING_MAG_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_VHW->heading_magnetic), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_VHW->heading_magnetic), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",M,"))
+    if (!append_text(message_data, &length, max_message_length, ",M,"))
     {
     	return nmea_error_message;
     }
 
     if (source_VHW->data_available & NMEA_VHW_WATER_SPEED_KTS_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_VHW->water_speed_knots), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_VHW->water_speed_knots), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",N,"))
+    if (!append_text(message_data, &length, max_message_length, ",N,"))
     {
     	return nmea_error_message;
     }
 
     if (source_VHW->data_available & NMEA_VHW_WATER_SPEED_KMPH_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_VHW->water_speed_kmph), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_VHW->water_speed_kmph), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",K"))
+    if (!append_text(message_data, &length, max_message_length, ",K"))
     {
     	return nmea_error_message;
     }
@@ -1389,7 +2046,7 @@ nmea_error_t nmea_encode_VHW(char *message_data,  const void *source)
 nmea_error_t nmea_encode_MWD(char *message_data, const void *source)
 {
     uint8_t  max_message_length;
-    const char *next_field_data;
+    size_t length;
     const nmea_message_data_MWD_t *source_MWD;
 
     if (message_data == NULL || source == NULL)
@@ -1401,56 +2058,52 @@ nmea_error_t nmea_encode_MWD(char *message_data, const void *source)
 
     max_message_length = NMEA_MAX_MESSAGE_LENGTH - 5U;
 
-    (void)strcpy(message_data, "$IIMWD,");
+    length = format_text(message_data, (size_t)max_message_length + (size_t)1, "$IIMWD,");
 
     if (source_MWD->data_available & NMEA_MWD_WIND_DIRECTION_TRUE_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_MWD->wind_direction_true), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_MWD->wind_direction_true), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",T,"))
+    if (!append_text(message_data, &length, max_message_length, ",T,"))
     {
     	return nmea_error_message;
     }
 
     if (source_MWD->data_available & NMEA_MWD_WIND_DIRECTION_MAG_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_MWD->wind_direction_magnetic), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_MWD->wind_direction_magnetic), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",M,"))
+    if (!append_text(message_data, &length, max_message_length, ",M,"))
     {
     	return nmea_error_message;
     }
 
     if (source_MWD->data_available & NMEA_MWD_WIND_SPEED_KTS_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_MWD->wind_speed_knots), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_MWD->wind_speed_knots), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",N,"))
+    if (!append_text(message_data, &length, max_message_length, ",N,"))
     {
     	return nmea_error_message;
     }
 
     if (source_MWD->data_available & NMEA_MWD_WIND_SPEED_MPS_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_MWD->wind_speed_mps), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_MWD->wind_speed_mps), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",M"))
+    if (!append_text(message_data, &length, max_message_length, ",M"))
     {
     	return nmea_error_message;
     }
@@ -1461,7 +2114,6 @@ nmea_error_t nmea_encode_MWD(char *message_data, const void *source)
 nmea_error_t nmea_encode_MWV(char *message_data, const void *source)
 {
     uint8_t max_message_length;
-    const char *next_field_data;
     size_t length;
     const nmea_message_data_MWV_t *source_MWV;
 
@@ -1474,73 +2126,62 @@ nmea_error_t nmea_encode_MWV(char *message_data, const void *source)
 
     max_message_length = NMEA_MAX_MESSAGE_LENGTH - 5U;
 
-    (void)strcpy(message_data, "$IIMWV,");
+    length = format_text(message_data, (size_t)max_message_length + (size_t)1, "$IIMWV,");
 
     if (source_MWV->data_available & NMEA_MWV_WIND_ANGLE_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_MWV->wind_angle), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_MWV->wind_angle), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_MWV->data_available & NMEA_MWV_REFERENCE_PRESENT)
     {
-        length = strlen(message_data);
-        if (length + (size_t)1 > (size_t)max_message_length)
+        if (!append_char(message_data, &length, max_message_length, source_MWV->reference))
         {
-            return nmea_error_message;
+        	return nmea_error_message;
         }
-        message_data[length] = source_MWV->reference;
-        message_data[length + (size_t)1] = 0;
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_MWV->data_available & NMEA_MWV_WIND_SPEED_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_MWV->wind_speed), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_MWV->wind_speed), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_MWV->data_available & NMEA_MWV_WIND_SPEED_UNITS_PRESENT)
     {
-        length = strlen(message_data);
-        if (length + (size_t)1 > (size_t)max_message_length)
+        if (!append_char(message_data, &length, max_message_length, source_MWV->wind_speed_units))
         {
-            return nmea_error_message;
+        	return nmea_error_message;
         }
-        message_data[length] = source_MWV->wind_speed_units;
-        message_data[length + (size_t)1] = 0;
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_MWV->data_available & NMEA_MWV_STATUS_PRESENT)
     {
-        length = strlen(message_data);
-        if (length + (size_t)1 > (size_t)max_message_length)
+        if (!append_char(message_data, &length, max_message_length, source_MWV->status))
         {
-            return nmea_error_message;
+        	return nmea_error_message;
         }
-        message_data[length] = source_MWV->status;
-        message_data[length + (size_t)1] = 0;
     }
 
     return nmea_error_none;
@@ -1553,53 +2194,50 @@ nmea_error_t nmea_decode_VDM(const char *message_data, nmea_message_data_VDM_t *
 	!AIVDM,2,2,3,B,1@0000000000000,2*55
 	 */
 
-    const char *next_token;
+    nmea_fields_t fields;
+    uint8_t length;
     uint32_t data_available = 0UL;
 
-    if (!check_received_message(message_data, 6U, 6U))
+    if (!tokenize(message_data, 7U, 7U, &fields))
     {
     	return nmea_error_message;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 1U) > 0U)
     {
-    	result->fragment_count = (uint8_t)atoi(next_token);
+    	result->fragment_count = (uint8_t)atoi(field_text(&fields, 1U));
     	data_available |= NMEA_VDM_FRAGMENT_COUNT_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 2U) > 0U)
     {
-    	result->fragment_number = (uint8_t)atoi(next_token);
+    	result->fragment_number = (uint8_t)atoi(field_text(&fields, 2U));
     	data_available |= NMEA_VDM_FRAGMENT_NUMBER_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 3U) > 0U)
     {
-    	result->message_identifier = (uint8_t)atoi(next_token);
+    	result->message_identifier = (uint8_t)atoi(field_text(&fields, 3U));
     	data_available |= NMEA_VDM_MESSAGE_IDENTIFIER_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 4U) > 0U)
     {
-    	result->channel_code = *next_token;
+    	result->channel_code = *field_text(&fields, 4U);
     	data_available |= NMEA_VDM_CHANNEL_CODE_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0 && strlen(next_token) <= (size_t)NMEA_VDM_MAX_AIS_DATA_FIELD_LENGTH)
+    length = field_length(&fields, 5U);
+    if (length > 0U && length <= NMEA_VDM_MAX_AIS_DATA_FIELD_LENGTH)
     {
-    	(void)strcpy(result->data, next_token);
+    	(void)memcpy(result->data, field_text(&fields, 5U), (size_t)length);
+    	result->data[length] = '\0';
     	data_available |= NMEA_VDM_DATA_PRESENT;
     }
 
-    next_token = my_strtok(NULL, "*/r");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 6U) > 0U)
     {
-    	result->fill_bits = (uint8_t)atoi(next_token);
+    	result->fill_bits = (uint8_t)atoi(field_text(&fields, 6U));
     	data_available |= NMEA_VDM_FILL_BITS_PRESENT;
     }
 
@@ -1611,7 +2249,6 @@ nmea_error_t nmea_decode_VDM(const char *message_data, nmea_message_data_VDM_t *
 nmea_error_t nmea_encode_VDM(char *message_data, const void *source)
 {
     uint8_t max_message_length;
-    const char *next_field_data;
     const nmea_message_data_VDM_t *source_VDM;
     size_t length;
 
@@ -1624,160 +2261,141 @@ nmea_error_t nmea_encode_VDM(char *message_data, const void *source)
 
     max_message_length = NMEA_MAX_MESSAGE_LENGTH - 5U;
 
-    (void)strcpy(message_data, "!AIVDM,");
+    length = format_text(message_data, (size_t)max_message_length + (size_t)1, "!AIVDM,");
 
     if (source_VDM->data_available & NMEA_VDM_FRAGMENT_COUNT_PRESENT)
     {
-        next_field_data = my_itoa((int32_t)(source_VDM->fragment_count));
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_uint(message_data, &length, max_message_length, (uint32_t)(source_VDM->fragment_count), 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_VDM->data_available & NMEA_VDM_FRAGMENT_NUMBER_PRESENT)
     {
-        next_field_data = my_itoa((int32_t)(source_VDM->fragment_number));
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_uint(message_data, &length, max_message_length, (uint32_t)(source_VDM->fragment_number), 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_VDM->data_available & NMEA_VDM_MESSAGE_IDENTIFIER_PRESENT)
     {
-        next_field_data = my_itoa((int32_t)(source_VDM->message_identifier));
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_uint(message_data, &length, max_message_length, (uint32_t)(source_VDM->message_identifier), 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_VDM->data_available & NMEA_VDM_CHANNEL_CODE_PRESENT)
     {
-        length = strlen(message_data);
-        if (length + (size_t)1 > (size_t)max_message_length)
+        if (!append_char(message_data, &length, max_message_length, source_VDM->channel_code))
         {
-            return nmea_error_message;
+        	return nmea_error_message;
         }
-        message_data[length] = source_VDM->channel_code;
-        message_data[length + (size_t)1] = 0;
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_VDM->data_available & NMEA_VDM_DATA_PRESENT)
     {
-        if (!safe_strcat(message_data, max_message_length, source_VDM->data))
+        if (!append_text(message_data, &length, max_message_length, source_VDM->data))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_VDM->data_available & NMEA_VDM_FILL_BITS_PRESENT)
     {
-        next_field_data = my_itoa((int32_t)(source_VDM->fill_bits));
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_uint(message_data, &length, max_message_length, (uint32_t)(source_VDM->fill_bits), 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (strlen(message_data) + (size_t)1 > (size_t)max_message_length)
-    {
-        return nmea_error_message;
-    }
-
     return nmea_error_none;
 }
 
 nmea_error_t nmea_decode_RMC(const char *message_data, nmea_message_data_RMC_t *result)
 {
+    nmea_fields_t fields;
     const char *next_token;
-    uint8_t comma_count = count_commas(message_data);
     uint32_t data_available = 0UL;
 
-    if (!check_received_message(message_data, 11U, 13U))
+    if (!tokenize(message_data, 12U, 14U, &fields))
     {
     	return nmea_error_message;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 1U) > 0U)
     {
+        next_token = field_text(&fields, 1U);
         result->utc.hours = (uint8_t)((float)atof(next_token) / 10000.0f);
         result->utc.minutes = (uint8_t)(((float)atof(next_token) - (float)(result->utc.hours * 10000.0f)) / 100.0f);
         result->utc.seconds = (float)atof(next_token) - (float)(result->utc.hours * 10000.0f) - (float)(result->utc.minutes * 100.0f);
         data_available |= NMEA_RMC_UTC_PRESENT;
     }
 
-    next_token=my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 2U) > 0U)
     {
-        result->status = *next_token;
+        result->status = *field_text(&fields, 2U);
         data_available |= NMEA_RMC_STATUS_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 3U) > 0U)
     {
-        result->latitude = atof(next_token);
+        result->latitude = atof(field_text(&fields, 3U));
         data_available |= NMEA_RMC_LATITUDE_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (*next_token == 'S')
+    if (*field_text(&fields, 4U) == 'S')
     {
         result->latitude = -result->latitude;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 5U) > 0U)
     {
-        result->longitude = atof(next_token);
+        result->longitude = atof(field_text(&fields, 5U));
         data_available |= NMEA_RMC_LONGITUDE_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (*next_token == 'W')
+    if (*field_text(&fields, 6U) == 'W')
     {
         result->longitude = -result->longitude;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 7U) > 0U)
     {
-        result->SOG = (float)atof(next_token);
+        result->SOG = (float)atof(field_text(&fields, 7U));
         data_available |= NMEA_RMC_SOG_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 8U) > 0U)
     {
-        result->COG = (float)atof(next_token);
+        result->COG = (float)atof(field_text(&fields, 8U));
         data_available |= NMEA_RMC_COG_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 9U) > 0U)
     {
+        next_token = field_text(&fields, 9U);
         result->date.date = (uint8_t)(atoi(next_token) / 10000);
         result->date.month = (uint8_t)((atoi(next_token) - (uint32_t)(result->date.date) * 10000UL) / 100UL);
         result->date.year = (uint16_t)(atoi(next_token) - (uint32_t)(result->date.date) * 10000UL - (uint32_t)(result->date.month) * 100UL);
@@ -1785,38 +2403,29 @@ nmea_error_t nmea_decode_RMC(const char *message_data, nmea_message_data_RMC_t *
         data_available |= NMEA_RMC_DATE_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 10U) > 0U)
     {
-        result->magnetic_variation = (float)atof(next_token);
+        result->magnetic_variation = (float)atof(field_text(&fields, 10U));
         data_available |= NMEA_RMC_MAG_VARIATION_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",*\r");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 11U) > 0U)
     {
-        result->magnetic_variation_direction = *next_token;
+        result->magnetic_variation_direction = *field_text(&fields, 11U);
         data_available |= NMEA_RMC_MAG_DIRECTION_PRESENT;
     }
 
-    if (comma_count >= 12U)
+    // mode and navigation status were added in later versions of the standard
+    if (fields.count >= 13U && field_length(&fields, 12U) > 0U)
     {
-        next_token = my_strtok(NULL, ",*\r");
-        if (strlen(next_token) > 0U)
-        {
-            result->mode = *next_token;
-            data_available |= NMEA_RMC_MODE_PRESENT;
-        }
+        result->mode = *field_text(&fields, 12U);
+        data_available |= NMEA_RMC_MODE_PRESENT;
+    }
 
-        if (comma_count == 13U)
-        {
-            next_token = my_strtok(NULL, "*\r");
-            if (strlen(next_token) > (size_t)0)
-            {
-                result->navigation_status = *next_token;
-                data_available |= NMEA_RMC_NAV_STATUS_PRESENT;
-            }
-        }
+    if (fields.count == 14U && field_length(&fields, 13U) > 0U)
+    {
+        result->navigation_status = *field_text(&fields, 13U);
+        data_available |= NMEA_RMC_NAV_STATUS_PRESENT;
     }
 
     result->data_available = data_available;
@@ -1827,11 +2436,8 @@ nmea_error_t nmea_decode_RMC(const char *message_data, nmea_message_data_RMC_t *
 nmea_error_t nmea_encode_RMC(char *message_data, const void *source)
 {
     uint8_t max_message_length;
-    const char *next_field_data;
     size_t length;
     const nmea_message_data_RMC_t *source_RMC;
-    char utc_buffer[12];
-    char date_buffer[8];
 
     if (message_data == NULL || source == NULL)
     {
@@ -1842,132 +2448,105 @@ nmea_error_t nmea_encode_RMC(char *message_data, const void *source)
 
     max_message_length = NMEA_MAX_MESSAGE_LENGTH - 5U;
 
-    (void)strcpy(message_data, "$GPRMC,");
+    length = format_text(message_data, (size_t)max_message_length + (size_t)1, "$GPRMC,");
 
     if (source_RMC->data_available & NMEA_RMC_UTC_PRESENT)
     {
         if (source_RMC->utc.hours < 24U && source_RMC->utc.minutes < 60U && source_RMC->utc.seconds < 60.0f)
         {
-            (void)snprintf(utc_buffer, sizeof(utc_buffer), "%02u%02u%04.1f",
-                    (unsigned int)(source_RMC->utc.hours),
-                    (unsigned int)(source_RMC->utc.minutes),
-					source_RMC->utc.seconds);
-            if (!safe_strcat(message_data, max_message_length, utc_buffer))
+            if (!append_uint(message_data, &length, max_message_length, (uint32_t)(source_RMC->utc.hours), 2U) ||
+                    !append_uint(message_data, &length, max_message_length, (uint32_t)(source_RMC->utc.minutes), 2U) ||
+                    !append_fixed(message_data, &length, max_message_length, source_RMC->utc.seconds, 1U, 2U))
             {
             	return nmea_error_message;
             }
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_RMC->data_available & NMEA_RMC_STATUS_PRESENT)
     {
-        length = strlen(message_data);
-        if (length + (size_t)1 > (size_t)max_message_length)
+        if (!append_char(message_data, &length, max_message_length, source_RMC->status))
         {
-            return nmea_error_message;
+        	return nmea_error_message;
         }
-        message_data[length] = source_RMC->status;
-        message_data[length + (size_t)1] = 0;
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_RMC->data_available & NMEA_RMC_LATITUDE_PRESENT)
     {
-        next_field_data = my_ftoa(fabsf(source_RMC->latitude), 3U, 4U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, fabsf(source_RMC->latitude), 3U, 4U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_RMC->data_available & NMEA_RMC_LATITUDE_PRESENT)
     {
-        if (strlen(message_data) + (size_t)1 > (size_t)max_message_length)
-        {
-            return nmea_error_message;
-        }
-
-        if (source_RMC->latitude < 0.0f)
-        {
-        	(void)strcat(message_data, "S");
-        }
-        else
+        if (!append_char(message_data, &length, max_message_length, source_RMC->latitude < 0.0f ? 'S' : 'N'))
         {
-        	(void)strcat(message_data, "N");
+        	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_RMC->data_available & NMEA_RMC_LONGITUDE_PRESENT)
     {
-        next_field_data = my_ftoa(fabsf(source_RMC->longitude), 3U, 5U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, fabsf(source_RMC->longitude), 3U, 5U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_RMC->data_available & NMEA_RMC_LONGITUDE_PRESENT)
     {
-        if (strlen(message_data) + (size_t)1 > (size_t)max_message_length)
-        {
-            return nmea_error_message;
-        }
-
-        if (source_RMC->longitude < 0.0f)
-        {
-            strcat(message_data, "W");
-        }
-        else
+        if (!append_char(message_data, &length, max_message_length, source_RMC->longitude < 0.0f ? 'W' : 'E'))
         {
-            strcat(message_data, "E");
+        	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_RMC->data_available & NMEA_RMC_SOG_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_RMC->SOG), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_RMC->SOG), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_RMC->data_available & NMEA_RMC_COG_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_RMC->COG), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_RMC->COG), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
@@ -1976,74 +2555,61 @@ nmea_error_t nmea_encode_RMC(char *message_data, const void *source)
     {
         if (source_RMC->date.date < 32U && source_RMC->date.month < 13U && source_RMC->date.year > 2000U && source_RMC->date.year < 2100U)
         {
-            (void)snprintf(date_buffer, sizeof(date_buffer), "%02u%02u%02u",
-                    (unsigned int)(source_RMC->date.date),
-                    (unsigned int)(source_RMC->date.month),
-                    (unsigned int)(source_RMC->date.year - 2000U));
-
-            if (!safe_strcat(message_data, max_message_length, date_buffer))
+            if (!append_uint(message_data, &length, max_message_length, (uint32_t)(source_RMC->date.date), 2U) ||
+                    !append_uint(message_data, &length, max_message_length, (uint32_t)(source_RMC->date.month), 2U) ||
+                    !append_uint(message_data, &length, max_message_length, (uint32_t)(source_RMC->date.year - 2000U), 2U))
             {
             	return nmea_error_message;
             }
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_RMC->data_available & NMEA_RMC_MAG_VARIATION_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_RMC->magnetic_variation), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_RMC->magnetic_variation), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_RMC->data_available & NMEA_RMC_MAG_DIRECTION_PRESENT)
     {
-        length = strlen(message_data);
-        if (length + (size_t)1 > (size_t)max_message_length)
+        if (!append_char(message_data, &length, max_message_length, source_RMC->magnetic_variation_direction))
         {
-            return nmea_error_message;
+        	return nmea_error_message;
         }
-        message_data[length] = source_RMC->magnetic_variation_direction;
-        message_data[length + (size_t)1] = 0;
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
 	if (source_RMC->data_available & NMEA_RMC_MODE_PRESENT)
 	{
-		length = strlen(message_data);
-		if (length + (size_t)1 > (size_t)max_message_length)
+		if (!append_char(message_data, &length, max_message_length, source_RMC->mode))
 		{
 			return nmea_error_message;
 		}
-		message_data[length] = source_RMC->mode;
-		message_data[length + (size_t)1] = 0;
 	}
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
 	if (source_RMC->data_available & NMEA_RMC_NAV_STATUS_PRESENT)
 	{
-		length = strlen(message_data);
-		if (length + (size_t)1 > (size_t)max_message_length)
+		if (!append_char(message_data, &length, max_message_length, source_RMC->navigation_status))
 		{
 			return nmea_error_message;
 		}
-		message_data[length] = source_RMC->navigation_status;
-		message_data[length + (size_t)1] = '\0';
 	}
 
     return nmea_error_none;
@@ -2051,99 +2617,89 @@ nmea_error_t nmea_encode_RMC(char *message_data, const void *source)
 
 nmea_error_t nmea_decode_GGA(const char *message_data, nmea_message_data_GGA_t *result)
 {
+    nmea_fields_t fields;
     const char *next_token;
     uint32_t data_available = 0UL;
 
-    if (!check_received_message(message_data, 14U, 14U))
+    if (!tokenize(message_data, 15U, 15U, &fields))
     {
     	return nmea_error_message;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 1U) > 0U)
     {
+        next_token = field_text(&fields, 1U);
         result->utc.hours = (uint8_t)((float)atof(next_token) / 10000.0f);
         result->utc.minutes = (uint8_t)(((float)atof(next_token) - (float)(result->utc.hours * 10000.0f)) / 100.0f);
         result->utc.seconds = (float)atof(next_token) - (float)(result->utc.hours * 10000.0f) - (float)(result->utc.minutes * 100.0f);
         data_available |= NMEA_GGA_UTC_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 2U) > 0U)
     {
-        result->latitude = atof(next_token);
+        result->latitude = atof(field_text(&fields, 2U));
         data_available |= NMEA_GGA_LATITUDE_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (*next_token == 'S')
+    if (*field_text(&fields, 3U) == 'S')
     {
         result->latitude = -result->latitude;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 4U) > 0U)
     {
-        result->longitude = atof(next_token);
+        result->longitude = atof(field_text(&fields, 4U));
         data_available |= NMEA_GGA_LONGITUDE_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (*next_token == 'W')
+    if (*field_text(&fields, 5U) == 'W')
     {
         result->longitude = -result->longitude;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 6U) > 0U)
     {
-        result->quality_indicator = (uint8_t)(atoi(next_token));
+        result->quality_indicator = (uint8_t)(atoi(field_text(&fields, 6U)));
         data_available |= NMEA_GGA_QUALITY_INDICATOR_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 7U) > 0U)
     {
-        result->satellites_in_use = (uint8_t)(atoi(next_token));
+        result->satellites_in_use = (uint8_t)(atoi(field_text(&fields, 7U)));
         data_available |= NMEA_GGA_SATELLITES_IN_USE_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 8U) > 0U)
     {
-        result->HDOP = (float)atof(next_token);
+        result->HDOP = (float)atof(field_text(&fields, 8U));
         data_available |= NMEA_GGA_HDOP_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 9U) > 0U)
     {
-        result->altitude = (float)atof(next_token);
+        result->altitude = (float)atof(field_text(&fields, 9U));
         data_available |= NMEA_GGA_ALTITUDE_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",");
+    // field 10 is altitude units, always M
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 11U) > 0U)
     {
-        result->geoidal_separation = (float)atof(next_token);
+        result->geoidal_separation = (float)atof(field_text(&fields, 11U));
         data_available |= NMEA_GGA_GEIODAL_SEPARATION_PRESENT;
     }
 
-    next_token = my_strtok(NULL, ",");
+    // field 12 is geoidal separation units, always M
 
-    next_token = my_strtok(NULL, ",");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 13U) > 0U)
     {
-        result->dgpsAge = (float)atof(next_token);
+        result->dgpsAge = (float)atof(field_text(&fields, 13U));
         data_available |= NMEA_GGA_DGPS_AGE_PRESENT;
     }
 
-    next_token = my_strtok(NULL, "*\r");
-    if (strlen(next_token) > (size_t)0)
+    if (field_length(&fields, 14U) > 0U)
     {
-        result->dgps_station_id = (uint8_t)(atoi(next_token));
+        result->dgps_station_id = (uint8_t)(atoi(field_text(&fields, 14U)));
         data_available |= NMEA_GGA_DGPS_STATION_ID_PRESENT;
     }
 
@@ -2155,10 +2711,8 @@ nmea_error_t nmea_decode_GGA(const char *message_data, nmea_message_data_GGA_t *
 nmea_error_t nmea_encode_GGA(char *message_data, const void *source)
 {
     uint8_t max_message_length;
-    const char *next_field_data;
+    size_t length;
     const nmea_message_data_GGA_t *source_GGA;
-    char utc_buffer[12];
-    char number_buffer[6];
 
     if (message_data == NULL || source == NULL)
     {
@@ -2169,91 +2723,69 @@ nmea_error_t nmea_encode_GGA(char *message_data, const void *source)
 
     max_message_length = NMEA_MAX_MESSAGE_LENGTH - 5U;
 
-    (void)strcpy(message_data, "$GPGGA,");
+    length = format_text(message_data, (size_t)max_message_length + (size_t)1, "$GPGGA,");
 
     if (source_GGA->data_available & NMEA_GGA_UTC_PRESENT)
     {
         if (source_GGA->utc.hours < 24U && source_GGA->utc.minutes < 60U && source_GGA->utc.seconds < 60.0f)
         {
-            (void)snprintf(utc_buffer, sizeof(utc_buffer), "%02u%02u%04.1f",
-                    (unsigned int)(source_GGA->utc.hours),
-                    (unsigned int)(source_GGA->utc.minutes),
-					source_GGA->utc.seconds);
-            if (!safe_strcat(message_data, max_message_length, utc_buffer))
+            if (!append_uint(message_data, &length, max_message_length, (uint32_t)(source_GGA->utc.hours), 2U) ||
+                    !append_uint(message_data, &length, max_message_length, (uint32_t)(source_GGA->utc.minutes), 2U) ||
+                    !append_fixed(message_data, &length, max_message_length, source_GGA->utc.seconds, 1U, 2U))
             {
             	return nmea_error_message;
             }
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_GGA->data_available & NMEA_GGA_LATITUDE_PRESENT)
     {
-        next_field_data = my_ftoa(fabsf(source_GGA->latitude), 3U, 4U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, fabsf(source_GGA->latitude), 3U, 4U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_GGA->data_available & NMEA_GGA_LATITUDE_PRESENT)
     {
-        if (strlen(message_data) + (size_t)1 > (size_t)max_message_length)
-        {
-            return nmea_error_message;
-        }
-
-        if (source_GGA->latitude < 0.0f)
+        if (!append_char(message_data, &length, max_message_length, source_GGA->latitude < 0.0f ? 'S' : 'N'))
         {
-        	(void)strcat(message_data, "S");
-        }
-        else
-        {
-        	(void)strcat(message_data, "N");
+        	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_GGA->data_available & NMEA_GGA_LONGITUDE_PRESENT)
     {
-        next_field_data = my_ftoa(fabsf(source_GGA->longitude),3U ,5U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, fabsf(source_GGA->longitude),3U ,5U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_GGA->data_available & NMEA_GGA_LONGITUDE_PRESENT)
     {
-        if (strlen(message_data) + (size_t)1 > (size_t)max_message_length)
-        {
-            return nmea_error_message;
-        }
-
-        if (source_GGA->longitude < 0.0f)
-        {
-        	(void)strcat(message_data, "W");
-        }
-        else
+        if (!append_char(message_data, &length, max_message_length, source_GGA->longitude < 0.0f ? 'W' : 'E'))
         {
-        	(void)strcat(message_data, "E");
+        	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
@@ -2262,14 +2794,13 @@ nmea_error_t nmea_encode_GGA(char *message_data, const void *source)
     {
         if (source_GGA->quality_indicator < 9u)
         {
-            (void)snprintf(number_buffer, sizeof(number_buffer), "%u", (unsigned int)(source_GGA->quality_indicator));
-            if (!safe_strcat(message_data, max_message_length, number_buffer))
+            if (!append_uint(message_data, &length, max_message_length, (uint32_t)(source_GGA->quality_indicator), 0U))
             {
             	return nmea_error_message;
             }
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
@@ -2278,66 +2809,61 @@ nmea_error_t nmea_encode_GGA(char *message_data, const void *source)
     {
         if (source_GGA->satellites_in_use < 13U)
         {
-            (void)snprintf(number_buffer, sizeof(number_buffer), "%02u", (unsigned int)(source_GGA->satellites_in_use));
-            if (!safe_strcat(message_data, max_message_length, number_buffer))
+            if (!append_uint(message_data, &length, max_message_length, (uint32_t)(source_GGA->satellites_in_use), 2U))
             {
             	return nmea_error_message;
             }
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_GGA->data_available & NMEA_GGA_HDOP_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_GGA->HDOP), 3U, 0U);		
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_GGA->HDOP), 3U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_GGA->data_available & NMEA_GGA_ALTITUDE_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_GGA->altitude), 3U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_GGA->altitude), 3U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",M,"))
+    if (!append_text(message_data, &length, max_message_length, ",M,"))
     {
     	return nmea_error_message;
     }
 
     if (source_GGA->data_available & NMEA_GGA_GEIODAL_SEPARATION_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_GGA->geoidal_separation), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_GGA->geoidal_separation), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",M,"))
+    if (!append_text(message_data, &length, max_message_length, ",M,"))
     {
     	return nmea_error_message;
     }
 
     if (source_GGA->data_available & NMEA_GGA_DGPS_AGE_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_GGA->dgpsAge), 0U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_GGA->dgpsAge), 0U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
@@ -2346,8 +2872,7 @@ nmea_error_t nmea_encode_GGA(char *message_data, const void *source)
     {
         if (source_GGA->dgps_station_id < 1024U)
         {
-            (void)snprintf(number_buffer, sizeof(number_buffer), "%04u", (unsigned int)(source_GGA->dgps_station_id));
-            if (!safe_strcat(message_data, max_message_length, number_buffer))
+            if (!append_uint(message_data, &length, max_message_length, (uint32_t)(source_GGA->dgps_station_id), 4U))
             {
             	return nmea_error_message;
             }
@@ -2360,7 +2885,7 @@ nmea_error_t nmea_encode_GGA(char *message_data, const void *source)
 nmea_error_t nmea_encode_MDA(char *message_data, const void *source)
 {
     uint8_t  max_message_length;
-    const char *next_field_data;
+    size_t length;
     const nmea_message_data_MDA_t *source_MDA;
 
     if (message_data == NULL || source == NULL)
@@ -2372,147 +2897,319 @@ nmea_error_t nmea_encode_MDA(char *message_data, const void *source)
 
     max_message_length = NMEA_MAX_MESSAGE_LENGTH - 5U;
 
-    (void)strcpy(message_data, "$IIMDA,");
+    length = format_text(message_data, (size_t)max_message_length + (size_t)1, "$IIMDA,");
 
     if (source_MDA->data_available & NMEA_MDA_PRESSURE_INCHES_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_MDA->pressure_inches), 3U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_MDA->pressure_inches), 3U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",I,"))
+    if (!append_text(message_data, &length, max_message_length, ",I,"))
     {
     	return nmea_error_message;
     }
 
     if (source_MDA->data_available & NMEA_MDA_PRESSURE_BARS_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_MDA->pressure_bars), 5U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_MDA->pressure_bars), 5U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",B,"))
+    if (!append_text(message_data, &length, max_message_length, ",B,"))
     {
     	return nmea_error_message;
     }
 
     if (source_MDA->data_available & NMEA_MDA_AIR_TEMPERATURE_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_MDA->air_temperature), 2U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_MDA->air_temperature), 2U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",C,"))
+    if (!append_text(message_data, &length, max_message_length, ",C,"))
     {
     	return nmea_error_message;
     }
 
     if (source_MDA->data_available & NMEA_MDA_WATER_TEMPERATURE_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_MDA->water_temperature), 2U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_MDA->water_temperature), 2U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",C,"))
+    if (!append_text(message_data, &length, max_message_length, ",C,"))
     {
     	return nmea_error_message;
     }
 
     if (source_MDA->data_available & NMEA_MDA_RELATIVE_HUMIDITY_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_MDA->relative_huimidity), 2U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_MDA->relative_huimidity), 2U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_MDA->data_available & NMEA_MDA_ABSOLUTE_HUMIDITY_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_MDA->absolute_humidity), 2U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_MDA->absolute_humidity), 2U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ","))
+    if (!append_text(message_data, &length, max_message_length, ","))
     {
     	return nmea_error_message;
     }
 
     if (source_MDA->data_available & NMEA_MDA_DEW_POINT_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_MDA->dew_point), 2U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_MDA->dew_point), 2U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",C,"))
+    if (!append_text(message_data, &length, max_message_length, ",C,"))
     {
     	return nmea_error_message;
     }
 
     if (source_MDA->data_available & NMEA_MDA_WIND_DIRECTION_TRUE_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_MDA->wind_direction_true), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_MDA->wind_direction_true), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",T,"))
+    if (!append_text(message_data, &length, max_message_length, ",T,"))
     {
     	return nmea_error_message;
     }
 
     if (source_MDA->data_available & NMEA_MDA_WIND_DIRECTION_MAGNETIC_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_MDA->wind_direction_magnetic), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_MDA->wind_direction_magnetic), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",M,"))
+    if (!append_text(message_data, &length, max_message_length, ",M,"))
     {
     	return nmea_error_message;
     }
 
     if (source_MDA->data_available & NMEA_MDA_WINDSPEED_KNOTS_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_MDA->windspeed_knots), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_MDA->windspeed_knots), 1U, 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",N,"))
+    if (!append_text(message_data, &length, max_message_length, ",N,"))
     {
     	return nmea_error_message;
     }
 
     if (source_MDA->data_available & NMEA_MDA_WINDSPEED_MPS_PRESENT)
     {
-        next_field_data = my_ftoa((float)(source_MDA->windspeed_mps), 1U, 0U);
-        if (!safe_strcat(message_data, max_message_length, next_field_data))
+        if (!append_fixed(message_data, &length, max_message_length, (float)(source_MDA->windspeed_mps), 1U, 0U))
+        {
+        	return nmea_error_message;
+        }
+    }
+    if (!append_text(message_data, &length, max_message_length, ",M"))
+    {
+    	return nmea_error_message;
+    }
+
+    return nmea_error_none;
+}
+
+nmea_error_t nmea_encode_N2K(char *message_data, const void *source)
+{
+    uint8_t max_message_length;
+    size_t length;
+    const nmea_message_data_N2K_t *source_N2K;
+    uint32_t counters[9];
+    uint8_t i;
+
+    if (message_data == NULL || source == NULL)
+    {
+        return nmea_error_param;
+    }
+
+    source_N2K = (nmea_message_data_N2K_t *)source;
+
+    max_message_length = NMEA_MAX_MESSAGE_LENGTH - 5U;
+
+    length = format_text(message_data, (size_t)max_message_length + (size_t)1, "$BBN2K,");
+
+    if (!append_fixed(message_data, &length, max_message_length, source_N2K->bus_load, 1U, 0U) ||
+    		!append_text(message_data, &length, max_message_length, ",") ||
+			!append_fixed(message_data, &length, max_message_length, source_N2K->long_bus_load, 1U, 0U))
+    {
+    	return nmea_error_message;
+    }
+
+    counters[0] = source_N2K->frames_per_second;
+    counters[1] = (uint32_t)source_N2K->sources;
+    counters[2] = (uint32_t)source_N2K->busiest_source;
+    counters[3] = (uint32_t)source_N2K->tx_errors;
+    counters[4] = (uint32_t)source_N2K->rx_errors;
+    counters[5] = (uint32_t)source_N2K->max_tx_errors;
+    counters[6] = (uint32_t)source_N2K->max_rx_errors;
+    counters[7] = source_N2K->rx_overruns;
+    counters[8] = source_N2K->send_blocked;
+    for (i = 0U; i < (uint8_t)(sizeof(counters) / sizeof(counters[0])); i++)
+    {
+        if (!append_text(message_data, &length, max_message_length, ",") ||
+        		!append_uint(message_data, &length, max_message_length, counters[i], 0U))
         {
         	return nmea_error_message;
         }
     }
-    if (!safe_strcat(message_data, max_message_length, ",M"))
+
+    return nmea_error_none;
+}
+
+nmea_error_t nmea_decode_GWY(const char *message_data, nmea_message_data_GWY_t *result)
+{
+	/* sample messages
+	$BBGWY*hh							query only
+	$BBGWY,YDR*hh						YD RAW, all PGNs
+	$BBGWY,PCD,+129025,+129026*hh		Seasmart, position and SOG/COG only
+	$BBGWY,ACT,-129038,-129039*hh		Actisense, all but AIS class A position reports
+	$BBGWY,OFF*hh
+	 */
+
+    nmea_fields_t fields;
+    const char *next_token;
+    uint32_t pgn;
+    uint8_t i;
+
+    result->format[0] = '\0';
+    result->filter_count = 0U;
+
+    if (!tokenize(message_data, 1U, 2U + NMEA_GWY_MAX_FILTER_PGNS, &fields))
+    {
+    	return nmea_error_message;
+    }
+
+    if (fields.count == 1U)
+    {
+    	return nmea_error_none;
+    }
+
+    if (field_length(&fields, 1U) != NMEA_GWY_FORMAT_LENGTH)
+    {
+    	return nmea_error_message;
+    }
+    (void)memcpy(result->format, field_text(&fields, 1U), (size_t)NMEA_GWY_FORMAT_LENGTH);
+    result->format[NMEA_GWY_FORMAT_LENGTH] = '\0';
+
+    for (i = 2U; i < fields.count; i++)
+    {
+    	next_token = field_text(&fields, i);
+    	if (*next_token != '+' && *next_token != '-')
+    	{
+    		break;
+    	}
+    	pgn = (uint32_t)strtoul(next_token + 1, NULL, 10);
+    	if (pgn == 0UL)
+    	{
+    		return nmea_error_message;
+    	}
+    	result->filter_pgns[result->filter_count] = pgn;
+    	result->filter_exclude[result->filter_count] = (*next_token == '-');
+    	result->filter_count++;
+    }
+
+    return nmea_error_none;
+}
+
+nmea_error_t nmea_encode_GWY(char *message_data, const void *source)
+{
+    uint8_t max_message_length;
+    size_t length;
+    const nmea_message_data_GWY_t *source_GWY;
+
+    if (message_data == NULL || source == NULL)
+    {
+        return nmea_error_param;
+    }
+
+    source_GWY = (nmea_message_data_GWY_t *)source;
+
+    max_message_length = NMEA_MAX_MESSAGE_LENGTH - 5U;
+
+    length = format_text(message_data, (size_t)max_message_length + (size_t)1, "$BBGWY,");
+
+    if (!append_text(message_data, &length, max_message_length, source_GWY->format) ||
+    		!append_text(message_data, &length, max_message_length, ",") ||
+			!append_uint(message_data, &length, max_message_length, source_GWY->messages, 0U) ||
+			!append_text(message_data, &length, max_message_length, ",") ||
+			!append_uint(message_data, &length, max_message_length, source_GWY->bytes, 0U) ||
+			!append_text(message_data, &length, max_message_length, ",") ||
+			!append_uint(message_data, &length, max_message_length, source_GWY->dropped_messages, 0U) ||
+			!append_text(message_data, &length, max_message_length, ",") ||
+			!append_uint(message_data, &length, max_message_length, source_GWY->dropped_bytes, 0U))
+    {
+    	return nmea_error_message;
+    }
+
+    return nmea_error_none;
+}
+
+nmea_error_t nmea_encode_ALR(char *message_data, const void *source)
+{
+    uint8_t max_message_length;
+    size_t length;
+    const nmea_message_data_ALR_t *source_ALR;
+
+    if (message_data == NULL || source == NULL)
+    {
+        return nmea_error_param;
+    }
+
+    source_ALR = (nmea_message_data_ALR_t *)source;
+    if (source_ALR->alarm_number > 999U)
+    {
+        return nmea_error_param;
+    }
+
+    max_message_length = NMEA_MAX_MESSAGE_LENGTH - 5U;
+
+    length = format_text(message_data, (size_t)max_message_length + (size_t)1, "$IIALR,");
+
+    if (source_ALR->data_available & NMEA_ALR_UTC_PRESENT)
+    {
+        if (source_ALR->utc.hours < 24U && source_ALR->utc.minutes < 60U && source_ALR->utc.seconds < 60.0f)
+        {
+            if (!append_uint(message_data, &length, max_message_length, (uint32_t)(source_ALR->utc.hours), 2U) ||
+                    !append_uint(message_data, &length, max_message_length, (uint32_t)(source_ALR->utc.minutes), 2U) ||
+                    !append_fixed(message_data, &length, max_message_length, source_ALR->utc.seconds, 2U, 2U))
+            {
+            	return nmea_error_message;
+            }
+        }
+    }
+    if (!append_char(message_data, &length, max_message_length, ',') ||
+    		!append_uint(message_data, &length, max_message_length, (uint32_t)source_ALR->alarm_number, 3U) ||
+    		!append_char(message_data, &length, max_message_length, ',') ||
+			!append_char(message_data, &length, max_message_length, source_ALR->condition ? 'A' : 'V') ||
+			!append_char(message_data, &length, max_message_length, ',') ||
+			!append_char(message_data, &length, max_message_length, source_ALR->acknowledged ? 'A' : 'V') ||
+			!append_char(message_data, &length, max_message_length, ',') ||
+			!append_text(message_data, &length, max_message_length, source_ALR->text))
     {
     	return nmea_error_message;
     }
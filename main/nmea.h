@@ -42,8 +42,7 @@ extern "C" {
 **************/
 
 #define NMEA_NUMBER_OF_PORTS                    			2U					///< Maximum number of ports this library can communicate on
-#define NMEA_MAXIMUM_TRANSMIT_MESSAGE_DETAILS           	16U					///< Maximum number of different transmit message types
-#define NMEA_MAXIMUM_RECEIVE_MESSAGE_DETAILS           		6U					///< Maximum number of different receive message types
+#define NMEA_MAXIMUM_TRANSMIT_MESSAGE_DETAILS           	32U					///< Maximum number of different transmit message types, not more than 32
 #define NMEA_MAX_MESSAGE_LENGTH     						82U					///< Maximum message length including cr lf
 #define NMEA_MIN_MESSAGE_LENGTH     						9U					///< Minumum message length including cr lf
 #define NMEA_DPT_DEPTH_PRESENT                				0x00000001UL		///< Message DPT bitfield for depth present
@@ -89,6 +88,7 @@ extern "C" {
 #define NMEA_VDM_CHANNEL_CODE_PRESENT  						0x00000008UL		///< Message VDM bitfield for channel code present
 #define NMEA_VDM_DATA_PRESENT  								0x00000010UL		///< Message VDM bitfield for data present
 #define NMEA_VDM_FILL_BITS_PRESENT  						0x00000020UL		///< Message VDM bitfield for fill bits present
+#define NMEA_ALR_UTC_PRESENT								0x00000001UL		///< Message ALR bitfield for time of condition change present
 #define NMEA_VHW_HEADING_TRUE_PRESENT     					0x00000001UL		///< Message VHW bitfield for heading true present
 #define NMEA_VHW_HEADING_MAG_PRESENT      					0x00000002UL		///< Message VHW bitfield for heading magnetic present
 #define NMEA_VHW_WATER_SPEED_KTS_PRESENT  					0x00000004UL		///< Message VHW bitfield for water speed knots present
@@ -116,8 +116,13 @@ extern "C" {
 #define NMEA_XDR_MEASUREMENT_5_PRESENT                		0x00000010UL		///< Message XDR bitfield for measurement 5 present
 #define NMEA_XDR_MEASUREMENT_6_PRESENT                		0x00000020UL		///< Message XDR bitfield for measurement 6 present
 #define NMEA_XDR_MAX_ID_LENGTH                      		8U					///< Maximum id length in a XDR message
-#define NMEA_SPEED_UP_MESSAGE_PERMIL_PERIOD_ADJUSTMENT		999UL				///< Rate speed up permil value
-#define NMEA_SLOW_DOWN_MESSAGE_PERMIL_PERIOD_ADJUSTMENT		1010UL				///< Rate speed down permil value
+#define NMEA_OUTPUT_QUEUE_SIZE								512U				///< Bytes of sentences queued per port and priority class
+#define NMEA_MAX_GROUP_SENTENCES							5U					///< Most sentences queued as one group by nmea_transmit_message_group
+#define NMEA_OUTPUT_BURST_MS								100UL				///< Time at a port's rate that can be sent at once after it has been idle
+#define NMEA_GWY_FORMAT_LENGTH								3U					///< Message GWY format field length
+#define NMEA_GWY_MAX_FILTER_PGNS							8U					///< Message GWY maximum PGN filter fields
+#define NMEA_ALR_TEXT_LENGTH								48U					///< Message ALR maximum alarm description length
+#define NMEA_PERIOD_ERROR_BUCKETS							8U					///< Buckets in the histogram of transmit period errors
 
 /************
 *** TYPES ***
@@ -143,6 +148,60 @@ typedef struct
     uint16_t year;          ///< year 4 digit form */
 } nmea_date_t;
 
+/**
+ * Counters of sentences received on a port
+ */
+typedef struct
+{
+	uint32_t sentences;				///< Sentences with good checksum
+	uint32_t malformed;				///< Sentences cut short by another start, too short or without checksum field
+	uint32_t over_length;			///< Sentences longer than NMEA_MAX_MESSAGE_LENGTH
+	uint32_t checksum_failed;		///< Sentences with wrong checksum
+} nmea_receive_stats_t;
+
+/**
+ * Counters of periodic messages transmitted on a port
+ */
+typedef struct
+{
+	uint32_t sent;												///< Periodic messages sent
+	uint32_t resynchronised;									///< Times a message was a whole period late and its schedule restarted
+	uint32_t period_error[NMEA_PERIOD_ERROR_BUCKETS];			///< Sends by how far in ms the time since the message was last sent was from its period. Bucket 0 is under 1 ms, bucket n is 2^(n-1) to 2^n - 1 ms and the last bucket also holds everything longer
+} nmea_transmit_stats_t;
+
+/**
+ * Priority classes of transmitted sentences. Each port has a queue per class and sends from the highest class that has
+ * anything waiting, so a lower class only gets what is left of the port's rate.
+ */
+typedef enum
+{
+	nmea_priority_high,			///< AIS, position and alarms, VDM, GGA, RMC and ALR
+	nmea_priority_normal,		///< Instrument data and replies to queries
+	nmea_priority_low,			///< Slowly changing data, MDA, XDR and MTW
+	nmea_priority_max			/* must be last value */
+} nmea_priority_t;
+
+/**
+ * Counters of one priority class of sentences transmitted on a port
+ */
+typedef struct
+{
+	uint32_t queued;				///< Sentences queued for sending
+	uint32_t sent;					///< Sentences written to the port
+	uint32_t dropped;				///< Queued sentences dropped, oldest first, to make room for newer ones of the class
+	uint32_t delay_total_ms;		///< Sum of the time sent sentences waited in the queue
+	uint32_t delay_max_ms;			///< Longest time a sent sentence waited in the queue
+} nmea_output_class_stats_t;
+
+/**
+ * Counters of sentences transmitted on a port, by priority class
+ */
+typedef struct
+{
+	nmea_output_class_stats_t classes[nmea_priority_max];	///< Counters indexed by nmea_priority_t
+	uint16_t queued_bytes[nmea_priority_max];				///< Bytes waiting in each class queue now
+} nmea_output_stats_t;
+
 /**
  * Enumeration of errors returned by this library
  */
@@ -173,6 +232,9 @@ typedef enum
     nmea_message_VLW,			///< Distances message
     nmea_message_XDR,			///< Transducer message
 	nmea_message_MDA,			///< Envirnment message
+	nmea_message_N2K,			///< BlueBridge NMEA2000 bus health, received empty as query and transmitted as reply
+	nmea_message_GWY,			///< BlueBridge NMEA2000 raw gateway, received as command or query and transmitted as reply
+	nmea_message_ALR,			///< Alarm state message, transmit only
     nmea_message_max            /* must be last value */
 } nmea_message_type_t;
 
@@ -195,7 +257,16 @@ typedef void (*nmea_get_transmit_data_callback_t)(void);
  * @param source Pointer to structure holding data to be encoded
  * @return One of the error codes defined above
  */
-typedef nmea_error_t (*nmea_encoder_function_t)(const char *message_data, void *source);
+typedef nmea_error_t (*nmea_encoder_function_t)(char *message_data, const void *source);
+
+/**
+ * Typedef of function that takes data received on a port that is passed on, see nmea_set_port_receive_forward
+ *
+ * @param data The received data
+ * @param length Bytes in data, 0 to only ask for the space
+ * @return How many more bytes can be taken
+ */
+typedef uint16_t (*nmea_receive_forward_function_t)(const uint8_t *data, uint16_t length);
 
 /**
  * Structure holding data on each message type to be transmitted per port
@@ -365,6 +436,52 @@ typedef struct
     float windspeed_mps;            ///< Wind speed ground referenced m/s
 } nmea_message_data_MDA_t;
 
+/**
+ * Structure for message data for BlueBridge proprietary message type N2K, sent as $BBN2K
+ */
+typedef struct
+{
+    float bus_load;					///< Bus load over last second in percent
+    float long_bus_load;			///< Bus load over last minute in percent
+    uint32_t frames_per_second;		///< Frames seen in last second
+    uint8_t sources;				///< Number of source addresses heard
+    uint8_t busiest_source;			///< Source address that has sent most frames, 255 if none
+    uint8_t tx_errors;				///< CAN controller transmit error counter
+    uint8_t rx_errors;				///< CAN controller receive error counter
+    uint8_t max_tx_errors;			///< Highest transmit error counter seen
+    uint8_t max_rx_errors;			///< Highest receive error counter seen
+    uint32_t rx_overruns;			///< Received frames lost because receive queue was full
+    uint32_t send_blocked;			///< Messages held back because send buffers were full
+} nmea_message_data_N2K_t;
+
+/**
+ * Structure for message data for BlueBridge proprietary message type GWY, sent as $BBGWY
+ */
+typedef struct
+{
+    char format[NMEA_GWY_FORMAT_LENGTH + 1];			///< OFF, ACT for Actisense, PCD for Seasmart or YDR for YD RAW, empty in a query
+    uint8_t filter_count;								///< PGN filter fields received
+    uint32_t filter_pgns[NMEA_GWY_MAX_FILTER_PGNS];		///< PGNs to include or exclude
+    bool filter_exclude[NMEA_GWY_MAX_FILTER_PGNS];		///< If PGN at same index is excluded, received as -PGN, included as +PGN
+    uint32_t messages;									///< Messages packed for sending
+    uint32_t bytes;										///< Bytes written to the link
+    uint32_t dropped_messages;							///< Messages lost because the link was busy
+    uint32_t dropped_bytes;								///< Bytes lost because the link was busy
+} nmea_message_data_GWY_t;
+
+/**
+ * Structure for message data for message type ALR
+ */
+typedef struct
+{
+    uint32_t data_available;						///< Bitfield of what fields are present in the message
+    nmea_utc_time_t utc;							///< Time of the condition change in UTC
+    uint16_t alarm_number;							///< Identifies the alarm, 0 to 999
+    bool condition;									///< If the threshold is exceeded, sent as A, or not, sent as V
+    bool acknowledged;								///< If the alarm has been acknowledged, sent as A, or not, sent as V
+    char text[NMEA_ALR_TEXT_LENGTH + 1];			///< Alarm description
+} nmea_message_data_ALR_t;
+
 /**
  * Structure for message data for message type VLW
  */
@@ -422,26 +539,116 @@ void nmea_enable_transmit_message(const transmit_message_details_t *nmea_transmi
 void nmea_disable_transmit_message(uint8_t port, nmea_message_type_t message_type);
 
 /**
- * Enable the reception of a specific message type on a specific port
+ * Enable the reception of a specific message type on a specific port. Every message type can be enabled on every port.
+ * If the type is already enabled on the port the earlier details are kept.
  *
  * @param nmea_receive_message_details Details of message type, port, period
  */
 void nmea_enable_receive_message(const nmea_receive_message_details_t *nmea_receive_message_details);
 
 /**
- * Disable the transmission of a specific message type on a specific port
+ * Transmit a message type enabled on a port at the next call of nmea_process rather than when next due. May be called
+ * from another task than the one calling nmea_process.
  *
- * @param port The port to disable this type transmission
+ * @param port The port to transmit on
  * @param message_type The message type
  */
 void nmea_transmit_message_now(uint8_t port, nmea_message_type_t message_type);
 
 /**
- * Main library processing function
+ * Encode a message from the data given and queue it for sending on a port straight away, for messages that are sent
+ * as data arrives, several at a time, rather than from a transmit message details slot
+ *
+ * @note Call from the task that runs nmea_process(), e.g. from a receive callback
+ * @param port The port to send on
+ * @param message_type The message type, which gives its priority class
+ * @param encoder Encoder of the message type
+ * @param message_data Data to encode, of the type the encoder takes
+ * @return Error code from above enum
+ */
+nmea_error_t nmea_transmit_message_data(uint8_t port, nmea_message_type_t message_type, nmea_encoder_function_t encoder,
+		const void *message_data);
+
+/**
+ * Encode several messages of a type from an array of data and queue them for sending on a port as a group, for
+ * messages that only make sense together, like the fragments of a VDM message. A group is queued whole or not at all
+ * and when the queue is full it is dropped whole, so no fragment is sent without the others.
+ *
+ * @note Call from the task that runs nmea_process(), e.g. from a receive callback
+ * @param port The port to send on
+ * @param message_type The message type, which gives its priority class
+ * @param encoder Encoder of the message type
+ * @param message_data Array of data to encode, of the type the encoder takes
+ * @param message_data_size Size of an element of message_data in bytes
+ * @param count Number of elements in message_data, not more than NMEA_MAX_GROUP_SENTENCES
+ * @return Error code from above enum
+ */
+nmea_error_t nmea_transmit_message_group(uint8_t port, nmea_message_type_t message_type, nmea_encoder_function_t encoder,
+		const void *message_data, size_t message_data_size, uint8_t count);
+
+/**
+ * Main library processing function. Encodes every message that is due into the output queues, writes from the queues
+ * as far as each port's rate allows and reads received data. Each periodic message is scheduled from the time it was
+ * due, not the time it was sent, so its period is kept on average however often this is called.
+ *
+ * @note Call this periodically, often enough for received data. Nothing happens unless this is done
+ * @return Time in ms until the next periodic message is due or a queued sentence can be written, 0 if that is now,
+ *         UINT32_MAX if there is nothing to wait for
+ */
+uint32_t nmea_process(void);
+
+/**
+ * Mute or unmute all transmission on a port, messages are encoded and scheduled as normal but not written
+ *
+ * @param port The port
+ * @param muted If transmission is muted
+ */
+void nmea_set_port_transmit_muted(uint8_t port, bool muted);
+
+/**
+ * Pass data received on a port on to another reader as well as decoding the sentences in it. Call only from receive
+ * callbacks of that port, or from the task that calls nmea_process, so the switch happens at a known point in the
+ * received data. Set during a receive callback, everything after the sentence being decoded is passed on. Reading the
+ * port is limited to what the function says it can take, so when it is full received data waits in the port.
  *
- * @note Call this periodically. Nothing happens unless this is done
+ * @param port The port
+ * @param forward Function that takes the data, NULL to stop passing data on
  */
-void nmea_process(void);
+void nmea_set_port_receive_forward(uint8_t port, nmea_receive_forward_function_t forward);
+
+/**
+ * Get the sentence framing counters of a port, counted since start up
+ *
+ * @param port The port
+ * @param stats Where to copy the counters
+ */
+void nmea_get_receive_stats(uint8_t port, nmea_receive_stats_t *stats);
+
+/**
+ * Get the periodic transmit counters of a port, counted since start up
+ *
+ * @param port The port
+ * @param stats Where to copy the counters
+ */
+void nmea_get_transmit_stats(uint8_t port, nmea_transmit_stats_t *stats);
+
+/**
+ * Set the most bytes per second written to a port, e.g. a tenth of the baud rate of a serial port or what a Bluetooth
+ * link carries. Sentences beyond that wait in the port's queues, highest priority class first. Up to
+ * NMEA_OUTPUT_BURST_MS worth can be sent at once after the port has been idle.
+ *
+ * @param port The port
+ * @param bytes_per_second The rate, 0 for no limit, which is the default
+ */
+void nmea_set_port_rate(uint8_t port, uint32_t bytes_per_second);
+
+/**
+ * Get the output queue counters of a port by priority class, counted since start up
+ *
+ * @param port The port
+ * @param stats Where to copy the counters
+ */
+void nmea_get_output_stats(uint8_t port, nmea_output_stats_t *stats);
 
 /**
  * Decode a GGA message
@@ -533,6 +740,15 @@ nmea_error_t nmea_encode_RMC(char *message_data, const void *source);
  */
 nmea_error_t nmea_decode_VDM(const char *message_data, nmea_message_data_VDM_t *result);
 
+/**
+ * Decode a BlueBridge proprietary GWY message
+ *
+ * @param message_data The received message
+ * @param result Structure to contain the decoded values
+ * @return Error code from above enum
+ */
+nmea_error_t nmea_decode_GWY(const char *message_data, nmea_message_data_GWY_t *result);
+
 /**
  * Encode a VDM message
  *
@@ -587,6 +803,33 @@ nmea_error_t nmea_encode_HDT(char *message_data, const void *source);
  */
 nmea_error_t nmea_encode_MDA(char *message_data, const void *source);
 
+/**
+ * Encode a BlueBridge proprietary N2K message
+ *
+ * @param message_data The encoded message
+ * @param source The source of the value to encode that is cast to a data specific type
+ * @return Error code from above enum
+ */
+nmea_error_t nmea_encode_N2K(char *message_data, const void *source);
+
+/**
+ * Encode a BlueBridge proprietary GWY message
+ *
+ * @param message_data The encoded message
+ * @param source The source of the value to encode that is cast to a data specific type
+ * @return Error code from above enum
+ */
+nmea_error_t nmea_encode_GWY(char *message_data, const void *source);
+
+/**
+ * Encode an ALR message
+ *
+ * @param message_data The encoded message
+ * @param source The source of the value to encode that is cast to a data specific type
+ * @return Error code from above enum
+ */
+nmea_error_t nmea_encode_ALR(char *message_data, const void *source);
+
 #ifdef __cplusplus
 }
 #endif
@@ -31,9 +31,11 @@ SOFTWARE.
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdlib.h>
 #include "freertos/FreeRTOS.h"
 #include "publisher.h"
 #include "main.h"
+#include "boat_data.h"
 #include "esp_log.h"
 #include "modem.h"
 #include "mqtt.h"
@@ -43,6 +45,8 @@ SOFTWARE.
 #include "util.h"
 #include "timer.h"
 #include "led.h"
+#include "format.h"
+#include "telemetry.h"
 
 /**************
 *** DEFINES ***
@@ -66,11 +70,16 @@ static bool modem_activate_data_connection(void);
 static bool config_parser_callback(char *key, char *value);
 static bool open_mqtt_connection(void);
 static void close_mqtt_connection(void);
+static size_t build_n2k_health_payload(char *payload, size_t size, const n2k_health_t *health);
+static bool parse_deadband(char *value);
 
 /**********************
 *** LOCAL VARIABLES ***
 **********************/
 
+static telemetry_state_t telemetry;			///< Fields sent on the all or bin topic, for delta publishing
+static bool binary_payload;					///< Data is published in binary on the bin topic instead of comma separated on the all topic
+
 /***********************
 *** GLOBAL VARIABLES ***
 ***********************/
@@ -240,6 +249,74 @@ static void close_mqtt_connection(void)
 	(void)ModemCloseTcpConnection(5000UL);
 }
 
+/**
+ * Write NMEA2000 bus health as comma separated values, bus load and long bus load with 1 decimal followed by the
+ * counters in the order of n2k_health_t
+ *
+ * @param payload Buffer to write to
+ * @param size Size in bytes of payload
+ * @param health Bus health snapshot to write
+ * @return Length of payload written
+ */
+static size_t build_n2k_health_payload(char *payload, size_t size, const n2k_health_t *health)
+{
+	const uint32_t counters[] = {health->frames_per_second, health->sources, health->busiest_source, health->tx_errors,
+			health->rx_errors, health->max_tx_errors, health->max_rx_errors, health->rx_overruns, health->send_blocked};
+	size_t length;
+	size_t i;
+
+	length = format_fixed(payload, size, health->bus_load, 1U, 0U);
+	length += format_text(&payload[length], size - length, ",");
+	length += format_fixed(&payload[length], size - length, health->long_bus_load, 1U, 0U);
+	for (i = 0U; i < sizeof(counters) / sizeof(counters[0]); i++)
+	{
+		length += format_text(&payload[length], size - length, ",");
+		length += format_uint(&payload[length], size - length, counters[i], 0U);
+	}
+
+	return length;
+}
+
+/**
+ * Set a telemetry field deadband from an SMS value in format field,absolute[,percent] e.g. DEPTH,0.2,5
+ *
+ * @param value The value, capitalized in place
+ * @return If the field was known and the deadband valid and set
+ */
+static bool parse_deadband(char *value)
+{
+	char *absolute_text;
+	char *percent_text;
+	char *end;
+	float absolute;
+	float percent = 0.0f;
+
+	util_capitalize_string(value);
+	absolute_text = strchr(value, ',');
+	if (absolute_text == NULL)
+	{
+		return false;
+	}
+	*absolute_text++ = '\0';
+	percent_text = strchr(absolute_text, ',');
+	if (percent_text != NULL)
+	{
+		*percent_text++ = '\0';
+		percent = strtof(percent_text, &end);
+		if (end == percent_text || *end != '\0')
+		{
+			return false;
+		}
+	}
+	absolute = strtof(absolute_text, &end);
+	if (end == absolute_text || *end != '\0')
+	{
+		return false;
+	}
+
+	return telemetry_set_deadband(telemetry_field_from_name(value), absolute, percent / 100.0f);
+}
+
 /**
  * Do modem initializations to the point of ready to open TCP connection
  */
@@ -271,8 +348,11 @@ static bool config_parser_callback(char *key, char *value)
 	char message_text[MODEM_SMS_MAX_TEXT_LENGTH + 1];
 	uint32_t period;
 	uint32_t time_ms;
+	boat_data_snapshot_t snapshot;
 	char number_buf[20];
 	char started_stopped_buf[8];
+	size_t length;
+	size_t line_length;
 	
 	if (key == NULL || value == NULL)
 	{
@@ -353,6 +433,49 @@ static bool config_parser_callback(char *key, char *value)
 		}
 		found = true;
 	}		
+	else if (strcmp(key, "KEYFRAME") == 0)
+	{
+		ESP_LOGI(pcTaskGetName(NULL), "Property keyframe=%s", value);	
+		if (telemetry_set_keyframe_interval(&telemetry, (uint16_t)atoi(value)))
+		{
+			(void)sms_send("OK", settings_get_phone_number());		
+		}
+		else
+		{
+			(void)sms_send("Bad value", settings_get_phone_number());		
+		}
+		found = true;
+	}		
+	else if (strcmp(key, "FORMAT") == 0)
+	{
+		ESP_LOGI(pcTaskGetName(NULL), "Property format=%s", value);	
+		util_capitalize_string(value);
+		if (strcmp(value, "BIN") == 0 || strcmp(value, "CSV") == 0)
+		{
+			binary_payload = strcmp(value, "BIN") == 0;
+			// subscribers of the other topic have nothing to apply deltas to
+			telemetry_init(&telemetry, telemetry.keyframe_interval);
+			(void)sms_send("OK", settings_get_phone_number());		
+		}
+		else
+		{
+			(void)sms_send("Bad value", settings_get_phone_number());		
+		}
+		found = true;
+	}		
+	else if (strcmp(key, "DEADBAND") == 0)
+	{
+		ESP_LOGI(pcTaskGetName(NULL), "Property deadband=%s", value);	
+		if (parse_deadband(value))
+		{
+			(void)sms_send("OK", settings_get_phone_number());		
+		}
+		else
+		{
+			(void)sms_send("Bad value", settings_get_phone_number());		
+		}
+		found = true;
+	}		
 	else if (strcmp(key, "SETTINGS") == 0)
 	{
 		ESP_LOGI(pcTaskGetName(NULL), "Command settings");	
@@ -419,11 +542,16 @@ static bool config_parser_callback(char *key, char *value)
 	{
 		ESP_LOGI(pcTaskGetName(NULL), "Command position");	
 		time_ms = timer_get_time_ms();			
+		boat_data_get_group(boat_data_group_position, &snapshot);
 		
-		if ((time_ms - boat_data_reception_time.latitude_received_time < LATITUDE_MAX_DATA_AGE_MS || boat_data_reception_time.latitude_received_time > time_ms) &&
-				(time_ms - boat_data_reception_time.longitude_received_time < LONGITUDE_MAX_DATA_AGE_MS || boat_data_reception_time.longitude_received_time > time_ms))
-		{
-			(void)snprintf(message_text, (size_t)MODEM_SMS_MAX_TEXT_LENGTH + 1, "maps.google.com/maps?t=k&q=loc:%.8f+%.8f", latitude_data, longitude_data);
+		if (boat_data_fresh(&snapshot, boat_data_latitude, time_ms) &&
+				boat_data_fresh(&snapshot, boat_data_longitude, time_ms))
+		{
+			// float has about 7 significant digits so more decimals than 7 would only be noise
+			length = format_text(message_text, sizeof(message_text), "maps.google.com/maps?t=k&q=loc:");
+			length += format_fixed(&message_text[length], sizeof(message_text) - length, snapshot.entries[boat_data_latitude].value.number, 7U, 0U);
+			length += format_text(&message_text[length], sizeof(message_text) - length, "+");
+			(void)format_fixed(&message_text[length], sizeof(message_text) - length, snapshot.entries[boat_data_longitude].value.number, 7U, 0U);
 		}
 		else
 		{
@@ -438,144 +566,173 @@ static bool config_parser_callback(char *key, char *value)
 	{
 		ESP_LOGI(pcTaskGetName(NULL), "Command data");	
 		time_ms = timer_get_time_ms();			
+		boat_data_get_all(&snapshot);
 		
 		message_text[0] = '\0';
+		length = 0U;
 		
 		// depth
-		if (time_ms - boat_data_reception_time.depth_received_time < DEPTH_MAX_DATA_AGE_MS || boat_data_reception_time.depth_received_time > time_ms)
+		if (boat_data_fresh(&snapshot, boat_data_depth, time_ms))
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "Depth=%0.1f m\n", depth_data);
+			line_length = format_text(number_buf, sizeof(number_buf), "Depth=");
+			line_length += format_fixed(&number_buf[line_length], sizeof(number_buf) - line_length, snapshot.entries[boat_data_depth].value.number, 1U, 0U);
+			(void)format_text(&number_buf[line_length], sizeof(number_buf) - line_length, " m\n");
 		}
 		else
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "Depth=?\n");
+			(void)format_text(number_buf, sizeof(number_buf), "Depth=?\n");
 		}
-		(void)util_safe_strcat(message_text, sizeof(message_text), number_buf);		
+		length += format_text(&message_text[length], sizeof(message_text) - length, number_buf);		
 		
 		// boat speed
-		if (time_ms - boat_data_reception_time.boat_speed_received_time < BOAT_SPEED_MAX_DATA_AGE_MS || boat_data_reception_time.boat_speed_received_time > time_ms)
+		if (boat_data_fresh(&snapshot, boat_data_boat_speed, time_ms))
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "Boatspeed=%0.1f kt\n", boat_speed_data);
+			line_length = format_text(number_buf, sizeof(number_buf), "Boatspeed=");
+			line_length += format_fixed(&number_buf[line_length], sizeof(number_buf) - line_length, snapshot.entries[boat_data_boat_speed].value.number, 1U, 0U);
+			(void)format_text(&number_buf[line_length], sizeof(number_buf) - line_length, " kt\n");
 		}		
 		else
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "Boatspeed=?\n");
+			(void)format_text(number_buf, sizeof(number_buf), "Boatspeed=?\n");
 		}
-		(void)util_safe_strcat(message_text, sizeof(message_text), number_buf);	
+		length += format_text(&message_text[length], sizeof(message_text) - length, number_buf);	
 		
 		// heading
-		if (time_ms - boat_data_reception_time.heading_true_received_time < HEADING_TRUE_MAX_DATA_AGE_MS || boat_data_reception_time.heading_true_received_time > time_ms)
+		if (boat_data_fresh(&snapshot, boat_data_heading_true, time_ms))
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "Heading=%u T\n", (unsigned int)heading_true_data);
+			line_length = format_text(number_buf, sizeof(number_buf), "Heading=");
+			line_length += format_uint(&number_buf[line_length], sizeof(number_buf) - line_length, (uint32_t)snapshot.entries[boat_data_heading_true].value.number, 0U);
+			(void)format_text(&number_buf[line_length], sizeof(number_buf) - line_length, " T\n");
 		}		
 		else
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "Heading=?\n");
+			(void)format_text(number_buf, sizeof(number_buf), "Heading=?\n");
 		}
-		(void)util_safe_strcat(message_text, sizeof(message_text), number_buf);			
+		length += format_text(&message_text[length], sizeof(message_text) - length, number_buf);			
 		
 		// trip
-		if (time_ms - boat_data_reception_time.trip_received_time < TRIP_MAX_DATA_AGE_MS || boat_data_reception_time.trip_received_time > time_ms)
+		if (boat_data_fresh(&snapshot, boat_data_trip, time_ms))
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "Trip=%0.1f Nm\n", trip_data);
+			line_length = format_text(number_buf, sizeof(number_buf), "Trip=");
+			line_length += format_fixed(&number_buf[line_length], sizeof(number_buf) - line_length, snapshot.entries[boat_data_trip].value.number, 1U, 0U);
+			(void)format_text(&number_buf[line_length], sizeof(number_buf) - line_length, " Nm\n");
 		}		
 		else
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "Trip=?\n");
+			(void)format_text(number_buf, sizeof(number_buf), "Trip=?\n");
 		}
-		(void)util_safe_strcat(message_text, sizeof(message_text), number_buf);			
+		length += format_text(&message_text[length], sizeof(message_text) - length, number_buf);			
 		
 
 		// log
-		if (time_ms - boat_data_reception_time.total_distance_received_time < TOTAL_DISTANCE_MAX_DATA_AGE_MS || boat_data_reception_time.total_distance_received_time > time_ms)
+		if (boat_data_fresh(&snapshot, boat_data_total_distance, time_ms))
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "Log=%u Nm\n", (unsigned int)total_distance_data);
+			line_length = format_text(number_buf, sizeof(number_buf), "Log=");
+			line_length += format_uint(&number_buf[line_length], sizeof(number_buf) - line_length, (uint32_t)snapshot.entries[boat_data_total_distance].value.number, 0U);
+			(void)format_text(&number_buf[line_length], sizeof(number_buf) - line_length, " Nm\n");
 		}
 		else
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "Log=?\n");
+			(void)format_text(number_buf, sizeof(number_buf), "Log=?\n");
 		}
-		(void)util_safe_strcat(message_text, sizeof(message_text), number_buf);			
+		length += format_text(&message_text[length], sizeof(message_text) - length, number_buf);			
 		
 
 		// sog
-		if (time_ms - boat_data_reception_time.speed_over_ground_received_time < SOG_MAX_DATA_AGE_MS || boat_data_reception_time.speed_over_ground_received_time > time_ms)
+		if (boat_data_fresh(&snapshot, boat_data_speed_over_ground, time_ms))
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "SOG=%0.1f kt\n", speed_over_ground_data);
+			line_length = format_text(number_buf, sizeof(number_buf), "SOG=");
+			line_length += format_fixed(&number_buf[line_length], sizeof(number_buf) - line_length, snapshot.entries[boat_data_speed_over_ground].value.number, 1U, 0U);
+			(void)format_text(&number_buf[line_length], sizeof(number_buf) - line_length, " kt\n");
 		}
 		else
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "SOG=?\n");
+			(void)format_text(number_buf, sizeof(number_buf), "SOG=?\n");
 		}
-		(void)util_safe_strcat(message_text, sizeof(message_text), number_buf);	
+		length += format_text(&message_text[length], sizeof(message_text) - length, number_buf);	
 
 		// cog
-		if (time_ms - boat_data_reception_time.course_over_ground_received_time < COG_MAX_DATA_AGE_MS || boat_data_reception_time.course_over_ground_received_time > time_ms)
-		{
-			(void)snprintf(number_buf, sizeof(number_buf), "COG=%hu T\n", course_over_ground_data);
+		// cast to unsigned only in range, boat data keeps it in whole degrees from 0 to 359
+		if (boat_data_fresh(&snapshot, boat_data_course_over_ground, time_ms) &&
+				snapshot.entries[boat_data_course_over_ground].value.number >= 0.0f &&
+				snapshot.entries[boat_data_course_over_ground].value.number < 360.0f)
+		{
+			line_length = format_text(number_buf, sizeof(number_buf), "COG=");
+			line_length += format_uint(&number_buf[line_length], sizeof(number_buf) - line_length, (uint32_t)snapshot.entries[boat_data_course_over_ground].value.number, 0U);
+			(void)format_text(&number_buf[line_length], sizeof(number_buf) - line_length, " T\n");
 		}
 		else
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "COG=?\n");
+			(void)format_text(number_buf, sizeof(number_buf), "COG=?\n");
 		}
-		(void)util_safe_strcat(message_text, sizeof(message_text), number_buf);	
+		length += format_text(&message_text[length], sizeof(message_text) - length, number_buf);	
 
 		// temperature
-		if (time_ms - boat_data_reception_time.seawater_temperature_received_time < TEMPERATURE_MAX_DATA_AGE_MS || boat_data_reception_time.seawater_temperature_received_time > time_ms)
+		if (boat_data_fresh(&snapshot, boat_data_seawater_temperature, time_ms))
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "Temp=%0.1f C\n", seawater_temeperature_data);
+			line_length = format_text(number_buf, sizeof(number_buf), "Temp=");
+			line_length += format_fixed(&number_buf[line_length], sizeof(number_buf) - line_length, snapshot.entries[boat_data_seawater_temperature].value.number, 1U, 0U);
+			(void)format_text(&number_buf[line_length], sizeof(number_buf) - line_length, " C\n");
 		}
 		else
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "Temp=?\n");
+			(void)format_text(number_buf, sizeof(number_buf), "Temp=?\n");
 		}
-		(void)util_safe_strcat(message_text, sizeof(message_text), number_buf);	
+		length += format_text(&message_text[length], sizeof(message_text) - length, number_buf);	
 
 		// tws
-		if (time_ms - boat_data_reception_time.true_wind_speed_received_time < TRUE_WIND_SPEED_MAX_DATA_AGE_MS || boat_data_reception_time.true_wind_speed_received_time > time_ms)
+		if (boat_data_fresh(&snapshot, boat_data_true_wind_speed, time_ms))
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "TWS=%0.1f kt\n", true_wind_speed_data);
+			line_length = format_text(number_buf, sizeof(number_buf), "TWS=");
+			line_length += format_fixed(&number_buf[line_length], sizeof(number_buf) - line_length, snapshot.entries[boat_data_true_wind_speed].value.number, 1U, 0U);
+			(void)format_text(&number_buf[line_length], sizeof(number_buf) - line_length, " kt\n");
 		}
 		else
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "TWS=?\n");
+			(void)format_text(number_buf, sizeof(number_buf), "TWS=?\n");
 		}
-		(void)util_safe_strcat(message_text, sizeof(message_text), number_buf);			
+		length += format_text(&message_text[length], sizeof(message_text) - length, number_buf);			
 		
 		// twa
-		if (time_ms - boat_data_reception_time.true_wind_angle_received_time < TRUE_WIND_ANGLE_MAX_DATA_AGE_MS || boat_data_reception_time.true_wind_angle_received_time > time_ms)
+		if (boat_data_fresh(&snapshot, boat_data_true_wind_angle, time_ms))
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "TWA=%0.1f\n", true_wind_angle_data);
+			line_length = format_text(number_buf, sizeof(number_buf), "TWA=");
+			line_length += format_fixed(&number_buf[line_length], sizeof(number_buf) - line_length, snapshot.entries[boat_data_true_wind_angle].value.number, 1U, 0U);
+			(void)format_text(&number_buf[line_length], sizeof(number_buf) - line_length, "\n");
 		}
 		else
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "TWA=?\n");
+			(void)format_text(number_buf, sizeof(number_buf), "TWA=?\n");
 		}
-		(void)util_safe_strcat(message_text, sizeof(message_text), number_buf);			
+		length += format_text(&message_text[length], sizeof(message_text) - length, number_buf);			
 		
 
 		// aws
-		if (time_ms - boat_data_reception_time.apparent_wind_speed_received_time < APPARENT_WIND_SPEED_MAX_DATA_AGE_MS || boat_data_reception_time.apparent_wind_speed_received_time > time_ms)
+		if (boat_data_fresh(&snapshot, boat_data_apparent_wind_speed, time_ms))
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "AWS=%.1f kt\n", apparent_wind_speed_data);
+			line_length = format_text(number_buf, sizeof(number_buf), "AWS=");
+			line_length += format_fixed(&number_buf[line_length], sizeof(number_buf) - line_length, snapshot.entries[boat_data_apparent_wind_speed].value.number, 1U, 0U);
+			(void)format_text(&number_buf[line_length], sizeof(number_buf) - line_length, " kt\n");
 		}
 		else
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "AWS=?\n");
+			(void)format_text(number_buf, sizeof(number_buf), "AWS=?\n");
 		}
-		(void)util_safe_strcat(message_text, sizeof(message_text), number_buf);			
+		length += format_text(&message_text[length], sizeof(message_text) - length, number_buf);			
 		
 
 		// awa
-		if (time_ms - boat_data_reception_time.apparent_wind_angle_received_time < APPARENT_WIND_ANGLE_MAX_DATA_AGE_MS || boat_data_reception_time.apparent_wind_angle_received_time > time_ms)
+		if (boat_data_fresh(&snapshot, boat_data_apparent_wind_angle, time_ms))
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "AWA=%.1f\n", apparent_wind_angle_data);
+			line_length = format_text(number_buf, sizeof(number_buf), "AWA=");
+			line_length += format_fixed(&number_buf[line_length], sizeof(number_buf) - line_length, snapshot.entries[boat_data_apparent_wind_angle].value.number, 1U, 0U);
+			(void)format_text(&number_buf[line_length], sizeof(number_buf) - line_length, "\n");
 		}		
 		else
 		{
-			(void)snprintf(number_buf, sizeof(number_buf), "AWA=?\n");
+			(void)format_text(number_buf, sizeof(number_buf), "AWA=?\n");
 		}
-		(void)util_safe_strcat(message_text, sizeof(message_text), number_buf);			
+		length += format_text(&message_text[length], sizeof(message_text) - length, number_buf);			
 
 		(void)sms_send(message_text, settings_get_phone_number());				
 		found = true;		
@@ -599,14 +756,19 @@ void publisher_task(void *parameters)
 	uint32_t i;
 	uint16_t properties_parsed;
 	uint32_t time_ms;
+	boat_data_snapshot_t snapshot;
+	telemetry_sample_t sample;
 	char mqtt_topic[20];
 	char mqtt_data_buf[220];	
-	char number_buf[20];
+	size_t length;
 	uint8_t publish_failed_count = 0U;
+	n2k_health_t n2k_health;
+	char alarm_text[ALARM_SMS_TEXT_LENGTH + 1];
 	
 	(void)parameters;
 	
 	ESP_LOGI(pcTaskGetName(NULL), "Boat iot task started");
+	telemetry_init(&telemetry, TELEMETRY_DEFAULT_KEYFRAME_INTERVAL);
 	
 	// signal main task that this task has started
 	(void)xTaskNotifyGive(get_main_task_handle());
@@ -667,150 +829,38 @@ void publisher_task(void *parameters)
 			// publish all data in one
 			if (!loop_failed && ModemGetTcpConnectedState())
 			{				
-				// topic
-				(void)snprintf(mqtt_topic, sizeof(mqtt_topic), "%08X/all", settings_get_hashed_imei());							
 				time_ms = timer_get_time_ms();			
+				boat_data_get_all(&snapshot);
+				telemetry_make_sample(&snapshot, time_ms, strength, settings_get_publishing_period_s(), &sample);
 				
-				// signal strength
-				(void)snprintf(mqtt_data_buf, sizeof(mqtt_data_buf), "%hhu,", strength);
-				
-				// cog
-				if (time_ms - boat_data_reception_time.course_over_ground_received_time < COG_MAX_DATA_AGE_MS || boat_data_reception_time.course_over_ground_received_time > time_ms)
-				{
-					(void)snprintf(number_buf, sizeof(number_buf), "%hu", course_over_ground_data);
-					(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), number_buf);
-				}
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), ",");
-				
-				// temperature
-				if (time_ms - boat_data_reception_time.seawater_temperature_received_time < TEMPERATURE_MAX_DATA_AGE_MS || boat_data_reception_time.seawater_temperature_received_time > time_ms)
-				{
-					(void)snprintf(number_buf, sizeof(number_buf), "%.1f", seawater_temeperature_data);
-					(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), number_buf);
-				}
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), ",");
-
-				// sog
-				if (time_ms - boat_data_reception_time.speed_over_ground_received_time < SOG_MAX_DATA_AGE_MS || boat_data_reception_time.speed_over_ground_received_time > time_ms)
-				{
-					(void)snprintf(number_buf, sizeof(number_buf), "%.1f", speed_over_ground_data);
-					(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), number_buf);
-				}
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), ",");
-				
-				// boat speed
-				if (time_ms - boat_data_reception_time.boat_speed_received_time < BOAT_SPEED_MAX_DATA_AGE_MS || boat_data_reception_time.boat_speed_received_time > time_ms)
-				{
-					(void)snprintf(number_buf, sizeof(number_buf), "%.1f", boat_speed_data);
-					(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), number_buf);
-				}
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), ",");
-
-				// log
-				if (time_ms - boat_data_reception_time.total_distance_received_time < TOTAL_DISTANCE_MAX_DATA_AGE_MS || boat_data_reception_time.total_distance_received_time > time_ms)
-				{
-					(void)snprintf(number_buf, sizeof(number_buf), "%u", (unsigned int)total_distance_data);
-					(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), number_buf);
-				}
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), ",");
-
-				// trip
-				if (time_ms - boat_data_reception_time.trip_received_time < TRIP_MAX_DATA_AGE_MS || boat_data_reception_time.trip_received_time > time_ms)
-				{
-					(void)snprintf(number_buf, sizeof(number_buf), "%.1f", trip_data);
-					(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), number_buf);
-				}
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), ",");
-
-				// heading
-				if (time_ms - boat_data_reception_time.heading_true_received_time < HEADING_TRUE_MAX_DATA_AGE_MS || boat_data_reception_time.heading_true_received_time > time_ms)
-				{
-					(void)snprintf(number_buf, sizeof(number_buf), "%u", (unsigned int)heading_true_data);
-					(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), number_buf);
-				}
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), ",");
-
-				// depth
-				if (time_ms - boat_data_reception_time.depth_received_time < DEPTH_MAX_DATA_AGE_MS || boat_data_reception_time.depth_received_time > time_ms)
+				if (binary_payload)
 				{
-					(void)snprintf(number_buf, sizeof(number_buf), "%.1f", depth_data);
-					(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), number_buf);
+					(void)snprintf(mqtt_topic, sizeof(mqtt_topic), "%08X/bin", settings_get_hashed_imei());							
+					length = telemetry_build_binary(&telemetry, &sample, (uint8_t *)mqtt_data_buf, sizeof(mqtt_data_buf));
+					mqtt_status = length > 0U ? MqttPublish(mqtt_topic, (uint8_t *)mqtt_data_buf, length, false, 10000UL) :
+							MQTT_BAD_PARAMETER;									
+					ESP_LOGI(pcTaskGetName(NULL), "Mqtt publish %s %u bytes %s", mqtt_topic, (uint32_t)length, MqttStatusToText(mqtt_status));		
 				}
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), ",");
-								
-				// tws
-				if (time_ms - boat_data_reception_time.true_wind_speed_received_time < TRUE_WIND_SPEED_MAX_DATA_AGE_MS || boat_data_reception_time.true_wind_speed_received_time > time_ms)
-				{
-					(void)snprintf(number_buf, sizeof(number_buf), "%.1f", true_wind_speed_data);
-					(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), number_buf);
-				}
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), ",");
-
-				// twa
-				if (time_ms - boat_data_reception_time.true_wind_angle_received_time < TRUE_WIND_ANGLE_MAX_DATA_AGE_MS || boat_data_reception_time.true_wind_angle_received_time > time_ms)
-				{
-					(void)snprintf(number_buf, sizeof(number_buf), "%.1f", true_wind_angle_data);
-					(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), number_buf);
-				}
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), ",");
-
-				// aws
-				if (time_ms - boat_data_reception_time.apparent_wind_speed_received_time < APPARENT_WIND_SPEED_MAX_DATA_AGE_MS || boat_data_reception_time.apparent_wind_speed_received_time > time_ms)
-				{
-					(void)snprintf(number_buf, sizeof(number_buf), "%.1f", apparent_wind_speed_data);
-					(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), number_buf);
-				}
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), ",");
-
-				// awa
-				if (time_ms - boat_data_reception_time.apparent_wind_angle_received_time < APPARENT_WIND_ANGLE_MAX_DATA_AGE_MS || boat_data_reception_time.apparent_wind_angle_received_time > time_ms)
-				{
-					(void)snprintf(number_buf, sizeof(number_buf), "%.1f", apparent_wind_angle_data);
-					(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), number_buf);
-				}
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), ",");
-				
-				// latitude
-				if (time_ms - boat_data_reception_time.latitude_received_time < LATITUDE_MAX_DATA_AGE_MS || boat_data_reception_time.latitude_received_time > time_ms)
-				{
-					(void)snprintf(number_buf, sizeof(number_buf), "%.4f", latitude_data);
-					(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), number_buf);
-				}
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), ",");				
-				
-				// longitude
-				if (time_ms - boat_data_reception_time.longitude_received_time < LONGITUDE_MAX_DATA_AGE_MS || boat_data_reception_time.longitude_received_time > time_ms)
+				else
 				{
-					(void)snprintf(number_buf, sizeof(number_buf), "%.4f", longitude_data);
-					(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), number_buf);
+					(void)snprintf(mqtt_topic, sizeof(mqtt_topic), "%08X/all", settings_get_hashed_imei());							
+					length = telemetry_build_csv(&telemetry, &sample, mqtt_data_buf, sizeof(mqtt_data_buf));
+					mqtt_status = MqttPublish(mqtt_topic, (uint8_t *)mqtt_data_buf, length, false, 10000UL);									
+					ESP_LOGI(pcTaskGetName(NULL), "Mqtt publish %s %s %s", mqtt_topic, mqtt_data_buf, MqttStatusToText(mqtt_status));		
 				}
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), ",");		
-
-				// pressure
-				if (time_ms - boat_data_reception_time.pressure_received_time < PRESSURE_MAX_DATA_AGE_MS || boat_data_reception_time.pressure_received_time > time_ms)
-				{
-					(void)snprintf(number_buf, sizeof(number_buf), "%.1f", pressure_data);
-					(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), number_buf);
-				}			
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), ",");		
-													
-				// period
-				(void)snprintf(number_buf, sizeof(number_buf), "%u", settings_get_publishing_period_s());
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), number_buf);	
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), ",");	
-
-				// exhaust temperature
-				(void)snprintf(number_buf, sizeof(number_buf), "%.1f", exhaust_temperature_data);
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), number_buf);
-				(void)util_safe_strcat(mqtt_data_buf, sizeof(mqtt_data_buf), ",");				
-
-				mqtt_status = MqttPublish(mqtt_topic, (uint8_t *)mqtt_data_buf, strlen(mqtt_data_buf), false, 10000UL);									
-				ESP_LOGI(pcTaskGetName(NULL), "Mqtt publish %s %s %s", mqtt_topic, mqtt_data_buf, MqttStatusToText(mqtt_status));		
+				telemetry_publish_result(&telemetry, mqtt_status == MQTT_OK);
 								
 				if (mqtt_status == MQTT_OK)
 				{
 					publish_failed_count = 0U;
 					led_flash(1000UL);
+					
+					// NMEA2000 bus health, best effort so failure here does not count
+					get_n2k_health(&n2k_health);
+					(void)snprintf(mqtt_topic, sizeof(mqtt_topic), "%08X/n2k", settings_get_hashed_imei());
+					length = build_n2k_health_payload(mqtt_data_buf, sizeof(mqtt_data_buf), &n2k_health);
+					mqtt_status = MqttPublish(mqtt_topic, (uint8_t *)mqtt_data_buf, length, false, 10000UL);
+					ESP_LOGI(pcTaskGetName(NULL), "Mqtt publish %s %s %s", mqtt_topic, mqtt_data_buf, MqttStatusToText(mqtt_status));
 				}
 				else
 				{
@@ -859,6 +909,16 @@ void publisher_task(void *parameters)
 				}
 			}
 
+			// AIS collision and proximity alarms go out as they are raised, not at the publishing period
+			while (get_alarm_sms(alarm_text))
+			{
+				if (settings_get_phone_number()[0] != '\0')
+				{
+					ESP_LOGI(pcTaskGetName(NULL), "Alarm SMS %s", alarm_text);
+					(void)sms_send(alarm_text, settings_get_phone_number());
+				}
+			}
+
 			vTaskDelay(1000UL);		
 			if (publish_failed_count > 0U)
 			{
@@ -32,6 +32,7 @@ SOFTWARE.
 #include "driver/gpio.h"
 #include "serial.h"
 #include "spp_acceptor.h"
+#include "capture.h"
 
 /**************
 *** DEFINES ***
@@ -96,6 +97,11 @@ size_t serial_1_read_data(size_t buffer_length, uint8_t *data)
 	size_t bytes_available;
 	size_t bytes_read;
 	
+	if (capture_replay_is_active())
+	{
+		return capture_replay_read(CAPTURE_STREAM_N0183, buffer_length, data);
+	}
+	
 	uart_get_buffered_data_len(UART_NUM_2, &bytes_available);
 	
 	if (bytes_available <= buffer_length)
@@ -106,6 +112,10 @@ size_t serial_1_read_data(size_t buffer_length, uint8_t *data)
 	{
 		bytes_read = (size_t)uart_read_bytes(UART_NUM_2, (void *)data, (uint32_t)buffer_length, (TickType_t)1);
 	}	
+	if (bytes_read <= buffer_length)
+	{
+		capture_serial(CAPTURE_STREAM_N0183, data, bytes_read);
+	}
 
 	return bytes_read;
 }
@@ -119,32 +129,15 @@ size_t serial_2_send_data(size_t length, const uint8_t *data)
 
 size_t serial_2_read_data(size_t buffer_length, uint8_t *data)
 {
-	size_t bytes_available;
-	size_t bytes_to_read;
-	size_t i;
-	int result;
-	
-	bytes_available = spp_bytes_received_size();
+	size_t bytes_read;
 	
-	if (bytes_available <= buffer_length)
+	if (capture_replay_is_active())
 	{
-		bytes_to_read = bytes_available;
+		return capture_replay_read(CAPTURE_STREAM_SPP, buffer_length, data);
 	}
-	else
-	{
-		bytes_to_read = buffer_length;
-	}	
 	
-	for (i = (size_t)0; i < bytes_to_read; i++)
-	{
-		result = spp_read();
-		if (result == -1)
-		{
-			return i;
-		}
-		
-		data[i] = (uint8_t)result;
-	}
+	bytes_read = spp_read_block(data, buffer_length);
+	capture_serial(CAPTURE_STREAM_SPP, data, bytes_read);
 	
-	return bytes_to_read;
+	return bytes_read;
 }
@@ -30,6 +30,7 @@ SOFTWARE.
 
 #include <string.h>
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "freertos/queue.h"
 #include "esp_log.h"
 #include "sms.h"
@@ -59,6 +59,7 @@ with the ESP32-IDF framework.
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
 #include "freertos/event_groups.h"
+#include "freertos/stream_buffer.h"
 #include "esp_log.h"
 #include "esp_bt.h"
 #include "esp_bt_main.h"
@@ -73,13 +74,12 @@ with the ESP32-IDF framework.
 
 #define SPP_SERVER_NAME 			"SPP_SERVER"		///< BlueDroid bluetooth serial server name, not apparent externally
 #define DEVICE_NAME 				"BlueBridge"		///< Bluetooth device name as seen by remote device
-#define RX_QUEUE_SIZE 				512					///< Queue size for incoming data in bytes
+#define RX_BUFFER_SIZE 				2048				///< Stream buffer size for incoming data in bytes, holds Actisense input while NMEA2000 send buffers are full
 #define TX_QUEUE_SIZE 				32					///< Queue size for outgoing data in packets
 #define SPP_NOT_CONGESTED   		0x04				///< Event group for when transmit is not busy
 #define SPP_TX_QUEUE_TIMEOUT 		1000				///< Transmit timeout for space to become available on transmit queue in OS ticks
 #define SPP_TX_DONE_TIMEOUT 		1000				///< Transmit timeout for completion in OS ticks
 #define SPP_NOT_CONGESTED_TIMEOUT 	1000				///< Transmit timeout for congestion to clear in OS ticks
-#define SPP_TX_MAX 					330					///< Transmit buffer size
 
 /************
 *** TYPES ***
@@ -99,6 +99,7 @@ typedef struct
 ********************************/
 
 static bool spp_send_buffer();
+static size_t spp_queue_write(const uint8_t *buffer, size_t size, TickType_t timeout);
 static void spp_tx_task(void *arg);
 static void esp_spp_cb(esp_spp_cb_event_t event, esp_spp_cb_param_t *param);
 static void esp_bt_gap_cb(esp_bt_gap_cb_event_t event, esp_bt_gap_cb_param_t *param);
@@ -107,7 +108,7 @@ static void esp_bt_gap_cb(esp_bt_gap_cb_event_t event, esp_bt_gap_cb_param_t *pa
 *** LOCAL VARIABLES ***
 **********************/
 
-static xQueueHandle spp_rx_queue;				///< Receive queue OS object
+static StreamBufferHandle_t spp_rx_buffer;		///< Receive stream buffer OS object, one reader, the NMEA0183 processor through serial_2_read_data
 static xQueueHandle spp_tx_queue;				///< Transmit queue OS object
 static EventGroupHandle_t spp_event_group;		///< OS object used for flow control 
 static SemaphoreHandle_t spp_tx_done;			///< Sempahore released when transmission completed
@@ -160,6 +161,37 @@ static bool spp_send_buffer()
     return false;
 }
 
+/**
+ * Put data on the transmit queue
+ *
+ * @param buffer The data to write
+ * @param size The length of data in buffer
+ * @param timeout How long to wait for space on the transmit queue in OS ticks
+ * @return How many bytes were written, all or 0
+ */
+static size_t spp_queue_write(const uint8_t *buffer, size_t size, TickType_t timeout)
+{
+    if (buffer == NULL || size == (size_t)0 || spp_tx_queue == NULL)
+    {
+        return (size_t)0;
+    }
+
+    spp_packet_t *packet = (spp_packet_t *)pvPortMalloc(sizeof(spp_packet_t) + size);
+    if (!packet)
+    {
+        return (size_t)0;
+    }
+    packet->len = size;
+    (void)memcpy(packet->data, buffer, size);
+    if (xQueueSend(spp_tx_queue, &packet, timeout) != pdPASS)
+    {
+        vPortFree(packet);
+        return (size_t)0;
+    }
+
+    return size;
+}
+
 /**
  * Task function running the bluetooth code
  * @param arg Unused
@@ -235,6 +267,8 @@ static void spp_tx_task(void *arg)
  */
 static void esp_spp_cb(esp_spp_cb_event_t event, esp_spp_cb_param_t *param)
 {
+    size_t sent;
+
     switch (event)
     {
     case ESP_SPP_INIT_EVT:
@@ -275,14 +309,11 @@ static void esp_spp_cb(esp_spp_cb_event_t event, esp_spp_cb_param_t *param)
         break;
 
     case ESP_SPP_DATA_IND_EVT:
-        ESP_LOGI(pcTaskGetName(NULL), "ESP_SPP_DATA_IND_EVT len=%d handle=%d", param->data_ind.len, param->data_ind.handle);
-        for (int i = 0; i < param->data_ind.len; i++)
+        ESP_LOGD(pcTaskGetName(NULL), "ESP_SPP_DATA_IND_EVT len=%d handle=%d", param->data_ind.len, param->data_ind.handle);
+        sent = xStreamBufferSend(spp_rx_buffer, param->data_ind.data, (size_t)param->data_ind.len, (TickType_t)0);
+        if (sent < (size_t)param->data_ind.len)
         {
-        	if (xQueueSend(spp_rx_queue, param->data_ind.data + i, (TickType_t)0) != pdTRUE)
-        	{
-				ESP_LOGI(pcTaskGetName(NULL), "RX Full! Discarding %u bytes", param->data_ind.len - i);
-				break;
-			}
+			ESP_LOGI(pcTaskGetName(NULL), "RX Full! Discarding %u bytes", (unsigned int)((size_t)param->data_ind.len - sent));
         }
         break;
 
@@ -410,7 +441,7 @@ void spp_init()
     spp_event_group = xEventGroupCreate();
     xEventGroupClearBits(spp_event_group, 0xFFFFFF);
     xEventGroupSetBits(spp_event_group, SPP_NOT_CONGESTED);
-    spp_rx_queue = xQueueCreate(RX_QUEUE_SIZE, sizeof(uint8_t));
+    spp_rx_buffer = xStreamBufferCreate(RX_BUFFER_SIZE, (size_t)1);
     spp_tx_queue = xQueueCreate(TX_QUEUE_SIZE, sizeof(spp_packet_t *));
     xTaskCreatePinnedToCore(spp_tx_task, "spp_tx", 4096, NULL, 2, &spp_task_handle, 0);
     spp_tx_done = xSemaphoreCreateBinary();
@@ -470,32 +501,29 @@ void spp_init()
 
 size_t spp_write(const uint8_t *buffer, size_t size)
 {
-    if (buffer == NULL || size == (size_t)0 || spp_tx_queue == NULL)
-    {
-        return (size_t)0;
-    }
+    return spp_queue_write(buffer, size, (TickType_t)SPP_TX_QUEUE_TIMEOUT);
+}
 
-    spp_packet_t *packet = (spp_packet_t *)pvPortMalloc(sizeof(spp_packet_t) + size);
-    if (!packet)
+size_t spp_write_no_wait(const uint8_t *buffer, size_t size)
+{
+    if (!spp_client)
     {
         return (size_t)0;
     }
-    packet->len = size;
-    (void)memcpy(packet->data, buffer, size);
-    if (xQueueSend(spp_tx_queue, &packet, SPP_TX_QUEUE_TIMEOUT) != pdPASS)
-    {
-        vPortFree(packet);
-        return (size_t)0;
-    }
 
-    return size;
+    return spp_queue_write(buffer, size, (TickType_t)0);
+}
+
+bool spp_is_connected(void)
+{
+    return spp_client != 0U;
 }
 
 int spp_read(void)
 {
     uint8_t c;
 
-    if (spp_rx_queue && xQueueReceive(spp_rx_queue, &c, 0) == pdTRUE)
+    if (spp_rx_buffer && xStreamBufferReceive(spp_rx_buffer, &c, sizeof(c), (TickType_t)0) == sizeof(c))
     {
         return c;
     }
@@ -503,12 +531,22 @@ int spp_read(void)
     return -1;
 }
 
+size_t spp_read_block(uint8_t *buffer, size_t size)
+{
+	if (!spp_rx_buffer || buffer == NULL)
+	{
+		return (size_t)0;
+	}
+
+	return xStreamBufferReceive(spp_rx_buffer, buffer, size, (TickType_t)0);
+}
+
 size_t spp_bytes_received_size(void)
 {
-	if (!spp_rx_queue)
+	if (!spp_rx_buffer)
 	{
 		return (size_t)0;
 	}
 	
-	return (size_t)uxQueueMessagesWaiting(spp_rx_queue);
+	return xStreamBufferBytesAvailable(spp_rx_buffer);
 }
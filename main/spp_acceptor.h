@@ -57,11 +57,17 @@ with the ESP32-IDF framework.
 ***************/
  
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 /**************
 *** DEFINES ***
 **************/
 
+#define SPP_TX_MAX 					330					///< Transmit buffer size, writes up to this long go to the link in one piece
+
 /************
 *** TYPES ***
 ************/
@@ -88,6 +94,22 @@ void spp_init(void);
  */
 size_t spp_write(const uint8_t *buffer, size_t size);
 
+/**
+ * Write data using the Bluetooth serial port profile driver without waiting for space on the transmit queue
+ * 
+ * @param buffer The data to write
+ * @param size The length of data in buffer
+ * @return How many bytes were written, 0 if no client is connected or the transmit queue is full
+ */
+size_t spp_write_no_wait(const uint8_t *buffer, size_t size);
+
+/**
+ * Get if a client is connected to the serial port profile server
+ *
+ * @return true if connected
+ */
+bool spp_is_connected(void);
+
 /**
  * Read a single byte using the Bluetooth serial port profile driver
  * 
@@ -95,6 +117,15 @@ size_t spp_write(const uint8_t *buffer, size_t size);
  */
 int spp_read(void);
 
+/**
+ * Read waiting bytes using the Bluetooth serial port profile driver without waiting for more to arrive
+ * 
+ * @param buffer Buffer to read into
+ * @param size Size of buffer in bytes
+ * @return Bytes read, 0 if none waiting
+ */
+size_t spp_read_block(uint8_t *buffer, size_t size);
+
 /**
  * Get the length of data to read from the Bluetooth serial port profile connection
  *
@@ -0,0 +1,466 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <string.h>
+#include <math.h>
+#include "telemetry.h"
+#include "format.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define TELEMETRY_NO_CHANNEL			boat_data_channel_max	///< Channel of a field that does not come from boat data
+#define TELEMETRY_FIXED_RANGE			2147483520.0f			///< Largest float below 2^31, fixed point values are clamped to it
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * How a field is taken from boat data and written
+ */
+typedef struct
+{
+	const char *name;					///< Name in SMS commands
+	boat_data_channel_t channel;		///< Boat data channel or TELEMETRY_NO_CHANNEL
+	uint8_t decimals;					///< Decimals written, 0 writes the value truncated to an unsigned integer
+	bool angle;							///< Values are degrees compared the short way round
+} telemetry_field_info_t;
+
+/**
+ * Change needed before a field is sent again
+ */
+typedef struct
+{
+	float absolute;						///< In the field's units
+	float relative;						///< Fraction of the value last sent
+} telemetry_deadband_t;
+
+/********************************
+*** LOCAL FUNCTION PROTOTYPES ***
+********************************/
+
+static bool field_moved(telemetry_field_t field, float sent, float value);
+static size_t write_field(char *payload, size_t size, telemetry_field_t field, float value);
+static uint32_t select_fields(telemetry_state_t *state, const telemetry_sample_t *sample, uint32_t *cleared);
+static int32_t field_to_fixed(telemetry_field_t field, float value);
+static bool append_varint(uint8_t *payload, size_t size, size_t *length, uint32_t value);
+
+/**********************
+*** LOCAL VARIABLES ***
+**********************/
+
+static telemetry_deadband_t deadbands[telemetry_field_max] =
+{
+	{2.0f, 0.0f},			// signal strength
+	{5.0f, 0.0f},			// cog
+	{0.2f, 0.0f},			// seawater temperature
+	{0.2f, 0.0f},			// sog
+	{0.2f, 0.0f},			// boat speed
+	{1.0f, 0.0f},			// log
+	{0.1f, 0.0f},			// trip
+	{5.0f, 0.0f},			// heading
+	{0.2f, 0.05f},			// depth
+	{0.5f, 0.1f},			// tws
+	{10.0f, 0.0f},			// twa
+	{0.5f, 0.1f},			// aws
+	{10.0f, 0.0f},			// awa
+	{0.0001f, 0.0f},		// latitude, 11 m
+	{0.0001f, 0.0f},		// longitude
+	{0.5f, 0.0f},			// pressure
+	{0.0f, 0.0f},			// publishing period
+	{2.0f, 0.0f}			// exhaust temperature
+};
+
+/***********************
+*** GLOBAL VARIABLES ***
+***********************/
+
+/****************
+*** CONSTANTS ***
+****************/
+
+static const uint32_t powers_of_ten[] = {1UL, 10UL, 100UL, 1000UL, 10000UL};
+
+static const telemetry_field_info_t field_infos[telemetry_field_max] =
+{
+	{"STRENGTH", TELEMETRY_NO_CHANNEL, 0U, false},
+	{"COG", boat_data_course_over_ground, 0U, true},
+	{"TEMP", boat_data_seawater_temperature, 1U, false},
+	{"SOG", boat_data_speed_over_ground, 1U, false},
+	{"BOATSPEED", boat_data_boat_speed, 1U, false},
+	{"LOG", boat_data_total_distance, 0U, false},
+	{"TRIP", boat_data_trip, 1U, false},
+	{"HEADING", boat_data_heading_true, 0U, true},
+	{"DEPTH", boat_data_depth, 1U, false},
+	{"TWS", boat_data_true_wind_speed, 1U, false},
+	{"TWA", boat_data_true_wind_angle, 1U, true},
+	{"AWS", boat_data_apparent_wind_speed, 1U, false},
+	{"AWA", boat_data_apparent_wind_angle, 1U, true},
+	{"LAT", boat_data_latitude, 4U, false},
+	{"LON", boat_data_longitude, 4U, false},
+	{"PRESSURE", boat_data_pressure, 1U, false},
+	{"PERIOD", TELEMETRY_NO_CHANNEL, 0U, false},
+	{"EXHAUST", boat_data_exhaust_temperature, 1U, false}
+};
+
+/**********************
+*** LOCAL FUNCTIONS ***
+**********************/
+
+/**
+ * Check if a field has moved out of its deadband
+ *
+ * @param field The field
+ * @param sent Value last sent
+ * @param value Value now
+ * @return If the field should be sent again
+ */
+static bool field_moved(telemetry_field_t field, float sent, float value)
+{
+	float difference = fabsf(value - sent);
+
+	if (field_infos[field].angle)
+	{
+		difference = fmodf(difference, 360.0f);
+		if (difference > 180.0f)
+		{
+			difference = 360.0f - difference;
+		}
+	}
+
+	return difference > deadbands[field].absolute + deadbands[field].relative * fabsf(sent);
+}
+
+/**
+ * Write a field value as it is sent
+ *
+ * @param payload Buffer to write to
+ * @param size Size in bytes of payload
+ * @param field The field
+ * @param value Value to write
+ * @return Characters written
+ */
+static size_t write_field(char *payload, size_t size, telemetry_field_t field, float value)
+{
+	if (field_infos[field].decimals == 0U)
+	{
+		// range checked as in the binary payload, a negative or not a number value is written as 0
+		return format_uint(payload, size, (uint32_t)field_to_fixed(field, value), 0U);
+	}
+
+	return format_fixed(payload, size, value, field_infos[field].decimals, 0U);
+}
+
+/**
+ * Choose the fields of the next payload and work out what subscribers will have once it is published
+ *
+ * @param state Stream state, pending and pending_keyframe are written
+ * @param sample Fields now
+ * @param cleared Written with a bit per field that is no longer available, always 0 in a keyframe
+ * @return Bit per field to send
+ */
+static uint32_t select_fields(telemetry_state_t *state, const telemetry_sample_t *sample, uint32_t *cleared)
+{
+	uint32_t field;
+	uint32_t bit;
+	uint32_t send = 0UL;
+
+	*cleared = 0UL;
+	state->pending_keyframe = state->keyframe_needed || state->since_keyframe + 1U >= state->keyframe_interval;
+	if (state->pending_keyframe)
+	{
+		state->pending = *sample;
+		return sample->present;
+	}
+
+	state->pending = state->sent;
+	for (field = 0UL; field < (uint32_t)telemetry_field_max; field++)
+	{
+		bit = 1UL << field;
+		if ((sample->present & bit) != 0UL)
+		{
+			if ((state->sent.present & bit) == 0UL ||
+					field_moved((telemetry_field_t)field, state->sent.values[field], sample->values[field]))
+			{
+				send |= bit;
+				state->pending.values[field] = sample->values[field];
+				state->pending.present |= bit;
+			}
+		}
+		else if ((state->sent.present & bit) != 0UL)
+		{
+			*cleared |= bit;
+			state->pending.present &= ~bit;
+		}
+	}
+
+	return send;
+}
+
+/**
+ * Convert a field value to the fixed point integer of the binary payload, the value the comma separated payload
+ * shows without the decimal point. It is split by format_split_fixed as in format_fixed so both round the same.
+ *
+ * @param field The field
+ * @param value The value
+ * @return Value in units of the field's last decimal, clamped to the int32_t range, 0 if not finite
+ */
+static int32_t field_to_fixed(telemetry_field_t field, float value)
+{
+	uint8_t decimals = field_infos[field].decimals;
+	float magnitude = fabsf(value);
+	uint32_t whole;
+	uint32_t fraction;
+	uint32_t fixed;
+
+	if (!isfinite(value))
+	{
+		return 0L;
+	}
+	if (decimals == 0U)
+	{
+		// whole fields are unsigned, as write_field writes them
+		return value <= 0.0f ? 0L : (value >= TELEMETRY_FIXED_RANGE ? INT32_MAX : (int32_t)value);
+	}
+	if (magnitude * (float)powers_of_ten[decimals] >= TELEMETRY_FIXED_RANGE)
+	{
+		return value < 0.0f ? -INT32_MAX : INT32_MAX;
+	}
+
+	format_split_fixed(magnitude, decimals, &whole, &fraction);
+	fixed = whole * powers_of_ten[decimals] + fraction;
+
+	return value < 0.0f ? -(int32_t)fixed : (int32_t)fixed;
+}
+
+/**
+ * Append an unsigned value as a varint, 7 bits per byte, least significant first, top bit set on all but the last
+ *
+ * @param payload Buffer to write to
+ * @param size Size in bytes of payload
+ * @param length Bytes used in payload, advanced by the bytes written
+ * @param value The value
+ * @return true if it fitted, false if not in which case nothing is written
+ */
+static bool append_varint(uint8_t *payload, size_t size, size_t *length, uint32_t value)
+{
+	uint8_t bytes[5];
+	size_t count = 0U;
+
+	do
+	{
+		bytes[count] = (uint8_t)(value & 0x7fUL);
+		value >>= 7;
+		if (value != 0UL)
+		{
+			bytes[count] |= 0x80U;
+		}
+		count++;
+	}
+	while (value != 0UL);
+
+	if (count > size - *length)
+	{
+		return false;
+	}
+	(void)memcpy(&payload[*length], bytes, count);
+	*length += count;
+
+	return true;
+}
+
+/***********************
+*** GLOBAL FUNCTIONS ***
+***********************/
+
+void telemetry_init(telemetry_state_t *state, uint16_t keyframe_interval)
+{
+	(void)memset(state, 0, sizeof(telemetry_state_t));
+	state->keyframe_needed = true;
+	if (!telemetry_set_keyframe_interval(state, keyframe_interval))
+	{
+		state->keyframe_interval = TELEMETRY_DEFAULT_KEYFRAME_INTERVAL;
+	}
+}
+
+bool telemetry_set_keyframe_interval(telemetry_state_t *state, uint16_t keyframe_interval)
+{
+	if (keyframe_interval < 1U || keyframe_interval > TELEMETRY_MAX_KEYFRAME_INTERVAL)
+	{
+		return false;
+	}
+	state->keyframe_interval = keyframe_interval;
+
+	return true;
+}
+
+bool telemetry_set_deadband(telemetry_field_t field, float absolute, float relative)
+{
+	// written as !(x >= 0) so NaN is refused too
+	if (field >= telemetry_field_max || !(absolute >= 0.0f) || !(relative >= 0.0f))
+	{
+		return false;
+	}
+	deadbands[field].absolute = absolute;
+	deadbands[field].relative = relative;
+
+	return true;
+}
+
+telemetry_field_t telemetry_field_from_name(const char *name)
+{
+	uint32_t field;
+
+	for (field = 0UL; field < (uint32_t)telemetry_field_max; field++)
+	{
+		if (strcmp(name, field_infos[field].name) == 0)
+		{
+			break;
+		}
+	}
+
+	return (telemetry_field_t)field;
+}
+
+void telemetry_make_sample(const boat_data_snapshot_t *snapshot, uint32_t time_ms, uint8_t strength, uint32_t period_s,
+		telemetry_sample_t *sample)
+{
+	uint32_t field;
+	boat_data_channel_t channel;
+
+	sample->present = 0UL;
+	for (field = 0UL; field < (uint32_t)telemetry_field_max; field++)
+	{
+		channel = field_infos[field].channel;
+		sample->values[field] = 0.0f;
+		if (channel != TELEMETRY_NO_CHANNEL && boat_data_fresh(snapshot, channel, time_ms))
+		{
+			sample->values[field] = snapshot->entries[channel].value.number;
+			sample->present |= 1UL << field;
+		}
+	}
+
+	sample->values[telemetry_field_signal_strength] = (float)strength;
+	sample->values[telemetry_field_publishing_period] = (float)period_s;
+	// exhaust temperature has always been sent, 0 when there is no sensor
+	sample->values[telemetry_field_exhaust_temperature] = snapshot->entries[boat_data_exhaust_temperature].value.number;
+	sample->present |= (1UL << telemetry_field_signal_strength) | (1UL << telemetry_field_publishing_period) |
+			(1UL << telemetry_field_exhaust_temperature);
+}
+
+size_t telemetry_build_csv(telemetry_state_t *state, const telemetry_sample_t *sample, char *payload, size_t size)
+{
+	uint32_t send;
+	uint32_t cleared;
+	uint32_t field;
+	size_t length = 0U;
+
+	send = select_fields(state, sample, &cleared);
+	for (field = 0UL; field < (uint32_t)telemetry_field_max; field++)
+	{
+		if ((send & (1UL << field)) != 0UL)
+		{
+			length += write_field(&payload[length], size - length, (telemetry_field_t)field, sample->values[field]);
+		}
+		else if ((cleared & (1UL << field)) != 0UL)
+		{
+			length += format_text(&payload[length], size - length, "-");
+		}
+		length += format_text(&payload[length], size - length, ",");
+	}
+
+	length += format_uint(&payload[length], size - length, (uint32_t)state->sequence, 0U);
+	length += format_text(&payload[length], size - length, state->pending_keyframe ? ",K" : ",D");
+	state->sequence++;
+
+	return length;
+}
+
+size_t telemetry_build_binary(telemetry_state_t *state, const telemetry_sample_t *sample, uint8_t *payload, size_t size)
+{
+	uint32_t send;
+	uint32_t cleared;
+	uint32_t field;
+	int32_t fixed;
+	size_t length = 2U;
+
+	if (size < 2U)
+	{
+		return 0U;
+	}
+
+	send = select_fields(state, sample, &cleared);
+	payload[0] = TELEMETRY_BINARY_VERSION;
+	payload[1] = (uint8_t)((state->pending_keyframe ? TELEMETRY_BINARY_FLAG_KEYFRAME : 0U) |
+			(cleared != 0UL ? TELEMETRY_BINARY_FLAG_CLEARED : 0U));
+	if (!append_varint(payload, size, &length, (uint32_t)state->sequence) ||
+			!append_varint(payload, size, &length, send) ||
+			(cleared != 0UL && !append_varint(payload, size, &length, cleared)))
+	{
+		return 0U;
+	}
+	for (field = 0UL; field < (uint32_t)telemetry_field_max; field++)
+	{
+		if ((send & (1UL << field)) != 0UL)
+		{
+			// zigzag so small negative numbers are short too
+			fixed = field_to_fixed((telemetry_field_t)field, sample->values[field]);
+			if (!append_varint(payload, size, &length, ((uint32_t)fixed << 1) ^ (uint32_t)(fixed >> 31)))
+			{
+				return 0U;
+			}
+		}
+	}
+	state->sequence++;
+
+	return length;
+}
+
+void telemetry_publish_result(telemetry_state_t *state, bool published)
+{
+	if (!published)
+	{
+		state->keyframe_needed = true;
+		return;
+	}
+
+	state->sent = state->pending;
+	state->keyframe_needed = false;
+	if (state->pending_keyframe)
+	{
+		state->since_keyframe = 0U;
+	}
+	else
+	{
+		state->since_keyframe++;
+	}
+}
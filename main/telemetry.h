@@ -0,0 +1,216 @@
+/*
+
+MIT License
+
+Copyright (c) John Blaiklock 2022 BlueBridge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************
+*** INCLUDES ***
+***************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "boat_data.h"
+
+/**************
+*** DEFINES ***
+**************/
+
+#define TELEMETRY_DEFAULT_KEYFRAME_INTERVAL		10U			///< Publishes from one keyframe to the next unless changed by SMS
+#define TELEMETRY_MAX_KEYFRAME_INTERVAL			100U		///< Most publishes from one keyframe to the next
+#define TELEMETRY_BINARY_VERSION				1U			///< First byte of a binary payload, changes when fields or their scaling change
+#define TELEMETRY_BINARY_FLAG_KEYFRAME			0x01U		///< Binary payload flag, the payload is a keyframe
+#define TELEMETRY_BINARY_FLAG_CLEARED			0x02U		///< Binary payload flag, a bitmap of fields no longer available follows the present bitmap
+#define TELEMETRY_BINARY_MAX_LENGTH				101U		///< Longest binary payload, 2 header bytes, sequence and 2 field bitmaps of up to 3 bytes and 18 fields of up to 5 bytes
+
+/************
+*** TYPES ***
+************/
+
+/**
+ * Fields of the telemetry payload in the order they are sent
+ */
+typedef enum
+{
+	telemetry_field_signal_strength,		///< Modem signal strength 0-31
+	telemetry_field_course_over_ground,		///< COG in whole degrees true
+	telemetry_field_seawater_temperature,	///< Seawater temperature in degrees C
+	telemetry_field_speed_over_ground,		///< SOG in knots
+	telemetry_field_boat_speed,				///< Boat speed through water in knots
+	telemetry_field_total_distance,			///< Log in whole nautical miles
+	telemetry_field_trip,					///< Trip in nautical miles
+	telemetry_field_heading_true,			///< Heading in whole degrees true
+	telemetry_field_depth,					///< Depth in metres
+	telemetry_field_true_wind_speed,		///< TWS in knots
+	telemetry_field_true_wind_angle,		///< TWA in degrees
+	telemetry_field_apparent_wind_speed,	///< AWS in knots
+	telemetry_field_apparent_wind_angle,	///< AWA in degrees
+	telemetry_field_latitude,				///< Latitude in degrees, north positive
+	telemetry_field_longitude,				///< Longitude in degrees, east positive
+	telemetry_field_pressure,				///< Atmospheric pressure in mb
+	telemetry_field_publishing_period,		///< Publishing period in seconds
+	telemetry_field_exhaust_temperature,	///< Engine exhaust temperature in degrees C
+	telemetry_field_max						/* must be last value */
+} telemetry_field_t;
+
+/**
+ * Values of one publish, taken from a boat data snapshot
+ */
+typedef struct
+{
+	uint32_t present;						///< Bit per telemetry_field_t set if the field is available
+	float values[telemetry_field_max];		///< Field values, only those with the present bit set are meaningful
+} telemetry_sample_t;
+
+/**
+ * What the subscribers of one topic have been sent. A payload is either a keyframe with every field or a delta
+ * with only the fields that moved out of their deadband since they were last sent.
+ */
+typedef struct
+{
+	telemetry_sample_t sent;				///< Fields as subscribers have them after the last successful publish
+	telemetry_sample_t pending;				///< Fields as subscribers will have them if the payload last built is published
+	uint16_t sequence;						///< Sequence number of the next payload, wraps at 65535
+	uint16_t keyframe_interval;				///< Publishes from one keyframe to the next, 1 for keyframes only
+	uint16_t since_keyframe;				///< Deltas published since the last keyframe
+	bool keyframe_needed;					///< The next payload is a keyframe whatever the interval
+	bool pending_keyframe;					///< The payload last built is a keyframe
+} telemetry_state_t;
+
+/*************************
+*** EXTERNAL VARIABLES ***
+*************************/
+
+/***************************
+*** FUNCTIONS PROTOTYPES ***
+***************************/
+
+/**
+ * Start a new stream of payloads, the first is a keyframe
+ *
+ * @param state Stream state, owned by the caller
+ * @param keyframe_interval Publishes from one keyframe to the next, 1 to send only keyframes
+ */
+void telemetry_init(telemetry_state_t *state, uint16_t keyframe_interval);
+
+/**
+ * Change the keyframe interval of a stream, taking effect from the next payload
+ *
+ * @param state Stream state
+ * @param keyframe_interval Publishes from one keyframe to the next, 1 to TELEMETRY_MAX_KEYFRAME_INTERVAL
+ * @return If the interval was in range and set
+ */
+bool telemetry_set_keyframe_interval(telemetry_state_t *state, uint16_t keyframe_interval);
+
+/**
+ * Set how far a field must move from the value last sent before it is sent again in a delta. The field is sent when
+ * the difference is more than absolute + relative * |last sent value|. Angles are compared the short way round.
+ * A field becoming available or unavailable is always sent. Deadbands are shared by all streams.
+ *
+ * @param field The field
+ * @param absolute Absolute part of the deadband in the field's units, 0 or more
+ * @param relative Relative part of the deadband as a fraction of the value last sent, 0 or more
+ * @return If the field and deadband were valid and set
+ */
+bool telemetry_set_deadband(telemetry_field_t field, float absolute, float relative);
+
+/**
+ * Find a field from its name as used in SMS commands, e.g. DEPTH or TWS
+ *
+ * @param name Field name in capitals
+ * @return The field or telemetry_field_max if not known
+ */
+telemetry_field_t telemetry_field_from_name(const char *name);
+
+/**
+ * Take the fields of a publish from a boat data snapshot. Channels that are not fresh are not present. Signal strength,
+ * publishing period and exhaust temperature are always present.
+ *
+ * @param snapshot Boat data read by the caller
+ * @param time_ms Time the snapshot was read
+ * @param strength Modem signal strength
+ * @param period_s Publishing period in seconds
+ * @param sample Written with the fields
+ */
+void telemetry_make_sample(const boat_data_snapshot_t *snapshot, uint32_t time_ms, uint8_t strength, uint32_t period_s,
+		telemetry_sample_t *sample);
+
+/**
+ * Build the next comma separated payload of a stream. Every field is followed by a comma, then come the sequence
+ * number and K for a keyframe or D for a delta. In a keyframe an empty field is not available. In a delta an empty
+ * field has not changed and - is a field that is no longer available. Call telemetry_publish_result after the payload
+ * has been published or has failed.
+ *
+ * @param state Stream state
+ * @param sample Fields to send
+ * @param payload Buffer to write to
+ * @param size Size in bytes of payload
+ * @return Length of payload written
+ */
+size_t telemetry_build_csv(telemetry_state_t *state, const telemetry_sample_t *sample, char *payload, size_t size);
+
+/**
+ * Build the next binary payload of a stream. It has the same fields and delta rules as the comma separated payload.
+ *
+ *     byte 0      TELEMETRY_BINARY_VERSION
+ *     byte 1      flags, TELEMETRY_BINARY_FLAG_KEYFRAME and TELEMETRY_BINARY_FLAG_CLEARED
+ *     varint      sequence number
+ *     varint      bitmap of fields that follow, bit n for telemetry_field_t n
+ *     varint      bitmap of fields no longer available, only with TELEMETRY_BINARY_FLAG_CLEARED
+ *     varints     a zigzag encoded value for each field in the bitmap in field order
+ *
+ * Varints are 7 bits per byte, least significant first, with the top bit set on all but the last byte. A field value
+ * is a fixed point integer of the number the comma separated payload shows, e.g. depth 12.3 is 123 and latitude
+ * -58.1235 is -581235, and zigzag encoded as (n << 1) ^ (n >> 31). Call telemetry_publish_result after the payload has
+ * been published or has failed.
+ *
+ * @param state Stream state
+ * @param sample Fields to send
+ * @param payload Buffer to write to
+ * @param size Size in bytes of payload, at least TELEMETRY_BINARY_MAX_LENGTH
+ * @return Length of payload written, 0 if it did not fit in size
+ */
+size_t telemetry_build_binary(telemetry_state_t *state, const telemetry_sample_t *sample, uint8_t *payload, size_t size);
+
+/**
+ * Record the outcome of publishing the payload last built. After a failure the next payload is a keyframe as the
+ * subscribers may have missed a change.
+ *
+ * @param state Stream state
+ * @param published If the payload was published
+ */
+void telemetry_publish_result(telemetry_state_t *state, bool published);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
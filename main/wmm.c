@@ -28,6 +28,7 @@ SOFTWARE.
 *** INCLUDES ***
 ***************/
 
+#include <stddef.h>
 #include <stdbool.h>
 #include <math.h>
 #include "wmm.h"